@@ -21,6 +21,8 @@ DOWNLOAD_RDEP=$(STAMP_PREPARED) $(HOST_STAMP_PREPARED)
 # Export options for download.pl
 export DOWNLOAD_CHECK_CERTIFICATE:=$(CONFIG_DOWNLOAD_CHECK_CERTIFICATE)
 export DOWNLOAD_TOOL_CUSTOM:=$(CONFIG_DOWNLOAD_TOOL_CUSTOM)
+export DOWNLOAD_PARALLEL:=$(CONFIG_DOWNLOAD_PARALLEL)
+export DOWNLOAD_HOST_JOBS:=$(CONFIG_DOWNLOAD_HOST_JOBS)
 
 define dl_method_git
 $(if $(filter https://github.com/% git://github.com/%,$(1)),github_archive,git)
@@ -136,6 +136,7 @@ endef
 UBI_NAND_SIZE_LIMIT = $(IMAGE_SIZE) - ($(NAND_SIZE)*20/1024 + 4*$(BLOCKSIZE))
 
 define Build/append-ubi
+	UBINIZE_CACHE_DIR=$(KDIR_TMP)/ubinize \
 	sh $(TOPDIR)/scripts/ubinize-image.sh \
 		$(if $(UBOOTENV_IN_UBI),--uboot-env) \
 		$(if $(KERNEL_IN_UBI),--kernel $(IMAGE_KERNEL)) \
@@ -153,6 +154,7 @@ define Build/append-ubi
 endef
 
 define Build/ubinize-image
+	UBINIZE_CACHE_DIR=$(KDIR_TMP)/ubinize \
 	sh $(TOPDIR)/scripts/ubinize-image.sh \
 		$(if $(UBOOTENV_IN_UBI),--uboot-env) \
 		$(foreach part,$(UBINIZE_PARTS),--part $(part)) \
@@ -372,6 +374,14 @@ define Build/initrd_compression
 	$(if $(CONFIG_TARGET_INITRAMFS_COMPRESSION_ZSTD),.zstd)
 endef
 
+# Only a separate initramfs is shared with other devices (of the same rootfs)
+# and rebuilt by Kernel/CompileImage/Initramfs, anything else is per device.
+define Build/fit_lock
+$(strip $(if $(and $(findstring with-initrd,$(word 3,$(1))),$(CONFIG_TARGET_ROOTFS_INITRAMFS_SEPARATE)), \
+	gen-cpio$(if $(TARGET_PER_DEVICE_ROOTFS),.$(ROOTFS_ID/$(DEVICE_NAME))), \
+	fit-$(DEVICE_NAME)))
+endef
+
 define Build/fit
 	$(call locked,$(TOPDIR)/scripts/mkits.sh \
 		-D $(DEVICE_NAME) -o $@.its -k $@ \
@@ -390,9 +400,10 @@ define Build/fit
 		$(if $(DEVICE_DTS_LOADADDR),-s $(DEVICE_DTS_LOADADDR)) \
 		$(if $(DEVICE_DTS_OVERLAY),$(foreach dtso,$(DEVICE_DTS_OVERLAY), -O $(dtso):$(KERNEL_BUILD_DIR)/image-$(dtso).dtbo)) \
 		-c $(if $(DEVICE_DTS_CONFIG),$(DEVICE_DTS_CONFIG),"config-1") \
-		-A $(LINUX_KARCH) -v $(LINUX_VERSION), gen-cpio$(if $(TARGET_PER_DEVICE_ROOTFS),.$(ROOTFS_ID/$(DEVICE_NAME))))
+		-A $(LINUX_KARCH) -v $(LINUX_VERSION), $(call Build/fit_lock,$(1)))
 	$(call locked,PATH=$(LINUX_DIR)/scripts/dtc:$(PATH) mkimage $(if $(findstring external,$(word 3,$(1))),\
-		-E -B 0x1000 $(if $(findstring static,$(word 3,$(1))),-p 0x1000)) -f $@.its $@.new)
+		-E -B 0x1000 $(if $(findstring static,$(word 3,$(1))),-p 0x1000)) -f $@.its $@.new, \
+		$(call Build/fit_lock,$(1)))
 	@mv $@.new $@
 endef
 
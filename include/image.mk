@@ -95,6 +95,15 @@ ifeq ($(CONFIG_SQUASHFS_XZ),y)
   SQUASHFSCOMP := xz $(LZMA_XZ_OPTIONS) $(BCJ_FILTER)
 endif
 
+SQUASHFS_CACHE := $(KDIR)/squashfs-cache
+
+# Split the CPUs between the image jobs make may run in parallel. This has
+# to be expanded in the recipe, -j only shows up in MAKEFLAGS there.
+ifndef SQUASHFS_PROCESSORS
+  SQUASHFS_JOBS = $(or $(patsubst -j%,%,$(lastword $(filter -j%,$(MAKEFLAGS)))),1)
+  SQUASHFS_PROCESSORS = $(shell n=$$(($(NPROC) / $(SQUASHFS_JOBS))); echo $$((n > 0 ? n : 1)))
+endif
+
 JFFS2_BLOCKSIZE ?= 64k 128k
 
 fs-types-$(CONFIG_TARGET_ROOTFS_SQUASHFS) += squashfs
@@ -265,10 +274,15 @@ $(eval $(foreach S,$(NAND_BLOCKSIZE),$(call Image/mkfs/jffs2-nand/template,$(S))
 
 define Image/mkfs/squashfs-common
 	$(STAGING_DIR_HOST)/bin/mksquashfs4 $(call mkfs_target_dir,$(1)) $@ \
-		-nopad -noappend -root-owned \
+		-nopad -noappend -root-owned -processors $(SQUASHFS_PROCESSORS) \
 		-comp $(SQUASHFSCOMP) $(SQUASHFSOPT)
 endef
 
+squashfs_cache = \
+	$(SCRIPT_DIR)/squashfs-cache.sh $(SQUASHFS_CACHE) \
+		$(call mkfs_target_dir,$(1)) $@ \
+		"$(SQUASHFSCOMP) $(SQUASHFSOPT) $(CONFIG_TARGET_ROOTFS_SECURITY_LABELS)" --
+
 ifeq ($(CONFIG_TARGET_ROOTFS_SECURITY_LABELS),y)
 define Image/mkfs/squashfs
 	echo ". $(call mkfs_target_dir,$(1))/etc/selinux/config" > $@.fakeroot-script
@@ -278,11 +292,11 @@ define Image/mkfs/squashfs
 	     "$(call mkfs_target_dir,$(1))" >> $@.fakeroot-script
 	echo "$(Image/mkfs/squashfs-common)" >> $@.fakeroot-script
 	chmod +x $@.fakeroot-script
-	$(FAKEROOT) "$@.fakeroot-script"
+	$(call squashfs_cache,$(1)) $(FAKEROOT) "$@.fakeroot-script"
 endef
 else
 define Image/mkfs/squashfs
-	$(call Image/mkfs/squashfs-common,$(1))
+	$(call squashfs_cache,$(1)) $(call Image/mkfs/squashfs-common,$(1))
 endef
 endif
 
@@ -58,18 +58,31 @@ define Download/git-kernel
 endef
 
 ifdef CONFIG_COLLECT_KERNEL_DEBUG
+  KERNEL_DEBUG_DIR:=$(KERNEL_BUILD_DIR)/debug
+  KERNEL_DEBUG_MODULES=$(patsubst $(STAGING_DIR_ROOT)/lib/modules/$(LINUX_VERSION)/%,$(KERNEL_DEBUG_DIR)/modules/%, \
+	$(wildcard $(STAGING_DIR_ROOT)/lib/modules/$(LINUX_VERSION)/*.ko))
+
+  # the debug copies are made by a parallel sub-make, one job per file,
+  # and only redone for files that changed since the last build
   define Kernel/CollectDebug
-	rm -rf $(KERNEL_BUILD_DIR)/debug
-	mkdir -p $(KERNEL_BUILD_DIR)/debug/modules
-	$(CP) $(LINUX_DIR)/vmlinux $(KERNEL_BUILD_DIR)/debug/
-	-$(CP) \
-		$(STAGING_DIR_ROOT)/lib/modules/$(LINUX_VERSION)/*.ko \
-		$(KERNEL_BUILD_DIR)/debug/modules/
-	$(FIND) $(KERNEL_BUILD_DIR)/debug -type f | $(XARGS) $(KERNEL_CROSS)strip --only-keep-debug
+	+$(MAKE) kernel-debug
 	$(TAR) c -C $(KERNEL_BUILD_DIR) debug \
 		$(if $(SOURCE_DATE_EPOCH),--mtime="@$(SOURCE_DATE_EPOCH)") \
 		| zstd -T0 -f -o $(BIN_DIR)/kernel-debug.tar.zst
   endef
+
+  define Kernel/DebugRules
+    $(KERNEL_DEBUG_DIR)/vmlinux: $(LINUX_DIR)/vmlinux
+	mkdir -p $$(dir $$@)
+	$(KERNEL_CROSS)strip --only-keep-debug -o $$@ $$<
+
+    $(KERNEL_DEBUG_DIR)/modules/%.ko: $(STAGING_DIR_ROOT)/lib/modules/$(LINUX_VERSION)/%.ko
+	mkdir -p $$(dir $$@)
+	$(KERNEL_CROSS)strip --only-keep-debug -o $$@ $$<
+
+    kernel-debug: $(KERNEL_DEBUG_DIR)/vmlinux $(KERNEL_DEBUG_MODULES)
+	rm -f $$(filter-out $(KERNEL_DEBUG_MODULES),$$(wildcard $(KERNEL_DEBUG_DIR)/modules/*.ko))
+  endef
 endif
 
 ifeq ($(DUMP)$(filter prereq clean refresh update,$(MAKECMDGOALS)),)
@@ -86,7 +99,8 @@ define BuildKernel
   $(if $(LINUX_SITE),$(call Download,kernel))
   $(if $(call qstrip,$(CONFIG_KERNEL_GIT_CLONE_URI)),$(call Download,git-kernel))
 
-  .NOTPARALLEL:
+  $(if $(filter kernel-debug,$(MAKECMDGOALS)),,.NOTPARALLEL:)
+  $(Kernel/DebugRules)
 
   $(Kernel/Autoclean)
   $(STAMP_PREPARED): $(if $(LINUX_SITE),$(DL_DIR)/$(LINUX_SOURCE))
@@ -95,6 +109,9 @@ define BuildKernel
 	$(Kernel/Prepare)
 	touch $$@
 
+  kernel-prepare-uncached: FORCE
+	$(Kernel/Prepare/Uncached)
+
   $(KERNEL_BUILD_DIR)/symtab.h: FORCE
 	rm -f $(KERNEL_BUILD_DIR)/symtab.h
 	touch $(KERNEL_BUILD_DIR)/symtab.h
@@ -20,13 +20,74 @@ else
   LINUX_CAT:=$(STAGING_DIR_HOST)/bin/libdeflate-gzip -dc
 endif
 
+# With the package build cache enabled, the patched source tree is stored
+# there too, keyed on the kernel source and the names and contents of all
+# patches and files applied to it. Unchanged trees are then unpacked in one
+# go instead of being patched again.
+ifneq ($(CONFIG_PKG_BUILD_CACHE),)
+  ifeq ($(QUILT),)
+    KERNEL_PATCH_CACHE:=1
+  endif
+endif
+KERNEL_PATCH_CACHE_KEY:=$(KERNEL_BUILD_DIR)/.patch-cache-key
+KERNEL_PATCH_CACHE_FILE:=$(KERNEL_BUILD_DIR)/.patch-cache.tar.gz
+
+define KernelPatchCache/Key
+	( \
+		echo "source: $(LINUX_VERSION) $(LINUX_SOURCE) $(LINUX_KERNEL_HASH)"; \
+		cd $(TOPDIR) && \
+		find $(patsubst $(TOPDIR)/%,%,$(wildcard $(KERNEL_FILE_DEPENDS))) -type f \
+			$(patsubst -x,-and -not -path,$(DEP_FINDPARAMS)) -print0 | \
+			xargs -0 -r $(MKHASH) -j 0 md5 | sort \
+	) | $(MKHASH) sha256
+endef
+
+define KernelPatchCache/Restore
+	rm -f $(KERNEL_PATCH_CACHE_KEY); \
+	key=$$$$($(KernelPatchCache/Key)) && [ -n "$$$$key" ] && \
+	echo "linux-$(LINUX_VERSION)-$$$$key" > $(KERNEL_PATCH_CACHE_KEY) && \
+	PKG_CACHE_DIR="$(PKG_CACHE_DIR)" PKG_CACHE_URL="$(PKG_CACHE_URL)" \
+		$(SCRIPT_DIR)/package-cache.sh fetch $$$$(cat $(KERNEL_PATCH_CACHE_KEY)) $(KERNEL_PATCH_CACHE_FILE) && \
+	echo "Build cache: using $$$$(cat $(KERNEL_PATCH_CACHE_KEY))" && \
+	$(STAGING_DIR_HOST)/bin/libdeflate-gzip -dc $(KERNEL_PATCH_CACHE_FILE) | \
+		$(TAR) -C $(KERNEL_BUILD_DIR) $(TAR_OPTIONS) || { \
+		rm -rf $(LINUX_DIR); \
+		false; \
+	}; \
+	ret=$$$$?; rm -f $(KERNEL_PATCH_CACHE_FILE); [ $$$$ret = 0 ]
+endef
+
+define KernelPatchCache/Store
+	if [ -s $(KERNEL_PATCH_CACHE_KEY) ]; then \
+		$(TAR) -C $(KERNEL_BUILD_DIR) -cf - $(notdir $(LINUX_DIR)) | \
+			$(STAGING_DIR_HOST)/bin/libdeflate-gzip -c > $(KERNEL_PATCH_CACHE_FILE) && \
+		PKG_CACHE_DIR="$(PKG_CACHE_DIR)" \
+			$(SCRIPT_DIR)/package-cache.sh store $$$$(cat $(KERNEL_PATCH_CACHE_KEY)) $(KERNEL_PATCH_CACHE_FILE) || \
+			echo "Build cache: failed to store the patched kernel tree"; \
+		rm -f $(KERNEL_PATCH_CACHE_FILE); \
+	fi
+endef
+
 ifeq ($(strip $(CONFIG_EXTERNAL_KERNEL_TREE)),"")
   ifeq ($(strip $(CONFIG_KERNEL_GIT_CLONE_URI)),"")
-    define Kernel/Prepare/Default
+    define Kernel/Prepare/Uncached
 	$(LINUX_CAT) $(DL_DIR)/$(LINUX_SOURCE) | $(TAR) -C $(KERNEL_BUILD_DIR) $(TAR_OPTIONS)
 	$(Kernel/Patch)
 	$(if $(QUILT),touch $(LINUX_DIR)/.quilt_used)
     endef
+
+    ifneq ($(KERNEL_PATCH_CACHE),)
+      define Kernel/Prepare/Default
+	+$(KernelPatchCache/Restore) || { \
+		$(MAKE) kernel-prepare-uncached && \
+		$(KernelPatchCache/Store); \
+	}
+      endef
+    else
+      define Kernel/Prepare/Default
+	$(Kernel/Prepare/Uncached)
+      endef
+    endif
   else
     define Kernel/Prepare/Default
 	$(LINUX_CAT) $(DL_DIR)/$(LINUX_SOURCE) | $(TAR) -C $(KERNEL_BUILD_DIR) $(TAR_OPTIONS)
@@ -179,13 +240,19 @@ define Kernel/PrepareConfigPerRootfs
 	}
 endef
 
+# Only the images change with an embedded initramfs, modules and dtbs are
+# left alone, so the relink does not go through them again
+KERNELNAME_INITRAMFS = $(if $(filter-out dtbs,$(KERNELNAME)),$(filter-out dtbs,$(KERNELNAME)),vmlinux)
+
 ifneq ($(CONFIG_TARGET_ROOTFS_INITRAMFS),)
 # $1: Custom TARGET_DIR. If omitted TARGET_DIR is used.
 # $2: If defined Generate Per Rootfs Kernel Directory and use it
 # For Separate Initramf with $2 declared, skip kernel compile, it has
 # already been done previously on generic image build
+# Each rootfs has its own directory and lock, so they are built in parallel,
+# using the jobserver of the calling make.
 define Kernel/CompileImage/Initramfs
-	$(call locked,{ \
+	+$(call locked,{ \
 		$(if $(2),$(call Kernel/PrepareConfigPerRootfs,$(LINUX_DIR)$(2));) \
 		$(call Kernel/Configure/Initramfs,$(if $(1),$(1),$(TARGET_DIR)),$(LINUX_DIR)$(2)); \
 		$(CP) $(GENERIC_PLATFORM_DIR)/other-files/init $(if $(1),$(1),$(TARGET_DIR))/init; \
@@ -212,8 +279,8 @@ define Kernel/CompileImage/Initramfs
 				$(if $(CONFIG_TARGET_INITRAMFS_COMPRESSION_ZSTD), \
 					$(STAGING_DIR_HOST)/bin/zstd -T0 -f -o $(KERNEL_BUILD_DIR)/initrd$(2).cpio.zstd $(KERNEL_BUILD_DIR)/initrd$(2).cpio;) \
 			}, gen-cpio$(2)); \
-			$(if $(2),,$(KERNEL_MAKE) $(KERNEL_MAKEOPTS_IMAGE) $(if $(KERNELNAME),$(KERNELNAME),all);),\
-			$(KERNEL_MAKE) $(if $(2),-C $(LINUX_DIR)$(2)) $(KERNEL_MAKEOPTS_IMAGE) $(if $(KERNELNAME),$(KERNELNAME),all);) \
+			$(if $(2),,$(KERNEL_MAKE) $(KERNEL_MAKEOPTS_IMAGE) $(KERNELNAME_INITRAMFS);),\
+			$(KERNEL_MAKE) $(if $(2),-C $(LINUX_DIR)$(2)) $(KERNEL_MAKEOPTS_IMAGE) $(KERNELNAME_INITRAMFS);) \
 		$(call Kernel/CopyImage,-initramfs,$(2)); \
 		$(if $(2),rm -rf $(LINUX_DIR)$(2);) \
 	}, gen-initramfs$(2));
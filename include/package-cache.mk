@@ -0,0 +1,171 @@
+# SPDX-License-Identifier: GPL-2.0-only
+#
+# Package build cache
+#
+# With CONFIG_PKG_BUILD_CACHE, the finished outputs of a package (its
+# packages, pkginfo, root and staging dir contributions) are stored under
+# a key hashed from everything that goes into the build: the package
+# directory, source hash, PKG_CONFIG_DEPENDS, target, toolchain and the
+# keys of the packages it depends on. A later build with the same key,
+# in this or any other tree, unpacks the outputs instead of building.
+#
+# The toolchain is identified by its version info and configuration, and
+# by the toolchain sources of the tree or, for an external toolchain, the
+# compiler and libc themselves. A package with a build dependency that has
+# no build key is not cached.
+#
+# Entries are read from CONFIG_PKG_BUILD_CACHE_DIR (then, if set, from
+# CONFIG_PKG_BUILD_CACHE_URL) and new ones are written to the directory,
+# which can be served over HTTP to other builders as is.
+#
+# The patched kernel tree is cached in the same place, see
+# include/kernel-defaults.mk.
+
+PKG_CACHE_WORK:=$(TMP_DIR)/pkgcache/$(PKG_DIR_NAME)$(if $(BUILD_VARIANT),.$(BUILD_VARIANT))
+PKG_CACHE_KEY=$(PKG_CACHE_WORK)/key
+
+# sources that can't be identified by content are never cached
+PKG_CACHE_SKIP=$(QUILT)$(filter skip,$(PKG_HASH) $(PKG_MIRROR_HASH))$(if $(PKG_SOURCE_URL),$(if $(PKG_HASH)$(PKG_MIRROR_HASH),,nohash))
+
+pkg_cache_echo=echo '$(subst ','\'',$(subst $(TOPDIR)/,,$(1)))'
+pkg_cache_deps=$(filter-out $(BUILD_PACKAGES),$(sort \
+	$(foreach pkg,$(BUILD_PACKAGES),$(call find_package_dependencies,$(pkg)))))
+
+# [!]SYMBOL:pkg entries only apply when CONFIG_SYMBOL is (not) set
+pkg_cache_cond=$(if $(CONFIG_$(patsubst !%,%,$(1))),$(if $(filter !%,$(1)),,y),$(if $(filter !%,$(1)),y))
+pkg_cache_build_dep=$(if $(findstring :,$(1)),$(if \
+	$(call pkg_cache_cond,$(firstword $(subst :, ,$(1)))),$(lastword $(subst :, ,$(1)))),$(1))
+pkg_cache_build_deps=$(filter-out $(BUILD_PACKAGES) $(PKG_NAME),$(sort \
+	$(foreach dep,$(filter-out %/host,$(PKG_BUILD_DEPENDS)),$(call pkg_cache_build_dep,$(dep)))))
+
+ifneq ($(CONFIG_EXTERNAL_TOOLCHAIN),)
+  PKG_CACHE_TOOLCHAIN_FILES=$(MKHASH) md5 \
+	$$($(TARGET_CC_NOCACHE) -print-prog-name=cc1) \
+	$$($(TARGET_CC_NOCACHE) -print-file-name=libc.so) \
+	$$($(TARGET_CC_NOCACHE) -print-libgcc-file-name) | $(MKHASH) md5
+else
+  PKG_CACHE_TOOLCHAIN_FILES=$(call find_md5_reproducible,$(TOPDIR)/toolchain,)
+endif
+
+define PackageCache/Inputs
+	( \
+		$(call pkg_cache_echo,path: $(CURDIR) $(BUILD_VARIANT)); \
+		$(call pkg_cache_echo,version: $(PKG_NAME) $(PKG_VERSION) $(PKG_RELEASE)); \
+		$(call pkg_cache_echo,source: $(PKG_SOURCE) $(PKG_SOURCE_VERSION) $(PKG_HASH) $(PKG_MIRROR_HASH)); \
+		echo "files: $$($(call find_md5_reproducible,$(CURDIR) $(PKG_FILE_DEPENDS),))"; \
+		echo "config: $(call confvar,$(PKG_CONFIG_DEPENDS) $(patsubst %,CONFIG_PACKAGE_%,$(BUILD_PACKAGES)))"; \
+		$(call pkg_cache_echo,target: $(BOARD) $(SUBTARGET) $(ARCH_PACKAGES) $(notdir $(TOOLCHAIN_DIR))); \
+		toolchain="$$($(TARGET_CC_NOCACHE) -v 2>&1 | sed -e 's,$(TOPDIR)/,,g' | $(MKHASH) md5)" && \
+		toolchain="$$toolchain $$($(MKHASH) md5 $(TOOLCHAIN_DIR)/info.mk)" && \
+		toolchain="$$toolchain $$($(PKG_CACHE_TOOLCHAIN_FILES))" || exit 1; \
+		echo "toolchain: $$toolchain"; \
+		$(call pkg_cache_echo,kernel: $(LINUX_VERSION) $(shell cat $(LINUX_DIR)/.vermagic 2>/dev/null)); \
+		$(call pkg_cache_echo,flags: $(TARGET_CPPFLAGS) $(TARGET_CFLAGS) $(TARGET_CXXFLAGS) $(TARGET_LDFLAGS)); \
+		for dep in $(pkg_cache_deps); do \
+			if [ -f $(PKG_INFO_DIR)/$$dep.buildkey ]; then \
+				echo "depends: $$dep $$(cat $(PKG_INFO_DIR)/$$dep.buildkey)"; \
+			elif [ -f $(PKG_INFO_DIR)/$$dep.provides ]; then \
+				echo "Build cache: $$dep has no build key" >&2; \
+				exit 1; \
+			fi; \
+		done; \
+		for dep in $(pkg_cache_build_deps); do \
+			if [ -f $(PKG_INFO_DIR)/$$dep.buildkey ]; then \
+				echo "build-depends: $$dep $$(cat $(PKG_INFO_DIR)/$$dep.buildkey)"; \
+			elif [ -f $(PKG_INFO_DIR)/$$dep.srcbuildkey ]; then \
+				echo "build-depends: $$dep $$(cat $(PKG_INFO_DIR)/$$dep.srcbuildkey)"; \
+			else \
+				echo "Build cache: build dependency $$dep has no build key" >&2; \
+				exit 1; \
+			fi; \
+		done; \
+	)
+endef
+
+# keyed by source name as well, for the PKG_BUILD_DEPENDS of other packages
+define PackageCache/WriteKeys
+	for pkg in $(BUILD_PACKAGES); do \
+		echo "$(1)" > $(PKG_INFO_DIR)/$$pkg.buildkey; \
+	done; \
+	echo "$(1)" > $(PKG_INFO_DIR)/$(PKG_NAME).srcbuildkey
+endef
+
+.PHONY: cache-compile pkg-cache-restore pkg-cache-store
+
+# sources are downloaded first, a newer download would invalidate restored stamps
+cache-compile:
+	+$(SUBMAKE) BUILD_VARIANT="$(BUILD_VARIANT)" ALL_VARIANTS="$(ALL_VARIANTS)" download pkg-cache-restore
+	+$(SUBMAKE) BUILD_VARIANT="$(BUILD_VARIANT)" ALL_VARIANTS="$(ALL_VARIANTS)" compile
+	+$(SUBMAKE) BUILD_VARIANT="$(BUILD_VARIANT)" ALL_VARIANTS="$(ALL_VARIANTS)" pkg-cache-store
+
+pkg-cache-restore:
+	rm -rf $(PKG_CACHE_WORK)
+	mkdir -p $(PKG_CACHE_WORK) $(PKG_INFO_DIR)
+	touch $(PKG_CACHE_WORK)/start
+	$(if $(PKG_CACHE_SKIP),,$(PackageCache/Inputs) > $(PKG_CACHE_WORK)/inputs && \
+		$(MKHASH) sha256 $(PKG_CACHE_WORK)/inputs > $(PKG_CACHE_KEY) || \
+		rm -f $(PKG_CACHE_KEY))
+	[ -s $(PKG_CACHE_KEY) ] || exit 0; \
+	[ ! -f $(STAMP_BUILT) ] || exit 0; \
+	PKG_CACHE_DIR="$(PKG_CACHE_DIR)" PKG_CACHE_URL="$(PKG_CACHE_URL)" \
+		$(SCRIPT_DIR)/package-cache.sh fetch $$(cat $(PKG_CACHE_KEY)) $(PKG_CACHE_WORK)/entry.tar.gz || exit 0; \
+	mkdir -p $(PKG_CACHE_WORK)/entry && \
+	$(TAR) -C $(PKG_CACHE_WORK)/entry -xzf $(PKG_CACHE_WORK)/entry.tar.gz && \
+	$(foreach pkg,$(IPKGS),[ -f $(PKG_CACHE_WORK)/entry/packages/$(notdir $(PACK_$(pkg))) ] && ) \
+	$(if $(Build/InstallDev),[ -f $(PKG_CACHE_WORK)/entry/staging.list ] && ) \
+	true || { echo "Build cache: incomplete entry for $(PKG_NAME), building"; exit 0; }; \
+	echo "Build cache: using $$(cat $(PKG_CACHE_KEY)) for $(PKG_NAME)"; \
+	rm -rf $(PKG_BUILD_DIR); \
+	mkdir -p $(PKG_BUILD_DIR)/.pkgdir $(STAGING_DIR)/packages && \
+	touch $(STAMP_PREPARED) && \
+	touch -r $(STAMP_PREPARED) $(STAMP_CONFIGURED) $(STAMP_BUILT) && \
+	$(CP) $(PKG_CACHE_WORK)/entry/pkgdir/. $(PKG_BUILD_DIR)/.pkgdir/ && \
+	$(foreach pkg,$(IPKGS), \
+		touch $(PKG_BUILD_DIR)/.pkgdir/$(pkg).installed && \
+		$(SCRIPT_DIR)/ipkg-remove $(pkg) $(call $(if $(CONFIG_USE_APK),apk,opkg)_package_files,$(pkg)) && \
+		mkdir -p $(PDIR_$(pkg)) && \
+		$(CP) $(PKG_CACHE_WORK)/entry/packages/$(notdir $(PACK_$(pkg))) $(PACK_$(pkg)) && ) \
+	$(CP) $(PKG_CACHE_WORK)/entry/pkginfo/. $(PKG_INFO_DIR)/ && \
+	$(if $(IPKGS),touch $(foreach pkg,$(IPKGS),$(PACK_$(pkg)) $(PKG_INFO_DIR)/$(pkg).provides) && ) \
+	if [ -f $(PKG_CACHE_WORK)/entry/staging.list ]; then \
+		if [ -f $(STAGING_DIR)/packages/$(STAGING_FILES_LIST) ]; then \
+			$(SCRIPT_DIR)/clean-package.sh \
+				"$(STAGING_DIR)/packages/$(STAGING_FILES_LIST)" \
+				"$(STAGING_DIR)"; \
+		fi; \
+		$(call locked, \
+			$(TAR) -C $(STAGING_DIR) -xzf $(PKG_CACHE_WORK)/entry/staging.tar.gz && \
+			$(CP) $(PKG_CACHE_WORK)/entry/staging.list $(STAGING_DIR)/packages/$(STAGING_FILES_LIST), \
+		staging-dir) && \
+		touch $(STAMP_INSTALLED); \
+	fi || { \
+		echo "Build cache: failed to unpack entry for $(PKG_NAME), building"; \
+		rm -f $(STAMP_PREPARED); \
+	}
+
+pkg-cache-store:
+	if [ -s $(PKG_CACHE_KEY) ]; then \
+		$(call PackageCache/WriteKeys,$$(cat $(PKG_CACHE_KEY))); \
+	elif [ ! -f $(PKG_INFO_DIR)/$(PKG_NAME).buildkey -o $(STAMP_BUILT) -nt $(PKG_INFO_DIR)/$(PKG_NAME).buildkey ]; then \
+		$(call PackageCache/WriteKeys,uncached-$$(date +%s)-$$$$); \
+	fi
+	[ -s $(PKG_CACHE_KEY) ] || exit 0; \
+	[ $(STAMP_BUILT) -nt $(PKG_CACHE_WORK)/start ] || exit 0; \
+	rm -rf $(PKG_CACHE_WORK)/entry; \
+	mkdir -p $(PKG_CACHE_WORK)/entry/packages $(PKG_CACHE_WORK)/entry/pkginfo $(PKG_CACHE_WORK)/entry/pkgdir && \
+	$(CP) $(PKG_CACHE_WORK)/inputs $(PKG_CACHE_WORK)/entry/ && \
+	$(foreach pkg,$(IPKGS), \
+		$(CP) $(PACK_$(pkg)) $(PKG_CACHE_WORK)/entry/packages/ && \
+		$(CP) $(PKG_BUILD_DIR)/.pkgdir/$(pkg) $(PKG_CACHE_WORK)/entry/pkgdir/ && \
+		$(foreach info,$(wildcard $(foreach p,$(pkg) $(PROVIDES_$(pkg)),$(PKG_INFO_DIR)/$(p).provides $(PKG_INFO_DIR)/$(p).version)), \
+			$(CP) $(info) $(PKG_CACHE_WORK)/entry/pkginfo/ && ) ) \
+	if [ -f $(STAMP_INSTALLED) -a -f $(STAGING_DIR)/packages/$(STAGING_FILES_LIST) ]; then \
+		$(CP) $(STAGING_DIR)/packages/$(STAGING_FILES_LIST) $(PKG_CACHE_WORK)/entry/staging.list && \
+		$(TAR) -C $(STAGING_DIR) --no-recursion -czf $(PKG_CACHE_WORK)/entry/staging.tar.gz \
+			-T $(STAGING_DIR)/packages/$(STAGING_FILES_LIST); \
+	fi && \
+	$(TAR) -C $(PKG_CACHE_WORK)/entry -czf $(PKG_CACHE_WORK)/entry.tar.gz . && \
+	PKG_CACHE_DIR="$(PKG_CACHE_DIR)" \
+		$(SCRIPT_DIR)/package-cache.sh store $$(cat $(PKG_CACHE_KEY)) $(PKG_CACHE_WORK)/entry.tar.gz || \
+		echo "Build cache: failed to store $(PKG_NAME)"
+	rm -rf $(PKG_CACHE_WORK)/entry $(PKG_CACHE_WORK)/entry.tar.gz
@@ -110,6 +110,7 @@ endif
     IDIR_$(1):=$(PKG_BUILD_DIR)/ipkg-$(PKGARCH)/$(1)
     ADIR_$(1):=$(PKG_BUILD_DIR)/apk-$(PKGARCH)/$(1)
     KEEP_$(1):=$(strip $(call Package/$(1)/conffiles))
+    PROVIDES_$(1):=$(filter-out $(1),$(PROVIDES))
     APK_SCRIPTS_$(1):=\
     --script "post-install:$$(ADIR_$(1))/post-install" \
     --script "pre-deinstall:$$(ADIR_$(1))/pre-deinstall"
@@ -83,8 +83,7 @@ endif
 
 include $(INCLUDE_DIR)/quilt.mk
 
-find_library_dependencies = \
-	$(wildcard $(patsubst %,$(STAGING_DIR)/pkginfo/%.version, \
+find_package_dependencies = \
 		$(filter-out $(BUILD_PACKAGES), $(sort $(foreach dep4, \
 			$(sort $(foreach dep3, \
 				$(sort $(foreach dep2, \
@@ -100,8 +99,11 @@ find_library_dependencies = \
 				$(Package/$(dep3)/depends) $(dep3) \
 			)), \
 			$(Package/$(dep4)/depends) $(dep4) \
-		))) \
-	))
+		)))
+
+find_library_dependencies = \
+	$(wildcard $(patsubst %,$(STAGING_DIR)/pkginfo/%.version, \
+		$(call find_package_dependencies,$(1))))
 
 
 PKG_DIR_NAME:=$(lastword $(subst /,$(space),$(CURDIR)))
@@ -139,6 +141,9 @@ include $(INCLUDE_DIR)/package-dumpinfo.mk
 include $(INCLUDE_DIR)/package-pack.mk
 include $(INCLUDE_DIR)/package-bin.mk
 include $(INCLUDE_DIR)/autotools.mk
+ifneq ($(CONFIG_PKG_BUILD_CACHE),)
+  include $(INCLUDE_DIR)/package-cache.mk
+endif
 
 _pkg_target:=$(if $(QUILT),,.)
 
@@ -348,7 +353,11 @@ Build/Install=$(if $(PKG_INSTALL),$(call Build/Install/Default,))
 Build/Dist=$(call Build/Dist/Default,)
 Build/DistCheck=$(call Build/DistCheck/Default,)
 
-.NOTPARALLEL:
+# with PKG_PACKAGE_PARALLEL set, the packages of one Makefile are installed
+# and packed in parallel, for sources having nothing to build themselves
+ifeq ($(PKG_PACKAGE_PARALLEL),)
+  .NOTPARALLEL:
+endif
 
 .PHONY: prepare-package-install
 prepare-package-install:
@@ -76,6 +76,12 @@ else
   zlib_link_flags := -lz
 endif
 
+ifndef IB
+$(eval $(call RequireCHeader,zlib.h, \
+	Please install a static zlib. (Missing libz.a or zlib.h), \
+	zlibVersion(), $(zlib_link_flags)))
+endif
+
 $(eval $(call TestHostCommand,perl-data-dumper, \
 	Please install the Perl Data::Dumper module, \
 	perl -MData::Dumper -e 1))
@@ -232,13 +238,21 @@ endif
 
 $(STAGING_DIR_HOST)/bin/mkhash: $(SCRIPT_DIR)/mkhash.c
 	mkdir -p $(dir $@)
-	$(CC) -O2 -I$(TOPDIR)/tools/include -o $@ $<
+	$(CC) -O2 -I$(TOPDIR)/tools/include -o $@ $< -lpthread
+
+$(STAGING_DIR_HOST)/bin/ipkg-make-index: $(SCRIPT_DIR)/ipkg-make-index.c $(SCRIPT_DIR)/mkhash.c
+	mkdir -p $(dir $@)
+	$(CC) -O2 -I$(TOPDIR)/tools/include -o $@ $< -lpthread $(zlib_link_flags)
 
 $(STAGING_DIR_HOST)/bin/xxd: $(SCRIPT_DIR)/xxdi.pl
 	$(LN) $< $@
 
 prereq: $(STAGING_DIR_HOST)/bin/mkhash $(STAGING_DIR_HOST)/bin/xxd
 
+ifndef IB
+prereq: $(STAGING_DIR_HOST)/bin/ipkg-make-index
+endif
+
 # Install ldconfig stub
 $(eval $(call TestHostCommand,ldconfig-stub,Failed to install stub, \
 	$(LN) $(SCRIPT_DIR)/noop.sh $(STAGING_DIR_HOST)/bin/ldconfig))
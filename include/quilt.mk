@@ -62,7 +62,7 @@ define PatchDir/Default
 	@if [ -d "$(2)" ] && [ "$$$$(ls $(2) | wc -l)" -gt 0 ]; then \
 		export PATCH="$(PATCH)"; \
 		if [ -s "$(2)/series" ]; then \
-			$(call filter_series,$(2)/series) | xargs -n1 \
+			$(call filter_series,$(2)/series) | xargs \
 				$(KPATCH) "$(1)" "$(2)"; \
 		else \
 			$(KPATCH) "$(1)" "$(2)"; \
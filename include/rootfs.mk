@@ -1,4 +1,11 @@
 ifdef CONFIG_USE_MKLIBS
+  MKLIBS_LDLIB = $(patsubst $(STAGING_DIR_ROOT)/%,/%,$(firstword $(wildcard \
+	$(foreach name,ld-uClibc.so.* ld-linux.so.* ld-*.so ld-musl-*.so.*, \
+	  $(STAGING_DIR_ROOT)/lib/$(name) \
+	))))
+  # number of reduced library sets kept in $(TMP_DIR)/mklibs-cache
+  MKLIBS_CACHE_KEEP = 4
+
   define mklibs
 	rm -rf $(TMP_DIR)/mklibs-progs $(TMP_DIR)/mklibs-out
 	# first find all programs and add them to the mklibs list
@@ -9,19 +16,35 @@ ifdef CONFIG_USE_MKLIBS
 	find $(STAGING_DIR_ROOT) -type f -name \*.so\* -exec \
 		file -r -N -F '' {} + | \
 		awk ' /shared object/ { print $$1 }' > $(TMP_DIR)/mklibs-libs
-	mkdir -p $(TMP_DIR)/mklibs-out
-	$(STAGING_DIR_HOST)/bin/mklibs -D \
-		-d $(TMP_DIR)/mklibs-out \
-		--sysroot $(STAGING_DIR_ROOT) \
-		`cat $(TMP_DIR)/mklibs-libs | sed 's:/*[^/]\+/*$$::' | uniq | sed 's:^$(STAGING_DIR_ROOT):-L :'` \
-		--ldlib $(patsubst $(STAGING_DIR_ROOT)/%,/%,$(firstword $(wildcard \
-			$(foreach name,ld-uClibc.so.* ld-linux.so.* ld-*.so ld-musl-*.so.*, \
-			  $(STAGING_DIR_ROOT)/lib/$(name) \
-			)))) \
-		--target $(REAL_GNU_TARGET_NAME) \
-		`cat $(TMP_DIR)/mklibs-progs $(TMP_DIR)/mklibs-libs` 2>&1
-	$(RSTRIP) $(TMP_DIR)/mklibs-out
-	for lib in `ls $(TMP_DIR)/mklibs-out/*.so.* 2>/dev/null`; do \
+	# the reduced libraries only depend on the objects, the same set of
+	# them gives the same output, in particular for the other profiles
+	echo "$(REAL_GNU_TARGET_NAME) $(MKLIBS_LDLIB)" | \
+		cat - $(TMP_DIR)/mklibs-progs $(TMP_DIR)/mklibs-libs > $(TMP_DIR)/mklibs-key
+	( echo $(STAGING_DIR_HOST)/bin/mklibs; \
+	  sort -u $(TMP_DIR)/mklibs-progs $(TMP_DIR)/mklibs-libs ) | \
+		$(XARGS) $(MKHASH) -n -j 0 sha256 >> $(TMP_DIR)/mklibs-key
+	MKLIBS_CACHE="$(TMP_DIR)/mklibs-cache/`$(MKHASH) sha256 $(TMP_DIR)/mklibs-key`"; \
+	if [ -d "$$MKLIBS_CACHE" ]; then \
+		echo "Using the libraries reduced for the same objects before"; \
+		touch "$$MKLIBS_CACHE"; \
+	else \
+		mkdir -p $(TMP_DIR)/mklibs-out && \
+		$(STAGING_DIR_HOST)/bin/mklibs -D \
+			-d $(TMP_DIR)/mklibs-out \
+			--sysroot $(STAGING_DIR_ROOT) \
+			`cat $(TMP_DIR)/mklibs-libs | sed 's:/*[^/]\+/*$$::' | uniq | sed 's:^$(STAGING_DIR_ROOT):-L :'` \
+			--ldlib $(MKLIBS_LDLIB) \
+			--target $(REAL_GNU_TARGET_NAME) \
+			`cat $(TMP_DIR)/mklibs-progs $(TMP_DIR)/mklibs-libs` 2>&1 && \
+		$(RSTRIP) $(TMP_DIR)/mklibs-out && \
+		mkdir -p $(TMP_DIR)/mklibs-cache && \
+		rm -rf "$$MKLIBS_CACHE.tmp" && \
+		cp -a $(TMP_DIR)/mklibs-out "$$MKLIBS_CACHE.tmp" && \
+		mv "$$MKLIBS_CACHE.tmp" "$$MKLIBS_CACHE" || exit 1; \
+		ls -dt $(TMP_DIR)/mklibs-cache/* | tail -n +$$(($(MKLIBS_CACHE_KEEP) + 1)) | \
+			$(XARGS) rm -rf; \
+	fi; \
+	for lib in `ls "$$MKLIBS_CACHE"/*.so.* 2>/dev/null`; do \
 		LIB="$${lib##*/}"; \
 		DEST="`ls "$(1)/lib/$$LIB" "$(1)/usr/lib/$$LIB" 2>/dev/null`"; \
 		[ -n "$$DEST" ] || continue; \
@@ -82,15 +105,20 @@ define prepare_rootfs
 		else \
 			IPKG_POSTINST_PATH=./usr/lib/opkg/info/*.postinst; \
 		fi; \
+		done_scripts=; \
 		for script in $$IPKG_POSTINST_PATH; do \
+			[ -f "$$script" ] || continue; \
 			IPKG_INSTROOT=$(1) $$(command -v bash) $$script; \
 			ret=$$?; \
 			if [ $$ret -ne 0 ]; then \
 				echo "postinst script $$script has failed with exit code $$ret" >&2; \
 				exit 1; \
 			fi; \
-			[ -n "$(CONFIG_USE_APK)" ] && $(STAGING_DIR_HOST)/bin/tar --delete -f ./lib/apk/db/scripts.tar $$(basename $$script); \
+			done_scripts="$$done_scripts $${script##*/}"; \
 		done; \
+		if [ -n "$(CONFIG_USE_APK)" ] && [ -n "$$done_scripts" ]; then \
+			$(STAGING_DIR_HOST)/bin/tar --delete -f ./lib/apk/db/scripts.tar $$done_scripts; \
+		fi; \
 		if [ -z "$(CONFIG_USE_APK)" ]; then \
 			$(if $(IB),,awk -i inplace \
 				'/^Status:/ { \
@@ -99,16 +127,7 @@ define prepare_rootfs
 				}1' $(1)/usr/lib/opkg/status) ; \
 			$(if $(SOURCE_DATE_EPOCH),sed -i "s/Installed-Time: .*/Installed-Time: $(SOURCE_DATE_EPOCH)/" $(1)/usr/lib/opkg/status ;) \
 		fi; \
-		for script in ./etc/init.d/*; do \
-			grep '#!/bin/sh /etc/rc.common' $$script >/dev/null || continue; \
-			if ! echo " $(3) " | grep -q " $$(basename $$script) "; then \
-				IPKG_INSTROOT=$(1) $$(command -v bash) ./etc/rc.common $$script enable; \
-				echo "Enabling" $$(basename $$script); \
-			else \
-				IPKG_INSTROOT=$(1) $$(command -v bash) ./etc/rc.common $$script disable; \
-				echo "Disabling" $$(basename $$script); \
-			fi; \
-		done || true \
+		$(SCRIPT_DIR)/rootfs-initscripts.sh $(1) $(3) || true \
 	)
 
 	@-find $(1) -name CVS -o -name .svn -o -name .git -o -name '.#*' | $(XARGS) rm -rf
@@ -46,6 +46,11 @@ endif
 define PackageDir
   $(TMP_DIR)/.$(SCAN_TARGET): $(TMP_DIR)/info/.$(SCAN_TARGET)-$(1)
   $(TMP_DIR)/info/.$(SCAN_TARGET)-$(1): $(SCAN_DIR)/$(2)/Makefile $(foreach DEP,$(DEPS_$(SCAN_DIR)/$(2)/Makefile) $(SCAN_DEPS),$(wildcard $(if $(filter /%,$(DEP)),$(DEP),$(SCAN_DIR)/$(2)/$(DEP))))
+	hash=$$$$(cat $$^ | $(MKHASH) md5); \
+	if [ -f $$@ ] && [ "$$$$hash" = "$$$$(cat $$@.hash 2>/dev/null)" ]; then \
+		touch $$@; \
+		exit 0; \
+	fi; \
 	{ \
 		$$(call progress,Collecting $(SCAN_NAME) info: $(SCAN_DIR)/$(2)) \
 		echo Source-Makefile: $(SCAN_DIR)/$(2)/Makefile; \
@@ -58,8 +63,9 @@ define PackageDir
 			rm -f $$@; \
 		}; \
 		echo; \
-	} > $$@.tmp
-	mv $$@.tmp $$@
+	} > $$@.tmp && \
+	mv $$@.tmp $$@ && \
+	echo "$$$$hash" > $$@.hash
 endef
 
 $(OVERRIDELIST):
@@ -113,10 +119,10 @@ $(TARGET_STAMP)::
 
 $(TMP_DIR)/.$(SCAN_TARGET): $(TARGET_STAMP)
 	$(call progress,Collecting $(SCAN_NAME) info: merging...)
-	-cat $(FILELIST) | awk '{gsub(/\//, "_", $$0);print "$(TMP_DIR)/info/.$(SCAN_TARGET)-" $$0}' | xargs cat > $@ 2>/dev/null
+	-cat $(FILELIST) | awk '{gsub(/\//, "_", $$0);print "$(TMP_DIR)/info/.$(SCAN_TARGET)-" $$0}' | xargs cat > $@.tmp 2>/dev/null
+	cmp -s $@.tmp $@ && rm -f $@.tmp || mv $@.tmp $@
 	$(call progress,Collecting $(SCAN_NAME) info: done)
 	echo
 
 FORCE:
 .PHONY: FORCE
-.NOTPARALLEL:
@@ -35,6 +35,12 @@ subdir_make_opts = \
 		BUILD_VARIANT="$(4)" \
 		ALL_VARIANTS="$(5)"
 
+# package compiles go through the build cache if enabled (include/package-cache.mk)
+# 1: subdir
+# 2: target
+# 3: build type
+subdir_goal = $(if $(3),$(3)-$(2),$(if $(and $(CONFIG_PKG_BUILD_CACHE),$(filter package/%,$(1)),$(filter compile,$(2))),cache-compile,$(2)))
+
 # 1: subdir
 # 2: target
 # 3: build type
@@ -46,7 +52,7 @@ log_make = \
 		set -o pipefail; \
 		mkdir -p $(BUILD_LOG_DIR)/$(1)$(if $(4),/$(4));) \
 	$(SCRIPT_DIR)/time.pl "time: $(1)$(if $(4),/$(4))/$(if $(3),$(3)-)$(2)" \
-	$$(SUBMAKE) $(subdir_make_opts) $(if $(3),$(3)-)$(2) \
+	$$(SUBMAKE) $(subdir_make_opts) $(call subdir_goal,$(1),$(2),$(3)) \
 		$(if $(BUILD_LOG),SILENT= 2>&1 | tee $(BUILD_LOG_DIR)/$(1)$(if $(4),/$(4))/$(if $(3),$(3)-)$(2).txt)
 
 ifdef CONFIG_AUTOREMOVE
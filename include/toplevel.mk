@@ -63,6 +63,10 @@ endif
 SCAN_COOKIE?=$(shell echo $$$$)
 export SCAN_COOKIE
 
+# parsed Config.in tree, reused by conf/mconf while its inputs are unchanged
+KCONFIG_PARSE_CACHE?=$(TOPDIR)/tmp/.config-parse-cache
+export KCONFIG_PARSE_CACHE
+
 SUBMAKE:=umask 022; $(SUBMAKE)
 
 ULIMIT_FIX=_limit=`ulimit -n`; [ "$$_limit" = "unlimited" -o "$$_limit" -ge 1024 ] || ulimit -n 1024;
@@ -75,20 +79,25 @@ endif
 
 _ignore = $(foreach p,$(IGNORE_PACKAGES),--ignore $(p))
 
+# Makefiles are dumped in parallel, each one only when it changed
+SCAN_JOBS ?= $(shell nproc 2>/dev/null || getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)
+
 prepare-tmpinfo: FORCE
 	@+$(MAKE) -r -s $(STAGING_DIR_HOST)/.prereq-build $(PREP_MK)
 	mkdir -p tmp/info feeds
 	[ -e $(TOPDIR)/feeds/base ] || ln -sf $(TOPDIR)/package $(TOPDIR)/feeds/base
-	$(_SINGLE)$(NO_TRACE_MAKE) -j1 -r -s -f include/scan.mk SCAN_TARGET="packageinfo" SCAN_DIR="package" SCAN_NAME="package" SCAN_DEPTH=5 SCAN_EXTRA=""
-	$(_SINGLE)$(NO_TRACE_MAKE) -j1 -r -s -f include/scan.mk SCAN_TARGET="targetinfo" SCAN_DIR="target/linux" SCAN_NAME="target" SCAN_DEPTH=3 SCAN_EXTRA="" SCAN_MAKEOPTS="TARGET_BUILD=1"
+	$(_SINGLE)$(NO_TRACE_MAKE) -j$(SCAN_JOBS) -r -s -f include/scan.mk SCAN_TARGET="packageinfo" SCAN_DIR="package" SCAN_NAME="package" SCAN_DEPTH=5 SCAN_EXTRA=""
+	$(_SINGLE)$(NO_TRACE_MAKE) -j$(SCAN_JOBS) -r -s -f include/scan.mk SCAN_TARGET="targetinfo" SCAN_DIR="target/linux" SCAN_NAME="target" SCAN_DEPTH=3 SCAN_EXTRA="" SCAN_MAKEOPTS="TARGET_BUILD=1"
 	for type in package target; do \
-		f=tmp/.$${type}info; t=tmp/.config-$${type}.in; \
-		[ "$$t" -nt "$$f" ] || ./scripts/$${type}-metadata.pl $(_ignore) config "$$f" > "$$t" || { rm -f "$$t"; echo "Failed to build $$t"; false; break; }; \
+		f=tmp/.$${type}info; t=tmp/.config-$${type}.in; s=tmp/info/.config-$${type}.stamp; \
+		[ "$$s" -nt "$$f" -a -e "$$t" ] || { ./scripts/$${type}-metadata.pl $(_ignore) config "$$f" > "$$t.tmp" && \
+			{ cmp -s "$$t.tmp" "$$t" && rm -f "$$t.tmp" || mv "$$t.tmp" "$$t"; } && touch "$$s"; } || \
+			{ rm -f "$$t" "$$t.tmp" "$$s"; echo "Failed to build $$t"; false; break; }; \
 	done
 	[ tmp/.config-feeds.in -nt tmp/.packageauxvars ] || ./scripts/feeds feed_config > tmp/.config-feeds.in
-	./scripts/package-metadata.pl mk tmp/.packageinfo > tmp/.packagedeps || { rm -f tmp/.packagedeps; false; }
-	./scripts/package-metadata.pl pkgaux tmp/.packageinfo > tmp/.packageauxvars || { rm -f tmp/.packageauxvars; false; }
-	./scripts/package-metadata.pl usergroup tmp/.packageinfo > tmp/.packageusergroup || { rm -f tmp/.packageusergroup; false; }
+	[ tmp/.packagedeps -nt tmp/.packageinfo ] || ./scripts/package-metadata.pl mk tmp/.packageinfo > tmp/.packagedeps || { rm -f tmp/.packagedeps; false; }
+	[ tmp/.packageauxvars -nt tmp/.packageinfo ] || ./scripts/package-metadata.pl pkgaux tmp/.packageinfo > tmp/.packageauxvars || { rm -f tmp/.packageauxvars; false; }
+	[ tmp/.packageusergroup -nt tmp/.packageinfo ] || ./scripts/package-metadata.pl usergroup tmp/.packageinfo > tmp/.packageusergroup || { rm -f tmp/.packageusergroup; false; }
 	touch $(TOPDIR)/tmp/.build
 
 .config: ./scripts/config/conf $(if $(CONFIG_HAVE_DOT_CONFIG),,prepare-tmpinfo)
@@ -202,7 +211,12 @@ else
 endif
 
 download: .config FORCE $(if $(wildcard $(STAGING_DIR_HOST)/bin/flock),,tools/flock/compile)
-	@+$(foreach dir,$(DOWNLOAD_DIRS),$(SUBMAKE) $(dir);)
+	@+if grep -q '^CONFIG_DOWNLOAD_PARALLEL=y' .config; then \
+		jobs=$$(sed -n 's/^CONFIG_DOWNLOAD_JOBS=//p' .config); \
+		$(SUBMAKE) -j$${jobs:-8} $(DOWNLOAD_DIRS); \
+	else \
+		$(foreach dir,$(DOWNLOAD_DIRS),$(SUBMAKE) $(dir);) \
+	fi
 
 clean dirclean: .config
 	@+$(SUBMAKE) -r $@
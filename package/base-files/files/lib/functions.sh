@@ -2,6 +2,8 @@
 # Copyright (C) 2006 Fokus Fraunhofer <carsten.tittel@fokus.fraunhofer.de>
 # Copyright (C) 2010 Vertical Communications
 
+# already loaded by a batched uci-defaults run (/etc/init.d/boot)
+[ -n "$UCI_DEFAULTS_PRELOADED" ] && return 0
 
 debug () {
 	${DEBUG:-:} "$@"
@@ -105,7 +107,15 @@ config () {
 	name="${name:-cfg$CONFIG_NUM_SECTIONS}"
 	append CONFIG_SECTIONS "$name"
 	export ${NO_EXPORT:+-n} CONFIG_SECTION="$name"
-	config_set "$CONFIG_SECTION" "TYPE" "${cfgtype}"
+	export ${NO_EXPORT:+-n} "CONFIG_${name}_TYPE=${cfgtype}"
+	# sections by type, so that config_foreach only visits those of its type
+	case "$cfgtype" in
+		""|*[!A-Za-z0-9_]*) ;;
+		*)
+			eval "[ -n \"\$CONFIG_TYPE_SECTIONS_$cfgtype\" ]" || append CONFIG_TYPES "$cfgtype"
+			append "CONFIG_TYPE_SECTIONS_$cfgtype" "$name"
+		;;
+	esac
 	[ -n "$NO_CALLBACK" ] || config_cb "$cfgtype" "$name"
 }
 
@@ -113,7 +123,7 @@ option () {
 	local varname="$1"; shift
 	local value="$*"
 
-	config_set "$CONFIG_SECTION" "${varname}" "${value}"
+	export ${NO_EXPORT:+-n} "CONFIG_${CONFIG_SECTION}_${varname}=${value}"
 	[ -n "$NO_CALLBACK" ] || option_cb "$varname" "$*"
 }
 
@@ -122,11 +132,11 @@ list() {
 	local value="$*"
 	local len
 
-	config_get len "$CONFIG_SECTION" "${varname}_LENGTH" 0
+	eval "len=\"\${CONFIG_${CONFIG_SECTION}_${varname}_LENGTH:-0}\""
 	[ $len = 0 ] && append CONFIG_LIST_STATE "${CONFIG_SECTION}_${varname}"
 	len=$((len + 1))
-	config_set "$CONFIG_SECTION" "${varname}_ITEM$len" "$value"
-	config_set "$CONFIG_SECTION" "${varname}_LENGTH" "$len"
+	export ${NO_EXPORT:+-n} "CONFIG_${CONFIG_SECTION}_${varname}_ITEM$len=$value"
+	export ${NO_EXPORT:+-n} "CONFIG_${CONFIG_SECTION}_${varname}_LENGTH=$len"
 	append "CONFIG_${CONFIG_SECTION}_${varname}" "$value" "$LIST_SEP"
 	[ -n "$NO_CALLBACK" ] || list_cb "$varname" "$*"
 }
@@ -181,10 +191,14 @@ config_foreach() {
 	[ "$#" -ge 1 ] && shift
 	local ___type="$1"
 	[ "$#" -ge 1 ] && shift
-	local section cfgtype
+	local section cfgtype ___sections="$CONFIG_SECTIONS"
 
 	[ -z "$CONFIG_SECTIONS" ] && return 0
-	for section in ${CONFIG_SECTIONS}; do
+	case "$___type" in
+		""|*[!A-Za-z0-9_]*) ;;
+		*) eval "___sections=\"\$CONFIG_TYPE_SECTIONS_$___type\"";;
+	esac
+	for section in ${___sections}; do
 		config_get cfgtype "$section" TYPE
 		[ -n "$___type" ] && [ "x$cfgtype" != "x$___type" ] && continue
 		eval "$___function \"\$section\" \"\$@\""
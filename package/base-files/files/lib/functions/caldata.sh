@@ -9,6 +9,11 @@ caldata_dd() {
 	local count=$(($3))
 	local offset=$(($4))
 
+	if [ -x /usr/sbin/caldata ]; then
+		/usr/sbin/caldata extract $source $offset $count $target
+		return $?
+	fi
+
 	dd if=$source of=$target iflag=skip_bytes,fullblock bs=$count skip=$offset count=1 2>/dev/null
 	return $?
 }
@@ -70,6 +75,12 @@ caldata_extract_reverse() {
 	local caldata
 
 	mtd=$(find_mtd_chardev "$part")
+
+	if [ -x /usr/sbin/caldata ]; then
+		/usr/sbin/caldata reverse $mtd $(($offset)) $count /lib/firmware/$FIRMWARE
+		return
+	fi
+
 	reversed=$(hexdump -v -s $offset -n $count -e '1/1 "%02x "' $mtd)
 
 	for byte in $reversed; do
@@ -135,6 +146,12 @@ caldata_patch_data() {
 
 	[ -n "$target" ] || target=/lib/firmware/$FIRMWARE
 
+	if [ -x /usr/sbin/caldata ]; then
+		/usr/sbin/caldata patch $target $data_offset $data $chksum_offset || \
+			caldata_die "failed to patch eeprom file"
+		return
+	fi
+
 	fw_data=$(hexdump -v -n $data_count -s $data_offset -e '1/1 "%02x"' $target)
 
 	if [ "$data" != "$fw_data" ]; then
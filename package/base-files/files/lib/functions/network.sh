@@ -6,6 +6,12 @@
 __network_ifstatus() {
 	local __tmp
 
+	# the copy of the dump kept by netifd's ifstatus-cache, if running
+	[ -z "$__NETWORK_CACHE" ] && [ -r /var/run/network/ifstatus.json ] && {
+		__tmp="$(cat /var/run/network/ifstatus.json 2>/dev/null)"
+		[ -n "$__tmp" ] && export __NETWORK_CACHE="$__tmp"
+	}
+
 	[ -z "$__NETWORK_CACHE" ] && {
 		__tmp="$(ubus call network.interface dump 2>&1)"
 		case "$?" in
@@ -24,6 +30,51 @@ __network_ifstatus() {
 	eval "$__tmp"
 }
 
+# read a scalar field of an interface from the variables of ifstatus-cache,
+# returns 2 if they are not available for the interface
+# 1: destination variable
+# 2: interface
+# 3: field
+__network_ifvar() {
+	local __tmp
+
+	[ -z "$__NETWORK_IF_TIME" ] && {
+		[ -r /var/run/network/ifstatus.sh ] && \
+			__tmp="$(cat /var/run/network/ifstatus.sh 2>/dev/null)" && \
+			eval "$__tmp"
+		# do not look for it again in this process
+		[ -n "$__NETWORK_IF_TIME" ] || __NETWORK_IF_TIME=0
+	}
+
+	case "$2" in
+		""|*[!A-Za-z0-9_]*) return 2 ;;
+	esac
+
+	eval "__tmp=\"\$__NETWORK_IF_known_$2\""
+	[ -n "$__tmp" ] || return 2
+
+	eval "__tmp=\"\$__NETWORK_IF_$3_$2\""
+	[ -z "$__tmp" ] && \
+		unset "$1" && \
+		return 1
+
+	export "$1=$__tmp"
+}
+
+# 1: destination variable
+# 2: interface
+# 3: field of ifstatus-cache
+# 4: path, if the field is not available
+__network_ifget() {
+	local __rv
+
+	__network_ifvar "$1" "$2" "$3"
+	__rv=$?
+	[ $__rv -lt 2 ] && return $__rv
+
+	__network_ifstatus "$1" "$2" "$4"
+}
+
 # determine first IPv4 address of given logical interface
 # 1: destination variable
 # 2: interface
@@ -277,33 +328,47 @@ network_find_wan6() { __network_wan "$1" "::" "$2"; }
 network_is_up()
 {
 	local __up
-	__network_ifstatus "__up" "$1" ".up" && [ "$__up" = 1 ]
+	__network_ifget "__up" "$1" up ".up" && [ "$__up" = 1 ]
 }
 
 # determine the protocol of the given logical interface
 # 1: destination variable
 # 2: interface
-network_get_protocol() { __network_ifstatus "$1" "$2" ".proto"; }
+network_get_protocol() { __network_ifget "$1" "$2" proto ".proto"; }
 
 # determine the uptime of the given logical interface
 # 1: destination variable
 # 2: interface
-network_get_uptime() { __network_ifstatus "$1" "$2" ".uptime"; }
+network_get_uptime()
+{
+	local __now __idle
+
+	__network_ifvar "$1" "$2" uptime
+	case "$?" in
+		0)
+			# the variables were written at $__NETWORK_IF_TIME
+			read __now __idle < /proc/uptime
+			eval "export $1=\$((\$$1 + ${__now%.*} - $__NETWORK_IF_TIME))"
+		;;
+		1) return 1 ;;
+		*) __network_ifstatus "$1" "$2" ".uptime" ;;
+	esac
+}
 
 # determine the metric of the given logical interface
 # 1: destination variable
 # 2: interface
-network_get_metric() { __network_ifstatus "$1" "$2" ".metric"; }
+network_get_metric() { __network_ifget "$1" "$2" metric ".metric"; }
 
 # determine the layer 3 linux network device of the given logical interface
 # 1: destination variable
 # 2: interface
-network_get_device() { __network_ifstatus "$1" "$2" ".l3_device"; }
+network_get_device() { __network_ifget "$1" "$2" l3dev ".l3_device"; }
 
 # determine the layer 2 linux network device of the given logical interface
 # 1: destination variable
 # 2: interface
-network_get_physdev() { __network_ifstatus "$1" "$2" ".device"; }
+network_get_physdev() { __network_ifget "$1" "$2" dev ".device"; }
 
 # defer netifd actions on the given linux network device
 # 1: device name
@@ -322,4 +387,14 @@ network_ready_device()
 }
 
 # flush the internal value cache to force re-reading values from ubus
-network_flush_cache() { unset __NETWORK_CACHE; }
+network_flush_cache()
+{
+	local __if __field
+
+	for __if in $__NETWORK_IF_LIST; do
+		for __field in known up proto metric uptime l3dev dev; do
+			unset "__NETWORK_IF_${__field}_${__if}"
+		done
+	done
+	unset __NETWORK_CACHE __NETWORK_IF_TIME __NETWORK_IF_LIST
+}
@@ -3,6 +3,33 @@
 . /lib/functions.sh
 . /usr/share/libubox/jshn.sh
 
+MACADDR_CACHE=/tmp/.macaddr_cache
+
+# Flash contents and board.json don't change at runtime, so lookups are
+# remembered in tmpfs for the rest of the boot. Empty results are not
+# cached, the partition may simply not have shown up yet.
+macaddr_cache_get() {
+	local key="$1"
+	local k v
+
+	[ -f "$MACADDR_CACHE" ] || return 1
+	while read k v; do
+		[ "$k" = "$key" ] || continue
+		echo $v
+		return 0
+	done < "$MACADDR_CACHE"
+
+	return 1
+}
+
+macaddr_cache_set() {
+	local key="$1"
+	local val="$2"
+
+	[ -n "$val" ] && echo "$key $val" >> "$MACADDR_CACHE" 2>/dev/null
+	echo $val
+}
+
 get_mac_binary() {
 	local path="$1"
 	local offset="$2"
@@ -12,6 +39,11 @@ get_mac_binary() {
 		return
 	fi
 
+	if [ -x /usr/sbin/caldata ]; then
+		/usr/sbin/caldata mac $path $offset 2>/dev/null
+		return
+	fi
+
 	hexdump -v -n 6 -s $offset -e '5/1 "%02x:" 1/1 "%02x"' $path 2>/dev/null
 }
 
@@ -33,6 +65,7 @@ get_mac_label_json() {
 	local macaddr
 
 	[ -s "$cfg" ] || return
+	macaddr_cache_get label_json && return
 
 	json_init
 	json_load "$(cat $cfg)"
@@ -42,7 +75,7 @@ get_mac_label_json() {
 		json_select ..
 	fi
 
-	echo $macaddr
+	macaddr_cache_set label_json "$macaddr"
 }
 
 get_mac_label() {
@@ -66,7 +99,11 @@ get_mac_ascii() {
 	local key="$2"
 	local mac_dirty
 
-	mac_dirty=$(strings "$part" | sed -n 's/^'"$key"'=//p')
+	if [ -x /usr/sbin/caldata ]; then
+		mac_dirty=$(/usr/sbin/caldata mac-ascii "$part" "$key")
+	else
+		mac_dirty=$(strings "$part" | sed -n 's/^'"$key"'=//p')
+	fi
 
 	# "canonicalize" mac
 	[ -n "$mac_dirty" ] && macaddr_canonicalize "$mac_dirty"
@@ -77,13 +114,14 @@ mtd_get_mac_ascii() {
 	local key="$2"
 	local part
 
+	macaddr_cache_get "mtd_ascii:$mtdname:$key" && return
 	part=$(find_mtd_part "$mtdname")
 	if [ -z "$part" ]; then
 		echo "mtd_get_mac_ascii: partition $mtdname not found!" >&2
 		return
 	fi
 
-	get_mac_ascii "$part" "$key"
+	macaddr_cache_set "mtd_ascii:$mtdname:$key" "$(get_mac_ascii "$part" "$key")"
 }
 
 mtd_get_mac_encrypted_arcadyan() {
@@ -153,6 +191,7 @@ mtd_get_mac_text() {
 	local length="${3:-17}"
 	local part
 
+	macaddr_cache_get "mtd_text:$mtdname:$offset:$length" && return
 	part=$(find_mtd_part "$mtdname")
 	if [ -z "$part" ]; then
 		echo "mtd_get_mac_text: partition $mtdname not found!" >&2
@@ -161,7 +200,8 @@ mtd_get_mac_text() {
 
 	[ $((offset + length)) -le $(mtd_get_part_size "$mtdname") ] || return
 
-	macaddr_canonicalize $(dd bs=1 if="$part" skip="$offset" count="$length" 2>/dev/null)
+	macaddr_cache_set "mtd_text:$mtdname:$offset:$length" \
+		"$(macaddr_canonicalize $(dd bs=1 if="$part" skip="$offset" count="$length" 2>/dev/null))"
 }
 
 mtd_get_mac_binary() {
@@ -169,20 +209,23 @@ mtd_get_mac_binary() {
 	local offset="$2"
 	local part
 
+	macaddr_cache_get "mtd_binary:$mtdname:$offset" && return
 	part=$(find_mtd_part "$mtdname")
-	get_mac_binary "$part" "$offset"
+	macaddr_cache_set "mtd_binary:$mtdname:$offset" "$(get_mac_binary "$part" "$offset")"
 }
 
 mtd_get_mac_binary_ubi() {
 	local mtdname="$1"
 	local offset="$2"
 
+	macaddr_cache_get "ubi_binary:$mtdname:$offset" && return
+
 	. /lib/upgrade/nand.sh
 
 	local ubidev=$(nand_find_ubi $CI_UBIPART)
 	local part=$(nand_find_volume $ubidev $1)
 
-	get_mac_binary "/dev/$part" "$offset"
+	macaddr_cache_set "ubi_binary:$mtdname:$offset" "$(get_mac_binary "/dev/$part" "$offset")"
 }
 
 mtd_get_part_size() {
@@ -202,13 +245,14 @@ mmc_get_mac_ascii() {
 	local key="$2"
 	local part
 
+	macaddr_cache_get "mmc_ascii:$part_name:$key" && return
 	part=$(find_mmc_part "$part_name")
 	if [ -z "$part" ]; then
 		echo "mmc_get_mac_ascii: partition $part_name not found!" >&2
 		return
 	fi
 
-	get_mac_ascii "$part" "$key"
+	macaddr_cache_set "mmc_ascii:$part_name:$key" "$(get_mac_ascii "$part" "$key")"
 }
 
 mmc_get_mac_binary() {
@@ -216,8 +260,9 @@ mmc_get_mac_binary() {
 	local offset="$2"
 	local part
 
+	macaddr_cache_get "mmc_binary:$part_name:$offset" && return
 	part=$(find_mmc_part "$part_name")
-	get_mac_binary "$part" "$offset"
+	macaddr_cache_set "mmc_binary:$part_name:$offset" "$(get_mac_binary "$part" "$offset")"
 }
 
 macaddr_add() {
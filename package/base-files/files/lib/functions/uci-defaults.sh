@@ -1,3 +1,6 @@
+# already loaded by a batched uci-defaults run (/etc/init.d/boot)
+[ -n "$UCI_DEFAULTS_PRELOADED" ] && return 0
+
 . /lib/functions.sh
 . /usr/share/libubox/jshn.sh
 
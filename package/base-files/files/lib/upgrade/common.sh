@@ -12,7 +12,7 @@ install_file() { # <file> [ <file> ... ]
 			target="$(readlink -f "$file")"
 			dest="$RAM_ROOT/$file"
 			[ ! -f "$dest" ] && {
-				dir="$(dirname "$dest")"
+				dir="${dest%/*}"
 				mkdir -p "$dir"
 				ln -s "$target" "$dest"
 			}
@@ -20,18 +20,31 @@ install_file() { # <file> [ <file> ... ]
 		fi
 		dest="$RAM_ROOT/$file"
 		[ -f "$file" -a ! -f "$dest" ] && {
-			dir="$(dirname "$dest")"
+			dir="${dest%/*}"
 			mkdir -p "$dir"
 			cp "$file" "$dest"
 		}
 	done
 }
 
-install_bin() {
-	local src files
-	src=$1
-	files=$1
-	[ -x "$src" ] && files="$src $(libs $src)"
+install_bin() { # <file> [ <file> ... ]
+	local file real lib seen=" " files=
+
+	# ldd only once for each real file, most programs are busybox links
+	for file in "$@"; do
+		files="$files $file"
+		real="$file"
+		[ -L "$file" ] && real="$(readlink -f "$file")"
+		case "$seen" in *" $real "*) continue ;; esac
+		seen="$seen$real "
+		[ -x "$real" ] || continue
+
+		for lib in $(libs "$real"); do
+			case "$seen" in *" $lib "*) continue ;; esac
+			seen="$seen$lib "
+			files="$files $lib"
+		done
+	done
 	install_file $files
 }
 
@@ -107,6 +120,41 @@ get_image_dd() {
 	)
 }
 
+_write_image_ranges() {
+	local pos=0 range start count to
+
+	for range in $(printf '%s\n' "$@" | sort -n -t : -k 1,1); do
+		start="${range%%:*}"; range="${range#*:}"
+		count="${range%%:*}"; to="${range#*:}"
+
+		[ "$start" -ge "$pos" ] || {
+			echo "Image range at sector $start overlaps the previous one" >&2
+			return 1
+		}
+		[ "$start" -gt "$pos" ] && {
+			dd of=/dev/null bs=1M iflag=fullblock,count_bytes \
+				count="$(((start - pos) * 512))" 2>/dev/null || return 1
+		}
+		dd of="$to" bs=1M iflag=fullblock,count_bytes \
+			count="$((count * 512))" conv=fsync || return 1
+		pos="$((start + count))"
+	done
+}
+
+# Write parts of an image to devices or files with a single pass over it,
+# instead of a get_image_dd for each of them reading the image from the
+# start. Each <range> is <start>:<count>:<target> in 512 byte sectors.
+get_image_ranges() { # <source> <range> [<range> ...]
+	local from="$1"; shift
+
+	(
+		exec 3>&2
+		( exec 3>&2; get_image "$from" 2>&1 1>&3 | grep -v -F ' Broken pipe'     ) 2>&1 1>&3 \
+			| ( exec 3>&2; _write_image_ranges "$@" 2>&1 1>&3 | grep -v -E ' records (in|out)') 2>&1 1>&3
+		exec 3>&-
+	)
+}
+
 get_magic_word() {
 	(get_image "$@" | dd bs=2 count=1 | hexdump -v -n 2 -e '1/1 "%02x"') 2>/dev/null
 }
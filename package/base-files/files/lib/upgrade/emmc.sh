@@ -3,34 +3,46 @@
 
 . /lib/functions.sh
 
+# Write stdin to <device> in 1MiB blocks
+emmc_write() {
+	dd of="$1" bs=1M iflag=fullblock 2>/dev/null
+}
+
 emmc_upgrade_tar() {
 	local tar_file="$1"
 	[ "$CI_KERNPART" -a -z "$EMMC_KERN_DEV" ] && export EMMC_KERN_DEV="$(find_mmc_part $CI_KERNPART $CI_ROOTDEV)"
 	[ "$CI_ROOTPART" -a -z "$EMMC_ROOT_DEV" ] && export EMMC_ROOT_DEV="$(find_mmc_part $CI_ROOTPART $CI_ROOTDEV)"
 	[ "$CI_DATAPART" -a -z "$EMMC_DATA_DEV" ] && export EMMC_DATA_DEV="$(find_mmc_part $CI_DATAPART $CI_ROOTDEV)"
-	local has_kernel
-	local has_rootfs
-	local board_dir=$(tar tf "$tar_file" | grep -m 1 '^sysupgrade-.*/$')
-	board_dir=${board_dir%/}
+	local board_dir kernel_size root_size
 
-	tar tf "$tar_file" ${board_dir}/kernel 1>/dev/null 2>/dev/null && has_kernel=1
-	tar tf "$tar_file" ${board_dir}/root 1>/dev/null 2>/dev/null && has_rootfs=1
+	# one listing for the board dir and the member sizes
+	eval "$(tar tvf "$tar_file" 2>/dev/null | awk '
+		!board && $NF ~ /^sysupgrade-.*\/$/ { board = $NF; sub(/\/$/, "", board) }
+		{ size[$NF] = $3 }
+		END {
+			print "board_dir=" board
+			if ((board "/kernel") in size) print "kernel_size=" size[board "/kernel"]
+			if ((board "/root") in size) print "root_size=" size[board "/root"]
+		}')"
 
-	[ "$has_rootfs" = 1 -a "$EMMC_ROOT_DEV" ] && {
+	[ -n "$root_size" -a "$EMMC_ROOT_DEV" ] && {
 		# Invalidate kernel image while rootfs is being written
-		[ "$has_kernel" = 1 -a "$EMMC_KERN_DEV" ] && {
+		[ -n "$kernel_size" -a "$EMMC_KERN_DEV" ] && {
 			dd if=/dev/zero of="$EMMC_KERN_DEV" bs=512 count=8
 			sync
 		}
 
-		export EMMC_ROOTFS_BLOCKS=$(($(tar xf "$tar_file" ${board_dir}/root -O | dd of="$EMMC_ROOT_DEV" bs=512 2>&1 | grep "records out" | cut -d' ' -f1)))
+		tar xf "$tar_file" ${board_dir}/root -O | emmc_write "$EMMC_ROOT_DEV"
+		export EMMC_ROOTFS_BLOCKS=$(((root_size + 511) / 512))
 		# Account for 64KiB ROOTDEV_OVERLAY_ALIGN in libfstools
 		EMMC_ROOTFS_BLOCKS=$(((EMMC_ROOTFS_BLOCKS + 127) & ~127))
 		sync
 	}
 
-	[ "$has_kernel" = 1 -a "$EMMC_KERN_DEV" ] &&
-		export EMMC_KERNEL_BLOCKS=$(($(tar xf "$tar_file" ${board_dir}/kernel -O | dd of="$EMMC_KERN_DEV" bs=512 2>&1 | grep "records out" | cut -d' ' -f1)))
+	[ -n "$kernel_size" -a "$EMMC_KERN_DEV" ] && {
+		tar xf "$tar_file" ${board_dir}/kernel -O | emmc_write "$EMMC_KERN_DEV"
+		export EMMC_KERNEL_BLOCKS=$(((kernel_size + 511) / 512))
+	}
 
 	if [ -z "$UPGRADE_BACKUP" ]; then
 		if [ "$EMMC_DATA_DEV" ]; then
@@ -48,7 +60,16 @@ emmc_upgrade_fit() {
 	[ "$CI_KERNPART" -a -z "$EMMC_KERN_DEV" ] && export EMMC_KERN_DEV="$(find_mmc_part $CI_KERNPART $CI_ROOTDEV)"
 
 	if [ "$EMMC_KERN_DEV" ]; then
-		export EMMC_KERNEL_BLOCKS=$(($(get_image "$fit_file" | fwtool -i /dev/null -T - | dd of="$EMMC_KERN_DEV" bs=512 2>&1 | grep "records out" | cut -d' ' -f1)))
+		# the size is only known once the trailer is stripped, count it
+		# in 512 byte input blocks while writing 1MiB blocks
+		export EMMC_KERNEL_BLOCKS=$(($(get_image "$fit_file" | fwtool -i /dev/null -T - | ${FIT_CHECK:-cat} | dd of="$EMMC_KERN_DEV" ibs=512 obs=1M iflag=fullblock 2>&1 | grep "records in" | cut -d' ' -f1)))
+
+		# FIT_CHECK is a filter checking the image as it is written,
+		# leave out the data marker and the config on a mismatch
+		if [ -n "$FIT_CHECK" ] && ! fit_check_ok; then
+			unset EMMC_KERNEL_BLOCKS
+			return 1
+		fi
 
 		[ -z "$UPGRADE_BACKUP" ] && dd if=/dev/zero of="$EMMC_KERN_DEV" bs=512 seek=$EMMC_KERNEL_BLOCKS count=8
 	fi
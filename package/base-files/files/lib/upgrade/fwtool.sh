@@ -1,3 +1,13 @@
+# Extract signature and metadata of the image in one go, fwtool only
+# reads the trailers at the end of the image for this.
+fwtool_extract() {
+	[ "$FWTOOL_EXTRACTED" = "$1" ] && return 0
+
+	rm -f /tmp/sysupgrade.ucert /tmp/sysupgrade.meta
+	fwtool -q -s /tmp/sysupgrade.ucert -i /tmp/sysupgrade.meta "$1"
+	FWTOOL_EXTRACTED="$1"
+}
+
 fwtool_check_signature() {
 	[ $# -gt 1 ] && return 1
 
@@ -9,7 +19,8 @@ fwtool_check_signature() {
 		fi
 	}
 
-	if ! fwtool -q -s /tmp/sysupgrade.ucert "$1"; then
+	fwtool_extract "$1"
+	if [ ! -s /tmp/sysupgrade.ucert ]; then
 		v "Image signature not present"
 		[ "$REQUIRE_IMAGE_SIGNATURE" = 1 -a "$FORCE" != 1 ] && {
 			v "Use sysupgrade -F to override this check when downgrading or flashing to vendor firmware"
@@ -18,6 +29,7 @@ fwtool_check_signature() {
 		return 0
 	fi
 
+	# the only pass over the whole image
 	fwtool -q -T -s /dev/null "$1" | \
 		ucert -V -m - -c "/tmp/sysupgrade.ucert" -P /etc/opkg/keys
 
@@ -27,9 +39,8 @@ fwtool_check_signature() {
 fwtool_check_image() {
 	[ $# -gt 1 ] && return 1
 
-	. /usr/share/libubox/jshn.sh
-
-	if ! fwtool -q -i /tmp/sysupgrade.meta "$1"; then
+	fwtool_extract "$1"
+	if [ ! -s /tmp/sysupgrade.meta ]; then
 		v "Image metadata not present"
 		[ "$REQUIRE_IMAGE_METADATA" = 1 -a "$FORCE" != 1 ] && {
 			v "Use sysupgrade -F to override this check when downgrading or flashing to vendor firmware"
@@ -38,29 +49,32 @@ fwtool_check_image() {
 		return 0
 	fi
 
-	json_load "$(cat /tmp/sysupgrade.meta)" || {
+	local meta imagecompat compatmessage supported_devices new_supported_devices
+	meta="$(jsonfilter -i /tmp/sysupgrade.meta \
+		-e 'imagecompat=@.compat_version' \
+		-e 'compatmessage=@.compat_message' \
+		-e 'supported_devices=@.supported_devices[*]' \
+		-e 'new_supported_devices=@.new_supported_devices[*]' 2>/dev/null)"
+	[ -n "$meta" ] || {
 		v "Invalid image metadata"
 		return 1
 	}
+	eval "$meta"
 
 	device="$(cat /tmp/sysinfo/board_name)"
 	devicecompat="$(uci -q get system.@system[0].compat_version)"
 	[ -n "$devicecompat" ] || devicecompat="1.0"
 
-	json_get_var imagecompat compat_version
-	json_get_var compatmessage compat_message
 	[ -n "$imagecompat" ] || imagecompat="1.0"
 
 	# select correct supported list based on compat_version
 	# (using this ensures that compatibility check works for devices
 	#  not knowing about compat-version)
-	local supported=supported_devices
-	[ "$imagecompat" != "1.0" ] && supported=new_supported_devices
-	json_select $supported || return 1
+	local devices="$supported_devices"
+	[ "$imagecompat" != "1.0" ] && devices="$new_supported_devices"
+	[ -n "$devices" ] || return 1
 
-	json_get_keys dev_keys
-	for k in $dev_keys; do
-		json_get_var dev "$k"
+	for dev in $devices; do
 		if [ "$dev" = "$device" ]; then
 			# major compat version -> no sysupgrade
 			if [ "${devicecompat%.*}" != "${imagecompat%.*}" ]; then
@@ -82,12 +96,7 @@ fwtool_check_image() {
 	done
 
 	v "Device $device not supported by this image"
-	local devices="Supported devices:"
-	for k in $dev_keys; do
-		json_get_var dev "$k"
-		devices="$devices $dev"
-	done
-	v "$devices"
+	v "Supported devices: $devices"
 
 	return 1
 }
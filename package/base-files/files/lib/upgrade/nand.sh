@@ -294,29 +294,95 @@ nand_upgrade_fit() {
 
 	local fit_ubidev="$(nand_find_ubi "$CI_UBIPART")"
 	local fit_ubivol="$(nand_find_volume $fit_ubidev "$CI_KERNPART")"
-	$cmd < "$fit_file" | ubiupdatevol /dev/$fit_ubivol -s "$fit_length" -
+	# FIT_CHECK holds back the end of a corrupt image, ubiupdatevol then
+	# fails before the update is complete
+	$cmd < "$fit_file" | ${FIT_CHECK:-cat} | ubiupdatevol /dev/$fit_ubivol -s "$fit_length" - || return 1
+	[ -z "$FIT_CHECK" ] || fit_check_ok
 }
 
 # Write images in the TAR file to MTD partitions and/or UBI volumes as required
-nand_upgrade_tar() {
+# Run tarstream on the tar, letting it seek in uncompressed files
+nand_tarstream() {
 	local tar_file="$1"
-	local cmd="${2:-cat}"
-	local jffs2_markers="${CI_JFFS2_CLEAN_MARKERS:-0}"
+	local cmd="$2"
+	local op="$3"
+	shift 3
+
+	if [ "$cmd" = "cat" ]; then
+		tarstream "$op" "$tar_file" "$@"
+	else
+		$cmd < "$tar_file" | tarstream "$op" - "$@"
+	fi
+}
+
+# Print "<size> <magic> <name>" for the kernel and root members
+nand_tar_list() {
+	local tar_file="$1"
+	local cmd="$2"
+
+	if command -v tarstream > /dev/null; then
+		nand_tarstream "$tar_file" "$cmd" list
+		return
+	fi
 
 	# WARNING: This fails if tar contains more than one 'sysupgrade-*' directory.
 	local board_dir="$($cmd < "$tar_file" | tar tf - | grep -m 1 '^sysupgrade-.*/$')"
-	board_dir="${board_dir%/}"
+	local member length magic
+	for member in kernel root; do
+		[ "$member" = kernel ] && [ "$CI_KERNPART" = "none" ] && continue
+		member="$board_dir$member"
+		length=$( ($cmd < "$tar_file" | tar xOf - "$member" | wc -c) 2> /dev/null)
+		[ "$length" ] || continue
+		magic="$(get_magic_long_tar "$tar_file" "$cmd" "$member")"
+		echo "$length ${magic:--} $member"
+	done
+}
 
-	local kernel_mtd kernel_length
+# Pipe each <member>=<command> into its command, in one pass with tarstream
+nand_tar_extract() {
+	local tar_file="$1"
+	local cmd="$2"
+	shift 2
+
+	if command -v tarstream > /dev/null; then
+		nand_tarstream "$tar_file" "$cmd" extract "$@"
+		return
+	fi
+
+	local spec
+	for spec in "$@"; do
+		$cmd < "$tar_file" | tar xOf - "${spec%%=*}" | sh -c "${spec#*=}" || return 1
+	done
+}
+
+nand_upgrade_tar() {
+	local tar_file="$1"
+	local cmd="${2:-cat}"
+	local jffs2_markers="${CI_JFFS2_CLEAN_MARKERS:-0}"
+
+	local board_dir kernel_length rootfs_length rootfs_magic
+	local size magic name
+	while read size magic name; do
+		[ "$name" ] || continue
+		[ "$board_dir" ] || board_dir="${name%%/*}"
+		case "$name" in
+			"$board_dir/kernel") kernel_length="$size";;
+			"$board_dir/root") rootfs_length="$size"; rootfs_magic="$magic";;
+		esac
+	done <<-EOF
+		$(nand_tar_list "$tar_file" "$cmd")
+	EOF
+
+	local kernel_mtd
 	if [ "$CI_KERNPART" != "none" ]; then
 		kernel_mtd="$(find_mtd_index "$CI_KERNPART")"
-		kernel_length=$( ($cmd < "$tar_file" | tar xOf - "$board_dir/kernel" | wc -c) 2> /dev/null)
 		[ "$kernel_length" = 0 ] && kernel_length=
+	else
+		kernel_length=
 	fi
-	local rootfs_length=$( ($cmd < "$tar_file" | tar xOf - "$board_dir/root" | wc -c) 2> /dev/null)
 	[ "$rootfs_length" = 0 ] && rootfs_length=
 	local rootfs_type
-	[ "$rootfs_length" ] && rootfs_type="$(identify_tar "$tar_file" "$cmd" "$board_dir/root")"
+	[ "$rootfs_length" ] && rootfs_type="$(identify_magic_long "$rootfs_magic")"
 
 	local ubi_kernel_length
 	if [ "$kernel_length" ]; then
@@ -334,31 +400,30 @@ nand_upgrade_tar() {
 	local has_env=0
 	nand_upgrade_prepare_ubi "$rootfs_length" "$rootfs_type" "$ubi_kernel_length" "$has_env" || return 1
 
+	# one <member>=<command> per volume, written in tar order
+	set --
 	if [ "$rootfs_length" ]; then
 		local ubidev="$( nand_find_ubi "${CI_ROOT_UBIPART:-$CI_UBIPART}" )"
 		local root_ubivol="$( nand_find_volume $ubidev "$CI_ROOTPART" )"
-		$cmd < "$tar_file" | tar xOf - "$board_dir/root" | \
-			ubiupdatevol /dev/$root_ubivol -s "$rootfs_length" -
+		set -- "$@" "$board_dir/root=ubiupdatevol /dev/$root_ubivol -s $rootfs_length -"
 	fi
 	if [ "$kernel_length" ]; then
 		if [ "$kernel_mtd" ]; then
 			if [ "$jffs2_markers" = 1 ]; then
 				flash_erase -j "/dev/mtd${kernel_mtd}" 0 0
-				$cmd < "$tar_file" | tar xOf - "$board_dir/kernel" | \
-					nandwrite "/dev/mtd${kernel_mtd}" -
+				set -- "$@" "$board_dir/kernel=nandwrite /dev/mtd${kernel_mtd} -"
 			else
-				$cmd < "$tar_file" | tar xOf - "$board_dir/kernel" | \
-					mtd write - "$CI_KERNPART"
+				set -- "$@" "$board_dir/kernel=mtd write - $CI_KERNPART"
 			fi
 		else
 			local ubidev="$( nand_find_ubi "${CI_KERN_UBIPART:-$CI_UBIPART}" )"
 			local kern_ubivol="$( nand_find_volume $ubidev "$CI_KERNPART" )"
-			$cmd < "$tar_file" | tar xOf - "$board_dir/kernel" | \
-				ubiupdatevol /dev/$kern_ubivol -s "$kernel_length" -
+			set -- "$@" "$board_dir/kernel=ubiupdatevol /dev/$kern_ubivol -s $kernel_length -"
 		fi
 	fi
 
-	return 0
+	[ $# -gt 0 ] || return 0
+	nand_tar_extract "$tar_file" "$cmd" "$@"
 }
 
 nand_verify_if_gzip_file() {
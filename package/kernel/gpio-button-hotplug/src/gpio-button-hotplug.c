@@ -32,6 +32,14 @@
 
 #define BH_SKB_SIZE	2048
 
+/* per button, at most BH_EVENT_BURST events within BH_EVENT_INTERVAL */
+#define BH_EVENT_BURST		10
+#define BH_EVENT_INTERVAL	HZ
+
+/* polling slows down to BH_POLL_IDLE_MAX once inputs were idle for a while */
+#define BH_POLL_IDLE_DELAY	HZ
+#define BH_POLL_IDLE_MAX	100
+
 #define DRV_NAME	"gpio-keys"
 #define PFX	DRV_NAME ": "
 
@@ -42,7 +50,7 @@ struct bh_event {
 	unsigned long		seen;
 
 	struct sk_buff		*skb;
-	struct work_struct	work;
+	struct list_head	list;
 };
 
 struct bh_map {
@@ -59,6 +67,10 @@ struct gpio_keys_button_data {
 	int threshold;
 	int can_sleep;
 	int irq;
+	int reported_state;
+	unsigned long rl_begin;
+	int rl_count;
+	bool rl_pending;
 	unsigned int software_debounce;
 	struct gpio_desc *gpiod;
 	const struct gpio_keys_button *b;
@@ -66,6 +78,17 @@ struct gpio_keys_button_data {
 
 extern u64 uevent_next_seqnum(void);
 
+static bool polled_irq = true;
+module_param(polled_irq, bool, 0444);
+MODULE_PARM_DESC(polled_irq,
+		 "Use edge interrupts for polled buttons if their GPIO supports them");
+
+static void button_hotplug_work(struct work_struct *work);
+
+static LIST_HEAD(bh_events);
+static DEFINE_SPINLOCK(bh_events_lock);
+static DECLARE_WORK(bh_events_work, button_hotplug_work);
+
 #define BH_MAP(_code, _name)		\
 	{				\
 		.code = (_code),	\
@@ -173,14 +196,13 @@ static int button_hotplug_fill_event(struct bh_event *event)
 	return ret;
 }
 
-static void button_hotplug_work(struct work_struct *work)
+static void button_hotplug_send(struct bh_event *event)
 {
-	struct bh_event *event = container_of(work, struct bh_event, work);
 	int ret = 0;
 
 	event->skb = alloc_skb(BH_SKB_SIZE, GFP_KERNEL);
 	if (!event->skb)
-		goto out_free_event;
+		return;
 
 	ret = bh_event_add_var(event, 0, "%s@", event->action);
 	if (ret)
@@ -198,8 +220,22 @@ static void button_hotplug_work(struct work_struct *work)
 		pr_err(PFX "work error %d\n", ret);
 		kfree_skb(event->skb);
 	}
- out_free_event:
-	kfree(event);
+}
+
+/* deliver all events queued since the last run in one go */
+static void button_hotplug_work(struct work_struct *work)
+{
+	struct bh_event *event, *tmp;
+	LIST_HEAD(events);
+
+	spin_lock(&bh_events_lock);
+	list_splice_init(&bh_events, &events);
+	spin_unlock(&bh_events_lock);
+
+	list_for_each_entry_safe(event, tmp, &events, list) {
+		button_hotplug_send(event);
+		kfree(event);
+	}
 }
 
 static int button_hotplug_create_event(const char *name, unsigned int type,
@@ -219,8 +255,11 @@ static int button_hotplug_create_event(const char *name, unsigned int type,
 	event->seen = seen;
 	event->action = pressed ? "pressed" : "released";
 
-	INIT_WORK(&event->work, (void *)(void *)button_hotplug_work);
-	schedule_work(&event->work);
+	spin_lock(&bh_events_lock);
+	list_add_tail(&event->list, &bh_events);
+	spin_unlock(&bh_events_lock);
+
+	schedule_work(&bh_events_work);
 
 	return 0;
 }
@@ -250,15 +289,51 @@ static int gpio_button_get_value(struct gpio_keys_button_data *bdata)
 	return val;
 }
 
-static void gpio_keys_handle_button(struct gpio_keys_button_data *bdata)
+static void gpio_keys_report(struct gpio_keys_button_data *bdata,
+			     unsigned int type, int state)
+{
+	unsigned long seen = jiffies;
+
+	if (time_after(seen, bdata->rl_begin + BH_EVENT_INTERVAL) ||
+	    time_before(seen, bdata->rl_begin)) {
+		bdata->rl_begin = seen;
+		bdata->rl_count = 0;
+	}
+
+	/* flapping input, report the final state once the interval is over */
+	if (bdata->rl_count >= BH_EVENT_BURST) {
+		bdata->rl_pending = true;
+		return;
+	}
+
+	bdata->rl_pending = false;
+	if (state == bdata->reported_state)
+		return;
+
+	bdata->rl_count++;
+
+	if (bdata->seen == 0)
+		bdata->seen = seen;
+
+	button_hotplug_create_event(button_map[bdata->map_entry].name, type,
+				    (seen - bdata->seen) / HZ, state);
+	bdata->seen = seen;
+	bdata->reported_state = state;
+}
+
+/* returns true while the button state is still settling */
+static bool gpio_keys_handle_button(struct gpio_keys_button_data *bdata)
 {
 	unsigned int type = bdata->b->type ?: EV_KEY;
 	int state = gpio_button_get_value(bdata);
-	unsigned long seen = jiffies;
 
 	pr_debug(PFX "event type=%u, code=%u, pressed=%d\n",
 		 type, bdata->b->code, state);
 
+	if (bdata->rl_pending &&
+	    time_after(jiffies, bdata->rl_begin + BH_EVENT_INTERVAL))
+		gpio_keys_report(bdata, type, bdata->last_state);
+
 	/* is this the initialization state? */
 	if (bdata->last_state == -1) {
 		/*
@@ -266,8 +341,10 @@ static void gpio_keys_handle_button(struct gpio_keys_button_data *bdata)
 		 * Just save their state and continue otherwise this
 		 * can cause OpenWrt to enter failsafe.
 		 */
-		if (type == EV_KEY && state == 0)
+		if (type == EV_KEY && state == 0) {
+			bdata->reported_state = state;
 			goto set_state;
+		}
 		/*
 		 * But we are very interested in pressed buttons and
 		 * initial switch state. These will be reported to
@@ -276,28 +353,28 @@ static void gpio_keys_handle_button(struct gpio_keys_button_data *bdata)
 	} else if (bdata->last_state == state) {
 		/* reset asserted counter (only relevant for polled keys) */
 		bdata->count = 0;
-		return;
+		return bdata->rl_pending;
 	}
 
 	if (bdata->count < bdata->threshold) {
 		bdata->count++;
-		return;
+		return true;
 	}
 
-	if (bdata->seen == 0)
-		bdata->seen = seen;
-
-	button_hotplug_create_event(button_map[bdata->map_entry].name, type,
-				    (seen - bdata->seen) / HZ, state);
-	bdata->seen = seen;
+	gpio_keys_report(bdata, type, state);
 
 set_state:
 	bdata->last_state = state;
 	bdata->count = 0;
+
+	return true;
 }
 
 struct gpio_keys_button_dev {
 	int polled;
+	int npolled;
+	unsigned int poll_interval;
+	unsigned long idle_since;
 	struct delayed_work work;
 
 	struct device *dev;
@@ -307,8 +384,7 @@ struct gpio_keys_button_dev {
 
 static void gpio_keys_polled_queue_work(struct gpio_keys_button_dev *bdev)
 {
-	struct gpio_keys_platform_data *pdata = bdev->pdata;
-	unsigned long delay = msecs_to_jiffies(pdata->poll_interval);
+	unsigned long delay = msecs_to_jiffies(bdev->poll_interval);
 
 	if (delay >= HZ)
 		delay = round_jiffies_relative(delay);
@@ -319,23 +395,50 @@ static void gpio_keys_polled_poll(struct work_struct *work)
 {
 	struct gpio_keys_button_dev *bdev =
 		container_of(work, struct gpio_keys_button_dev, work.work);
+	struct gpio_keys_platform_data *pdata = bdev->pdata;
+	bool active = false;
 	int i;
 
-	for (i = 0; i < bdev->pdata->nbuttons; i++) {
+	for (i = 0; i < pdata->nbuttons; i++) {
 		struct gpio_keys_button_data *bdata = &bdev->data[i];
 
-		if (bdata->gpiod)
-			gpio_keys_handle_button(bdata);
+		if (bdata->gpiod && !bdata->irq)
+			active |= gpio_keys_handle_button(bdata);
+	}
+
+	/*
+	 * Back off while nothing happens, the first change brings the
+	 * interval back so debouncing runs at the configured rate.
+	 */
+	if (active) {
+		bdev->idle_since = jiffies;
+		bdev->poll_interval = pdata->poll_interval;
+	} else if (time_after(jiffies, bdev->idle_since + BH_POLL_IDLE_DELAY)) {
+		bdev->poll_interval = min(bdev->poll_interval * 2,
+					  max_t(unsigned int, pdata->poll_interval,
+						BH_POLL_IDLE_MAX));
 	}
+
 	gpio_keys_polled_queue_work(bdev);
 }
 
 static void gpio_keys_polled_close(struct gpio_keys_button_dev *bdev)
 {
 	struct gpio_keys_platform_data *pdata = bdev->pdata;
+	int i;
 
 	cancel_delayed_work_sync(&bdev->work);
 
+	for (i = 0; i < pdata->nbuttons; i++) {
+		struct gpio_keys_button_data *bdata = &bdev->data[i];
+
+		if (!bdata->irq)
+			continue;
+
+		disable_irq(bdata->irq);
+		cancel_delayed_work_sync(&bdata->work);
+	}
+
 	if (pdata->disable)
 		pdata->disable(bdev->dev);
 }
@@ -344,8 +447,16 @@ static void gpio_keys_irq_work_func(struct work_struct *work)
 {
 	struct gpio_keys_button_data *bdata = container_of(work,
 		struct gpio_keys_button_data, work.work);
+	unsigned long end;
 
 	gpio_keys_handle_button(bdata);
+
+	/* no further interrupt may come to flush a rate limited state */
+	if (bdata->rl_pending) {
+		end = bdata->rl_begin + BH_EVENT_INTERVAL + 1;
+		schedule_delayed_work(&bdata->work, time_after(end, jiffies) ?
+				      end - jiffies : 0);
+	}
 }
 
 static irqreturn_t button_handle_irq(int irq, void *_bdata)
@@ -553,6 +664,8 @@ static int gpio_keys_button_probe(struct platform_device *pdev,
 
 		bdata->can_sleep = gpiod_cansleep(bdata->gpiod);
 		bdata->last_state = -1; /* Unknown state on boot */
+		bdata->reported_state = -1;
+		bdata->rl_begin = jiffies;
 
 		if (bdev->polled) {
 			bdata->threshold = DIV_ROUND_UP(button->debounce_interval,
@@ -640,11 +753,44 @@ static int gpio_keys_probe(struct platform_device *pdev)
 	return 0;
 }
 
+/*
+ * Let the GPIO controller report edges instead of polling, debounced
+ * by the irq work like in the gpio-keys case.
+ */
+static int gpio_keys_polled_request_irq(struct gpio_keys_button_dev *bdev,
+					struct gpio_keys_button_data *bdata)
+{
+	int irq, ret;
+
+	irq = gpiod_to_irq(bdata->gpiod);
+	if (irq <= 0)
+		return -ENXIO;
+
+	INIT_DELAYED_WORK(&bdata->work, gpio_keys_irq_work_func);
+	bdata->software_debounce = bdata->b->debounce_interval;
+	bdata->irq = irq;
+
+	ret = devm_request_threaded_irq(bdev->dev, irq, NULL,
+			button_handle_irq,
+			IRQF_ONESHOT | IRQF_TRIGGER_RISING | IRQF_TRIGGER_FALLING,
+			dev_name(bdev->dev), bdata);
+	if (ret < 0) {
+		bdata->irq = 0;
+		bdata->software_debounce = 0;
+		return ret;
+	}
+
+	bdata->threshold = 0;
+	schedule_delayed_work(&bdata->work, 0);
+
+	return 0;
+}
+
 static int gpio_keys_polled_probe(struct platform_device *pdev)
 {
 	struct gpio_keys_platform_data *pdata;
 	struct gpio_keys_button_dev *bdev;
-	int ret;
+	int ret, i;
 
 	ret = gpio_keys_button_probe(pdev, &bdev, 1);
 	if (ret)
@@ -656,9 +802,27 @@ static int gpio_keys_polled_probe(struct platform_device *pdev)
 	if (pdata->enable)
 		pdata->enable(bdev->dev);
 
-	gpio_keys_polled_queue_work(bdev);
+	for (i = 0; i < pdata->nbuttons; i++) {
+		struct gpio_keys_button_data *bdata = &bdev->data[i];
 
-	return ret;
+		if (!bdata->gpiod)
+			continue;
+
+		if (polled_irq && !gpio_keys_polled_request_irq(bdev, bdata)) {
+			dev_dbg(&pdev->dev, "button %d uses irq:%d\n", i,
+				bdata->irq);
+			continue;
+		}
+
+		bdev->npolled++;
+	}
+
+	bdev->poll_interval = pdata->poll_interval;
+	bdev->idle_since = jiffies;
+	if (bdev->npolled)
+		gpio_keys_polled_queue_work(bdev);
+
+	return 0;
 }
 
 static void gpio_keys_irq_close(struct gpio_keys_button_dev *bdev)
@@ -725,6 +889,7 @@ static void __exit gpio_button_exit(void)
 {
 	platform_driver_unregister(&gpio_keys_driver);
 	platform_driver_unregister(&gpio_keys_polled_driver);
+	flush_work(&bh_events_work);
 }
 
 module_init(gpio_button_init);
@@ -42,6 +42,7 @@
 #include <linux/init.h>
 #include <linux/ioport.h>
 #include <linux/delay.h>
+#include <linux/iopoll.h>
 #include <linux/device.h>
 #include <linux/sched.h>
 #include <linux/platform_device.h>
@@ -280,6 +281,8 @@ IFX_MEI_LongWordReadOffset (DSL_DEV_Device_t * pDev, u32 ul_address,
 /**
  * Write several DWORD datas to ARC memory via ARC DMA interface
  * This function writes several DWORD datas to ARC memory via DMA interface.
+ * The data port increments the address itself and uncached stores reach it
+ * in order, so a single barrier after the whole block is enough.
  *
  * \param 	pDev		the device pointer
  * \param  	destaddr	The address to write
@@ -292,6 +295,7 @@ static DSL_DEV_MeiError_t
 IFX_MEI_DMAWrite (DSL_DEV_Device_t * pDev, u32 destaddr,
 			u32 * databuff, u32 databuffsize)
 {
+	u32 data_port = pDev->base_address + ME_DX_DATA;
 	u32 *p = databuff;
 	u32 temp;
 
@@ -302,13 +306,17 @@ IFX_MEI_DMAWrite (DSL_DEV_Device_t * pDev, u32 destaddr,
 	IFX_MEI_LongWordWriteOffset (pDev, ME_DX_AD, destaddr);
 
 	//      Write the data pushed across DMA
-	while (databuffsize--) {
-		temp = *p;
-		if (destaddr == MEI_TO_ARC_MAILBOX)
+	if (destaddr == MEI_TO_ARC_MAILBOX) {
+		while (databuffsize--) {
+			temp = *p++;
 			MEI_HALF_WORD_SWAP (temp);
-		IFX_MEI_LongWordWriteOffset (pDev, (u32) ME_DX_DATA, temp);
-		p++;
+			IFX_MEI_WRITE_REGISTER_L (temp, data_port);
+		}
+	} else {
+		while (databuffsize--)
+			IFX_MEI_WRITE_REGISTER_L (*p++, data_port);
 	}
+	wmb();
 
 	return DSL_DEV_MEI_ERR_SUCCESS;
 
@@ -329,6 +337,7 @@ static DSL_DEV_MeiError_t
 IFX_MEI_DMARead (DSL_DEV_Device_t * pDev, u32 srcaddr, u32 * databuff,
 		       u32 databuffsize)
 {
+	u32 data_port = pDev->base_address + ME_DX_DATA;
 	u32 *p = databuff;
 	u32 temp;
 
@@ -339,13 +348,17 @@ IFX_MEI_DMARead (DSL_DEV_Device_t * pDev, u32 srcaddr, u32 * databuff,
 	IFX_MEI_LongWordWriteOffset (pDev, (u32) ME_DX_AD, srcaddr);
 
 	//      Read the data popped across DMA
-	while (databuffsize--) {
-		IFX_MEI_LongWordReadOffset (pDev, (u32) ME_DX_DATA, &temp);
-		if (databuff == (u32 *) DSL_DEV_PRIVATE(pDev)->CMV_RxMsg)	// swap half word
+	if (databuff == (u32 *) DSL_DEV_PRIVATE(pDev)->CMV_RxMsg) {	// swap half word
+		while (databuffsize--) {
+			temp = IFX_MEI_READ_REGISTER_L (data_port);
 			MEI_HALF_WORD_SWAP (temp);
-		*p = temp;
-		p++;
+			*p++ = temp;
+		}
+	} else {
+		while (databuffsize--)
+			*p++ = IFX_MEI_READ_REGISTER_L (data_port);
 	}
+	rmb();
 
 	return DSL_DEV_MEI_ERR_SUCCESS;
 
@@ -565,7 +578,6 @@ static DSL_DEV_MeiError_t
 IFX_MEI_MailboxWrite (DSL_DEV_Device_t * pDev, u16 * msgsrcbuffer,
 			    u16 msgsize)
 {
-	int i;
 	u32 arc_mailbox_status = 0x0;
 	u32 temp = 0;
 	DSL_DEV_MeiError_t meiMailboxError = DSL_DEV_MEI_ERR_SUCCESS;
@@ -580,17 +592,14 @@ IFX_MEI_MailboxWrite (DSL_DEV_Device_t * pDev, u16 * msgsrcbuffer,
 	DSL_DEV_PRIVATE(pDev)->cmv_waiting = 1;
 	IFX_MEI_LongWordWriteOffset (pDev, (u32) ME_ME2ARC_INT, MEI_TO_ARC_MSGAV);
 
-	i = 0;
-	while (i < WHILE_DELAY) {	// wait for ARC to clear the bit
-		IFX_MEI_LongWordReadOffset (pDev, (u32) ME_ME2ARC_INT, &arc_mailbox_status);
-		if ((arc_mailbox_status & MEI_TO_ARC_MSGAV) != MEI_TO_ARC_MSGAV)
-			break;
-		i++;
-		if (i == WHILE_DELAY) {
-			IFX_MEI_EMSG (">>> Timeout waiting for ARC to clear MEI_TO_ARC_MSGAV!!!"
-			      " MEI_TO_ARC message size = %d DWORDs <<<\n", msgsize/2);
-			meiMailboxError = DSL_DEV_MEI_ERR_FAILURE;
-		}
+	// wait for ARC to clear the bit, sleeping between the reads
+	if (read_poll_timeout (IFX_MEI_READ_REGISTER_L, arc_mailbox_status,
+			       !(arc_mailbox_status & MEI_TO_ARC_MSGAV),
+			       MAILBOX_POLL_US, MAILBOX_TIMEOUT_US, false,
+			       pDev->base_address + ME_ME2ARC_INT)) {
+		IFX_MEI_EMSG (">>> Timeout waiting for ARC to clear MEI_TO_ARC_MSGAV!!!"
+		      " MEI_TO_ARC message size = %d DWORDs <<<\n", msgsize/2);
+		meiMailboxError = DSL_DEV_MEI_ERR_FAILURE;
 	}
 
 	return meiMailboxError;
@@ -1241,8 +1250,8 @@ DSL_BSP_SendCMV (DSL_DEV_Device_t * pDev, u16 * request, int reply, u16 * respon
 	}
 
 #if !defined(BSP_PORT_RTEMS)
-	if (DSL_DEV_PRIVATE(pDev)->arcmsgav == 0)
-		MEI_WAIT_EVENT_TIMEOUT (DSL_DEV_PRIVATE(pDev)->wait_queue_arcmsgav, CMV_TIMEOUT);
+	MEI_WAIT_EVENT_COND_TIMEOUT (DSL_DEV_PRIVATE(pDev)->wait_queue_arcmsgav,
+				     DSL_DEV_PRIVATE(pDev)->arcmsgav != 0, CMV_TIMEOUT);
 #else
 	while (DSL_DEV_PRIVATE(pDev)->arcmsgav == 0 && delay_counter < CMV_TIMEOUT / 5) {
 		MEI_WAIT (5);
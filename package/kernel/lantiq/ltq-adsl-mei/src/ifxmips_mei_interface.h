@@ -132,6 +132,9 @@ ugly_hack_sleep_on_timeout(wait_queue_head_t *q, long timeout)
 /* wait for an event, timeout is measured in ms */
 #define MEI_WAIT_EVENT_TIMEOUT(ev,timeout)\
         ugly_hack_sleep_on_timeout(&ev, timeout * HZ / 1000)
+/* wait for cond to become true or an event, timeout is measured in ms */
+#define MEI_WAIT_EVENT_COND_TIMEOUT(ev,cond,timeout)\
+        wait_event_interruptible_timeout(ev, cond, msecs_to_jiffies(timeout))
 #define MEI_WAKEUP_EVENT(ev)\
         wake_up_interruptible(&ev)
 #endif /* IFX_MEI_BSP */
@@ -178,6 +181,8 @@ ugly_hack_sleep_on_timeout(wait_queue_head_t *q, long timeout)
 #define ME_XMEM_BAR16				(0x0094)
 
 #define WHILE_DELAY 		20000
+#define MAILBOX_POLL_US		20	// poll interval for the ARC to take a message
+#define MAILBOX_TIMEOUT_US	10000
 /*
 **	Define where in ME Processor's memory map the Stratify chip lives
 */
@@ -42,6 +42,8 @@ struct ltq_atm_ops {
 };
 
 #include <linux/atomic.h>
+#include <linux/hashtable.h>
+#include <linux/netdevice.h>
 #include <lantiq_atm.h>
 
 /*
@@ -119,6 +121,7 @@ struct ltq_atm_ops {
 #define QSB_RESERVE_TX_QUEUE            0
 #define FIRST_QSB_QID                   1
 #define MAX_PVC_NUMBER                  (MAX_QUEUE_NUMBER - FIRST_QSB_QID)
+#define PVC_HASH_BITS                   4
 #define MAX_RX_DMA_CHANNEL_NUMBER       8
 #define MAX_TX_DMA_CHANNEL_NUMBER       16
 #define DATA_BUFFER_ALIGNMENT           EMA_ALIGNMENT
@@ -200,12 +203,19 @@ struct connection {
 	unsigned int aal5_vcc_oversize_sdu; /* number of packets with oversize error */
 
 	unsigned int port;
+
+	struct hlist_node vpivci_node;  /*  in vpivci_map, keyed by VPI and VCI */
+	struct hlist_node vpi_node;     /*  in vpi_map, keyed by VPI only       */
 };
 
 struct atm_priv_data {
 	unsigned long conn_table;
 	struct connection conn[MAX_PVC_NUMBER];
 
+	/*  open connections, for the OAM RX and TX lookups */
+	DECLARE_HASHTABLE(vpivci_map, PVC_HASH_BITS);
+	DECLARE_HASHTABLE(vpi_map, PVC_HASH_BITS);
+
 	volatile struct rx_descriptor *aal_desc;
 	unsigned int aal_desc_pos;
 
@@ -239,6 +249,10 @@ struct atm_priv_data {
 	void *tx_skb_base;
 
 	int irq;
+
+	/*  RX and TX completion run from NAPI, on a dummy netdev   */
+	struct net_device *napi_dev;
+	struct napi_struct napi;
 };
 
 #include "ifxmips_atm_ppe_common.h"
@@ -196,15 +196,10 @@ static inline int get_tx_desc(unsigned int);
  *  mailbox handler and signal function
  */
 static inline void mailbox_oam_rx_handler(void);
-static inline void mailbox_aal_rx_handler(void);
+static inline int mailbox_aal_rx_handler(int);
 static irqreturn_t mailbox_irq_handler(int, void *);
 static inline void mailbox_signal(unsigned int, int);
-static void do_ppe_tasklet(unsigned long);
-#if LINUX_VERSION_CODE < KERNEL_VERSION(5,9,0)
-DECLARE_TASKLET(g_dma_tasklet, do_ppe_tasklet, 0);
-#else
-DECLARE_TASKLET_OLD(g_dma_tasklet, do_ppe_tasklet);
-#endif
+static int ppe_napi_poll(struct napi_struct *, int);
 
 /*
  *  QSB & HTU setting functions
@@ -267,6 +262,8 @@ EXPORT_SYMBOL(ifx_mei_atm_showtime_exit);
 
 static struct atm_priv_data g_atm_priv_data;
 
+#define VPIVCI_KEY(vpi, vci)	(((vpi) << 16) | (vci))
+
 static struct atmdev_ops g_ifx_atm_ops = {
 	.open = ppe_open,
 	.close = ppe_close,
@@ -447,6 +444,11 @@ static int ppe_open(struct atm_vcc *vcc)
 	*MBOX_IGU1_ISRC |= (1 << (conn + FIRST_QSB_QID + 16));
 	*MBOX_IGU1_IER |= (1 << (conn + FIRST_QSB_QID + 16));
 
+	/*  make it visible to the OAM and TX lookups */
+	vcc->dev_data = &g_atm_priv_data.conn[conn];
+	hash_add_rcu(g_atm_priv_data.vpivci_map, &g_atm_priv_data.conn[conn].vpivci_node, VPIVCI_KEY(vpi, vci));
+	hash_add_rcu(g_atm_priv_data.vpi_map, &g_atm_priv_data.conn[conn].vpi_node, vpi);
+
 	ret = 0;
 
 PPE_OPEN_EXIT:
@@ -473,6 +475,12 @@ static void ppe_close(struct atm_vcc *vcc)
 	/*  clear htu   */
 	clear_htu_entry(conn);
 
+	/*  remove from lookups, the entries are reused on the next open */
+	hash_del_rcu(&connection->vpivci_node);
+	hash_del_rcu(&connection->vpi_node);
+	vcc->dev_data = NULL;
+	synchronize_rcu();
+
 	/*  release connection  */
 	connection->vcc = NULL;
 	connection->aal5_vcc_crc_err = 0;
@@ -501,7 +509,7 @@ static void ppe_close(struct atm_vcc *vcc)
 	}
 
 	/* wait for incoming packets to be processed by upper layers */
-	tasklet_unlock_wait(&g_dma_tasklet);
+	napi_synchronize(&g_atm_priv_data.napi);
 
 PPE_CLOSE_EXIT:
 	return;
@@ -911,7 +919,7 @@ static inline void mailbox_oam_rx_handler(void)
 	}
 }
 
-static inline void mailbox_aal_rx_handler(void)
+static inline int mailbox_aal_rx_handler(int budget)
 {
 	unsigned int vlddes = WRX_DMA_CHANNEL_CONFIG(RX_DMA_CH_AAL)->vlddes;
 	struct rx_descriptor reg_desc;
@@ -919,9 +927,9 @@ static inline void mailbox_aal_rx_handler(void)
 	struct atm_vcc *vcc;
 	struct sk_buff *skb, *new_skb;
 	struct rx_inband_trailer *trailer;
-	unsigned int i;
+	int i;
 
-	for ( i = 0; i < vlddes; i++ ) {
+	for ( i = 0; i < vlddes && i < budget; i++ ) {
 		unsigned int loop_count = 0;
 
 		do {
@@ -1001,15 +1009,19 @@ static inline void mailbox_aal_rx_handler(void)
 
 		mailbox_signal(RX_DMA_CH_AAL, 0);
 	}
+
+	return i;
 }
 
-static void do_ppe_tasklet(unsigned long data)
+static int ppe_napi_poll(struct napi_struct *napi, int budget)
 {
 	unsigned int irqs = *MBOX_IGU1_ISR;
-	*MBOX_IGU1_ISRC = *MBOX_IGU1_ISR;
+	int work_done;
 
-	if (irqs & (1 << RX_DMA_CH_AAL))
-		mailbox_aal_rx_handler();
+	*MBOX_IGU1_ISRC = irqs;
+
+	/*  descriptors left over from the last poll have no irq pending anymore */
+	work_done = mailbox_aal_rx_handler(budget);
 	if (irqs & (1 << RX_DMA_CH_OAM))
 		mailbox_oam_rx_handler();
 
@@ -1017,12 +1029,17 @@ static void do_ppe_tasklet(unsigned long data)
 	if ((irqs >> (FIRST_QSB_QID + 16)) & g_atm_priv_data.conn_table)
 		mailbox_tx_handler(irqs >> (FIRST_QSB_QID + 16));
 
-	if ((*MBOX_IGU1_ISR & ((1 << RX_DMA_CH_AAL) | (1 << RX_DMA_CH_OAM))) != 0)
-		tasklet_schedule(&g_dma_tasklet);
-	else if (*MBOX_IGU1_ISR >> (FIRST_QSB_QID + 16)) /* TX queue */
-		tasklet_schedule(&g_dma_tasklet);
-	else
+	if (work_done >= budget)
+		return budget;
+
+	/*  more events came in meanwhile, stay in polling mode */
+	if (WRX_DMA_CHANNEL_CONFIG(RX_DMA_CH_AAL)->vlddes || *MBOX_IGU1_ISR)
+		return budget;
+
+	if (napi_complete_done(napi, work_done))
 		enable_irq(g_atm_priv_data.irq);
+
+	return work_done;
 }
 
 static irqreturn_t mailbox_irq_handler(int irq, void *dev_id)
@@ -1031,7 +1048,7 @@ static irqreturn_t mailbox_irq_handler(int irq, void *dev_id)
 		return IRQ_HANDLED;
 
 	disable_irq_nosync(g_atm_priv_data.irq);
-	tasklet_schedule(&g_dma_tasklet);
+	napi_schedule(&g_atm_priv_data.napi);
 
 	return IRQ_HANDLED;
 }
@@ -1275,47 +1292,48 @@ static void invalidate_oam_htu_entry(void)
 
 static inline int find_vpi(unsigned int vpi)
 {
-	int i;
-	unsigned int bit;
+	struct connection *conn;
+	int ret = -1;
 
-	for ( i = 0, bit = 1; i < MAX_PVC_NUMBER; i++, bit <<= 1 ) {
-		if ( (g_atm_priv_data.conn_table & bit) != 0
-				&& g_atm_priv_data.conn[i].vcc != NULL
-				&& vpi == g_atm_priv_data.conn[i].vcc->vpi )
-			return i;
+	rcu_read_lock();
+	hash_for_each_possible_rcu(g_atm_priv_data.vpi_map, conn, vpi_node, vpi) {
+		if ( conn->vcc != NULL && vpi == conn->vcc->vpi ) {
+			ret = conn - g_atm_priv_data.conn;
+			break;
+		}
 	}
+	rcu_read_unlock();
 
-	return -1;
+	return ret;
 }
 
 static inline int find_vpivci(unsigned int vpi, unsigned int vci)
 {
-	int i;
-	unsigned int bit;
-
-	for ( i = 0, bit = 1; i < MAX_PVC_NUMBER; i++, bit <<= 1 ) {
-		if ( (g_atm_priv_data.conn_table & bit) != 0
-				&& g_atm_priv_data.conn[i].vcc != NULL
-				&& vpi == g_atm_priv_data.conn[i].vcc->vpi
-				&& vci == g_atm_priv_data.conn[i].vcc->vci )
-			return i;
+	struct connection *conn;
+	int ret = -1;
+
+	rcu_read_lock();
+	hash_for_each_possible_rcu(g_atm_priv_data.vpivci_map, conn, vpivci_node, VPIVCI_KEY(vpi, vci)) {
+		if ( conn->vcc != NULL
+				&& vpi == conn->vcc->vpi
+				&& vci == conn->vcc->vci ) {
+			ret = conn - g_atm_priv_data.conn;
+			break;
+		}
 	}
+	rcu_read_unlock();
 
-	return -1;
+	return ret;
 }
 
 static inline int find_vcc(struct atm_vcc *vcc)
 {
-	int i;
-	unsigned int bit;
+	struct connection *conn = vcc->dev_data;
 
-	for ( i = 0, bit = 1; i < MAX_PVC_NUMBER; i++, bit <<= 1 ) {
-		if ( (g_atm_priv_data.conn_table & bit) != 0
-			&& g_atm_priv_data.conn[i].vcc == vcc )
-		return i;
-	}
+	if ( conn == NULL || conn->vcc != vcc )
+		return -1;
 
-	return -1;
+	return conn - g_atm_priv_data.conn;
 }
 
 static inline int ifx_atm_version(const struct ltq_atm_ops *ops, char *buf)
@@ -1758,6 +1776,18 @@ static const struct of_device_id ltq_atm_match[] = {
 };
 MODULE_DEVICE_TABLE(of, ltq_atm_match);
 
+static void free_napi(void)
+{
+	napi_disable(&g_atm_priv_data.napi);
+	netif_napi_del(&g_atm_priv_data.napi);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,10,0)
+	free_netdev(g_atm_priv_data.napi_dev);
+#else
+	kfree(g_atm_priv_data.napi_dev);
+#endif
+	g_atm_priv_data.napi_dev = NULL;
+}
+
 static int ltq_atm_probe(struct platform_device *pdev)
 {
 	const struct of_device_id *match;
@@ -1789,6 +1819,24 @@ static int ltq_atm_probe(struct platform_device *pdev)
 	init_rx_tables();
 	init_tx_tables();
 
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,10,0)
+	g_atm_priv_data.napi_dev = alloc_netdev_dummy(0);
+#else
+	g_atm_priv_data.napi_dev = kzalloc(sizeof(struct net_device), GFP_KERNEL);
+	if ( g_atm_priv_data.napi_dev )
+		init_dummy_netdev(g_atm_priv_data.napi_dev);
+#endif
+	if ( !g_atm_priv_data.napi_dev ) {
+		ret = -ENOMEM;
+		goto INIT_PRIV_DATA_FAIL;
+	}
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6,1,0)
+	netif_napi_add(g_atm_priv_data.napi_dev, &g_atm_priv_data.napi, ppe_napi_poll);
+#else
+	netif_napi_add(g_atm_priv_data.napi_dev, &g_atm_priv_data.napi, ppe_napi_poll, NAPI_POLL_WEIGHT);
+#endif
+	napi_enable(&g_atm_priv_data.napi);
+
 	/*  create devices  */
 	for ( port_num = 0; port_num < ATM_PORT_NUMBER; port_num++ ) {
 		g_atm_priv_data.port[port_num].dev = atm_dev_register("ifxmips_atm", NULL, &g_ifx_atm_ops, -1, NULL);
@@ -1859,6 +1907,7 @@ REQUEST_IRQ_PPE_MAILBOX_IGU1_INT_FAIL:
 ATM_DEV_REGISTER_FAIL:
 	while ( port_num-- > 0 )
 		atm_dev_deregister(g_atm_priv_data.port[port_num].dev);
+	free_napi();
 INIT_PRIV_DATA_FAIL:
 	clear_priv_data();
 	printk("ifxmips_atm: ATM init failed\n");
@@ -1882,6 +1931,8 @@ static int ltq_atm_remove(struct platform_device *pdev)
 	for ( port_num = 0; port_num < ATM_PORT_NUMBER; port_num++ )
 		atm_dev_deregister(g_atm_priv_data.port[port_num].dev);
 
+	free_napi();
+
 	ops->shutdown();
 
 	clear_priv_data();
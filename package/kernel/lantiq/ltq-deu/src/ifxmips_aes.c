@@ -57,10 +57,16 @@
 #include <linux/delay.h>
 #include <asm/byteorder.h>
 #include <crypto/algapi.h>
+#include <crypto/authenc.h>
 #include <crypto/b128ops.h>
 #include <crypto/gcm.h>
 #include <crypto/gf128mul.h>
 #include <crypto/scatterwalk.h>
+#if LINUX_VERSION_CODE < KERNEL_VERSION(5,11,0)
+#include <crypto/sha.h>
+#else
+#include <crypto/sha1.h>
+#endif
 #include <crypto/xts.h>
 #include <crypto/internal/aead.h>
 #include <crypto/internal/hash.h>
@@ -86,6 +92,9 @@ spinlock_t aes_lock;
 #define CRTCL_SECT_START       spin_lock_irqsave(&aes_lock, flag)
 #define CRTCL_SECT_END         spin_unlock_irqrestore(&aes_lock, flag)
 
+/* blocks processed per critical section, bounds the IRQ-off time */
+#define AES_BLOCKS_PER_SECT    16
+
 /* Definition of constants */
 #define AES_START   IFX_AES_CON
 #define AES_MIN_KEY_SIZE    16
@@ -262,75 +271,82 @@ void ifx_deu_aes (void *ctx_arg, u8 *out_arg, const u8 *in_arg,
     /*~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
     int i = 0;
     int byte_cnt = nbytes; 
+    int blocks;
 
-    CRTCL_SECT_START;
+    /* the lock keeps IRQs off, so only hold it for AES_BLOCKS_PER_SECT
+       blocks at a time; key and chaining state are reloaded after that */
+    do {
+        CRTCL_SECT_START;
 
-    aes_set_key_hw (ctx_arg);
+        aes_set_key_hw (ctx_arg);
 
-    aes->controlr.E_D = !encdec;    //encryption
-    aes->controlr.O = mode; //0 ECB 1 CBC 2 OFB 3 CFB 4 CTR 
+        aes->controlr.E_D = !encdec;    //encryption
+        aes->controlr.O = mode; //0 ECB 1 CBC 2 OFB 3 CFB 4 CTR 
 
-    //aes->controlr.F = 128; //default; only for CFB and OFB modes; change only for customer-specific apps
-    if (mode > 0) {
-        aes->IV3R = DEU_ENDIAN_SWAP(*(u32 *) iv_arg);
-        aes->IV2R = DEU_ENDIAN_SWAP(*((u32 *) iv_arg + 1));
-        aes->IV1R = DEU_ENDIAN_SWAP(*((u32 *) iv_arg + 2));
-        aes->IV0R = DEU_ENDIAN_SWAP(*((u32 *) iv_arg + 3));
-    };
+        //aes->controlr.F = 128; //default; only for CFB and OFB modes; change only for customer-specific apps
+        if (mode > 0) {
+            aes->IV3R = DEU_ENDIAN_SWAP(*(u32 *) iv_arg);
+            aes->IV2R = DEU_ENDIAN_SWAP(*((u32 *) iv_arg + 1));
+            aes->IV1R = DEU_ENDIAN_SWAP(*((u32 *) iv_arg + 2));
+            aes->IV0R = DEU_ENDIAN_SWAP(*((u32 *) iv_arg + 3));
+        };
 
 
-    i = 0;
-    while (byte_cnt >= 16) {
+        blocks = 0;
+        while (byte_cnt >= 16 && blocks < AES_BLOCKS_PER_SECT) {
 
-        aes->ID3R = INPUT_ENDIAN_SWAP(*((u32 *) in_arg + (i * 4) + 0));
-        aes->ID2R = INPUT_ENDIAN_SWAP(*((u32 *) in_arg + (i * 4) + 1));
-        aes->ID1R = INPUT_ENDIAN_SWAP(*((u32 *) in_arg + (i * 4) + 2));
-        aes->ID0R = INPUT_ENDIAN_SWAP(*((u32 *) in_arg + (i * 4) + 3));    /* start crypto */
-        
-        while (aes->controlr.BUS) {
-            // this will not take long
-        }
+            aes->ID3R = INPUT_ENDIAN_SWAP(*((u32 *) in_arg + (i * 4) + 0));
+            aes->ID2R = INPUT_ENDIAN_SWAP(*((u32 *) in_arg + (i * 4) + 1));
+            aes->ID1R = INPUT_ENDIAN_SWAP(*((u32 *) in_arg + (i * 4) + 2));
+            aes->ID0R = INPUT_ENDIAN_SWAP(*((u32 *) in_arg + (i * 4) + 3));    /* start crypto */
+            
+            while (aes->controlr.BUS) {
+                // this will not take long
+            }
 
-        *((volatile u32 *) out_arg + (i * 4) + 0) = aes->OD3R;
-        *((volatile u32 *) out_arg + (i * 4) + 1) = aes->OD2R;
-        *((volatile u32 *) out_arg + (i * 4) + 2) = aes->OD1R;
-        *((volatile u32 *) out_arg + (i * 4) + 3) = aes->OD0R;
+            *((volatile u32 *) out_arg + (i * 4) + 0) = aes->OD3R;
+            *((volatile u32 *) out_arg + (i * 4) + 1) = aes->OD2R;
+            *((volatile u32 *) out_arg + (i * 4) + 2) = aes->OD1R;
+            *((volatile u32 *) out_arg + (i * 4) + 3) = aes->OD0R;
 
-        i++;
-        byte_cnt -= 16;
-    }
+            i++;
+            blocks++;
+            byte_cnt -= 16;
+        }
 
-    /* To handle all non-aligned bytes (not aligned to 16B size) */
-    if (byte_cnt) {
-        u8 temparea[16] = {0,};
+        /* To handle all non-aligned bytes (not aligned to 16B size) */
+        if (byte_cnt > 0 && byte_cnt < 16) {
+            u8 temparea[16] = {0,};
 
-        memcpy(temparea, ((u32 *) in_arg + (i * 4)), byte_cnt);
+            memcpy(temparea, ((u32 *) in_arg + (i * 4)), byte_cnt);
 
-        aes->ID3R = INPUT_ENDIAN_SWAP(*((u32 *) temparea + 0));
-        aes->ID2R = INPUT_ENDIAN_SWAP(*((u32 *) temparea + 1));
-        aes->ID1R = INPUT_ENDIAN_SWAP(*((u32 *) temparea + 2));
-        aes->ID0R = INPUT_ENDIAN_SWAP(*((u32 *) temparea + 3));    /* start crypto */
+            aes->ID3R = INPUT_ENDIAN_SWAP(*((u32 *) temparea + 0));
+            aes->ID2R = INPUT_ENDIAN_SWAP(*((u32 *) temparea + 1));
+            aes->ID1R = INPUT_ENDIAN_SWAP(*((u32 *) temparea + 2));
+            aes->ID0R = INPUT_ENDIAN_SWAP(*((u32 *) temparea + 3));    /* start crypto */
 
-        while (aes->controlr.BUS) {
-        }
+            while (aes->controlr.BUS) {
+            }
 
-        *((volatile u32 *) temparea + 0) = aes->OD3R;
-        *((volatile u32 *) temparea + 1) = aes->OD2R;
-        *((volatile u32 *) temparea + 2) = aes->OD1R;
-        *((volatile u32 *) temparea + 3) = aes->OD0R;
+            *((volatile u32 *) temparea + 0) = aes->OD3R;
+            *((volatile u32 *) temparea + 1) = aes->OD2R;
+            *((volatile u32 *) temparea + 2) = aes->OD1R;
+            *((volatile u32 *) temparea + 3) = aes->OD0R;
 
-        memcpy(((u32 *) out_arg + (i * 4)), temparea, byte_cnt);
-    }
+            memcpy(((u32 *) out_arg + (i * 4)), temparea, byte_cnt);
+            byte_cnt = 0;
+        }
 
-    //tc.chen : copy iv_arg back
-    if (mode > 0) {
-        *((u32 *) iv_arg) = DEU_ENDIAN_SWAP(aes->IV3R);
-        *((u32 *) iv_arg + 1) = DEU_ENDIAN_SWAP(aes->IV2R);
-        *((u32 *) iv_arg + 2) = DEU_ENDIAN_SWAP(aes->IV1R);
-        *((u32 *) iv_arg + 3) = DEU_ENDIAN_SWAP(aes->IV0R);
-    }
+        //tc.chen : copy iv_arg back
+        if (mode > 0) {
+            *((u32 *) iv_arg) = DEU_ENDIAN_SWAP(aes->IV3R);
+            *((u32 *) iv_arg + 1) = DEU_ENDIAN_SWAP(aes->IV2R);
+            *((u32 *) iv_arg + 2) = DEU_ENDIAN_SWAP(aes->IV1R);
+            *((u32 *) iv_arg + 3) = DEU_ENDIAN_SWAP(aes->IV0R);
+        }
 
-    CRTCL_SECT_END;
+        CRTCL_SECT_END;
+    } while (byte_cnt > 0);
 }
 
 /*!
@@ -1871,6 +1887,215 @@ struct aead_alg ifxdeu_gcm_aes_alg = {
     .setauthsize             =   gcm_aes_setauthsize,
 };
 
+#ifdef CONFIG_CRYPTO_DEV_SHA1_HMAC
+struct aes_authenc_ctx {
+    struct aes_ctx aes;
+    struct crypto_shash *hmac;
+};
+
+/*! \fn int authenc_aes_set_key (struct crypto_aead *aead, const uint8_t *key, unsigned int keylen)
+ *  \ingroup IFX_AES_FUNCTIONS
+ *  \brief sets the HMAC and AES keys for aead authenc
+ *  \param aead linux crypto aead
+ *  \param key authenc key blob
+ *  \param keylen length of the key blob
+ *  \return -EINVAL - bad key, 0 - SUCCESS
+*/
+static int authenc_aes_set_key (struct crypto_aead *aead, const u8 *key, unsigned int keylen)
+{
+    struct aes_authenc_ctx *ctx = crypto_aead_ctx(aead);
+    struct crypto_authenc_keys keys;
+    int err;
+
+    err = crypto_authenc_extractkeys(&keys, key, keylen);
+    if (err) goto out;
+
+    err = crypto_shash_setkey(ctx->hmac, keys.authkey, keys.authkeylen);
+    if (err) goto out;
+
+    err = aes_set_key(&aead->base, keys.enckey, keys.enckeylen);
+
+out:
+    memzero_explicit(&keys, sizeof(keys));
+    return err;
+}
+
+/*! \fn int authenc_aes_hash_assoc(struct shash_desc *desc, struct aead_request *req)
+ *  \ingroup IFX_AES_FUNCTIONS
+ *  \brief hash the assoc data and copy it to dst if not in place
+ *  \param desc hmac descriptor
+ *  \param req aead request
+ *  \return err
+*/
+static int authenc_aes_hash_assoc(struct shash_desc *desc, struct aead_request *req)
+{
+    u8 buf[SHA1_BLOCK_SIZE];
+    unsigned int off, len;
+    int err = 0;
+
+    for (off = 0; off < req->assoclen && !err; off += len) {
+        len = min_t(unsigned int, req->assoclen - off, sizeof(buf));
+        scatterwalk_map_and_copy(buf, req->src, off, len, 0);
+        if (req->src != req->dst)
+            scatterwalk_map_and_copy(buf, req->dst, off, len, 1);
+        err = crypto_shash_update(desc, buf, len);
+    }
+
+    return err;
+}
+
+/*! \fn int authenc_aes_encrypt(struct aead_request *req)
+ *  \ingroup IFX_AES_FUNCTIONS
+ *  \brief encrypt and authenticate in one walk over the payload
+ *  \param req aead request
+ *  \return err
+*/
+static int authenc_aes_encrypt(struct aead_request *req)
+{
+    struct crypto_aead *aead = crypto_aead_reqtfm(req);
+    struct aes_authenc_ctx *ctx = crypto_aead_ctx(aead);
+    SHASH_DESC_ON_STACK(desc, ctx->hmac);
+    struct skcipher_walk walk;
+    u8 digest[SHA1_DIGEST_SIZE];
+    unsigned int enc_bytes, nbytes;
+    int err;
+
+    if (req->cryptlen % AES_BLOCK_SIZE)
+        return -EINVAL;
+
+    desc->tfm = ctx->hmac;
+    err = crypto_shash_init(desc);
+    if (!err)
+        err = authenc_aes_hash_assoc(desc, req);
+    if (err)
+        return err;
+
+    err = skcipher_walk_aead_encrypt(&walk, req, false);
+
+    /* hash each chunk of ciphertext while it is still in the cache */
+    while ((nbytes = enc_bytes = walk.nbytes)) {
+        enc_bytes -= (nbytes % AES_BLOCK_SIZE);
+        ifx_deu_aes_cbc(&ctx->aes, walk.dst.virt.addr, walk.src.virt.addr,
+                       walk.iv, enc_bytes, CRYPTO_DIR_ENCRYPT, 0);
+        crypto_shash_update(desc, walk.dst.virt.addr, enc_bytes);
+        nbytes &= AES_BLOCK_SIZE - 1;
+        err = skcipher_walk_done(&walk, nbytes);
+    }
+    if (err)
+        return err;
+
+    err = crypto_shash_final(desc, digest);
+    if (err)
+        return err;
+
+    scatterwalk_map_and_copy(digest, req->dst, req->assoclen + req->cryptlen,
+                       crypto_aead_authsize(aead), 1);
+
+    return 0;
+}
+
+/*! \fn int authenc_aes_decrypt(struct aead_request *req)
+ *  \ingroup IFX_AES_FUNCTIONS
+ *  \brief authenticate and decrypt in one walk over the payload
+ *  \param req aead request
+ *  \return err
+*/
+static int authenc_aes_decrypt(struct aead_request *req)
+{
+    struct crypto_aead *aead = crypto_aead_reqtfm(req);
+    struct aes_authenc_ctx *ctx = crypto_aead_ctx(aead);
+    unsigned int authsize = crypto_aead_authsize(aead);
+    SHASH_DESC_ON_STACK(desc, ctx->hmac);
+    struct skcipher_walk walk;
+    u8 digest[SHA1_DIGEST_SIZE];
+    u8 tag[SHA1_DIGEST_SIZE];
+    unsigned int dec_bytes, nbytes;
+    int err;
+
+    if (req->cryptlen < authsize || (req->cryptlen - authsize) % AES_BLOCK_SIZE)
+        return -EINVAL;
+
+    desc->tfm = ctx->hmac;
+    err = crypto_shash_init(desc);
+    if (!err)
+        err = authenc_aes_hash_assoc(desc, req);
+    if (err)
+        return err;
+
+    err = skcipher_walk_aead_decrypt(&walk, req, false);
+
+    /* ciphertext has to be hashed before an in-place decrypt overwrites it */
+    while ((nbytes = dec_bytes = walk.nbytes)) {
+        dec_bytes -= (nbytes % AES_BLOCK_SIZE);
+        crypto_shash_update(desc, walk.src.virt.addr, dec_bytes);
+        ifx_deu_aes_cbc(&ctx->aes, walk.dst.virt.addr, walk.src.virt.addr,
+                       walk.iv, dec_bytes, CRYPTO_DIR_DECRYPT, 0);
+        nbytes &= AES_BLOCK_SIZE - 1;
+        err = skcipher_walk_done(&walk, nbytes);
+    }
+    if (err)
+        return err;
+
+    err = crypto_shash_final(desc, digest);
+    if (err)
+        return err;
+
+    scatterwalk_map_and_copy(tag, req->src, req->assoclen + req->cryptlen - authsize,
+                       authsize, 0);
+
+    return crypto_memneq(tag, digest, authsize) ? -EBADMSG : 0;
+}
+
+/*! \fn int authenc_aes_init_tfm(struct crypto_aead *aead)
+ *  \ingroup IFX_AES_FUNCTIONS
+ *  \brief allocate the hmac(sha1) transform, picks up the DEU one
+ *  \param aead linux crypto aead
+ *  \return err
+*/
+static int authenc_aes_init_tfm(struct crypto_aead *aead)
+{
+    struct aes_authenc_ctx *ctx = crypto_aead_ctx(aead);
+
+    ctx->hmac = crypto_alloc_shash("hmac(sha1)", 0, 0);
+    if (IS_ERR(ctx->hmac)) return PTR_ERR(ctx->hmac);
+
+    return 0;
+}
+
+/*! \fn void authenc_aes_exit_tfm(struct crypto_aead *aead)
+ *  \ingroup IFX_AES_FUNCTIONS
+ *  \brief free the hmac(sha1) transform
+ *  \param aead linux crypto aead
+*/
+static void authenc_aes_exit_tfm(struct crypto_aead *aead)
+{
+    struct aes_authenc_ctx *ctx = crypto_aead_ctx(aead);
+
+    crypto_free_shash(ctx->hmac);
+}
+
+/*
+ * \brief AES function mappings
+*/
+struct aead_alg ifxdeu_authenc_sha1_cbc_aes_alg = {
+    .base.cra_name           =   "authenc(hmac(sha1),cbc(aes))",
+    .base.cra_driver_name    =   "ifxdeu-authenc(hmac(sha1),cbc(aes))",
+    .base.cra_priority       =   400,
+    .base.cra_flags          =   CRYPTO_ALG_KERN_DRIVER_ONLY,
+    .base.cra_blocksize      =   AES_BLOCK_SIZE,
+    .base.cra_ctxsize        =   sizeof(struct aes_authenc_ctx),
+    .base.cra_module         =   THIS_MODULE,
+    .base.cra_list           =   LIST_HEAD_INIT(ifxdeu_authenc_sha1_cbc_aes_alg.base.cra_list),
+    .init                    =   authenc_aes_init_tfm,
+    .exit                    =   authenc_aes_exit_tfm,
+    .ivsize                  =   AES_BLOCK_SIZE,
+    .maxauthsize             =   SHA1_DIGEST_SIZE,
+    .setkey                  =   authenc_aes_set_key,
+    .encrypt                 =   authenc_aes_encrypt,
+    .decrypt                 =   authenc_aes_decrypt,
+};
+#endif /* CONFIG_CRYPTO_DEV_SHA1_HMAC */
+
 /*! \fn int ifxdeu_init_aes (void)
  *  \ingroup IFX_AES_FUNCTIONS
  *  \brief function to initialize AES driver
@@ -1912,12 +2137,23 @@ int ifxdeu_init_aes (void)
     if ((ret = crypto_register_aead(&ifxdeu_gcm_aes_alg)))
         goto gcm_aes_err;
 
+#ifdef CONFIG_CRYPTO_DEV_SHA1_HMAC
+    if ((ret = crypto_register_aead(&ifxdeu_authenc_sha1_cbc_aes_alg)))
+        goto authenc_aes_err;
+#endif
+
     CRTCL_SECT_INIT;
 
 
     printk (KERN_NOTICE "IFX DEU AES initialized%s%s.\n", disable_multiblock ? "" : " (multiblock)", disable_deudma ? "" : " (DMA)");
     return ret;
 
+#ifdef CONFIG_CRYPTO_DEV_SHA1_HMAC
+authenc_aes_err:
+    crypto_unregister_aead(&ifxdeu_gcm_aes_alg);
+    printk (KERN_ERR "IFX authenc_aes initialization failed!\n");
+    return ret;
+#endif
 gcm_aes_err:
     crypto_unregister_aead(&ifxdeu_gcm_aes_alg);
     printk (KERN_ERR "IFX gcm_aes initialization failed!\n");
@@ -1976,4 +2212,7 @@ void ifxdeu_fini_aes (void)
     crypto_unregister_skcipher (&ifxdeu_ctr_rfc3686_aes_alg);
     crypto_unregister_shash (&ifxdeu_cbcmac_aes_alg);
     crypto_unregister_aead (&ifxdeu_gcm_aes_alg);
+#ifdef CONFIG_CRYPTO_DEV_SHA1_HMAC
+    crypto_unregister_aead (&ifxdeu_authenc_sha1_cbc_aes_alg);
+#endif
 }
@@ -62,6 +62,7 @@
 #define MD5_HMAC_BLOCK_SIZE 64
 #define MD5_BLOCK_WORDS     16
 #define MD5_HASH_WORDS      4
+#define MD5_MAX_BLOCKS      16  // blocks hashed per critical section
 #define HASH_START   IFX_HASH_CON
 
 //#define CRYPTO_DEBUG
@@ -81,47 +82,60 @@ struct md5_ctx {
 
 extern int disable_deudma;
 
-/*! \fn static void md5_transform(u32 *hash, u32 const *in)
+/*! \fn static void md5_transform(struct md5_ctx *mctx, u32 *hash, u32 const *in, unsigned int blocks)
  *  \ingroup IFX_MD5_FUNCTIONS
  *  \brief main interface to md5 hardware   
  *  \param hash current hash value  
- *  \param in 64-byte block of input  
+ *  \param in 64-byte blocks of input  
+ *  \param blocks number of blocks
 */                                 
-static void md5_transform(struct md5_ctx *mctx, u32 *hash, u32 const *in)
+static void md5_transform(struct md5_ctx *mctx, u32 *hash, u32 const *in, unsigned int blocks)
 {
     int i;
     volatile struct deu_hash_t *hashs = (struct deu_hash_t *) HASH_START;
     unsigned long flag;
+    unsigned int n;
 
-    CRTCL_SECT_HASH_START;
+    while (blocks) {
+        n = min_t(unsigned int, blocks, MD5_MAX_BLOCKS);
+        blocks -= n;
 
-    MD5_HASH_INIT;
+        CRTCL_SECT_HASH_START;
 
-    if (mctx->started) { 
-        hashs->D1R = *((u32 *) hash + 0);
-        hashs->D2R = *((u32 *) hash + 1);
-        hashs->D3R = *((u32 *) hash + 2);
-        hashs->D4R = *((u32 *) hash + 3);
-    }
+        MD5_HASH_INIT;
 
-    for (i = 0; i < 16; i++) {
-        hashs->MR = in[i];
-//      printk("in[%d]: %08x\n", i, in[i]);
-    };
+        if (mctx->started) { 
+            hashs->D1R = *((u32 *) hash + 0);
+            hashs->D2R = *((u32 *) hash + 1);
+            hashs->D3R = *((u32 *) hash + 2);
+            hashs->D4R = *((u32 *) hash + 3);
+        }
 
-    //wait for processing
-    while (hashs->controlr.BSY) {
-        // this will not take long
-    }
+        /* consecutive blocks continue from the digest left in the
+         * output registers
+        */
+        while (n--) {
+            for (i = 0; i < 16; i++) {
+                hashs->MR = in[i];
+            };
+
+            //wait for processing
+            while (hashs->controlr.BSY) {
+                // this will not take long
+            }
+
+            in += 16;
+        }
 
-    *((u32 *) hash + 0) = hashs->D1R;
-    *((u32 *) hash + 1) = hashs->D2R;
-    *((u32 *) hash + 2) = hashs->D3R;
-    *((u32 *) hash + 3) = hashs->D4R;
+        *((u32 *) hash + 0) = hashs->D1R;
+        *((u32 *) hash + 1) = hashs->D2R;
+        *((u32 *) hash + 2) = hashs->D3R;
+        *((u32 *) hash + 3) = hashs->D4R;
 
-    CRTCL_SECT_HASH_END;
+        CRTCL_SECT_HASH_END;
 
-    mctx->started = 1;
+        mctx->started = 1;
+    }
 }
 
 /*! \fn static inline void md5_transform_helper(struct md5_ctx *ctx)
@@ -132,7 +146,7 @@ static void md5_transform(struct md5_ctx *mctx, u32 *hash, u32 const *in)
 static inline void md5_transform_helper(struct md5_ctx *ctx)
 {
     //le32_to_cpu_array(ctx->block, sizeof(ctx->block) / sizeof(u32));
-    md5_transform(ctx, ctx->hash, ctx->block);
+    md5_transform(ctx, ctx->hash, ctx->block, 1);
 }
 
 /*! \fn static void md5_init(struct crypto_tfm *tfm)
@@ -177,6 +191,15 @@ static int md5_update(struct shash_desc *desc, const u8 *data, unsigned int len)
     data += avail;
     len -= avail;
 
+    /* whole blocks are hashed straight from aligned input */
+    if (IS_ALIGNED((unsigned long)data, sizeof(u32)) &&
+        len >= sizeof(mctx->block)) {
+        md5_transform(mctx, mctx->hash, (const u32 *)data,
+                      len / sizeof(mctx->block));
+        data += len & ~(sizeof(mctx->block) - 1);
+        len &= sizeof(mctx->block) - 1;
+    }
+
     while (len >= sizeof(mctx->block)) {
         memcpy(mctx->block, data, sizeof(mctx->block));
         md5_transform_helper(mctx);
@@ -215,7 +238,7 @@ static int md5_final(struct shash_desc *desc, u8 *out)
     mctx->block[14] = le32_to_cpu(mctx->byte_count << 3);
     mctx->block[15] = le32_to_cpu(mctx->byte_count >> 29);
 
-    md5_transform(mctx, mctx->hash, mctx->block);                                                 
+    md5_transform(mctx, mctx->hash, mctx->block, 1);                                                 
 
     memcpy(out, mctx->hash, MD5_DIGEST_SIZE);
 
@@ -67,6 +67,7 @@
 
 #define SHA1_DIGEST_SIZE    20
 #define SHA1_HMAC_BLOCK_SIZE    64
+#define SHA1_MAX_BLOCKS     16  // blocks hashed per critical section
 #define HASH_START   IFX_HASH_CON
 
 //#define CRYPTO_DEBUG
@@ -90,54 +91,68 @@ struct sha1_ctx {
 
 extern int disable_deudma;
 
-/*! \fn static void sha1_transform1 (u32 *state, const u32 *in)
+/*! \fn static void sha1_transform1 (struct sha1_ctx *sctx, const u32 *in, unsigned int blocks)
  *  \ingroup IFX_SHA1_FUNCTIONS
  *  \brief main interface to sha1 hardware   
- *  \param state current state 
- *  \param in 64-byte block of input  
+ *  \param sctx sha1 context
+ *  \param in 64-byte blocks of input  
+ *  \param blocks number of blocks
 */                                 
-static void sha1_transform1 (struct sha1_ctx *sctx, u32 *state, const u32 *in)
+static void sha1_transform1 (struct sha1_ctx *sctx, const u32 *in, unsigned int blocks)
 {
     int i = 0;
     volatile struct deu_hash_t *hashs = (struct deu_hash_t *) HASH_START;
     unsigned long flag;
+    unsigned int n;
 
-    CRTCL_SECT_HASH_START;
+    while (blocks) {
+        n = min_t(unsigned int, blocks, SHA1_MAX_BLOCKS);
+        blocks -= n;
 
-    SHA_HASH_INIT;
+        CRTCL_SECT_HASH_START;
 
-    /* For context switching purposes, the previous hash output
-     * is loaded back into the output register 
-    */
-    if (sctx->started) {
-        hashs->D1R = *((u32 *) sctx->hash + 0);
-        hashs->D2R = *((u32 *) sctx->hash + 1);
-        hashs->D3R = *((u32 *) sctx->hash + 2);
-        hashs->D4R = *((u32 *) sctx->hash + 3);
-        hashs->D5R = *((u32 *) sctx->hash + 4);
-    }
+        SHA_HASH_INIT;
+
+        /* For context switching purposes, the previous hash output
+         * is loaded back into the output register 
+        */
+        if (sctx->started) {
+            hashs->D1R = *((u32 *) sctx->hash + 0);
+            hashs->D2R = *((u32 *) sctx->hash + 1);
+            hashs->D3R = *((u32 *) sctx->hash + 2);
+            hashs->D4R = *((u32 *) sctx->hash + 3);
+            hashs->D5R = *((u32 *) sctx->hash + 4);
+        }
+
+        /* consecutive blocks continue from the digest left in the
+         * output registers
+        */
+        while (n--) {
+            for (i = 0; i < 16; i++) {
+                hashs->MR = in[i];
+            };
+
+            //wait for processing
+            while (hashs->controlr.BSY) {
+                // this will not take long
+            }
+
+            in += 16;
+        }
+
+        /* For context switching purposes, the output is saved into a 
+         * context struct which can be used later on 
+        */
+        *((u32 *) sctx->hash + 0) = hashs->D1R;
+        *((u32 *) sctx->hash + 1) = hashs->D2R;
+        *((u32 *) sctx->hash + 2) = hashs->D3R;
+        *((u32 *) sctx->hash + 3) = hashs->D4R;
+        *((u32 *) sctx->hash + 4) = hashs->D5R;
 
-    for (i = 0; i < 16; i++) {
-        hashs->MR = in[i];
-    };
+        sctx->started = 1;
 
-    //wait for processing
-    while (hashs->controlr.BSY) {
-        // this will not take long
+        CRTCL_SECT_HASH_END;
     }
-   
-    /* For context switching purposes, the output is saved into a 
-     * context struct which can be used later on 
-    */
-    *((u32 *) sctx->hash + 0) = hashs->D1R;
-    *((u32 *) sctx->hash + 1) = hashs->D2R;
-    *((u32 *) sctx->hash + 2) = hashs->D3R;
-    *((u32 *) sctx->hash + 3) = hashs->D4R;
-    *((u32 *) sctx->hash + 4) = hashs->D5R;
-
-    sctx->started = 1;
-
-    CRTCL_SECT_HASH_END;
 }
 
 /*! \fn static void sha1_init1(struct crypto_tfm *tfm)
@@ -172,9 +187,10 @@ static int sha1_update(struct shash_desc * desc, const u8 *data,
 
     if ((j + len) > 63) {
         memcpy (&sctx->buffer[j], data, (i = 64 - j));
-        sha1_transform1 (sctx, sctx->state, (const u32 *)sctx->buffer);
-        for (; i + 63 < len; i += 64) {
-            sha1_transform1 (sctx, sctx->state, (const u32 *)&data[i]);
+        sha1_transform1 (sctx, (const u32 *)sctx->buffer, 1);
+        if (len - i >= 64) {
+            sha1_transform1 (sctx, (const u32 *)&data[i], (len - i) / 64);
+            i += (len - i) & ~63;
         }
 
         j = 0;
@@ -331,13 +331,13 @@ static int ptm_hard_start_xmit(struct sk_buff *skb, struct net_device *dev)
         dev_kfree_skb_any(skb);
         skb = new_skb;
         byteoff = (unsigned int)skb->data & (DATA_BUFFER_ALIGNMENT - 1);
-        /*  write back to physical memory   */
-        dma_cache_wback((unsigned long)skb->data, skb->len);
     }
 
     /* make the skb unowned */
     skb_orphan(skb);
 
+    /*  the PPE passes TX buffers on to the WAN TX and swap rings, they are
+        freed from there, so the back pointer has to travel with the buffer */
     *(struct sk_buff **)((unsigned int)skb->data - byteoff - sizeof(struct sk_buff *)) = skb;
     /*  write back to physical memory   */
     dma_cache_wback((unsigned long)skb->data - byteoff - sizeof(struct sk_buff *), skb->len + byteoff + sizeof(struct sk_buff *));
@@ -25,6 +25,7 @@
 #include <linux/types.h>
 #include <linux/delay.h>
 #include <linux/firmware.h>
+#include <linux/slab.h>
 
 #include <net/dc_ep.h>
 
@@ -176,6 +177,7 @@ void dc_aca_free_fw_file(struct dc_ep_priv *priv)
 	if (fw_info->fw && !IS_ERR(fw_info->fw))
 		release_firmware(fw_info->fw);
 
+	kfree(fw_info->fw_data);
 	fw_info->fw = NULL;
 	fw_info->fw_data = NULL;
 	fw_info->fw_len = 0;
@@ -416,6 +418,65 @@ done:
 	return ret;
 }
 
+/* Keep the fw sections in the byte order they are downloaded in, so that
+ * a re-init only has to copy them and the firmware file can be released.
+ * Each word lands on the device as wr32(cpu_to_be32(word)) would leave it,
+ * i.e. byte swapped.
+ */
+static int aca_fw_image_build(struct dc_ep_priv *priv)
+{
+	int i, j;
+	u32 *img;
+	size_t size, total = 0;
+	const char *fw_base;
+	struct aca_fw_info *fw_info = to_fw_info(priv);
+	struct aca_fw_dl_addr *fw_dl = to_fw_addr(priv);
+	const char *fw_end = (const char *)fw_info->fw->data + fw_info->fw->size;
+
+	for (i = 0; i < fw_dl->fw_num; i++) {
+		size = fw_dl->fw_addr[i].fw_size;
+		fw_base = fw_dl->fw_addr[i].fw_base;
+
+		if (size % 4) {
+			dev_err(priv->dev,
+				"aca %s fw size is not a multiple of 4\n",
+				fw_id_to_str(fw_dl->fw_addr[i].fw_id));
+			return -EINVAL;
+		}
+
+		if (fw_base > fw_end || size > fw_end - fw_base) {
+			dev_err(priv->dev, "aca %s fw exceeds fw file\n",
+				fw_id_to_str(fw_dl->fw_addr[i].fw_id));
+			return -EINVAL;
+		}
+		total += size;
+	}
+
+	img = kmalloc(total, GFP_KERNEL);
+	if (!img)
+		return -ENOMEM;
+
+	fw_info->fw_data = img;
+	fw_info->fw_len = total;
+
+	for (i = 0; i < fw_dl->fw_num; i++) {
+		size = fw_dl->fw_addr[i].fw_size;
+		fw_base = fw_dl->fw_addr[i].fw_base;
+
+		for (j = 0; j < size; j += 4)
+			img[j / 4] = swab32(*((u32 *)(fw_base + j)));
+
+		fw_dl->fw_addr[i].fw_base = (const char *)img;
+		img += size / 4;
+	}
+
+	/* Everything needed later on is parsed or copied by now */
+	release_firmware(fw_info->fw);
+	fw_info->fw = NULL;
+
+	return 0;
+}
+
 static int aca_fetch_fw_api(struct dc_ep_priv *priv, const char *name)
 {
 	int ret;
@@ -476,7 +537,14 @@ static int aca_fetch_fw_api(struct dc_ep_priv *priv, const char *name)
 	dev_dbg(dev, "section number %d\n",
 		be32_to_cpu(fw_f_hdr->num_section));
 
-	aca_section_parse(priv, fw_data);
+	ret = aca_section_parse(priv, fw_data);
+	if (ret)
+		goto err;
+
+	ret = aca_fw_image_build(priv);
+	if (ret)
+		goto err;
+
 	return 0;
 err:
 	dc_aca_free_fw_file(priv);
@@ -485,45 +553,38 @@ err:
 
 static int aca_fetch_fw(struct dc_ep_priv *priv)
 {
+	/* Parsed on the first init, kept until the device is removed */
+	if (to_fw_info(priv)->fw_data)
+		return 0;
+
 	return aca_fetch_fw_api(priv, ACA_FW_FILE);
 }
 
 static int aca_fw_download(struct dc_ep_priv *priv)
 {
-	int i, j;
-	u32 val;
+	int i;
 	size_t size;
-	u32 id, load_addr;
+	u32 load_addr;
 	const char *fw_base;
 	struct aca_fw_dl_addr *fw_dl = to_fw_addr(priv);
 
 	for (i = 0; i < fw_dl->fw_num; i++) {
-		id = fw_dl->fw_addr[i].fw_id;
 		load_addr = fw_dl->fw_addr[i].fw_load_addr;
 		size = fw_dl->fw_addr[i].fw_size;
 		fw_base = fw_dl->fw_addr[i].fw_base;
 
-		if (size % 4) {
-			dev_err(priv->dev,
-				"aca %s fw size is not a multiple of 4\n",
-				fw_id_to_str(id));
-			return -EINVAL;
-		}
-
-		for (j = 0; j < size; j += 4) {
-			val = *((u32 *)(fw_base + j));
-			wr32(cpu_to_be32(val), load_addr + j);
-		}
+		memcpy_toio(priv->mem + load_addr, fw_base, size);
 		/* Write flush */
 		rd32(load_addr);
 	#ifdef DEBUG
 		{
+		int j;
 		u32 src, dst;
 
 		for (j = 0; j < size; j += 4) {
 			dst = rd32(load_addr + j);
-			src = *((u32 *)(fw_base + j));
-			if (dst != cpu_to_be32(src)) {
+			src = le32_to_cpu(*((u32 *)(fw_base + j)));
+			if (dst != src) {
 				dev_info(priv->dev,
 					"dst 0x%08x != src 0x%08x\n", dst, src);
 				return -EIO;
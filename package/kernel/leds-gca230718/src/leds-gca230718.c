@@ -5,6 +5,8 @@
  * Copyright 2022 Roland Reinl <reinlroland+github@gmail.com>
  *
  * This driver can control RGBW LEDs which are connected to a GCA230718.
+ * Every update sends the brightness of all LEDs, so changes are collected
+ * and sent at most once per frame period.
  */
 
 #include <linux/delay.h>
@@ -16,6 +18,7 @@
 #include <linux/i2c.h>
 #include <linux/mutex.h>
 #include <linux/version.h>
+#include <linux/workqueue.h>
 
 #define GCA230718_MAX_LEDS (4u)
 
@@ -28,6 +31,9 @@
 #define GCA230718_2ND_SEQUENCE_BYTE_1 (0x01u)
 #define GCA230718_3RD_SEQUENCE_BYTE_1 (0x03u)
 
+/* Minimum time between two updates of the LEDs */
+#define GCA230718_FRAME_TIME msecs_to_jiffies(20)
+
 struct gca230718_led {
 	enum led_brightness brightness;
 	struct i2c_client *client;
@@ -36,6 +42,9 @@ struct gca230718_led {
 
 struct gca230718_private {
 	struct mutex lock;
+	struct i2c_client *client;
+	struct delayed_work work;
+	unsigned long last_update;
 	struct gca230718_led leds[GCA230718_MAX_LEDS];
 };
 
@@ -81,8 +90,18 @@ static void gca230718_send_sequence(struct i2c_client *client, u8 byte0,
 	mutex_unlock(&(priv->lock));
 }
 
-static int gca230718_set_brightness(struct led_classdev *led_cdev,
-				    enum led_brightness value)
+static void gca230718_update(struct work_struct *work)
+{
+	struct gca230718_private *priv = container_of(
+		to_delayed_work(work), struct gca230718_private, work);
+
+	gca230718_send_sequence(priv->client, GCA230718_2ND_SEQUENCE_BYTE_1,
+				priv);
+	priv->last_update = jiffies;
+}
+
+static void gca230718_set_brightness(struct led_classdev *led_cdev,
+				     enum led_brightness value)
 {
 	struct gca230718_led *led;
 	struct i2c_client *client;
@@ -92,15 +111,25 @@ static int gca230718_set_brightness(struct led_classdev *led_cdev,
 
 	if (client) {
 		struct gca230718_private *priv;
+		unsigned long next;
 
 		led->brightness = value;
 		priv = i2c_get_clientdata(client);
+		next = priv->last_update + GCA230718_FRAME_TIME;
 
-		gca230718_send_sequence(client, GCA230718_2ND_SEQUENCE_BYTE_1,
-					priv);
+		/* Does nothing if an update is pending already */
+		schedule_delayed_work(&priv->work,
+				      time_before(jiffies, next) ?
+					      next - jiffies : 0);
 	}
+}
 
-	return 0;
+static void gca230718_flush(void *data)
+{
+	struct gca230718_private *priv = data;
+
+	/* Send the final state, e.g. the LEDs turned off on removal */
+	flush_delayed_work(&priv->work);
 }
 
 static int gca230718_probe(struct i2c_client *client)
@@ -120,6 +149,14 @@ static int gca230718_probe(struct i2c_client *client)
 	if (err)
 		return err;
 
+	priv->client = client;
+	INIT_DELAYED_WORK(&priv->work, gca230718_update);
+	priv->last_update = jiffies - GCA230718_FRAME_TIME;
+
+	err = devm_add_action_or_reset(&client->dev, gca230718_flush, priv);
+	if (err)
+		return err;
+
 	i2c_set_clientdata(client, priv);
 
 	struct device_node *ledNode;
@@ -149,8 +186,7 @@ static int gca230718_probe(struct i2c_client *client)
 
 			ledClassDev->brightness = LED_OFF;
 			ledClassDev->max_brightness = LED_FULL;
-			ledClassDev->brightness_set_blocking =
-				gca230718_set_brightness;
+			ledClassDev->brightness_set = gca230718_set_brightness;
 
 			if (devm_led_classdev_register_ext(
 				    &client->dev, ledClassDev, &init_data))
@@ -8,6 +8,9 @@
  * is transferred as 3'b110 and a zero pulse is 3'b100. For this driver to
  * work properly, the SPI frequency should be 2.105MHz~2.85MHz and it needs
  * to transfer all the bytes continuously.
+ *
+ * Every transfer carries the whole chain, so LED changes are collected and
+ * sent at most once per frame period instead of once per change.
  */
 
 #include <linux/led-class-multicolor.h>
@@ -16,13 +19,16 @@
 #include <linux/of_device.h>
 #include <linux/property.h>
 #include <linux/spi/spi.h>
-#include <linux/mutex.h>
+#include <linux/spinlock.h>
 #include <linux/version.h>
+#include <linux/workqueue.h>
 
 #define WS2812B_BYTES_PER_COLOR 3
 #define WS2812B_NUM_COLORS 3
 /* A continuous 0 for 50us+ as the 'reset' signal */
 #define WS2812B_RESET_LEN 18
+/* Minimum time between two updates of the chain */
+#define WS2812B_FRAME_TIME msecs_to_jiffies(20)
 
 struct ws2812b_led {
 	struct led_classdev_mc mc_cdev;
@@ -33,10 +39,14 @@ struct ws2812b_led {
 struct ws2812b_priv {
 	struct led_classdev ldev;
 	struct spi_device *spi;
-	struct mutex mutex;
+	spinlock_t lock;
+	struct delayed_work work;
+	unsigned long last_update;
+	bool dirty;
 	int num_leds;
 	size_t data_len;
 	u8 *data_buf;
+	u8 *tx_buf;
 	struct ws2812b_led leds[];
 };
 
@@ -79,26 +89,59 @@ static void ws2812b_set_byte(struct ws2812b_priv *priv, size_t offset, u8 val)
 	p[2] = l3b[val & 0x7]; /* Bit 2-0 */
 }
 
-static int ws2812b_set(struct led_classdev *cdev,
-		       enum led_brightness brightness)
+static void ws2812b_update(struct work_struct *work)
+{
+	struct ws2812b_priv *priv =
+		container_of(to_delayed_work(work), struct ws2812b_priv, work);
+	int ret;
+
+	spin_lock_irq(&priv->lock);
+	if (!priv->dirty) {
+		spin_unlock_irq(&priv->lock);
+		return;
+	}
+	memcpy(priv->tx_buf, priv->data_buf, priv->data_len);
+	priv->dirty = false;
+	spin_unlock_irq(&priv->lock);
+
+	ret = spi_write(priv->spi, priv->tx_buf, priv->data_len);
+	if (ret)
+		dev_err_ratelimited(&priv->spi->dev, "update failed: %d\n", ret);
+
+	priv->last_update = jiffies;
+}
+
+static void ws2812b_set(struct led_classdev *cdev,
+			enum led_brightness brightness)
 {
 	struct led_classdev_mc *mc_cdev = lcdev_to_mccdev(cdev);
 	struct ws2812b_led *led =
 		container_of(mc_cdev, struct ws2812b_led, mc_cdev);
 	struct ws2812b_priv *priv = dev_get_drvdata(cdev->dev->parent);
-	int ret;
+	unsigned long next = priv->last_update + WS2812B_FRAME_TIME;
+	unsigned long flags;
 	int i;
 
 	led_mc_calc_color_components(mc_cdev, brightness);
 
-	mutex_lock(&priv->mutex);
+	spin_lock_irqsave(&priv->lock, flags);
 	for (i = 0; i < WS2812B_NUM_COLORS; i++)
 		ws2812b_set_byte(priv, led->cascade * WS2812B_NUM_COLORS + i,
 				 led->subled[i].brightness);
-	ret = spi_write(priv->spi, priv->data_buf, priv->data_len);
-	mutex_unlock(&priv->mutex);
+	priv->dirty = true;
+	spin_unlock_irqrestore(&priv->lock, flags);
+
+	/* does nothing if an update is pending already */
+	schedule_delayed_work(&priv->work,
+			      time_before(jiffies, next) ? next - jiffies : 0);
+}
+
+static void ws2812b_flush(void *data)
+{
+	struct ws2812b_priv *priv = data;
 
-	return ret;
+	/* send the final state, e.g. the LEDs turned off on removal */
+	flush_delayed_work(&priv->work);
 }
 
 static int ws2812b_probe(struct spi_device *spi)
@@ -120,16 +163,24 @@ static int ws2812b_probe(struct spi_device *spi)
 	priv->data_buf = devm_kzalloc(dev, priv->data_len, GFP_KERNEL);
 	if (!priv->data_buf)
 		return -ENOMEM;
+	priv->tx_buf = devm_kzalloc(dev, priv->data_len, GFP_KERNEL);
+	if (!priv->tx_buf)
+		return -ENOMEM;
 
 	for (i = 0; i < num_leds * WS2812B_NUM_COLORS; i++)
 		ws2812b_set_byte(priv, i, 0);
 
-	ret = devm_mutex_init(dev, &priv->mutex);
+	spin_lock_init(&priv->lock);
+	INIT_DELAYED_WORK(&priv->work, ws2812b_update);
+	priv->last_update = jiffies - WS2812B_FRAME_TIME;
+
+	ret = devm_add_action_or_reset(dev, ws2812b_flush, priv);
 	if (ret)
 		return ret;
 
 	priv->num_leds = num_leds;
 	priv->spi = spi;
+	spi_set_drvdata(spi, priv);
 
 	device_for_each_child_node(dev, led_node) {
 		struct led_init_data init_data = {
@@ -164,7 +215,7 @@ static int ws2812b_probe(struct spi_device *spi)
 			priv->leds[cur_led].subled;
 		priv->leds[cur_led].mc_cdev.num_colors = WS2812B_NUM_COLORS;
 		priv->leds[cur_led].mc_cdev.led_cdev.max_brightness = 255;
-		priv->leds[cur_led].mc_cdev.led_cdev.brightness_set_blocking = ws2812b_set;
+		priv->leds[cur_led].mc_cdev.led_cdev.brightness_set = ws2812b_set;
 
 		for (i = 0; i < WS2812B_NUM_COLORS; i++) {
 			priv->leds[cur_led].subled[i].color_index = color_idx[i];
@@ -183,8 +234,6 @@ static int ws2812b_probe(struct spi_device *spi)
 		cur_led++;
 	}
 
-	spi_set_drvdata(spi, priv);
-
 	return 0;
 }
 
@@ -806,7 +806,9 @@ define KernelPackage/zram
 	CONFIG_ZSMALLOC \
 	CONFIG_ZRAM \
 	CONFIG_ZRAM_DEBUG=n \
-	CONFIG_ZRAM_WRITEBACK=n \
+	CONFIG_ZRAM_WRITEBACK=$(if $(CONFIG_ZRAM_WRITEBACK),y,n) \
+	CONFIG_ZRAM_MULTI_COMP=$(if $(CONFIG_ZRAM_MULTI_COMP),y,n) \
+	CONFIG_ZRAM_TRACK_ENTRY_ACTIME=$(if $(CONFIG_ZRAM_WRITEBACK)$(CONFIG_ZRAM_MULTI_COMP),y,n) \
 	CONFIG_ZSMALLOC_STAT=n
   FILES:= \
 	$(LINUX_DIR)/mm/zsmalloc.ko \
@@ -845,6 +847,20 @@ define KernelPackage/zram/config
             select PACKAGE_kmod-lib-zstd
 
     endchoice
+
+    config ZRAM_MULTI_COMP
+            bool "Recompression of idle pages"
+            select PACKAGE_kmod-lib-zstd
+            help
+              Allow recompressing pages with a second, slower but stronger
+              algorithm (zram_recomp_algo, e.g. zstd), see
+              /etc/init.d/zram recompress.
+
+    config ZRAM_WRITEBACK
+            bool "Writeback of idle pages to a backing device"
+            help
+              Allow moving idle or incompressible pages to a block device
+              (zram_backing_dev), see /etc/init.d/zram writeback.
   endif
 endef
 
@@ -19,6 +19,9 @@
 #include <linux/netdevice.h>
 #include <linux/rtnetlink.h>
 #include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/u64_stats_sync.h>
+#include <net/sch_generic.h>
 
 #define trelay_log(loglevel, tr, fmt, ...) \
 	printk(loglevel "trelay: %s <-> %s: " fmt "\n", \
@@ -27,30 +30,109 @@
 static LIST_HEAD(trelay_devs);
 static struct dentry *debugfs_dir;
 
+struct trelay_stats {
+	u64_stats_t packets;
+	u64_stats_t bytes;
+	u64_stats_t bypass;
+	u64_stats_t dropped;
+	struct u64_stats_sync syncp;
+};
+
+/* one per direction, used as rx_handler_data of the ingress device */
+struct trelay_port {
+	struct net_device *dev;
+	struct trelay_stats __percpu *stats;
+};
+
 struct trelay {
 	struct list_head list;
 	struct net_device *dev1, *dev2;
+	struct trelay_port port[2];
 	struct dentry *debugfs;
 	int to_remove;
 	char name[];
 };
 
+/*
+ * Frames can skip the qdisc layer if it would not hold them back anyway:
+ * noqueue, or an empty pfifo/pfifo_fast, and nothing hooked into egress.
+ */
+static bool trelay_can_bypass(struct net_device *dev, struct netdev_queue *txq)
+{
+	struct Qdisc *q;
+
+#ifdef CONFIG_NET_XGRESS
+	if (rcu_access_pointer(dev->tcx_egress))
+		return false;
+#endif
+#ifdef CONFIG_NETFILTER_EGRESS
+	if (rcu_access_pointer(dev->nf_hooks_egress))
+		return false;
+#endif
+
+	if (netif_xmit_frozen_or_stopped(txq))
+		return false;
+
+	q = rcu_dereference(txq->qdisc);
+	if (!q->enqueue)
+		return true;
+
+	if (!(q->flags & TCQ_F_CAN_BYPASS))
+		return false;
+
+	if (q->flags & TCQ_F_NOLOCK)
+		return nolock_qdisc_is_empty(q);
+
+	return !qdisc_qlen(q);
+}
+
 rx_handler_result_t trelay_handle_frame(struct sk_buff **pskb)
 {
+	struct trelay_port *port;
+	struct trelay_stats *stats;
+	struct netdev_queue *txq;
 	struct net_device *dev;
 	struct sk_buff *skb = *pskb;
+	unsigned int len;
+	bool bypass;
+	int ret;
 
-	dev = rcu_dereference(skb->dev->rx_handler_data);
-	if (!dev)
+	port = rcu_dereference(skb->dev->rx_handler_data);
+	if (!port)
 		return RX_HANDLER_PASS;
 
 	if (skb->protocol == htons(ETH_P_PAE))
 		return RX_HANDLER_PASS;
 
+	dev = port->dev;
 	skb_push(skb, ETH_HLEN);
 	skb->dev = dev;
 	skb_forward_csum(skb);
-	dev_queue_xmit(skb);
+	len = skb->len;
+
+	/*
+	 * The tx queue follows the recorded rx queue, so multi-queue devices
+	 * keep each flow on its CPU. GRO super packets are passed on as they
+	 * are and only segmented if the egress device can't offload them.
+	 */
+	txq = netdev_core_pick_tx(dev, skb, NULL);
+	bypass = trelay_can_bypass(dev, txq);
+	if (bypass)
+		ret = dev_direct_xmit(skb, skb_get_queue_mapping(skb));
+	else
+		ret = dev_queue_xmit(skb);
+
+	stats = this_cpu_ptr(port->stats);
+	u64_stats_update_begin(&stats->syncp);
+	if (net_xmit_eval(ret)) {
+		u64_stats_inc(&stats->dropped);
+	} else {
+		u64_stats_inc(&stats->packets);
+		u64_stats_add(&stats->bytes, len);
+		if (bypass)
+			u64_stats_inc(&stats->bypass);
+	}
+	u64_stats_update_end(&stats->syncp);
 
 	return RX_HANDLER_CONSUMED;
 }
@@ -61,6 +143,53 @@ static int trelay_open(struct inode *inode, struct file *file)
 	return 0;
 }
 
+static void trelay_free(struct trelay *tr)
+{
+	free_percpu(tr->port[0].stats);
+	free_percpu(tr->port[1].stats);
+	kfree(tr);
+}
+
+static void trelay_stats_show_port(struct seq_file *s, struct net_device *from,
+				   struct trelay_port *port)
+{
+	u64 packets = 0, bytes = 0, bypass = 0, dropped = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		const struct trelay_stats *stats = per_cpu_ptr(port->stats, cpu);
+		u64 p, b, f, d;
+		unsigned int start;
+
+		do {
+			start = u64_stats_fetch_begin(&stats->syncp);
+			p = u64_stats_read(&stats->packets);
+			b = u64_stats_read(&stats->bytes);
+			f = u64_stats_read(&stats->bypass);
+			d = u64_stats_read(&stats->dropped);
+		} while (u64_stats_fetch_retry(&stats->syncp, start));
+
+		packets += p;
+		bytes += b;
+		bypass += f;
+		dropped += d;
+	}
+
+	seq_printf(s, "%s -> %s: packets %llu bytes %llu bypass %llu dropped %llu\n",
+		   from->name, port->dev->name, packets, bytes, bypass, dropped);
+}
+
+static int trelay_stats_show(struct seq_file *s, void *unused)
+{
+	struct trelay *tr = s->private;
+
+	trelay_stats_show_port(s, tr->dev1, &tr->port[0]);
+	trelay_stats_show_port(s, tr->dev2, &tr->port[1]);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(trelay_stats);
+
 static int trelay_do_remove(struct trelay *tr)
 {
 	list_del(&tr->list);
@@ -77,7 +206,7 @@ static int trelay_do_remove(struct trelay *tr)
 
 	trelay_log(KERN_INFO, tr, "stopped");
 
-	kfree(tr);
+	trelay_free(tr);
 
 	return 0;
 }
@@ -156,6 +285,13 @@ static int trelay_do_add(char *name, char *devn1, char *devn2)
 	if (!tr)
 		return -ENOMEM;
 
+	tr->port[0].stats = netdev_alloc_pcpu_stats(struct trelay_stats);
+	tr->port[1].stats = netdev_alloc_pcpu_stats(struct trelay_stats);
+	if (!tr->port[0].stats || !tr->port[1].stats) {
+		trelay_free(tr);
+		return -ENOMEM;
+	}
+
 	rtnl_lock();
 	rcu_read_lock();
 
@@ -171,11 +307,14 @@ static int trelay_do_add(char *name, char *devn1, char *devn2)
 	if (!dev1 || !dev2)
 		goto out;
 
-	ret = netdev_rx_handler_register(dev1, trelay_handle_frame, dev2);
+	tr->port[0].dev = dev2;
+	tr->port[1].dev = dev1;
+
+	ret = netdev_rx_handler_register(dev1, trelay_handle_frame, &tr->port[0]);
 	if (ret < 0)
 		goto out;
 
-	ret = netdev_rx_handler_register(dev2, trelay_handle_frame, dev1);
+	ret = netdev_rx_handler_register(dev2, trelay_handle_frame, &tr->port[1]);
 	if (ret < 0) {
 		netdev_rx_handler_unregister(dev1);
 		goto out;
@@ -193,13 +332,14 @@ static int trelay_do_add(char *name, char *devn1, char *devn2)
 
 	tr->debugfs = debugfs_create_dir(name, debugfs_dir);
 	debugfs_create_file("remove", S_IWUSR, tr->debugfs, tr, &fops_remove);
+	debugfs_create_file("stats", S_IRUSR, tr->debugfs, tr, &trelay_stats_fops);
 	ret = 0;
 
 out:
 	rcu_read_unlock();
 	rtnl_unlock();
 	if (ret < 0)
-		kfree(tr);
+		trelay_free(tr);
 
 	return ret;
 }
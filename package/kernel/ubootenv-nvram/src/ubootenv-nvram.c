@@ -3,6 +3,7 @@
  *   Copyright (C) 2022  Bjørn Mork <bjorn@mork.no>
  */
 
+#include <linux/crc32.h>
 #include <linux/fs.h>
 #include <linux/init.h>
 #include <linux/io.h>
@@ -13,6 +14,7 @@
 #include <linux/of.h>
 #include <linux/of_reserved_mem.h>
 #include <linux/platform_device.h>
+#include <asm/unaligned.h>
 
 #define NAME "ubootenv"
 
@@ -53,6 +55,16 @@ static loff_t ubootenv_llseek(struct file *file, loff_t off, int whence)
 	return fixed_size_llseek(file, off, whence, data->rmem->size);
 }
 
+/* The region is plain memory, tools may update the environment in place */
+static int ubootenv_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct ubootenv_drvdata *data = to_ubootenv_drvdata(file);
+
+	if (!data->env)
+		return -EIO;
+	return vm_iomap_memory(vma, data->rmem->base, data->rmem->size);
+}
+
 /* Faking the minimal mtd ioctl subset required by the fw_env.c */
 static long ubootenv_ioctl(struct file *file, u_int cmd, u_long arg)
 {
@@ -82,15 +94,100 @@ static const struct file_operations ubootenv_fops = {
 	.read           = ubootenv_read,
 	.write          = ubootenv_write,
 	.llseek         = ubootenv_llseek,
+	.mmap           = ubootenv_mmap,
 	.unlocked_ioctl = ubootenv_ioctl,
 };
 
+/*
+ * The environment starts with the CRC32 of the data following it, with a
+ * flags byte in between for a redundant environment. Returns the offset
+ * of the data, or 0 if the CRC does not match either layout.
+ */
+static size_t ubootenv_data_offset(struct ubootenv_drvdata *data, u32 *crc)
+{
+	size_t size = data->rmem->size;
+	u8 *env = data->env;
+
+	*crc = get_unaligned_le32(env);
+	if ((crc32(~0, env + 4, size - 4) ^ ~0) == *crc)
+		return 4;
+	if ((crc32(~0, env + 5, size - 5) ^ ~0) == *crc)
+		return 5;
+	return 0;
+}
+
+/* the stored CRC, to tell whether the environment changed since it was read */
+static ssize_t crc_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct ubootenv_drvdata *data = container_of(dev_get_drvdata(dev),
+						     struct ubootenv_drvdata, misc);
+
+	if (!data->env)
+		return -EIO;
+	return sysfs_emit(buf, "%08x\n", get_unaligned_le32(data->env));
+}
+static DEVICE_ATTR_RO(crc);
+
+static ssize_t valid_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct ubootenv_drvdata *data = container_of(dev_get_drvdata(dev),
+						     struct ubootenv_drvdata, misc);
+	u32 crc;
+
+	if (!data->env)
+		return -EIO;
+	return sysfs_emit(buf, "%d\n", !!ubootenv_data_offset(data, &crc));
+}
+static DEVICE_ATTR_RO(valid);
+
+/* the variables, one per line, as long as they fit into the page */
+static ssize_t env_show(struct device *dev, struct device_attribute *attr, char *buf)
+{
+	struct ubootenv_drvdata *data = container_of(dev_get_drvdata(dev),
+						     struct ubootenv_drvdata, misc);
+	size_t ofs, size, len, ret = 0;
+	const char *env;
+	u32 crc;
+
+	if (!data->env)
+		return -EIO;
+
+	ofs = ubootenv_data_offset(data, &crc);
+	if (!ofs)
+		return -EBADMSG;
+
+	env = data->env;
+	size = data->rmem->size;
+	while (ofs < size && env[ofs]) {
+		len = strnlen(env + ofs, size - ofs);
+		if (ret + len + 1 >= PAGE_SIZE)
+			return -EFBIG;
+
+		memcpy(buf + ret, env + ofs, len);
+		ret += len;
+		buf[ret++] = '\n';
+		ofs += len + 1;
+	}
+
+	return ret;
+}
+static DEVICE_ATTR_RO(env);
+
+static struct attribute *ubootenv_attrs[] = {
+	&dev_attr_crc.attr,
+	&dev_attr_valid.attr,
+	&dev_attr_env.attr,
+	NULL,
+};
+ATTRIBUTE_GROUPS(ubootenv);
+
 /* We can only map a single reserved-memory range */
 static struct ubootenv_drvdata drvdata = {
 	.misc = {
-		.fops  = &ubootenv_fops,
-		.minor = MISC_DYNAMIC_MINOR,
-		.name  = NAME,
+		.fops   = &ubootenv_fops,
+		.minor  = MISC_DYNAMIC_MINOR,
+		.name   = NAME,
+		.groups = ubootenv_groups,
 	},
 };
 
@@ -11,6 +11,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "dsl_cpe_control.h"
@@ -61,6 +62,41 @@
 	if (ioctl(fd, request, &out)) \
 		return;
 
+/* Like the above, but reuse the result while the cache slot is valid */
+#define __IOCTL_CACHED(type, request, slot, max_age, setup) \
+	static type cached_out[2]; \
+	static struct cache_entry cached_entry[2]; \
+	type out; \
+	if (cache_valid(&cached_entry[slot], max_age)) { \
+		out = cached_out[slot]; \
+	} else { \
+		memset(&out, 0, sizeof(type)); \
+		setup; \
+		if (ioctl(fd, request, &out)) \
+			return; \
+		cached_out[slot] = out; \
+		cache_store(&cached_entry[slot]); \
+	}
+
+#define IOCTL_CACHED(type, request, max_age) \
+	__IOCTL_CACHED(type, request, 0, max_age, )
+
+#define IOCTL_DIR_CACHED(type, request, dir, max_age) \
+	__IOCTL_CACHED(type, request, dir == DSL_DOWNSTREAM, max_age, \
+		out.nDirection = dir)
+
+#define IOCTL_DIR_DELT_CACHED(type, request, dir, delt, max_age) \
+	__IOCTL_CACHED(type, request, dir == DSL_DOWNSTREAM, max_age, \
+		out.nDirection = dir; out.nDeltDataType = delt)
+
+/* Data that only changes when the line retrains, e.g. the negotiated mode */
+#define CACHE_LINE		0
+/* Per-tone data that is updated during showtime (SNR, bit allocation) */
+#define CACHE_TONES		60
+
+/* How often subscribers are checked for line state changes, in ms */
+#define LINE_STATE_POLL		1000
+
 typedef enum {
 	ANNEX_UNKNOWN = 0,
 	ANNEX_A,
@@ -144,9 +180,60 @@ enum {
 	RAMODE_MAP_DYNAMIC_SOS,
 };
 
+struct cache_entry {
+	unsigned int gen;
+	time_t time;
+};
+
 static DSL_CPE_ThreadCtrl_t thread;
 static struct ubus_context *ctx;
 static struct blob_buf b;
+static struct ubus_object dsl_object;
+
+/* Kept open, everything runs in the ubus thread */
+static int fd_dsl = -1;
+static int fd_mei = -1;
+
+/* Bumped on every line state change, invalidating all cached ioctls */
+static unsigned int line_gen = 1;
+static DSL_LineStateValue_t line_state_cur;
+static bool line_state_known;
+
+static time_t now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec;
+}
+
+static bool cache_valid(const struct cache_entry *entry, int max_age) {
+	if (entry->gen != line_gen)
+		return false;
+
+	return max_age == CACHE_LINE || now() - entry->time < max_age;
+}
+
+static void cache_store(struct cache_entry *entry) {
+	entry->gen = line_gen;
+	entry->time = now();
+}
+
+static bool open_devices(void) {
+	if (fd_dsl < 0)
+#ifndef INCLUDE_DSL_CPE_API_DANUBE
+		fd_dsl = open(DSL_CPE_DEVICE_NAME "/0", O_RDWR, 0644);
+#else
+		fd_dsl = open(DSL_CPE_DEVICE_NAME, O_RDWR, 0644);
+#endif
+
+#ifdef INCLUDE_DSL_CPE_API_VRX
+	if (fd_mei < 0)
+		fd_mei = open(DSL_CPE_DSL_LOW_DEV "/0", O_RDWR, 0644);
+#endif
+
+	return fd_dsl >= 0;
+}
 
 static inline void m_null() {
 	blobmsg_add_field(&b, BLOBMSG_TYPE_UNSPEC, "", NULL, 0);
@@ -354,7 +441,7 @@ static standard_t get_standard(const uint8_t *xtse) {
 }
 
 static void version_information(int fd) {
-	IOCTL(DSL_VersionInformation_t, DSL_FIO_VERSION_INFORMATION_GET)
+	IOCTL_CACHED(DSL_VersionInformation_t, DSL_FIO_VERSION_INFORMATION_GET, CACHE_LINE)
 
 	m_str("api_version", out.data.DSL_DriverVersionApi);
 	m_str("firmware_version", out.data.DSL_ChipSetFWVersion);
@@ -362,12 +449,10 @@ static void version_information(int fd) {
 	m_str("driver_version", out.data.DSL_DriverVersionMeiBsp);
 }
 
-static void line_state(int fd) {
-	IOCTL(DSL_LineState_t, DSL_FIO_LINE_STATE_GET)
-
+static void line_state(DSL_LineStateValue_t state) {
 	int map = LSTATE_MAP_UNKNOWN;
 	const char *str;
-	switch (out.data.nLineState) {
+	switch (state) {
 	STR_CASE_MAP(DSL_LINESTATE_NOT_INITIALIZED, "Not initialized", LSTATE_MAP_NOT_INITIALIZED)
 	STR_CASE_MAP(DSL_LINESTATE_EXCEPTION, "Exception", LSTATE_MAP_EXCEPTION)
 	STR_CASE(DSL_LINESTATE_NOT_UPDATED, "Not updated")
@@ -418,7 +503,31 @@ static void line_state(int fd) {
 	if (map != LSTATE_MAP_UNKNOWN )
 		m_u32("state_num", map);
 
-	m_bool("up", out.data.nLineState == DSL_LINESTATE_SHOWTIME_TC_SYNC);
+	m_bool("up", state == DSL_LINESTATE_SHOWTIME_TC_SYNC);
+}
+
+/* Must not be called while a reply is being built, notifying uses b */
+static bool line_state_update(int fd) {
+	DSL_LineState_t out;
+
+	memset(&out, 0, sizeof(out));
+	if (ioctl(fd, DSL_FIO_LINE_STATE_GET, &out))
+		return false;
+
+	if (line_state_known && out.data.nLineState == line_state_cur)
+		return true;
+
+	line_gen++;
+	line_state_cur = out.data.nLineState;
+	line_state_known = true;
+
+	if (ctx && dsl_object.has_subscribers) {
+		blob_buf_init(&b, 0);
+		line_state(line_state_cur);
+		ubus_notify(ctx, &dsl_object, "line_state", b.head, -1);
+	}
+
+	return true;
 }
 
 static void pm_channel_counters_showtime(int fd) {
@@ -428,7 +537,7 @@ static void pm_channel_counters_showtime(int fd) {
 }
 
 static void g997_line_inventory(int fd) {
-	IOCTL_DIR(DSL_G997_LineInventory_t, DSL_FIO_G997_LINE_INVENTORY_GET, DSL_DOWNSTREAM)
+	IOCTL_DIR_CACHED(DSL_G997_LineInventory_t, DSL_FIO_G997_LINE_INVENTORY_GET, DSL_DOWNSTREAM, CACHE_LINE)
 
 	m_array("vendor_id", out.data.G994VendorID, DSL_G997_LI_MAXLEN_VENDOR_ID);
 	m_vendor("vendor", out.data.G994VendorID);
@@ -440,14 +549,14 @@ static void g997_line_inventory(int fd) {
 
 static void pilot_tones_status(int fd) {
 #ifndef INCLUDE_DSL_CPE_API_DANUBE
-	IOCTL(DSL_PilotTonesStatus_t, DSL_FIO_PILOT_TONES_STATUS_GET);
+	IOCTL_CACHED(DSL_PilotTonesStatus_t, DSL_FIO_PILOT_TONES_STATUS_GET, CACHE_LINE);
 
 	m_array_u16("pilot_tones", out.data.nPilotTone, out.data.nNumData);
 #endif
 }
 
 static void band_border_status(int fd, DSL_AccessDir_t direction) {
-	IOCTL(DSL_BandBorderStatus_t, DSL_FIO_BAND_BORDER_STATUS_GET);
+	IOCTL_CACHED(DSL_BandBorderStatus_t, DSL_FIO_BAND_BORDER_STATUS_GET, CACHE_LINE);
 
 	void *c, *c2;
 
@@ -464,7 +573,7 @@ static void band_border_status(int fd, DSL_AccessDir_t direction) {
 }
 
 static void g977_get_bit_allocation(int fd, DSL_AccessDir_t direction) {
-	IOCTL_DIR(DSL_G997_BitAllocationNsc_t, DSL_FIO_G997_BIT_ALLOCATION_NSC_GET, direction);
+	IOCTL_DIR_CACHED(DSL_G997_BitAllocationNsc_t, DSL_FIO_G997_BIT_ALLOCATION_NSC_GET, direction, CACHE_TONES);
 
 	// create default value to obtain consistent JSON structure
 	m_u32("groupsize", 1);
@@ -473,7 +582,7 @@ static void g977_get_bit_allocation(int fd, DSL_AccessDir_t direction) {
 }
 
 static void g977_get_snr(int fd, DSL_AccessDir_t direction) {
-	IOCTL_DIR_DELT(DSL_G997_DeltSnr_t, DSL_FIO_G997_DELT_SNR_GET, direction, DSL_DELT_DATA_SHOWTIME);
+	IOCTL_DIR_DELT_CACHED(DSL_G997_DeltSnr_t, DSL_FIO_G997_DELT_SNR_GET, direction, DSL_DELT_DATA_SHOWTIME, CACHE_TONES);
 
 	m_u32("groupsize", out.data.nGroupSize);
 	m_u32("groups", out.data.deltSnr.nNumData);
@@ -491,7 +600,7 @@ static void g977_get_snr(int fd, DSL_AccessDir_t direction) {
 }
 
 static void g977_get_qln(int fd, DSL_AccessDir_t direction) {
-	IOCTL_DIR_DELT(DSL_G997_DeltQln_t, DSL_FIO_G997_DELT_QLN_GET, direction, DSL_DELT_DATA_SHOWTIME);
+	IOCTL_DIR_DELT_CACHED(DSL_G997_DeltQln_t, DSL_FIO_G997_DELT_QLN_GET, direction, DSL_DELT_DATA_SHOWTIME, CACHE_LINE);
 
 	m_u32("groupsize", out.data.nGroupSize);
 	m_u32("groups", out.data.deltQln.nNumData);
@@ -509,7 +618,7 @@ static void g977_get_qln(int fd, DSL_AccessDir_t direction) {
 }
 
 static void g977_get_hlog(int fd, DSL_AccessDir_t direction) {
-	IOCTL_DIR_DELT(DSL_G997_DeltHlog_t, DSL_FIO_G997_DELT_HLOG_GET, direction, DSL_DELT_DATA_SHOWTIME);
+	IOCTL_DIR_DELT_CACHED(DSL_G997_DeltHlog_t, DSL_FIO_G997_DELT_HLOG_GET, direction, DSL_DELT_DATA_SHOWTIME, CACHE_LINE);
 
 	m_u32("groupsize", out.data.nGroupSize);
 	m_u32("groups", out.data.deltHlog.nNumData);
@@ -550,7 +659,7 @@ static void g997_power_management_status(int fd) {
 }
 
 static void g997_xtu_system_enabling(int fd, standard_t *standard) {
-	IOCTL(DSL_G997_XTUSystemEnabling_t, DSL_FIO_G997_XTU_SYSTEM_ENABLING_STATUS_GET)
+	IOCTL_CACHED(DSL_G997_XTUSystemEnabling_t, DSL_FIO_G997_XTU_SYSTEM_ENABLING_STATUS_GET, CACHE_LINE)
 
 	m_array("xtse", out.data.XTSE, DSL_G997_NUM_XTSE_OCTETS);
 
@@ -597,7 +706,7 @@ static void get_vector_status(int fd, vector_t *status) {
 	if (fd < 0)
 		return;
 
-	IOCTL(IOCTL_MEI_dsmStatus_t, FIO_MEI_DSM_STATUS_GET);
+	IOCTL_CACHED(IOCTL_MEI_dsmStatus_t, FIO_MEI_DSM_STATUS_GET, CACHE_LINE);
 
 	switch (out.eVectorStatus) {
 	case e_MEI_VECTOR_STAT_OFF:
@@ -629,7 +738,7 @@ static void vector_erb(int fd) {
 
 static void band_plan_status(int fd, profile_t *profile) {
 #if (INCLUDE_DSL_CPE_API_VDSL_SUPPORT == 1)
-	IOCTL(DSL_BandPlanStatus_t, DSL_FIO_BAND_PLAN_STATUS_GET)
+	IOCTL_CACHED(DSL_BandPlanStatus_t, DSL_FIO_BAND_PLAN_STATUS_GET, CACHE_LINE)
 
 	switch (out.data.nProfile) {
 	case DSL_PROFILE_8A:
@@ -685,7 +794,7 @@ static void band_plan_status(int fd, profile_t *profile) {
 }
 
 static void line_feature_config(int fd, DSL_AccessDir_t direction, bool *retx) {
-	IOCTL_DIR(DSL_LineFeature_t, DSL_FIO_LINE_FEATURE_STATUS_GET, direction)
+	IOCTL_DIR_CACHED(DSL_LineFeature_t, DSL_FIO_LINE_FEATURE_STATUS_GET, direction, CACHE_LINE)
 
 	m_bool("trellis", out.data.bTrellisEnable);
 	m_bool("bitswap", out.data.bBitswapEnable);
@@ -697,7 +806,7 @@ static void line_feature_config(int fd, DSL_AccessDir_t direction, bool *retx) {
 
 static void g997_rate_adaptation_status(int fd, DSL_AccessDir_t direction) {
 #ifndef INCLUDE_DSL_CPE_API_DANUBE
-	IOCTL_DIR(DSL_G997_RateAdaptationStatus_t, DSL_FIO_G997_RATE_ADAPTATION_STATUS_GET, direction);
+	IOCTL_DIR_CACHED(DSL_G997_RateAdaptationStatus_t, DSL_FIO_G997_RATE_ADAPTATION_STATUS_GET, direction, CACHE_LINE);
 
 	int map = RAMODE_MAP_UNKNOWN;
 	const char *str;
@@ -922,14 +1031,12 @@ static int line_statistics(struct ubus_context *ctx, struct ubus_object *obj,
 	int fd;
 	void *c, *c2;
 
-#ifndef INCLUDE_DSL_CPE_API_DANUBE
-	fd = open(DSL_CPE_DEVICE_NAME "/0", O_RDWR, 0644);
-#else
-	fd = open(DSL_CPE_DEVICE_NAME, O_RDWR, 0644);
-#endif
-	if (fd < 0)
+	if (!open_devices())
 		return UBUS_STATUS_UNKNOWN_ERROR;
 
+	fd = fd_dsl;
+	line_state_update(fd);
+
 	blob_buf_init(&b, 0);
 
 	pilot_tones_status(fd);
@@ -981,8 +1088,6 @@ static int line_statistics(struct ubus_context *ctx, struct ubus_object *obj,
 
 	ubus_send_reply(ctx, req, b.head);
 
-	close(fd);
-
 	return 0;
 }
 
@@ -990,31 +1095,24 @@ static int metrics(struct ubus_context *ctx, struct ubus_object *obj,
 		   struct ubus_request_data *req, const char *method,
 		   struct blob_attr *msg)
 {
-	int fd, fd_mei;
+	int fd;
 	void *c, *c2;
 	standard_t standard = STD_UNKNOWN;
 	profile_t profile = PROFILE_UNKNOWN;
 	vector_t vector = VECTOR_UNKNOWN;
 	bool retx_up = false, retx_down = false;
 
-#ifndef INCLUDE_DSL_CPE_API_DANUBE
-	fd = open(DSL_CPE_DEVICE_NAME "/0", O_RDWR, 0644);
-#else
-	fd = open(DSL_CPE_DEVICE_NAME, O_RDWR, 0644);
-#endif
-	if (fd < 0)
+	if (!open_devices())
 		return UBUS_STATUS_UNKNOWN_ERROR;
 
-#ifdef INCLUDE_DSL_CPE_API_VRX
-	fd_mei = open(DSL_CPE_DSL_LOW_DEV "/0", O_RDWR, 0644);
-#else
-	fd_mei = -1;
-#endif
+	fd = fd_dsl;
+	line_state_update(fd);
 
 	blob_buf_init(&b, 0);
 
 	version_information(fd);
-	line_state(fd);
+	if (line_state_known)
+		line_state(line_state_cur);
 	pm_channel_counters_showtime(fd);
 
 	c = blobmsg_open_table(&b, "atu_c");
@@ -1114,10 +1212,6 @@ static int metrics(struct ubus_context *ctx, struct ubus_object *obj,
 
 	ubus_send_reply(ctx, req, b.head);
 
-	if (fd_mei >= 0)
-		close(fd_mei);
-	close(fd);
-
 	return 0;
 }
 
@@ -1136,6 +1230,17 @@ static struct ubus_object dsl_object = {
 	.n_methods = ARRAY_SIZE(dsl_methods),
 };
 
+static void line_state_poll(struct uloop_timeout *t) {
+	if (dsl_object.has_subscribers && open_devices())
+		line_state_update(fd_dsl);
+
+	uloop_timeout_set(t, LINE_STATE_POLL);
+}
+
+static struct uloop_timeout line_state_timer = {
+	.cb = line_state_poll,
+};
+
 static DSL_int_t ubus_main(DSL_CPE_Thread_Params_t *params) {
 	uloop_run();
 	return 0;
@@ -1155,6 +1260,7 @@ void ubus_init() {
 	}
 
 	ubus_add_uloop(ctx);
+	uloop_timeout_set(&line_state_timer, LINE_STATE_POLL);
 
 	DSL_CPE_ThreadInit(&thread, "ubus", ubus_main, DSL_CPE_PIPE_STACK_SIZE, DSL_CPE_PIPE_PRIORITY, 0, 0);
 }
@@ -1167,4 +1273,9 @@ void ubus_deinit() {
 	uloop_done();
 
 	DSL_CPE_ThreadShutdown(&thread, 1000);
+
+	if (fd_mei >= 0)
+		close(fd_mei);
+	if (fd_dsl >= 0)
+		close(fd_dsl);
 }
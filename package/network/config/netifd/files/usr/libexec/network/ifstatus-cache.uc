@@ -0,0 +1,122 @@
+#!/usr/bin/ucode
+'use strict';
+
+// Keeps a copy of the network.interface dump in /var/run/network for the
+// network.sh helpers, so that they do not each have to fetch it over ubus.
+// The copy is removed on every network.interface event and on every
+// notification of the network.interface object (interface.update for
+// address, prefix, route and lease changes), and written again once they
+// have settled. The iface hotplug scripts also remove it before any other
+// script runs, so that none of them reads a copy older than the event:
+//
+// ifstatus.json  the dump on a single line
+// ifstatus.sh    shell variables with the scalar fields of each interface,
+//                __NETWORK_IF_<field>_<interface>, read without a jsonfilter
+
+import * as libubus from 'ubus';
+import * as uloop from 'uloop';
+import { mkdir, readfile, rename, unlink, writefile } from 'fs';
+
+const cache_dir = '/var/run/network';
+const json_file = `${cache_dir}/ifstatus.json`;
+const shell_file = `${cache_dir}/ifstatus.sh`;
+const settle_delay = 100;
+const retry_delay = 1000;
+
+const fields = {
+	known: (iface) => 1,
+	up: (iface) => iface.up ? 1 : 0,
+	proto: (iface) => iface.proto,
+	metric: (iface) => iface.metric,
+	uptime: (iface) => iface.uptime,
+	l3dev: (iface) => iface.l3_device,
+	dev: (iface) => iface.device,
+};
+
+let ubus, timer, sub, sub_timer;
+
+function quote(val)
+{
+	return `'${replace(`${val}`, "'", "'\\''")}'`;
+}
+
+function write_atomic(path, data)
+{
+	if (writefile(`${path}.tmp`, data) == null ||
+	    !rename(`${path}.tmp`, path))
+		unlink(`${path}.tmp`);
+}
+
+function invalidate()
+{
+	unlink(shell_file);
+	unlink(json_file);
+}
+
+function refresh()
+{
+	let dump = ubus.call('network.interface', 'dump');
+	let names = [];
+
+	if (type(dump?.interface) != 'array') {
+		timer.set(retry_delay);
+		return;
+	}
+
+	let lines = [
+		`__NETWORK_IF_TIME=${int(readfile('/proc/uptime'))}`
+	];
+
+	for (let iface in dump.interface) {
+		if (!match(iface.interface, /^[A-Za-z0-9_]+$/))
+			continue;
+
+		push(names, iface.interface);
+		for (let name, get in fields) {
+			let val = get(iface);
+
+			if (val != null)
+				push(lines, `__NETWORK_IF_${name}_${iface.interface}=${quote(val)}`);
+		}
+	}
+	push(lines, `__NETWORK_IF_LIST=${quote(join(' ', names))}`);
+
+	write_atomic(json_file, sprintf('%J\n', dump));
+	write_atomic(shell_file, join('\n', lines) + '\n');
+}
+
+function changed()
+{
+	invalidate();
+	timer.set(settle_delay);
+}
+
+function subscribe()
+{
+	if (!sub.subscribe('network.interface')) {
+		sub_timer.set(retry_delay);
+		return;
+	}
+
+	changed();
+}
+
+uloop.init();
+
+ubus = libubus.connect();
+if (!ubus) {
+	warn('Failed to connect to ubus\n');
+	exit(1);
+}
+
+mkdir(cache_dir);
+timer = uloop.timer(0, refresh);
+sub_timer = uloop.timer(0, subscribe);
+
+ubus.listener('network.interface', changed);
+
+// netifd drops the subscription when it restarts
+sub = ubus.subscriber(changed, () => sub_timer.set(retry_delay));
+
+uloop.run();
+invalidate();
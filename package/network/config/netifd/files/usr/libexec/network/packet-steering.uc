@@ -11,6 +11,12 @@ let disable;
 let cpus;
 let all_cpus;
 let local_flows = 0;
+let interval = 0;
+
+// resident mode: minimum gain in CPU share for a rebalance, and the CPU
+// share below which the current plan is left alone
+let rebalance_gain = 0.15;
+let rebalance_busy = 0.5;
 
 while (length(ARGV) > 0) {
 	let arg = shift(ARGV);
@@ -30,6 +36,9 @@ while (length(ARGV) > 0) {
 	case '-l':
 		local_flows = +shift(ARGV);
 		break;
+	case '-i':
+		interval = +shift(ARGV);
+		break;
 	}
 }
 
@@ -43,48 +52,107 @@ function task_name(pid)
 	return trim(split(line, "\t", 2)[1]);
 }
 
+let task_cpus = {};
+let written_vals = {};
+
 function set_task_cpu(pid, cpu) {
 	if (disable)
 		cpu = join(",", map(cpus, (cpu) => cpu.id));
+	if (task_cpus[pid] == `${cpu}`)
+		return;
 	let name = task_name(pid);
 	if (!name)
 		return;
+	task_cpus[pid] = `${cpu}`;
 	if (debug || do_nothing)
 		warn(`taskset -p -c ${cpu} ${name}\n`);
 	if (!do_nothing)
 		system(`taskset -p -c ${cpu} ${pid}`);
 }
 
+// cpumask in the kernel's format, comma separated 32 bit words
 function cpu_mask(cpu)
 {
-	let mask;
-	if (cpu < 0)
-		mask = (1 << length(cpus)) - 1;
-	else
-		mask = (1 << int(cpu));
-	return sprintf("%x", mask);
+	let ids = (cpu < 0) ? map(cpus, (cpu) => cpu.id) : [ int(cpu) ];
+	let words = [ 0 ];
+	for (let id in ids) {
+		while (length(words) <= id >> 5)
+			push(words, 0);
+		words[id >> 5] |= 1 << (id & 31);
+	}
+	return join(",", map(reverse(words), (word) => sprintf("%08x", word)));
+}
+
+function write_value(path, val) {
+	if (written_vals[path] == `${val}`)
+		return;
+	written_vals[path] = `${val}`;
+	if (debug || do_nothing)
+		warn(`echo ${val} > ${path}\n`);
+	if (!do_nothing)
+		writefile(path, `${val}`);
 }
 
-function set_netdev_cpu(dev, cpu) {
+function set_netdev_cpu(dev, cpu, no_rps) {
 	let queues = glob(`/sys/class/net/${dev}/queues/rx-*/rps_cpus`);
 	let val = cpu_mask(cpu);
-	if (disable)
+	if (disable || no_rps)
 		val = 0;
-	for (let queue in queues) {
-		if (debug || do_nothing)
-			warn(`echo ${val} > ${queue}\n`);
-		if (!do_nothing)
-			writefile(queue, `${val}`);
-	}
+	for (let queue in queues)
+		write_value(queue, val);
 	queues = glob(`/sys/class/net/${dev}/queues/rx-*/rps_flow_cnt`);
-	for (let queue in queues) {
-		if (debug || do_nothing)
-			warn(`echo ${local_flows} > ${queue}\n`);
-		if (!do_nothing)
-			writefile(queue, `${local_flows}`);
+	for (let queue in queues)
+		write_value(queue, local_flows);
+}
+
+function set_irq_cpu(irq, cpu) {
+	write_value(`/proc/irq/${irq}/smp_affinity`, cpu_mask(disable ? -1 : cpu));
+}
+
+// send from queue n on the CPU handling the interrupt of queue n
+function set_netdev_xps(dev, irq_cpus) {
+	for (let queue in glob(`/sys/class/net/${dev}/queues/tx-*/xps_cpus`)) {
+		let n = int(match(queue, /tx-(\d+)/)[1]);
+		write_value(queue, disable ? 0 : cpu_mask(irq_cpus[n % length(irq_cpus)]));
 	}
 }
 
+function netdev_rx_queues(dev) {
+	return length(glob(`/sys/class/net/${dev}/queues/rx-*`));
+}
+
+let proc_irqs;
+
+function read_proc_irqs() {
+	proc_irqs = [];
+	for (let line in split(readfile("/proc/interrupts") ?? "", "\n")) {
+		let m = match(line, /^ *(\d+):.* ([^ ]+)$/);
+		if (m)
+			push(proc_irqs, { irq: int(m[1]), name: m[2] });
+	}
+}
+
+// hardware interrupts of a device, in queue order if there are several
+function device_irqs(pdev) {
+	let irqs = map(glob(`${pdev.path}/msi_irqs/*`), (path) => int(basename(path)));
+
+	if (!length(irqs)) {
+		let devname = basename(pdev.path);
+		for (let entry in proc_irqs)
+			if (entry.name == devname ||
+			    length(filter(pdev.netdev, (dev) =>
+				    entry.name == dev || index(entry.name, `${dev}-`) == 0)))
+				push(irqs, entry.irq);
+	}
+
+	if (!length(irqs))
+		for (let entry in proc_irqs)
+			if (entry.name == pdev.driver)
+				push(irqs, entry.irq);
+
+	return sort(irqs, (a, b) => a - b);
+}
+
 function task_device_match(name, device)
 {
 	let napi_match = match(name, /napi\/([^-+])-\d+/);
@@ -124,6 +192,12 @@ function cpu_add_weight(cpu_id, weight)
 	}
 }
 
+function reset_cpu_load()
+{
+	for (let cpu in cpus)
+		cpu.load = 0.0;
+}
+
 function get_next_cpu(weight, prev_cpu)
 {
 	if (disable)
@@ -140,62 +214,91 @@ function get_next_cpu(weight, prev_cpu)
 	return cpu;
 }
 
-let phys_devs = {};
-let netdev_phys = {};
-let netdevs = map(glob("/sys/class/net/*"), (dev) => basename(dev));
+let phys_devs;
+let netdevs;
 
-for (let dev in netdevs) {
-	let pdev_path = realpath(`/sys/class/net/${dev}/device`);
-	if (!pdev_path)
-		continue;
+function scan_devices() {
+	phys_devs = {};
+	netdevs = map(glob("/sys/class/net/*"), (dev) => basename(dev));
 
-	if (length(glob(`/sys/class/net/${dev}/lower_*`)) > 0)
-		continue;
+	for (let dev in netdevs) {
+		let pdev_path = realpath(`/sys/class/net/${dev}/device`);
+		if (!pdev_path)
+			continue;
 
-	let pdev = phys_devs[pdev_path];
-	if (!pdev) {
-		pdev = phys_devs[pdev_path] = {
-			path: pdev_path,
-			driver: basename(readlink(`${pdev_path}/driver`)),
-			netdev: [],
-			phy: [],
-			tasks: [],
-		};
-	}
+		if (length(glob(`/sys/class/net/${dev}/lower_*`)) > 0)
+			continue;
 
-	let phyidx = trim(readfile(`/sys/class/net/${dev}/phy80211/index`));
-	if (phyidx != null) {
-		let phy = `phy${phyidx}`;
-		if (index(pdev.phy, phy) < 0)
-			push(pdev.phy, phy);
-	}
+		let pdev = phys_devs[pdev_path];
+		if (!pdev) {
+			pdev = phys_devs[pdev_path] = {
+				path: pdev_path,
+				driver: basename(readlink(`${pdev_path}/driver`)),
+				netdev: [],
+				phy: [],
+				tasks: [],
+			};
+		}
 
-	push(pdev.netdev, dev);
-	netdev_phys[dev] = pdev;
-}
+		let phyidx = trim(readfile(`/sys/class/net/${dev}/phy80211/index`));
+		if (phyidx != null) {
+			let phy = `phy${phyidx}`;
+			if (index(pdev.phy, phy) < 0)
+				push(pdev.phy, phy);
+		}
 
-for (let path in glob("/proc/*/exe")) {
-	readlink(path);
-	if (error() != "No such file or directory")
-		continue;
+		push(pdev.netdev, dev);
+		pdev.rx_queues = max(pdev.rx_queues ?? 0, netdev_rx_queues(dev));
+	}
 
-	let pid = basename(dirname(path));
-	let name = task_name(pid);
-	for (let devname in phys_devs) {
-		let dev = phys_devs[devname];
-		if (!task_device_match(name, dev))
+	read_proc_irqs();
+	for (let devname, pdev in phys_devs)
+		pdev.irqs = device_irqs(pdev);
+
+	for (let path in glob("/proc/*/exe")) {
+		readlink(path);
+		if (error() != "No such file or directory")
 			continue;
 
-		push(dev.tasks, pid);
-		break;
+		let pid = basename(dirname(path));
+		let name = task_name(pid);
+		for (let devname in phys_devs) {
+			let dev = phys_devs[devname];
+			if (!task_device_match(name, dev))
+				continue;
+
+			push(dev.tasks, pid);
+			break;
+		}
 	}
 }
 
-function assign_dev_cpu(dev) {
-	if (length(dev.tasks) > 0) {
-		let cpu = dev.napi_cpu = get_next_cpu(napi_weight);
+function assign_dev_cpu(dev, napi_load, rx_load) {
+	if (dev.rx_queues > 1 && length(dev.irqs) > 1) {
+		// multi-queue hardware: spread the queue interrupts and their
+		// NAPI threads, the hardware already distributes the flows
+		let weight = (napi_load ?? napi_weight) / length(dev.irqs);
+		let irq_cpus = map(dev.irqs, (irq) => get_next_cpu(weight));
+		for (let i, irq in dev.irqs)
+			set_irq_cpu(irq, irq_cpus[i]);
+		for (let i, task in dev.tasks)
+			set_task_cpu(task, irq_cpus[i % length(irq_cpus)]);
+		dev.napi_cpu = irq_cpus[0];
+		dev.rx_cpu = null;
+		for (let netdev in dev.netdev) {
+			set_netdev_cpu(netdev, 0, true);
+			set_netdev_xps(netdev, irq_cpus);
+		}
+		return;
+	}
+
+	if (length(dev.tasks) > 0 || length(dev.irqs) > 0) {
+		// without threads, NAPI runs on the CPU taking the interrupt
+		let cpu = dev.napi_cpu = get_next_cpu(napi_load ?? napi_weight);
 		for (let task in dev.tasks)
 			set_task_cpu(task, cpu);
+		for (let irq in dev.irqs)
+			set_irq_cpu(irq, cpu);
 	}
 
 	if (length(dev.netdev) > 0) {
@@ -203,34 +306,197 @@ function assign_dev_cpu(dev) {
 		if (all_cpus)
 			cpu = -1;
 		else
-			cpu = get_next_cpu(rx_weight, dev.napi_cpu);
+			cpu = get_next_cpu(rx_load ?? rx_weight, dev.napi_cpu);
 		dev.rx_cpu = cpu;
 		for (let netdev in dev.netdev)
 			set_netdev_cpu(netdev, cpu);
 	}
 }
 
-// Assign ethernet devices first
-for (let devname in phys_devs) {
-	let dev = phys_devs[devname];
-	if (!length(dev.phy))
-		assign_dev_cpu(dev);
-}
+function assign_static() {
+	// Assign ethernet devices first
+	for (let devname in phys_devs) {
+		let dev = phys_devs[devname];
+		if (!length(dev.phy))
+			assign_dev_cpu(dev);
+	}
 
-// Add bias to avoid assigning other tasks to CPUs with ethernet NAPI
-for (let devname in phys_devs) {
-	let dev = phys_devs[devname];
-	if (!length(dev.tasks) || dev.napi_cpu == null)
-		continue;
-	cpu_add_weight(dev.napi_cpu, eth_bias);
-}
+	// Add bias to avoid assigning other tasks to CPUs with ethernet NAPI
+	for (let devname in phys_devs) {
+		let dev = phys_devs[devname];
+		if (dev.napi_cpu == null)
+			continue;
+		cpu_add_weight(dev.napi_cpu, eth_bias);
+	}
 
-// Assign WLAN devices
-for (let devname in phys_devs) {
-	let dev = phys_devs[devname];
-	if (length(dev.phy) > 0)
-		assign_dev_cpu(dev);
+	// Assign WLAN devices
+	for (let devname in phys_devs) {
+		let dev = phys_devs[devname];
+		if (length(dev.phy) > 0)
+			assign_dev_cpu(dev);
+	}
 }
 
+scan_devices();
+assign_static();
+
 if (debug > 1)
 	warn(sprintf("devices: %.J\ncpus: %.J\n", phys_devs, cpus));
+
+if (disable || interval <= 0)
+	exit(0);
+
+/*
+ * Resident mode: every interval, measure the CPU time of the NAPI threads
+ * of each device and the softirq time of each CPU, which is attributed to
+ * the devices steering their RPS work there by their share of the received
+ * packets. The devices are then redistributed by their measured load,
+ * heaviest first, but only if that relieves the busiest CPU noticeably.
+ */
+const clk_tck = 100;
+
+function task_ticks(pid)
+{
+	let stat = readfile(`/proc/${pid}/stat`);
+	if (!stat)
+		return 0;
+	// skip past the command name, it may contain spaces
+	let fields = split(substr(stat, rindex(stat, ")") + 2), " ");
+	return int(fields[11]) + int(fields[12]);
+}
+
+function cpu_softirq_ticks()
+{
+	let ticks = {};
+	for (let line in split(readfile("/proc/stat"), "\n")) {
+		let m = match(line, /^cpu(\d+) +(\d+ +){6}(\d+)/);
+		if (m)
+			ticks[m[1]] = int(m[3]);
+	}
+	return ticks;
+}
+
+function netdev_packets(netdev)
+{
+	return int(readfile(`/sys/class/net/${netdev}/statistics/rx_packets`));
+}
+
+function sample()
+{
+	let s = { softirq: cpu_softirq_ticks(), devs: {} };
+	for (let devname, dev in phys_devs) {
+		let napi = 0, packets = 0;
+		for (let task in dev.tasks)
+			napi += task_ticks(task);
+		for (let netdev in dev.netdev)
+			packets += netdev_packets(netdev);
+		s.devs[devname] = { napi, packets };
+	}
+	return s;
+}
+
+function measure(prev, cur)
+{
+	let elapsed = interval * clk_tck;
+	let cpu_packets = {};
+	let loads = {};
+
+	for (let devname, dev in phys_devs) {
+		let p = prev.devs[devname], c = cur.devs[devname];
+		if (!p || !c)
+			continue;
+		loads[devname] = {
+			napi: max(c.napi - p.napi, 0) / elapsed,
+			packets: max(c.packets - p.packets, 0),
+		};
+		if (dev.rx_cpu != null && dev.rx_cpu >= 0)
+			cpu_packets[dev.rx_cpu] = (cpu_packets[dev.rx_cpu] ?? 0) + loads[devname].packets;
+	}
+
+	for (let devname, dev in phys_devs) {
+		let load = loads[devname];
+		if (!load)
+			continue;
+		let cpu = dev.rx_cpu;
+		load.rx = 0.0;
+		if (cpu == null || cpu < 0 || !cpu_packets[cpu])
+			continue;
+		let softirq = max(cur.softirq[cpu] - prev.softirq[cpu], 0) / elapsed;
+		load.rx = softirq * load.packets / cpu_packets[cpu];
+	}
+
+	return loads;
+}
+
+function current_max_load(loads)
+{
+	reset_cpu_load();
+	for (let devname, dev in phys_devs) {
+		let load = loads[devname];
+		if (!load)
+			continue;
+		if (dev.napi_cpu != null)
+			cpu_add_weight(dev.napi_cpu, load.napi);
+		if (dev.rx_cpu != null && dev.rx_cpu >= 0)
+			cpu_add_weight(dev.rx_cpu, load.rx);
+	}
+	return max(...map(cpus, (cpu) => cpu.load));
+}
+
+function planned_max_load(loads)
+{
+	let devnames = sort(keys(loads), (a, b) =>
+		(loads[b].napi + loads[b].rx) - (loads[a].napi + loads[a].rx));
+
+	// dry run of the greedy assignment
+	reset_cpu_load();
+	for (let devname in devnames) {
+		let load = loads[devname], dev = phys_devs[devname];
+		let napi_cpu = length(dev.tasks) ? get_next_cpu(load.napi) : null;
+		if (!all_cpus)
+			get_next_cpu(load.rx, napi_cpu);
+	}
+	return { devnames, max: max(...map(cpus, (cpu) => cpu.load)) };
+}
+
+function rebalance(loads)
+{
+	let cur = current_max_load(loads);
+	if (cur < rebalance_busy)
+		return;
+
+	let plan = planned_max_load(loads);
+	if (cur - plan.max < rebalance_gain)
+		return;
+
+	if (debug)
+		warn(sprintf("rebalance: busiest cpu %.2f -> %.2f\n", cur, plan.max));
+
+	reset_cpu_load();
+	for (let devname in plan.devnames)
+		assign_dev_cpu(phys_devs[devname], loads[devname].napi, loads[devname].rx);
+}
+
+let rescan = false;
+signal("HUP", () => { rescan = true; });
+
+let prev = sample();
+while (true) {
+	sleep(interval * 1000);
+
+	let cur_netdevs = map(glob("/sys/class/net/*"), (dev) => basename(dev));
+	if (rescan || join(" ", cur_netdevs) != join(" ", netdevs)) {
+		rescan = false;
+		task_cpus = {};
+		written_vals = {};
+		reset_cpu_load();
+		scan_devices();
+		assign_static();
+		prev = sample();
+		continue;
+	}
+
+	let cur = sample();
+	rebalance(measure(prev, cur));
+	prev = cur;
+}
@@ -276,6 +276,22 @@ tcrules() {
 		-f $_dir/tcrules.awk
 }
 
+# Classes are replaced in place, so that reloading the config does not
+# drop the queues. Remove the ones that are not configured anymore.
+remove_classes() {
+	local dev="$1"
+	local keep="$2"
+
+	cat <<EOF
+for c in \$(tc class show dev $dev | sed -n -e 's/^class hfsc 1:\\([0-9]*\\)0 .*/\\1/p'); do
+	case " $keep " in *" \$c "*) continue;; esac
+	tc filter del dev $dev parent 1: prio \$((\$c * 2)) >&- 2>&-
+	tc filter del dev $dev parent 1: prio \$((\$c * 2 + 1)) >&- 2>&-
+	tc class del dev $dev classid 1:\${c}0 >&- 2>&-
+done
+EOF
+}
+
 start_interface() {
 	local iface="$1"
 	local num_ifb="$2"
@@ -313,6 +329,7 @@ start_interface() {
 			*) continue;;
 		esac
 		cstr=
+		keep=
 		for class in $classes; do
 			cls_var pktsize "$class" packetsize $dir 1500
 			cls_var pktdelay "$class" packetdelay $dir 0
@@ -323,13 +340,16 @@ start_interface() {
 			cls_var filter "$class" filter $dir ""
 			config_get classnr "$class" classnr
 			append cstr "$classnr:$prio:$avgrate:$pktsize:$pktdelay:$maxrate:$qdisc:$filter" "$N"
+			append keep "$classnr"
 		done
 		append ${prefix}q "$(tcrules)" "$N"
+		append ${prefix}q "$(remove_classes "$dev" "$keep")" "$N"
+		append QOS_DEVICES "$dev"
 		export dev_${dir}="ip link add ${dev} type ifb >&- 2>&-
 ip link set $dev up >&- 2>&-
-tc qdisc del dev $dev root >&- 2>&-
-tc qdisc add dev $dev root handle 1: hfsc default ${class_default}0
-tc class add dev $dev parent 1: classid 1:1 hfsc sc rate ${rate}kbit ul rate ${rate}kbit"
+tc qdisc replace dev $dev root handle 1: hfsc default ${class_default}0
+tc filter del dev $dev parent 1: prio 10 >&- 2>&-
+tc class replace dev $dev parent 1: classid 1:1 hfsc sc rate ${rate}kbit ul rate ${rate}kbit"
 	done
 	[ -n "$download" ] && {
 		add_insmod cls_u32
@@ -339,13 +359,17 @@ tc class add dev $dev parent 1: classid 1:1 hfsc sc rate ${rate}kbit ul rate ${r
 		add_insmod sch_ingress
 	}
 	if [ -n "$halfduplex" ]; then
-		export dev_up="tc qdisc del dev $device root >&- 2>&-
-tc qdisc add dev $device root handle 1: hfsc
-tc filter add dev $device parent 1: prio 10 u32 match u32 0 0 flowid 1:1 action mirred egress redirect dev ifb$ifbdev"
+		append QOS_DEVICES "$device"
+		export dev_up="tc qdisc del dev $device ingress >&- 2>&-
+tc qdisc replace dev $device root handle 1: hfsc
+tc filter replace dev $device parent 1: prio 10 handle 800::800 u32 match u32 0 0 flowid 1:1 action mirred egress redirect dev ifb$ifbdev
+$(remove_classes "$device" "")
+tc class del dev $device classid 1:1 >&- 2>&-"
 	elif [ -n "$download" ]; then
-		append dev_${dir} "tc qdisc del dev $device ingress >&- 2>&-
-tc qdisc add dev $device ingress
-tc filter add dev $device parent ffff: prio 1 u32 match u32 0 0 flowid 1:1 action connmark action mirred egress redirect dev ifb$ifbdev" "$N"
+		append dev_${dir} "tc qdisc replace dev $device ingress
+tc filter replace dev $device parent ffff: prio 1 handle 800::800 u32 match u32 0 0 flowid 1:1 action connmark action mirred egress redirect dev ifb$ifbdev" "$N"
+	else
+		append dev_up "tc qdisc del dev $device ingress >&- 2>&-" "$N"
 	fi
 	add_insmod cls_fw
 	add_insmod sch_hfsc
@@ -369,6 +393,17 @@ start_interfaces() {
 	done
 }
 
+# Remove QoS from the devices that were set up by an earlier config
+stop_interfaces() {
+	cat <<EOF
+for dev in \$(tc qdisc show | grep -E '(hfsc|ingress)' | awk '{print \$5}' | sort -u); do
+	case " $QOS_DEVICES " in *" \$dev "*) continue;; esac
+	tc qdisc del dev "\$dev" ingress >&- 2>&-
+	tc qdisc del dev "\$dev" root >&- 2>&-
+done
+EOF
+}
+
 add_rules() {
 	local var="$1"
 	local rules="$2"
@@ -521,6 +556,7 @@ done
 case "$1" in
 	all)
 		start_interfaces "$C"
+		stop_interfaces
 		start_firewall
 	;;
 	interface)
@@ -68,7 +68,7 @@ END {
 
 	# main qdisc
 	for (i = 1; i <= n; i++) {
-		printf "tc class add dev "device" parent 1:1 classid 1:"class[i]"0 hfsc"
+		printf "tc class replace dev "device" parent 1:1 classid 1:"class[i]"0 hfsc"
 		if (rtm1[i] > 0) {
 			printf " rt m1 " int(rtm1[i]) "kbit d " int(d[i] * 1000) "us m2 " int(rtm2[i])"kbit"
 		}
@@ -79,12 +79,12 @@ END {
 	# leaf qdisc
 	avpkt = 1200
 	for (i = 1; i <= n; i++) {
-		print "tc qdisc add dev "device" parent 1:"class[i]"0 handle "class[i]"00: fq_codel limit 800 quantum 300 noecn"
+		print "tc qdisc replace dev "device" parent 1:"class[i]"0 handle "class[i]"00: fq_codel limit 800 quantum 300 noecn"
 	}
 
 	# filter rule
 	for (i = 1; i <= n; i++) {
-		filter_cmd = "tc filter add dev "device" parent 1: prio %d handle %s fw flowid 1:%d0\n";
+		filter_cmd = "tc filter replace dev "device" parent 1: prio %d handle %s fw flowid 1:%d0\n";
 		if (direction == "up") {
 			filter_1 = sprintf("0x%x0/0xf0", class[i])
 			filter_2 = sprintf("0x0%x/0x0f", class[i])
@@ -98,7 +98,7 @@ END {
 
 		filterc=1
 		if (filter[i] != "") {
-			print " tc filter add dev "device" parent "class[i]"00: handle "filterc"0 "filter[i]
+			print " tc filter replace dev "device" parent "class[i]"00: handle "filterc"0 "filter[i]
 			filterc=filterc+1
 		}
 	}
@@ -63,6 +63,9 @@ print_attrs(const struct switch_attr *attr)
 			case SWITCH_TYPE_NOVAL:
 				type = "none";
 				break;
+			case SWITCH_TYPE_ARL:
+				type = "arl";
+				break;
 			default:
 				type = "unknown";
 				break;
@@ -114,6 +117,9 @@ free_attr_val(const struct switch_attr *attr, const struct switch_val *val)
 	case SWITCH_TYPE_LINK:
 		free(val->value.link);
 		break;
+	case SWITCH_TYPE_ARL:
+		free(val->value.arl);
+		break;
 	default:
 		break;
 	}
@@ -155,6 +161,20 @@ print_attr_val(const struct switch_attr *attr, const struct switch_val *val)
 		else
 			printf("port:%d link:down", val->port_vlan);
 		break;
+	case SWITCH_TYPE_ARL:
+		for (i = 0; i < val->len; i++) {
+			struct switch_arl_entry *arl = &val->value.arl[i];
+			int j;
+
+			printf("%sMAC %02x:%02x:%02x:%02x:%02x:%02x ports:",
+				i ? "\n" : "",
+				arl->mac[0], arl->mac[1], arl->mac[2],
+				arl->mac[3], arl->mac[4], arl->mac[5]);
+			for (j = 0; j < 32; j++)
+				if (arl->portmap & (1U << j))
+					printf(" %d", j);
+		}
+		break;
 	default:
 		printf("?unknown-type?");
 	}
@@ -61,6 +61,11 @@ static struct nla_policy link_policy[SWITCH_LINK_ATTR_MAX] = {
 	[SWITCH_LINK_FLAG_EEE_1000BASET] = { .type = NLA_FLAG },
 };
 
+static struct nla_policy arl_policy[SWITCH_ARL_ATTR_MAX] = {
+	[SWITCH_ARL_MAC] = { .minlen = 6 },
+	[SWITCH_ARL_PORTMAP] = { .type = NLA_U32 },
+};
+
 static inline void *
 swlib_alloc(size_t size)
 {
@@ -150,12 +155,10 @@ nla_put_failure:
 }
 
 static int
-send_attr(struct nl_msg *msg, void *arg)
+put_attr(struct nl_msg *msg, struct switch_val *val)
 {
-	struct switch_val *val = arg;
 	struct switch_attr *attr = val->attr;
 
-	NLA_PUT_U32(msg, SWITCH_ATTR_ID, attr->dev->id);
 	NLA_PUT_U32(msg, SWITCH_ATTR_OP_ID, attr->id);
 	switch(attr->atype) {
 	case SWLIB_ATTR_GROUP_PORT:
@@ -174,6 +177,19 @@ nla_put_failure:
 	return -1;
 }
 
+static int
+send_attr(struct nl_msg *msg, void *arg)
+{
+	struct switch_val *val = arg;
+
+	NLA_PUT_U32(msg, SWITCH_ATTR_ID, val->attr->dev->id);
+
+	return put_attr(msg, val);
+
+nla_put_failure:
+	return -1;
+}
+
 static int
 store_port_val(struct nl_msg *msg, struct nlattr *nla, struct switch_val *val)
 {
@@ -243,6 +259,48 @@ out:
 	return err;
 }
 
+/* called once for every part of a multipart reply */
+static int
+store_arl_val(struct nl_msg *msg, struct nlattr *nla, struct switch_val *val)
+{
+	struct switch_arl_entry *arl;
+	struct nlattr *p;
+	int err = 0;
+	int remaining;
+	int n = 0;
+
+	nla_for_each_nested(p, nla, remaining)
+		n++;
+
+	if (!n)
+		goto out;
+
+	arl = realloc(val->value.arl, sizeof(*arl) * (val->len + n));
+	if (!arl)
+		return -ENOMEM;
+	val->value.arl = arl;
+
+	nla_for_each_nested(p, nla, remaining) {
+		struct nlattr *tb[SWITCH_ARL_ATTR_MAX+1];
+
+		err = nla_parse_nested(tb, SWITCH_ARL_ATTR_MAX, p, arl_policy);
+		if (err < 0)
+			goto out;
+
+		if (!tb[SWITCH_ARL_MAC] || !tb[SWITCH_ARL_PORTMAP])
+			continue;
+
+		arl = &val->value.arl[val->len];
+		memcpy(arl->mac, nla_data(tb[SWITCH_ARL_MAC]), sizeof(arl->mac));
+		arl->portmap = nla_get_u32(tb[SWITCH_ARL_PORTMAP]);
+
+		val->len++;
+	}
+
+out:
+	return err;
+}
+
 static int
 store_val(struct nl_msg *msg, void *arg)
 {
@@ -265,6 +323,8 @@ store_val(struct nl_msg *msg, void *arg)
 		val->err = store_port_val(msg, tb[SWITCH_ATTR_OP_VALUE_PORTS], val);
 	else if (tb[SWITCH_ATTR_OP_VALUE_LINK])
 		val->err = store_link_val(msg, tb[SWITCH_ATTR_OP_VALUE_LINK], val);
+	else if (tb[SWITCH_ATTR_OP_VALUE_ARL])
+		val->err = store_arl_val(msg, tb[SWITCH_ATTR_OP_VALUE_ARL], val);
 
 	val->err = 0;
 	return 0;
@@ -363,12 +423,11 @@ nla_put_failure:
 }
 
 static int
-send_attr_val(struct nl_msg *msg, void *arg)
+put_attr_val(struct nl_msg *msg, struct switch_val *val)
 {
-	struct switch_val *val = arg;
 	struct switch_attr *attr = val->attr;
 
-	if (send_attr(msg, arg))
+	if (put_attr(msg, val))
 		goto nla_put_failure;
 
 	switch(attr->type) {
@@ -399,6 +458,19 @@ nla_put_failure:
 	return -1;
 }
 
+static int
+send_attr_val(struct nl_msg *msg, void *arg)
+{
+	struct switch_val *val = arg;
+
+	NLA_PUT_U32(msg, SWITCH_ATTR_ID, val->attr->dev->id);
+
+	return put_attr_val(msg, val);
+
+nla_put_failure:
+	return -1;
+}
+
 int
 swlib_set_attr(struct switch_dev *dev, struct switch_attr *attr, struct switch_val *val)
 {
@@ -429,28 +501,32 @@ enum {
 	CMD_SPEED,
 };
 
-int swlib_set_attr_string(struct switch_dev *dev, struct switch_attr *a, int port_vlan, const char *str)
+/* converts str into val, returns 1 if there is nothing to set */
+static int
+parse_attr_string(struct switch_dev *dev, struct switch_attr *a, int port_vlan,
+		  char *str, struct switch_val *val)
 {
 	struct switch_port *ports;
 	struct switch_port_link *link;
-	struct switch_val val;
 	char *ptr;
 	int cmd = CMD_NONE;
 
-	memset(&val, 0, sizeof(val));
-	val.port_vlan = port_vlan;
+	memset(val, 0, sizeof(*val));
+	val->attr = a;
+	val->port_vlan = port_vlan;
 	switch(a->type) {
 	case SWITCH_TYPE_INT:
-		val.value.i = atoi(str);
+		val->value.i = atoi(str);
 		break;
 	case SWITCH_TYPE_STRING:
-		val.value.s = (char *)str;
+		val->value.s = str;
 		break;
 	case SWITCH_TYPE_PORTS:
-		ports = alloca(sizeof(struct switch_port) * dev->ports);
-		memset(ports, 0, sizeof(struct switch_port) * dev->ports);
-		val.len = 0;
-		ptr = (char *)str;
+		ports = calloc(dev->ports, sizeof(struct switch_port));
+		if (!ports)
+			return -1;
+		val->value.ports = ports;
+		ptr = str;
 		while(ptr && *ptr)
 		{
 			while(*ptr && isspace(*ptr))
@@ -462,14 +538,14 @@ int swlib_set_attr_string(struct switch_dev *dev, struct switch_attr *a, int por
 			if (!isdigit(*ptr))
 				return -1;
 
-			if (val.len >= dev->ports)
+			if (val->len >= dev->ports)
 				return -1;
 
-			ports[val.len].flags = 0;
-			ports[val.len].id = strtoul(ptr, &ptr, 10);
+			ports[val->len].flags = 0;
+			ports[val->len].id = strtoul(ptr, &ptr, 10);
 			while(*ptr && !isspace(*ptr)) {
 				if (*ptr == 't')
-					ports[val.len].flags |= SWLIB_PORT_FLAG_TAGGED;
+					ports[val->len].flags |= SWLIB_PORT_FLAG_TAGGED;
 				else
 					return -1;
 
@@ -477,14 +553,15 @@ int swlib_set_attr_string(struct switch_dev *dev, struct switch_attr *a, int por
 			}
 			if (*ptr)
 				ptr++;
-			val.len++;
+			val->len++;
 		}
-		val.value.ports = ports;
 		break;
 	case SWITCH_TYPE_LINK:
-		link = malloc(sizeof(struct switch_port_link));
-		memset(link, 0, sizeof(struct switch_port_link));
-		ptr = (char *)str;
+		link = calloc(1, sizeof(struct switch_port_link));
+		if (!link)
+			return -1;
+		val->value.link = link;
+		ptr = str;
 		for (ptr = strtok(ptr," "); ptr; ptr = strtok(NULL, " ")) {
 			switch (cmd) {
 			case CMD_NONE:
@@ -521,17 +598,218 @@ int swlib_set_attr_string(struct switch_dev *dev, struct switch_attr *a, int por
 				break;
 			}
 		}
-		val.value.link = link;
 		break;
 	case SWITCH_TYPE_NOVAL:
 		if (str && !strcmp(str, "0"))
-			return 0;
+			return 1;
 
 		break;
 	default:
 		return -1;
 	}
-	return swlib_set_attr(dev, a, &val);
+	return 0;
+}
+
+static void
+free_attr_val(struct switch_val *val)
+{
+	switch(val->attr->type) {
+	case SWITCH_TYPE_PORTS:
+		free(val->value.ports);
+		break;
+	case SWITCH_TYPE_LINK:
+		free(val->value.link);
+		break;
+	default:
+		break;
+	}
+}
+
+int swlib_set_attr_string(struct switch_dev *dev, struct switch_attr *a, int port_vlan, const char *str)
+{
+	struct switch_val val;
+	int ret;
+
+	ret = parse_attr_string(dev, a, port_vlan, (char *)str, &val);
+	if (!ret)
+		ret = swlib_set_attr(dev, a, &val);
+	else if (ret > 0)
+		ret = 0;
+
+	free_attr_val(&val);
+	return ret;
+}
+
+struct swlib_batch_op {
+	struct switch_val val;
+	char *str;
+};
+
+struct swlib_batch {
+	struct switch_dev *dev;
+	struct swlib_batch_op *ops;
+	int n_ops;
+	int size;
+
+	/* state of the commit in progress */
+	int pos;
+	int apply;
+	int probe;
+	int err;
+};
+
+struct swlib_batch *swlib_batch_new(struct switch_dev *dev)
+{
+	struct swlib_batch *b;
+
+	b = calloc(1, sizeof(*b));
+	if (!b)
+		return NULL;
+
+	b->dev = dev;
+	return b;
+}
+
+int swlib_batch_add_string(struct swlib_batch *b, struct switch_attr *a, int port_vlan, const char *str)
+{
+	struct swlib_batch_op *op;
+	int ret;
+
+	if (b->n_ops == b->size) {
+		int size = b->size ? b->size * 2 : 16;
+
+		op = realloc(b->ops, size * sizeof(*op));
+		if (!op)
+			return -1;
+
+		b->ops = op;
+		b->size = size;
+	}
+
+	op = &b->ops[b->n_ops];
+	op->str = strdup(str);
+	if (!op->str)
+		return -1;
+
+	ret = parse_attr_string(b->dev, a, port_vlan, op->str, &op->val);
+	if (ret) {
+		free_attr_val(&op->val);
+		free(op->str);
+		return ret < 0 ? ret : 0;
+	}
+
+	b->n_ops++;
+	return 0;
+}
+
+static int
+attr_set_cmd(struct switch_attr *attr)
+{
+	switch(attr->atype) {
+	case SWLIB_ATTR_GROUP_GLOBAL:
+		return SWITCH_CMD_SET_GLOBAL;
+	case SWLIB_ATTR_GROUP_PORT:
+		return SWITCH_CMD_SET_PORT;
+	case SWLIB_ATTR_GROUP_VLAN:
+		return SWITCH_CMD_SET_VLAN;
+	default:
+		return -1;
+	}
+}
+
+static int
+send_batch(struct nl_msg *msg, void *arg)
+{
+	struct swlib_batch *b = arg;
+	struct nlattr *n, *op;
+	int start = b->pos;
+
+	NLA_PUT_U32(msg, SWITCH_ATTR_ID, b->dev->id);
+	if (b->probe)
+		return 0;
+
+	n = nla_nest_start(msg, SWITCH_ATTR_OP_BATCH);
+	if (!n)
+		goto nla_put_failure;
+
+	/* fill the message with as many ops as fit, the rest goes into
+	 * the next request */
+	while (b->pos < b->n_ops) {
+		struct switch_val *val = &b->ops[b->pos].val;
+		uint32_t len = nlmsg_hdr(msg)->nlmsg_len;
+		int cmd = attr_set_cmd(val->attr);
+
+		op = nla_nest_start(msg, SWITCH_ATTR_OP);
+		if (cmd < 0 || !op ||
+		    nla_put_u32(msg, SWITCH_ATTR_OP_CMD, cmd) < 0 ||
+		    put_attr_val(msg, val) < 0) {
+			nlmsg_hdr(msg)->nlmsg_len = len;
+
+			/* does not fit into a request of its own either */
+			if (b->pos == start) {
+				b->err = -1;
+				b->pos++;
+				start++;
+				continue;
+			}
+			break;
+		}
+
+		nla_nest_end(msg, op);
+		b->pos++;
+	}
+	nla_nest_end(msg, n);
+
+	if (b->pos == b->n_ops && b->apply &&
+	    !nla_put_flag(msg, SWITCH_ATTR_OP_APPLY))
+		b->apply = 0;
+
+	return 0;
+
+nla_put_failure:
+	return -1;
+}
+
+int swlib_batch_commit(struct swlib_batch *b, int apply)
+{
+	int ret;
+
+	/* make sure the kernel knows the batch command before sending
+	 * anything, so the caller can still fall back to single requests */
+	b->probe = 1;
+	ret = swlib_call(SWITCH_CMD_SET_BATCH, NULL, send_batch, b);
+	b->probe = 0;
+	if (ret < 0)
+		return ret;
+
+	b->pos = 0;
+	b->apply = apply;
+	b->err = 0;
+	while (b->pos < b->n_ops || b->apply) {
+		int pos = b->pos;
+
+		ret = swlib_call(SWITCH_CMD_SET_BATCH, NULL, send_batch, b);
+		if (ret < 0 && !b->err)
+			b->err = ret;
+
+		/* the request could not even be built */
+		if (b->pos == pos && (b->pos < b->n_ops || b->apply))
+			break;
+	}
+
+	return b->err;
+}
+
+void swlib_batch_free(struct swlib_batch *b)
+{
+	int i;
+
+	for (i = 0; i < b->n_ops; i++) {
+		free_attr_val(&b->ops[i].val);
+		free(b->ops[i].str);
+	}
+	free(b->ops);
+	free(b);
 }
 
 
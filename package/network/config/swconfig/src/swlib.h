@@ -115,7 +115,9 @@ struct switch_attr;
 struct switch_port;
 struct switch_port_map;
 struct switch_port_link;
+struct switch_arl_entry;
 struct switch_val;
+struct swlib_batch;
 struct uci_package;
 
 struct switch_dev {
@@ -144,6 +146,7 @@ struct switch_val {
 		int i;
 		struct switch_port *ports;
 		struct switch_port_link *link;
+		struct switch_arl_entry *arl;
 	} value;
 };
 
@@ -178,6 +181,11 @@ struct switch_port_link {
 	uint32_t eee;
 };
 
+struct switch_arl_entry {
+	uint8_t mac[6];
+	unsigned int portmap;
+};
+
 /**
  * swlib_list: list all switches
  */
@@ -248,6 +256,39 @@ int swlib_set_attr(struct switch_dev *dev, struct switch_attr *attr,
 int swlib_set_attr_string(struct switch_dev *dev, struct switch_attr *attr,
 		int port_vlan, const char *str);
 
+/**
+ * swlib_batch_new: start a batch of attribute changes
+ * @dev: switch device struct
+ * returns NULL if out of memory
+ */
+struct swlib_batch *swlib_batch_new(struct switch_dev *dev);
+
+/**
+ * swlib_batch_add_string: queue an attribute change with type conversion
+ * @b: batch
+ * @attr: switch attribute struct
+ * @port_vlan: port or vlan (if applicable)
+ * @str: string value
+ * returns 0 on success
+ */
+int swlib_batch_add_string(struct swlib_batch *b, struct switch_attr *attr,
+		int port_vlan, const char *str);
+
+/**
+ * swlib_batch_commit: send all queued changes to the switch
+ * @b: batch
+ * @apply: let the driver apply the config after the last change
+ * returns 0 on success, -NLE_OPNOTSUPP if the kernel does not support
+ * batches, in which case nothing has been changed
+ */
+int swlib_batch_commit(struct swlib_batch *b, int apply);
+
+/**
+ * swlib_batch_free: free a batch and all queued changes
+ * @b: batch
+ */
+void swlib_batch_free(struct swlib_batch *b);
+
 /**
  * swlib_get_attr: get the value for an attribute
  * @dev: switch device struct
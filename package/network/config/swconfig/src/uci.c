@@ -113,6 +113,9 @@ int swlib_apply_from_uci(struct switch_dev *dev, struct uci_package *p)
 	struct uci_option *o;
 	struct uci_ptr ptr;
 	struct switch_val val;
+	struct swlib_setting *st;
+	struct swlib_batch *batch;
+	bool batched = false;
 	int i;
 
 	settings = NULL;
@@ -224,8 +227,29 @@ found:
 		swlib_map_settings(dev, SWLIB_ATTR_GROUP_PORT, port_n, s);
 	}
 
-	for (i = 0; i < ARRAY_SIZE(early_settings); i++) {
-		struct swlib_setting *st = &early_settings[i];
+	attr = swlib_lookup_attr(dev, SWLIB_ATTR_GROUP_GLOBAL, "apply");
+
+	/* send everything in one go if the kernel supports it */
+	batch = swlib_batch_new(dev);
+	if (batch) {
+		for (i = 0; i < ARRAY_SIZE(early_settings); i++) {
+			st = &early_settings[i];
+			if (!st->attr || !st->val)
+				continue;
+			swlib_batch_add_string(batch, st->attr, st->port_vlan, st->val);
+		}
+
+		for (st = settings; st; st = st->next)
+			swlib_batch_add_string(batch, st->attr, st->port_vlan, st->val);
+
+		if (swlib_batch_commit(batch, !!attr) != -NLE_OPNOTSUPP)
+			batched = true;
+
+		swlib_batch_free(batch);
+	}
+
+	for (i = 0; !batched && i < ARRAY_SIZE(early_settings); i++) {
+		st = &early_settings[i];
 		if (!st->attr || !st->val)
 			continue;
 		swlib_set_attr_string(dev, st->attr, st->port_vlan, st->val);
@@ -233,19 +257,19 @@ found:
 	}
 
 	while (settings) {
-		struct swlib_setting *st = settings;
+		st = settings;
 
-		swlib_set_attr_string(dev, st->attr, st->port_vlan, st->val);
+		if (!batched)
+			swlib_set_attr_string(dev, st->attr, st->port_vlan, st->val);
 		st = st->next;
 		free(settings);
 		settings = st;
 	}
 
-	/* Apply the config */
-	attr = swlib_lookup_attr(dev, SWLIB_ATTR_GROUP_GLOBAL, "apply");
-	if (!attr)
+	if (batched || !attr)
 		return 0;
 
+	/* Apply the config */
 	memset(&val, 0, sizeof(val));
 	swlib_set_attr(dev, attr, &val);
 
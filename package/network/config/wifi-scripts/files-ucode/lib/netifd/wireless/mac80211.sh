@@ -164,7 +164,9 @@ function setup_phy(phy, config, data) {
 	config.channel = +config.channel;
 	config.frequency = get_channel_frequency(config.band, config.channel);
 
-	if (config.country) {
+	// every request makes cfg80211 re-evaluate the channels of all phys
+	let reg = nl80211.request(nl80211.const.NL80211_CMD_GET_REG, 0, {});
+	if (config.country && config.country != reg?.reg_alpha2) {
 		log(`Setting country code to ${config.country}`);
 		system(`iw reg set ${config.country}`);
 	}
@@ -197,9 +199,9 @@ function setup_phy(phy, config, data) {
 	system(`iw phy ${phy} set distance ${config.distance}`);
 
 	if (config.frag)
-		system(`iw phy ${phy} set frag ${frag}`);
+		system(`iw phy ${phy} set frag ${config.frag}`);
 	if (config.rts)
-		system(`iw phy ${phy} set rts ${rts}`);
+		system(`iw phy ${phy} set rts ${config.rts}`);
 }
 
 function iw_htmode(config) {
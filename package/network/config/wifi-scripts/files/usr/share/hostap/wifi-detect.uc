@@ -82,8 +82,27 @@ function freq_range_match(ranges, freq) {
 	return false;
 }
 
-function wiphy_detect() {
-	let phys = nl.request(nl.const.NL80211_CMD_GET_WIPHY, nl.const.NLM_F_DUMP, { split_wiphy_dump: true });
+function wiphy_dump(name) {
+	let msg = { split_wiphy_dump: true };
+
+	if (name)
+		msg.wiphy = phy_idx(name);
+
+	return nl.request(nl.const.NL80211_CMD_GET_WIPHY, nl.const.NLM_F_DUMP, msg);
+}
+
+// with phy names given, only those are updated and the others are left
+// as they are in the board file
+function wiphy_detect(names) {
+	let phys = [];
+
+	if (length(names)) {
+		for (let name in names)
+			if (readfile(`/sys/class/ieee80211/${name}/index`))
+				push(phys, ...(wiphy_dump(name) ?? []));
+	} else {
+		phys = wiphy_dump();
+	}
 	if (!phys)
 		return;
 
@@ -246,8 +265,9 @@ function wiphy_detect() {
 	}
 }
 
-cleanup();
-wiphy_detect();
+if (!length(ARGV))
+	cleanup();
+wiphy_detect(ARGV);
 if (!is_equal(prev_board_data, board_data)) {
 	let new_file = board_file + ".new";
 	unlink(new_file);
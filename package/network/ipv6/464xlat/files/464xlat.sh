@@ -89,6 +89,7 @@ proto_464xlat_teardown() {
 	[ -f /tmp/464-$cfg-anycast ] || return
 	local ip6addr=$(cat /tmp/464-$cfg-anycast)
 
+	# the device and its conntracks go once no setup took them over
 	464xlatcfg "$link"
 
 	rm -rf /tmp/464-$cfg-anycast
@@ -98,9 +99,6 @@ proto_464xlat_teardown() {
 		ip -6 rule del from all lookup local
 		ip -6 rule add from all lookup local pref 0
 	fi
-
-	# Kill conntracks SNATed to 192.0.0.1
-	echo 192.0.0.1 > /proc/net/nf_conntrack
 }
 
 proto_464xlat_init_config() {
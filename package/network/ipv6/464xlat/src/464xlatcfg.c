@@ -20,38 +20,94 @@
 #include <net/if.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <string.h>
 #include <signal.h>
 #include <stdio.h>
 #include <netdb.h>
 
-static void sighandler(__attribute__((unused)) int signal)
+/*
+ * Seconds the nat46 device outlives a stopped instance. A new instance
+ * started within that time takes the device over and reconfigures it in
+ * place, so that the translated IPv4 connections survive a reconnect.
+ */
+#define CLAT_HOLD_TIME	10
+
+static volatile sig_atomic_t signals;
+
+static void sighandler(int signal)
 {
+	signals |= 1 << signal;
+}
+
+/* Kill conntracks SNATed to 192.0.0.1 */
+static void conntrack_flush(void)
+{
+	FILE *fp = fopen("/proc/net/nf_conntrack", "w");
+
+	if (fp) {
+		fputs("192.0.0.1\n", fp);
+		fclose(fp);
+	}
+}
+
+static void clat_remove(const char *name, const char *pidfile)
+{
+	FILE *fp;
+	int pid;
+
+	fp = fopen("/proc/net/nat46/control", "w");
+	if (fp) {
+		fprintf(fp, "del %s\n", name);
+		fclose(fp);
+	}
+
+	conntrack_flush();
+
+	fp = fopen(pidfile, "r");
+	if (fp) {
+		if (fscanf(fp, "%d", &pid) == 1 && pid == getpid())
+			unlink(pidfile);
+		fclose(fp);
+	}
 }
 
 int main(int argc, const char *argv[])
 {
 	char buf[INET6_ADDRSTRLEN], prefix[INET6_ADDRSTRLEN + 4];
-	int pid;
+	char pidfile[64], old_addr[INET6_ADDRSTRLEN] = "", old_prefix[INET6_ADDRSTRLEN + 4] = "";
+	sigset_t mask, oldmask;
+	int pid = 0, exists;
 
 	if (argc <= 1) {
 		fprintf(stderr, "Usage: %s <name> [ifname] [ipv6prefix] [ipv4addr] [ipv6addr]\n", argv[0]);
 		return 1;
 	}
 
-	snprintf(buf, sizeof(buf), "/var/run/%s.pid", argv[1]);
-	FILE *fp = fopen(buf, "r");
+	snprintf(pidfile, sizeof(pidfile), "/var/run/%s.pid", argv[1]);
+	FILE *fp = fopen(pidfile, "r");
 	if (fp) {
-		if (fscanf(fp, "%d", &pid) == 1)
-			kill(pid, SIGTERM);
-
-		unlink(buf);
+		if (fscanf(fp, "%d", &pid) != 1)
+			pid = 0;
+		else if (fscanf(fp, " %45s %49s", old_addr, old_prefix) != 2)
+			old_addr[0] = old_prefix[0] = 0;
 		fclose(fp);
 	}
 
-	if (!argv[2])
+	/* the instance removes the device once its hold time is over */
+	if (!argv[2]) {
+		if (pid > 0)
+			kill(pid, SIGTERM);
 		return 0;
+	}
+
+	/* take the device over from the previous instance */
+	if (pid > 0 && !kill(pid, SIGUSR1)) {
+		for (int i = 0; i < 20 && !kill(pid, 0); i++)
+			usleep(50 * 1000);
+	}
+	unlink(pidfile);
 
-	if (!argv[3] || !argv[4] || !(fp = fopen(buf, "wx")))
+	if (!argv[3] || !argv[4] || !(fp = fopen(pidfile, "wx")))
 		return 1;
 
 	signal(SIGTERM, SIG_DFL);
@@ -124,12 +180,26 @@ int main(int argc, const char *argv[])
 	fputc('\n', stdout);
 	fflush(stdout);
 
+	/* an existing device is reconfigured in place */
+	exists = if_nametoindex(argv[1]) != 0;
+
 	FILE *nat46 = fopen("/proc/net/nat46/control", "w");
-	if (!nat46 || fprintf(nat46, "add %s\nconfig %s local.style NONE local.v4 %s/32 local.v6 %s/128 "
-			"remote.style RFC6052 remote.v6 %s\n", argv[1], argv[1], argv[4], buf, prefix) < 0 ||
+	if (!nat46 || (!exists && fprintf(nat46, "add %s\n", argv[1]) < 0) ||
+			fprintf(nat46, "config %s local.style NONE local.v4 %s/32 local.v6 %s/128 "
+			"remote.style RFC6052 remote.v6 %s\n", argv[1], argv[4], buf, prefix) < 0 ||
 			fclose(nat46))
 		return 4;
 
+	/* connections translated with the old addresses are broken anyway */
+	if (exists && (strcmp(old_addr, buf) || strcmp(old_prefix, prefix)))
+		conntrack_flush();
+
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGTERM);
+	sigaddset(&mask, SIGUSR1);
+	sigaddset(&mask, SIGALRM);
+	sigprocmask(SIG_BLOCK, &mask, &oldmask);
+
 	if (!(pid = fork())) {
 		fclose(fp);
 		fclose(stdin);
@@ -138,16 +208,25 @@ int main(int argc, const char *argv[])
 		chdir("/");
 		setsid();
 		signal(SIGTERM, sighandler);
-		pause();
+		signal(SIGUSR1, sighandler);
+		signal(SIGALRM, sighandler);
+
+		/* SIGTERM: stopped, SIGUSR1: taken over by a new instance */
+		while (!(signals & ((1 << SIGUSR1) | (1 << SIGALRM)))) {
+			sigsuspend(&oldmask);
+			if (signals & (1 << SIGTERM)) {
+				signals &= ~(1 << SIGTERM);
+				alarm(CLAT_HOLD_TIME);
+			}
+		}
 
-		nat46 = fopen("/proc/net/nat46/control", "w");
-		if (nat46) {
-			fprintf(nat46, "del %s\n", argv[1]);
-			fclose(nat46);
+		if (!(signals & (1 << SIGUSR1))) {
+			close(sock);
+			clat_remove(argv[1], pidfile);
 		}
 	} else {
 		rewind(fp);
-		fprintf(fp, "%d\n", pid);
+		fprintf(fp, "%d\n%s %s\n", pid, buf, prefix);
 	}
 
 	return 0;
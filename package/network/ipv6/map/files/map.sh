@@ -20,6 +20,16 @@
 	init_proto "$@"
 }
 
+# copy the fields of rule $2 to ${1}_<FIELD> without forking subshells
+map_rule_vars() {
+	local field
+
+	for field in BR DMR EALEN IPV4ADDR IPV4PREFIX IPV6ADDR IPV6PREFIX \
+			OFFSET PD6IFACE PORTSETS PREFIX4LEN PREFIX6LEN; do
+		eval "${1}_${field}=\"\$RULE_${2}_${field}\""
+	done
+}
+
 proto_map_setup() {
 	local cfg="$1"
 	local iface="$2"
@@ -72,29 +82,29 @@ proto_map_setup() {
 		return
 	fi
 
-	k=$RULE_BMR
+	map_rule_vars BMR $RULE_BMR
 	if [ "$maptype" = "lw4o6" -o "$maptype" = "map-e" ]; then
 		proto_init_update "$link" 1
-		proto_add_ipv4_address $(eval "echo \$RULE_${k}_IPV4ADDR") "" "" ""
+		proto_add_ipv4_address $BMR_IPV4ADDR "" "" ""
 
 		proto_add_tunnel
 		json_add_string mode ipip6
 		json_add_int mtu "${mtu:-1280}"
 		json_add_int ttl "${ttl:-64}"
-		json_add_string local $(eval "echo \$RULE_${k}_IPV6ADDR")
-		json_add_string remote $(eval "echo \$RULE_${k}_BR")
-		json_add_string link $(eval "echo \$RULE_${k}_PD6IFACE")
+		json_add_string local $BMR_IPV6ADDR
+		json_add_string remote $BMR_BR
+		json_add_string link $BMR_PD6IFACE
 		json_add_object "data"
 			[ -n "$encaplimit" ] && json_add_string encaplimit "$encaplimit"
 			if [ "$maptype" = "map-e" ]; then
 				json_add_array "fmrs"
-				for i in $(seq $RULE_COUNT); do
-					[ "$(eval "echo \$RULE_${i}_FMR")" != 1 ] && continue
+				for i in $RULE_FMRS; do
+					map_rule_vars FMR $i
 					json_add_object ""
-					json_add_string prefix6 "$(eval "echo \$RULE_${i}_IPV6PREFIX")/$(eval "echo \$RULE_${i}_PREFIX6LEN")"
-					json_add_string prefix4 "$(eval "echo \$RULE_${i}_IPV4PREFIX")/$(eval "echo \$RULE_${i}_PREFIX4LEN")"
-					json_add_int ealen $(eval "echo \$RULE_${i}_EALEN")
-					json_add_int offset $(eval "echo \$RULE_${i}_OFFSET")
+					json_add_string prefix6 "$FMR_IPV6PREFIX/$FMR_PREFIX6LEN"
+					json_add_string prefix4 "$FMR_IPV4PREFIX/$FMR_PREFIX4LEN"
+					json_add_int ealen $FMR_EALEN
+					json_add_int offset $FMR_OFFSET
 					json_close_object
 				done
 				json_close_array
@@ -109,17 +119,17 @@ proto_map_setup() {
 		[ "$legacymap" = 1 ] && style="MAP0"
 
 		echo add $link > /proc/net/nat46/control
-		local cfgstr="local.style $style local.v4 $(eval "echo \$RULE_${k}_IPV4PREFIX")/$(eval "echo \$RULE_${k}_PREFIX4LEN")"
-		cfgstr="$cfgstr local.v6 $(eval "echo \$RULE_${k}_IPV6PREFIX")/$(eval "echo \$RULE_${k}_PREFIX6LEN")"
-		cfgstr="$cfgstr local.ea-len $(eval "echo \$RULE_${k}_EALEN") local.psid-offset $(eval "echo \$RULE_${k}_OFFSET")"
-		cfgstr="$cfgstr remote.v4 0.0.0.0/0 remote.v6 $(eval "echo \$RULE_${k}_DMR") remote.style RFC6052 remote.ea-len 0 remote.psid-offset 0"
+		local cfgstr="local.style $style local.v4 $BMR_IPV4PREFIX/$BMR_PREFIX4LEN"
+		cfgstr="$cfgstr local.v6 $BMR_IPV6PREFIX/$BMR_PREFIX6LEN"
+		cfgstr="$cfgstr local.ea-len $BMR_EALEN local.psid-offset $BMR_OFFSET"
+		cfgstr="$cfgstr remote.v4 0.0.0.0/0 remote.v6 $BMR_DMR remote.style RFC6052 remote.ea-len 0 remote.psid-offset 0"
 		echo config $link $cfgstr > /proc/net/nat46/control
 
-		for i in $(seq $RULE_COUNT); do
-			[ "$(eval "echo \$RULE_${i}_FMR")" != 1 ] && continue
-			local cfgstr="remote.style $style remote.v4 $(eval "echo \$RULE_${i}_IPV4PREFIX")/$(eval "echo \$RULE_${i}_PREFIX4LEN")"
-			cfgstr="$cfgstr remote.v6 $(eval "echo \$RULE_${i}_IPV6PREFIX")/$(eval "echo \$RULE_${i}_PREFIX6LEN")"
-			cfgstr="$cfgstr remote.ea-len $(eval "echo \$RULE_${i}_EALEN") remote.psid-offset $(eval "echo \$RULE_${i}_OFFSET")"
+		for i in $RULE_FMRS; do
+			map_rule_vars FMR $i
+			local cfgstr="remote.style $style remote.v4 $FMR_IPV4PREFIX/$FMR_PREFIX4LEN"
+			cfgstr="$cfgstr remote.v6 $FMR_IPV6PREFIX/$FMR_PREFIX6LEN"
+			cfgstr="$cfgstr remote.ea-len $FMR_EALEN remote.psid-offset $FMR_OFFSET"
 			echo insert $link $cfgstr > /proc/net/nat46/control
 		done
 	else
@@ -132,15 +142,15 @@ proto_map_setup() {
 	[ -n "$zone" ] && json_add_string zone "$zone"
 
 	json_add_array firewall
-	  if [ -z "$(eval "echo \$RULE_${k}_PORTSETS")" ]; then
+	  if [ -z "$BMR_PORTSETS" ]; then
 	    json_add_object ""
 	      json_add_string type nat
 	      json_add_string target SNAT
 	      json_add_string family inet
-	      json_add_string snat_ip $(eval "echo \$RULE_${k}_IPV4ADDR")
+	      json_add_string snat_ip $BMR_IPV4ADDR
 	    json_close_object
 	  else
-	    for portset in $(eval "echo \$RULE_${k}_PORTSETS"); do
+	    for portset in $BMR_PORTSETS; do
               for proto in icmp tcp udp; do
 	        json_add_object ""
 	          json_add_string type nat
@@ -148,7 +158,7 @@ proto_map_setup() {
 	          json_add_string family inet
 	          json_add_string proto "$proto"
                   json_add_boolean connlimit_ports 1
-                  json_add_string snat_ip $(eval "echo \$RULE_${k}_IPV4ADDR")
+                  json_add_string snat_ip $BMR_IPV4ADDR
                   json_add_string snat_port "$portset"
 	        json_close_object
               done
@@ -165,7 +175,7 @@ proto_map_setup() {
 				json_add_string direction in
 				json_add_string dest "$zone"
 				json_add_string src "$zone"
-				json_add_string src_ip $(eval "echo \$RULE_${k}_IPV6ADDR")
+				json_add_string src_ip $BMR_IPV6ADDR
 				json_add_string target ACCEPT
 			json_close_object
 			json_add_object ""
@@ -175,11 +185,11 @@ proto_map_setup() {
 				json_add_string direction out
 				json_add_string dest "$zone"
 				json_add_string src "$zone"
-				json_add_string dest_ip $(eval "echo \$RULE_${k}_IPV6ADDR")
+				json_add_string dest_ip $BMR_IPV6ADDR
 				json_add_string target ACCEPT
 			json_close_object
 		}
-		proto_add_ipv6_route $(eval "echo \$RULE_${k}_IPV6ADDR") 128
+		proto_add_ipv6_route $BMR_IPV6ADDR 128
 	  fi
 	json_close_array
 	proto_close_data
@@ -189,10 +199,10 @@ proto_map_setup() {
 	if [ "$maptype" = "lw4o6" -o "$maptype" = "map-e" ]; then
 		json_init
 		json_add_string name "${cfg}_"
-		json_add_string ifname "@$(eval "echo \$RULE_${k}_PD6IFACE")"
+		json_add_string ifname "@$BMR_PD6IFACE"
 		json_add_string proto "static"
 		json_add_array ip6addr
-		json_add_string "" "$(eval "echo \$RULE_${k}_IPV6ADDR")"
+		json_add_string "" "$BMR_IPV6ADDR"
 		json_close_array
 		json_close_object
 		ubus call network add_dynamic "$(json_dump)"
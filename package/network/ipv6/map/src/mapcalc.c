@@ -26,6 +26,16 @@
 
 struct blob_attr *dump = NULL;
 
+/* interfaces from the dump that may hold the PD, parsed once for all rules */
+struct map_iface {
+	const char *name;
+	struct blob_attr *prefix;
+	struct blob_attr *address;
+};
+
+static struct map_iface *ifaces = NULL;
+static size_t ifaces_cnt = 0;
+
 enum {
 	DUMP_ATTR_INTERFACE,
 	DUMP_ATTR_MAX
@@ -113,6 +123,37 @@ static void handle_dump(struct ubus_request *req __attribute__((unused)),
 	dump = blob_memdup(tb[DUMP_ATTR_INTERFACE]);
 }
 
+static void parse_ifaces(const char *filter)
+{
+	struct blob_attr *c;
+	unsigned rem;
+	size_t cnt = 0;
+
+	if (!dump)
+		return;
+
+	blobmsg_for_each_attr(c, dump, rem)
+		++cnt;
+
+	ifaces = calloc(cnt, sizeof(*ifaces));
+	if (!ifaces)
+		return;
+
+	blobmsg_for_each_attr(c, dump, rem) {
+		struct blob_attr *tb[IFACE_ATTR_MAX];
+		blobmsg_parse(iface_attrs, IFACE_ATTR_MAX, tb, blobmsg_data(c), blobmsg_data_len(c));
+
+		if (!tb[IFACE_ATTR_INTERFACE] || (strcmp(filter, "*") && strcmp(filter,
+				blobmsg_get_string(tb[IFACE_ATTR_INTERFACE]))))
+			continue;
+
+		ifaces[ifaces_cnt].name = blobmsg_get_string(tb[IFACE_ATTR_INTERFACE]);
+		ifaces[ifaces_cnt].prefix = tb[IFACE_ATTR_PREFIX];
+		ifaces[ifaces_cnt].address = tb[IFACE_ATTR_ADDRESS];
+		ifaces_cnt++;
+	}
+}
+
 static void match_prefix(int *pdlen, struct in6_addr *pd, struct blob_attr *cur,
 		const struct in6_addr *ipv6prefix, int prefix6len, bool lw4o6)
 {
@@ -208,7 +249,11 @@ int main(int argc, char *argv[])
 		ubus_invoke(ubus, network_interface, "dump", NULL, handle_dump, NULL, 5000);
 	}
 
+	parse_ifaces(argv[1]);
+
 	int rulecnt = 0;
+	int fmrcnt = 0;
+	int *fmrs = calloc(argc, sizeof(*fmrs));
 	for (int i = 2; i < argc; ++i) {
 		bool lw4o6 = false;
 		bool fmr = false;
@@ -285,23 +330,14 @@ int main(int argc, char *argv[])
 
 		// Find PD
 		if (pdlen < 0) {
-			struct blob_attr *c;
-			unsigned rem;
-			blobmsg_for_each_attr(c, dump, rem) {
-				struct blob_attr *tb[IFACE_ATTR_MAX];
-				blobmsg_parse(iface_attrs, IFACE_ATTR_MAX, tb, blobmsg_data(c), blobmsg_data_len(c));
-
-				if (!tb[IFACE_ATTR_INTERFACE] || (strcmp(argv[1], "*") && strcmp(argv[1],
-						blobmsg_get_string(tb[IFACE_ATTR_INTERFACE]))))
-					continue;
-
-				match_prefix(&pdlen, &pd, tb[IFACE_ATTR_PREFIX], &ipv6prefix, prefix6len, lw4o6);
+			for (size_t j = 0; j < ifaces_cnt; ++j) {
+				match_prefix(&pdlen, &pd, ifaces[j].prefix, &ipv6prefix, prefix6len, lw4o6);
 
 				if (lw4o6)
-					match_prefix(&pdlen, &pd, tb[IFACE_ATTR_ADDRESS], &ipv6prefix, prefix6len, lw4o6);
+					match_prefix(&pdlen, &pd, ifaces[j].address, &ipv6prefix, prefix6len, lw4o6);
 
 				if (pdlen >= 0) {
-					iface = blobmsg_get_string(tb[IFACE_ATTR_INTERFACE]);
+					iface = ifaces[j].name;
 					break;
 				}
 			}
@@ -356,6 +392,9 @@ int main(int argc, char *argv[])
 		}
 
 		++rulecnt;
+		if (fmr && fmrs)
+			fmrs[fmrcnt++] = rulecnt;
+
 		char ipv4addrbuf[INET_ADDRSTRLEN];
 		char ipv4prefixbuf[INET_ADDRSTRLEN];
 		char ipv6prefixbuf[INET6_ADDRSTRLEN];
@@ -392,6 +431,7 @@ int main(int argc, char *argv[])
 
 
 		if (psidlen > 0 && psid >= 0) {
+			printf("RULE_%d_PSID=%d\n", rulecnt, psid >> (16 - psidlen));
 			printf("RULE_%d_PORTSETS='", rulecnt);
 			for (int k = (offset) ? 1 : 0; k < (1 << offset); ++k) {
 				int start = (k << (16 - offset)) | (psid >> offset);
@@ -413,6 +453,11 @@ int main(int argc, char *argv[])
 			printf("RULE_%d_BR=%s\n", rulecnt, br);
 	}
 
+	printf("RULE_FMRS='");
+	for (int i = 0; i < fmrcnt; ++i)
+		printf("%s%d", i ? " " : "", fmrs[i]);
+	printf("'\n");
+
 	printf("RULE_COUNT=%d\n", rulecnt);
 	return status;
 }
@@ -0,0 +1,104 @@
+#!/usr/bin/ucode
+'use strict';
+
+// Collects the events of dhcp-script.uc and passes them on to the
+// hotplug.dhcp, hotplug.neigh and hotplug.tftp objects in batches.
+// Within a batch, only the last event of a lease or neighbour is kept,
+// an add followed by updates stays an add, and an entry that is added
+// and removed again is dropped altogether.
+
+import * as libubus from 'ubus';
+import * as uloop from 'uloop';
+
+const flush_delay = 200;
+const max_pending = 256;
+
+let ubus, timer;
+let pending = [];
+
+function env_get(ev, name)
+{
+	for (let var in ev.env)
+		if (index(var, `${name}=`) == 0)
+			return substr(var, length(name) + 1);
+}
+
+function env_set(ev, name, value)
+{
+	ev.env = [ ...filter(ev.env, (var) => index(var, `${name}=`) != 0), `${name}=${value}` ];
+}
+
+function coalesce(events)
+{
+	let last = {};
+
+	for (let ev in events) {
+		ev.action = env_get(ev, 'ACTION');
+		if (ev.object == 'tftp')
+			continue;
+
+		let key = `${ev.object} ${env_get(ev, 'MACADDR')} ${env_get(ev, 'IPADDR')}`;
+		let prev = last[key];
+		last[key] = ev;
+		if (!prev)
+			continue;
+
+		prev.drop = true;
+		if (prev.action != 'add')
+			continue;
+
+		if (ev.action == 'remove') {
+			ev.drop = true;
+			delete last[key];
+		} else if (ev.action == 'update') {
+			ev.action = 'add';
+			env_set(ev, 'ACTION', 'add');
+		}
+	}
+
+	return filter(events, (ev) => !ev.drop);
+}
+
+function flush()
+{
+	let events = coalesce(pending);
+
+	if (timer)
+		timer.cancel();
+	timer = null;
+	pending = [];
+
+	for (let ev in events)
+		ubus.call(`hotplug.${ev.object}`, 'call', { env: ev.env });
+}
+
+uloop.init();
+
+ubus = libubus.connect();
+if (!ubus) {
+	warn('Failed to connect to ubus\n');
+	exit(1);
+}
+
+ubus.publish('dnsmasq.events', {
+	push: {
+		call: function(req) {
+			let args = req.args;
+
+			if (index([ 'dhcp', 'neigh', 'tftp' ], args.object) < 0 ||
+			    type(args.env) != 'array')
+				return libubus.STATUS_INVALID_ARGUMENT;
+
+			push(pending, { object: args.object, env: args.env });
+			if (length(pending) >= max_pending)
+				flush();
+			else if (!timer)
+				timer = uloop.timer(flush_delay, flush);
+
+			return { pending: length(pending) };
+		},
+		args: { object: '', env: [] }
+	},
+});
+
+uloop.run();
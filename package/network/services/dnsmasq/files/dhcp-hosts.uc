@@ -0,0 +1,138 @@
+#!/usr/bin/ucode
+'use strict';
+
+// Generate the static leases and domain records of a dnsmasq instance
+// in one pass over the uci config, in place of the dhcp_host_add and
+// dhcp_domain_add shell callbacks of the init script, which take tens of
+// seconds on setups with thousands of host and domain sections.
+//
+// Usage: dhcp-hosts.uc <instance> <dhcp version> <domain> <dhcp-hostsfile> <addn-hosts>
+//
+// The --dhcp-host entries are appended to <dhcp-hostsfile>, the DNS
+// records to <addn-hosts>. The names of the host sections with a
+// networkid are printed, their dhcp options are left to the init script.
+
+import { cursor } from 'uci';
+import { open } from 'fs';
+
+const [ instance, dhcp_ver, domain, dhcphostsfile, hostsfile ] = ARGV;
+
+function get(val) {
+	return type(val) == 'array' ? join(' ', val) : (val ?? '');
+}
+
+function words(val) {
+	return filter(split(get(val), /[ \t\n]+/), length);
+}
+
+// same as config_get_bool
+function get_bool(val, def) {
+	switch (val) {
+	case '1': case 'on': case 'true': case 'yes': case 'enabled':
+		return true;
+	case '0': case 'off': case 'false': case 'no': case 'disabled':
+		return false;
+	}
+	return def;
+}
+
+// same as hex_to_hostid, invalid literals are passed on as they are
+function hex_to_hostid(val) {
+	let digits = replace(val, /^0x/, '');
+
+	if (!match(digits, /^[0-9a-fA-F]*$/))
+		return val;
+
+	let id = hex(digits || '0');
+	return sprintf('%x:%x', (id >> 16) % 65536, id % 65536);
+}
+
+function host_add(s) {
+	let name = get(s.name), ip = get(s.ip), hostid = get(s.hostid);
+
+	if (!get_bool(s.enable, true))
+		return;
+
+	if (!ip && !name && !hostid)
+		return;
+
+	if (get_bool(s.dns, false) && ip && name)
+		push(hosts, `${ip} ${name}${domain ? '.' + domain : ''}`);
+
+	let mtags = '', macs, duids, tags;
+
+	if (type(s.match_tag) == 'array')
+		for (let t in s.match_tag)
+			mtags += `tag:${t},`;
+
+	macs = join(',', words(s.mac));
+
+	if (dhcp_ver == '6' && s.duid)
+		duids = 'id:' + split(get(s.duid), ' ')[0];
+
+	if (!macs && !duids) {
+		if (!name)
+			return;
+		macs = name;
+		name = '';
+	}
+
+	if (hostid)
+		hostid = hex_to_hostid(hostid);
+
+	tags = join(',set:', words(s.tag));
+
+	let leasetime = get(s.leasetime);
+	let hosttag = (s.networkid ? `,set:${get(s.networkid)}` : '') +
+		(tags ? `,set:${tags}` : '') +
+		(get_bool(s.broadcast, false) ? ',set:needs-broadcast' : '');
+	let nametime = (name ? `,${name}` : '') + (leasetime ? `,${leasetime}` : '');
+
+	if (dhcp_ver == '6')
+		push(dhcphosts, mtags + macs + (duids ? `,${duids}` : '') + hosttag +
+			(ip ? `,${ip}` : '') + (hostid ? `,[::${hostid}]` : '') + nametime);
+	else
+		push(dhcphosts, mtags + macs + hosttag + (ip ? `,${ip}` : '') + nametime);
+}
+
+function domain_add(s) {
+	let names = words(s.name), ip = get(s.ip);
+
+	if (length(names) && ip)
+		push(hosts, `${ip} ${join(' ', names)}`);
+}
+
+function append(path, lines) {
+	let f = open(path, 'a');
+
+	if (!f)
+		die(`Cannot open ${path}`);
+
+	if (length(lines))
+		f.write(join('\n', lines) + '\n');
+	f.close();
+}
+
+// same as filter_dnsmasq
+function foreach_instance(stype, cb) {
+	uci.foreach('dhcp', stype, (s) => {
+		if (!s.instance || s.instance == instance)
+			cb(s);
+	});
+}
+
+const uci = cursor();
+let dhcphosts = [], hosts = [];
+
+if (!uci.load('dhcp'))
+	die('Cannot load the dhcp config');
+
+foreach_instance('host', (s) => {
+	if (s.networkid)
+		print(s['.name'], '\n');
+	host_add(s);
+});
+foreach_instance('domain', domain_add);
+
+append(dhcphostsfile, dhcphosts);
+append(hostsfile, hosts);
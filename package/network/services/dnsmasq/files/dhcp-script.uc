@@ -0,0 +1,66 @@
+#!/usr/bin/ucode
+'use strict';
+
+// Counterpart of dhcp-script.sh for setups without a user dhcpscript:
+// hands the event to the batching dhcp-events.uc daemon over ubus, or
+// straight to the hotplug object if that is not running, without
+// spawning any further processes.
+
+import { connect } from 'ubus';
+
+const action = ARGV[0];
+let env = [];
+let object;
+
+for (let name, value in getenv())
+	if (index(name, 'DNSMASQ_') == 0)
+		push(env, `${name}=${value}`);
+env = sort(env);
+
+switch (action) {
+case 'add':
+case 'del':
+case 'old':
+case 'arp-add':
+case 'arp-del':
+	push(env, `MACADDR=${ARGV[1]}`, `IPADDR=${ARGV[2]}`);
+	break;
+}
+
+switch (action) {
+case 'add':
+	push(env, 'ACTION=add', `HOSTNAME=${ARGV[3]}`);
+	object = 'dhcp';
+	break;
+case 'del':
+	push(env, 'ACTION=remove', `HOSTNAME=${ARGV[3]}`);
+	object = 'dhcp';
+	break;
+case 'old':
+	push(env, 'ACTION=update', `HOSTNAME=${ARGV[3]}`);
+	object = 'dhcp';
+	break;
+case 'arp-add':
+	push(env, 'ACTION=add');
+	object = 'neigh';
+	break;
+case 'arp-del':
+	push(env, 'ACTION=remove');
+	object = 'neigh';
+	break;
+case 'tftp':
+	push(env, 'ACTION=add', `TFTP_SIZE=${ARGV[1]}`,
+	     `TFTP_ADDR=${ARGV[2]}`, `TFTP_PATH=${ARGV[3]}`);
+	object = 'tftp';
+	break;
+}
+
+if (!object)
+	exit(0);
+
+let ubus = connect();
+if (!ubus)
+	exit(1);
+
+if (!ubus.call('dnsmasq.events', 'push', { object, env }))
+	ubus.call(`hotplug.${object}`, 'call', { env });
@@ -107,24 +107,57 @@ t_serveropenraw(ent, tce)
   return ts;
 }
 
+static void
+t_genexp(n, g, exp)
+     struct t_num * n;
+     struct t_num * g;
+     struct t_serverexp * exp;
+{
+  BigInteger b, gb, bn, bg;
+
+  exp->b.data = exp->bbuf;
+  exp->gb.data = exp->gbbuf;
+
+  if(n->len < BLEN)
+    exp->b.len = n->len;
+  else
+    exp->b.len = BLEN;
+
+  t_random(exp->b.data, exp->b.len);
+  b = BigIntegerFromBytes(exp->b.data, exp->b.len);
+  bn = BigIntegerFromBytes(n->data, n->len);
+  bg = BigIntegerFromBytes(g->data, g->len);
+  gb = BigIntegerFromInt(0);
+  BigIntegerModExp(gb, bg, b, bn);
+
+  exp->gb.len = BigIntegerToBytes(gb, exp->gb.data);
+
+  BigIntegerFree(gb);
+  BigIntegerFree(b);
+  BigIntegerFree(bg);
+  BigIntegerFree(bn);
+}
+
+_TYPE( void )
+t_serverprecomp(tce, exp)
+     struct t_confent * tce;
+     struct t_serverexp * exp;
+{
+  t_genexp(&tce->modulus, &tce->generator, exp);
+}
+
 _TYPE( struct t_num * )
-t_servergenexp(ts)
+t_servergenexpfrom(ts, exp)
      struct t_server * ts;
+     struct t_serverexp * exp;
 {
-  BigInteger b, B, v, n, g;
+  BigInteger B, v, n;
 
-  if(ts->n.len < BLEN)
-    ts->b.len = ts->n.len;
-  else
-    ts->b.len = BLEN;
+  ts->b.len = exp->b.len;
+  memcpy(ts->b.data, exp->b.data, ts->b.len);
 
-  t_random(ts->b.data, ts->b.len);
-  b = BigIntegerFromBytes(ts->b.data, ts->b.len);
   n = BigIntegerFromBytes(ts->n.data, ts->n.len);
-  g = BigIntegerFromBytes(ts->g.data, ts->g.len);
-  B = BigIntegerFromInt(0);
-  BigIntegerModExp(B, g, b, n);
-
+  B = BigIntegerFromBytes(exp->gb.data, exp->gb.len);
   v = BigIntegerFromBytes(ts->v.data, ts->v.len);
   BigIntegerAdd(B, B, v);
   if(BigIntegerCmp(B, n) > 0)
@@ -134,15 +167,28 @@ t_servergenexp(ts)
 
   BigIntegerFree(v);
   BigIntegerFree(B);
-  BigIntegerFree(b);
-  BigIntegerFree(g);
   BigIntegerFree(n);
 
+  memset(exp->bbuf, 0, sizeof(exp->bbuf));
+  exp->b.len = 0;
+  exp->gb.len = 0;
+
   SHA1Update(&ts->oldckhash, ts->B.data, ts->B.len);
 
   return &ts->B;
 }
 
+_TYPE( struct t_num * )
+t_servergenexp(ts)
+     struct t_server * ts;
+{
+  struct t_serverexp exp;
+
+  t_genexp(&ts->n, &ts->g, &exp);
+
+  return t_servergenexpfrom(ts, &exp);
+}
+
 _TYPE( unsigned char * )
 t_servergetkey(ts, clientval)
      struct t_server * ts;
@@ -98,6 +98,14 @@ struct t_server {
   unsigned char saltbuf[MAXSALTLEN], bbuf[BLEN], Bbuf[MAXPARAMLEN];
 };
 
+/* random exponent b and g^b, independent of the user */
+struct t_serverexp {
+  struct t_num b;
+  struct t_num gb;
+
+  unsigned char bbuf[BLEN], gbbuf[MAXPARAMLEN];
+};
+
 /*
  * SRP server-side negotiation
  *
@@ -108,6 +116,10 @@ struct t_server {
  * "t_servergenexp" will generate a random 256-bit exponent and
  *   raise g (from the configuration file) to that power, returning
  *   the result.  This result should be sent to the client as y(p).
+ * "t_serverprecomp" does the expensive part of "t_servergenexp" ahead
+ *   of time, so it can run while the server is idle.  The result is
+ *   consumed by "t_servergenexpfrom" for a session using the same
+ *   configuration entry, and must not be used twice.
  * "t_servergetkey" accepts the exponential w(p), which should be
  *   sent by the client, and computes the 256-bit session key.
  *   This data should be saved before the session is closed.
@@ -130,6 +142,9 @@ _TYPE( struct t_server * )
 _TYPE( struct t_server * )
   t_serveropenraw P((struct t_pwent *, struct t_confent *));
 _TYPE( struct t_num * ) t_servergenexp P((struct t_server *));
+_TYPE( void ) t_serverprecomp P((struct t_confent *, struct t_serverexp *));
+_TYPE( struct t_num * )
+  t_servergenexpfrom P((struct t_server *, struct t_serverexp *));
 _TYPE( unsigned char * ) t_servergetkey P((struct t_server *, struct t_num *));
 _TYPE( int ) t_serververify P((struct t_server *, unsigned char *));
 _TYPE( unsigned char * ) t_serverresponse P((struct t_server *));
@@ -6,6 +6,7 @@ let ubus = libubus.connect(null, 60);
 
 hostapd.data.config = {};
 hostapd.data.pending_config = {};
+hostapd.data.restart_fields = {};
 
 hostapd.data.file_fields = {
 	vlan_file: true,
@@ -24,6 +25,20 @@ hostapd.data.file_fields = {
 	eap_sim_db: true,
 };
 
+// settings that can be updated without restarting the radio or bss
+hostapd.data.reload_fields = {
+	// radio
+	supported_rates: true,
+	basic_rates: true,
+	beacon_rate: true,
+
+	// bss
+	wpa_passphrase: true,
+	wpa_psk: true,
+	sae_password: true,
+	macaddr_acl: true,
+};
+
 hostapd.data.iface_fields = {
 	ft_iface: true,
 	upnp_iface: true,
@@ -342,10 +357,6 @@ function bss_reload_psk(bss, config, old_config)
 	if (is_equal(old_config.hash.wpa_psk_file, config.hash.wpa_psk_file))
 		return;
 
-	old_config.hash.wpa_psk_file = config.hash.wpa_psk_file;
-	if (!is_equal(old_config, config))
-		return;
-
 	let ret = bss.ctrl("RELOAD_WPA_PSK");
 	ret ??= "failed";
 
@@ -400,10 +411,6 @@ function bss_reload_rxkhs(bss, config, old_config)
 			return;
 	}
 
-	old_config.hash.rxkh_file = config.hash.rxkh_file;
-	if (!is_equal(old_config, config))
-		return;
-
 	let ret = bss.ctrl("RELOAD_RXKHS");
 	ret ??= "failed";
 
@@ -415,23 +422,6 @@ function remove_file_fields(config)
 	return filter(config, (line) => !hostapd.data.file_fields[split(line, "=")[0]]);
 }
 
-function bss_remove_file_fields(config)
-{
-	let new_cfg = {};
-
-	for (let key in config)
-		new_cfg[key] = config[key];
-	new_cfg.data = remove_file_fields(new_cfg.data);
-	new_cfg.hash = {};
-	for (let key in config.hash)
-		new_cfg.hash[key] = config.hash[key];
-	delete new_cfg.hash.wpa_psk_file;
-	delete new_cfg.hash.sae_password_file;
-	delete new_cfg.hash.vlan_file;
-
-	return new_cfg;
-}
-
 function bss_ifindex_list(config)
 {
 	config = filter(config, (line) => !!hostapd.data.iface_fields[split(line, "=")[0]]);
@@ -447,11 +437,54 @@ function bss_ifindex_list(config)
 	}));
 }
 
-function bss_config_hash(config)
+function bss_config_hash(config, skip_reload)
 {
+	if (skip_reload)
+		config = filter(config, (line) => !hostapd.data.reload_fields[split(line, "=")[0]]);
+
 	return hostapd.sha1(remove_file_fields(config) + bss_ifindex_list(config));
 }
 
+function config_changed_fields(old_data, data)
+{
+	let count = {};
+	let fields = {};
+
+	for (let line in old_data)
+		count[line] = (count[line] ?? 0) + 1;
+	for (let line in data)
+		count[line] = (count[line] ?? 0) - 1;
+
+	for (let line, n in count)
+		if (n)
+			fields[split(line, "=")[0]] = true;
+
+	return sort(keys(fields));
+}
+
+function config_restart_fields(fields)
+{
+	return filter(fields, (key) => !hostapd.data.file_fields[key] &&
+				       !hostapd.data.reload_fields[key]);
+}
+
+function bss_restart_fields(config, old_config)
+{
+	let fields = config_changed_fields(old_config.data, config.data);
+
+	if (config.bssid != old_config.bssid)
+		push(fields, "bssid");
+
+	return config_restart_fields(fields);
+}
+
+function config_report_restart(name, ifname, fields)
+{
+	hostapd.printf(`Restart required for ${ifname} on phy ${name}, changed: ${join(", ", fields)}`);
+	hostapd.data.restart_fields[name] ??= {};
+	hostapd.data.restart_fields[name][ifname] = fields;
+}
+
 function bss_find_existing(config, prev_config, prev_hash)
 {
 	let hash = bss_config_hash(config.data);
@@ -467,6 +500,25 @@ function bss_find_existing(config, prev_config, prev_hash)
 	return -1;
 }
 
+// same interface, only settings changed that can be updated in place
+function bss_find_reloadable(config, prev_config, prev_hash)
+{
+	let hash = bss_config_hash(config.data, true);
+
+	for (let i = 0; i < length(prev_config.bss); i++) {
+		if (!prev_hash[i] || prev_config.bss[i].ifname != config.ifname)
+			continue;
+
+		if (hash != bss_config_hash(prev_config.bss[i].data, true))
+			continue;
+
+		prev_hash[i] = null;
+		return i;
+	}
+
+	return -1;
+}
+
 function get_config_bss(config, idx)
 {
 	if (!config.bss[idx]) {
@@ -485,10 +537,20 @@ function iface_reload_config(name, phydev, config, old_config)
 {
 	let phy = phydev.name;
 
-	if (!old_config || !is_equal(old_config.radio, config.radio))
+	if (!old_config)
 		return false;
 
-	if (is_equal(old_config.bss, config.bss))
+	let radio_fields = config_changed_fields(old_config.radio.data, config.radio.data);
+	if (old_config.radio.channel != config.radio.channel)
+		push(radio_fields, "channel");
+
+	let restart = config_restart_fields(radio_fields);
+	if (length(restart)) {
+		config_report_restart(name, "radio", restart);
+		return false;
+	}
+
+	if (!length(radio_fields) && is_equal(old_config.bss, config.bss))
 		return true;
 
 	if (hostapd.data.pending_config[name])
@@ -510,6 +572,17 @@ function iface_reload_config(name, phydev, config, old_config)
 		return false;
 	}
 
+	if (length(radio_fields)) {
+		hostapd.printf(`Update rates on phy ${name}`);
+		if (iface.reload_rates(iface_gen_config(config)) < 0) {
+			hostapd.printf(`Failed to update rates on phy ${name}`);
+			return false;
+		}
+	}
+
+	if (is_equal(old_config.bss, config.bss))
+		return true;
+
 	let macaddr_list = iface_config_macaddr_list(config);
 	let bss_list = [];
 	let bss_list_cfg = [];
@@ -521,15 +594,22 @@ function iface_reload_config(name, phydev, config, old_config)
 	}
 
 	// Step 1: find (possibly renamed) interfaces with the same config
-	// and store them in the new order (with gaps)
+	// and store them in the new order (with gaps). A second pass keeps
+	// interfaces whose changes can be applied in place.
+	for (let reload in [ false, true ])
 	for (let i = 0; i < length(config.bss); i++) {
 		let prev;
 
+		if (bss_list[i])
+			continue;
+
 		// For fullmac devices, the first interface needs to be preserved,
 		// since it's treated as the master
 		if (!i && phy_is_fullmac(phy)) {
 			prev = 0;
 			prev_bss_hash[0] = null;
+		} else if (reload) {
+			prev = bss_find_reloadable(config.bss[i], old_config, prev_bss_hash);
 		} else {
 			prev = bss_find_existing(config.bss[i], old_config, prev_bss_hash);
 		}
@@ -698,23 +778,20 @@ function iface_reload_config(name, phydev, config, old_config)
 		if (is_equal(config.bss[i], bss_list_cfg[i]))
 			continue;
 
-		if (is_equal(bss_remove_file_fields(config.bss[i]),
-		             bss_remove_file_fields(bss_list_cfg[i]))) {
-			hostapd.printf(`Update config data files for bss ${ifname}`);
+		let restart = bss_restart_fields(config.bss[i], bss_list_cfg[i]);
+		if (!length(restart)) {
+			hostapd.printf(`Update config in place for bss ${ifname}`);
 			if (bss.set_config(config_inline, i, true) < 0) {
-				hostapd.printf(`Could not update config data files for bss ${ifname}`);
+				hostapd.printf(`Could not update config in place for bss ${ifname}`);
 				return false;
-			} else {
-				bss.ctrl("RELOAD_WPA_PSK");
-				continue;
 			}
-		}
 
-		bss_reload_psk(bss, config.bss[i], bss_list_cfg[i]);
-		bss_reload_rxkhs(bss, config.bss[i], bss_list_cfg[i]);
-		if (is_equal(config.bss[i], bss_list_cfg[i]))
+			bss_reload_psk(bss, config.bss[i], bss_list_cfg[i]);
+			bss_reload_rxkhs(bss, config.bss[i], bss_list_cfg[i]);
 			continue;
+		}
 
+		config_report_restart(name, ifname, restart);
 		hostapd.printf(`Reload config for bss '${config.bss[0].ifname}' on phy '${name}'`);
 		if (bss.set_config(config_inline, i) < 0) {
 			hostapd.printf(`Failed to set config for bss ${ifname}`);
@@ -730,6 +807,7 @@ function iface_set_config(name, config)
 	let old_config = hostapd.data.config[name];
 
 	hostapd.data.config[name] = config;
+	delete hostapd.data.restart_fields[name];
 
 	if (!config) {
 		hostapd.remove_iface(name);
@@ -1009,7 +1087,8 @@ let main_obj = {
 				hostapd.data.auth_obj.notify("reload", { phy, radio });
 
 			return {
-				pid: hostapd.getpid()
+				pid: hostapd.getpid(),
+				restart: hostapd.data.restart_fields[name] ?? {},
 			};
 		})
 	},
@@ -42,13 +42,153 @@ function iface_start(phydev, iface, macaddr_list)
 		wpas.printf(`Failed to create device ${ifname}: ${ret}`);
 	wdev_set_up(ifname, true);
 	wpas.add_iface(iface.config);
+	iface.networks = iface_networks(ifname, config_parse(iface.config.config_data).networks);
 	iface.running = true;
 }
 
+function config_parse(data)
+{
+	let ret = { global: [], networks: [] };
+	let network;
+
+	for (let line in split(data ?? "", "\n")) {
+		line = trim(line);
+		if (!line || substr(line, 0, 1) == "#")
+			continue;
+
+		if (network != null) {
+			if (line == "}") {
+				push(ret.networks, join("\n", network));
+				network = null;
+			} else {
+				push(network, line);
+			}
+		} else if (line == "network={") {
+			network = [];
+		} else {
+			push(ret.global, line);
+		}
+	}
+
+	return ret;
+}
+
+/* ids of the network blocks, in the order they were read from the config */
+function iface_networks(ifname, networks)
+{
+	let wpa = wpas.interfaces[ifname];
+	if (!wpa)
+		return null;
+
+	let list = split(wpa.ctrl("LIST_NETWORKS") ?? "", "\n");
+	let ret = [];
+
+	for (let i = 1; i < length(list); i++)
+		if (length(list[i]))
+			push(ret, { id: int(split(list[i], "\t")[0]), data: networks[i - 1] });
+
+	if (length(ret) != length(networks))
+		return null;
+
+	return ret;
+}
+
+function network_add(wpa, data)
+{
+	let id = wpa.ctrl("ADD_NETWORK");
+	let enable = true;
+
+	if (!match(id, /^[0-9]+$/))
+		return null;
+
+	for (let line in split(data, "\n")) {
+		line = split(line, "=", 2);
+		if (line[0] == "disabled" && line[1] == "1")
+			enable = false;
+		if (wpa.ctrl(`SET_NETWORK ${id} ${line[0]} ${line[1]}`) != "OK") {
+			wpa.ctrl(`REMOVE_NETWORK ${id}`);
+			return null;
+		}
+	}
+
+	if (enable)
+		wpa.ctrl(`ENABLE_NETWORK ${id}`);
+
+	return { id: int(id), data };
+}
+
+/*
+ * Apply a changed config to the running interface without recreating it.
+ * Only the network blocks and the mesh parameters can change, the networks
+ * that stay the same are left alone, so the link is kept unless its own
+ * network changed.
+ */
+function iface_reload(new_if, old_if)
+{
+	let ifname = old_if.config.iface;
+	let wpa = wpas.interfaces[ifname];
+
+	if (!old_if.running || !old_if.networks || !wpa)
+		return false;
+
+	for (let key in { ...old_if.config, ...new_if.config }) {
+		if (key == "config_data" || substr(key, 0, 5) == "mesh_")
+			continue;
+		if (!is_equal(old_if.config[key], new_if.config[key]))
+			return false;
+	}
+
+	let old_cfg = config_parse(old_if.config.config_data);
+	let new_cfg = config_parse(new_if.config.config_data);
+	if (!is_equal(old_cfg.global, new_cfg.global))
+		return false;
+
+	let networks = [];
+	let pending = [ ...old_if.networks ];
+	let added = [];
+
+	for (let data in new_cfg.networks) {
+		let idx = index(map(pending, (net) => net.data), data);
+
+		if (idx >= 0) {
+			push(networks, pending[idx]);
+			splice(pending, idx, 1);
+		} else {
+			push(added, data);
+		}
+	}
+
+	for (let net in pending)
+		wpa.ctrl(`REMOVE_NETWORK ${net.id}`);
+
+	for (let data in added) {
+		let net = network_add(wpa, data);
+		if (!net) {
+			wpas.printf(`Failed to add network to interface ${ifname}`);
+			return false;
+		}
+		push(networks, net);
+	}
+
+	if (new_if.config.mode == "mesh")
+		wdev_set_mesh_params(ifname, new_if.config);
+
+	new_if.networks = networks;
+	new_if.running = true;
+
+	return true;
+}
+
 function iface_cb(new_if, old_if)
 {
 	if (old_if && new_if && is_equal(old_if.config, new_if.config)) {
 		new_if.running = old_if.running;
+		new_if.networks = old_if.networks;
+		return;
+	}
+
+	if (new_if && old_if && iface_reload(new_if, old_if)) {
+		wpas.printf(`Updated configuration for interface ${old_if.config.iface}`);
 		return;
 	}
 
@@ -16,12 +16,19 @@
 #include <libubox/avl-cmp.h>
 #include <libubox/kvlist.h>
 
+#include <sys/inotify.h>
+#include <sys/prctl.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
 #include <fnmatch.h>
+#include <libgen.h>
 
 #define VENDOR_ID_WISPR 14122
 #define VENDOR_ATTR_SIZE 6
 
+/* delay between a change of the user file and its reload, in usec */
+#define USER_FILE_RELOAD_DELAY 100000
+
 struct radius_parse_attr_data {
 	unsigned int vendor;
 	u8 type;
@@ -42,19 +49,43 @@ struct radius_user_state {
 	struct eap_user data;
 };
 
+/*
+ * Wildcard users are indexed by the literal prefix of their pattern, each
+ * prefix holding its patterns in file order. A lookup only has to fnmatch
+ * the patterns whose prefix is one of the prefixes of the name.
+ */
+struct radius_wildcard {
+	struct list_head list;
+	struct blob_attr *data;
+	const char *pattern;
+	int index;
+};
+
+struct radius_wildcard_prefix {
+	struct avl_node node;
+	struct list_head entries;
+};
+
 struct radius_user_data {
 	struct kvlist users;
 	struct avl_tree user_state;
 	struct blob_attr *wildcard;
+	struct avl_tree wildcard_prefix;
+	struct radius_wildcard *wildcards;
+	size_t wildcard_prefix_len;
 };
 
 struct radius_state {
 	struct radius_server_data *radius;
 	struct eap_config eap;
 
-	struct radius_user_data phase1, phase2;
+	struct radius_user_data *phase1, *phase2;
 	const char *user_file;
 	time_t user_file_ts;
+	int user_file_fd;
+
+	pid_t *workers;
+	int n_workers;
 
 	int n_attrs;
 	struct hostapd_radius_attr *attrs;
@@ -111,21 +142,102 @@ static void radius_tls_event(void *ctx, enum tls_event ev,
 	}
 }
 
-static void radius_userdata_init(struct radius_user_data *u)
+static struct radius_user_data *radius_userdata_alloc(void)
 {
+	struct radius_user_data *u;
+
+	u = calloc(1, sizeof(*u));
+	if (!u)
+		return NULL;
+
 	kvlist_init(&u->users, kvlist_blob_len);
 	avl_init(&u->user_state, avl_strcmp, false, NULL);
+	avl_init(&u->wildcard_prefix, avl_strcmp, false, NULL);
+
+	return u;
 }
 
 static void radius_userdata_free(struct radius_user_data *u)
 {
+	struct radius_wildcard_prefix *p, *ptmp;
 	struct radius_user_state *s, *tmp;
 
+	if (!u)
+		return;
+
 	kvlist_free(&u->users);
+	avl_remove_all_elements(&u->wildcard_prefix, p, node, ptmp)
+		free(p);
+	free(u->wildcards);
 	free(u->wildcard);
-	u->wildcard = NULL;
 	avl_remove_all_elements(&u->user_state, s, node, tmp)
 		free(s);
+	free(u);
+}
+
+static size_t radius_wildcard_prefix_len(const char *pattern)
+{
+	return strcspn(pattern, "*?[\\");
+}
+
+static void
+radius_wildcard_add(struct radius_user_data *u, struct radius_wildcard *w)
+{
+	struct radius_wildcard_prefix *p;
+	size_t len = radius_wildcard_prefix_len(w->pattern);
+	char *key;
+
+	key = alloca(len + 1);
+	memcpy(key, w->pattern, len);
+	key[len] = 0;
+
+	p = avl_find_element(&u->wildcard_prefix, key, p, node);
+	if (!p) {
+		char *key_buf;
+
+		p = calloc_a(sizeof(*p), &key_buf, len + 1);
+		if (!p)
+			return;
+
+		INIT_LIST_HEAD(&p->entries);
+		p->node.key = strcpy(key_buf, key);
+		avl_insert(&u->wildcard_prefix, &p->node);
+	}
+
+	list_add_tail(&w->list, &p->entries);
+	if (len > u->wildcard_prefix_len)
+		u->wildcard_prefix_len = len;
+}
+
+static void
+radius_wildcard_load(struct radius_user_data *u)
+{
+	static const struct blobmsg_policy policy = {
+		"name", BLOBMSG_TYPE_STRING
+	};
+	struct blob_attr *cur, *pattern;
+	int rem, n = 0;
+
+	u->wildcards = calloc(blobmsg_check_array(u->wildcard, BLOBMSG_TYPE_UNSPEC) + 1,
+			      sizeof(*u->wildcards));
+	if (!u->wildcards)
+		return;
+
+	blobmsg_for_each_attr(cur, u->wildcard, rem) {
+		struct radius_wildcard *w = &u->wildcards[n];
+
+		if (blobmsg_type(cur) != BLOBMSG_TYPE_TABLE)
+			continue;
+
+		blobmsg_parse(&policy, 1, &pattern, blobmsg_data(cur), blobmsg_len(cur));
+		if (!pattern)
+			continue;
+
+		w->data = cur;
+		w->pattern = blobmsg_get_string(pattern);
+		w->index = n++;
+		radius_wildcard_add(u, w);
+	}
 }
 
 static void
@@ -151,12 +263,90 @@ radius_userdata_load(struct radius_user_data *u, struct blob_attr *data)
 	blobmsg_for_each_attr(cur, tb[USERSTATE_USERS], rem)
 		kvlist_set(&u->users, blobmsg_name(cur), cur);
 
-	if (tb[USERSTATE_WILDCARD])
+	if (tb[USERSTATE_WILDCARD]) {
 		u->wildcard = blob_memdup(tb[USERSTATE_WILDCARD]);
+		radius_wildcard_load(u);
+	}
+}
+
+static struct blob_attr *
+radius_wildcard_get(struct radius_user_data *u, const char *name)
+{
+	struct radius_wildcard *w, *match = NULL;
+	struct radius_wildcard_prefix *p;
+	size_t len = strlen(name);
+	char *prefix;
+
+	if (avl_is_empty(&u->wildcard_prefix))
+		return NULL;
+
+	if (len > u->wildcard_prefix_len)
+		len = u->wildcard_prefix_len;
+
+	prefix = alloca(len + 1);
+	memcpy(prefix, name, len);
+	prefix[len] = 0;
+
+	while (1) {
+		p = avl_find_element(&u->wildcard_prefix, prefix, p, node);
+		if (p) {
+			list_for_each_entry(w, &p->entries, list) {
+				if (match && w->index > match->index)
+					break;
+
+				if (!fnmatch(w->pattern, name, 0)) {
+					match = w;
+					break;
+				}
+			}
+		}
+
+		if (!len)
+			break;
+
+		prefix[--len] = 0;
+	}
+
+	return match ? match->data : NULL;
 }
 
+static struct blob_attr *
+radius_user_get(struct radius_user_data *s, const char *name)
+{
+	struct blob_attr *cur;
+
+	cur = kvlist_get(&s->users, name);
+	if (cur)
+		return cur;
+
+	return radius_wildcard_get(s, name);
+}
+
+/*
+ * Move the user states of the identities that resolve to the same entry
+ * in the new data as in the old one, so that only the users that were
+ * added or changed get parsed again.
+ */
 static void
-load_userfile(struct radius_state *s)
+radius_userdata_move_state(struct radius_user_data *u,
+			   struct radius_user_data *old)
+{
+	struct radius_user_state *s, *tmp;
+	struct blob_attr *cur, *prev;
+
+	avl_for_each_element_safe(&old->user_state, s, node, tmp) {
+		prev = radius_user_get(old, s->node.key);
+		cur = radius_user_get(u, s->node.key);
+		if (!prev || !cur || !blob_attr_equal(prev, cur))
+			continue;
+
+		avl_delete(&old->user_state, &s->node);
+		avl_insert(&u->user_state, &s->node);
+	}
+}
+
+static void
+load_userfile(struct radius_state *s, bool force)
 {
 	enum {
 		USERDATA_PHASE1,
@@ -168,6 +358,7 @@ load_userfile(struct radius_state *s)
 		[USERDATA_PHASE2] = { "phase2", BLOBMSG_TYPE_TABLE },
 	};
 	struct blob_attr *tb[__USERDATA_MAX], *cur;
+	struct radius_user_data *phase1, *phase2;
 	static struct blob_buf b;
 	struct stat st;
 	int rem;
@@ -175,50 +366,124 @@ load_userfile(struct radius_state *s)
 	if (stat(s->user_file, &st))
 		return;
 
-	if (s->user_file_ts == st.st_mtime)
+	if (!force && s->user_file_ts == st.st_mtime)
 		return;
 
 	s->user_file_ts = st.st_mtime;
-	radius_userdata_free(&s->phase1);
-	radius_userdata_free(&s->phase2);
 
 	blob_buf_init(&b, 0);
-	blobmsg_add_json_from_file(&b, s->user_file);
+	if (!blobmsg_add_json_from_file(&b, s->user_file)) {
+		wpa_printf(MSG_INFO, "failed to parse user file %s, keeping the previous users\n",
+			   s->user_file);
+		goto out;
+	}
+
+	phase1 = radius_userdata_alloc();
+	phase2 = radius_userdata_alloc();
+	if (!phase1 || !phase2) {
+		radius_userdata_free(phase1);
+		radius_userdata_free(phase2);
+		goto out;
+	}
+
 	blobmsg_parse(policy, __USERDATA_MAX, tb, blob_data(b.head), blob_len(b.head));
-	radius_userdata_load(&s->phase1, tb[USERDATA_PHASE1]);
-	radius_userdata_load(&s->phase2, tb[USERDATA_PHASE2]);
+	radius_userdata_load(phase1, tb[USERDATA_PHASE1]);
+	radius_userdata_load(phase2, tb[USERDATA_PHASE2]);
+
+	radius_userdata_move_state(phase1, s->phase1);
+	radius_userdata_move_state(phase2, s->phase2);
+	radius_userdata_free(s->phase1);
+	radius_userdata_free(s->phase2);
+	s->phase1 = phase1;
+	s->phase2 = phase2;
 
+out:
 	blob_buf_free(&b);
 }
 
-static struct blob_attr *
-radius_user_get(struct radius_user_data *s, const char *name)
+static void radius_userfile_reload(void *eloop_ctx, void *user_ctx)
 {
-	struct blob_attr *cur;
-	int rem;
+	load_userfile(eloop_ctx, true);
+}
 
-	cur = kvlist_get(&s->users, name);
-	if (cur)
-		return cur;
+static void radius_userfile_changed(struct radius_state *s)
+{
+	eloop_cancel_timeout(radius_userfile_reload, s, NULL);
+	eloop_register_timeout(0, USER_FILE_RELOAD_DELAY,
+			       radius_userfile_reload, s, NULL);
+}
 
-	blobmsg_for_each_attr(cur, s->wildcard, rem) {
-		static const struct blobmsg_policy policy = {
-			"name", BLOBMSG_TYPE_STRING
-		};
-		struct blob_attr *pattern;
+static void radius_userfile_event(int sock, void *eloop_ctx, void *sock_ctx)
+{
+	struct radius_state *s = eloop_ctx;
+	const char *name = sock_ctx;
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event *ev;
+	bool changed = false;
+	ssize_t len;
+	char *pos;
+
+	while ((len = read(sock, buf, sizeof(buf))) > 0) {
+		for (pos = buf; pos < buf + len; pos += sizeof(*ev) + ev->len) {
+			ev = (const struct inotify_event *)pos;
+			if ((ev->mask & IN_Q_OVERFLOW) ||
+			    (ev->len && !strcmp(ev->name, name)))
+				changed = true;
+		}
+	}
 
-		if (blobmsg_type(cur) != BLOBMSG_TYPE_TABLE)
-			continue;
+	if (changed)
+		radius_userfile_changed(s);
+}
 
-		blobmsg_parse(&policy, 1, &pattern, blobmsg_data(cur), blobmsg_len(cur));
-		if (!name)
-			continue;
+static void radius_userfile_signal(int sig, void *signal_ctx)
+{
+	struct radius_state *s = signal_ctx;
+	int i;
 
-		if (!fnmatch(blobmsg_get_string(pattern), name, 0))
-			return cur;
+	for (i = 0; i < s->n_workers; i++)
+		kill(s->workers[i], sig);
+
+	radius_userfile_changed(s);
+}
+
+/*
+ * Reload the user file when it is written or replaced, and on SIGHUP.
+ * The directory is watched, since editors and provisioning tools usually
+ * replace the file by renaming a new one over it. Without inotify, the
+ * mtime of the file is checked on each lookup instead.
+ */
+static void radius_userfile_watch(struct radius_state *s)
+{
+	char *dir, *name;
+
+	eloop_register_signal_reconfig(radius_userfile_signal, s);
+
+	dir = strdup(s->user_file);
+	name = strdup(s->user_file);
+	if (!dir || !name)
+		goto error;
+
+	s->user_file_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (s->user_file_fd < 0)
+		goto error;
+
+	if (inotify_add_watch(s->user_file_fd, dirname(dir),
+			      IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0 ||
+	    eloop_register_read_sock(s->user_file_fd, radius_userfile_event,
+				     s, basename(name))) {
+		close(s->user_file_fd);
+		goto error;
 	}
 
-	return NULL;
+	free(dir);
+	return;
+
+error:
+	wpa_printf(MSG_INFO, "failed to watch user file %s\n", s->user_file);
+	s->user_file_fd = -1;
+	free(dir);
+	free(name);
 }
 
 static struct radius_parse_attr_data *
@@ -520,7 +785,7 @@ static int radius_get_eap_user(void *ctx, const u8 *identity,
 			       struct eap_user *user)
 {
 	struct radius_state *s = ctx;
-	struct radius_user_data *u = phase2 ? &s->phase2 : &s->phase1;
+	struct radius_user_data *u;
 	struct blob_attr *entry;
 	struct eap_user *data;
 	char *id;
@@ -528,8 +793,10 @@ static int radius_get_eap_user(void *ctx, const u8 *identity,
 	if (identity_len > 512)
 		return -1;
 
-	load_userfile(s);
+	if (s->user_file_fd < 0)
+		load_userfile(s, false);
 
+	u = phase2 ? s->phase2 : s->phase1;
 	id = alloca(identity_len + 1);
 	memcpy(id, identity, identity_len);
 	id[identity_len] = 0;
@@ -555,12 +822,93 @@ static int radius_get_eap_user(void *ctx, const u8 *identity,
 	return 0;
 }
 
+/*
+ * The EAP sessions, and with them the TLS handshakes, are spread across
+ * worker processes, each running its own radius server on the same ports.
+ * The kernel hashes incoming requests by source address and port, so all
+ * requests of a NAS stay on one worker, which keeps its EAP sessions and
+ * the TLS sessions its returning clients resume. The workers are forked
+ * before anything else is set up, so that none of them share the state
+ * of the event loop or the TLS library.
+ */
+static int radius_start_workers(struct radius_state *s, int n)
+{
+	pid_t parent = getpid();
+	pid_t pid;
+	int i;
+
+	if (n <= 1)
+		return 0;
+
+	s->workers = calloc(n - 1, sizeof(*s->workers));
+	if (!s->workers)
+		return -1;
+
+	for (i = 1; i < n; i++) {
+		pid = fork();
+		if (pid < 0) {
+			wpa_printf(MSG_ERROR, "failed to start worker: %s\n",
+				   strerror(errno));
+			return -1;
+		}
+
+		if (!pid) {
+			free(s->workers);
+			s->workers = NULL;
+			s->n_workers = 0;
+
+			prctl(PR_SET_PDEATHSIG, SIGTERM);
+			if (getppid() != parent)
+				exit(0);
+
+			return 0;
+		}
+
+		s->workers[s->n_workers++] = pid;
+	}
+
+	return 0;
+}
+
+static void radius_worker_exit(int sig, void *signal_ctx)
+{
+	struct radius_state *s = signal_ctx;
+	pid_t pid;
+	int i;
+
+	while ((pid = waitpid(-1, NULL, WNOHANG)) > 0) {
+		for (i = 0; i < s->n_workers; i++) {
+			if (s->workers[i] != pid)
+				continue;
+
+			/* let procd restart the whole server */
+			wpa_printf(MSG_ERROR, "worker %d exited\n", pid);
+			s->workers[i] = s->workers[--s->n_workers];
+			eloop_terminate();
+			break;
+		}
+	}
+}
+
+static void radius_stop_workers(struct radius_state *s)
+{
+	int i;
+
+	for (i = 0; i < s->n_workers; i++)
+		kill(s->workers[i], SIGTERM);
+
+	free(s->workers);
+	s->workers = NULL;
+	s->n_workers = 0;
+}
+
 static int radius_setup(struct radius_state *s, struct radius_config *c)
 {
 	struct eap_config *eap = &s->eap;
 	struct tls_config conf = {
 		.event_cb = radius_tls_event,
 		.tls_flags = TLS_CONN_DISABLE_TLSv1_3,
+		.tls_session_lifetime = eap->tls_session_lifetime,
 		.cb_ctx = s,
 	};
 
@@ -593,8 +941,13 @@ static int radius_setup(struct radius_state *s, struct radius_config *c)
 static int radius_init(struct radius_state *s)
 {
 	memset(s, 0, sizeof(*s));
-	radius_userdata_init(&s->phase1);
-	radius_userdata_init(&s->phase2);
+	s->user_file_fd = -1;
+	s->phase1 = radius_userdata_alloc();
+	s->phase2 = radius_userdata_alloc();
+	if (!s->phase1 || !s->phase2)
+		return -1;
+
+	return 0;
 }
 
 static void radius_deinit(struct radius_state *s)
@@ -605,8 +958,15 @@ static void radius_deinit(struct radius_state *s)
 	if (s->eap.ssl_ctx)
 		tls_deinit(s->eap.ssl_ctx);
 
-	radius_userdata_free(&s->phase1);
-	radius_userdata_free(&s->phase2);
+	if (s->user_file_fd >= 0) {
+		eloop_unregister_read_sock(s->user_file_fd);
+		close(s->user_file_fd);
+	}
+
+	radius_stop_workers(s);
+
+	radius_userdata_free(s->phase1);
+	radius_userdata_free(s->phase2);
 }
 
 static int usage(const char *progname)
@@ -620,21 +980,20 @@ int radius_main(int argc, char **argv)
 	static struct radius_state state = {};
 	static struct radius_config config = {};
 	const char *progname = argv[0];
+	int workers = 1;
 	int ret = 0;
 	int ch;
 
 	wpa_debug_setup_stdout();
 	wpa_debug_level = 0;
 
-	if (eloop_init()) {
-		wpa_printf(MSG_ERROR, "Failed to initialize event loop");
+	eap_server_register_methods();
+	if (radius_init(&state)) {
+		wpa_printf(MSG_ERROR, "Failed to allocate user data");
 		return 1;
 	}
 
-	eap_server_register_methods();
-	radius_init(&state);
-
-	while ((ch = getopt(argc, argv, "6C:c:d:i:k:K:p:P:s:u:")) != -1) {
+	while ((ch = getopt(argc, argv, "6C:c:d:i:k:K:p:P:s:t:u:w:")) != -1) {
 		switch (ch) {
 		case '6':
 			config.radius.ipv6 = 1;
@@ -685,9 +1044,17 @@ int radius_main(int argc, char **argv)
 		case 's':
 			config.radius.client_file = optarg;
 			break;
+		case 't':
+			state.eap.tls_session_lifetime = atoi(optarg);
+			break;
 		case 'u':
 			state.user_file = optarg;
 			break;
+		case 'w':
+			workers = atoi(optarg);
+			if (workers <= 0)
+				workers = sysconf(_SC_NPROCESSORS_ONLN);
+			break;
 		default:
 			return usage(progname);
 		}
@@ -700,11 +1067,26 @@ int radius_main(int argc, char **argv)
 		goto out;
 	}
 
+	if (radius_start_workers(&state, workers)) {
+		ret = 1;
+		goto out;
+	}
+
+	if (eloop_init()) {
+		wpa_printf(MSG_ERROR, "Failed to initialize event loop");
+		ret = 1;
+		goto out;
+	}
+
+	if (state.n_workers)
+		eloop_register_signal(SIGCHLD, radius_worker_exit, &state);
+
 	ret = radius_setup(&state, &config);
 	if (ret)
 		goto out;
 
-	load_userfile(&state);
+	radius_userfile_watch(&state);
+	load_userfile(&state, true);
 	eloop_run();
 
 out:
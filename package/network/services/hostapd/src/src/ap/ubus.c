@@ -37,6 +37,18 @@ static inline struct hostapd_data *get_hapd_from_object(struct ubus_object *obj)
 struct ubus_banned_client {
 	struct avl_node avl;
 	u8 addr[ETH_ALEN];
+	struct os_reltime expire;
+};
+
+/* probe request decision of the subscribers, reused for verdict_ttl */
+struct ubus_probe_verdict {
+	struct avl_node avl;
+	u8 addr[ETH_ALEN];
+	struct hostapd_data *hapd;
+	struct ubus_notify_request nreq;
+	struct os_reltime expire;
+	bool pending;
+	int resp;
 };
 
 static void ubus_reconnect_timeout(void *eloop_data, void *user_ctx)
@@ -119,17 +131,60 @@ static void hostapd_notify_ubus(struct ubus_object *obj, char *bssname, char *ev
 }
 
 static void
-hostapd_bss_del_ban(void *eloop_data, void *user_ctx)
+hostapd_bss_del_ban(struct hostapd_data *hapd, struct ubus_banned_client *ban)
 {
-	struct ubus_banned_client *ban = eloop_data;
-	struct hostapd_data *hapd = user_ctx;
-
 	avl_delete(&hapd->ubus.banned, &ban->avl);
 	free(ban);
 }
 
+static void hostapd_bss_ban_timeout(void *eloop_data, void *user_ctx);
+
+/* a single timeout per BSS, set for the ban that expires first */
 static void
-hostapd_bss_ban_client(struct hostapd_data *hapd, u8 *addr, int time)
+hostapd_bss_ban_schedule(struct hostapd_data *hapd)
+{
+	struct ubus_banned_client *ban, *next = NULL;
+	struct os_reltime now, left;
+
+	eloop_cancel_timeout(hostapd_bss_ban_timeout, hapd, NULL);
+
+	avl_for_each_element(&hapd->ubus.banned, ban, avl) {
+		if (!next || os_reltime_before(&ban->expire, &next->expire))
+			next = ban;
+	}
+
+	if (!next)
+		return;
+
+	os_get_reltime(&now);
+	if (os_reltime_before(&now, &next->expire))
+		os_reltime_sub(&next->expire, &now, &left);
+	else
+		left.sec = left.usec = 0;
+
+	eloop_register_timeout(left.sec, left.usec, hostapd_bss_ban_timeout,
+			       hapd, NULL);
+}
+
+static void
+hostapd_bss_ban_timeout(void *eloop_data, void *user_ctx)
+{
+	struct hostapd_data *hapd = eloop_data;
+	struct ubus_banned_client *ban, *tmp;
+	struct os_reltime now;
+
+	os_get_reltime(&now);
+	avl_for_each_element_safe(&hapd->ubus.banned, ban, avl, tmp) {
+		if (!os_reltime_before(&now, &ban->expire))
+			hostapd_bss_del_ban(hapd, ban);
+	}
+
+	hostapd_bss_ban_schedule(hapd);
+}
+
+/* update a ban without rescheduling the timeout, time is in ms */
+static void
+hostapd_bss_set_ban(struct hostapd_data *hapd, const u8 *addr, int time)
 {
 	struct ubus_banned_client *ban;
 
@@ -142,18 +197,234 @@ hostapd_bss_ban_client(struct hostapd_data *hapd, u8 *addr, int time)
 			return;
 
 		ban = os_zalloc(sizeof(*ban));
+		if (!ban)
+			return;
+
 		memcpy(ban->addr, addr, sizeof(ban->addr));
 		ban->avl.key = ban->addr;
 		avl_insert(&hapd->ubus.banned, &ban->avl);
-	} else {
-		eloop_cancel_timeout(hostapd_bss_del_ban, ban, hapd);
-		if (!time) {
-			hostapd_bss_del_ban(ban, hapd);
-			return;
+	} else if (!time) {
+		hostapd_bss_del_ban(hapd, ban);
+		return;
+	}
+
+	os_get_reltime(&ban->expire);
+	ban->expire.sec += time / 1000;
+	ban->expire.usec += (time % 1000) * 1000;
+	if (ban->expire.usec >= 1000000) {
+		ban->expire.sec++;
+		ban->expire.usec -= 1000000;
+	}
+}
+
+static void
+hostapd_bss_ban_client(struct hostapd_data *hapd, u8 *addr, int time)
+{
+	hostapd_bss_set_ban(hapd, addr, time);
+	hostapd_bss_ban_schedule(hapd);
+}
+
+static void
+hostapd_bss_flush_bans(struct hostapd_data *hapd)
+{
+	struct ubus_banned_client *ban, *tmp;
+
+	eloop_cancel_timeout(hostapd_bss_ban_timeout, hapd, NULL);
+	avl_for_each_element_safe(&hapd->ubus.banned, ban, avl, tmp)
+		hostapd_bss_del_ban(hapd, ban);
+}
+
+static void
+hostapd_verdict_set(struct ubus_probe_verdict *v, int resp)
+{
+	v->resp = resp;
+	v->pending = false;
+	os_get_reltime(&v->expire);
+	v->expire.sec += v->hapd->ubus.verdict_ttl;
+}
+
+static void
+hostapd_verdict_timeout(void *eloop_data, void *user_ctx)
+{
+	struct ubus_probe_verdict *v = eloop_data;
+
+	/* keep the last verdict if nobody answered in time */
+	ubus_abort_request(ctx, &v->nreq.req);
+	hostapd_verdict_set(v, v->resp);
+}
+
+static void
+hostapd_verdict_status_cb(struct ubus_notify_request *req, int idx, int ret)
+{
+	struct ubus_probe_verdict *v = container_of(req, struct ubus_probe_verdict, nreq);
+
+	v->resp = ret;
+}
+
+static void
+hostapd_verdict_complete_cb(struct ubus_notify_request *req, int idx, int ret)
+{
+	struct ubus_probe_verdict *v = container_of(req, struct ubus_probe_verdict, nreq);
+
+	eloop_cancel_timeout(hostapd_verdict_timeout, v, NULL);
+	hostapd_verdict_set(v, v->resp);
+}
+
+static void
+hostapd_verdict_free(struct hostapd_data *hapd, struct ubus_probe_verdict *v)
+{
+	if (v->pending) {
+		eloop_cancel_timeout(hostapd_verdict_timeout, v, NULL);
+		ubus_abort_request(ctx, &v->nreq.req);
+	}
+
+	avl_delete(&hapd->ubus.verdicts, &v->avl);
+	free(v);
+}
+
+static void
+hostapd_verdict_flush(struct hostapd_data *hapd, bool all)
+{
+	struct ubus_probe_verdict *v, *tmp;
+	struct os_reltime now;
+
+	os_get_reltime(&now);
+	avl_for_each_element_safe(&hapd->ubus.verdicts, v, avl, tmp) {
+		if (all || (!v->pending && os_reltime_before(&v->expire, &now)))
+			hostapd_verdict_free(hapd, v);
+	}
+}
+
+static void
+hostapd_verdict_gc(void *eloop_data, void *user_ctx)
+{
+	struct hostapd_data *hapd = eloop_data;
+
+	hostapd_verdict_flush(hapd, false);
+	eloop_register_timeout(hapd->ubus.verdict_ttl, 0, hostapd_verdict_gc, hapd, NULL);
+}
+
+/*
+ * Ask the subscribers about a probe request without waiting for them. The
+ * frame is answered with the previous verdict (or accepted if there is none
+ * yet) and the answer is used for the following probes of the client.
+ */
+static int
+hostapd_verdict_query(struct hostapd_data *hapd, struct ubus_probe_verdict *v,
+		      const u8 *addr, const char *type)
+{
+	if (!v) {
+		v = os_zalloc(sizeof(*v));
+		if (!v)
+			return WLAN_STATUS_SUCCESS;
+
+		memcpy(v->addr, addr, sizeof(v->addr));
+		v->avl.key = v->addr;
+		v->hapd = hapd;
+		avl_insert(&hapd->ubus.verdicts, &v->avl);
+	}
+
+	memset(&v->nreq, 0, sizeof(v->nreq));
+	if (ubus_notify_async(ctx, &hapd->ubus.obj, type, b.head, &v->nreq))
+		return v->resp;
+
+	v->nreq.status_cb = hostapd_verdict_status_cb;
+	v->nreq.complete_cb = hostapd_verdict_complete_cb;
+	ubus_complete_request_async(ctx, &v->nreq.req);
+	v->pending = true;
+	eloop_register_timeout(0, 100 * 1000, hostapd_verdict_timeout, v, NULL);
+
+	return v->resp;
+}
+
+/* probe requests of a client seen during the current probe_interval */
+struct ubus_probe_summary {
+	struct avl_node avl;
+	u8 addr[ETH_ALEN];
+	struct os_reltime first_seen;
+	struct os_reltime last_seen;
+	unsigned int count;
+	int signal;
+};
+
+static void
+hostapd_probe_summary_flush(struct hostapd_data *hapd, bool notify)
+{
+	struct ubus_probe_summary *ps, *tmp;
+	struct os_reltime now, age;
+	void *list, *c;
+
+	if (avl_is_empty(&hapd->ubus.probes))
+		return;
+
+	notify = notify && hapd->ubus.obj.has_subscribers;
+	if (notify) {
+		os_get_reltime(&now);
+		blob_buf_init(&b, 0);
+		blobmsg_add_string(&b, "ifname", hapd->conf->iface);
+		blobmsg_add_u32(&b, "freq", hapd->iface->freq);
+		list = blobmsg_open_array(&b, "clients");
+	}
+
+	avl_for_each_element_safe(&hapd->ubus.probes, ps, avl, tmp) {
+		if (notify) {
+			c = blobmsg_open_table(&b, NULL);
+			blobmsg_add_macaddr(&b, "address", ps->addr);
+			os_reltime_sub(&now, &ps->first_seen, &age);
+			blobmsg_add_u32(&b, "first_seen", age.sec * 1000 + age.usec / 1000);
+			os_reltime_sub(&now, &ps->last_seen, &age);
+			blobmsg_add_u32(&b, "last_seen", age.sec * 1000 + age.usec / 1000);
+			blobmsg_add_u32(&b, "count", ps->count);
+			if (ps->signal)
+				blobmsg_add_u32(&b, "signal", ps->signal);
+			blobmsg_close_table(&b, c);
 		}
+
+		avl_delete(&hapd->ubus.probes, &ps->avl);
+		free(ps);
+	}
+
+	if (notify) {
+		blobmsg_close_array(&b, list);
+		ubus_notify(ctx, &hapd->ubus.obj, "probe-summary", b.head, -1);
+	}
+}
+
+static void
+hostapd_probe_summary_timeout(void *eloop_data, void *user_ctx)
+{
+	struct hostapd_data *hapd = eloop_data;
+
+	hostapd_probe_summary_flush(hapd, true);
+	eloop_register_timeout(hapd->ubus.probe_interval / 1000,
+			       (hapd->ubus.probe_interval % 1000) * 1000,
+			       hostapd_probe_summary_timeout, hapd, NULL);
+}
+
+static void
+hostapd_probe_summary_add(struct hostapd_data *hapd, const u8 *addr, int signal)
+{
+	struct ubus_probe_summary *ps;
+	struct os_reltime now;
+
+	os_get_reltime(&now);
+	ps = avl_find_element(&hapd->ubus.probes, addr, ps, avl);
+	if (!ps) {
+		ps = os_zalloc(sizeof(*ps));
+		if (!ps)
+			return;
+
+		memcpy(ps->addr, addr, sizeof(ps->addr));
+		ps->avl.key = ps->addr;
+		ps->first_seen = now;
+		ps->signal = signal;
+		avl_insert(&hapd->ubus.probes, &ps->avl);
 	}
 
-	eloop_register_timeout(0, time * 1000, hostapd_bss_del_ban, ban, hapd);
+	ps->last_seen = now;
+	ps->count++;
+	if (signal && (!ps->signal || signal > ps->signal))
+		ps->signal = signal;
 }
 
 static int
@@ -235,6 +506,98 @@ hostapd_parse_capab_blobmsg(struct sta_info *sta)
 	blobmsg_close_table(&b, v);
 }
 
+/* driver data of a station, shared by get_clients calls that accept it */
+struct ubus_sta_data {
+	struct avl_node avl;
+	u8 addr[ETH_ALEN];
+	struct os_reltime updated;
+	struct hostap_sta_driver_data data;
+	int ret;
+	bool seen;
+};
+
+static int
+hostapd_ubus_read_sta_data(struct hostapd_data *hapd, struct sta_info *sta,
+			   struct hostap_sta_driver_data *data,
+			   unsigned int max_age)
+{
+	struct ubus_sta_data *sd;
+	struct os_reltime now, age;
+
+	if (!max_age)
+		return hostapd_drv_read_sta_data(hapd, data, sta->addr);
+
+	os_get_reltime(&now);
+	sd = avl_find_element(&hapd->ubus.sta_data, sta->addr, sd, avl);
+	if (!sd) {
+		sd = os_zalloc(sizeof(*sd));
+		if (!sd)
+			return hostapd_drv_read_sta_data(hapd, data, sta->addr);
+
+		memcpy(sd->addr, sta->addr, sizeof(sd->addr));
+		sd->avl.key = sd->addr;
+		avl_insert(&hapd->ubus.sta_data, &sd->avl);
+		goto update;
+	}
+
+	os_reltime_sub(&now, &sd->updated, &age);
+	if (age.sec * 1000 + age.usec / 1000 <= max_age)
+		goto out;
+
+update:
+	sd->ret = hostapd_drv_read_sta_data(hapd, &sd->data, sta->addr);
+	sd->updated = now;
+out:
+	sd->seen = true;
+	*data = sd->data;
+
+	return sd->ret;
+}
+
+static void
+hostapd_ubus_flush_sta_data(struct hostapd_data *hapd, bool all)
+{
+	struct ubus_sta_data *sd, *tmp;
+
+	avl_for_each_element_safe(&hapd->ubus.sta_data, sd, avl, tmp) {
+		if (sd->seen && !all) {
+			sd->seen = false;
+			continue;
+		}
+
+		avl_delete(&hapd->ubus.sta_data, &sd->avl);
+		free(sd);
+	}
+}
+
+enum {
+	CLIENT_FIELD_RRM,
+	CLIENT_FIELD_EXT_CAPAB,
+	CLIENT_FIELD_SIGNATURE,
+	CLIENT_FIELD_DRIVER,
+	CLIENT_FIELD_CAPAB,
+	__CLIENT_FIELD_MAX
+};
+
+static const char * const client_fields[__CLIENT_FIELD_MAX] = {
+	[CLIENT_FIELD_RRM] = "rrm",
+	[CLIENT_FIELD_EXT_CAPAB] = "extended_capabilities",
+	[CLIENT_FIELD_SIGNATURE] = "signature",
+	[CLIENT_FIELD_DRIVER] = "driver",
+	[CLIENT_FIELD_CAPAB] = "capabilities",
+};
+
+enum {
+	GET_CLIENTS_FIELDS,
+	GET_CLIENTS_MAX_AGE,
+	__GET_CLIENTS_MAX
+};
+
+static const struct blobmsg_policy get_clients_policy[__GET_CLIENTS_MAX] = {
+	[GET_CLIENTS_FIELDS] = { "fields", BLOBMSG_TYPE_ARRAY },
+	[GET_CLIENTS_MAX_AGE] = { "max_age", BLOBMSG_TYPE_INT32 },
+};
+
 static int
 hostapd_bss_get_clients(struct ubus_context *ctx, struct ubus_object *obj,
 			struct ubus_request_data *req, const char *method,
@@ -242,7 +605,10 @@ hostapd_bss_get_clients(struct ubus_context *ctx, struct ubus_object *obj,
 {
 	struct hostapd_data *hapd = container_of(obj, struct hostapd_data, ubus.obj);
 	struct hostap_sta_driver_data sta_driver_data;
+	struct blob_attr *tb[__GET_CLIENTS_MAX];
 	struct sta_info *sta;
+	unsigned int fields = ~0U;
+	unsigned int max_age = 0;
 	void *list, *c;
 	char mac_buf[20];
 	static const struct {
@@ -262,6 +628,34 @@ hostapd_bss_get_clients(struct ubus_context *ctx, struct ubus_object *obj,
 		{ "mfp", WLAN_STA_MFP },
 	};
 
+	blobmsg_parse(get_clients_policy, __GET_CLIENTS_MAX, tb,
+		      blob_data(msg), blob_len(msg));
+
+	if (tb[GET_CLIENTS_FIELDS]) {
+		struct blob_attr *cur;
+		int rem, i;
+
+		if (blobmsg_check_array(tb[GET_CLIENTS_FIELDS],
+					BLOBMSG_TYPE_STRING) < 0)
+			return UBUS_STATUS_INVALID_ARGUMENT;
+
+		fields = 0;
+		blobmsg_for_each_attr(cur, tb[GET_CLIENTS_FIELDS], rem) {
+			for (i = 0; i < __CLIENT_FIELD_MAX; i++) {
+				if (!strcmp(blobmsg_get_string(cur), client_fields[i]))
+					break;
+			}
+
+			if (i == __CLIENT_FIELD_MAX)
+				return UBUS_STATUS_INVALID_ARGUMENT;
+
+			fields |= BIT(i);
+		}
+	}
+
+	if (tb[GET_CLIENTS_MAX_AGE])
+		max_age = blobmsg_get_u32(tb[GET_CLIENTS_MAX_AGE]);
+
 	blob_buf_init(&b, 0);
 	blobmsg_add_u32(&b, "freq", hapd->iface->freq);
 	list = blobmsg_open_table(&b, "clients");
@@ -279,29 +673,37 @@ hostapd_bss_get_clients(struct ubus_context *ctx, struct ubus_object *obj,
 		blobmsg_add_u8(&b, "mbo", !!(sta->cell_capa));
 #endif
 
-		r = blobmsg_open_array(&b, "rrm");
-		for (i = 0; i < ARRAY_SIZE(sta->rrm_enabled_capa); i++)
-			blobmsg_add_u32(&b, "", sta->rrm_enabled_capa[i]);
-		blobmsg_close_array(&b, r);
+		if (fields & BIT(CLIENT_FIELD_RRM)) {
+			r = blobmsg_open_array(&b, "rrm");
+			for (i = 0; i < ARRAY_SIZE(sta->rrm_enabled_capa); i++)
+				blobmsg_add_u32(&b, "", sta->rrm_enabled_capa[i]);
+			blobmsg_close_array(&b, r);
+		}
 
-		r = blobmsg_open_array(&b, "extended_capabilities");
-		/* Check if client advertises extended capabilities */
-		if (sta->ext_capability && sta->ext_capability[0] > 0) {
-			for (i = 0; i < sta->ext_capability[0]; i++) {
-				blobmsg_add_u32(&b, "", sta->ext_capability[1 + i]);
+		if (fields & BIT(CLIENT_FIELD_EXT_CAPAB)) {
+			r = blobmsg_open_array(&b, "extended_capabilities");
+			/* Check if client advertises extended capabilities */
+			if (sta->ext_capability && sta->ext_capability[0] > 0) {
+				for (i = 0; i < sta->ext_capability[0]; i++) {
+					blobmsg_add_u32(&b, "", sta->ext_capability[1 + i]);
+				}
 			}
+			blobmsg_close_array(&b, r);
 		}
-		blobmsg_close_array(&b, r);
 
 		blobmsg_add_u32(&b, "aid", sta->aid);
 #ifdef CONFIG_TAXONOMY
-		r = blobmsg_alloc_string_buffer(&b, "signature", 1024);
-		if (retrieve_sta_taxonomy(hapd, sta, r, 1024) > 0)
-			blobmsg_add_string_buffer(&b);
+		if (fields & BIT(CLIENT_FIELD_SIGNATURE)) {
+			r = blobmsg_alloc_string_buffer(&b, "signature", 1024);
+			if (retrieve_sta_taxonomy(hapd, sta, r, 1024) > 0)
+				blobmsg_add_string_buffer(&b);
+		}
 #endif
 
 		/* Driver information */
-		if (hostapd_drv_read_sta_data(hapd, &sta_driver_data, sta->addr) >= 0) {
+		if ((fields & BIT(CLIENT_FIELD_DRIVER)) &&
+		    hostapd_ubus_read_sta_data(hapd, sta, &sta_driver_data,
+					       max_age) >= 0) {
 			r = blobmsg_open_table(&b, "bytes");
 			blobmsg_add_u64(&b, "rx", sta_driver_data.rx_bytes);
 			blobmsg_add_u64(&b, "tx", sta_driver_data.tx_bytes);
@@ -322,13 +724,18 @@ hostapd_bss_get_clients(struct ubus_context *ctx, struct ubus_object *obj,
 			blobmsg_add_u32(&b, "signal", sta_driver_data.signal);
 		}
 
-		hostapd_parse_capab_blobmsg(sta);
+		if (fields & BIT(CLIENT_FIELD_CAPAB))
+			hostapd_parse_capab_blobmsg(sta);
 
 		blobmsg_close_table(&b, c);
 	}
 	blobmsg_close_array(&b, list);
 	ubus_send_reply(ctx, req, b.head);
 
+	/* forget stations that have gone away */
+	if (max_age && (fields & BIT(CLIENT_FIELD_DRIVER)))
+		hostapd_ubus_flush_sta_data(hapd, false);
+
 	return 0;
 }
 
@@ -426,13 +833,54 @@ hostapd_bss_get_status(struct ubus_context *ctx, struct ubus_object *obj,
 
 enum {
 	NOTIFY_RESPONSE,
+	NOTIFY_VERDICT_CACHE,
 	__NOTIFY_MAX
 };
 
 static const struct blobmsg_policy notify_policy[__NOTIFY_MAX] = {
 	[NOTIFY_RESPONSE] = { "notify_response", BLOBMSG_TYPE_INT32 },
+	[NOTIFY_VERDICT_CACHE] = { "verdict_cache", BLOBMSG_TYPE_INT32 },
+};
+
+enum {
+	PROBE_SUMMARY_INTERVAL,
+	__PROBE_SUMMARY_MAX
+};
+
+static const struct blobmsg_policy probe_summary_policy[__PROBE_SUMMARY_MAX] = {
+	[PROBE_SUMMARY_INTERVAL] = { "interval", BLOBMSG_TYPE_INT32 },
 };
 
+static int
+hostapd_probe_summary(struct ubus_context *ctx, struct ubus_object *obj,
+		      struct ubus_request_data *req, const char *method,
+		      struct blob_attr *msg)
+{
+	struct blob_attr *tb[__PROBE_SUMMARY_MAX];
+	struct hostapd_data *hapd = get_hapd_from_object(obj);
+	int interval;
+
+	blobmsg_parse(probe_summary_policy, __PROBE_SUMMARY_MAX, tb,
+		      blob_data(msg), blob_len(msg));
+
+	if (!tb[PROBE_SUMMARY_INTERVAL])
+		return UBUS_STATUS_INVALID_ARGUMENT;
+
+	interval = blobmsg_get_u32(tb[PROBE_SUMMARY_INTERVAL]);
+	if (interval < 0)
+		return UBUS_STATUS_INVALID_ARGUMENT;
+
+	eloop_cancel_timeout(hostapd_probe_summary_timeout, hapd, NULL);
+	hostapd_probe_summary_flush(hapd, true);
+
+	hapd->ubus.probe_interval = interval;
+	if (interval)
+		eloop_register_timeout(interval / 1000, (interval % 1000) * 1000,
+				       hostapd_probe_summary_timeout, hapd, NULL);
+
+	return UBUS_STATUS_OK;
+}
+
 static int
 hostapd_notify_response(struct ubus_context *ctx, struct ubus_object *obj,
 			struct ubus_request_data *req, const char *method,
@@ -452,6 +900,15 @@ hostapd_notify_response(struct ubus_context *ctx, struct ubus_object *obj,
 
 	hapd->ubus.notify_response = blobmsg_get_u32(tb[NOTIFY_RESPONSE]);
 
+	eloop_cancel_timeout(hostapd_verdict_gc, hapd, NULL);
+	hostapd_verdict_flush(hapd, true);
+	hapd->ubus.verdict_ttl = 0;
+	if (tb[NOTIFY_VERDICT_CACHE])
+		hapd->ubus.verdict_ttl = blobmsg_get_u32(tb[NOTIFY_VERDICT_CACHE]);
+	if (hapd->ubus.verdict_ttl > 0)
+		eloop_register_timeout(hapd->ubus.verdict_ttl, 0,
+				       hostapd_verdict_gc, hapd, NULL);
+
 	return UBUS_STATUS_OK;
 }
 
@@ -542,6 +999,96 @@ hostapd_bss_list_bans(struct ubus_context *ctx, struct ubus_object *obj,
 	return 0;
 }
 
+enum {
+	BAN_CLIENTS_ADDRS,
+	BAN_CLIENTS_BAN_TIME,
+	BAN_CLIENTS_SCOPE,
+	__BAN_CLIENTS_MAX
+};
+
+static const struct blobmsg_policy ban_clients_policy[__BAN_CLIENTS_MAX] = {
+	[BAN_CLIENTS_ADDRS] = { "addrs", BLOBMSG_TYPE_ARRAY },
+	[BAN_CLIENTS_BAN_TIME] = { "ban_time", BLOBMSG_TYPE_INT32 },
+	[BAN_CLIENTS_SCOPE] = { "scope", BLOBMSG_TYPE_STRING },
+};
+
+static void
+hostapd_bss_ban_list(struct hostapd_data *hapd, struct blob_attr *addrs, int time)
+{
+	struct blob_attr *cur;
+	u8 addr[ETH_ALEN];
+	int rem;
+
+	if (!hapd->ubus.obj.id)
+		return;
+
+	blobmsg_for_each_attr(cur, addrs, rem) {
+		if (hwaddr_aton(blobmsg_get_string(cur), addr))
+			continue;
+
+		hostapd_bss_set_ban(hapd, addr, time);
+	}
+
+	hostapd_bss_ban_schedule(hapd);
+}
+
+static int
+hostapd_bss_ban_clients(struct ubus_context *ctx, struct ubus_object *obj,
+			struct ubus_request_data *req, const char *method,
+			struct blob_attr *msg)
+{
+	struct hostapd_data *hapd = container_of(obj, struct hostapd_data, ubus.obj);
+	struct blob_attr *tb[__BAN_CLIENTS_MAX];
+	struct hapd_interfaces *interfaces;
+	struct blob_attr *cur;
+	const char *scope = "bss";
+	u8 addr[ETH_ALEN];
+	int time, rem;
+	size_t i, j;
+
+	blobmsg_parse(ban_clients_policy, __BAN_CLIENTS_MAX, tb,
+		      blob_data(msg), blob_len(msg));
+
+	if (!tb[BAN_CLIENTS_ADDRS] || !tb[BAN_CLIENTS_BAN_TIME])
+		return UBUS_STATUS_INVALID_ARGUMENT;
+
+	if (blobmsg_check_array(tb[BAN_CLIENTS_ADDRS], BLOBMSG_TYPE_STRING) < 0)
+		return UBUS_STATUS_INVALID_ARGUMENT;
+
+	blobmsg_for_each_attr(cur, tb[BAN_CLIENTS_ADDRS], rem) {
+		if (hwaddr_aton(blobmsg_get_string(cur), addr))
+			return UBUS_STATUS_INVALID_ARGUMENT;
+	}
+
+	time = blobmsg_get_u32(tb[BAN_CLIENTS_BAN_TIME]);
+	if (tb[BAN_CLIENTS_SCOPE])
+		scope = blobmsg_get_string(tb[BAN_CLIENTS_SCOPE]);
+
+	if (!strcmp(scope, "bss")) {
+		hostapd_bss_ban_list(hapd, tb[BAN_CLIENTS_ADDRS], time);
+	} else if (!strcmp(scope, "radio")) {
+		for (i = 0; i < hapd->iface->num_bss; i++)
+			hostapd_bss_ban_list(hapd->iface->bss[i],
+					     tb[BAN_CLIENTS_ADDRS], time);
+	} else if (!strcmp(scope, "all")) {
+		interfaces = hapd->iface->interfaces;
+		if (!interfaces)
+			return UBUS_STATUS_NOT_SUPPORTED;
+
+		for (i = 0; i < interfaces->count; i++) {
+			struct hostapd_iface *iface = interfaces->iface[i];
+
+			for (j = 0; j < iface->num_bss; j++)
+				hostapd_bss_ban_list(iface->bss[j],
+						     tb[BAN_CLIENTS_ADDRS], time);
+		}
+	} else {
+		return UBUS_STATUS_INVALID_ARGUMENT;
+	}
+
+	return 0;
+}
+
 #ifdef CONFIG_WPS
 static int
 hostapd_bss_wps_start(struct ubus_context *ctx, struct ubus_object *obj,
@@ -1050,56 +1597,60 @@ hostapd_rrm_nr_list(struct ubus_context *ctx, struct ubus_object *obj,
 
 enum {
 	NR_SET_LIST,
+	NR_SET_ADD,
+	NR_SET_REMOVE,
+	NR_SET_SCOPE,
 	__NR_SET_LIST_MAX
 };
 
 static const struct blobmsg_policy nr_set_policy[__NR_SET_LIST_MAX] = {
 	[NR_SET_LIST] = { "list", BLOBMSG_TYPE_ARRAY },
+	[NR_SET_ADD] = { "add", BLOBMSG_TYPE_ARRAY },
+	[NR_SET_REMOVE] = { "remove", BLOBMSG_TYPE_ARRAY },
+	[NR_SET_SCOPE] = { "scope", BLOBMSG_TYPE_STRING },
 };
 
+struct hostapd_rrm_nr_entry {
+	u8 bssid[ETH_ALEN];
+	struct wpa_ssid_value ssid;
+	struct wpabuf *data;
+};
 
 static void
-hostapd_rrm_nr_clear(struct hostapd_data *hapd)
+hostapd_rrm_nr_entries_free(struct hostapd_rrm_nr_entry *list, int n)
 {
-	struct hostapd_neighbor_entry *nr;
-
-restart:
-	dl_list_for_each(nr, &hapd->nr_db, struct hostapd_neighbor_entry, list) {
-		if (!memcmp(nr->bssid, hapd->own_addr, ETH_ALEN))
-			continue;
+	int i;
 
-		hostapd_neighbor_remove(hapd, nr->bssid, &nr->ssid);
-		goto restart;
-	}
+	for (i = 0; i < n; i++)
+		wpabuf_free(list[i].data);
+	free(list);
 }
 
-static int
-hostapd_rrm_nr_set(struct ubus_context *ctx, struct ubus_object *obj,
-		   struct ubus_request_data *req, const char *method,
-		   struct blob_attr *msg)
+/*
+ * Parse an array of [ bssid, ssid, neighbor report ] entries. An empty
+ * BSSID is taken from the neighbor report, an empty SSID from the BSS.
+ */
+static struct hostapd_rrm_nr_entry *
+hostapd_rrm_nr_entries(struct hostapd_data *hapd, struct blob_attr *attr,
+		       int *n_entries)
 {
 	static const struct blobmsg_policy nr_e_policy[] = {
 		{ .type = BLOBMSG_TYPE_STRING },
 		{ .type = BLOBMSG_TYPE_STRING },
 		{ .type = BLOBMSG_TYPE_STRING },
 	};
-	struct hostapd_data *hapd = get_hapd_from_object(obj);
-	struct blob_attr *tb_l[__NR_SET_LIST_MAX];
 	struct blob_attr *tb[ARRAY_SIZE(nr_e_policy)];
+	struct hostapd_rrm_nr_entry *list;
 	struct blob_attr *cur;
-	int rem;
-
-	hostapd_rrm_nr_enable(hapd);
+	int rem, n = 0;
 
-	blobmsg_parse(nr_set_policy, __NR_SET_LIST_MAX, tb_l, blob_data(msg), blob_len(msg));
-	if (!tb_l[NR_SET_LIST])
-		return UBUS_STATUS_INVALID_ARGUMENT;
+	*n_entries = 0;
+	list = calloc(blobmsg_check_array(attr, BLOBMSG_TYPE_UNSPEC) + 1, sizeof(*list));
+	if (!list)
+		return NULL;
 
-	hostapd_rrm_nr_clear(hapd);
-	blobmsg_for_each_attr(cur, tb_l[NR_SET_LIST], rem) {
-		struct wpa_ssid_value ssid;
-		struct wpabuf *data;
-		u8 bssid[ETH_ALEN];
+	blobmsg_for_each_attr(cur, attr, rem) {
+		struct hostapd_rrm_nr_entry *e = &list[n];
 		char *s, *nr_s;
 
 		blobmsg_parse_array(nr_e_policy, ARRAY_SIZE(nr_e_policy), tb, blobmsg_data(cur), blobmsg_data_len(cur));
@@ -1108,17 +1659,18 @@ hostapd_rrm_nr_set(struct ubus_context *ctx, struct ubus_object *obj,
 
 		/* Neighbor Report binary */
 		nr_s = blobmsg_get_string(tb[2]);
-		data = wpabuf_parse_bin(nr_s);
-		if (!data)
+		e->data = wpabuf_parse_bin(nr_s);
+		if (!e->data)
 			goto invalid;
+		n++;
 
 		/* BSSID */
 		s = blobmsg_get_string(tb[0]);
 		if (strlen(s) == 0) {
 			/* Copy BSSID from neighbor report */
-			if (hwaddr_compact_aton(nr_s, bssid))
+			if (hwaddr_compact_aton(nr_s, e->bssid))
 				goto invalid;
-		} else if (hwaddr_aton(s, bssid)) {
+		} else if (hwaddr_aton(s, e->bssid)) {
 			goto invalid;
 		}
 
@@ -1126,26 +1678,412 @@ hostapd_rrm_nr_set(struct ubus_context *ctx, struct ubus_object *obj,
 		s = blobmsg_get_string(tb[1]);
 		if (strlen(s) == 0) {
 			/* Copy SSID from hostapd BSS conf */
-			memcpy(&ssid, &hapd->conf->ssid, sizeof(ssid));
+			memcpy(&e->ssid, &hapd->conf->ssid, sizeof(e->ssid));
 		} else {
-			ssid.ssid_len = strlen(s);
-			if (ssid.ssid_len > sizeof(ssid.ssid))
+			e->ssid.ssid_len = strlen(s);
+			if (e->ssid.ssid_len > sizeof(e->ssid.ssid))
 				goto invalid;
 
-			memcpy(&ssid, s, ssid.ssid_len);
+			memcpy(&e->ssid, s, e->ssid.ssid_len);
 		}
+	}
 
-		hostapd_neighbor_set(hapd, bssid, &ssid, data, NULL, NULL, 0, 0);
-		wpabuf_free(data);
-		continue;
+	*n_entries = n;
+	return list;
 
 invalid:
+	hostapd_rrm_nr_entries_free(list, n);
+	return NULL;
+}
+
+static bool
+hostapd_rrm_nr_entries_valid(struct hostapd_data *hapd, struct blob_attr *attr)
+{
+	struct hostapd_rrm_nr_entry *list;
+	int n;
+
+	if (!attr)
+		return true;
+
+	list = hostapd_rrm_nr_entries(hapd, attr, &n);
+	if (!list)
+		return false;
+
+	hostapd_rrm_nr_entries_free(list, n);
+	return true;
+}
+
+static void
+hostapd_rrm_nr_add(struct hostapd_data *hapd,
+		   struct hostapd_rrm_nr_entry *list, int n)
+{
+	struct hostapd_neighbor_entry *nr;
+	int i;
+
+	for (i = 0; i < n; i++) {
+		struct hostapd_rrm_nr_entry *e = &list[i];
+
+		if (!memcmp(e->bssid, hapd->own_addr, ETH_ALEN))
+			continue;
+
+		/* leave unchanged entries alone */
+		nr = hostapd_neighbor_get(hapd, e->bssid, &e->ssid);
+		if (nr && nr->nr && !wpabuf_cmp(nr->nr, e->data))
+			continue;
+
+		hostapd_neighbor_set(hapd, e->bssid, &e->ssid, e->data, NULL, NULL, 0, 0);
+	}
+}
+
+/*
+ * With a list, the neighbors of the BSS are replaced by those in it, but
+ * only the entries that differ are touched. The add and remove arrays
+ * change single entries, removal is by BSSID.
+ */
+static void
+hostapd_rrm_nr_update(struct hostapd_data *hapd, struct blob_attr **tb)
+{
+	struct hostapd_neighbor_entry *nr, *tmp;
+	struct hostapd_rrm_nr_entry *list;
+	struct blob_attr *cur;
+	u8 bssid[ETH_ALEN];
+	int i, n, rem;
+
+	hostapd_rrm_nr_enable(hapd);
+
+	if (tb[NR_SET_LIST]) {
+		list = hostapd_rrm_nr_entries(hapd, tb[NR_SET_LIST], &n);
+		if (!list)
+			return;
+
+		dl_list_for_each_safe(nr, tmp, &hapd->nr_db, struct hostapd_neighbor_entry, list) {
+			if (!memcmp(nr->bssid, hapd->own_addr, ETH_ALEN))
+				continue;
+
+			for (i = 0; i < n; i++) {
+				if (!memcmp(nr->bssid, list[i].bssid, ETH_ALEN) &&
+				    nr->ssid.ssid_len == list[i].ssid.ssid_len &&
+				    !memcmp(nr->ssid.ssid, list[i].ssid.ssid, nr->ssid.ssid_len))
+					break;
+			}
+
+			if (i == n)
+				hostapd_neighbor_remove(hapd, nr->bssid, &nr->ssid);
+		}
+
+		hostapd_rrm_nr_add(hapd, list, n);
+		hostapd_rrm_nr_entries_free(list, n);
+	}
+
+	blobmsg_for_each_attr(cur, tb[NR_SET_REMOVE], rem) {
+		if (hwaddr_aton(blobmsg_get_string(cur), bssid) ||
+		    !memcmp(bssid, hapd->own_addr, ETH_ALEN))
+			continue;
+
+		dl_list_for_each_safe(nr, tmp, &hapd->nr_db, struct hostapd_neighbor_entry, list) {
+			if (!memcmp(nr->bssid, bssid, ETH_ALEN))
+				hostapd_neighbor_remove(hapd, nr->bssid, &nr->ssid);
+		}
+	}
+
+	if (tb[NR_SET_ADD]) {
+		list = hostapd_rrm_nr_entries(hapd, tb[NR_SET_ADD], &n);
+		if (!list)
+			return;
+
+		hostapd_rrm_nr_add(hapd, list, n);
+		hostapd_rrm_nr_entries_free(list, n);
+	}
+}
+
+static int
+hostapd_rrm_nr_set(struct ubus_context *ctx, struct ubus_object *obj,
+		   struct ubus_request_data *req, const char *method,
+		   struct blob_attr *msg)
+{
+	struct hostapd_data *hapd = get_hapd_from_object(obj);
+	struct blob_attr *tb[__NR_SET_LIST_MAX];
+	struct hapd_interfaces *interfaces;
+	struct blob_attr *cur;
+	const char *scope = "bss";
+	u8 bssid[ETH_ALEN];
+	size_t i, j;
+	int rem;
+
+	blobmsg_parse(nr_set_policy, __NR_SET_LIST_MAX, tb, blob_data(msg), blob_len(msg));
+	if (!tb[NR_SET_LIST] && !tb[NR_SET_ADD] && !tb[NR_SET_REMOVE])
+		return UBUS_STATUS_INVALID_ARGUMENT;
+
+	/* validate everything before changing any BSS */
+	if (!hostapd_rrm_nr_entries_valid(hapd, tb[NR_SET_LIST]) ||
+	    !hostapd_rrm_nr_entries_valid(hapd, tb[NR_SET_ADD]))
+		return UBUS_STATUS_INVALID_ARGUMENT;
+
+	if (tb[NR_SET_REMOVE]) {
+		if (blobmsg_check_array(tb[NR_SET_REMOVE], BLOBMSG_TYPE_STRING) < 0)
+			return UBUS_STATUS_INVALID_ARGUMENT;
+
+		blobmsg_for_each_attr(cur, tb[NR_SET_REMOVE], rem) {
+			if (hwaddr_aton(blobmsg_get_string(cur), bssid))
+				return UBUS_STATUS_INVALID_ARGUMENT;
+		}
+	}
+
+	if (tb[NR_SET_SCOPE])
+		scope = blobmsg_get_string(tb[NR_SET_SCOPE]);
+
+	if (!strcmp(scope, "bss")) {
+		hostapd_rrm_nr_update(hapd, tb);
+	} else if (!strcmp(scope, "radio")) {
+		for (i = 0; i < hapd->iface->num_bss; i++)
+			hostapd_rrm_nr_update(hapd->iface->bss[i], tb);
+	} else if (!strcmp(scope, "all")) {
+		interfaces = hapd->iface->interfaces;
+		if (!interfaces)
+			return UBUS_STATUS_NOT_SUPPORTED;
+
+		for (i = 0; i < interfaces->count; i++) {
+			struct hostapd_iface *iface = interfaces->iface[i];
+
+			for (j = 0; j < iface->num_bss; j++)
+				hostapd_rrm_nr_update(iface->bss[j], tb);
+		}
+	} else {
 		return UBUS_STATUS_INVALID_ARGUMENT;
 	}
 
 	return 0;
 }
 
+/* quiet time after a report element before the report counts as complete */
+#define BEACON_REPORT_SETTLE 200
+#define BEACON_REPORT_TIMEOUT 5000
+#define BEACON_REPORT_KEEP 300
+#define BEACON_BATCH_INTERVAL 100
+
+struct ubus_beacon_report_entry {
+	u8 rep_mode;
+	struct rrm_measurement_beacon_report rep;
+};
+
+/*
+ * Beacon reports of a client, collected for a batched rrm_beacon_req and
+ * sent as a single event once the client stopped reporting. The last
+ * result of each client stays around for rrm_beacon_reports.
+ */
+struct ubus_beacon_report {
+	struct avl_node avl;
+	u8 addr[ETH_ALEN];
+	struct hostapd_data *hapd;
+	struct os_reltime requested;
+	const char *status;
+	int token;
+	unsigned int n_reports;
+	struct ubus_beacon_report_entry *reports;
+};
+
+/* clients still waiting for their request, sent one per interval */
+struct ubus_beacon_batch {
+	struct wpabuf *req;
+	unsigned int interval;
+	unsigned int timeout;
+	int n_addrs, next;
+	u8 addrs[][ETH_ALEN];
+};
+
+static void
+hostapd_ubus_add_beacon_report(const struct rrm_measurement_beacon_report *rep,
+			       u8 rep_mode)
+{
+	blobmsg_add_u16(&b, "op-class", rep->op_class);
+	blobmsg_add_u16(&b, "channel", rep->channel);
+	blobmsg_add_u64(&b, "start-time", rep->start_time);
+	blobmsg_add_u16(&b, "duration", rep->duration);
+	blobmsg_add_u16(&b, "report-info", rep->report_info);
+	blobmsg_add_u16(&b, "rcpi", rep->rcpi);
+	blobmsg_add_u16(&b, "rsni", rep->rsni);
+	blobmsg_add_macaddr(&b, "bssid", rep->bssid);
+	blobmsg_add_u16(&b, "antenna-id", rep->antenna_id);
+	blobmsg_add_u16(&b, "parent-tsf", rep->parent_tsf);
+	blobmsg_add_u16(&b, "rep-mode", rep_mode);
+}
+
+static void
+hostapd_beacon_report_print(struct ubus_beacon_report *r)
+{
+	struct os_reltime now, age;
+	unsigned int i;
+	void *c;
+
+	os_get_reltime(&now);
+	os_reltime_sub(&now, &r->requested, &age);
+
+	blobmsg_add_macaddr(&b, "address", r->addr);
+	blobmsg_add_u32(&b, "token", r->token);
+	blobmsg_add_string(&b, "status", r->status);
+	blobmsg_add_u32(&b, "age", age.sec * 1000 + age.usec / 1000);
+
+	c = blobmsg_open_array(&b, "reports");
+	for (i = 0; i < r->n_reports; i++) {
+		void *e = blobmsg_open_table(&b, NULL);
+
+		hostapd_ubus_add_beacon_report(&r->reports[i].rep,
+					       r->reports[i].rep_mode);
+		blobmsg_close_table(&b, e);
+	}
+	blobmsg_close_array(&b, c);
+}
+
+static void hostapd_beacon_report_timeout(void *eloop_data, void *user_ctx);
+
+static void
+hostapd_beacon_report_free(struct ubus_beacon_report *r)
+{
+	eloop_cancel_timeout(hostapd_beacon_report_timeout, r, NULL);
+	avl_delete(&r->hapd->ubus.beacon_reports, &r->avl);
+	free(r->reports);
+	free(r);
+}
+
+static void
+hostapd_beacon_report_done(struct ubus_beacon_report *r, const char *status)
+{
+	struct hostapd_data *hapd = r->hapd;
+
+	eloop_cancel_timeout(hostapd_beacon_report_timeout, r, NULL);
+	r->status = status;
+
+	if (!hapd->ubus.obj.has_subscribers)
+		return;
+
+	blob_buf_init(&b, 0);
+	blobmsg_add_string(&b, "ifname", hapd->conf->iface);
+	hostapd_beacon_report_print(r);
+	ubus_notify(ctx, &hapd->ubus.obj, "beacon-reports", b.head, -1);
+}
+
+static void
+hostapd_beacon_report_timeout(void *eloop_data, void *user_ctx)
+{
+	struct ubus_beacon_report *r = eloop_data;
+
+	hostapd_beacon_report_done(r, r->n_reports ? "complete" : "timeout");
+}
+
+static void
+hostapd_beacon_reports_gc(struct hostapd_data *hapd, bool all)
+{
+	struct ubus_beacon_report *r, *tmp;
+	struct os_reltime now;
+
+	os_get_reltime(&now);
+	avl_for_each_element_safe(&hapd->ubus.beacon_reports, r, avl, tmp) {
+		if (all || (strcmp(r->status, "pending") != 0 &&
+			    os_reltime_expired(&now, &r->requested, BEACON_REPORT_KEEP)))
+			hostapd_beacon_report_free(r);
+	}
+}
+
+static bool
+hostapd_beacon_report_add(struct hostapd_data *hapd, const u8 *addr, u8 token,
+			  u8 rep_mode, struct rrm_measurement_beacon_report *rep)
+{
+	struct ubus_beacon_report_entry *reports;
+	struct ubus_beacon_report *r;
+
+	r = avl_find_element(&hapd->ubus.beacon_reports, addr, r, avl);
+	if (!r || r->token != token)
+		return false;
+
+	/* late reports only go into the stored result */
+	reports = realloc(r->reports, (r->n_reports + 1) * sizeof(*reports));
+	if (!reports)
+		return true;
+
+	r->reports = reports;
+	reports[r->n_reports].rep_mode = rep_mode;
+	memcpy(&reports[r->n_reports].rep, rep, sizeof(*rep));
+	r->n_reports++;
+
+	if (!strcmp(r->status, "pending")) {
+		eloop_cancel_timeout(hostapd_beacon_report_timeout, r, NULL);
+		eloop_register_timeout(0, BEACON_REPORT_SETTLE * 1000,
+				       hostapd_beacon_report_timeout, r, NULL);
+	}
+
+	return true;
+}
+
+static void
+hostapd_beacon_report_request(struct hostapd_data *hapd, const u8 *addr,
+			      const struct wpabuf *req, unsigned int timeout)
+{
+	struct ubus_beacon_report *r;
+	int token;
+
+	r = avl_find_element(&hapd->ubus.beacon_reports, addr, r, avl);
+	if (r)
+		hostapd_beacon_report_free(r);
+
+	r = os_zalloc(sizeof(*r));
+	if (!r)
+		return;
+
+	memcpy(r->addr, addr, sizeof(r->addr));
+	r->avl.key = r->addr;
+	r->hapd = hapd;
+	r->status = "pending";
+	os_get_reltime(&r->requested);
+	avl_insert(&hapd->ubus.beacon_reports, &r->avl);
+
+	token = hostapd_send_beacon_req(hapd, addr, 0, req);
+	if (token < 0) {
+		r->token = -1;
+		hostapd_beacon_report_done(r, "error");
+		return;
+	}
+
+	r->token = token;
+	eloop_register_timeout(timeout / 1000, (timeout % 1000) * 1000,
+			       hostapd_beacon_report_timeout, r, NULL);
+}
+
+static void
+hostapd_beacon_batch_free(struct hostapd_data *hapd);
+
+static void
+hostapd_beacon_batch_next(void *eloop_data, void *user_ctx)
+{
+	struct hostapd_data *hapd = eloop_data;
+	struct ubus_beacon_batch *batch = hapd->ubus.beacon_batch;
+
+	hostapd_beacon_report_request(hapd, batch->addrs[batch->next++],
+				      batch->req, batch->timeout);
+
+	if (batch->next == batch->n_addrs) {
+		hostapd_beacon_batch_free(hapd);
+		return;
+	}
+
+	eloop_register_timeout(batch->interval / 1000,
+			       (batch->interval % 1000) * 1000,
+			       hostapd_beacon_batch_next, hapd, NULL);
+}
+
+static void
+hostapd_beacon_batch_free(struct hostapd_data *hapd)
+{
+	struct ubus_beacon_batch *batch = hapd->ubus.beacon_batch;
+
+	if (!batch)
+		return;
+
+	eloop_cancel_timeout(hostapd_beacon_batch_next, hapd, NULL);
+	wpabuf_free(batch->req);
+	free(batch);
+	hapd->ubus.beacon_batch = NULL;
+}
+
 enum {
 	BEACON_REQ_ADDR,
 	BEACON_REQ_MODE,
@@ -1154,6 +2092,9 @@ enum {
 	BEACON_REQ_DURATION,
 	BEACON_REQ_BSSID,
 	BEACON_REQ_SSID,
+	BEACON_REQ_ADDRS,
+	BEACON_REQ_INTERVAL,
+	BEACON_REQ_TIMEOUT,
 	__BEACON_REQ_MAX,
 };
 
@@ -1165,8 +2106,81 @@ static const struct blobmsg_policy beacon_req_policy[__BEACON_REQ_MAX] = {
 	[BEACON_REQ_MODE] { "mode", BLOBMSG_TYPE_INT32 },
 	[BEACON_REQ_BSSID] { "bssid", BLOBMSG_TYPE_STRING },
 	[BEACON_REQ_SSID] { "ssid", BLOBMSG_TYPE_STRING },
+	[BEACON_REQ_ADDRS] { "addrs", BLOBMSG_TYPE_ARRAY },
+	[BEACON_REQ_INTERVAL] { "interval", BLOBMSG_TYPE_INT32 },
+	[BEACON_REQ_TIMEOUT] { "timeout", BLOBMSG_TYPE_INT32 },
 };
 
+/*
+ * Request beacon reports from a list of clients, or all associated ones for
+ * an empty list. The requests go out one per interval to keep them from
+ * taking up the air all at once, and each client's reports are delivered
+ * as a single beacon-reports event. A new batch replaces a pending one.
+ */
+static int
+hostapd_rrm_beacon_req_batch(struct hostapd_data *hapd, struct blob_attr **tb,
+			     struct wpabuf *req)
+{
+	struct ubus_beacon_batch *batch;
+	struct blob_attr *cur;
+	struct sta_info *sta;
+	int n, rem;
+
+	n = blobmsg_check_array(tb[BEACON_REQ_ADDRS], BLOBMSG_TYPE_STRING);
+	if (n < 0) {
+		wpabuf_free(req);
+		return UBUS_STATUS_INVALID_ARGUMENT;
+	}
+
+	if (!n) {
+		for (sta = hapd->sta_list; sta; sta = sta->next)
+			n++;
+	}
+
+	batch = os_zalloc(sizeof(*batch) + n * ETH_ALEN);
+	if (!batch) {
+		wpabuf_free(req);
+		return UBUS_STATUS_UNKNOWN_ERROR;
+	}
+
+	batch->req = req;
+	batch->interval = BEACON_BATCH_INTERVAL;
+	if (tb[BEACON_REQ_INTERVAL])
+		batch->interval = blobmsg_get_u32(tb[BEACON_REQ_INTERVAL]);
+	batch->timeout = BEACON_REPORT_TIMEOUT;
+	if (tb[BEACON_REQ_TIMEOUT])
+		batch->timeout = blobmsg_get_u32(tb[BEACON_REQ_TIMEOUT]);
+
+	blobmsg_for_each_attr(cur, tb[BEACON_REQ_ADDRS], rem) {
+		if (hwaddr_aton(blobmsg_get_string(cur), batch->addrs[batch->n_addrs++])) {
+			wpabuf_free(req);
+			free(batch);
+			return UBUS_STATUS_INVALID_ARGUMENT;
+		}
+	}
+
+	if (!batch->n_addrs) {
+		for (sta = hapd->sta_list; sta && batch->n_addrs < n; sta = sta->next) {
+			if (sta->flags & WLAN_STA_ASSOC)
+				memcpy(batch->addrs[batch->n_addrs++], sta->addr, ETH_ALEN);
+		}
+	}
+
+	hostapd_beacon_batch_free(hapd);
+	hostapd_beacon_reports_gc(hapd, false);
+
+	if (!batch->n_addrs) {
+		wpabuf_free(req);
+		free(batch);
+		return 0;
+	}
+
+	hapd->ubus.beacon_batch = batch;
+	eloop_register_timeout(0, 0, hostapd_beacon_batch_next, hapd, NULL);
+
+	return 0;
+}
+
 static int
 hostapd_rrm_beacon_req(struct ubus_context *ctx, struct ubus_object *obj,
 		       struct ubus_request_data *ureq, const char *method,
@@ -1183,7 +2197,8 @@ hostapd_rrm_beacon_req(struct ubus_context *ctx, struct ubus_object *obj,
 
 	blobmsg_parse(beacon_req_policy, __BEACON_REQ_MAX, tb, blob_data(msg), blob_len(msg));
 
-	if (!tb[BEACON_REQ_ADDR] || !tb[BEACON_REQ_MODE] || !tb[BEACON_REQ_DURATION] ||
+	if ((!tb[BEACON_REQ_ADDR] && !tb[BEACON_REQ_ADDRS]) ||
+	    !tb[BEACON_REQ_MODE] || !tb[BEACON_REQ_DURATION] ||
 	    !tb[BEACON_REQ_OP_CLASS] || !tb[BEACON_REQ_CHANNEL])
 		return UBUS_STATUS_INVALID_ARGUMENT;
 
@@ -1191,7 +2206,8 @@ hostapd_rrm_beacon_req(struct ubus_context *ctx, struct ubus_object *obj,
 		buf_len += blobmsg_data_len(tb[BEACON_REQ_SSID]) + 2 - 1;
 
 	mode = blobmsg_get_u32(tb[BEACON_REQ_MODE]);
-	if (hwaddr_aton(blobmsg_data(tb[BEACON_REQ_ADDR]), addr))
+	if (tb[BEACON_REQ_ADDR] &&
+	    hwaddr_aton(blobmsg_data(tb[BEACON_REQ_ADDR]), addr))
 		return UBUS_STATUS_INVALID_ARGUMENT;
 
 	if (tb[BEACON_REQ_BSSID] &&
@@ -1226,13 +2242,61 @@ hostapd_rrm_beacon_req(struct ubus_context *ctx, struct ubus_object *obj,
 		wpabuf_put_data(req, blobmsg_data(cur), blobmsg_data_len(cur) - 1);
 	}
 
+	if (!tb[BEACON_REQ_ADDR])
+		return hostapd_rrm_beacon_req_batch(hapd, tb, req);
+
 	ret = hostapd_send_beacon_req(hapd, addr, 0, req);
+	wpabuf_free(req);
 	if (ret < 0)
 		return -ret;
 
 	return 0;
 }
 
+enum {
+	BEACON_REPORTS_ADDR,
+	__BEACON_REPORTS_MAX,
+};
+
+static const struct blobmsg_policy beacon_reports_policy[__BEACON_REPORTS_MAX] = {
+	[BEACON_REPORTS_ADDR] = { "addr", BLOBMSG_TYPE_STRING },
+};
+
+static int
+hostapd_rrm_beacon_reports(struct ubus_context *ctx, struct ubus_object *obj,
+			   struct ubus_request_data *req, const char *method,
+			   struct blob_attr *msg)
+{
+	struct hostapd_data *hapd = get_hapd_from_object(obj);
+	struct blob_attr *tb[__BEACON_REPORTS_MAX];
+	struct ubus_beacon_report *r;
+	u8 addr[ETH_ALEN];
+	void *list, *c;
+
+	blobmsg_parse(beacon_reports_policy, __BEACON_REPORTS_MAX, tb,
+		      blob_data(msg), blob_len(msg));
+
+	if (tb[BEACON_REPORTS_ADDR] &&
+	    hwaddr_aton(blobmsg_data(tb[BEACON_REPORTS_ADDR]), addr))
+		return UBUS_STATUS_INVALID_ARGUMENT;
+
+	blob_buf_init(&b, 0);
+	list = blobmsg_open_array(&b, "clients");
+	avl_for_each_element(&hapd->ubus.beacon_reports, r, avl) {
+		if (tb[BEACON_REPORTS_ADDR] && memcmp(r->addr, addr, ETH_ALEN) != 0)
+			continue;
+
+		c = blobmsg_open_table(&b, NULL);
+		hostapd_beacon_report_print(r);
+		blobmsg_close_table(&b, c);
+	}
+	blobmsg_close_array(&b, list);
+
+	ubus_send_reply(ctx, req, b.head);
+
+	return 0;
+}
+
 enum {
 	LM_REQ_ADDR,
 	LM_REQ_TX_POWER_USED,
@@ -1328,136 +2392,371 @@ void hostapd_ubus_handle_link_measurement(struct hostapd_data *hapd, const u8 *d
 
 #ifdef CONFIG_WNM_AP
 
+#define BSS_TR_BATCH_INTERVAL 20
+
+struct ubus_bss_tr_params {
+	bool disassoc_imminent;
+	bool abridged;
+	u16 disassoc_timer;
+	u8 validity_period;
+	u8 dialog_token;
+	u8 mbo_reason;
+	u8 cell_pref;
+	u16 reassoc_delay;
+	u8 *nr;
+	int nr_len;
+};
+
+struct ubus_bss_tr_client {
+	u8 addr[ETH_ALEN];
+	struct ubus_bss_tr_params *params;
+};
+
+/* clients still waiting for their request, sent one per interval */
+struct ubus_bss_tr_batch {
+	struct ubus_bss_tr_params params;
+	unsigned int interval;
+	int n_clients, next;
+	struct ubus_bss_tr_client clients[];
+};
+
+enum {
+	BSS_TR_ADDR,
+	BSS_TR_DA_IMMINENT,
+	BSS_TR_DA_TIMER,
+	BSS_TR_VALID_PERIOD,
+	BSS_TR_NEIGHBORS,
+	BSS_TR_ABRIDGED,
+	BSS_TR_DIALOG_TOKEN,
+	BSS_TR_CLIENTS,
+	BSS_TR_INTERVAL,
+#ifdef CONFIG_MBO
+	BSS_TR_MBO_REASON,
+	BSS_TR_CELL_PREF,
+	BSS_TR_REASSOC_DELAY,
+#endif
+	__BSS_TR_DISASSOC_MAX
+};
+
+static const struct blobmsg_policy bss_tr_policy[__BSS_TR_DISASSOC_MAX] = {
+	[BSS_TR_ADDR] = { "addr", BLOBMSG_TYPE_STRING },
+	[BSS_TR_DA_IMMINENT] = { "disassociation_imminent", BLOBMSG_TYPE_BOOL },
+	[BSS_TR_DA_TIMER] = { "disassociation_timer", BLOBMSG_TYPE_INT32 },
+	[BSS_TR_VALID_PERIOD] = { "validity_period", BLOBMSG_TYPE_INT32 },
+	[BSS_TR_NEIGHBORS] = { "neighbors", BLOBMSG_TYPE_ARRAY },
+	[BSS_TR_ABRIDGED] = { "abridged", BLOBMSG_TYPE_BOOL },
+	[BSS_TR_DIALOG_TOKEN] = { "dialog_token", BLOBMSG_TYPE_INT32 },
+	[BSS_TR_CLIENTS] = { "clients", BLOBMSG_TYPE_ARRAY },
+	[BSS_TR_INTERVAL] = { "interval", BLOBMSG_TYPE_INT32 },
+#ifdef CONFIG_MBO
+	[BSS_TR_MBO_REASON] = { "mbo_reason", BLOBMSG_TYPE_INT32 },
+	[BSS_TR_CELL_PREF] = { "cell_pref", BLOBMSG_TYPE_INT32 },
+	[BSS_TR_REASSOC_DELAY] = { "reassoc_delay", BLOBMSG_TYPE_INT32 },
+#endif
+};
+
 static int
-hostapd_bss_tr_send(struct hostapd_data *hapd, u8 *addr, bool disassoc_imminent, bool abridged,
-		    u16 disassoc_timer, u8 validity_period, u8 dialog_token,
-		    struct blob_attr *neighbors, u8 mbo_reason, u8 cell_pref, u8 reassoc_delay)
+hostapd_bss_tr_parse_neighbors(struct blob_attr *neighbors,
+			       struct ubus_bss_tr_params *p)
 {
 	struct blob_attr *cur;
-	struct sta_info *sta;
 	int nr_len = 0;
 	int rem;
-	u8 *nr = NULL;
-	u8 req_mode = 0;
-	u8 mbo[10];
-	size_t mbo_len = 0;
+	u8 *nr_cur;
 
-	sta = ap_get_sta(hapd, addr);
-	if (!sta)
-		return UBUS_STATUS_NOT_FOUND;
+	if (blobmsg_check_array(neighbors, BLOBMSG_TYPE_STRING) < 0)
+		return UBUS_STATUS_INVALID_ARGUMENT;
 
-	if (neighbors) {
-		u8 *nr_cur;
+	blobmsg_for_each_attr(cur, neighbors, rem) {
+		int len = strlen(blobmsg_get_string(cur));
 
-		if (blobmsg_check_array(neighbors,
-					BLOBMSG_TYPE_STRING) < 0)
+		if (len % 2)
 			return UBUS_STATUS_INVALID_ARGUMENT;
 
-		blobmsg_for_each_attr(cur, neighbors, rem) {
-			int len = strlen(blobmsg_get_string(cur));
+		nr_len += (len / 2) + 2;
+	}
 
-			if (len % 2)
-				return UBUS_STATUS_INVALID_ARGUMENT;
+	if (!nr_len)
+		return 0;
 
-			nr_len += (len / 2) + 2;
-		}
+	p->nr = os_zalloc(nr_len);
+	if (!p->nr)
+		return UBUS_STATUS_UNKNOWN_ERROR;
+
+	nr_cur = p->nr;
+	blobmsg_for_each_attr(cur, neighbors, rem) {
+		int len = strlen(blobmsg_get_string(cur)) / 2;
 
-		if (nr_len) {
-			nr = os_zalloc(nr_len);
-			if (!nr)
-				return UBUS_STATUS_UNKNOWN_ERROR;
+		*nr_cur++ = WLAN_EID_NEIGHBOR_REPORT;
+		*nr_cur++ = (u8) len;
+		if (hexstr2bin(blobmsg_data(cur), nr_cur, len)) {
+			os_free(p->nr);
+			p->nr = NULL;
+			return UBUS_STATUS_INVALID_ARGUMENT;
 		}
 
-		nr_cur = nr;
-		blobmsg_for_each_attr(cur, neighbors, rem) {
-			int len = strlen(blobmsg_get_string(cur)) / 2;
+		nr_cur += len;
+	}
+	p->nr_len = nr_len;
 
-			*nr_cur++ = WLAN_EID_NEIGHBOR_REPORT;
-			*nr_cur++ = (u8) len;
-			if (hexstr2bin(blobmsg_data(cur), nr_cur, len)) {
-				free(nr);
-				return UBUS_STATUS_INVALID_ARGUMENT;
-			}
+	return 0;
+}
 
-			nr_cur += len;
-		}
+/*
+ * Parse the request parameters, starting from those in base, so that the
+ * clients of a bulk request can override single parameters of the shared
+ * ones. Each parameter set owns its neighbor list.
+ */
+static int
+hostapd_bss_tr_parse(struct blob_attr **tb, const struct ubus_bss_tr_params *base,
+		     struct ubus_bss_tr_params *p)
+{
+	struct blob_attr *cur;
+
+	*p = *base;
+	p->nr = NULL;
+	p->nr_len = 0;
+
+	if ((cur = tb[BSS_TR_DA_TIMER]) != NULL)
+		p->disassoc_timer = blobmsg_get_u32(cur);
+
+	if ((cur = tb[BSS_TR_VALID_PERIOD]) != NULL)
+		p->validity_period = blobmsg_get_u32(cur);
+
+	if ((cur = tb[BSS_TR_DIALOG_TOKEN]) != NULL)
+		p->dialog_token = blobmsg_get_u32(cur);
+
+	if ((cur = tb[BSS_TR_DA_IMMINENT]) != NULL)
+		p->disassoc_imminent = blobmsg_get_bool(cur);
+
+	if ((cur = tb[BSS_TR_ABRIDGED]) != NULL)
+		p->abridged = blobmsg_get_bool(cur);
+
+#ifdef CONFIG_MBO
+	if ((cur = tb[BSS_TR_MBO_REASON]) != NULL) {
+		if (blobmsg_get_u32(cur) > MBO_TRANSITION_REASON_PREMIUM_AP)
+			return UBUS_STATUS_INVALID_ARGUMENT;
+
+		p->mbo_reason = blobmsg_get_u32(cur);
 	}
 
-	if (nr)
+	if ((cur = tb[BSS_TR_CELL_PREF]) != NULL) {
+		u32 val = blobmsg_get_u32(cur);
+
+		if (val != 0 && val != 1 && val != 255)
+			return UBUS_STATUS_INVALID_ARGUMENT;
+
+		p->cell_pref = val;
+	}
+
+	if ((cur = tb[BSS_TR_REASSOC_DELAY]) != NULL) {
+		if (blobmsg_get_u32(cur) > 65535)
+			return UBUS_STATUS_INVALID_ARGUMENT;
+
+		p->reassoc_delay = blobmsg_get_u32(cur);
+	}
+
+	if (p->reassoc_delay && !p->disassoc_imminent)
+		return UBUS_STATUS_INVALID_ARGUMENT;
+#endif
+
+	if (tb[BSS_TR_NEIGHBORS])
+		return hostapd_bss_tr_parse_neighbors(tb[BSS_TR_NEIGHBORS], p);
+
+	if (base->nr) {
+		p->nr = os_memdup(base->nr, base->nr_len);
+		if (!p->nr)
+			return UBUS_STATUS_UNKNOWN_ERROR;
+
+		p->nr_len = base->nr_len;
+	}
+
+	return 0;
+}
+
+static int
+hostapd_bss_tr_send(struct hostapd_data *hapd, const u8 *addr,
+		    const struct ubus_bss_tr_params *p)
+{
+	struct sta_info *sta;
+	u8 req_mode = 0;
+	u8 mbo[10];
+	size_t mbo_len = 0;
+
+	sta = ap_get_sta(hapd, addr);
+	if (!sta)
+		return UBUS_STATUS_NOT_FOUND;
+
+	if (p->nr)
 		req_mode |= WNM_BSS_TM_REQ_PREF_CAND_LIST_INCLUDED;
 
-	if (abridged)
+	if (p->abridged)
 		req_mode |= WNM_BSS_TM_REQ_ABRIDGED;
 
-	if (disassoc_imminent)
+	if (p->disassoc_imminent)
 		req_mode |= WNM_BSS_TM_REQ_DISASSOC_IMMINENT;
 
 #ifdef CONFIG_MBO
 	u8 *mbo_pos = mbo;
 
-	if (mbo_reason > MBO_TRANSITION_REASON_PREMIUM_AP)
-		return UBUS_STATUS_INVALID_ARGUMENT;
-
-	if (cell_pref != 0 && cell_pref != 1 && cell_pref != 255)
-		return UBUS_STATUS_INVALID_ARGUMENT;
-
-	if (reassoc_delay > 65535 || (reassoc_delay && !disassoc_imminent))
-		return UBUS_STATUS_INVALID_ARGUMENT;
-
 	*mbo_pos++ = MBO_ATTR_ID_TRANSITION_REASON;
 	*mbo_pos++ = 1;
-	*mbo_pos++ = mbo_reason;
+	*mbo_pos++ = p->mbo_reason;
 	*mbo_pos++ = MBO_ATTR_ID_CELL_DATA_PREF;
 	*mbo_pos++ = 1;
-	*mbo_pos++ = cell_pref;
+	*mbo_pos++ = p->cell_pref;
 
-	if (reassoc_delay) {
+	if (p->reassoc_delay) {
 		*mbo_pos++ = MBO_ATTR_ID_ASSOC_RETRY_DELAY;
 		*mbo_pos++ = 2;
-		WPA_PUT_LE16(mbo_pos, reassoc_delay);
+		WPA_PUT_LE16(mbo_pos, p->reassoc_delay);
 		mbo_pos += 2;
 	}
 
 	mbo_len = mbo_pos - mbo;
 #endif
 
-	if (wnm_send_bss_tm_req(hapd, sta, req_mode, disassoc_timer, validity_period, NULL,
-				dialog_token, NULL, nr, nr_len, mbo_len ? mbo : NULL, mbo_len))
+	if (wnm_send_bss_tm_req(hapd, sta, req_mode, p->disassoc_timer,
+				p->validity_period, NULL, p->dialog_token, NULL,
+				p->nr, p->nr_len, mbo_len ? mbo : NULL, mbo_len))
 		return UBUS_STATUS_UNKNOWN_ERROR;
 
 	return 0;
 }
 
-enum {
-	BSS_TR_ADDR,
-	BSS_TR_DA_IMMINENT,
-	BSS_TR_DA_TIMER,
-	BSS_TR_VALID_PERIOD,
-	BSS_TR_NEIGHBORS,
-	BSS_TR_ABRIDGED,
-	BSS_TR_DIALOG_TOKEN,
-#ifdef CONFIG_MBO
-	BSS_TR_MBO_REASON,
-	BSS_TR_CELL_PREF,
-	BSS_TR_REASSOC_DELAY,
-#endif
-	__BSS_TR_DISASSOC_MAX
-};
+static void
+hostapd_bss_tr_batch_free(struct hostapd_data *hapd);
 
-static const struct blobmsg_policy bss_tr_policy[__BSS_TR_DISASSOC_MAX] = {
-	[BSS_TR_ADDR] = { "addr", BLOBMSG_TYPE_STRING },
-	[BSS_TR_DA_IMMINENT] = { "disassociation_imminent", BLOBMSG_TYPE_BOOL },
-	[BSS_TR_DA_TIMER] = { "disassociation_timer", BLOBMSG_TYPE_INT32 },
-	[BSS_TR_VALID_PERIOD] = { "validity_period", BLOBMSG_TYPE_INT32 },
-	[BSS_TR_NEIGHBORS] = { "neighbors", BLOBMSG_TYPE_ARRAY },
-	[BSS_TR_ABRIDGED] = { "abridged", BLOBMSG_TYPE_BOOL },
-	[BSS_TR_DIALOG_TOKEN] = { "dialog_token", BLOBMSG_TYPE_INT32 },
-#ifdef CONFIG_MBO
-	[BSS_TR_MBO_REASON] = { "mbo_reason", BLOBMSG_TYPE_INT32 },
-	[BSS_TR_CELL_PREF] = { "cell_pref", BLOBMSG_TYPE_INT32 },
-	[BSS_TR_REASSOC_DELAY] = { "reassoc_delay", BLOBMSG_TYPE_INT32 },
-#endif
-};
+static void
+hostapd_bss_tr_batch_next(void *eloop_data, void *user_ctx)
+{
+	struct hostapd_data *hapd = eloop_data;
+	struct ubus_bss_tr_batch *batch = hapd->ubus.bss_tr_batch;
+	struct ubus_bss_tr_client *c = &batch->clients[batch->next++];
+
+	/* clients that left meanwhile are skipped */
+	hostapd_bss_tr_send(hapd, c->addr, c->params);
+
+	if (batch->next == batch->n_clients) {
+		hostapd_bss_tr_batch_free(hapd);
+		return;
+	}
+
+	eloop_register_timeout(batch->interval / 1000,
+			       (batch->interval % 1000) * 1000,
+			       hostapd_bss_tr_batch_next, hapd, NULL);
+}
+
+static void
+hostapd_bss_tr_batch_release(struct ubus_bss_tr_batch *batch)
+{
+	int i;
+
+	for (i = 0; i < batch->n_clients; i++) {
+		struct ubus_bss_tr_params *p = batch->clients[i].params;
+
+		if (p == &batch->params)
+			continue;
+
+		os_free(p->nr);
+		free(p);
+	}
+
+	os_free(batch->params.nr);
+	free(batch);
+}
+
+static void
+hostapd_bss_tr_batch_free(struct hostapd_data *hapd)
+{
+	if (!hapd->ubus.bss_tr_batch)
+		return;
+
+	eloop_cancel_timeout(hostapd_bss_tr_batch_next, hapd, NULL);
+	hostapd_bss_tr_batch_release(hapd->ubus.bss_tr_batch);
+	hapd->ubus.bss_tr_batch = NULL;
+}
+
+/*
+ * Steer a list of clients at once, each given by its address or by a table
+ * with the address and any parameters that differ from the shared ones.
+ * Everything is parsed up front, and the requests are sent one per
+ * interval. A new bulk request replaces a pending one.
+ */
+static int
+hostapd_bss_tr_bulk(struct hostapd_data *hapd, struct blob_attr **tb,
+		    const struct ubus_bss_tr_params *base)
+{
+	struct ubus_bss_tr_batch *batch;
+	struct blob_attr *cur;
+	int n, rem, ret;
+
+	n = blobmsg_check_array(tb[BSS_TR_CLIENTS], BLOBMSG_TYPE_UNSPEC);
+	if (n <= 0)
+		return UBUS_STATUS_INVALID_ARGUMENT;
+
+	batch = os_zalloc(sizeof(*batch) + n * sizeof(batch->clients[0]));
+	if (!batch)
+		return UBUS_STATUS_UNKNOWN_ERROR;
+
+	ret = hostapd_bss_tr_parse(tb, base, &batch->params);
+	if (ret)
+		goto error;
+
+	batch->interval = BSS_TR_BATCH_INTERVAL;
+	if (tb[BSS_TR_INTERVAL])
+		batch->interval = blobmsg_get_u32(tb[BSS_TR_INTERVAL]);
+
+	blobmsg_for_each_attr(cur, tb[BSS_TR_CLIENTS], rem) {
+		struct ubus_bss_tr_client *c = &batch->clients[batch->n_clients];
+		struct blob_attr *ctb[__BSS_TR_DISASSOC_MAX];
+		struct ubus_bss_tr_params *p;
+
+		ret = UBUS_STATUS_INVALID_ARGUMENT;
+		if (blobmsg_type(cur) == BLOBMSG_TYPE_STRING) {
+			if (hwaddr_aton(blobmsg_get_string(cur), c->addr))
+				goto error;
+
+			c->params = &batch->params;
+			batch->n_clients++;
+			continue;
+		}
+
+		if (blobmsg_type(cur) != BLOBMSG_TYPE_TABLE)
+			goto error;
+
+		blobmsg_parse(bss_tr_policy, __BSS_TR_DISASSOC_MAX, ctb,
+			      blobmsg_data(cur), blobmsg_len(cur));
+		if (!ctb[BSS_TR_ADDR] ||
+		    hwaddr_aton(blobmsg_get_string(ctb[BSS_TR_ADDR]), c->addr))
+			goto error;
+
+		p = os_zalloc(sizeof(*p));
+		if (!p) {
+			ret = UBUS_STATUS_UNKNOWN_ERROR;
+			goto error;
+		}
+
+		ret = hostapd_bss_tr_parse(ctb, &batch->params, p);
+		if (ret) {
+			free(p);
+			goto error;
+		}
+
+		c->params = p;
+		batch->n_clients++;
+	}
+
+	hostapd_bss_tr_batch_free(hapd);
+	hapd->ubus.bss_tr_batch = batch;
+	hostapd_bss_tr_batch_next(hapd, NULL);
+
+	return 0;
+
+error:
+	hostapd_bss_tr_batch_release(batch);
+	return ret;
+}
 
 static int
 hostapd_bss_transition_request(struct ubus_context *ctx, struct ubus_object *obj,
@@ -1465,51 +2764,33 @@ hostapd_bss_transition_request(struct ubus_context *ctx, struct ubus_object *obj
 			       struct blob_attr *msg)
 {
 	struct hostapd_data *hapd = container_of(obj, struct hostapd_data, ubus.obj);
+	static const struct ubus_bss_tr_params defaults = {
+		.dialog_token = 1,
+	};
 	struct blob_attr *tb[__BSS_TR_DISASSOC_MAX];
-	struct sta_info *sta;
-	u32 da_timer = 0;
-	u32 valid_period = 0;
+	struct ubus_bss_tr_params p;
 	u8 addr[ETH_ALEN];
-	u32 dialog_token = 1;
-	bool abridged;
-	bool da_imminent;
-	u8 mbo_reason;
-	u8 cell_pref;
-	u8 reassoc_delay;
+	int ret;
 
 	blobmsg_parse(bss_tr_policy, __BSS_TR_DISASSOC_MAX, tb, blob_data(msg), blob_len(msg));
 
+	if (tb[BSS_TR_CLIENTS])
+		return hostapd_bss_tr_bulk(hapd, tb, &defaults);
+
 	if (!tb[BSS_TR_ADDR])
 		return UBUS_STATUS_INVALID_ARGUMENT;
 
 	if (hwaddr_aton(blobmsg_data(tb[BSS_TR_ADDR]), addr))
 		return UBUS_STATUS_INVALID_ARGUMENT;
 
-	if (tb[BSS_TR_DA_TIMER])
-		da_timer = blobmsg_get_u32(tb[BSS_TR_DA_TIMER]);
-
-	if (tb[BSS_TR_VALID_PERIOD])
-		valid_period = blobmsg_get_u32(tb[BSS_TR_VALID_PERIOD]);
-
-	if (tb[BSS_TR_DIALOG_TOKEN])
-		dialog_token = blobmsg_get_u32(tb[BSS_TR_DIALOG_TOKEN]);
-
-	da_imminent = !!(tb[BSS_TR_DA_IMMINENT] && blobmsg_get_bool(tb[BSS_TR_DA_IMMINENT]));
-	abridged = !!(tb[BSS_TR_ABRIDGED] && blobmsg_get_bool(tb[BSS_TR_ABRIDGED]));
-
-#ifdef CONFIG_MBO
-	if (tb[BSS_TR_MBO_REASON])
-		mbo_reason = blobmsg_get_u32(tb[BSS_TR_MBO_REASON]);
-
-	if (tb[BSS_TR_CELL_PREF])
-		cell_pref = blobmsg_get_u32(tb[BSS_TR_CELL_PREF]);
+	ret = hostapd_bss_tr_parse(tb, &defaults, &p);
+	if (ret)
+		return ret;
 
-	if (tb[BSS_TR_REASSOC_DELAY])
-		reassoc_delay = blobmsg_get_u32(tb[BSS_TR_REASSOC_DELAY]);
-#endif
+	ret = hostapd_bss_tr_send(hapd, addr, &p);
+	os_free(p.nr);
 
-	return hostapd_bss_tr_send(hapd, addr, da_imminent, abridged, da_timer, valid_period,
-				   dialog_token, tb[BSS_TR_NEIGHBORS], mbo_reason, cell_pref, reassoc_delay);
+	return ret;
 }
 #endif
 
@@ -1617,7 +2898,7 @@ hostapd_bss_get_sta_ies(struct ubus_context *ctx, struct ubus_object *obj,
 
 static const struct ubus_method bss_methods[] = {
 	UBUS_METHOD_NOARG("reload", hostapd_bss_reload),
-	UBUS_METHOD_NOARG("get_clients", hostapd_bss_get_clients),
+	UBUS_METHOD("get_clients", hostapd_bss_get_clients, get_clients_policy),
 #ifdef CONFIG_TAXONOMY
 	UBUS_METHOD("get_sta_ies", hostapd_bss_get_sta_ies, addr_policy),
 #endif
@@ -1627,6 +2908,7 @@ static const struct ubus_method bss_methods[] = {
 	UBUS_METHOD("update_airtime", hostapd_bss_update_airtime, airtime_policy),
 #endif
 	UBUS_METHOD_NOARG("list_bans", hostapd_bss_list_bans),
+	UBUS_METHOD("ban_clients", hostapd_bss_ban_clients, ban_clients_policy),
 #ifdef CONFIG_WPS
 	UBUS_METHOD_NOARG("wps_start", hostapd_bss_wps_start),
 	UBUS_METHOD_NOARG("wps_status", hostapd_bss_wps_status),
@@ -1639,11 +2921,13 @@ static const struct ubus_method bss_methods[] = {
 #endif
 	UBUS_METHOD("set_vendor_elements", hostapd_vendor_elements, ve_policy),
 	UBUS_METHOD("notify_response", hostapd_notify_response, notify_policy),
+	UBUS_METHOD("probe_summary", hostapd_probe_summary, probe_summary_policy),
 	UBUS_METHOD("bss_mgmt_enable", hostapd_bss_mgmt_enable, bss_mgmt_enable_policy),
 	UBUS_METHOD_NOARG("rrm_nr_get_own", hostapd_rrm_nr_get_own),
 	UBUS_METHOD_NOARG("rrm_nr_list", hostapd_rrm_nr_list),
 	UBUS_METHOD("rrm_nr_set", hostapd_rrm_nr_set, nr_set_policy),
 	UBUS_METHOD("rrm_beacon_req", hostapd_rrm_beacon_req, beacon_req_policy),
+	UBUS_METHOD("rrm_beacon_reports", hostapd_rrm_beacon_reports, beacon_reports_policy),
 	UBUS_METHOD("link_measurement_req", hostapd_rrm_lm_req, lm_req_policy),
 #ifdef CONFIG_WNM_AP
 	UBUS_METHOD("bss_transition_request", hostapd_bss_transition_request, bss_tr_policy),
@@ -1755,6 +3039,10 @@ void hostapd_ubus_add_bss(struct hostapd_data *hapd)
 		return;
 
 	avl_init(&hapd->ubus.banned, avl_compare_macaddr, false, NULL);
+	avl_init(&hapd->ubus.verdicts, avl_compare_macaddr, false, NULL);
+	avl_init(&hapd->ubus.sta_data, avl_compare_macaddr, false, NULL);
+	avl_init(&hapd->ubus.probes, avl_compare_macaddr, false, NULL);
+	avl_init(&hapd->ubus.beacon_reports, avl_compare_macaddr, false, NULL);
 	obj->name = name;
 	if (!strcmp(hapd->driver->name, "wired")) {
 		obj->type = &wired_object_type;
@@ -1783,6 +3071,17 @@ void hostapd_ubus_free_bss(struct hostapd_data *hapd)
 		return;
 
 	if (obj->id) {
+		eloop_cancel_timeout(hostapd_verdict_gc, hapd, NULL);
+		hostapd_verdict_flush(hapd, true);
+		hostapd_ubus_flush_sta_data(hapd, true);
+		eloop_cancel_timeout(hostapd_probe_summary_timeout, hapd, NULL);
+		hostapd_probe_summary_flush(hapd, false);
+		hostapd_beacon_batch_free(hapd);
+		hostapd_beacon_reports_gc(hapd, true);
+#ifdef CONFIG_WNM_AP
+		hostapd_bss_tr_batch_free(hapd);
+#endif
+		hostapd_bss_flush_bans(hapd);
 		ubus_remove_object(ctx, obj);
 		hostapd_ubus_ref_dec();
 	}
@@ -1843,6 +3142,7 @@ ubus_event_cb(struct ubus_notify_request *req, int idx, int ret)
 int hostapd_ubus_handle_event(struct hostapd_data *hapd, struct hostapd_ubus_request *req)
 {
 	struct ubus_banned_client *ban;
+	struct ubus_probe_verdict *v = NULL;
 	const char *types[HOSTAPD_UBUS_TYPE_MAX] = {
 		[HOSTAPD_UBUS_PROBE_REQ] = "probe",
 		[HOSTAPD_UBUS_AUTH_REQ] = "auth",
@@ -1864,6 +3164,23 @@ int hostapd_ubus_handle_event(struct hostapd_data *hapd, struct hostapd_ubus_req
 	if (!hapd->ubus.obj.has_subscribers)
 		return WLAN_STATUS_SUCCESS;
 
+	/* without responses probe requests only need to be counted */
+	if (!hapd->ubus.notify_response && hapd->ubus.probe_interval &&
+	    req->type == HOSTAPD_UBUS_PROBE_REQ) {
+		hostapd_probe_summary_add(hapd, addr, req->ssi_signal);
+		return WLAN_STATUS_SUCCESS;
+	}
+
+	if (hapd->ubus.notify_response && hapd->ubus.verdict_ttl > 0 &&
+	    req->type == HOSTAPD_UBUS_PROBE_REQ) {
+		struct os_reltime now;
+
+		os_get_reltime(&now);
+		v = avl_find_element(&hapd->ubus.verdicts, addr, v, avl);
+		if (v && (v->pending || !os_reltime_before(&v->expire, &now)))
+			return v->resp;
+	}
+
 	if (req->type < ARRAY_SIZE(types))
 		type = types[req->type];
 
@@ -1922,6 +3239,9 @@ int hostapd_ubus_handle_event(struct hostapd_data *hapd, struct hostapd_ubus_req
 		return WLAN_STATUS_SUCCESS;
 	}
 
+	if (hapd->ubus.verdict_ttl > 0 && req->type == HOSTAPD_UBUS_PROBE_REQ)
+		return hostapd_verdict_query(hapd, v, addr, type);
+
 	if (ubus_notify_async(ctx, &hapd->ubus.obj, type, b.head, &ureq.nreq))
 		return WLAN_STATUS_SUCCESS;
 
@@ -1977,25 +3297,21 @@ void hostapd_ubus_notify_beacon_report(
 	struct hostapd_data *hapd, const u8 *addr, u8 token, u8 rep_mode,
 	struct rrm_measurement_beacon_report *rep, size_t len)
 {
-	if (!hapd->ubus.obj.has_subscribers)
+	if (!hapd->ubus.obj.id)
 		return;
 
 	if (!addr || !rep)
 		return;
 
+	if (hostapd_beacon_report_add(hapd, addr, token, rep_mode, rep))
+		return;
+
+	if (!hapd->ubus.obj.has_subscribers)
+		return;
+
 	blob_buf_init(&b, 0);
 	blobmsg_add_macaddr(&b, "address", addr);
-	blobmsg_add_u16(&b, "op-class", rep->op_class);
-	blobmsg_add_u16(&b, "channel", rep->channel);
-	blobmsg_add_u64(&b, "start-time", rep->start_time);
-	blobmsg_add_u16(&b, "duration", rep->duration);
-	blobmsg_add_u16(&b, "report-info", rep->report_info);
-	blobmsg_add_u16(&b, "rcpi", rep->rcpi);
-	blobmsg_add_u16(&b, "rsni", rep->rsni);
-	blobmsg_add_macaddr(&b, "bssid", rep->bssid);
-	blobmsg_add_u16(&b, "antenna-id", rep->antenna_id);
-	blobmsg_add_u16(&b, "parent-tsf", rep->parent_tsf);
-	blobmsg_add_u16(&b, "rep-mode", rep_mode);
+	hostapd_ubus_add_beacon_report(rep, rep_mode);
 
 	ubus_notify(ctx, &hapd->ubus.obj, "beacon-report", b.head, -1);
 }
@@ -28,6 +28,8 @@ struct hostapd_data;
 struct hapd_interfaces;
 struct rrm_measurement_beacon_report;
 struct sta_info;
+struct ubus_beacon_batch;
+struct ubus_bss_tr_batch;
 
 #ifdef UBUS_SUPPORT
 
@@ -37,7 +39,15 @@ struct sta_info;
 struct hostapd_ubus_bss {
 	struct ubus_object obj;
 	struct avl_tree banned;
+	struct avl_tree verdicts;
+	struct avl_tree sta_data;
+	struct avl_tree probes;
+	struct avl_tree beacon_reports;
+	struct ubus_beacon_batch *beacon_batch;
+	struct ubus_bss_tr_batch *bss_tr_batch;
 	int notify_response;
+	int verdict_ttl;
+	int probe_interval;
 };
 
 void hostapd_ubus_add_iface(struct hostapd_iface *iface);
@@ -10,6 +10,7 @@
 #include "dfs.h"
 #include "acs.h"
 #include "ieee802_11_auth.h"
+#include "ctrl_iface_ap.h"
 #include <libubox/uloop.h>
 
 static uc_resource_type_t *global_type, *bss_type, *iface_type;
@@ -204,6 +205,126 @@ bss_reload_vlans(struct hostapd_data *hapd, struct hostapd_bss_config *bss)
 	return 0;
 }
 
+#define swap_field(name)				\
+	do {								\
+		__typeof__(old_bss->name) tmp = old_bss->name;	\
+		old_bss->name = bss->name;		\
+		bss->name = tmp;				\
+	} while (0)
+
+/* for bit fields, which __typeof__ can't be applied to */
+#define swap_flag(name)					\
+	do {								\
+		unsigned int tmp = old_bss->name;	\
+		old_bss->name = bss->name;		\
+		bss->name = tmp;				\
+	} while (0)
+
+static bool
+bss_psk_changed(struct hostapd_bss_config *old_bss,
+		struct hostapd_bss_config *bss)
+{
+	struct hostapd_wpa_psk *psk, *old_psk;
+	struct sae_password_entry *pw, *old_pw;
+
+	if (!!old_bss->ssid.wpa_passphrase != !!bss->ssid.wpa_passphrase ||
+	    (bss->ssid.wpa_passphrase &&
+	     strcmp(old_bss->ssid.wpa_passphrase, bss->ssid.wpa_passphrase) != 0))
+		return true;
+
+	/* only the explicitly configured PSKs, derived ones are not set yet */
+	for (psk = bss->ssid.wpa_psk; psk; psk = psk->next) {
+		for (old_psk = old_bss->ssid.wpa_psk; old_psk; old_psk = old_psk->next)
+			if (!os_memcmp(psk->psk, old_psk->psk, PMK_LEN) &&
+			    !os_memcmp(psk->addr, old_psk->addr, ETH_ALEN))
+				break;
+		if (!old_psk)
+			return true;
+	}
+
+	for (pw = bss->sae_passwords, old_pw = old_bss->sae_passwords;
+	     pw && old_pw; pw = pw->next, old_pw = old_pw->next)
+		if (strcmp(pw->password, old_pw->password) != 0 ||
+		    !!pw->identifier != !!old_pw->identifier ||
+		    (pw->identifier &&
+		     strcmp(pw->identifier, old_pw->identifier) != 0) ||
+		    pw->vlan_id != old_pw->vlan_id)
+			return true;
+
+	return pw || old_pw;
+}
+
+static bool
+bss_acl_changed(struct hostapd_bss_config *old_bss,
+		struct hostapd_bss_config *bss)
+{
+	return old_bss->macaddr_acl != bss->macaddr_acl ||
+	       old_bss->num_accept_mac != bss->num_accept_mac ||
+	       old_bss->num_deny_mac != bss->num_deny_mac ||
+	       os_memcmp(old_bss->accept_mac, bss->accept_mac,
+			 bss->num_accept_mac * sizeof(*bss->accept_mac)) ||
+	       os_memcmp(old_bss->deny_mac, bss->deny_mac,
+			 bss->num_deny_mac * sizeof(*bss->deny_mac));
+}
+
+/*
+ * Apply the settings that can change without restarting the BSS: PSKs,
+ * SAE passwords, MAC address ACLs and VLAN interface names. Anything
+ * else is left alone, the caller restarts the BSS for that. Changes to
+ * the PSK and RxKH files are picked up by RELOAD_WPA_PSK and RELOAD_RXKHS.
+ */
+static int
+bss_reload_in_place(struct hostapd_data *hapd, struct hostapd_bss_config *bss)
+{
+	struct hostapd_bss_config *old_bss = hapd->conf;
+	bool psk_changed, acl_changed;
+
+	if (bss_reload_vlans(hapd, bss))
+		return -1;
+
+	psk_changed = bss_psk_changed(old_bss, bss);
+	acl_changed = bss_acl_changed(old_bss, bss);
+
+	swap_field(ssid.wpa_psk_file);
+#ifdef CONFIG_IEEE80211R_AP
+	swap_field(rxkh_file);
+#endif
+	if (psk_changed) {
+		swap_field(ssid.wpa_passphrase);
+		swap_flag(ssid.wpa_passphrase_set);
+		swap_field(ssid.wpa_psk);
+		swap_flag(ssid.wpa_psk_set);
+		swap_field(sae_passwords);
+#ifdef CONFIG_SAE
+		swap_field(ssid.pt);
+#endif
+		if (hostapd_setup_wpa_psk(old_bss)) {
+			wpa_printf(MSG_ERROR, "Failed to set up WPA PSKs for %s",
+				   old_bss->iface);
+			return -1;
+		}
+	}
+
+	if (acl_changed) {
+		swap_field(macaddr_acl);
+		swap_field(accept_mac);
+		swap_field(num_accept_mac);
+		swap_field(deny_mac);
+		swap_field(num_deny_mac);
+		hostapd_disassoc_accept_mac(hapd);
+		hostapd_disassoc_deny_mac(hapd);
+	}
+
+	/* stations need to reconnect using the new credentials */
+	if (psk_changed) {
+		wpa_printf(MSG_INFO, "Credentials of %s changed, disconnecting stations",
+			   old_bss->iface);
+		hostapd_flush_old_stations(hapd, WLAN_REASON_PREV_AUTH_NOT_VALID);
+	}
+
+	return 0;
+}
+
 static uc_value_t *
 uc_hostapd_bss_set_config(uc_vm_t *vm, size_t nargs)
 {
@@ -232,19 +353,8 @@ uc_hostapd_bss_set_config(uc_vm_t *vm, size_t nargs)
 		goto free;
 
 	if (ucv_boolean_get(files_only)) {
-		struct hostapd_bss_config *bss = conf->bss[idx];
-		struct hostapd_bss_config *old_bss = hapd->conf;
-
-#define swap_field(name)				\
-	do {								\
-		void *ptr = old_bss->name;		\
-		old_bss->name = bss->name;		\
-		bss->name = ptr;				\
-	} while (0)
-
-		swap_field(ssid.wpa_psk_file);
-		ret = bss_reload_vlans(hapd, bss);
-		goto done;
+		ret = bss_reload_in_place(hapd, conf->bss[idx]);
+		goto free;
 	}
 
 	hostapd_bss_deinit_no_free(hapd);
@@ -261,8 +371,6 @@ uc_hostapd_bss_set_config(uc_vm_t *vm, size_t nargs)
 	hostapd_setup_bss(hapd, hapd == iface->bss[0], true);
 	hostapd_ucode_update_interfaces();
 	hostapd_owe_update_trans(iface);
-
-done:
 	ret = 0;
 free:
 	hostapd_config_free(conf);
@@ -447,6 +555,54 @@ free:
 	return NULL;
 }
 
+static uc_value_t *
+uc_hostapd_iface_reload_rates(uc_vm_t *vm, size_t nargs)
+{
+	struct hostapd_iface *iface = uc_fn_thisval("hostapd.iface");
+	struct hostapd_config *old_conf, *conf;
+	uc_value_t *file = uc_fn_arg(0);
+	int ret = -1;
+
+	if (!iface || !iface->current_mode || ucv_type(file) != UC_STRING)
+		goto out;
+
+	conf = interfaces->config_read_cb(ucv_string_get(file));
+	if (!conf)
+		goto out;
+
+	old_conf = iface->conf;
+
+#define swap_rates()						\
+	do {								\
+		int *rates = old_conf->supported_rates;		\
+		old_conf->supported_rates = conf->supported_rates;	\
+		conf->supported_rates = rates;			\
+		rates = old_conf->basic_rates;			\
+		old_conf->basic_rates = conf->basic_rates;		\
+		conf->basic_rates = rates;				\
+	} while (0)
+
+	swap_rates();
+	if (hostapd_prepare_rates(iface, iface->current_mode)) {
+		wpa_printf(MSG_ERROR, "Failed to set new rates on %s", iface->phy);
+		swap_rates();
+		hostapd_prepare_rates(iface, iface->current_mode);
+		goto free;
+	}
+
+	old_conf->beacon_rate = conf->beacon_rate;
+	old_conf->rate_type = conf->rate_type;
+	if (ieee802_11_set_beacons(iface))
+		goto free;
+
+	ret = 0;
+
+free:
+	hostapd_config_free(conf);
+out:
+	return ucv_int64_new(ret);
+}
+
 static uc_value_t *
 uc_hostapd_bss_ctrl(uc_vm_t *vm, size_t nargs)
 {
@@ -876,6 +1032,7 @@ int hostapd_ucode_init(struct hapd_interfaces *ifaces)
 	};
 	static const uc_function_list_t iface_fns[] = {
 		{ "set_bss_order", uc_hostapd_iface_set_bss_order },
+		{ "reload_rates", uc_hostapd_iface_reload_rates },
 		{ "add_bss", uc_hostapd_iface_add_bss },
 		{ "stop", uc_hostapd_iface_stop },
 		{ "start", uc_hostapd_iface_start },
@@ -218,10 +218,19 @@ proto_pppoe_init_config() {
 	proto_config_add_string "host_uniq"
 	proto_config_add_int "padi_attempts"
 	proto_config_add_int "padi_timeout"
+	proto_config_add_boolean "reuse_session"
 
 	lasterror=1
 }
 
+# The session of a connection lost with the carrier is still up on the
+# access concentrator, which may refuse a new one from our address until
+# it times out. ppp-up records the session of the connection, and the next
+# pppd resumes it instead of going through discovery again.
+pppoe_session_file() {
+	echo "/var/run/pppoe-$1.session"
+}
+
 proto_pppoe_setup() {
 	local config="$1"
 	local iface="$2"
@@ -236,9 +245,23 @@ proto_pppoe_setup() {
 	json_get_var host_uniq host_uniq
 	json_get_var padi_attempts padi_attempts
 	json_get_var padi_timeout padi_timeout
+	json_get_var reuse_session reuse_session
+
+	local session_file="$(pppoe_session_file "$config")"
+	local session
+
+	if [ "${reuse_session:-0}" -gt 0 ]; then
+		# tried once, a failed resume falls back to discovery
+		session="$(cat "$session_file" 2>/dev/null)"
+		rm -f "$session_file"
+	else
+		unset reuse_session
+	fi
 
 	ppp_generic_setup "$config" \
 		plugin pppoe.so \
+		${reuse_session:+set PPPOE_IFACE="$iface"} \
+		${session:+rp_pppoe_sess "$session" lcp-max-configure 3} \
 		${ac:+rp_pppoe_ac "$ac"} \
 		${service:+rp_pppoe_service "$service"} \
 		${host_uniq:+host-uniq "$host_uniq"} \
@@ -248,6 +271,13 @@ proto_pppoe_setup() {
 }
 
 proto_pppoe_teardown() {
+	local interface="$1"
+	local iface="$2"
+
+	# without a carrier, the PADT of pppd does not reach the peer
+	[ "$(cat "/sys/class/net/$iface/carrier" 2>/dev/null)" = 0 ] || \
+		rm -f "$(pppoe_session_file "$interface")"
+
 	ppp_generic_teardown "$@"
 }
 
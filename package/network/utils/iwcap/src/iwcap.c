@@ -26,15 +26,19 @@
 #include <signal.h>
 #include <syslog.h>
 #include <errno.h>
+#include <poll.h>
 #include <byteswap.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
 #include <sys/socket.h>
 #include <net/ethernet.h>
 #include <net/if.h>
 #include <netinet/in.h>
 #include <linux/if_packet.h>
+#include <linux/filter.h>
 
 #define ARPHRD_IEEE80211_RADIOTAP	803
 
@@ -45,6 +49,13 @@
 #define FRAMETYPE_BEACON			0x80
 #define FRAMETYPE_DATA				0x08
 
+#define RING_BLOCK_SIZE				(1 << 16)
+#define RING_BLOCK_NUM				16
+#define RING_FRAME_SIZE				2048
+#define RING_RETIRE_MSEC			50
+
+#define STREAM_BATCH				256
+
 #if __BYTE_ORDER == __BIG_ENDIAN
 #define le16(x) __bswap_16(x)
 #else
@@ -57,6 +68,7 @@ uint8_t run_daemon = 0;
 
 uint32_t frames_captured = 0;
 uint32_t frames_filtered = 0;
+uint32_t frames_dropped  = 0;
 
 int capture_sock = -1;
 const char *ifname = NULL;
@@ -100,6 +112,18 @@ typedef struct ieee80211_radiotap_header {
 	u_int32_t it_present;    /* fields present */
 } __attribute__((__packed__)) radiotap_hdr_t;
 
+struct capture_ring {
+	struct tpacket_req3 req; /* kernel ring layout */
+	uint8_t *map;            /* mapped ring memory */
+	uint32_t block;          /* next block to read */
+};
+
+struct stream_buf {
+	pcaprec_hdr_t hdr[STREAM_BATCH];     /* queued frame headers */
+	struct iovec iov[STREAM_BATCH * 2];  /* header and payload pairs */
+	uint32_t num;                        /* number of queued frames */
+};
+
 
 int check_type(void)
 {
@@ -171,11 +195,10 @@ void write_pcap_header(FILE *o)
 	fwrite(&ghdr, 1, sizeof(ghdr), o);
 }
 
-void write_pcap_frame(FILE *o, uint32_t *sec, uint32_t *usec,
-					  uint16_t len, uint16_t olen)
+void fill_pcap_frame(pcaprec_hdr_t *fhdr, uint32_t *sec, uint32_t *usec,
+					 uint16_t len, uint16_t olen)
 {
 	struct timeval tv;
-	pcaprec_hdr_t fhdr;
 
 	if (!sec || !usec)
 	{
@@ -187,15 +210,181 @@ void write_pcap_frame(FILE *o, uint32_t *sec, uint32_t *usec,
 		tv.tv_usec = *usec;
 	}
 
-	fhdr.ts_sec   = tv.tv_sec;
-	fhdr.ts_usec  = tv.tv_usec;
-	fhdr.incl_len = len;
-	fhdr.orig_len = olen;
+	fhdr->ts_sec   = tv.tv_sec;
+	fhdr->ts_usec  = tv.tv_usec;
+	fhdr->incl_len = len;
+	fhdr->orig_len = olen;
+}
+
+void write_pcap_frame(FILE *o, uint32_t *sec, uint32_t *usec,
+					  uint16_t len, uint16_t olen)
+{
+	pcaprec_hdr_t fhdr;
 
+	fill_pcap_frame(&fhdr, sec, usec, len, olen);
 	fwrite(&fhdr, 1, sizeof(fhdr), o);
 }
 
 
+/* queue a frame for the next vectored write to stdout, the payload is
+ * referenced in place and must stay valid until stream_flush() */
+void stream_add(struct stream_buf *s, uint8_t *buf, uint32_t *sec,
+				uint32_t *usec, uint16_t len, uint16_t olen)
+{
+	fill_pcap_frame(&s->hdr[s->num], sec, usec, len, olen);
+
+	s->iov[s->num * 2].iov_base     = &s->hdr[s->num];
+	s->iov[s->num * 2].iov_len      = sizeof(s->hdr[s->num]);
+	s->iov[s->num * 2 + 1].iov_base = buf;
+	s->iov[s->num * 2 + 1].iov_len  = len;
+
+	s->num++;
+}
+
+void stream_flush(struct stream_buf *s)
+{
+	struct iovec *iov = s->iov;
+	int cnt = s->num * 2;
+	ssize_t len;
+
+	while (cnt > 0)
+	{
+		len = writev(1, iov, cnt);
+
+		if (len < 0)
+		{
+			if (errno == EINTR)
+				continue;
+
+			break;
+		}
+
+		/* skip over completely written vectors, resume partial ones */
+		while (cnt > 0 && (size_t)len >= iov->iov_len)
+		{
+			len -= iov->iov_len;
+			iov++;
+			cnt--;
+		}
+
+		if (cnt > 0)
+		{
+			iov->iov_base = (uint8_t *)iov->iov_base + len;
+			iov->iov_len -= len;
+		}
+	}
+
+	s->num = 0;
+}
+
+
+int set_filter(uint8_t filter_beacon, uint8_t filter_data, uint16_t snaplen)
+{
+	struct sock_filter code[] = {
+		/* X = little endian radiotap header length */
+		BPF_STMT(BPF_LD  | BPF_B   | BPF_ABS, 3),
+		BPF_STMT(BPF_ALU | BPF_LSH | BPF_K,   8),
+		BPF_STMT(BPF_MISC | BPF_TAX, 0),
+		BPF_STMT(BPF_LD  | BPF_B   | BPF_ABS, 2),
+		BPF_STMT(BPF_ALU | BPF_OR  | BPF_X,   0),
+		BPF_STMT(BPF_MISC | BPF_TAX, 0),
+
+		/* A = 802.11 frame type, frames without one are dropped by
+		 * the out of bounds load */
+		BPF_STMT(BPF_LD  | BPF_B   | BPF_IND, 0),
+		BPF_STMT(BPF_ALU | BPF_AND | BPF_K,   FRAMETYPE_MASK),
+
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,   FRAMETYPE_BEACON, 0, 1),
+		BPF_STMT(BPF_RET | BPF_K, filter_beacon ? 0 : snaplen),
+		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K,   FRAMETYPE_DATA, 0, 1),
+		BPF_STMT(BPF_RET | BPF_K, filter_data ? 0 : snaplen),
+		BPF_STMT(BPF_RET | BPF_K, snaplen),
+	};
+
+	struct sock_fprog prog = {
+		.len    = sizeof(code) / sizeof(code[0]),
+		.filter = code
+	};
+
+	return setsockopt(capture_sock, SOL_SOCKET, SO_ATTACH_FILTER,
+					  &prog, sizeof(prog));
+}
+
+void update_drops(void)
+{
+	struct tpacket_stats_v3 st;
+	socklen_t len = sizeof(st);
+
+	/* counters are reset by the kernel on every read */
+	if (!getsockopt(capture_sock, SOL_PACKET, PACKET_STATISTICS, &st, &len))
+		frames_dropped += st.tp_drops;
+}
+
+
+int capture_ring_init(struct capture_ring *r)
+{
+	int ver = TPACKET_V3;
+	size_t size;
+
+	memset(r, 0, sizeof(*r));
+
+	r->req.tp_block_size       = RING_BLOCK_SIZE;
+	r->req.tp_block_nr         = RING_BLOCK_NUM;
+	r->req.tp_frame_size       = RING_FRAME_SIZE;
+	r->req.tp_frame_nr         = (RING_BLOCK_SIZE / RING_FRAME_SIZE) *
+	                             RING_BLOCK_NUM;
+	r->req.tp_retire_blk_tov   = RING_RETIRE_MSEC;
+	r->req.tp_feature_req_word = 0;
+
+	if (setsockopt(capture_sock, SOL_PACKET, PACKET_VERSION,
+				   &ver, sizeof(ver)))
+		return -1;
+
+	if (setsockopt(capture_sock, SOL_PACKET, PACKET_RX_RING,
+				   &r->req, sizeof(r->req)))
+		return -1;
+
+	size = (size_t)r->req.tp_block_size * r->req.tp_block_nr;
+	r->map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+				  capture_sock, 0);
+
+	if (r->map == MAP_FAILED)
+	{
+		r->map = NULL;
+		return -1;
+	}
+
+	return 0;
+}
+
+/* return the next block handed over by the kernel or NULL if none is ready */
+struct tpacket_block_desc * capture_ring_get(struct capture_ring *r)
+{
+	struct tpacket_block_desc *bd = (struct tpacket_block_desc *)
+		(r->map + (size_t)r->block * r->req.tp_block_size);
+
+	if (!(__atomic_load_n(&bd->hdr.bh1.block_status, __ATOMIC_ACQUIRE) &
+		  TP_STATUS_USER))
+		return NULL;
+
+	return bd;
+}
+
+void capture_ring_put(struct capture_ring *r, struct tpacket_block_desc *bd)
+{
+	__atomic_store_n(&bd->hdr.bh1.block_status, TP_STATUS_KERNEL,
+					 __ATOMIC_RELEASE);
+
+	r->block = (r->block + 1) % r->req.tp_block_nr;
+}
+
+void capture_ring_free(struct capture_ring *r)
+{
+	munmap(r->map, (size_t)r->req.tp_block_size * r->req.tp_block_nr);
+	memset(r, 0, sizeof(*r));
+}
+
+
 struct ringbuf * ringbuf_init(uint32_t num_item, uint16_t len_item)
 {
 	static struct ringbuf r;
@@ -271,8 +460,13 @@ void msg(const char *fmt, ...)
 int main(int argc, char **argv)
 {
 	int i, n;
-	struct ringbuf *ring;
+	struct ringbuf *ring = NULL;
 	struct ringbuf_entry *e;
+	struct capture_ring cring = { 0 };
+	struct tpacket_block_desc *bd;
+	struct tpacket3_hdr *th;
+	struct pollfd pfd;
+	static struct stream_buf stream;
 	struct sockaddr_ll local = {
 		.sll_family   = AF_PACKET,
 		.sll_protocol = htons(ETH_P_ALL)
@@ -282,7 +476,9 @@ int main(int argc, char **argv)
 
 	uint8_t frametype;
 	uint8_t pktbuf[0xFFFF];
-	ssize_t pktlen;
+	uint8_t *pkt = pktbuf;
+	ssize_t pktlen = 0;
+	uint32_t pktolen = 0, npkts, sec, usec;
 
 	FILE *o;
 
@@ -426,6 +622,15 @@ int main(int argc, char **argv)
 		return 6;
 	}
 
+	/* prefer a mapped ring, fall back to recvfrom() if it is unsupported */
+	if (capture_ring_init(&cring))
+		msg("Unable to set up capture ring: %s\n", strerror(errno));
+
+	/* truncate in the kernel only if the original length is still known */
+	if (set_filter(filter_beacon, filter_data,
+				   (cring.map && !streaming) ? pktcap : 0xFFFF))
+		msg("Unable to attach capture filter: %s\n", strerror(errno));
+
 	if (bind(capture_sock, (struct sockaddr *)&local, sizeof(local)) == -1)
 	{
 		msg("Unable to bind to interface: %s\n",
@@ -482,6 +687,11 @@ int main(int argc, char **argv)
 	msg(" * Beacon frames are %sfiltered\n", filter_beacon ? "" : "not ");
 	msg(" * Data frames are %sfiltered\n", filter_data ? "" : "not ");
 
+	if (cring.map)
+		msg(" * Using %d bytes capture ring with %d blocks\n",
+			cring.req.tp_block_size * cring.req.tp_block_nr,
+			cring.req.tp_block_nr);
+
 	signal(SIGINT, sig_teardown);
 	signal(SIGTERM, sig_teardown);
 
@@ -516,8 +726,11 @@ int main(int argc, char **argv)
 
 				fclose(o);
 
+				update_drops();
+
 				msg(" * %d frames captured\n", frames_captured);
 				msg(" * %d frames filtered\n", frames_filtered);
+				msg(" * %d frames dropped\n", frames_dropped);
 				msg(" * %d frames dumped\n", n);
 			}
 
@@ -533,50 +746,112 @@ int main(int argc, char **argv)
 			if (ring)
 				ringbuf_free(ring);
 
+			if (cring.map)
+				capture_ring_free(&cring);
+
 			return 0;
 		}
 
-		pktlen = recvfrom(capture_sock, pktbuf, sizeof(pktbuf), 0, NULL, 0);
-		frames_captured++;
+		bd = NULL;
+		th = NULL;
 
-		/* check received frametype, if we should filter it, rewind the ring */
-		rhdr = (radiotap_hdr_t *)pktbuf;
-
-		if (pktlen <= sizeof(radiotap_hdr_t) || le16(rhdr->it_len) >= pktlen)
+		if (cring.map)
 		{
-			frames_filtered++;
-			continue;
-		}
+			/* wait for the kernel to retire a block, signals interrupt
+			 * poll() so pending dumps are handled without delay */
+			if (!(bd = capture_ring_get(&cring)))
+			{
+				pfd.fd = capture_sock;
+				pfd.events = POLLIN | POLLERR;
+				pfd.revents = 0;
 
-		frametype = *(uint8_t *)(pktbuf + le16(rhdr->it_len));
+				poll(&pfd, 1, -1);
+				continue;
+			}
 
-		if ((filter_data   && (frametype & FRAMETYPE_MASK) == FRAMETYPE_DATA) ||
-		    (filter_beacon && (frametype & FRAMETYPE_MASK) == FRAMETYPE_BEACON))
+			th = (struct tpacket3_hdr *)
+				((uint8_t *)bd + bd->hdr.bh1.offset_to_first_pkt);
+			npkts = bd->hdr.bh1.num_pkts;
+		}
+		else
 		{
-			frames_filtered++;
-			continue;
+			pktlen = recvfrom(capture_sock, pktbuf, sizeof(pktbuf), 0, NULL, 0);
+			pktolen = pktlen;
+			pkt = pktbuf;
+			npkts = 1;
 		}
 
-		if (streaming)
+		for (i = 0; i < npkts; i++)
 		{
-			if (!header_written)
+			if (th)
 			{
-				write_pcap_header(stdout);
-				header_written = 1;
+				pkt     = (uint8_t *)th + th->tp_mac;
+				pktlen  = th->tp_snaplen;
+				pktolen = th->tp_len;
+				sec     = th->tp_sec;
+				usec    = th->tp_nsec / 1000;
+
+				th = (struct tpacket3_hdr *)((uint8_t *)th + th->tp_next_offset);
 			}
 
-			write_pcap_frame(stdout, NULL, NULL, pktlen, pktlen);
-			fwrite(pktbuf, 1, pktlen, stdout);
-			fflush(stdout);
-		}
-		else
-		{
-			e = ringbuf_add(ring);
-			e->olen = pktlen;
-			e->len = (pktlen > pktcap) ? pktcap : pktlen;
+			frames_captured++;
+
+			/* check received frametype, if we should filter it, skip it */
+			rhdr = (radiotap_hdr_t *)pkt;
+
+			if (pktlen <= sizeof(radiotap_hdr_t) || le16(rhdr->it_len) >= pktlen)
+			{
+				frames_filtered++;
+				continue;
+			}
+
+			frametype = *(uint8_t *)(pkt + le16(rhdr->it_len));
+
+			if ((filter_data   && (frametype & FRAMETYPE_MASK) == FRAMETYPE_DATA) ||
+			    (filter_beacon && (frametype & FRAMETYPE_MASK) == FRAMETYPE_BEACON))
+			{
+				frames_filtered++;
+				continue;
+			}
+
+			if (streaming)
+			{
+				if (!header_written)
+				{
+					write_pcap_header(stdout);
+					fflush(stdout);
+					header_written = 1;
+				}
+
+				if (stream.num == STREAM_BATCH)
+					stream_flush(&stream);
+
+				stream_add(&stream, pkt, th ? &sec : NULL, th ? &usec : NULL,
+						   pktlen, pktolen);
+			}
+			else
+			{
+				e = ringbuf_add(ring);
+				e->olen = pktolen;
+				e->len = (pktlen > pktcap) ? pktcap : pktlen;
 
-			memcpy((void *)e + sizeof(*e), pktbuf, e->len);
+				if (th)
+				{
+					e->sec  = sec;
+					e->usec = usec;
+				}
+
+				memcpy((void *)e + sizeof(*e), pkt, e->len);
+			}
 		}
+
+		/* payloads are referenced in place, write them before the block
+		 * is handed back to the kernel */
+		if (streaming)
+			stream_flush(&stream);
+
+		if (bd)
+			capture_ring_put(&cring, bd);
 	}
 
 	return 0;
@@ -15,8 +15,20 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <signal.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/wait.h>
 
 
+struct query {
+	const char *name;
+	pid_t pid;
+	int fd;
+	char buf[1024];
+	size_t len;
+	int status;
+};
+
 static void abort_query(int sig)
 {
 	exit(1);
@@ -26,19 +38,169 @@ static void show_usage(void)
 {
 	printf("Usage:\n");
 	printf("	resolveip -h\n");
-	printf("	resolveip [-t timeout] hostname\n");
-	printf("	resolveip -4 [-t timeout] hostname\n");
-	printf("	resolveip -6 [-t timeout] hostname\n");
+	printf("	resolveip [-t timeout] hostname [hostname...]\n");
+	printf("	resolveip -4 [-t timeout] hostname [hostname...]\n");
+	printf("	resolveip -6 [-t timeout] hostname [hostname...]\n");
+	printf("\nWith several host names, they are resolved in parallel within the\n");
+	printf("timeout and every address is printed after its host name.\n");
 	exit(255);
 }
 
+static int print_addrs(FILE *out, const char *name, struct addrinfo *hints)
+{
+	char ipaddr[INET6_ADDRSTRLEN];
+	struct addrinfo *res, *rp;
+	void *addr;
+
+	if (getaddrinfo(name, NULL, hints, &res))
+		return 2;
+
+	for (rp = res; rp != NULL; rp = rp->ai_next)
+	{
+		addr = (rp->ai_family == AF_INET)
+			? (void *)&((struct sockaddr_in *)rp->ai_addr)->sin_addr
+			: (void *)&((struct sockaddr_in6 *)rp->ai_addr)->sin6_addr
+		;
+
+		if (!inet_ntop(rp->ai_family, addr, ipaddr, INET6_ADDRSTRLEN - 1))
+			return 3;
+
+		fprintf(out, "%s\n", ipaddr);
+	}
+
+	freeaddrinfo(res);
+	return 0;
+}
+
+static int query_start(struct query *q, struct addrinfo *hints)
+{
+	int fds[2];
+	FILE *out;
+
+	if (pipe(fds))
+		return -1;
+
+	q->pid = fork();
+	if (q->pid < 0) {
+		close(fds[0]);
+		close(fds[1]);
+		return -1;
+	}
+
+	if (!q->pid) {
+		close(fds[0]);
+		out = fdopen(fds[1], "w");
+		_exit(out ? print_addrs(out, q->name, hints) | (fclose(out) ? 3 : 0) : 3);
+	}
+
+	close(fds[1]);
+	q->fd = fds[0];
+	return 0;
+}
+
+static long deadline_left(struct timespec *deadline)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (deadline->tv_sec - now.tv_sec) * 1000 +
+		(deadline->tv_nsec - now.tv_nsec) / 1000000;
+}
+
+/*
+ * Every name is resolved in a process of its own, the libc resolver
+ * already asks for A and AAAA in parallel. Names that are not resolved
+ * once the timeout is over count as timed out.
+ */
+static int resolve_batch(char **names, int n, struct addrinfo *hints, int timeout)
+{
+	struct query *queries = calloc(n, sizeof(*queries));
+	struct pollfd *pfds = calloc(n, sizeof(*pfds));
+	struct timespec deadline;
+	int i, pending = 0, ret = 0;
+	char *line, *end;
+	ssize_t len;
+	long left;
+
+	if (!queries || !pfds)
+		exit(3);
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_sec += timeout;
+
+	for (i = 0; i < n; i++) {
+		queries[i].name = names[i];
+		queries[i].fd = -1;
+		queries[i].status = 1;
+		if (query_start(&queries[i], hints))
+			queries[i].status = 3;
+		else
+			pending++;
+	}
+
+	while (pending > 0 && (left = deadline_left(&deadline)) > 0) {
+		for (i = 0; i < n; i++) {
+			pfds[i].fd = queries[i].fd;
+			pfds[i].events = POLLIN;
+		}
+
+		if (poll(pfds, n, left) < 0)
+			break;
+
+		for (i = 0; i < n; i++) {
+			struct query *q = &queries[i];
+
+			if (q->fd < 0 || !pfds[i].revents)
+				continue;
+
+			len = read(q->fd, q->buf + q->len, sizeof(q->buf) - 1 - q->len);
+			if (len > 0) {
+				q->len += len;
+				if (q->len < sizeof(q->buf) - 1)
+					continue;
+			}
+
+			close(q->fd);
+			q->fd = -1;
+			pending--;
+
+			if (waitpid(q->pid, &q->status, 0) == q->pid && WIFEXITED(q->status))
+				q->status = WEXITSTATUS(q->status);
+			else
+				q->status = 3;
+			q->pid = 0;
+		}
+	}
+
+	for (i = 0; i < n; i++) {
+		struct query *q = &queries[i];
+
+		if (q->pid > 0) {
+			kill(q->pid, SIGKILL);
+			waitpid(q->pid, NULL, 0);
+			close(q->fd);
+			q->len = 0;
+		}
+
+		q->buf[q->len] = 0;
+		for (line = q->buf; (end = strchr(line, '\n')) != NULL; line = end + 1) {
+			*end = 0;
+			printf("%s %s\n", q->name, line);
+		}
+
+		if (q->status > ret)
+			ret = q->status;
+	}
+
+	free(queries);
+	free(pfds);
+	return ret;
+}
+
 int main(int argc, char **argv)
 {
 	int timeout = 3;
 	int opt;
-	char ipaddr[INET6_ADDRSTRLEN];
-	void *addr;
-	struct addrinfo *res, *rp;
 	struct sigaction sa = {	.sa_handler = &abort_query };
 	struct addrinfo hints = {
 		.ai_family   = AF_UNSPEC,
@@ -74,25 +236,11 @@ int main(int argc, char **argv)
 	if (!argv[optind])
 		show_usage();
 
+	if (argv[optind + 1])
+		exit(resolve_batch(&argv[optind], argc - optind, &hints, timeout));
+
 	sigaction(SIGALRM, &sa, NULL);
 	alarm(timeout);
 
-	if (getaddrinfo(argv[optind], NULL, &hints, &res))
-		exit(2);
-
-	for (rp = res; rp != NULL; rp = rp->ai_next)
-	{
-		addr = (rp->ai_family == AF_INET)
-			? (void *)&((struct sockaddr_in *)rp->ai_addr)->sin_addr
-			: (void *)&((struct sockaddr_in6 *)rp->ai_addr)->sin6_addr
-		;
-
-		if (!inet_ntop(rp->ai_family, addr, ipaddr, INET6_ADDRSTRLEN - 1))
-			exit(3);
-
-		printf("%s\n", ipaddr);
-	}
-
-	freeaddrinfo(res);
-	exit(0);
+	exit(print_addrs(stdout, argv[optind], &hints));
 }
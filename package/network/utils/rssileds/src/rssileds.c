@@ -26,11 +26,20 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <signal.h>
 #include <unistd.h>
 #include <syslog.h>
+#include <net/if.h>
+
+#include <libubox/uloop.h>
+#include <netlink/netlink.h>
+#include <netlink/genl/genl.h>
+#include <netlink/genl/ctrl.h>
+#include <linux/nl80211.h>
 
 #include "iwinfo.h"
 
@@ -38,6 +47,12 @@
 #define LEDS_BASEPATH		"/sys/class/leds/"
 #define BACKEND_RETRY_DELAY	500000
 
+/* the nl80211 iwinfo backend reports quality as dBm + 110 */
+#define NL80211_QUAL_OFFSET	110
+/* CQM threshold spacing within the range of dimmable LEDs, in percent */
+#define EVENT_BRIGHTNESS_STEP	10
+#define MAX_THRESHOLDS		64
+
 char *ifname;
 int qual_max;
 
@@ -45,6 +60,7 @@ struct led {
 	char *sysfspath;
 	FILE *controlfd;
 	unsigned char state;
+	unsigned char max_brightness;
 };
 
 typedef struct rule rule_t;
@@ -54,9 +70,20 @@ struct rule {
 	int maxq;
 	int boffset;
 	int bfactor;
+	int active;
 	rule_t *next;
 };
 
+static const struct iwinfo_ops *iw;
+static rule_t *headrule;
+static int refresh, hysteresis, q0 = -1;
+
+static struct nl_sock *nl_cmd, *nl_event;
+static int nl80211_id, ifindex;
+static struct nl_cb *event_cb;
+static struct uloop_fd event_fd;
+static struct uloop_timeout poll_timer;
+
 void log_rules(rule_t *rules)
 {
 	rule_t *rule = rules;
@@ -96,6 +123,25 @@ int set_led(struct led *led, unsigned char value)
 	return 0;
 }
 
+static unsigned char read_max_brightness(const char *ledname)
+{
+	char path[256];
+	FILE *fp;
+	int max = 255;
+
+	snprintf(path, sizeof(path), "%s%s/max_brightness", LEDS_BASEPATH, ledname);
+	fp = fopen(path, "r");
+	if ( ! fp )
+		return 255;
+
+	if ( fscanf(fp, "%d", &max) != 1 || max < 1 || max > 255 )
+		max = 255;
+
+	fclose(fp);
+
+	return max;
+}
+
 int init_led(struct led **led, char *ledname)
 {
 	struct led *newled;
@@ -128,6 +174,7 @@ int init_led(struct led **led, char *ledname)
 
 	newled->sysfspath = bp;
 	newled->controlfd = bfp;
+	newled->max_brightness = read_max_brightness(ledname);
 
 	*led = newled;
 
@@ -194,10 +241,19 @@ void update_leds(rule_t *rules, int q)
 		b = ( q + rule->boffset ) * rule->bfactor;
 		if ( b < 0 )
 			b=0;
-		if ( b > 255 )
-			b=255;
+		if ( b > rule->led->max_brightness )
+			b=rule->led->max_brightness;
+
+		/* once on, a rule only turns off beyond the threshold */
+		if ( q < 0 )
+			rule->active = 0;
+		else if ( rule->active )
+			rule->active = q >= rule->minq - hysteresis &&
+				       q <= rule->maxq + hysteresis;
+		else
+			rule->active = q >= rule->minq && q <= rule->maxq;
 
-		if ( q >= rule->minq && q <= rule->maxq )
+		if ( rule->active )
 			set_led(rule->led, (unsigned char)b);
 		else
 			set_led(rule->led, 0);
@@ -206,31 +262,372 @@ void update_leds(rule_t *rules, int q)
 	}
 }
 
+static void poll_cb(struct uloop_timeout *t)
+{
+	int q;
+
+	q = quality(iw, ifname);
+	if ( q < q0 - hysteresis || q > q0 + hysteresis ) {
+		update_leds(headrule, q);
+		q0=q;
+	};
+	// re-open backend...
+	if ( q == -1 && q0 == -1 ) {
+		if (iw) {
+			iwinfo_finish();
+			iw=NULL;
+		} else if (!open_backend(&iw, ifname)) {
+			uloop_timeout_set(t, refresh / 1000);
+			return;
+		}
+		uloop_timeout_set(t, BACKEND_RETRY_DELAY / 1000);
+		return;
+	}
+	uloop_timeout_set(t, refresh / 1000);
+}
+
+static void start_polling(void)
+{
+	syslog(LOG_INFO, "polling %s every %d us\n", ifname, refresh);
+	if (event_fd.registered)
+		uloop_fd_delete(&event_fd);
+	poll_timer.cb = poll_cb;
+	uloop_timeout_set(&poll_timer, 0);
+}
+
+static int no_seq_check(struct nl_msg *msg, void *arg)
+{
+	return NL_OK;
+}
+
+static int ack_handler(struct nl_msg *msg, void *arg)
+{
+	int *ret = arg;
+
+	*ret = 0;
+	return NL_STOP;
+}
+
+static int error_handler(struct sockaddr_nl *nla, struct nlmsgerr *err,
+			 void *arg)
+{
+	int *ret = arg;
+
+	*ret = err->error;
+	return NL_STOP;
+}
+
+static int nl_call(struct nl_msg *msg, int (*handler)(struct nl_msg *, void *),
+		   void *arg)
+{
+	struct nl_cb *cb;
+	int ret = -ENOMEM;
+
+	cb = nl_cb_alloc(NL_CB_DEFAULT);
+	if (!cb)
+		goto out;
+
+	ret = nl_send_auto_complete(nl_cmd, msg);
+	if (ret < 0)
+		goto free_cb;
+
+	ret = 1;
+	nl_cb_err(cb, NL_CB_CUSTOM, error_handler, &ret);
+	nl_cb_set(cb, NL_CB_FINISH, NL_CB_CUSTOM, ack_handler, &ret);
+	nl_cb_set(cb, NL_CB_ACK, NL_CB_CUSTOM, ack_handler, &ret);
+	if (handler)
+		nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM, handler, arg);
+
+	while (ret > 0)
+		nl_recvmsgs(nl_cmd, cb);
+
+free_cb:
+	nl_cb_put(cb);
+out:
+	nlmsg_free(msg);
+	return ret;
+}
+
+struct mcast_group {
+	const char *name;
+	int id;
+};
+
+static int family_handler(struct nl_msg *msg, void *arg)
+{
+	struct genlmsghdr *gnlh = nlmsg_data(nlmsg_hdr(msg));
+	struct nlattr *tb[CTRL_ATTR_MAX + 1], *mcgrp;
+	struct mcast_group *grp;
+	int rem;
+
+	nla_parse(tb, CTRL_ATTR_MAX, genlmsg_attrdata(gnlh, 0),
+		  genlmsg_attrlen(gnlh, 0), NULL);
+
+	if (!tb[CTRL_ATTR_MCAST_GROUPS])
+		return NL_SKIP;
+
+	nla_for_each_nested(mcgrp, tb[CTRL_ATTR_MCAST_GROUPS], rem) {
+		struct nlattr *tb_grp[CTRL_ATTR_MCAST_GRP_MAX + 1];
+
+		nla_parse(tb_grp, CTRL_ATTR_MCAST_GRP_MAX, nla_data(mcgrp),
+			  nla_len(mcgrp), NULL);
+
+		if (!tb_grp[CTRL_ATTR_MCAST_GRP_NAME] ||
+		    !tb_grp[CTRL_ATTR_MCAST_GRP_ID])
+			continue;
+
+		for (grp = arg; grp->name; grp++)
+			if (!strcmp(nla_get_string(tb_grp[CTRL_ATTR_MCAST_GRP_NAME]), grp->name))
+				grp->id = nla_get_u32(tb_grp[CTRL_ATTR_MCAST_GRP_ID]);
+	}
+
+	return NL_SKIP;
+}
+
+static int cmp_int(const void *a, const void *b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+/*
+ * Let the kernel report when the signal crosses the boundaries of a rule,
+ * or a brightness step of a dimmable LED, instead of polling for it.
+ */
+static int set_cqm_thresholds(void)
+{
+	int32_t thold[MAX_THRESHOLDS];
+	int q[MAX_THRESHOLDS];
+	struct nlattr *cqm;
+	struct nl_msg *msg;
+	rule_t *rule;
+	int i, n = 0, nq = 0;
+
+	if (!iw || strcmp(iw->name, "nl80211") || qual_max < 1)
+		return -EOPNOTSUPP;
+
+	for (rule = headrule; rule; rule = rule->next) {
+		if (nq < MAX_THRESHOLDS)
+			q[nq++] = rule->minq;
+		if (nq < MAX_THRESHOLDS)
+			q[nq++] = rule->maxq + 1;
+
+		if (rule->led->max_brightness <= 1 || !rule->bfactor)
+			continue;
+
+		for (i = rule->minq + EVENT_BRIGHTNESS_STEP;
+		     i <= rule->maxq && nq < MAX_THRESHOLDS;
+		     i += EVENT_BRIGHTNESS_STEP)
+			q[nq++] = i;
+	}
+
+	qsort(q, nq, sizeof(*q), cmp_int);
+	for (i = 0; i < nq; i++) {
+		int32_t dbm;
+
+		if (q[i] <= 0 || q[i] > 100)
+			continue;
+
+		/* lowest signal at which quality() returns at least q[i] */
+		dbm = (q[i] * qual_max + 99) / 100 - NL80211_QUAL_OFFSET;
+		if (n && thold[n - 1] >= dbm)
+			continue;
+
+		thold[n++] = dbm;
+	}
+
+	if (!n)
+		return -EINVAL;
+
+	msg = nlmsg_alloc();
+	if (!msg)
+		return -ENOMEM;
+
+	genlmsg_put(msg, 0, 0, nl80211_id, 0, 0, NL80211_CMD_SET_CQM, 0);
+	NLA_PUT_U32(msg, NL80211_ATTR_IFINDEX, ifindex);
+
+	cqm = nla_nest_start(msg, NL80211_ATTR_CQM);
+	if (!cqm)
+		goto nla_put_failure;
+
+	NLA_PUT(msg, NL80211_ATTR_CQM_RSSI_THOLD, n * sizeof(*thold), thold);
+	NLA_PUT_U32(msg, NL80211_ATTR_CQM_RSSI_HYST, hysteresis * qual_max / 100);
+	nla_nest_end(msg, cqm);
+
+	return nl_call(msg, NULL, NULL);
+
+nla_put_failure:
+	nlmsg_free(msg);
+	return -ENOMEM;
+}
+
+static void event_update(int rearm)
+{
+	int q = -1;
+
+	if (ifindex && (iw || !open_backend(&iw, ifname)))
+		q = quality(iw, ifname);
+
+	update_leds(headrule, q);
+
+	if (!rearm || !ifindex)
+		return;
+
+	if (set_cqm_thresholds()) {
+		syslog(LOG_WARNING, "can't set signal thresholds on %s\n", ifname);
+		start_polling();
+	}
+}
+
+static int event_handler(struct nl_msg *msg, void *arg)
+{
+	struct genlmsghdr *gnlh = nlmsg_data(nlmsg_hdr(msg));
+	struct nlattr *tb[NL80211_ATTR_MAX + 1];
+	int idx;
+
+	nla_parse(tb, NL80211_ATTR_MAX, genlmsg_attrdata(gnlh, 0),
+		  genlmsg_attrlen(gnlh, 0), NULL);
+
+	if (!tb[NL80211_ATTR_IFINDEX])
+		return NL_SKIP;
+
+	idx = nla_get_u32(tb[NL80211_ATTR_IFINDEX]);
+
+	switch (gnlh->cmd) {
+	case NL80211_CMD_NEW_INTERFACE:
+		if (!tb[NL80211_ATTR_IFNAME] ||
+		    strcmp(nla_get_string(tb[NL80211_ATTR_IFNAME]), ifname))
+			break;
+
+		ifindex = idx;
+		event_update(1);
+		break;
+	case NL80211_CMD_DEL_INTERFACE:
+		if (idx != ifindex)
+			break;
+
+		ifindex = 0;
+		event_update(0);
+		break;
+	case NL80211_CMD_CONNECT:
+		if (idx == ifindex)
+			event_update(1);
+		break;
+	case NL80211_CMD_DISCONNECT:
+	case NL80211_CMD_NOTIFY_CQM:
+		if (idx == ifindex)
+			event_update(0);
+		break;
+	}
+
+	return NL_SKIP;
+}
+
+static void event_fd_cb(struct uloop_fd *fd, unsigned int events)
+{
+	nl_recvmsgs(nl_event, event_cb);
+}
+
+static int init_events(void)
+{
+	struct mcast_group groups[] = {
+		{ "config", -ENOENT },
+		{ "mlme", -ENOENT },
+		{}
+	};
+	struct nl_msg *msg;
+	int i;
+
+	nl_cmd = nl_socket_alloc();
+	nl_event = nl_socket_alloc();
+	event_cb = nl_cb_alloc(NL_CB_DEFAULT);
+	if (!nl_cmd || !nl_event || !event_cb)
+		return -ENOMEM;
+
+	if (genl_connect(nl_cmd) || genl_connect(nl_event))
+		return -ENOLINK;
+
+	nl80211_id = genl_ctrl_resolve(nl_cmd, "nl80211");
+	if (nl80211_id < 0)
+		return nl80211_id;
+
+	msg = nlmsg_alloc();
+	if (!msg)
+		return -ENOMEM;
+
+	genlmsg_put(msg, 0, 0, GENL_ID_CTRL, 0, 0, CTRL_CMD_GETFAMILY, 0);
+	NLA_PUT_STRING(msg, CTRL_ATTR_FAMILY_NAME, "nl80211");
+	if (nl_call(msg, family_handler, groups))
+		return -ENOENT;
+
+	for (i = 0; groups[i].name; i++)
+		if (groups[i].id < 0 ||
+		    nl_socket_add_membership(nl_event, groups[i].id))
+			return -ENOENT;
+
+	nl_cb_set(event_cb, NL_CB_SEQ_CHECK, NL_CB_CUSTOM, no_seq_check, NULL);
+	nl_cb_set(event_cb, NL_CB_VALID, NL_CB_CUSTOM, event_handler, NULL);
+	nl_socket_set_nonblocking(nl_event);
+
+	event_fd.fd = nl_socket_get_fd(nl_event);
+	event_fd.cb = event_fd_cb;
+	uloop_fd_add(&event_fd, ULOOP_READ);
+
+	syslog(LOG_INFO, "waiting for signal events on %s\n", ifname);
+
+	ifindex = if_nametoindex(ifname);
+	event_update(1);
+
+	return 0;
+
+nla_put_failure:
+	nlmsg_free(msg);
+	return -ENOMEM;
+}
+
+static void usage(const char *prog)
+{
+	printf("syntax: %s [-e] (ifname) (refresh) (threshold) (rule) [rule] ...\n", prog);
+	printf("  -e: update on nl80211 signal events instead of every (refresh) us\n");
+	printf("  rule: (sysfs-name) (minq) (maxq) (offset) (factore)\n");
+}
+
 int main(int argc, char **argv)
 {
-	int i,q,q0,r,s;
-	const struct iwinfo_ops *iw = NULL;
-	rule_t *headrule = NULL, *currentrule = NULL;
+	int i, ch, events = 0;
+	rule_t *currentrule = NULL;
+	char *prog = argv[0];
+
+	while ((ch = getopt(argc, argv, "e")) != -1) {
+		switch (ch) {
+		case 'e':
+			events = 1;
+			break;
+		default:
+			usage(prog);
+			return 1;
+		}
+	}
+	argc -= optind - 1;
+	argv += optind - 1;
 
 	if (argc < 9 || ( (argc-4) % 5 != 0 ) )
 	{
-		printf("syntax: %s (ifname) (refresh) (threshold) (rule) [rule] ...\n", argv[0]);
-		printf("  rule: (sysfs-name) (minq) (maxq) (offset) (factore)\n");
+		usage(prog);
 		return 1;
 	}
 
 	ifname = argv[1];
 
 	/* refresh interval */
-	if ( sscanf(argv[2], "%d", &r) != 1 )
+	if ( sscanf(argv[2], "%d", &refresh) != 1 )
 		return 1;
 
 	/* sustain threshold */
-	if ( sscanf(argv[3], "%d", &s) != 1 )
+	if ( sscanf(argv[3], "%d", &hysteresis) != 1 )
 		return 1;
 
 	openlog("rssileds", LOG_PID, LOG_DAEMON);
-	syslog(LOG_INFO, "monitoring %s, refresh rate %d, threshold %d\n", ifname, r, s);
+	syslog(LOG_INFO, "monitoring %s, refresh rate %d, threshold %d\n", ifname, refresh, hysteresis);
 
 	currentrule = headrule;
 	for (i=4; i<argc; i=i+5) {
@@ -264,25 +661,13 @@ int main(int argc, char **argv)
 	}
 	log_rules(headrule);
 
-	q0 = -1;
-	do {
-		q = quality(iw, ifname);
-		if ( q < q0 - s || q > q0 + s ) {
-			update_leds(headrule, q);
-			q0=q;
-		};
-		// re-open backend...
-		if ( q == -1 && q0 == -1 ) {
-			if (iw) {
-				iwinfo_finish();
-				iw=NULL;
-				usleep(BACKEND_RETRY_DELAY);
-			}
-			while (open_backend(&iw, ifname))
-				usleep(BACKEND_RETRY_DELAY);
-		}
-		usleep(r);
-	} while(1);
+	uloop_init();
+
+	if ( ! events || init_events() )
+		start_polling();
+
+	uloop_run();
+	uloop_done();
 
 	iwinfo_finish();
 
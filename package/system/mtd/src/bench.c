@@ -0,0 +1,227 @@
+/*
+ * bench.c
+ *
+ * Measure the erase, write and read speed of an mtd partition
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Every good erase block of the partition is erased, written with a
+ * pattern and read back, one pass over the whole partition after the other,
+ * through the same routines that mtd write uses. Each pass reports the
+ * throughput over the partition and the latency of the single blocks.
+ * The data on the partition is lost, it is left erased.
+ */
+
+#include <sys/ioctl.h>
+#include <sys/types.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <mtd/mtd-user.h>
+
+#include "mtd.h"
+
+enum {
+	BENCH_ERASE,
+	BENCH_WRITE,
+	BENCH_READ,
+	__BENCH_MAX
+};
+
+static const char * const bench_names[__BENCH_MAX] = {
+	[BENCH_ERASE] = "erase",
+	[BENCH_WRITE] = "write",
+	[BENCH_READ] = "read",
+};
+
+static double
+bench_time(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int
+bench_cmp(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+/* nearest rank of a sorted list */
+static double
+bench_percentile(const double *lat, int n, int pct)
+{
+	int i = (n * pct + 99) / 100;
+
+	return lat[i ? i - 1 : 0];
+}
+
+static int
+bench_read_buffer(int fd, char *buf, int offset, int length)
+{
+	int r;
+
+	while (length > 0) {
+		r = pread(fd, buf, length, offset);
+		if (r < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (!r)
+			return -1;
+
+		buf += r;
+		offset += r;
+		length -= r;
+	}
+
+	return 0;
+}
+
+static void
+bench_report(int pass, double *lat, int n, double total)
+{
+	double mb = (double)n * erasesize / (1024 * 1024);
+
+	qsort(lat, n, sizeof(*lat), bench_cmp);
+	printf("%-6s %8.2f MB/s  block ms: p50 %.2f  p90 %.2f  p99 %.2f  max %.2f\n",
+	       bench_names[pass], total > 0 ? mb / total : 0,
+	       bench_percentile(lat, n, 50) * 1e3,
+	       bench_percentile(lat, n, 90) * 1e3,
+	       bench_percentile(lat, n, 99) * 1e3,
+	       lat[n - 1] * 1e3);
+}
+
+int
+mtd_bench(const char *mtd)
+{
+	struct mtd_ecc_stats ecc_start, ecc_end;
+	double *lat[__BENCH_MAX] = {}, total, t;
+	char *pattern = NULL, *buf = NULL;
+	int *blocks = NULL, nblocks = 0;
+	int fd, pass, i, has_ecc;
+	int errors = 0, mismatch = 0, ret = -1;
+
+	fd = mtd_check_open(mtd);
+	if (fd < 0)
+		return -1;
+
+	if (!erasesize || mtdsize < erasesize) {
+		fprintf(stderr, "Invalid erase block size on %s\n", mtd);
+		goto out;
+	}
+
+	blocks = malloc((mtdsize / erasesize) * sizeof(*blocks));
+	pattern = malloc(erasesize);
+	buf = malloc(erasesize);
+	for (pass = 0; pass < __BENCH_MAX; pass++)
+		lat[pass] = malloc((mtdsize / erasesize) * sizeof(**lat));
+	if (!blocks || !pattern || !buf ||
+	    !lat[BENCH_ERASE] || !lat[BENCH_WRITE] || !lat[BENCH_READ]) {
+		fprintf(stderr, "Out of memory!\n");
+		goto out;
+	}
+
+	for (i = 0; i + erasesize <= mtdsize; i += erasesize) {
+		if (mtd_block_is_bad(fd, i)) {
+			if (quiet < 2)
+				fprintf(stderr, "Skipping bad block at 0x%08x\n", i);
+			continue;
+		}
+		blocks[nblocks++] = i;
+	}
+	if (!nblocks) {
+		fprintf(stderr, "No good blocks on %s\n", mtd);
+		goto out;
+	}
+
+	/* each block starts with its own offset, so misplaced writes show up */
+	for (i = 0; i < erasesize; i++)
+		pattern[i] = (i * 2654435761U) >> 24;
+
+	has_ecc = !ioctl(fd, ECCGETSTATS, &ecc_start);
+
+	if (quiet < 2)
+		fprintf(stderr, "Benchmarking %s, %d blocks of %d KiB ...\n",
+			mtd, nblocks, erasesize / 1024);
+
+	for (pass = 0; pass < __BENCH_MAX; pass++) {
+		for (i = 0; i < nblocks; i++) {
+			int ofs = blocks[i];
+
+			*(uint32_t *)pattern = ofs;
+
+			t = bench_time();
+			switch (pass) {
+			case BENCH_ERASE:
+				if (mtd_erase_block(fd, ofs) < 0) {
+					fprintf(stderr, "Failed to erase block at 0x%08x\n", ofs);
+					errors++;
+				}
+				break;
+			case BENCH_WRITE:
+				mtd_write_buffer(fd, pattern, ofs, erasesize);
+				break;
+			case BENCH_READ:
+				if (bench_read_buffer(fd, buf, ofs, erasesize) < 0) {
+					fprintf(stderr, "Failed to read block at 0x%08x\n", ofs);
+					errors++;
+				}
+				break;
+			}
+			lat[pass][i] = bench_time() - t;
+
+			if (pass == BENCH_READ && memcmp(buf, pattern, erasesize))
+				mismatch++;
+		}
+	}
+
+	if (has_ecc && ioctl(fd, ECCGETSTATS, &ecc_end))
+		has_ecc = 0;
+
+	for (i = 0; i < nblocks; i++)
+		mtd_erase_block(fd, blocks[i]);
+
+	for (pass = 0; pass < __BENCH_MAX; pass++) {
+		total = 0;
+		for (i = 0; i < nblocks; i++)
+			total += lat[pass][i];
+		bench_report(pass, lat[pass], nblocks, total);
+	}
+
+	printf("%d blocks, %d errors, %d blocks read back wrong\n",
+	       nblocks, errors, mismatch);
+	if (has_ecc)
+		printf("ecc: %u bitflips corrected, %u uncorrectable\n",
+		       ecc_end.corrected - ecc_start.corrected,
+		       ecc_end.failed - ecc_start.failed);
+
+	ret = errors || mismatch ? -1 : 0;
+
+out:
+	for (pass = 0; pass < __BENCH_MAX; pass++)
+		free(lat[pass]);
+	free(blocks);
+	free(pattern);
+	free(buf);
+	close(fd);
+	return ret;
+}
@@ -0,0 +1,255 @@
+/*
+ * delta.c
+ *
+ * Apply a block delta to an mtd partition in place
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * Delta format, all fields are big endian:
+ *
+ *   header:  "MTDD", u32 erasesize, u32 number of blocks in the new image,
+ *            u32 number of blocks in the old image, md5 of the old image,
+ *            md5 of the new image
+ *   record:  u32 dst, u32 src, u32 difflen, followed by erasesize bytes:
+ *            difflen bytes that are added to the start of old block src
+ *            (bsdiff style), the rest is copied literally
+ *   end:     u32 0xffffffff
+ *
+ * Blocks without a record keep their contents. Records are sorted by dst
+ * and may only use a src >= dst (or 0xffffffff with difflen 0 for literal
+ * blocks), so every old block is still intact when it is read.
+ *
+ * The old image is checked against its md5 before the first block is
+ * erased, and the new image is read back and checked against its md5
+ * once all records are written. Source blocks must lie inside the old
+ * image, so a delta for a different base is never applied.
+ */
+
+#include <sys/types.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <libubox/md5.h>
+
+#include "mtd.h"
+
+#define DELTA_MAGIC	0x4d544444	/* "MTDD" */
+#define DELTA_END	0xffffffff
+#define DELTA_NO_SRC	0xffffffff
+
+struct delta_hdr {
+	uint32_t magic;
+	uint32_t erasesize;
+	uint32_t blocks;
+	uint32_t base_blocks;
+	uint8_t base_md5[16];
+	uint8_t md5[16];
+};
+
+struct delta_rec {
+	uint32_t src;
+	uint32_t difflen;
+};
+
+static int
+delta_read(int fd, void *data, int len)
+{
+	char *p = data;
+	int r;
+
+	while (len > 0) {
+		r = read(fd, p, len);
+		if (r < 0) {
+			if ((errno == EINTR) || (errno == EAGAIN))
+				continue;
+			return -1;
+		}
+		if (!r)
+			return -1;
+
+		p += r;
+		len -= r;
+	}
+
+	return 0;
+}
+
+static int
+delta_md5(int fd, uint32_t blocks, char *buf, uint8_t *md5)
+{
+	md5_ctx_t ctx;
+	uint32_t i;
+	off_t ofs;
+
+	md5_begin(&ctx);
+	for (i = 0; i < blocks; i++) {
+		ofs = (off_t) i * erasesize;
+		if (mtd_block_is_bad(fd, ofs) ||
+		    pread(fd, buf, erasesize, ofs) != erasesize) {
+			fprintf(stderr, "\nFailed to read block %u\n", i);
+			return -1;
+		}
+		md5_hash(buf, erasesize, &ctx);
+	}
+	md5_end(md5, &ctx);
+
+	return 0;
+}
+
+int
+mtd_patch(int deltafd, const char *mtd)
+{
+	struct delta_hdr hdr;
+	struct delta_rec rec;
+	uint32_t dst, prev = 0, blocks, base_blocks, i;
+	uint8_t md5[16];
+	char *old = NULL, *new = NULL;
+	int fd, n = 0, ret = -1;
+	off_t ofs;
+
+	if (delta_read(deltafd, &hdr, sizeof(hdr)) || ntohl(hdr.magic) != DELTA_MAGIC) {
+		fprintf(stderr, "Not a block delta\n");
+		return -1;
+	}
+
+	fd = mtd_check_open(mtd);
+	if (fd < 0) {
+		fprintf(stderr, "Could not open mtd device: %s\n", mtd);
+		return -1;
+	}
+
+	blocks = ntohl(hdr.blocks);
+	base_blocks = ntohl(hdr.base_blocks);
+	if (ntohl(hdr.erasesize) != erasesize || blocks > mtdsize / erasesize ||
+	    base_blocks > mtdsize / erasesize) {
+		fprintf(stderr, "Delta does not match the layout of %s\n", mtd);
+		goto out;
+	}
+
+	old = malloc(erasesize);
+	new = malloc(erasesize);
+	if (!old || !new) {
+		fprintf(stderr, "Out of memory\n");
+		goto out;
+	}
+
+	if (quiet < 2)
+		fprintf(stderr, "Patching %s ... ", mtd);
+
+	if (delta_md5(fd, base_blocks, old, md5))
+		goto out;
+
+	if (memcmp(md5, hdr.base_md5, sizeof(md5)) != 0) {
+		fprintf(stderr, "\nDelta was made for a different image\n");
+		goto out;
+	}
+
+	if (!quiet)
+		fprintf(stderr, " [ ]");
+
+	for (;;) {
+		if (delta_read(deltafd, &dst, sizeof(dst)))
+			goto truncated;
+
+		dst = ntohl(dst);
+		if (dst == DELTA_END)
+			break;
+
+		if (delta_read(deltafd, &rec, sizeof(rec)))
+			goto truncated;
+
+		rec.src = ntohl(rec.src);
+		rec.difflen = ntohl(rec.difflen);
+
+		if (dst >= blocks || (n && dst <= prev) || rec.difflen > erasesize ||
+		    (rec.src == DELTA_NO_SRC && rec.difflen) ||
+		    (rec.src != DELTA_NO_SRC && (rec.src < dst || rec.src >= base_blocks))) {
+			fprintf(stderr, "\nInvalid delta record for block %u\n", dst);
+			goto out;
+		}
+
+		if (!quiet)
+			fprintf(stderr, "\b\b\b[r]");
+
+		if (rec.src != DELTA_NO_SRC) {
+			ofs = (off_t) rec.src * erasesize;
+			if (mtd_block_is_bad(fd, ofs) ||
+			    pread(fd, old, erasesize, ofs) != erasesize) {
+				fprintf(stderr, "\nFailed to read block %u\n", rec.src);
+				goto out;
+			}
+		}
+
+		if (delta_read(deltafd, new, erasesize))
+			goto truncated;
+
+		for (i = 0; i < rec.difflen; i++)
+			new[i] += old[i];
+
+		ofs = (off_t) dst * erasesize;
+		if (mtd_block_is_bad(fd, ofs)) {
+			fprintf(stderr, "\nBad block %u, a full image is needed\n", dst);
+			goto out;
+		}
+
+		if (!quiet)
+			fprintf(stderr, "\b\b\b[e]");
+
+		if (mtd_erase_block(fd, ofs) < 0) {
+			fprintf(stderr, "\nFailed to erase block %u\n", dst);
+			goto out;
+		}
+
+		if (!quiet)
+			fprintf(stderr, "\b\b\b[w]");
+
+		if (pwrite(fd, new, erasesize, ofs) != erasesize) {
+			fprintf(stderr, "\nFailed to write block %u\n", dst);
+			goto out;
+		}
+
+		prev = dst;
+		n++;
+	}
+
+	if (!quiet)
+		fprintf(stderr, "\b\b\b[v]");
+
+	if (delta_md5(fd, blocks, new, md5))
+		goto out;
+
+	if (memcmp(md5, hdr.md5, sizeof(md5)) != 0) {
+		fprintf(stderr, "\nPatched image does not match the delta\n");
+		goto out;
+	}
+
+	if (!quiet)
+		fprintf(stderr, "\b\b\b\b    ");
+
+	if (quiet < 2)
+		fprintf(stderr, "\n%d of %u blocks patched\n", n, blocks);
+
+	ret = 0;
+	goto out;
+
+truncated:
+	fprintf(stderr, "\nTruncated delta\n");
+out:
+	free(old);
+	free(new);
+	close(fd);
+	return ret;
+}
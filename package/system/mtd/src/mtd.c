@@ -90,6 +90,8 @@ static char *tpl_uboot_args_part;
 static int buflen = 0;
 int quiet;
 int no_erase;
+int skip_unchanged;
+int verify_write;
 int mtdsize = 0;
 int erasesize = 0;
 int jffs2_skip_bytes=0;
@@ -466,6 +468,60 @@ indicate_writing(const char *mtd)
 		fprintf(stderr, " [ ]");
 }
 
+static struct {
+	double read, compare, erase, write, verify;
+	int blocks, unchanged, retried;
+} write_stats;
+
+static double
+time_delta(struct timespec *ts)
+{
+	struct timespec now;
+	double delta;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	delta = (now.tv_sec - ts->tv_sec) + (now.tv_nsec - ts->tv_nsec) / 1e9;
+	*ts = now;
+
+	return delta;
+}
+
+static int
+mtd_block_unchanged(int fd, off_t ofs, const char *data, int len)
+{
+	static char *cmpbuf;
+
+	if (!cmpbuf)
+		cmpbuf = malloc(erasesize);
+
+	if (!cmpbuf || pread(fd, cmpbuf, len, ofs) != len)
+		return 0;
+
+	return !memcmp(cmpbuf, data, len);
+}
+
+/* read back a block that was just written, erase and rewrite it on mismatch */
+static int
+mtd_write_verify(int fd, off_t ofs, const char *data, int len)
+{
+	int retries = 2;
+
+	while (!mtd_block_unchanged(fd, ofs, data, len)) {
+		if (no_erase || !retries-- || ofs % erasesize)
+			return -1;
+
+		if (!quiet)
+			fprintf(stderr, "\nRetrying block at 0x%08llx   ", (unsigned long long) ofs);
+
+		write_stats.retried++;
+		if (mtd_erase_block(fd, ofs) < 0 ||
+		    pwrite(fd, data, len, ofs) != len)
+			return -1;
+	}
+
+	return 0;
+}
+
 static int
 mtd_write(int imagefd, const char *mtd, char *fis_layout, size_t part_offset)
 {
@@ -478,6 +534,11 @@ mtd_write(int imagefd, const char *mtd, char *fis_layout, size_t part_offset)
 	int buflen_raw = 0;
 	int jffs2_replaced = 0;
 	int skip_bad_blocks = 0;
+	int unchanged;
+	struct timespec ts;
+	uint32_t f_md5[4];
+	md5_ctx_t md5;
+	off_t pos;
 
 #ifdef FIS_SUPPORT
 	static struct fis_part new_parts[MAX_ARGS];
@@ -544,6 +605,11 @@ next:
 
 	r = 0;
 
+	/* hash the image as it streams in, including data read before we got here */
+	md5_begin(&md5);
+	if (buflen > 0)
+		md5_hash(buf, buflen, &md5);
+
 resume:
 	next = strchr(mtd, ':');
 	if (next) {
@@ -575,6 +641,7 @@ resume:
 	indicate_writing(mtd);
 
 	w = e = 0;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
 	for (;;) {
 		/* buffer may contain data already (from trx check or last mtd partition write attempt) */
 		while (buflen < erasesize) {
@@ -591,9 +658,12 @@ resume:
 			if (r == 0)
 				break;
 
+			md5_hash(buf + buflen, r, &md5);
 			buflen += r;
 		}
 
+		write_stats.read += time_delta(&ts);
+
 		if (buflen_raw == 0)
 			buflen_raw = buflen;
 
@@ -642,8 +712,29 @@ resume:
 			mtd_parse_jffs2data(buf, jffs2dir);
 		}
 
+		/* leave the block alone if the flash already holds this data */
+		unchanged = 0;
+		if (skip_unchanged && !no_erase && !offset &&
+		    w == e - skip_bad_blocks && !mtd_block_is_bad(fd, e)) {
+			if (!quiet)
+				fprintf(stderr, "\b\b\b[c]");
+
+			unchanged = mtd_block_unchanged(fd, e + part_offset, buf, erasesize);
+			write_stats.compare += time_delta(&ts);
+		}
+
+		if (unchanged) {
+			if (!quiet)
+				fprintf(stderr, "\b\b\b[s]");
+
+			lseek(fd, erasesize, SEEK_CUR);
+			e += erasesize;
+			w += buflen;
+			write_stats.unchanged++;
+		}
+
 		/* need to erase the next block before writing data to it */
-		if(!no_erase)
+		if(!no_erase && !unchanged)
 		{
 			while (w + buflen > e - skip_bad_blocks) {
 				if (!quiet)
@@ -682,21 +773,38 @@ resume:
 				/* erase the chunk */
 				e += erasesize;
 			}
+			write_stats.erase += time_delta(&ts);
 		}
 
-		if (!quiet)
-			fprintf(stderr, "\b\b\b[w]");
+		if (!unchanged) {
+			if (!quiet)
+				fprintf(stderr, "\b\b\b[w]");
+
+			pos = lseek(fd, 0, SEEK_CUR);
+			if ((result = write(fd, buf + offset, buflen)) < buflen) {
+				if (result < 0) {
+					fprintf(stderr, "Error writing image.\n");
+					exit(1);
+				} else {
+					fprintf(stderr, "Insufficient space.\n");
+					exit(1);
+				}
+			}
+			w += buflen;
+			write_stats.write += time_delta(&ts);
 
-		if ((result = write(fd, buf + offset, buflen)) < buflen) {
-			if (result < 0) {
-				fprintf(stderr, "Error writing image.\n");
-				exit(1);
-			} else {
-				fprintf(stderr, "Insufficient space.\n");
-				exit(1);
+			if (verify_write) {
+				if (!quiet)
+					fprintf(stderr, "\b\b\b[v]");
+
+				if (mtd_write_verify(fd, pos, buf + offset, buflen) < 0) {
+					fprintf(stderr, "\nVerification failed at 0x%08llx\n", (unsigned long long) pos);
+					exit(1);
+				}
+				write_stats.verify += time_delta(&ts);
 			}
 		}
-		w += buflen;
+		write_stats.blocks++;
 
 #ifdef FIS_SUPPORT
 		if (cur_part && cur_part->size
@@ -742,6 +850,21 @@ resume:
 	if (quiet < 2)
 		fprintf(stderr, "\n");
 
+	if (quiet < 2 && skip_unchanged)
+		fprintf(stderr, "%d of %d blocks unchanged; read %.2fs, compare %.2fs, erase %.2fs, write %.2fs\n",
+			write_stats.unchanged, write_stats.blocks, write_stats.read,
+			write_stats.compare, write_stats.erase, write_stats.write);
+
+	if (verify_write) {
+		md5_end(f_md5, &md5);
+		if (quiet < 2)
+			fprintf(stderr, "%08x%08x%08x%08x - %s\n"
+				"Verified %d blocks (%d retried) in %.2fs\n",
+				f_md5[0], f_md5[1], f_md5[2], f_md5[3], imagefile,
+				write_stats.blocks - write_stats.unchanged,
+				write_stats.retried, write_stats.verify);
+	}
+
 #ifdef FIS_SUPPORT
 	if (fis_layout) {
 		if (fis_remap(old_parts, n_old, new_parts, n_new) < 0)
@@ -775,7 +898,10 @@ static void usage(void)
 	"        erase                   erase all data on device\n"
 	"        verify <imagefile>|-    verify <imagefile> (use - for stdin) to device\n"
 	"        write <imagefile>|-     write <imagefile> (use - for stdin) to device\n"
-	"        jffs2write <file>       append <file> to the jffs2 partition on the device\n");
+	"        patch <deltafile>|-     apply a block delta (use - for stdin) to device\n"
+	"        jffs2write <file>       append <file> to the jffs2 partition on the device\n"
+	"        bench                   measure the erase, write and read speed of the device\n"
+	"                                (destroys all data on it)\n");
 	if (mtd_resetbc) {
 	    fprintf(stderr,
 	"        resetbc <device>        reset the uboot boot counter\n");
@@ -801,6 +927,10 @@ static void usage(void)
 	"        -q                      quiet mode (once: no [w] on writing,\n"
 	"                                           twice: no status messages)\n"
 	"        -n                      write without first erasing the blocks\n"
+	"        -u                      skip erasing and writing blocks that already\n"
+	"                                hold the image data (for write)\n"
+	"        -v                      read back and check every block after\n"
+	"                                writing it, print the image md5 (for write)\n"
 	"        -r                      reboot after successful command\n"
 	"        -f                      force write without trx checks\n"
 	"        -e <device>             erase <device> before executing the command\n"
@@ -857,6 +987,7 @@ int main (int argc, char **argv)
 	enum {
 		CMD_ERASE,
 		CMD_WRITE,
+		CMD_PATCH,
 		CMD_UNLOCK,
 		CMD_JFFS2WRITE,
 		CMD_FIXTRX,
@@ -866,6 +997,7 @@ int main (int argc, char **argv)
 		CMD_VERIFY,
 		CMD_DUMP,
 		CMD_RESETBC,
+		CMD_BENCH,
 	} cmd = -1;
 
 	erase[0] = NULL;
@@ -874,12 +1006,14 @@ int main (int argc, char **argv)
 	buflen = 0;
 	quiet = 0;
 	no_erase = 0;
+	skip_unchanged = 0;
+	verify_write = 0;
 
 	while ((ch = getopt(argc, argv,
 #ifdef FIS_SUPPORT
 			"F:"
 #endif
-			"frnqe:d:s:j:p:o:c:t:l:M:")) != -1)
+			"frnquve:d:s:j:p:o:c:t:l:M:")) != -1)
 		switch (ch) {
 			case 'f':
 				force = 1;
@@ -890,6 +1024,12 @@ int main (int argc, char **argv)
 			case 'n':
 				no_erase = 1;
 				break;
+			case 'u':
+				skip_unchanged = 1;
+				break;
+			case 'v':
+				verify_write = 1;
+				break;
 			case 'j':
 				jffs2file = optarg;
 				break;
@@ -1001,6 +1141,9 @@ int main (int argc, char **argv)
 	} else if ((strcmp(argv[0], "dump") == 0) && (argc == 2)) {
 		cmd = CMD_DUMP;
 		device = argv[1];
+	} else if ((strcmp(argv[0], "bench") == 0) && (argc == 2)) {
+		cmd = CMD_BENCH;
+		device = argv[1];
 	} else if ((strcmp(argv[0], "write") == 0) && (argc == 3)) {
 		cmd = CMD_WRITE;
 		device = argv[2];
@@ -1025,6 +1168,25 @@ int main (int argc, char **argv)
 			fprintf(stderr, "Image check failed.\n");
 			exit(1);
 		}
+	} else if ((strcmp(argv[0], "patch") == 0) && (argc == 3)) {
+		cmd = CMD_PATCH;
+		device = argv[2];
+
+		if (strcmp(argv[1], "-") == 0) {
+			imagefile = "<stdin>";
+			imagefd = 0;
+		} else {
+			imagefile = argv[1];
+			if ((imagefd = open(argv[1], O_RDONLY)) < 0) {
+				fprintf(stderr, "Couldn't open delta file: %s!\n", imagefile);
+				exit(1);
+			}
+		}
+
+		if (!mtd_check(device)) {
+			fprintf(stderr, "Can't open device for writing!\n");
+			exit(1);
+		}
 	} else if ((strcmp(argv[0], "jffs2write") == 0) && (argc == 3)) {
 		cmd = CMD_JFFS2WRITE;
 		device = argv[2];
@@ -1071,6 +1233,18 @@ int main (int argc, char **argv)
 				mtd_unlock(device);
 			mtd_write(imagefd, device, fis_layout, part_offset);
 			break;
+		case CMD_PATCH:
+			if (!unlocked)
+				mtd_unlock(device);
+			if (mtd_patch(imagefd, device) < 0)
+				exit(1);
+			break;
+		case CMD_BENCH:
+			if (!unlocked)
+				mtd_unlock(device);
+			if (mtd_bench(device) < 0)
+				exit(1);
+			break;
 		case CMD_JFFS2WRITE:
 			if (!unlocked)
 				mtd_unlock(device);
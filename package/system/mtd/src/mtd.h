@@ -23,6 +23,8 @@ extern int mtd_write_buffer(int fd, const char *buf, int offset, int length);
 extern int mtd_write_jffs2(const char *mtd, const char *filename, const char *dir);
 extern int mtd_replace_jffs2(const char *mtd, int fd, int ofs, const char *filename);
 extern void mtd_parse_jffs2data(const char *buf, const char *dir);
+extern int mtd_patch(int deltafd, const char *mtd);
+extern int mtd_bench(const char *mtd);
 
 /* target specific functions */
 extern int trx_fixup(int fd, const char *name)  __attribute__ ((weak));
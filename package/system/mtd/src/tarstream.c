@@ -0,0 +1,428 @@
+/*
+ * tarstream.c
+ *
+ * Walk a (sysupgrade) tar stream once and feed its members to commands
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+/*
+ * tarstream list <tarfile>|-
+ *   Print "<size> <magic> <name>" for every regular file, magic being
+ *   the first four bytes in hex (or "-" for empty files). Member data of
+ *   a seekable tar file is skipped without reading it.
+ *
+ * tarstream extract <tarfile>|- <member>=<command> [...]
+ *   Pipe each named member into "/bin/sh -c <command>" as it passes by,
+ *   with TAR_SIZE set to the member length. Everything else is skipped.
+ *   Fails if a command fails or a member is missing.
+ *
+ * ustar, GNU long names and pax path/size records are understood.
+ */
+
+#define _GNU_SOURCE
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TAR_BLOCK	512
+#define TAR_PAD(x)	(((x) + TAR_BLOCK - 1) & ~(unsigned long long)(TAR_BLOCK - 1))
+
+struct tar_member {
+	char name[PATH_MAX];
+	unsigned long long size;
+	char type;
+};
+
+struct extract_spec {
+	const char *name;
+	const char *cmd;
+	int done;
+};
+
+static int tar_fd;
+static int tar_seekable;
+static unsigned char buf[64 * 1024];
+
+static ssize_t read_full(void *data, size_t len)
+{
+	size_t done = 0;
+	ssize_t r;
+
+	while (done < len) {
+		r = read(tar_fd, (char *) data + done, len - done);
+		if (r < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (!r)
+			break;
+		done += r;
+	}
+
+	return done;
+}
+
+static int write_full(int fd, const void *data, size_t len)
+{
+	const char *p = data;
+	ssize_t r;
+
+	while (len) {
+		r = write(fd, p, len);
+		if (r < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		p += r;
+		len -= r;
+	}
+
+	return 0;
+}
+
+static int skip(unsigned long long len)
+{
+	ssize_t r;
+
+	if (tar_seekable && lseek(tar_fd, len, SEEK_CUR) >= 0)
+		return 0;
+
+	while (len) {
+		r = read_full(buf, len < sizeof(buf) ? len : sizeof(buf));
+		if (r <= 0)
+			return -1;
+		len -= r;
+	}
+
+	return 0;
+}
+
+static unsigned long long parse_number(const unsigned char *p, int len)
+{
+	unsigned long long val = 0;
+	int i = 0;
+
+	/* GNU base-256 encoding for large values */
+	if (p[0] & 0x80) {
+		val = p[0] & 0x7f;
+		for (i = 1; i < len; i++)
+			val = (val << 8) | p[i];
+		return val;
+	}
+
+	while (i < len && (p[i] == ' ' || p[i] == '0'))
+		i++;
+	for (; i < len && p[i] >= '0' && p[i] <= '7'; i++)
+		val = (val << 3) | (p[i] - '0');
+
+	return val;
+}
+
+static int header_valid(const unsigned char *h)
+{
+	unsigned int sum = 0;
+	int i;
+
+	for (i = 0; i < TAR_BLOCK; i++)
+		sum += (i >= 148 && i < 156) ? ' ' : h[i];
+
+	return sum == parse_number(h + 148, 8);
+}
+
+/* read a long name or pax header payload into buf */
+static int read_ext(unsigned long long size)
+{
+	if (size >= sizeof(buf))
+		return -1;
+
+	if (read_full(buf, size) != (ssize_t) size ||
+	    skip(TAR_PAD(size) - size))
+		return -1;
+	buf[size] = 0;
+
+	return 0;
+}
+
+static void parse_pax(char *name, unsigned long long *size)
+{
+	char *p = (char *) buf, *end, *key, *val;
+	unsigned long len;
+
+	while (*p) {
+		len = strtoul(p, &key, 10);
+		if (!len || *key != ' ')
+			break;
+		end = p + len;
+		key++;
+		val = strchr(key, '=');
+		if (!val || val >= end)
+			break;
+		*val++ = 0;
+		end[-1] = 0;
+
+		if (!strcmp(key, "path"))
+			snprintf(name, PATH_MAX, "%s", val);
+		else if (!strcmp(key, "size"))
+			*size = strtoull(val, NULL, 10);
+
+		p = end;
+	}
+}
+
+/* returns 1 for a member, 0 at the end of the archive, -1 on error */
+static int next_member(struct tar_member *m)
+{
+	unsigned char h[TAR_BLOCK];
+	char ext_name[PATH_MAX] = "";
+	unsigned long long ext_size = ~0ULL;
+	ssize_t r;
+	int i;
+
+	for (;;) {
+		r = read_full(h, sizeof(h));
+		if (r == 0)
+			return 0;
+		if (r != sizeof(h))
+			return -1;
+
+		for (i = 0; i < TAR_BLOCK && !h[i]; i++)
+			;
+		if (i == TAR_BLOCK)
+			return 0;
+
+		if (!header_valid(h)) {
+			fprintf(stderr, "Bad tar header checksum\n");
+			return -1;
+		}
+
+		m->type = h[156];
+		m->size = parse_number(h + 124, 12);
+
+		switch (m->type) {
+		case 'L':
+			if (read_ext(m->size))
+				return -1;
+			snprintf(ext_name, sizeof(ext_name), "%.*s",
+				 (int) sizeof(ext_name) - 1, buf);
+			continue;
+		case 'x':
+			if (read_ext(m->size))
+				return -1;
+			parse_pax(ext_name, &ext_size);
+			continue;
+		case 'g':
+			if (skip(TAR_PAD(m->size)))
+				return -1;
+			continue;
+		}
+
+		if (*ext_name)
+			snprintf(m->name, sizeof(m->name), "%s", ext_name);
+		else if (!memcmp(h + 257, "ustar", 5) && h[345])
+			snprintf(m->name, sizeof(m->name), "%.155s/%.100s",
+				 h + 345, h);
+		else
+			snprintf(m->name, sizeof(m->name), "%.100s", h);
+
+		if (ext_size != ~0ULL)
+			m->size = ext_size;
+
+		return 1;
+	}
+}
+
+static int is_file(struct tar_member *m)
+{
+	return m->type == '0' || m->type == '\0' || m->type == '7';
+}
+
+static int tar_list(void)
+{
+	struct tar_member m;
+	unsigned char magic[4];
+	ssize_t len;
+	int ret, i;
+
+	while ((ret = next_member(&m)) > 0) {
+		if (!is_file(&m)) {
+			if (skip(TAR_PAD(m.size)))
+				return 1;
+			continue;
+		}
+
+		len = m.size < sizeof(magic) ? m.size : sizeof(magic);
+		if (read_full(magic, len) != len ||
+		    skip(TAR_PAD(m.size) - len))
+			return 1;
+
+		printf("%llu ", m.size);
+		for (i = 0; i < len; i++)
+			printf("%02x", magic[i]);
+		printf("%s %s\n", len ? "" : "-", m.name);
+	}
+
+	return ret < 0;
+}
+
+static int run_member(struct tar_member *m, const char *cmd)
+{
+	unsigned long long len = m->size;
+	char size[24];
+	int fds[2], status;
+	ssize_t r;
+	pid_t pid;
+
+	if (pipe(fds))
+		return -1;
+
+	pid = fork();
+	if (pid < 0)
+		return -1;
+
+	if (!pid) {
+		signal(SIGPIPE, SIG_DFL);
+		if (tar_fd)
+			close(tar_fd);
+		close(fds[1]);
+		dup2(fds[0], 0);
+		close(fds[0]);
+		snprintf(size, sizeof(size), "%llu", m->size);
+		setenv("TAR_SIZE", size, 1);
+		execl("/bin/sh", "sh", "-c", cmd, NULL);
+		_exit(127);
+	}
+
+	close(fds[0]);
+	while (len) {
+		r = read_full(buf, len < sizeof(buf) ? len : sizeof(buf));
+		if (r <= 0) {
+			fprintf(stderr, "Truncated tar member %s\n", m->name);
+			break;
+		}
+		if (write_full(fds[1], buf, r)) {
+			fprintf(stderr, "Failed to feed %s: %s\n", m->name,
+				strerror(errno));
+			break;
+		}
+		len -= r;
+	}
+	close(fds[1]);
+
+	if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) ||
+	    WEXITSTATUS(status)) {
+		fprintf(stderr, "Command for %s failed\n", m->name);
+		return -1;
+	}
+
+	if (len || skip(TAR_PAD(m->size) - m->size))
+		return -1;
+
+	return 0;
+}
+
+static int tar_extract(struct extract_spec *specs, int n_specs)
+{
+	struct tar_member m;
+	int ret, i;
+
+	while ((ret = next_member(&m)) > 0) {
+		for (i = 0; i < n_specs; i++)
+			if (!specs[i].done && !strcmp(specs[i].name, m.name))
+				break;
+
+		if (i == n_specs || !is_file(&m)) {
+			if (skip(TAR_PAD(m.size)))
+				return 1;
+			continue;
+		}
+
+		if (run_member(&m, specs[i].cmd))
+			return 1;
+		specs[i].done = 1;
+	}
+
+	if (ret < 0) {
+		fprintf(stderr, "Failed to read tar\n");
+		return 1;
+	}
+
+	for (i = 0; i < n_specs; i++) {
+		if (specs[i].done)
+			continue;
+		fprintf(stderr, "Member %s not found\n", specs[i].name);
+		ret = 1;
+	}
+
+	return ret;
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "Usage: tarstream list <tarfile>|-\n"
+		"       tarstream extract <tarfile>|- <member>=<command> [...]\n");
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	struct extract_spec *specs;
+	char *sep;
+	int i;
+
+	if (argc < 3)
+		usage();
+
+	if (!strcmp(argv[2], "-")) {
+		tar_fd = 0;
+	} else {
+		tar_fd = open(argv[2], O_RDONLY);
+		if (tar_fd < 0) {
+			fprintf(stderr, "Couldn't open %s: %s\n", argv[2],
+				strerror(errno));
+			return 1;
+		}
+	}
+	tar_seekable = lseek(tar_fd, 0, SEEK_CUR) >= 0;
+
+	if (!strcmp(argv[1], "list"))
+		return tar_list();
+
+	if (strcmp(argv[1], "extract") || argc < 4)
+		usage();
+
+	specs = calloc(argc - 3, sizeof(*specs));
+	if (!specs)
+		return 1;
+
+	for (i = 3; i < argc; i++) {
+		sep = strchr(argv[i], '=');
+		if (!sep)
+			usage();
+		*sep = 0;
+		specs[i - 3].name = argv[i];
+		specs[i - 3].cmd = sep + 1;
+	}
+
+	/* a dying writer must show up as an error, not kill us */
+	signal(SIGPIPE, SIG_IGN);
+
+	return tar_extract(specs, argc - 3);
+}
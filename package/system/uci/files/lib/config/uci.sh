@@ -31,6 +31,10 @@ uci_load() {
 			export ${NO_EXPORT:+-n} CONFIG_${VAR}_LENGTH=
 		done
 		export ${NO_EXPORT:+-n} CONFIG_LIST_STATE=
+		for VAR in $CONFIG_TYPES; do
+			export ${NO_EXPORT:+-n} CONFIG_TYPE_SECTIONS_${VAR}=
+		done
+		export ${NO_EXPORT:+-n} CONFIG_TYPES=
 		export ${NO_EXPORT:+-n} CONFIG_SECTIONS=
 		export ${NO_EXPORT:+-n} CONFIG_NUM_SECTIONS=0
 		export ${NO_EXPORT:+-n} CONFIG_SECTION=
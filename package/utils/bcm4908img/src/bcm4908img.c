@@ -3,15 +3,19 @@
  * Copyright (C) 2021 Rafał Miłecki <rafal@milecki.pl>
  */
 
+#define _GNU_SOURCE
+
 #include <byteswap.h>
 #include <endian.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
@@ -57,6 +61,8 @@
 
 #define UBI_EC_HDR_MAGIC		0x55424923
 
+#define BCM4908IMG_COPY_CHUNK		(1 << 20)
+
 static int debug;
 
 struct bcm4908img_tail {
@@ -182,6 +188,86 @@ uint32_t bcm4908img_crc32(uint32_t crc, const void *buf, size_t len) {
  * Helpers
  **************************************************/
 
+static int bcm4908img_write_all(int fd, const void *buf, size_t length) {
+	const uint8_t *out = buf;
+	ssize_t bytes;
+
+	while (length) {
+		bytes = write(fd, out, length);
+		if (bytes < 0 && errno == EINTR)
+			continue;
+		if (bytes <= 0)
+			return bytes ? -errno : -EIO;
+		out += bytes;
+		length -= bytes;
+	}
+
+	return 0;
+}
+
+/*
+ * Image parsing needs to seek so data coming from a pipe (e.g. zcat output)
+ * gets moved into an anonymous memory file first. That avoids creating any
+ * temporary file in the (often almost full) tmpfs during sysupgrade.
+ */
+static FILE *bcm4908img_spool_stdin(void) {
+	uint8_t buf[16384];
+	FILE *fp = NULL;
+	ssize_t bytes;
+	int fd = -1;
+	int err;
+
+#ifdef __linux__
+	fd = memfd_create("bcm4908img", 0);
+	if (fd >= 0) {
+		fp = fdopen(fd, "r");
+		if (!fp)
+			close(fd);
+	}
+#endif
+	if (!fp) {
+		fp = tmpfile();
+		if (!fp) {
+			fprintf(stderr, "Failed to create buffer for stdin data: %d\n", -errno);
+			return NULL;
+		}
+	}
+	fd = fileno(fp);
+
+#ifdef __linux__
+	while ((bytes = splice(STDIN_FILENO, NULL, fd, NULL, BCM4908IMG_COPY_CHUNK, SPLICE_F_MOVE)) > 0)
+		;
+	if (!bytes)
+		goto out;
+	if (errno != EINVAL) {
+		err = -errno;
+		goto err_close;
+	}
+#endif
+
+	/* No splice() support for the target file, just copy data */
+	while ((bytes = read(STDIN_FILENO, buf, sizeof(buf))) != 0) {
+		if (bytes < 0) {
+			if (errno == EINTR)
+				continue;
+			err = -errno;
+			goto err_close;
+		}
+		err = bcm4908img_write_all(fd, buf, bytes);
+		if (err)
+			goto err_close;
+	}
+
+out:
+	rewind(fp);
+	return fp;
+
+err_close:
+	fprintf(stderr, "Failed to read stdin: %d\n", err);
+	fclose(fp);
+	return NULL;
+}
+
 static FILE *bcm4908img_open(const char *pathname, const char *mode) {
 	struct stat st;
 
@@ -199,8 +285,11 @@ static FILE *bcm4908img_open(const char *pathname, const char *mode) {
 	}
 
 	if (S_ISFIFO(st.st_mode)) {
-		fprintf(stderr, "Reading from pipe stdin is unsupported\n");
-		return NULL;
+		if (strcmp(mode, "r")) {
+			fprintf(stderr, "Modifying pipe stdin is unsupported\n");
+			return NULL;
+		}
+		return bcm4908img_spool_stdin();
 	}
 
 	return stdin;
@@ -211,18 +300,102 @@ static void bcm4908img_close(FILE *fp) {
 		fclose(fp);
 }
 
-static int bcm4908img_calc_crc32(FILE *fp, struct bcm4908img_info *info) {
-	uint8_t buf[1024];
-	size_t length;
+static int bcm4908img_crc32_range(FILE *fp, size_t offset, size_t length, uint32_t *crc32) {
+	uint8_t buf[16384];
 	size_t bytes;
+	void *map;
 
-	/* Start with cferom (or bootfs) - skip vendor header */
-	fseek(fp, info->cferom_offset, SEEK_SET);
+	/* Flush pending writes so they are visible through mmap() */
+	fflush(fp);
 
+	map = mmap(NULL, offset + length, PROT_READ, MAP_SHARED, fileno(fp), 0);
+	if (map != MAP_FAILED) {
+		madvise(map, offset + length, MADV_SEQUENTIAL);
+		*crc32 = bcm4908img_crc32(*crc32, (uint8_t *)map + offset, length);
+		munmap(map, offset + length);
+		return 0;
+	}
+
+	/* Not mappable (e.g. character device), fall back to reading */
+	if (fseek(fp, offset, SEEK_SET)) {
+		fprintf(stderr, "Failed to fseek to the 0x%zx\n", offset);
+		return -errno;
+	}
+	while (length && (bytes = fread(buf, 1, bcm4908img_min(sizeof(buf), length), fp)) > 0) {
+		*crc32 = bcm4908img_crc32(*crc32, buf, bytes);
+		length -= bytes;
+	}
+	if (length) {
+		fprintf(stderr, "Failed to read last %zd B of data\n", length);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+static int bcm4908img_calc_crc32(FILE *fp, struct bcm4908img_info *info) {
+	/* Start with cferom (or bootfs) - skip vendor header */
 	info->crc32 = 0xffffffff;
-	length = info->tail_offset - info->cferom_offset;
+	return bcm4908img_crc32_range(fp, info->cferom_offset, info->tail_offset - info->cferom_offset, &info->crc32);
+}
+
+/*
+ * Write image data to stdout. Avoid copying it through userspace buffers
+ * whenever possible: copy_file_range() for regular files and splice() for
+ * pipes (e.g. "mtd write -").
+ */
+static int bcm4908img_copy_out(FILE *fp, size_t offset, size_t length) {
+	uint8_t buf[16384];
+	size_t bytes;
+	int err;
+
+	fflush(stdout);
+
+#ifdef __linux__
+	{
+		int out = fileno(stdout);
+		loff_t off = offset;
+		struct stat st;
+		ssize_t ret;
+
+		if (fstat(out, &st))
+			st.st_mode = 0;
+
+		while (length) {
+			bytes = bcm4908img_min(length, BCM4908IMG_COPY_CHUNK);
+			if (S_ISREG(st.st_mode))
+				ret = copy_file_range(fileno(fp), &off, out, NULL, bytes, 0);
+			else if (S_ISFIFO(st.st_mode))
+				ret = splice(fileno(fp), &off, out, NULL, bytes, SPLICE_F_MORE);
+			else
+				break;
+			if (ret < 0 && errno == EINTR)
+				continue;
+			if (ret < 0 && errno == EPIPE) {
+				fprintf(stderr, "Failed to write data: %d\n", -errno);
+				return -EPIPE;
+			}
+			if (ret <= 0)
+				break;
+			length -= ret;
+		}
+		offset = off;
+	}
+#endif
+
+	if (!length)
+		return 0;
+
+	if (fseek(fp, offset, SEEK_SET)) {
+		err = -errno;
+		fprintf(stderr, "Failed to fseek to the 0x%zx\n", offset);
+		return err;
+	}
 	while (length && (bytes = fread(buf, 1, bcm4908img_min(sizeof(buf), length), fp)) > 0) {
-		info->crc32 = bcm4908img_crc32(info->crc32, buf, bytes);
+		if (fwrite(buf, 1, bytes, stdout) != bytes) {
+			fprintf(stderr, "Failed to write %zu B of data\n", bytes);
+			return -EIO;
+		}
 		length -= bytes;
 	}
 	if (length) {
@@ -372,22 +545,17 @@ static int bcm4908img_parse(FILE *fp, struct bcm4908img_info *info) {
 
 	/* CRC32 */
 
-	/* Start with cferom (or bootfs) - skip vendor header */
-	fseek(fp, info->cferom_offset, SEEK_SET);
-
-	info->crc32 = 0xffffffff;
-	length = info->tail_offset - info->cferom_offset;
-	while (length && (bytes = fread(buf, 1, bcm4908img_min(sizeof(buf), length), fp)) > 0) {
-		info->crc32 = bcm4908img_crc32(info->crc32, buf, bytes);
-		length -= bytes;
-	}
-	if (length) {
-		fprintf(stderr, "Failed to read last %zd B of data\n", length);
-		return -EIO;
-	}
+	err = bcm4908img_calc_crc32(fp, info);
+	if (err)
+		return err;
 
 	/* Tail */
 
+	if (fseek(fp, info->tail_offset, SEEK_SET)) {
+		err = -errno;
+		fprintf(stderr, "Failed to fseek to the 0x%zx\n", info->tail_offset);
+		return err;
+	}
 	if (fread(tail, 1, sizeof(*tail), fp) != sizeof(*tail)) {
 		fprintf(stderr, "Failed to read BCM4908 image tail\n");
 		return -EIO;
@@ -593,10 +761,8 @@ static int bcm4908img_extract(int argc, char **argv) {
 	struct bcm4908img_info info;
 	const char *pathname = NULL;
 	const char *type = NULL;
-	uint8_t buf[1024];
 	size_t offset;
 	size_t length;
-	size_t bytes;
 	FILE *fp;
 	int c;
 	int err = 0;
@@ -658,16 +824,7 @@ static int bcm4908img_extract(int argc, char **argv) {
 		goto err_close;
 	}
 
-	fseek(fp, offset, SEEK_SET);
-	while (length && (bytes = fread(buf, 1, bcm4908img_min(sizeof(buf), length), fp)) > 0) {
-		fwrite(buf, bytes, 1, stdout);
-		length -= bytes;
-	}
-	if (length) {
-		err = -EIO;
-		fprintf(stderr, "Failed to read last %zd B of data\n", length);
-		goto err_close;
-	}
+	err = bcm4908img_copy_out(fp, offset, length);
 
 err_close:
 	bcm4908img_close(fp);
@@ -0,0 +1,347 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * caldata - extract and patch wireless calibration data
+ *
+ * Native backend for /lib/functions/caldata.sh, replacing the dd, hexdump
+ * and printf pipelines that used to run for every firmware request. Also
+ * reads MAC addresses from flash for /lib/functions/system.sh.
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CALDATA_MAX	(1024 * 1024)
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"Usage: caldata extract <source> <offset> <count> <target>\n"
+		"       caldata reverse <source> <offset> <count> <target>\n"
+		"       caldata patch <target> <offset> <hexdata> [<chksum offset>]\n"
+		"       caldata mac <source> <offset>\n"
+		"       caldata mac-ascii <source> <key>\n");
+	exit(1);
+}
+
+static int parse_num(const char *str, unsigned long *val)
+{
+	char *end;
+
+	errno = 0;
+	*val = strtoul(str, &end, 0);
+
+	return errno || !*str || *end;
+}
+
+static ssize_t pread_full(int fd, void *buf, size_t len, off_t off)
+{
+	size_t done = 0;
+	ssize_t r;
+
+	while (done < len) {
+		r = pread(fd, (char *) buf + done, len - done, off + done);
+		if (r < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (!r)
+			break;
+		done += r;
+	}
+
+	return done;
+}
+
+static int pwrite_full(int fd, const void *buf, size_t len, off_t off)
+{
+	size_t done = 0;
+	ssize_t r;
+
+	while (done < len) {
+		r = pwrite(fd, (const char *) buf + done, len - done, off + done);
+		if (r < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		done += r;
+	}
+
+	return 0;
+}
+
+static int copy_out(int argc, char **argv, int reverse)
+{
+	unsigned long offset, count;
+	unsigned char *buf, tmp;
+	ssize_t len, i;
+	int fd, ret = 1;
+
+	if (argc != 6 || parse_num(argv[3], &offset) ||
+	    parse_num(argv[4], &count) || count > CALDATA_MAX)
+		usage();
+
+	buf = malloc(count);
+	if (!buf)
+		return 1;
+
+	fd = open(argv[2], O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "caldata: can't open %s: %s\n", argv[2],
+			strerror(errno));
+		goto out;
+	}
+
+	/* like dd, a short source is not an error */
+	len = pread_full(fd, buf, count, offset);
+	close(fd);
+	if (len < 0) {
+		fprintf(stderr, "caldata: can't read %s: %s\n", argv[2],
+			strerror(errno));
+		goto out;
+	}
+
+	if (reverse) {
+		for (i = 0; i < len / 2; i++) {
+			tmp = buf[i];
+			buf[i] = buf[len - 1 - i];
+			buf[len - 1 - i] = tmp;
+		}
+	}
+
+	fd = open(argv[5], O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		fprintf(stderr, "caldata: can't open %s: %s\n", argv[5],
+			strerror(errno));
+		goto out;
+	}
+
+	if (pwrite_full(fd, buf, len, 0))
+		fprintf(stderr, "caldata: can't write %s: %s\n", argv[5],
+			strerror(errno));
+	else
+		ret = 0;
+	close(fd);
+
+out:
+	free(buf);
+	return ret;
+}
+
+static int parse_hex(const char *str, unsigned char *buf, size_t len)
+{
+	unsigned int byte;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		if (!isxdigit(str[2 * i]) || !isxdigit(str[2 * i + 1]) ||
+		    sscanf(str + 2 * i, "%2x", &byte) != 1)
+			return -1;
+		buf[i] = byte;
+	}
+
+	return 0;
+}
+
+/*
+ * Same as xor $(data_2xor_val ...): big endian 16 bit words, a trailing
+ * odd byte counts as the low byte.
+ */
+static unsigned int xor16(const unsigned char *buf, size_t len)
+{
+	unsigned int val = 0;
+	size_t i;
+
+	for (i = 0; i + 1 < len; i += 2)
+		val ^= (buf[i] << 8) | buf[i + 1];
+	if (len & 1)
+		val ^= buf[len - 1];
+
+	return val;
+}
+
+static int patch(int argc, char **argv)
+{
+	unsigned char data[256], old[256], sum[2];
+	unsigned long offset, sum_offset = 0;
+	unsigned int chksum;
+	size_t len;
+	int fd, ret = 1;
+
+	if (argc < 5 || argc > 6 || parse_num(argv[3], &offset) ||
+	    (argc == 6 && parse_num(argv[5], &sum_offset)))
+		usage();
+
+	len = strlen(argv[4]);
+	if (!len || (len & 1) || len / 2 > sizeof(data) ||
+	    parse_hex(argv[4], data, len / 2)) {
+		fprintf(stderr, "caldata: invalid data %s\n", argv[4]);
+		return 1;
+	}
+	len /= 2;
+
+	fd = open(argv[2], O_RDWR);
+	if (fd < 0) {
+		fprintf(stderr, "caldata: can't open %s: %s\n", argv[2],
+			strerror(errno));
+		return 1;
+	}
+
+	if (pread_full(fd, old, len, offset) != (ssize_t) len)
+		goto err;
+
+	if (!memcmp(old, data, len)) {
+		ret = 0;
+		goto out;
+	}
+
+	if (argc == 6) {
+		if (pread_full(fd, sum, 2, sum_offset) != 2)
+			goto err;
+
+		chksum = (sum[0] << 8) | sum[1];
+		chksum ^= xor16(old, len) ^ xor16(data, len);
+		sum[0] = chksum >> 8;
+		sum[1] = chksum;
+
+		if (pwrite_full(fd, sum, 2, sum_offset))
+			goto err;
+	}
+
+	if (pwrite_full(fd, data, len, offset))
+		goto err;
+
+	ret = 0;
+	goto out;
+
+err:
+	fprintf(stderr, "caldata: failed to patch %s\n", argv[2]);
+out:
+	close(fd);
+	return ret;
+}
+
+static int mac_binary(int argc, char **argv)
+{
+	unsigned char mac[6];
+	unsigned long offset;
+	ssize_t len;
+	int fd;
+
+	if (argc != 4 || parse_num(argv[3], &offset))
+		usage();
+
+	fd = open(argv[2], O_RDONLY);
+	if (fd < 0)
+		return 1;
+
+	/* plain read, so this works on /dev/urandom too */
+	if (offset && lseek(fd, offset, SEEK_SET) < 0) {
+		close(fd);
+		return 1;
+	}
+
+	len = 0;
+	while (len < (ssize_t) sizeof(mac)) {
+		ssize_t r = read(fd, mac + len, sizeof(mac) - len);
+
+		if (r < 0 && errno == EINTR)
+			continue;
+		if (r <= 0)
+			break;
+		len += r;
+	}
+	close(fd);
+
+	if (len != sizeof(mac))
+		return 1;
+
+	printf("%02x:%02x:%02x:%02x:%02x:%02x", mac[0], mac[1], mac[2],
+	       mac[3], mac[4], mac[5]);
+
+	return 0;
+}
+
+/*
+ * Same as strings <source> | sed -n 's/^<key>=//p': print the value of
+ * every printable run of at least four characters starting with "<key>=".
+ */
+static int mac_ascii(int argc, char **argv)
+{
+	unsigned char buf[4096];
+	char run[256];
+	size_t keylen, runlen = 0;
+	ssize_t len, i;
+	int fd, c, match = 1;
+
+	if (argc != 4)
+		usage();
+
+	keylen = strlen(argv[3]);
+
+	fd = open(argv[2], O_RDONLY);
+	if (fd < 0)
+		return 1;
+
+	for (;;) {
+		len = read(fd, buf, sizeof(buf));
+		if (len < 0 && errno == EINTR)
+			continue;
+
+		for (i = 0; i <= len; i++) {
+			c = i < len ? buf[i] : -1;
+			if (c >= 0 && (isprint(c) || c == '\t')) {
+				if (match && runlen < keylen + 1)
+					match = c == (runlen < keylen ?
+						      argv[3][runlen] : '=');
+				if (runlen < sizeof(run) - 1)
+					run[runlen] = c;
+				runlen++;
+				continue;
+			}
+
+			/* a read boundary does not end a run */
+			if (c < 0 && len > 0)
+				break;
+
+			if (match && runlen > keylen && runlen >= 4)
+				printf("%.*s\n", (int) (runlen < sizeof(run) ?
+					runlen : sizeof(run) - 1) - (int) keylen - 1,
+					run + keylen + 1);
+			runlen = 0;
+			match = 1;
+		}
+
+		if (len <= 0)
+			break;
+	}
+	close(fd);
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+		usage();
+
+	if (!strcmp(argv[1], "extract"))
+		return copy_out(argc, argv, 0);
+	if (!strcmp(argv[1], "reverse"))
+		return copy_out(argc, argv, 1);
+	if (!strcmp(argv[1], "patch"))
+		return patch(argc, argv);
+	if (!strcmp(argv[1], "mac"))
+		return mac_binary(argc, argv);
+	if (!strcmp(argv[1], "mac-ascii"))
+		return mac_ascii(argc, argv);
+
+	usage();
+	return 1;
+}
@@ -43,9 +43,25 @@ export_fitblk_bootdev() {
 	done
 }
 
+# Copy a FIT image from stdin to stdout, checking the hashes of its
+# sub-images on the way. The end of a corrupt or truncated image is held
+# back, fit_check_ok tells afterwards whether the image passed.
+fit_check() {
+	fitcheck
+	echo "$?" > /tmp/fitcheck.status
+}
+
+fit_check_ok() {
+	[ "$(cat /tmp/fitcheck.status 2>/dev/null)" = 0 ] && return 0
+
+	echo "FIT image is corrupt or truncated"
+	return 1
+}
+
 fit_do_upgrade() {
 	export_fitblk_bootdev
 	[ -n "$CI_METHOD" ] || return 1
+	command -v fitcheck >/dev/null && FIT_CHECK=fit_check
 	[ -e /dev/fit0 ] && fitblk /dev/fit0
 	[ -e /dev/fitrw ] && fitblk /dev/fitrw
 
@@ -0,0 +1,553 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Copy a uImage.FIT image from stdin to stdout, checking the crc32 and
+ * sha1 hash nodes of its sub-images on the way.
+ *
+ * The output lags one chunk behind the input, so that on a mismatch or a
+ * truncated image the end of the image is never written and the consumer
+ * (dd, ubiupdatevol) sees a short image.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#define FDT_MAGIC		0xd00dfeed
+#define FDT_BEGIN_NODE		1
+#define FDT_END_NODE		2
+#define FDT_PROP		3
+#define FDT_NOP			4
+#define FDT_END			9
+
+/* larger FIT structures embed their data, they are passed unchecked */
+#define FIT_MAX_SIZE		(4 * 1024 * 1024)
+
+#define MAX_IMAGES		16
+#define MAX_HASHES		4
+#define CHUNK_SIZE		(64 * 1024)
+
+enum hash_algo {
+	HASH_CRC32,
+	HASH_SHA1,
+};
+
+struct sha1_ctx {
+	uint32_t state[5];
+	uint64_t len;
+	uint8_t buf[64];
+};
+
+struct fit_hash {
+	enum hash_algo algo;
+	uint8_t value[20];
+	union {
+		uint32_t crc;
+		struct sha1_ctx sha1;
+	};
+};
+
+struct fit_image {
+	const char *name;
+	const uint8_t *data;	/* embedded data */
+	uint64_t pos, len;
+	int has_pos, has_len;
+	struct fit_hash hash[MAX_HASHES];
+	int n_hash;
+	int skipped;		/* hash nodes with an unsupported algorithm */
+};
+
+static struct fit_image images[MAX_IMAGES];
+static int n_images;
+
+static uint32_t be32(const uint8_t *p)
+{
+	return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+static uint32_t crc32_table[256];
+
+static void crc32_init(void)
+{
+	uint32_t c;
+	int i, j;
+
+	for (i = 0; i < 256; i++) {
+		c = i;
+		for (j = 0; j < 8; j++)
+			c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+		crc32_table[i] = c;
+	}
+}
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *p, size_t len)
+{
+	while (len--)
+		crc = crc32_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+	return crc;
+}
+
+#define ROL32(x, n)	(((x) << (n)) | ((x) >> (32 - (n))))
+
+static void sha1_block(struct sha1_ctx *ctx, const uint8_t *p)
+{
+	uint32_t w[80], a, b, c, d, e, f, k, t;
+	int i;
+
+	for (i = 0; i < 16; i++)
+		w[i] = be32(p + i * 4);
+	for (; i < 80; i++)
+		w[i] = ROL32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+	a = ctx->state[0];
+	b = ctx->state[1];
+	c = ctx->state[2];
+	d = ctx->state[3];
+	e = ctx->state[4];
+
+	for (i = 0; i < 80; i++) {
+		if (i < 20) {
+			f = (b & c) | (~b & d);
+			k = 0x5a827999;
+		} else if (i < 40) {
+			f = b ^ c ^ d;
+			k = 0x6ed9eba1;
+		} else if (i < 60) {
+			f = (b & c) | (b & d) | (c & d);
+			k = 0x8f1bbcdc;
+		} else {
+			f = b ^ c ^ d;
+			k = 0xca62c1d6;
+		}
+
+		t = ROL32(a, 5) + f + e + k + w[i];
+		e = d;
+		d = c;
+		c = ROL32(b, 30);
+		b = a;
+		a = t;
+	}
+
+	ctx->state[0] += a;
+	ctx->state[1] += b;
+	ctx->state[2] += c;
+	ctx->state[3] += d;
+	ctx->state[4] += e;
+}
+
+static void sha1_init(struct sha1_ctx *ctx)
+{
+	static const uint32_t init[5] = {
+		0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0
+	};
+
+	memcpy(ctx->state, init, sizeof(init));
+	ctx->len = 0;
+}
+
+static void sha1_update(struct sha1_ctx *ctx, const uint8_t *p, size_t len)
+{
+	size_t fill = ctx->len % 64, n;
+
+	ctx->len += len;
+
+	if (fill) {
+		n = 64 - fill < len ? 64 - fill : len;
+		memcpy(ctx->buf + fill, p, n);
+		p += n;
+		len -= n;
+		if (fill + n < 64)
+			return;
+		sha1_block(ctx, ctx->buf);
+	}
+
+	for (; len >= 64; p += 64, len -= 64)
+		sha1_block(ctx, p);
+
+	memcpy(ctx->buf, p, len);
+}
+
+static void sha1_final(struct sha1_ctx *ctx, uint8_t *digest)
+{
+	uint64_t bits = ctx->len * 8;
+	uint8_t pad[72] = { 0x80 };
+	size_t fill = ctx->len % 64;
+	int i;
+
+	sha1_update(ctx, pad, fill < 56 ? 56 - fill : 120 - fill);
+	for (i = 0; i < 8; i++)
+		pad[i] = bits >> (56 - i * 8);
+	sha1_update(ctx, pad, 8);
+
+	for (i = 0; i < 20; i++)
+		digest[i] = ctx->state[i / 4] >> (24 - (i % 4) * 8);
+}
+
+static void hash_update(struct fit_image *img, const uint8_t *p, size_t len)
+{
+	int i;
+
+	for (i = 0; i < img->n_hash; i++) {
+		struct fit_hash *h = &img->hash[i];
+
+		if (h->algo == HASH_CRC32)
+			h->crc = crc32_update(h->crc, p, len);
+		else
+			sha1_update(&h->sha1, p, len);
+	}
+}
+
+static int hash_check(struct fit_image *img)
+{
+	uint8_t digest[20];
+	int i;
+
+	for (i = 0; i < img->n_hash; i++) {
+		struct fit_hash *h = &img->hash[i];
+		size_t len;
+
+		if (h->algo == HASH_CRC32) {
+			h->crc ^= ~0U;
+			digest[0] = h->crc >> 24;
+			digest[1] = h->crc >> 16;
+			digest[2] = h->crc >> 8;
+			digest[3] = h->crc;
+			len = 4;
+		} else {
+			sha1_final(&h->sha1, digest);
+			len = 20;
+		}
+
+		if (memcmp(digest, h->value, len)) {
+			fprintf(stderr, "fitcheck: %s hash of sub-image %s does not match\n",
+				h->algo == HASH_CRC32 ? "crc32" : "sha1", img->name);
+			return -1;
+		}
+	}
+
+	if (img->skipped && !img->n_hash)
+		fprintf(stderr, "fitcheck: no supported hash for sub-image %s, not checked\n",
+			img->name);
+
+	return 0;
+}
+
+static void parse_hash(struct fit_image *img, const char *algo,
+		       const uint8_t *value, uint32_t value_len)
+{
+	struct fit_hash *h;
+
+	if (!algo || !value || img->n_hash == MAX_HASHES)
+		return;
+
+	h = &img->hash[img->n_hash];
+	if (!strcmp(algo, "crc32") && value_len == 4) {
+		h->algo = HASH_CRC32;
+		h->crc = ~0U;
+	} else if (!strcmp(algo, "sha1") && value_len == 20) {
+		h->algo = HASH_SHA1;
+		sha1_init(&h->sha1);
+	} else {
+		img->skipped++;
+		return;
+	}
+
+	memcpy(h->value, value, value_len);
+	img->n_hash++;
+}
+
+/* collect the sub-images below /images and their hash nodes */
+static int parse_fit(const uint8_t *fit, uint32_t size)
+{
+	uint32_t off_struct = be32(fit + 8), off_strings = be32(fit + 12);
+	uint32_t size_strings = be32(fit + 32), size_struct = be32(fit + 36);
+	uint32_t pos = off_struct, end, token, len, nameoff;
+	const char *hash_algo = NULL, *name, *prop;
+	const uint8_t *hash_value = NULL, *data;
+	uint32_t hash_len = 0, data_offset = 0;
+	int depth = 0, in_images = 0, in_hash = 0, has_offset = 0;
+	struct fit_image *img = NULL;
+
+	if (off_struct > size || size_struct > size - off_struct ||
+	    off_strings > size || size_strings > size - off_strings)
+		return -1;
+
+	end = off_struct + size_struct;
+	while (pos + 4 <= end) {
+		token = be32(fit + pos);
+		pos += 4;
+
+		switch (token) {
+		case FDT_BEGIN_NODE:
+			name = (const char *)fit + pos;
+			len = strnlen(name, end - pos);
+			if (len == end - pos)
+				return -1;
+			pos += (len + 4) & ~3;
+			depth++;
+
+			if (depth == 2 && !strcmp(name, "images")) {
+				in_images = 1;
+			} else if (in_images && depth == 3) {
+				if (n_images == MAX_IMAGES)
+					return -1;
+				img = &images[n_images++];
+				img->name = name;
+				has_offset = 0;
+			} else if (img && depth == 4 && !strncmp(name, "hash", 4)) {
+				in_hash = 1;
+				hash_algo = NULL;
+				hash_value = NULL;
+			}
+			break;
+		case FDT_END_NODE:
+			if (in_hash && depth == 4) {
+				parse_hash(img, hash_algo, hash_value, hash_len);
+				in_hash = 0;
+			} else if (img && depth == 3) {
+				if (has_offset)
+					img->pos = data_offset + ((size + 3) & ~3);
+				img = NULL;
+			} else if (in_images && depth == 2) {
+				in_images = 0;
+			}
+			depth--;
+			break;
+		case FDT_PROP:
+			if (pos + 8 > end)
+				return -1;
+			len = be32(fit + pos);
+			nameoff = be32(fit + pos + 4);
+			pos += 8;
+			if (len > end - pos || nameoff >= size_strings)
+				return -1;
+			prop = (const char *)fit + off_strings + nameoff;
+			data = fit + pos;
+			pos += (len + 3) & ~3;
+
+			if (in_hash && depth == 4) {
+				if (!strcmp(prop, "algo") && len && !data[len - 1])
+					hash_algo = (const char *)data;
+				else if (!strcmp(prop, "value")) {
+					hash_value = data;
+					hash_len = len;
+				}
+			} else if (img && depth == 3) {
+				if (!strcmp(prop, "data")) {
+					img->data = data;
+					img->len = len;
+					img->has_len = 1;
+				} else if (!strcmp(prop, "data-size") && len == 4) {
+					img->len = be32(data);
+					img->has_len = 1;
+				} else if (!strcmp(prop, "data-offset") && len == 4) {
+					data_offset = be32(data);
+					has_offset = 1;
+					img->has_pos = 1;
+				} else if (!strcmp(prop, "data-position") && len == 4) {
+					img->pos = be32(data);
+					img->has_pos = 1;
+				}
+			}
+			break;
+		case FDT_NOP:
+			break;
+		case FDT_END:
+			return 0;
+		default:
+			return -1;
+		}
+	}
+
+	return -1;
+}
+
+static int read_full(uint8_t *buf, size_t len)
+{
+	size_t done = 0;
+	ssize_t r;
+
+	while (done < len) {
+		r = read(STDIN_FILENO, buf + done, len - done);
+		if (r < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		if (!r)
+			break;
+		done += r;
+	}
+
+	return done;
+}
+
+static int write_full(const uint8_t *buf, size_t len)
+{
+	ssize_t r;
+
+	while (len) {
+		r = write(STDOUT_FILENO, buf, len);
+		if (r < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("fitcheck: write");
+			return -1;
+		}
+		buf += r;
+		len -= r;
+	}
+
+	return 0;
+}
+
+/* copy the rest of the input, unchecked */
+static int copy_rest(uint8_t *buf)
+{
+	int len;
+
+	while ((len = read_full(buf, CHUNK_SIZE)) > 0)
+		if (write_full(buf, len))
+			return -1;
+
+	return len;
+}
+
+int main(int argc, char **argv)
+{
+	static uint8_t chunk[2][CHUNK_SIZE];
+	uint64_t offset, data_end = 0;
+	uint8_t hdr[40], *fit;
+	uint32_t size;
+	int cur = 0, pending = 0, checked = 0;
+	int i, len;
+
+	if (argc != 1) {
+		fprintf(stderr, "Check the sub-image hashes of a uImage.FIT on its way from stdin to stdout\n");
+		fprintf(stderr, "Syntax: %s < image > output\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	len = read_full(hdr, sizeof(hdr));
+	if (len < (int)sizeof(hdr) || be32(hdr) != FDT_MAGIC) {
+		fprintf(stderr, "fitcheck: not a FIT image\n");
+		return EXIT_FAILURE;
+	}
+
+	size = be32(hdr + 4);
+	if (size < sizeof(hdr)) {
+		fprintf(stderr, "fitcheck: invalid FIT header\n");
+		return EXIT_FAILURE;
+	}
+
+	if (size > FIT_MAX_SIZE) {
+		fprintf(stderr, "fitcheck: FIT structure too large, not checking it\n");
+		if (write_full(hdr, sizeof(hdr)) || copy_rest(chunk[0]))
+			return EXIT_FAILURE;
+		return EXIT_SUCCESS;
+	}
+
+	fit = malloc(size);
+	if (!fit) {
+		fprintf(stderr, "fitcheck: out of memory\n");
+		return EXIT_FAILURE;
+	}
+
+	memcpy(fit, hdr, sizeof(hdr));
+	if (read_full(fit + sizeof(hdr), size - sizeof(hdr)) != (int)(size - sizeof(hdr))) {
+		fprintf(stderr, "fitcheck: FIT structure truncated\n");
+		return EXIT_FAILURE;
+	}
+
+	if (parse_fit(fit, size)) {
+		fprintf(stderr, "fitcheck: invalid FIT structure\n");
+		return EXIT_FAILURE;
+	}
+
+	crc32_init();
+
+	/* embedded data is checked right away, the rest as it streams by */
+	for (i = 0; i < n_images; i++) {
+		struct fit_image *img = &images[i];
+
+		if (img->data) {
+			hash_update(img, img->data, img->len);
+			if (hash_check(img))
+				return EXIT_FAILURE;
+			img->n_hash = 0;
+		} else if (img->has_pos && img->has_len) {
+			if (img->pos < size) {
+				fprintf(stderr, "fitcheck: sub-image %s overlaps the FIT structure\n",
+					img->name);
+				return EXIT_FAILURE;
+			}
+			if (img->pos + img->len > data_end)
+				data_end = img->pos + img->len;
+		} else {
+			img->n_hash = 0;
+		}
+	}
+
+	if (write_full(fit, size))
+		return EXIT_FAILURE;
+
+	offset = size;
+	checked = data_end <= size;
+	while ((len = read_full(chunk[cur], CHUNK_SIZE)) > 0) {
+		for (i = 0; i < n_images; i++) {
+			struct fit_image *img = &images[i];
+			uint64_t start, end;
+
+			if (!img->n_hash)
+				continue;
+
+			start = img->pos > offset ? img->pos : offset;
+			end = img->pos + img->len < offset + len ?
+			      img->pos + img->len : offset + len;
+			if (start < end)
+				hash_update(img, chunk[cur] + (start - offset),
+					    end - start);
+		}
+		offset += len;
+
+		if (!checked && offset >= data_end) {
+			for (i = 0; i < n_images; i++)
+				if (images[i].n_hash && hash_check(&images[i]))
+					return EXIT_FAILURE;
+			checked = 1;
+		}
+
+		/* only write the previous chunk once this one was checked */
+		if (pending && write_full(chunk[!cur], CHUNK_SIZE))
+			return EXIT_FAILURE;
+
+		if (len < CHUNK_SIZE) {
+			pending = 0;
+			if (!checked)
+				break;
+			if (write_full(chunk[cur], len))
+				return EXIT_FAILURE;
+			break;
+		}
+
+		pending = 1;
+		cur = !cur;
+	}
+
+	if (len < 0) {
+		perror("fitcheck: read");
+		return EXIT_FAILURE;
+	}
+
+	if (!checked) {
+		fprintf(stderr, "fitcheck: FIT image truncated\n");
+		return EXIT_FAILURE;
+	}
+
+	if (pending && write_full(chunk[!cur], CHUNK_SIZE))
+		return EXIT_FAILURE;
+
+	return EXIT_SUCCESS;
+}
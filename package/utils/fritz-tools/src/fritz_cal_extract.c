@@ -34,88 +34,107 @@
 #include "zlib.h"
 
 #define CHUNK 1024
+#define MAX_ENTRIES 8
+#define MAX_OFFSETS 8
 
-static inline size_t special_min(size_t a, size_t b)
-{
-	return a == 0 ? b : (a < b ? a : b);
-}
+struct cal_entry {
+	uint16_t id;
+	uint16_t len;
+} __attribute__((packed));
 
-/* Decompress from file source to file dest until stream ends or EOF.
+struct cal_request {
+	uint16_t id;
+	const char *output;
+	unsigned char *data;
+	size_t len;
+};
+
+static struct cal_request req[MAX_ENTRIES];
+static int n_req;
+static int n_out;
+
+static size_t limit, skip;
+
+/* Decompress the deflate stream in buf, keeping the limit bytes (or all of
+   them, if limit is 0) that follow the first skip bytes of its output.
    inf() returns Z_OK on success, Z_MEM_ERROR if memory could not be
    allocated for processing, Z_DATA_ERROR if the deflate data is
-   invalid or incomplete, Z_VERSION_ERROR if the version of zlib.h and
-   the version of the library linked do not match, or Z_ERRNO if there
-   is an error reading or writing the files. */
-static int inf(FILE *source, FILE *dest, size_t limit, size_t skip)
+   invalid or incomplete, or Z_VERSION_ERROR if the version of zlib.h
+   and the version of the library linked do not match. */
+static int inf(const unsigned char *buf, size_t size, struct cal_request *r)
 {
-	int ret;
-	size_t have;
-	z_stream strm;
-	unsigned char in[CHUNK];
 	unsigned char out[CHUNK];
+	unsigned char *data = NULL, *tmp;
+	size_t have, start, len = 0, total = 0;
+	z_stream strm;
+	int ret;
 
 	/* allocate inflate state */
 	strm.zalloc = Z_NULL;
 	strm.zfree = Z_NULL;
 	strm.opaque = Z_NULL;
-	strm.avail_in = 0;
-	strm.next_in = Z_NULL;
+	strm.avail_in = size;
+	strm.next_in = (unsigned char *)buf;
 	ret = inflateInit(&strm);
 	if (ret != Z_OK)
 		return ret;
 
-	/* decompress until deflate stream ends or end of file */
+	/* run inflate() until the stream ends, the input ends or the limit
+	   is reached */
 	do {
-		strm.avail_in = fread(in, 1, CHUNK, source);
-		if (ferror(source)) {
-			(void)inflateEnd(&strm);
-			return Z_ERRNO;
+		strm.avail_out = CHUNK;
+		strm.next_out = out;
+		ret = inflate(&strm, Z_NO_FLUSH);
+		assert(ret != Z_STREAM_ERROR);  /* state not clobbered */
+		switch (ret) {
+		case Z_NEED_DICT:
+			ret = Z_DATA_ERROR;     /* and fall through */
+		case Z_DATA_ERROR:
+		case Z_MEM_ERROR:
+			goto out;
 		}
-		if (strm.avail_in == 0)
-			break;
-		strm.next_in = in;
-
-		/* run inflate() on input until output buffer not full */
-		do {
-			strm.avail_out = CHUNK;
-			strm.next_out = out;
-			ret = inflate(&strm, Z_NO_FLUSH);
-			assert(ret != Z_STREAM_ERROR);  /* state not clobbered */
-			switch (ret) {
-			case Z_NEED_DICT:
-				ret = Z_DATA_ERROR;     /* and fall through */
-			case Z_DATA_ERROR:
-			case Z_MEM_ERROR:
-				(void)inflateEnd(&strm);
-				return ret;
-			}
-			have = special_min(limit, CHUNK - strm.avail_out) - skip;
-			if (fwrite(&out[skip], have, 1, dest) != 1 || ferror(dest)) {
-				(void)inflateEnd(&strm);
-				return Z_ERRNO;
-			}
-		skip = 0;
-		limit -= have;
-		} while (strm.avail_out == 0 && limit > 0);
 
-		/* done when inflate() says it's done */
-	} while (ret != Z_STREAM_END && limit > 0);
+		have = CHUNK - strm.avail_out;
+		total += have;
+		if (total <= skip)
+			continue;
+
+		/* the part of this chunk past skip */
+		start = total - skip < have ? have - (total - skip) : 0;
+		have -= start;
+		if (limit && len + have > limit)
+			have = limit - len;
+
+		tmp = realloc(data, len + have);
+		if (!tmp) {
+			ret = Z_MEM_ERROR;
+			goto out;
+		}
+		data = tmp;
+		memcpy(data + len, &out[start], have);
+		len += have;
+	} while (ret != Z_STREAM_END && strm.avail_out == 0 &&
+		 (!limit || len < limit));
+
+	if ((limit && len == limit) || ret == Z_STREAM_END) {
+		r->data = data;
+		r->len = len;
+		data = NULL;
+		ret = Z_OK;
+	} else {
+		ret = Z_DATA_ERROR;
+	}
 
-	/* clean up and return */
+out:
+	free(data);
 	(void)inflateEnd(&strm);
-	return (limit == 0 ? Z_OK : (ret == Z_STREAM_END ? Z_OK : Z_DATA_ERROR));
+	return ret;
 }
 
-/* report a zlib or i/o error */
+/* report a zlib error */
 static void zerr(int ret)
 {
 	switch (ret) {
-	case Z_ERRNO:
-		if (ferror(stdin))
-			fputs("error reading stdin\n", stderr);
-		if (ferror(stdout))
-			fputs("error writing stdout\n", stderr);
-		break;
 	case Z_STREAM_ERROR:
 		fputs("invalid compression level\n", stderr);
 		break;
@@ -140,63 +159,163 @@ static unsigned int get_num(char *str)
 
 static void usage(void)
 {
-	fprintf(stderr, "Usage: fritz_cal_extract [-s seek offset] [-i skip] [-o output file] [-l limit] [infile] -e entry_id\n"
-			"Finds and extracts zlib compressed calibration data in the EVA loader\n");
+	fprintf(stderr, "Usage: fritz_cal_extract [-s seek offset]... [-i skip] [-l limit] -e entry_id [-o output file]... [infile]...\n"
+			"Finds and extracts zlib compressed calibration data in the EVA loader\n"
+			"Every seek offset of every infile is tried in turn, until all entries are found.\n"
+			"The n-th output file is written with the n-th entry, the others go to stdout.\n");
 	exit(EXIT_FAILURE);
 }
 
-struct cal_entry {
-	uint16_t id;
-	uint16_t len;
-} __attribute__((packed));
+/* read all of an input, so that every candidate offset is searched in
+   memory instead of reading the flash again */
+static unsigned char *read_input(FILE *in, size_t *size)
+{
+	unsigned char *buf = NULL, *tmp;
+	size_t len = 0, alloc = 0, ret;
 
-/* compress or decompress from stdin to stdout */
-int main(int argc, char **argv)
+	do {
+		if (len == alloc) {
+			alloc = alloc ? alloc * 2 : 64 * 1024;
+			tmp = realloc(buf, alloc);
+			if (!tmp) {
+				fputs("out of memory\n", stderr);
+				free(buf);
+				return NULL;
+			}
+			buf = tmp;
+		}
+
+		ret = fread(buf + len, 1, alloc - len, in);
+		len += ret;
+	} while (ret);
+
+	if (ferror(in)) {
+		perror("Failed to read input file");
+		free(buf);
+		return NULL;
+	}
+
+	*size = len;
+	return buf;
+}
+
+/* walk the calibration table at offset and extract the requested entries
+   that were not found yet, returns the number of those still missing */
+static int extract(const unsigned char *buf, size_t size, size_t offset)
 {
 	struct cal_entry cal = { .len = 0 };
-	FILE *in = stdin;
+	size_t pos = offset;
+	int i, missing = 0;
+
+	for (i = 0; i < n_req; i++)
+		if (!req[i].data)
+			missing++;
+
+	while (missing) {
+		pos += be16toh(cal.len);
+		if (pos + sizeof(cal) > size)
+			break;
+
+		memcpy(&cal, buf + pos, sizeof(cal));
+		pos += sizeof(cal);
+
+		/* end of the filesystem */
+		if (cal.id == 0xffff)
+			break;
+
+		for (i = 0; i < n_req; i++) {
+			int ret;
+
+			if (req[i].data || req[i].id != cal.id)
+				continue;
+
+			ret = inf(buf + pos, size - pos, &req[i]);
+			if (ret == Z_OK)
+				missing--;
+			else
+				zerr(ret);
+		}
+	}
+
+	return missing;
+}
+
+static int write_output(struct cal_request *r)
+{
 	FILE *out = stdout;
-	size_t limit = 0, skip = 0;
-	int initial_offset = 0;
-	int entry = -1;
-	int ret;
-	int opt;
+	int ret = 0;
+
+	if (r->output) {
+		out = fopen(r->output, "w");
+		if (!out) {
+			perror("Failed to create output file");
+			return -1;
+		}
+	}
+
+	if (fwrite(r->data, r->len, 1, out) != 1 && r->len) {
+		fputs("error writing output\n", stderr);
+		ret = -1;
+	}
+
+	if (out != stdout && fclose(out))
+		ret = -1;
+
+	return ret;
+}
+
+int main(int argc, char **argv)
+{
+	size_t offset[MAX_OFFSETS] = {}, size;
+	unsigned char *buf;
+	int n_offset = 0;
+	int missing;
+	int ret = EXIT_SUCCESS;
+	int opt, i, j;
 
 	while ((opt = getopt(argc, argv, "s:e:o:l:i:")) != -1) {
 		switch (opt) {
 		case 's':
-			initial_offset = (int)get_num(optarg);
+			if (n_offset == MAX_OFFSETS) {
+				fprintf(stderr, "Too many seek offsets\n");
+				return EXIT_FAILURE;
+			}
+			offset[n_offset++] = get_num(optarg);
 			if (errno) {
 				perror("Failed to parse seek offset");
-				goto out_bad;
+				return EXIT_FAILURE;
 			}
 			break;
 		case 'e':
-			entry = (int) htobe16(get_num(optarg));
+			if (n_req == MAX_ENTRIES) {
+				fprintf(stderr, "Too many entry ids\n");
+				return EXIT_FAILURE;
+			}
+			req[n_req++].id = htobe16(get_num(optarg));
 			if (errno) {
 				perror("Failed to entry id");
-				goto out_bad;
+				return EXIT_FAILURE;
 			}
 			break;
 		case 'o':
-			out = fopen(optarg, "w");
-			if (!out) {
-				perror("Failed to create output file");
-				goto out_bad;
+			if (n_out == MAX_ENTRIES) {
+				fprintf(stderr, "Too many output files\n");
+				return EXIT_FAILURE;
 			}
+			req[n_out++].output = optarg;
 			break;
 		case 'l':
 			limit = (size_t)get_num(optarg);
 			if (errno) {
 				perror("Failed to parse limit");
-				goto out_bad;
+				return EXIT_FAILURE;
 			}
 			break;
 		case 'i':
 			skip = (size_t)get_num(optarg);
 			if (errno) {
 				perror("Failed to parse skip");
-				goto out_bad;
+				return EXIT_FAILURE;
 			}
 			break;
 		default: /* '?' */
@@ -204,58 +323,56 @@ int main(int argc, char **argv)
 		}
 	}
 
-	if (entry == -1)
+	if (!n_req || n_out > n_req)
 		usage();
 
-	if (argc > 1 && optind <= argc) {
-		in = fopen(argv[optind], "r");
-		if (!in) {
-			perror("Failed to open input file");
-			goto out_bad;
-		}
-	}
+	if (!n_offset)
+		n_offset = 1;
 
-	if (initial_offset) {
-		ret = fseek(in, initial_offset, SEEK_CUR);
-		if (ret) {
-			perror("Failed to seek to calibration table");
-			goto out_bad;
-		}
-	}
+	missing = n_req;
+	for (i = optind; missing && i <= argc; i++) {
+		FILE *in = stdin;
 
-	do {
-		ret = fseek(in, be16toh(cal.len), SEEK_CUR);
-		if (feof(in)) {
-			fprintf(stderr, "Reached end of file, but didn't find the matching entry\n");
-			goto out_bad;
-		} else if (ferror(in)) {
-			perror("Failure during seek");
-			goto out_bad;
+		if (i == argc) {
+			if (optind < argc)
+				break;
+		} else {
+			in = fopen(argv[i], "r");
+			if (!in) {
+				perror("Failed to open input file");
+				continue;
+			}
 		}
 
-		ret = fread(&cal, 1, sizeof cal, in);
-		if (ret != sizeof cal)
-			goto out_bad;
-	} while (entry != cal.id || cal.id == 0xffff);
+		buf = read_input(in, &size);
+		if (in != stdin)
+			fclose(in);
+		if (!buf)
+			continue;
 
-	if (cal.id == 0xffff) {
-		fprintf(stderr, "Reached end of filesystem, but didn't find the matching entry\n");
-		goto out_bad;
-	}
+		for (j = 0; missing && j < n_offset; j++) {
+			if (offset[j] >= size) {
+				fprintf(stderr, "Failed to seek to calibration table\n");
+				continue;
+			}
+			missing = extract(buf, size, offset[j]);
+		}
 
-	ret = inf(in, out, limit, skip);
-	if (ret == Z_OK)
-		goto out;
+		free(buf);
+	}
 
-	zerr(ret);
+	for (i = 0; i < n_req; i++) {
+		if (!req[i].data) {
+			fprintf(stderr, "Didn't find the matching entry 0x%x\n",
+				be16toh(req[i].id));
+			ret = EXIT_FAILURE;
+			continue;
+		}
 
-out_bad:
-	ret = EXIT_FAILURE;
+		if (write_output(&req[i]))
+			ret = EXIT_FAILURE;
+		free(req[i].data);
+	}
 
-out:
-	if (in)
-		fclose(in);
-	if (out)
-		fclose(out);
 	return ret;
 }
@@ -45,6 +45,7 @@
 #include <arpa/inet.h>
 #include <mtd/mtd-user.h>
 #include <assert.h>
+#include <limits.h>
 
 #define DEFAULT_TFFS_SIZE	(256 * 1024)
 
@@ -62,9 +63,20 @@
 
 #define TFFS_SEGMENT_CLEARED 0xffffffff
 
+#define TFFS_INDEX_DIR		"/tmp"
+#define TFFS_INDEX_MAGIC	0x54464958	/* TFIX */
+#define TFFS_INDEX_VERSION	1
+#define TFFS_INDEX_FLAG_OOB	0x1
+#define TFFS_INDEX_FLAG_SWAP	0x2
+
+#define MAX_NAME_FILTERS	16
+
 static char *progname;
 static char *mtddev;
 static char *name_filter = NULL;
+static char *name_filters[MAX_NAME_FILTERS];
+static int num_name_filters;
+static bool use_index = true;
 static bool show_all = false;
 static bool print_all_key_names = false;
 static bool read_oob_sector_health = false;
@@ -72,6 +84,7 @@ static bool swap_bytes = false;
 static uint8_t readbuf[TFFS_SECTOR_SIZE];
 static uint8_t oobbuf[TFFS_SECTOR_OOB_SIZE];
 static uint32_t blocksize;
+static uint32_t mtdsize;
 static int mtdfd;
 static uint32_t num_sectors;
 static uint8_t *sectors;
@@ -107,6 +120,19 @@ struct tffs_key_name_table {
 	struct tffs_name_table_entry *entries;
 };
 
+/*
+ * Cached result of the sector scan, followed by the sector health bitmap
+ * and the id of every sector seen while looking up the name table.
+ */
+struct tffs_index_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t size;
+	uint32_t erasesize;
+	uint32_t flags;
+	uint32_t block_crc;
+};
+
 static inline uint8_t read_uint8(void *buf, ptrdiff_t off)
 {
 	return *(uint8_t *)(buf + off);
@@ -372,6 +398,39 @@ static int show_matching_key_value(struct tffs_key_name_table *key_names)
 	return EXIT_FAILURE;
 }
 
+static int show_matching_key_value_pairs(struct tffs_key_name_table *key_names)
+{
+	struct tffs_entry tmp;
+	int ret = EXIT_SUCCESS;
+	uint32_t i;
+
+	for (int n = 0; n < num_name_filters; n++) {
+		for (i = 0; i < key_names->size; i++) {
+			if (!strcmp(key_names->entries[i].val, name_filters[n]))
+				break;
+		}
+
+		if (i == key_names->size) {
+			fprintf(stderr, "ERROR: Unknown key name %s!\n", name_filters[n]);
+			ret = EXIT_FAILURE;
+			continue;
+		}
+
+		if (!find_entry(key_names->entries[i].id, &tmp)) {
+			fprintf(stderr, "ERROR: no value found for name %s!\n", name_filters[n]);
+			ret = EXIT_FAILURE;
+			continue;
+		}
+
+		printf("%s=", name_filters[n]);
+		print_entry_value(&tmp);
+		printf("\n");
+		free(tmp.val);
+	}
+
+	return ret;
+}
+
 static int check_sector(off_t pos)
 {
 	if (!read_oob_sector_health) {
@@ -417,7 +476,7 @@ static int check_block(off_t pos, uint32_t sector)
 	return 1;
 }
 
-static int scan_mtd(void)
+static int init_mtd(void)
 {
 	struct mtd_info_user info;
 
@@ -426,6 +485,7 @@ static int scan_mtd(void)
 	}
 
 	blocksize = info.erasesize;
+	mtdsize = info.size;
 
 	num_sectors = info.size / TFFS_SECTOR_SIZE;
 	sectors = malloc((num_sectors + 7) / 8);
@@ -436,10 +496,15 @@ static int scan_mtd(void)
 	}
 	memset(sectors, 0xff, (num_sectors + 7) / 8);
 
+	return 1;
+}
+
+static int scan_mtd(void)
+{
 	uint32_t sector = 0, valid_blocks = 0;
 	uint8_t block_ok = 0;
-	for (off_t pos = 0; pos < info.size; sector++, pos += TFFS_SECTOR_SIZE) {
-		if (pos % info.erasesize == 0) {
+	for (off_t pos = 0; pos < mtdsize; sector++, pos += TFFS_SECTOR_SIZE) {
+		if (pos % blocksize == 0) {
 			block_ok = check_block(pos, sector);
 			/* first sector of the block contains metadata
 			   => handle it like a bad sector */
@@ -455,6 +520,115 @@ static int scan_mtd(void)
 	return valid_blocks;
 }
 
+static uint32_t crc32(uint32_t crc, const uint8_t *buf, size_t len)
+{
+	while (len--) {
+		crc ^= *buf++;
+		for (int i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ (0xedb88320 & -(crc & 1));
+	}
+
+	return crc;
+}
+
+/*
+ * TFFS isn't written while OpenWrt is running and /tmp doesn't survive a
+ * reboot, so checksumming all block headers is enough to tell whether the
+ * index belongs to the flash contents.
+ */
+static uint32_t block_headers_crc(void)
+{
+	uint32_t crc = 0xffffffff;
+
+	for (off_t pos = 0; pos < mtdsize; pos += blocksize) {
+		if (pread(mtdfd, readbuf, TFFS_SECTOR_SIZE, pos) != TFFS_SECTOR_SIZE)
+			memset(readbuf, 0, TFFS_SECTOR_SIZE);
+		crc = crc32(crc, readbuf, TFFS_SECTOR_SIZE);
+	}
+
+	return ~crc;
+}
+
+static void index_path(char *path, size_t len)
+{
+	const char *name = strrchr(mtddev, '/');
+
+	name = name ? name + 1 : mtddev;
+	snprintf(path, len, "%s/fritz_tffs_nand.%s.idx", TFFS_INDEX_DIR, name);
+}
+
+static void index_header_init(struct tffs_index_header *hdr)
+{
+	memset(hdr, 0, sizeof(*hdr));
+	hdr->magic = TFFS_INDEX_MAGIC;
+	hdr->version = TFFS_INDEX_VERSION;
+	hdr->size = mtdsize;
+	hdr->erasesize = blocksize;
+	hdr->flags = (read_oob_sector_health ? TFFS_INDEX_FLAG_OOB : 0) |
+		     (swap_bytes ? TFFS_INDEX_FLAG_SWAP : 0);
+	hdr->block_crc = block_headers_crc();
+}
+
+static int load_index(void)
+{
+	struct tffs_index_header hdr, cur;
+	char path[PATH_MAX];
+	FILE *fp;
+	int ret = 0;
+
+	index_path(path, sizeof(path));
+	fp = fopen(path, "r");
+	if (!fp)
+		return 0;
+
+	if (fread(&hdr, sizeof(hdr), 1, fp) != 1)
+		goto out;
+
+	index_header_init(&cur);
+	if (memcmp(&hdr, &cur, sizeof(hdr)))
+		goto out;
+
+	if (fread(sectors, (num_sectors + 7) / 8, 1, fp) != 1 ||
+	    fread(sector_ids, sizeof(uint32_t), num_sectors, fp) != num_sectors) {
+		/* don't trust a partially loaded index */
+		memset(sectors, 0xff, (num_sectors + 7) / 8);
+		memset(sector_ids, 0, num_sectors * sizeof(uint32_t));
+		goto out;
+	}
+
+	ret = 1;
+out:
+	fclose(fp);
+	return ret;
+}
+
+static void save_index(void)
+{
+	struct tffs_index_header hdr;
+	char path[PATH_MAX];
+	char tmp[PATH_MAX + 16];
+	FILE *fp;
+
+	index_path(path, sizeof(path));
+	snprintf(tmp, sizeof(tmp), "%s.%d", path, getpid());
+
+	fp = fopen(tmp, "w");
+	if (!fp)
+		return;
+
+	index_header_init(&hdr);
+	if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1 ||
+	    fwrite(sectors, (num_sectors + 7) / 8, 1, fp) != 1 ||
+	    fwrite(sector_ids, sizeof(uint32_t), num_sectors, fp) != num_sectors) {
+		fclose(fp);
+		unlink(tmp);
+		return;
+	}
+
+	if (fclose(fp) || rename(tmp, path))
+		unlink(tmp);
+}
+
 static void usage(int status)
 {
 	FILE *stream = (status != EXIT_SUCCESS) ? stderr : stdout;
@@ -467,8 +641,10 @@ static void usage(int status)
 	"  -d <mtd>        inspect the TFFS on mtd device <mtd>\n"
 	"  -h              show this screen\n"
 	"  -l              list all supported keys\n"
-	"  -n <key name>   display the value of the given key\n"
+	"  -n <key name>   display the value of the given key, may be given\n"
+	"                  multiple times to display name=value pairs\n"
 	"  -o              read OOB information about sector health\n"
+	"  -x              don't use the sector index cached in " TFFS_INDEX_DIR "\n"
 	);
 
 	exit(status);
@@ -479,7 +655,7 @@ static void parse_options(int argc, char *argv[])
 	while (1) {
 		int c;
 
-		c = getopt(argc, argv, "abd:hln:o");
+		c = getopt(argc, argv, "abd:hln:ox");
 		if (c == -1)
 			break;
 
@@ -487,6 +663,7 @@ static void parse_options(int argc, char *argv[])
 		case 'a':
 			show_all = true;
 			name_filter = NULL;
+			num_name_filters = 0;
 			print_all_key_names = false;
 			break;
 		case 'b':
@@ -502,8 +679,14 @@ static void parse_options(int argc, char *argv[])
 			print_all_key_names = true;
 			show_all = false;
 			name_filter = NULL;
+			num_name_filters = 0;
 			break;
 		case 'n':
+			if (num_name_filters == MAX_NAME_FILTERS) {
+				fprintf(stderr, "ERROR: too many key names given!\n");
+				usage(EXIT_FAILURE);
+			}
+			name_filters[num_name_filters++] = optarg;
 			name_filter = optarg;
 			show_all = false;
 			print_all_key_names = false;
@@ -511,6 +694,9 @@ static void parse_options(int argc, char *argv[])
 		case 'o':
 			read_oob_sector_health = true;
 			break;
+		case 'x':
+			use_index = false;
+			break;
 		default:
 			usage(EXIT_FAILURE);
 			break;
@@ -534,6 +720,7 @@ int main(int argc, char *argv[])
 	int ret = EXIT_FAILURE;
 	struct tffs_entry name_table;
 	struct tffs_key_name_table key_names;
+	bool indexed = false;
 
 	progname = basename(argv[0]);
 
@@ -546,10 +733,18 @@ int main(int argc, char *argv[])
 		goto out;
 	}
 
-	if (!scan_mtd()) {
+	if (!init_mtd()) {
+		fprintf(stderr, "ERROR: Failed to get info about tffs device %s\n", mtddev);
+		goto out_close;
+	}
+
+	if (use_index)
+		indexed = load_index();
+
+	if (!indexed && !scan_mtd()) {
 		fprintf(stderr, "ERROR: Parsing blocks from tffs device %s failed\n", mtddev);
 		fprintf(stderr, "       Is byte-swapping (-b) required?\n");
-		goto out_close;
+		goto out_free_sectors;
 	}
 
 	if (!find_entry(TFFS_ID_TABLE_NAME, &name_table)) {
@@ -558,6 +753,10 @@ int main(int argc, char *argv[])
 		goto out_free_sectors;
 	}
 
+	/* looking up the name table visited every sector, remember their ids */
+	if (use_index && !indexed)
+		save_index();
+
 	parse_key_names(&name_table, &key_names);
 	if (key_names.size < 1) {
 		fprintf(stderr, "ERROR: No name table found on tffs device %s\n",
@@ -570,6 +769,8 @@ int main(int argc, char *argv[])
 		ret = EXIT_SUCCESS;
 	} else if (show_all) {
 		ret = show_all_key_value_pairs(&key_names);
+	} else if (num_name_filters > 1) {
+		ret = show_matching_key_value_pairs(&key_names);
 	} else {
 		ret = show_matching_key_value(&key_names);
 	}
@@ -24,6 +24,8 @@
 
 #include "nvram.h"
 
+/* Number of variables actually modified */
+static int changed = 0;
 
 static nvram_handle_t * nvram_open_rdonly(void)
 {
@@ -83,8 +85,32 @@ static int do_get(nvram_handle_t *nvram, const char *var)
 	return stat;
 }
 
+static int do_mget(nvram_handle_t *nvram, int argc, const char *argv[])
+{
+	const char *val;
+	int stat = 0;
+	int i;
+
+	/* One line per variable, an empty one if unset, to keep them aligned */
+	for( i = 0; i < argc; i++ )
+	{
+		if( (val = nvram_get(nvram, argv[i])) == NULL )
+		{
+			val = "";
+			stat = 1;
+		}
+
+		printf("%s\n", val);
+	}
+
+	return stat;
+}
+
 static int do_unset(nvram_handle_t *nvram, const char *var)
 {
+	if( nvram_get(nvram, var) != NULL )
+		changed++;
+
 	return nvram_unset(nvram, var);
 }
 
@@ -92,15 +118,53 @@ static int do_set(nvram_handle_t *nvram, const char *pair)
 {
 	char *val = strstr(pair, "=");
 	char var[strlen(pair)];
+	const char *cur;
 	int stat = 1;
 
 	if( val != NULL )
 	{
 		memset(var, 0, sizeof(var));
 		strncpy(var, pair, (int)(val-pair));
-		stat = nvram_set(nvram, var, (char *)(val + 1));
+
+		/* Don't count a value that is already set */
+		if( (cur = nvram_get(nvram, var)) != NULL && !strcmp(cur, val + 1) )
+			return 0;
+
+		if( (stat = nvram_set(nvram, var, (char *)(val + 1))) == 0 )
+			changed++;
+	}
+
+	return stat;
+}
+
+static int do_batch(nvram_handle_t *nvram)
+{
+	char *line = NULL;
+	size_t size = 0;
+	ssize_t len;
+	int stat = 0;
+
+	/* Read variable=value pairs from stdin, one per line */
+	while( (len = getline(&line, &size, stdin)) > 0 )
+	{
+		if( line[len - 1] == '\n' )
+			line[--len] = '\0';
+
+		if( !len || line[0] == '#' )
+			continue;
+
+		if( strchr(line, '=') == NULL )
+		{
+			fprintf(stderr, "Invalid batch line '%s' !\n", line);
+			stat = 1;
+			continue;
+		}
+
+		if( do_set(nvram, line) )
+			stat = 1;
 	}
 
+	free(line);
 	return stat;
 }
 
@@ -140,8 +204,10 @@ static void usage(void)
 		"	nvram show\n"
 		"	nvram info\n"
 		"	nvram get variable\n"
+		"	nvram mget variable [variable ...]\n"
 		"	nvram set variable=value [set ...]\n"
 		"	nvram unset variable [unset ...]\n"
+		"	nvram batch   (variable=value lines on stdin)\n"
 		"	nvram commit\n"
 	);
 }
@@ -150,9 +216,11 @@ int main( int argc, const char *argv[] )
 {
 	nvram_handle_t *nvram;
 	int commit = 0;
+	int staged = 0;
 	int write = 0;
 	int stat = 1;
 	int done = 0;
+	int ret;
 	int i;
 
 	if( argc < 2 ) {
@@ -163,14 +231,22 @@ int main( int argc, const char *argv[] )
 	/* Ugly... iterate over arguments to see whether we can expect a write */
 	if( ( !strcmp(argv[1], "set")  && 2 < argc ) ||
 		( !strcmp(argv[1], "unset") && 2 < argc ) ||
+		!strcmp(argv[1], "batch") ||
 		!strcmp(argv[1], "commit") )
 		write = 1;
 
+	/* Pending changes from earlier calls have to be committed as well */
+	if( write && nvram_find_staging() != NULL )
+		staged = 1;
+
 
 	nvram = write ? nvram_open_staging() : nvram_open_rdonly();
 
 	if( nvram != NULL && argc > 1 )
 	{
+		/* A lone commit succeeds, the other commands set their status */
+		stat = 0;
+
 		for( i = 1; i < argc; i++ )
 		{
 			if( !strcmp(argv[i], "show") )
@@ -183,6 +259,12 @@ int main( int argc, const char *argv[] )
 				stat = do_info(nvram);
 				done++;
 			}
+			else if( !strcmp(argv[i], "mget") && (i+1) < argc )
+			{
+				stat = do_mget(nvram, argc - i - 1, &argv[i + 1]);
+				done++;
+				break;
+			}
 			else if( !strcmp(argv[i], "get") || !strcmp(argv[i], "unset") || !strcmp(argv[i], "set") )
 			{
 				if( (i+1) < argc )
@@ -210,6 +292,11 @@ int main( int argc, const char *argv[] )
 					break;
 				}
 			}
+			else if( !strcmp(argv[i], "batch") )
+			{
+				stat = do_batch(nvram);
+				done++;
+			}
 			else if( !strcmp(argv[i], "commit") )
 			{
 				commit = 1;
@@ -223,13 +310,22 @@ int main( int argc, const char *argv[] )
 			}
 		}
 
-		if( write )
-			stat = nvram_commit(nvram);
+		/* Don't let a successful write hide a failed command */
+		if( write && changed && (ret = nvram_commit(nvram)) != 0 )
+			stat = ret;
 
 		nvram_close(nvram);
 
-		if( commit )
-			stat = staging_to_nvram();
+		/* Only touch the flash if there is something new to write */
+		if( !changed && !staged )
+		{
+			if( write )
+				unlink(NVRAM_STAGING);
+		}
+		else if( commit && (ret = staging_to_nvram()) != 0 )
+		{
+			stat = ret;
+		}
 	}
 
 	if( !nvram )
@@ -104,6 +104,7 @@ static int _nvram_rehash(nvram_handle_t *h)
 
 	/* (Re)initialize hash table */
 	_nvram_free(h);
+	h->hashed = 1;
 
 	/* Parse and set "name=value\0 ... \0\0" */
 	name = (char *) &header[1];
@@ -139,6 +140,41 @@ static int _nvram_rehash(nvram_handle_t *h)
 	return 0;
 }
 
+/* Build the hash table on first use. */
+static void _nvram_hash_once(nvram_handle_t *h)
+{
+	if (!h->hashed)
+		_nvram_rehash(h);
+}
+
+/*
+ * Look a variable up in the raw data, the last definition wins. The scan
+ * stays inside the NVRAM area given by the header, and stops at the first
+ * entry that is not terminated inside it.
+ */
+static char * _nvram_scan(nvram_handle_t *h, const char *name)
+{
+	nvram_header_t *header = nvram_header(h);
+	char *end = h->mmap + h->length;
+	char *p = (char *) &header[1];
+	char *value = NULL;
+	size_t len = strlen(name), n;
+
+	if (header->len < h->length - h->offset)
+		end = (char *) header + header->len;
+
+	for (; p < end && *p; p += n + 1) {
+		n = strnlen(p, end - p);
+		if (p + n == end)
+			break;
+
+		if (len < n && p[len] == '=' && !memcmp(p, name, len))
+			value = p + len + 1;
+	}
+
+	return value;
+}
+
 
 /*
  * -- Public functions --
@@ -160,6 +196,17 @@ char * nvram_get(nvram_handle_t *h, const char *name)
 	if (!name)
 		return NULL;
 
+	/*
+	 * Plain lookups don't need the hash table, only the SDRAM values
+	 * that are derived from the header do
+	 */
+	if (!h->hashed) {
+		if ((value = _nvram_scan(h, name)) != NULL || strncmp(name, "sdram_", 6))
+			return value;
+
+		_nvram_rehash(h);
+	}
+
 	/* Hash the name */
 	i = hash(name) % NVRAM_ARRAYSIZE(h->nvram_hash);
 
@@ -177,6 +224,8 @@ int nvram_set(nvram_handle_t *h, const char *name, const char *value)
 	uint32_t i;
 	nvram_tuple_t *t, *u, **prev;
 
+	_nvram_hash_once(h);
+
 	/* Hash the name */
 	i = hash(name) % NVRAM_ARRAYSIZE(h->nvram_hash);
 
@@ -215,6 +264,8 @@ int nvram_unset(nvram_handle_t *h, const char *name)
 	if (!name)
 		return 0;
 
+	_nvram_hash_once(h);
+
 	/* Hash the name */
 	i = hash(name) % NVRAM_ARRAYSIZE(h->nvram_hash);
 
@@ -240,6 +291,8 @@ nvram_tuple_t * nvram_getall(nvram_handle_t *h)
 
 	l = NULL;
 
+	_nvram_hash_once(h);
+
 	for (i = 0; i < NVRAM_ARRAYSIZE(h->nvram_hash); i++) {
 		for (t = h->nvram_hash[i]; t; t = t->next) {
 			if( (x = (nvram_tuple_t *) malloc(sizeof(nvram_tuple_t))) != NULL )
@@ -270,6 +323,8 @@ int nvram_commit(nvram_handle_t *h)
 	nvram_header_t tmp;
 	uint8_t crc;
 
+	_nvram_hash_once(h);
+
 	/* Regenerate header */
 	header->magic = NVRAM_MAGIC;
 	header->crc_ver_init = (NVRAM_VERSION << 8);
@@ -402,7 +457,9 @@ nvram_handle_t * nvram_open(const char *file, int rdonly)
 
 				if (header->magic == NVRAM_MAGIC &&
 				    (rdonly || header->len < h->length - h->offset)) {
-					_nvram_rehash(h);
+					/* read-only users mostly just get a few values */
+					if (rdonly != NVRAM_RO)
+						_nvram_rehash(h);
 					free(mtd);
 					return h;
 				}
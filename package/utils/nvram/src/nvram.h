@@ -50,6 +50,7 @@ struct nvram_handle {
 	unsigned int offset;
 	struct nvram_tuple *nvram_hash[257];
 	struct nvram_tuple *nvram_dead;
+	int hashed;
 };
 
 typedef struct nvram_handle nvram_handle_t;
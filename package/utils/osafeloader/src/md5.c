@@ -75,6 +75,22 @@
 	(*(MD5_u32plus *)&ptr[(n) * 4])
 #define GET(n) \
 	SET(n)
+#elif defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+/*
+ * Other little-endian architectures: let the compiler pick the best load,
+ * a single one where unaligned accesses are allowed (ARMv7, AArch64...).
+ */
+static inline MD5_u32plus md5_load(const unsigned char *p)
+{
+	MD5_u32plus v;
+
+	memcpy(&v, p, 4);
+	return v;
+}
+#define SET(n) \
+	md5_load(&ptr[(n) * 4])
+#define GET(n) \
+	SET(n)
 #else
 #define SET(n) \
 	(ctx->block[(n)] = \
@@ -11,11 +11,15 @@
 #include <byteswap.h>
 #include <endian.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "md5.h"
 
@@ -42,13 +46,20 @@ struct safeloader_header {
 	uint8_t md5[16];
 } __attribute__ ((packed));
 
-char *safeloader_path;
-char *partition_name;
-char *out_path;
+#define OSAFELOADER_MAX_PARTS	32
 
-static inline size_t osafeloader_min(size_t x, size_t y) {
-	return x < y ? x : y;
-}
+/* Partition table follows the header and vendor info */
+#define OSAFELOADER_PTN_OFFSET	(sizeof(struct safeloader_header) + 0x1000)
+
+struct osafeloader_image {
+	const uint8_t *data;
+	size_t size;
+};
+
+char *safeloader_path;
+char *partition_names[OSAFELOADER_MAX_PARTS];
+char *out_paths[OSAFELOADER_MAX_PARTS];
+int num_parts;
 
 static const uint8_t md5_salt[16] = {
 	0x7a, 0x2b, 0x15, 0xed,
@@ -57,16 +68,62 @@ static const uint8_t md5_salt[16] = {
 	0xac, 0x2a, 0x9f, 0x4e,
 };
 
+/**************************************************
+ * Image
+ **************************************************/
+
+/* Map the whole image, it's only read from memory afterwards */
+static int osafeloader_open(struct osafeloader_image *img) {
+	struct stat st;
+	void *data;
+	int fd;
+
+	fd = open(safeloader_path, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "Couldn't open %s\n", safeloader_path);
+		return -EACCES;
+	}
+
+	if (fstat(fd, &st) || st.st_size < OSAFELOADER_PTN_OFFSET) {
+		fprintf(stderr, "Couldn't read %s header\n", safeloader_path);
+		close(fd);
+		return -EIO;
+	}
+
+	data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		fprintf(stderr, "Couldn't map %s\n", safeloader_path);
+		return -EIO;
+	}
+	madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+	img->data = data;
+	img->size = st.st_size;
+
+	return 0;
+}
+
+static void osafeloader_close(struct osafeloader_image *img) {
+	munmap((void *)img->data, img->size);
+}
+
+/* The partition table is text, terminated by anything not matching */
+static FILE *osafeloader_ptn_open(struct osafeloader_image *img) {
+	return fmemopen((void *)(img->data + OSAFELOADER_PTN_OFFSET),
+			img->size - OSAFELOADER_PTN_OFFSET, "r");
+}
+
 /**************************************************
  * Info
  **************************************************/
 
 static int osafeloader_info(int argc, char **argv) {
-	FILE *safeloader;
-	struct safeloader_header hdr;
+	struct osafeloader_image img;
+	const struct safeloader_header *hdr;
+	FILE *ptn;
 	MD5_CTX ctx;
-	size_t bytes, imagesize;
-	uint8_t buf[1024];
+	size_t imagesize;
 	uint8_t md5[16];
 	char name[32];
 	int base, size, i;
@@ -79,50 +136,45 @@ static int osafeloader_info(int argc, char **argv) {
 	}
 	safeloader_path = argv[2];
 
-	safeloader = fopen(safeloader_path, "r");
-	if (!safeloader) {
-		fprintf(stderr, "Couldn't open %s\n", safeloader_path);
-		err = -EACCES;
+	err = osafeloader_open(&img);
+	if (err)
 		goto out;
-	}
 
-	bytes = fread(&hdr, 1, sizeof(hdr), safeloader);
-	if (bytes != sizeof(hdr)) {
-		fprintf(stderr, "Couldn't read %s header\n", safeloader_path);
-		err =  -EIO;
-		goto err_close;
-	}
-	imagesize = be32_to_cpu(hdr.imagesize);
+	hdr = (const struct safeloader_header *)img.data;
+	imagesize = be32_to_cpu(hdr->imagesize);
+	if (imagesize > img.size - sizeof(*hdr))
+		imagesize = img.size - sizeof(*hdr);
 
 	MD5_Init(&ctx);
 	MD5_Update(&ctx, md5_salt, sizeof(md5_salt));
-	while ((bytes = fread(buf, 1, osafeloader_min(sizeof(buf), imagesize), safeloader)) > 0) {
-		MD5_Update(&ctx, buf, bytes);
-		imagesize -= bytes;
-	}
+	MD5_Update(&ctx, img.data + sizeof(*hdr), imagesize);
 	MD5_Final(md5, &ctx);
 
-	if (memcmp(md5, hdr.md5, 16)) {
+	if (memcmp(md5, hdr->md5, 16)) {
 		fprintf(stderr, "Broken SafeLoader file with invalid MD5\n");
 		err =  -EIO;
 		goto err_close;
 	}
 
-	printf("%10s: %d\n", "Image size", be32_to_cpu(hdr.imagesize));
+	printf("%10s: %d\n", "Image size", be32_to_cpu(hdr->imagesize));
 	printf("%10s: ", "MD5");
 	for (i = 0; i < 16; i++)
 		printf("%02x", md5[i]);
 	printf("\n");
 
-	/* Skip header & vendor info */
-	fseek(safeloader, 0x1014, SEEK_SET);
+	ptn = osafeloader_ptn_open(&img);
+	if (!ptn) {
+		err = -ENOMEM;
+		goto err_close;
+	}
 
-	while (fscanf(safeloader, "fwup-ptn %s base 0x%x size 0x%x\t\r\n", name, &base, &size) == 3) {
+	while (fscanf(ptn, "fwup-ptn %31s base 0x%x size 0x%x\t\r\n", name, &base, &size) == 3) {
 		printf("%10s: %s (0x%x - 0x%x)\n", "Partition", name, base, base + size);
 	}
+	fclose(ptn);
 
 err_close:
-	fclose(safeloader);
+	osafeloader_close(&img);
 out:
 	return err;
 }
@@ -131,29 +183,82 @@ out:
  * Extract
  **************************************************/
 
-static void osafeloader_extract_parse_options(int argc, char **argv) {
+static int osafeloader_extract_parse_options(int argc, char **argv) {
 	int c;
 
 	while ((c = getopt(argc, argv, "p:o:")) != -1) {
 		switch (c) {
 		case 'p':
-			partition_name = optarg;
+			if (num_parts == OSAFELOADER_MAX_PARTS) {
+				fprintf(stderr, "Too many partitions specified\n");
+				return -EINVAL;
+			} else if (partition_names[num_parts]) {
+				fprintf(stderr, "No output file specified for %s\n",
+					partition_names[num_parts]);
+				return -EINVAL;
+			}
+			partition_names[num_parts] = optarg;
 			break;
 		case 'o':
-			out_path = optarg;
+			if (!partition_names[num_parts]) {
+				fprintf(stderr, "No partition name specified\n");
+				return -EINVAL;
+			}
+			out_paths[num_parts++] = optarg;
 			break;
 		}
 	}
+
+	if (num_parts < OSAFELOADER_MAX_PARTS && partition_names[num_parts]) {
+		fprintf(stderr, "No output file specified\n");
+		return -EINVAL;
+	} else if (!num_parts) {
+		fprintf(stderr, "No partition name specified\n");
+		return -EINVAL;
+	}
+
+	return 0;
 }
 
-static int osafeloader_extract(int argc, char **argv) {
-	FILE *safeloader;
+static int osafeloader_extract_one(struct osafeloader_image *img, int i,
+				   unsigned int base, unsigned int size) {
+	size_t offset = OSAFELOADER_PTN_OFFSET + base;
+	size_t avail = offset < img->size ? img->size - offset : 0;
+	size_t bytes = size < avail ? size : avail;
 	FILE *out;
-	struct safeloader_header hdr;
-	size_t bytes;
+	int err = 0;
+
+	out = fopen(out_paths[i], "w");
+	if (!out) {
+		fprintf(stderr, "Couldn't open %s\n", out_paths[i]);
+		return -EACCES;
+	}
+
+	if (bytes && fwrite(img->data + offset, 1, bytes, out) != bytes) {
+		fprintf(stderr, "Couldn't write %zu B to %s\n", bytes, out_paths[i]);
+		err = -EIO;
+	} else if (bytes != size) {
+		fprintf(stderr, "Couldn't extract whole partition %s from %s (%zu B left)\n",
+			partition_names[i], safeloader_path, size - bytes);
+		err = -EIO;
+	}
+
+	if (fclose(out) && !err) {
+		fprintf(stderr, "Couldn't write %s\n", out_paths[i]);
+		err = -EIO;
+	}
+
+	return err;
+}
+
+static int osafeloader_extract(int argc, char **argv) {
+	struct osafeloader_image img;
+	bool found[OSAFELOADER_MAX_PARTS] = { };
+	FILE *ptn;
 	char name[32];
-	int base, size;
+	unsigned int base, size;
 	int err = 0;
+	int i;
 
 	if (argc < 3) {
 		fprintf(stderr, "No SafeLoader file passed\n");
@@ -163,73 +268,42 @@ static int osafeloader_extract(int argc, char **argv) {
 	safeloader_path = argv[2];
 
 	optind = 3;
-	osafeloader_extract_parse_options(argc, argv);
-	if (!partition_name) {
-		fprintf(stderr, "No partition name specified\n");
-		err = -EINVAL;
+	err = osafeloader_extract_parse_options(argc, argv);
+	if (err)
 		goto out;
-	} else if (!out_path) {
-		fprintf(stderr, "No output file specified\n");
-		err = -EINVAL;
-		goto out;
-	}
 
-	safeloader = fopen(safeloader_path, "r");
-	if (!safeloader) {
-		fprintf(stderr, "Couldn't open %s\n", safeloader_path);
-		err = -EACCES;
+	err = osafeloader_open(&img);
+	if (err)
 		goto out;
-	}
 
-	out = fopen(out_path, "w");
-	if (!out) {
-		fprintf(stderr, "Couldn't open %s\n", out_path);
-		err = -EACCES;
-		goto err_close_safeloader;
-	}
-
-	bytes = fread(&hdr, 1, sizeof(hdr), safeloader);
-	if (bytes != sizeof(hdr)) {
-		fprintf(stderr, "Couldn't read %s header\n", safeloader_path);
-		err =  -EIO;
-		goto err_close_out;
+	ptn = osafeloader_ptn_open(&img);
+	if (!ptn) {
+		err = -ENOMEM;
+		goto err_close;
 	}
 
-	/* Skip vendor info */
-	fseek(safeloader, 0x1000, SEEK_CUR);
-
-	err = -ENOENT;
-	while (fscanf(safeloader, "fwup-ptn %s base 0x%x size 0x%x\t\r\n", name, &base, &size) == 3) {
-		uint8_t buf[1024];
-
-		if (strcmp(name, partition_name))
-			continue;
-
-		err = 0;
-
-		fseek(safeloader, sizeof(hdr) + 0x1000 + base, SEEK_SET);
+	/* One walk over the table for all requested partitions */
+	while (!err && fscanf(ptn, "fwup-ptn %31s base 0x%x size 0x%x\t\r\n", name, &base, &size) == 3) {
+		for (i = 0; i < num_parts && !err; i++) {
+			if (found[i] || strcmp(name, partition_names[i]))
+				continue;
 
-		while ((bytes = fread(buf, 1, osafeloader_min(sizeof(buf), size), safeloader)) > 0) {
-			if (fwrite(buf, 1, bytes, out) != bytes) {
-				fprintf(stderr, "Couldn't write %zu B to %s\n", bytes, out_path);
-				err = -EIO;
-				break;
-			}
-			size -= bytes;
+			found[i] = true;
+			err = osafeloader_extract_one(&img, i, base, size);
 		}
+	}
+	fclose(ptn);
 
-		if (size) {
-			fprintf(stderr, "Couldn't extract whole partition %s from %s (%d B left)\n", partition_name, safeloader_path, size);
-			err = -EIO;
+	for (i = 0; i < num_parts && !err; i++) {
+		if (!found[i]) {
+			fprintf(stderr, "Couldn't find partition %s in %s\n",
+				partition_names[i], safeloader_path);
+			err = -ENOENT;
 		}
-
-		break;
 	}
 
-err_close_out:
-	fclose(out);
-err_close_safeloader:
-	fclose(safeloader);
+err_close:
+	osafeloader_close(&img);
 out:
 	return err;
 }
@@ -248,6 +322,8 @@ static void usage() {
 	printf("\tosafeloader extract <file> [options]\n");
 	printf("\t-p name\t\t\t\tname of partition to extract\n");
 	printf("\t-o file\t\t\t\toutput file\n");
+	printf("\t\t\t\t\t(-p and -o may be repeated to extract\n");
+	printf("\t\t\t\t\tmore partitions at once)\n");
 }
 
 int main(int argc, char **argv) {
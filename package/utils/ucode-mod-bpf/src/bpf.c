@@ -1,7 +1,9 @@
 #include <sys/resource.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <net/if.h>
+#include <linux/if_link.h>
 
 #include <stdint.h>
 #include <stdio.h>
@@ -18,6 +20,7 @@
 #define TRUE ucv_boolean_new(true)
 
 static uc_resource_type_t *module_type, *map_type, *map_iter_type, *program_type;
+static uc_resource_type_t *map_mmap_type, *ringbuf_type;
 static uc_value_t *registry;
 static uc_vm_t *debug_vm;
 
@@ -34,6 +37,8 @@ struct uc_bpf_fd {
 struct uc_bpf_map {
 	struct uc_bpf_fd fd; /* must be first */
 	unsigned int key_size, val_size;
+	/* per-CPU maps: val_size covers the values of all CPUs */
+	unsigned int cpu_val_size, ncpus;
 };
 
 struct uc_bpf_map_iter {
@@ -43,6 +48,19 @@ struct uc_bpf_map_iter {
 	uint8_t key[];
 };
 
+struct uc_bpf_map_mmap {
+	void *data;
+	size_t size;
+	unsigned int val_size, elem_size, max_entries;
+	bool writable;
+};
+
+struct uc_bpf_ringbuf {
+	struct ring_buffer *rb;
+	uc_vm_t *vm;
+	uc_value_t *cb;
+};
+
 __attribute__((format(printf, 2, 3))) static void
 set_error(int errcode, const char *fmt, ...)
 {
@@ -187,10 +205,26 @@ uc_bpf_open_module(uc_vm_t *vm, size_t nargs)
 	return uc_resource_new(module_type, obj);
 }
 
+static bool
+uc_bpf_map_type_percpu(unsigned int type)
+{
+	switch (type) {
+	case BPF_MAP_TYPE_PERCPU_HASH:
+	case BPF_MAP_TYPE_PERCPU_ARRAY:
+	case BPF_MAP_TYPE_LRU_PERCPU_HASH:
+	case BPF_MAP_TYPE_PERCPU_CGROUP_STORAGE:
+		return true;
+	default:
+		return false;
+	}
+}
+
 static uc_value_t *
-uc_bpf_map_create(int fd, unsigned int key_size, unsigned int val_size, bool close)
+uc_bpf_map_create(int fd, unsigned int type, unsigned int key_size,
+		  unsigned int val_size, bool close)
 {
 	struct uc_bpf_map *uc_map;
+	int ncpus;
 
 	uc_map = xalloc(sizeof(*uc_map));
 	uc_map->fd.fd = fd;
@@ -198,6 +232,14 @@ uc_bpf_map_create(int fd, unsigned int key_size, unsigned int val_size, bool clo
 	uc_map->val_size = val_size;
 	uc_map->fd.close = close;
 
+	/* lookups of per-CPU maps return one 8 byte aligned value per CPU */
+	ncpus = libbpf_num_possible_cpus();
+	if (uc_bpf_map_type_percpu(type) && ncpus > 0) {
+		uc_map->cpu_val_size = val_size;
+		uc_map->ncpus = ncpus;
+		uc_map->val_size = ((val_size + 7) & ~7) * ncpus;
+	}
+
 	return uc_resource_new(map_type, uc_map);
 }
 
@@ -223,7 +265,7 @@ uc_bpf_open_map(uc_vm_t *vm, size_t nargs)
 		err_return(errno, NULL);
 	}
 
-	return uc_bpf_map_create(fd, info.key_size, info.value_size, true);
+	return uc_bpf_map_create(fd, info.type, info.key_size, info.value_size, true);
 }
 
 static uc_value_t *
@@ -284,7 +326,8 @@ uc_bpf_module_get_map(uc_vm_t *vm, size_t nargs)
 	if (fd < 0)
 		err_return(EINVAL, NULL);
 
-	return uc_bpf_map_create(fd, bpf_map__key_size(map), bpf_map__value_size(map), false);
+	return uc_bpf_map_create(fd, bpf_map__type(map), bpf_map__key_size(map),
+				 bpf_map__value_size(map), false);
 }
 
 static uc_value_t *
@@ -382,6 +425,106 @@ uc_bpf_map_get(uc_vm_t *vm, size_t nargs)
 	return ucv_string_new_length(val, map->val_size);
 }
 
+static void *
+uc_bpf_map_lookup_percpu(uc_vm_t *vm, size_t nargs, struct uc_bpf_map **mapp)
+{
+	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
+	uc_value_t *a_key = uc_fn_arg(0);
+	void *key, *val;
+
+	if (!map)
+		err_return(EINVAL, NULL);
+
+	if (!map->ncpus)
+		err_return(EINVAL, "not a per-CPU map");
+
+	key = uc_bpf_map_arg(a_key, "key", map->key_size);
+	if (!key)
+		return NULL;
+
+	val = xalloc(map->val_size);
+	if (bpf_map_lookup_elem(map->fd.fd, key, val)) {
+		free(val);
+		return NULL;
+	}
+
+	*mapp = map;
+	return val;
+}
+
+static uc_value_t *
+uc_bpf_map_get_percpu(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_map *map;
+	unsigned int stride, i;
+	uc_value_t *rv;
+	uint8_t *val;
+
+	val = uc_bpf_map_lookup_percpu(vm, nargs, &map);
+	if (!val)
+		return NULL;
+
+	stride = map->val_size / map->ncpus;
+	rv = ucv_array_new(vm);
+	for (i = 0; i < map->ncpus; i++)
+		ucv_array_push(rv, ucv_string_new_length((char *)val + i * stride,
+							 map->cpu_val_size));
+	free(val);
+
+	return rv;
+}
+
+/*
+ * Sum up the values of all CPUs. Values are treated as arrays of 64 bit
+ * counters, or 32 bit counters if their size is not a multiple of 8.
+ * Values of 4 or 8 bytes are returned as integer.
+ */
+static uc_value_t *
+uc_bpf_map_get_sum(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_map *map;
+	unsigned int stride, i, j, n;
+	uc_value_t *rv = NULL;
+	uint8_t *val, *sum;
+	bool wide;
+
+	val = uc_bpf_map_lookup_percpu(vm, nargs, &map);
+	if (!val)
+		return NULL;
+
+	wide = !(map->cpu_val_size % 8);
+	if (!wide && map->cpu_val_size % 4) {
+		set_error(EINVAL, "value size is not a multiple of 4");
+		goto out;
+	}
+
+	stride = map->val_size / map->ncpus;
+	n = map->cpu_val_size / (wide ? 8 : 4);
+	sum = alloca(map->cpu_val_size);
+	memcpy(sum, val, map->cpu_val_size);
+	for (i = 1; i < map->ncpus; i++) {
+		uint8_t *cur = val + i * stride;
+
+		for (j = 0; j < n; j++) {
+			if (wide)
+				((uint64_t *)sum)[j] += ((uint64_t *)cur)[j];
+			else
+				((uint32_t *)sum)[j] += ((uint32_t *)cur)[j];
+		}
+	}
+
+	if (map->cpu_val_size == 8)
+		rv = ucv_int64_new(*(uint64_t *)sum);
+	else if (map->cpu_val_size == 4)
+		rv = ucv_int64_new(*(uint32_t *)sum);
+	else
+		rv = ucv_string_new_length((char *)sum, map->cpu_val_size);
+
+out:
+	free(val);
+	return rv;
+}
+
 static uc_value_t *
 uc_bpf_map_set(uc_vm_t *vm, size_t nargs)
 {
@@ -582,6 +725,520 @@ uc_bpf_map_foreach(uc_vm_t *vm, size_t nargs)
 	return ucv_boolean_new(ret);
 }
 
+#ifndef ENOTSUPP
+#define ENOTSUPP 524
+#endif
+
+#define UC_BPF_BATCH_SIZE	256
+
+static bool
+uc_bpf_batch_unsupported(int err)
+{
+	return err == EINVAL || err == EOPNOTSUPP || err == ENOTSUPP;
+}
+
+static void
+uc_bpf_map_dump_add(uc_vm_t *vm, uc_value_t *list, struct uc_bpf_map *map,
+		    const void *key, const void *val)
+{
+	uc_value_t *entry = ucv_array_new(vm);
+
+	ucv_array_push(entry, ucv_string_new_length(key, map->key_size));
+	ucv_array_push(entry, ucv_string_new_length(val, map->val_size));
+	ucv_array_push(list, entry);
+}
+
+/* returns 1 if the kernel or map type does not support batch lookups */
+static int
+uc_bpf_map_dump_batch(uc_vm_t *vm, struct uc_bpf_map *map, bool delete,
+		      uc_value_t *list)
+{
+	size_t tok_size = map->key_size > 8 ? map->key_size : 8;
+	unsigned int size = UC_BPF_BATCH_SIZE;
+	uint8_t *keys, *vals, *in, *out;
+	bool first = true;
+	int ret = 0;
+	int err;
+
+	keys = xalloc(size * map->key_size);
+	vals = xalloc(size * map->val_size);
+	in = xalloc(tok_size);
+	out = xalloc(tok_size);
+
+	do {
+		__u32 count = size, i;
+
+		if (delete)
+			err = bpf_map_lookup_and_delete_batch(map->fd.fd,
+					first ? NULL : in, out, keys, vals,
+					&count, NULL);
+		else
+			err = bpf_map_lookup_batch(map->fd.fd,
+					first ? NULL : in, out, keys, vals,
+					&count, NULL);
+		err = err < 0 ? errno : 0;
+
+		/* all entries of a hash bucket have to fit */
+		if (err == ENOSPC && !count) {
+			size *= 2;
+			keys = xrealloc(keys, size * map->key_size);
+			vals = xrealloc(vals, size * map->val_size);
+			err = 0;
+			continue;
+		}
+
+		if (err && err != ENOENT) {
+			if (first && uc_bpf_batch_unsupported(err)) {
+				ret = 1;
+			} else {
+				set_error(err, NULL);
+				ret = -1;
+			}
+			break;
+		}
+
+		for (i = 0; i < count; i++)
+			uc_bpf_map_dump_add(vm, list, map,
+					    keys + i * map->key_size,
+					    vals + i * map->val_size);
+
+		memcpy(in, out, tok_size);
+		first = false;
+	} while (!err);
+
+	free(keys);
+	free(vals);
+	free(in);
+	free(out);
+
+	return ret;
+}
+
+static uc_value_t *
+uc_bpf_map_dump(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
+	bool delete = ucv_is_truish(uc_fn_arg(0));
+	void *key, *next, *val;
+	uc_value_t *rv;
+	bool has_next;
+	int ret;
+
+	if (!map)
+		err_return(EINVAL, NULL);
+
+	rv = ucv_array_new(vm);
+	ret = uc_bpf_map_dump_batch(vm, map, delete, rv);
+	if (ret < 0) {
+		ucv_put(rv);
+		return NULL;
+	}
+
+	if (!ret)
+		return rv;
+
+	/* walk the map one key at a time */
+	key = alloca(map->key_size);
+	next = alloca(map->key_size);
+	val = alloca(map->val_size);
+	has_next = !bpf_map_get_next_key(map->fd.fd, NULL, next);
+	while (has_next) {
+		memcpy(key, next, map->key_size);
+		has_next = !bpf_map_get_next_key(map->fd.fd, next, next);
+
+		if (bpf_map_lookup_elem(map->fd.fd, key, val))
+			continue;
+
+		uc_bpf_map_dump_add(vm, rv, map, key, val);
+		if (delete)
+			bpf_map_delete_elem(map->fd.fd, key);
+	}
+
+	return rv;
+}
+
+static void *
+uc_bpf_map_array_arg(uc_value_t *list, const char *kind, unsigned int size,
+		     size_t len)
+{
+	uint8_t *buf, *cur;
+	size_t i;
+
+	buf = xalloc(len * size);
+	for (i = 0; i < len; i++) {
+		cur = uc_bpf_map_arg(ucv_array_get(list, i), kind, size);
+		if (!cur) {
+			free(buf);
+			return NULL;
+		}
+
+		memcpy(buf + i * size, cur, size);
+	}
+
+	return buf;
+}
+
+static uc_value_t *
+uc_bpf_map_set_batch(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
+	uc_value_t *a_keys = uc_fn_arg(0);
+	uc_value_t *a_vals = uc_fn_arg(1);
+	uc_value_t *a_flags = uc_fn_arg(2);
+	uint8_t *keys = NULL, *vals = NULL;
+	uc_value_t *rv = NULL;
+	size_t len, done = 0;
+	uint64_t flags;
+	int err;
+
+	if (!map)
+		err_return(EINVAL, NULL);
+
+	if (ucv_type(a_keys) != UC_ARRAY || ucv_type(a_vals) != UC_ARRAY)
+		err_return(EINVAL, NULL);
+
+	len = ucv_array_length(a_keys);
+	if (len != ucv_array_length(a_vals))
+		err_return(EINVAL, "number of keys and values differs");
+
+	if (!a_flags)
+		flags = BPF_ANY;
+	else if (ucv_type(a_flags) != UC_INTEGER)
+		err_return(EINVAL, "flags");
+	else
+		flags = ucv_int64_get(a_flags);
+
+	if (!len)
+		return ucv_int64_new(0);
+
+	keys = uc_bpf_map_array_arg(a_keys, "key", map->key_size, len);
+	if (!keys)
+		goto out;
+
+	vals = uc_bpf_map_array_arg(a_vals, "value", map->val_size, len);
+	if (!vals)
+		goto out;
+
+	{
+		DECLARE_LIBBPF_OPTS(bpf_map_batch_opts, opts,
+				    .elem_flags = flags);
+		__u32 count = len;
+
+		err = bpf_map_update_batch(map->fd.fd, keys, vals, &count, &opts);
+		err = err < 0 ? errno : 0;
+		done = count;
+	}
+
+	if (err && !done && uc_bpf_batch_unsupported(err)) {
+		for (err = 0; done < len; done++) {
+			if (bpf_map_update_elem(map->fd.fd,
+						keys + done * map->key_size,
+						vals + done * map->val_size,
+						flags)) {
+				err = errno;
+				break;
+			}
+		}
+	}
+
+	if (err) {
+		set_error(err, "updated %zu of %zu elements", done, len);
+		goto out;
+	}
+
+	rv = ucv_int64_new(done);
+
+out:
+	free(keys);
+	free(vals);
+	return rv;
+}
+
+static uc_value_t *
+uc_bpf_map_delete_batch(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
+	uc_value_t *a_keys = uc_fn_arg(0);
+	size_t len, pos = 0, deleted = 0;
+	bool batch = true;
+	uint8_t *keys;
+	int err;
+
+	if (!map)
+		err_return(EINVAL, NULL);
+
+	if (ucv_type(a_keys) != UC_ARRAY)
+		err_return(EINVAL, NULL);
+
+	len = ucv_array_length(a_keys);
+	if (!len)
+		return ucv_int64_new(0);
+
+	keys = uc_bpf_map_array_arg(a_keys, "key", map->key_size, len);
+	if (!keys)
+		return NULL;
+
+	while (pos < len) {
+		uint8_t *key = keys + pos * map->key_size;
+		__u32 count = len - pos;
+
+		if (batch) {
+			err = bpf_map_delete_batch(map->fd.fd, key, &count, NULL);
+			err = err < 0 ? errno : 0;
+			pos += count;
+			deleted += count;
+
+			if (err && !deleted && uc_bpf_batch_unsupported(err)) {
+				batch = false;
+				continue;
+			}
+		} else {
+			err = bpf_map_delete_elem(map->fd.fd, key) ? errno : 0;
+			if (!err)
+				deleted++;
+			pos++;
+			if (err == ENOENT)
+				continue;
+		}
+
+		/* the batch stops at the first key that does not exist */
+		if (err == ENOENT) {
+			pos++;
+			continue;
+		}
+
+		if (err) {
+			set_error(err, NULL);
+			break;
+		}
+	}
+
+	free(keys);
+
+	return ucv_int64_new(deleted);
+}
+
+static uc_value_t *
+uc_bpf_map_mmap(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
+	struct uc_bpf_map_mmap *m;
+	struct bpf_map_info info = {};
+	__u32 len = sizeof(info);
+	size_t size, page;
+	bool writable = true;
+	void *data;
+
+	if (!map)
+		err_return(EINVAL, NULL);
+
+	if (bpf_obj_get_info_by_fd(map->fd.fd, &info, &len))
+		err_return(errno, NULL);
+
+	if (info.type != BPF_MAP_TYPE_ARRAY || !(info.map_flags & BPF_F_MMAPABLE))
+		err_return(EINVAL, "map is not mmapable");
+
+	/* array values are laid out 8 byte aligned */
+	page = sysconf(_SC_PAGESIZE);
+	size = (size_t)((info.value_size + 7) & ~7) * info.max_entries;
+	size = (size + page - 1) & ~(page - 1);
+
+	data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, map->fd.fd, 0);
+	if (data == MAP_FAILED && errno == EPERM) {
+		/* frozen or read-only for user space */
+		writable = false;
+		data = mmap(NULL, size, PROT_READ, MAP_SHARED, map->fd.fd, 0);
+	}
+
+	if (data == MAP_FAILED)
+		err_return(errno, NULL);
+
+	m = xalloc(sizeof(*m));
+	m->data = data;
+	m->size = size;
+	m->val_size = info.value_size;
+	m->elem_size = (info.value_size + 7) & ~7;
+	m->max_entries = info.max_entries;
+	m->writable = writable;
+
+	return uc_resource_new(map_mmap_type, m);
+}
+
+static void *
+uc_bpf_map_mmap_elem(struct uc_bpf_map_mmap *m, uc_value_t *index)
+{
+	int64_t idx;
+
+	if (ucv_type(index) != UC_INTEGER)
+		err_return(EINVAL, "index type");
+
+	idx = ucv_int64_get(index);
+	if (idx < 0 || idx >= m->max_entries)
+		err_return(ERANGE, "index out of range");
+
+	return (uint8_t *)m->data + idx * m->elem_size;
+}
+
+static uc_value_t *
+uc_bpf_map_mmap_get(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_map_mmap *m = uc_fn_thisval("bpf.map_mmap");
+	void *val;
+
+	if (!m)
+		err_return(EINVAL, NULL);
+
+	val = uc_bpf_map_mmap_elem(m, uc_fn_arg(0));
+	if (!val)
+		return NULL;
+
+	return ucv_string_new_length(val, m->val_size);
+}
+
+static uc_value_t *
+uc_bpf_map_mmap_get_int(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_map_mmap *m = uc_fn_thisval("bpf.map_mmap");
+	void *val;
+
+	if (!m)
+		err_return(EINVAL, NULL);
+
+	val = uc_bpf_map_mmap_elem(m, uc_fn_arg(0));
+	if (!val)
+		return NULL;
+
+	if (m->val_size == 4)
+		return ucv_int64_new(*(volatile uint32_t *)val);
+	else if (m->val_size == 8)
+		return ucv_int64_new(*(volatile uint64_t *)val);
+
+	err_return(EINVAL, "value size mismatch");
+}
+
+static uc_value_t *
+uc_bpf_map_mmap_set(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_map_mmap *m = uc_fn_thisval("bpf.map_mmap");
+	void *elem, *val;
+
+	if (!m)
+		err_return(EINVAL, NULL);
+
+	if (!m->writable)
+		err_return(EPERM, NULL);
+
+	elem = uc_bpf_map_mmap_elem(m, uc_fn_arg(0));
+	if (!elem)
+		return NULL;
+
+	val = uc_bpf_map_arg(uc_fn_arg(1), "value", m->val_size);
+	if (!val)
+		return NULL;
+
+	memcpy(elem, val, m->val_size);
+
+	return TRUE;
+}
+
+static int
+uc_bpf_ringbuf_cb(void *ctx, void *data, size_t size)
+{
+	struct uc_bpf_ringbuf *r = ctx;
+	uc_vm_t *vm = r->vm;
+	uc_value_t *rv;
+	bool stop;
+
+	uc_vm_stack_push(vm, ucv_get(r->cb));
+	uc_vm_stack_push(vm, ucv_string_new_length(data, size));
+	if (uc_vm_call(vm, false, 1) != EXCEPTION_NONE)
+		return -ECANCELED;
+
+	rv = uc_vm_stack_pop(vm);
+	stop = (ucv_type(rv) == UC_BOOLEAN && !ucv_boolean_get(rv));
+	ucv_put(rv);
+
+	return stop ? -ECANCELED : 0;
+}
+
+static uc_value_t *
+uc_bpf_map_ringbuf(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_map *map = uc_fn_thisval("bpf.map");
+	uc_value_t *func = uc_fn_arg(0);
+	struct uc_bpf_ringbuf *r;
+	int err;
+
+	if (!map || !ucv_is_callable(func))
+		err_return(EINVAL, NULL);
+
+	r = xalloc(sizeof(*r));
+	r->vm = vm;
+	r->cb = ucv_get(func);
+	r->rb = ring_buffer__new(map->fd.fd, uc_bpf_ringbuf_cb, r, NULL);
+	if (!r->rb) {
+		err = errno;
+		ucv_put(r->cb);
+		free(r);
+		err_return(err, NULL);
+	}
+
+	return uc_resource_new(ringbuf_type, r);
+}
+
+static uc_value_t *
+uc_bpf_ringbuf_fileno(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_ringbuf *r = uc_fn_thisval("bpf.ringbuf");
+
+	if (!r)
+		err_return(EINVAL, NULL);
+
+	return ucv_int64_new(ring_buffer__epoll_fd(r->rb));
+}
+
+static uc_value_t *
+uc_bpf_ringbuf_result(int ret)
+{
+	/* stopped by the callback */
+	if (ret == -ECANCELED)
+		return ucv_boolean_new(false);
+
+	if (ret < 0)
+		err_return(-ret, NULL);
+
+	return ucv_int64_new(ret);
+}
+
+static uc_value_t *
+uc_bpf_ringbuf_consume(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_ringbuf *r = uc_fn_thisval("bpf.ringbuf");
+
+	if (!r)
+		err_return(EINVAL, NULL);
+
+	return uc_bpf_ringbuf_result(ring_buffer__consume(r->rb));
+}
+
+static uc_value_t *
+uc_bpf_ringbuf_poll(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_ringbuf *r = uc_fn_thisval("bpf.ringbuf");
+	uc_value_t *timeout = uc_fn_arg(0);
+	int msecs = -1;
+
+	if (!r)
+		err_return(EINVAL, NULL);
+
+	if (ucv_type(timeout) == UC_INTEGER)
+		msecs = ucv_int64_get(timeout);
+	else if (timeout)
+		err_return(EINVAL, "timeout");
+
+	return uc_bpf_ringbuf_result(ring_buffer__poll(r->rb, msecs));
+}
+
 static uc_value_t *
 uc_bpf_obj_pin(uc_vm_t *vm, size_t nargs, const char *type)
 {
@@ -674,6 +1331,73 @@ uc_bpf_program_tc_attach(uc_vm_t *vm, size_t nargs)
 	return uc_bpf_set_tc_hook(ifname, type, prio, f->fd);
 }
 
+static int
+uc_bpf_xdp_args(uc_value_t *ifname, uc_value_t *mode, int *ifindex, __u32 *flags)
+{
+	const char *mode_str;
+
+	if (ucv_type(ifname) != UC_STRING ||
+	    (mode && ucv_type(mode) != UC_STRING))
+		err_return_int(EINVAL, NULL);
+
+	*flags = 0;
+	if (mode) {
+		mode_str = ucv_string_get(mode);
+		if (!strcmp(mode_str, "native"))
+			*flags = XDP_FLAGS_DRV_MODE;
+		else if (!strcmp(mode_str, "generic"))
+			*flags = XDP_FLAGS_SKB_MODE;
+		else if (!strcmp(mode_str, "offload"))
+			*flags = XDP_FLAGS_HW_MODE;
+		else
+			err_return_int(EINVAL, "mode");
+	}
+
+	*ifindex = if_nametoindex(ucv_string_get(ifname));
+	if (!*ifindex)
+		err_return_int(ENOENT, NULL);
+
+	return 0;
+}
+
+static uc_value_t *
+uc_bpf_program_xdp_attach(uc_vm_t *vm, size_t nargs)
+{
+	struct uc_bpf_fd *f = uc_fn_thisval("bpf.program");
+	uc_value_t *ifname = uc_fn_arg(0);
+	uc_value_t *mode = uc_fn_arg(1);
+	__u32 flags;
+	int ifindex;
+
+	if (!f)
+		err_return(EINVAL, NULL);
+
+	if (uc_bpf_xdp_args(ifname, mode, &ifindex, &flags))
+		return NULL;
+
+	if (bpf_xdp_attach(ifindex, f->fd, flags, NULL) < 0)
+		err_return(errno, NULL);
+
+	return TRUE;
+}
+
+static uc_value_t *
+uc_bpf_xdp_detach(uc_vm_t *vm, size_t nargs)
+{
+	uc_value_t *ifname = uc_fn_arg(0);
+	uc_value_t *mode = uc_fn_arg(1);
+	__u32 flags;
+	int ifindex;
+
+	if (uc_bpf_xdp_args(ifname, mode, &ifindex, &flags))
+		return NULL;
+
+	if (bpf_xdp_detach(ifindex, flags, NULL) < 0)
+		err_return(errno, NULL);
+
+	return TRUE;
+}
+
 static uc_value_t *
 uc_bpf_tc_detach(uc_vm_t *vm, size_t nargs)
 {
@@ -764,11 +1488,18 @@ static void module_free(void *ptr)
 static const uc_function_list_t map_fns[] = {
 	{ "pin",			uc_bpf_map_pin },
 	{ "get",			uc_bpf_map_get },
+	{ "get_percpu",			uc_bpf_map_get_percpu },
+	{ "get_sum",			uc_bpf_map_get_sum },
 	{ "set",			uc_bpf_map_set },
 	{ "delete",			uc_bpf_map_delete },
 	{ "delete_all",			uc_bpf_map_delete_all },
 	{ "foreach",			uc_bpf_map_foreach },
 	{ "iterator",			uc_bpf_map_iterator },
+	{ "dump",			uc_bpf_map_dump },
+	{ "set_batch",			uc_bpf_map_set_batch },
+	{ "delete_batch",		uc_bpf_map_delete_batch },
+	{ "mmap",			uc_bpf_map_mmap },
+	{ "ringbuf",			uc_bpf_map_ringbuf },
 };
 
 static void uc_bpf_fd_free(void *ptr)
@@ -785,9 +1516,39 @@ static const uc_function_list_t map_iter_fns[] = {
 	{ "next_int",			uc_bpf_map_iter_next_int },
 };
 
+static const uc_function_list_t map_mmap_fns[] = {
+	{ "get",			uc_bpf_map_mmap_get },
+	{ "get_int",			uc_bpf_map_mmap_get_int },
+	{ "set",			uc_bpf_map_mmap_set },
+};
+
+static void uc_bpf_map_mmap_free(void *ptr)
+{
+	struct uc_bpf_map_mmap *m = ptr;
+
+	munmap(m->data, m->size);
+	free(m);
+}
+
+static const uc_function_list_t ringbuf_fns[] = {
+	{ "fileno",			uc_bpf_ringbuf_fileno },
+	{ "consume",			uc_bpf_ringbuf_consume },
+	{ "poll",			uc_bpf_ringbuf_poll },
+};
+
+static void uc_bpf_ringbuf_free(void *ptr)
+{
+	struct uc_bpf_ringbuf *r = ptr;
+
+	ring_buffer__free(r->rb);
+	ucv_put(r->cb);
+	free(r);
+}
+
 static const uc_function_list_t prog_fns[] = {
 	{ "pin",			uc_bpf_program_pin },
 	{ "tc_attach",			uc_bpf_program_tc_attach },
+	{ "xdp_attach",			uc_bpf_program_xdp_attach },
 };
 
 static const uc_function_list_t global_fns[] = {
@@ -797,6 +1558,7 @@ static const uc_function_list_t global_fns[] = {
 	{ "open_map",			uc_bpf_open_map },
 	{ "open_program",		uc_bpf_open_program },
 	{ "tc_detach",			uc_bpf_tc_detach },
+	{ "xdp_detach",			uc_bpf_xdp_detach },
 };
 
 void uc_module_init(uc_vm_t *vm, uc_value_t *scope)
@@ -811,4 +1573,6 @@ void uc_module_init(uc_vm_t *vm, uc_value_t *scope)
 	map_type = uc_type_declare(vm, "bpf.map", map_fns, uc_bpf_fd_free);
 	map_iter_type = uc_type_declare(vm, "bpf.map_iter", map_iter_fns, free);
 	program_type = uc_type_declare(vm, "bpf.program", prog_fns, uc_bpf_fd_free);
+	map_mmap_type = uc_type_declare(vm, "bpf.map_mmap", map_mmap_fns, uc_bpf_map_mmap_free);
+	ringbuf_type = uc_type_declare(vm, "bpf.ringbuf", ringbuf_fns, uc_bpf_ringbuf_free);
 }
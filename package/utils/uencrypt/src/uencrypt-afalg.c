@@ -0,0 +1,354 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later
+ *
+ * Kernel crypto API (AF_ALG) backend, used in place of the crypto
+ * library when the kernel has a crypto engine driver for the cipher.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <linux/if_alg.h>
+#include "uencrypt.h"
+
+#ifndef SOL_ALG
+# define SOL_ALG 279
+#endif
+
+#define AFALG_CHUNK_SIZE 16384
+#define AFALG_MAX_BLOCK_SIZE 16
+#define AFALG_MAX_IV_SIZE 16
+
+struct afalg_ctx {
+    int tfmfd;
+    int opfd;
+    int blocksize;
+    int enc;
+    int padding;
+};
+
+/*
+ * Only go through the kernel if the preferred implementation of the
+ * algorithm is not one of the generic C ones, a syscall per chunk only
+ * pays off with an engine doing the work.
+ */
+static int afalg_accelerated(const char *alg)
+{
+    char line[128], key[32], val[96];
+    char name[96] = "", driver[96] = "", best[96] = "";
+    int prio = -1, best_prio = -1;
+    int done = 0;
+    FILE *f;
+
+    f = fopen("/proc/crypto", "r");
+    if (!f)
+	return 0;
+
+    while (!done) {
+	done = !fgets(line, sizeof(line), f);
+	if (!done && sscanf(line, "%31s : %95s", key, val) == 2) {
+	    if (!strcmp(key, "name"))
+		strcpy(name, val);
+	    else if (!strcmp(key, "driver"))
+		strcpy(driver, val);
+	    else if (!strcmp(key, "priority"))
+		prio = atoi(val);
+	    continue;
+	}
+
+	/* end of an entry */
+	if (!strcmp(name, alg) && prio > best_prio) {
+	    best_prio = prio;
+	    strcpy(best, driver);
+	}
+	name[0] = driver[0] = 0;
+	prio = -1;
+    }
+    fclose(f);
+
+    return best[0] && !strstr(best, "generic") && !strstr(best, "fixed-time");
+}
+
+static int afalg_set_op(struct afalg_ctx *ctx, const unsigned char *iv,
+			int ivlen)
+{
+    union {
+	char buf[CMSG_SPACE(sizeof(uint32_t)) +
+		 CMSG_SPACE(sizeof(struct af_alg_iv) + AFALG_MAX_IV_SIZE)];
+	struct cmsghdr align;
+    } cbuf;
+    struct msghdr msg = {
+	.msg_control = cbuf.buf,
+	.msg_controllen = CMSG_SPACE(sizeof(uint32_t)),
+    };
+    struct cmsghdr *cmsg;
+    struct af_alg_iv *alg_iv;
+    uint32_t op = ctx->enc ? ALG_OP_ENCRYPT : ALG_OP_DECRYPT;
+
+    memset(&cbuf, 0, sizeof(cbuf));
+    if (ivlen)
+	msg.msg_controllen += CMSG_SPACE(sizeof(*alg_iv) + ivlen);
+
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_ALG;
+    cmsg->cmsg_type = ALG_SET_OP;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(op));
+    memcpy(CMSG_DATA(cmsg), &op, sizeof(op));
+
+    if (ivlen) {
+	cmsg = CMSG_NXTHDR(&msg, cmsg);
+	cmsg->cmsg_level = SOL_ALG;
+	cmsg->cmsg_type = ALG_SET_IV;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(*alg_iv) + ivlen);
+	alg_iv = (struct af_alg_iv *) CMSG_DATA(cmsg);
+	alg_iv->ivlen = ivlen;
+	memcpy(alg_iv->iv, iv, ivlen);
+    }
+
+    /* the data follows, the whole input is one operation */
+    return sendmsg(ctx->opfd, &msg, MSG_MORE) < 0 ? -1 : 0;
+}
+
+void afalg_free_ctx(void *vctx)
+{
+    struct afalg_ctx *ctx = vctx;
+
+    if (!ctx)
+	return;
+    if (ctx->opfd >= 0)
+	close(ctx->opfd);
+    if (ctx->tfmfd >= 0)
+	close(ctx->tfmfd);
+    free(ctx);
+}
+
+void *afalg_create_ctx(const cipher_t *cipher, const unsigned char *key,
+		       int keylen, const unsigned char *iv, int ivlen,
+		       int enc, int padding)
+{
+    struct sockaddr_alg sa = {
+	.salg_family = AF_ALG,
+	.salg_type = "skcipher",
+    };
+    struct afalg_ctx *ctx;
+    const char *alg;
+    int blocksize;
+
+    alg = get_cipher_afalg(cipher, padding, &blocksize);
+    if (!alg || blocksize > AFALG_MAX_BLOCK_SIZE ||
+	ivlen > AFALG_MAX_IV_SIZE || !afalg_accelerated(alg))
+	return NULL;
+
+    ctx = calloc(1, sizeof(*ctx));
+    if (!ctx)
+	return NULL;
+
+    ctx->opfd = -1;
+    ctx->blocksize = blocksize;
+    ctx->enc = enc;
+    ctx->padding = padding && blocksize > 1;
+    strncpy((char *) sa.salg_name, alg, sizeof(sa.salg_name) - 1);
+
+    ctx->tfmfd = socket(AF_ALG, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (ctx->tfmfd < 0 ||
+	bind(ctx->tfmfd, (struct sockaddr *) &sa, sizeof(sa)) ||
+	setsockopt(ctx->tfmfd, SOL_ALG, ALG_SET_KEY, key, keylen))
+	goto abort;
+
+    ctx->opfd = accept(ctx->tfmfd, NULL, 0);
+    if (ctx->opfd < 0 || afalg_set_op(ctx, iv, ivlen))
+	goto abort;
+
+    return ctx;
+
+abort:
+    afalg_free_ctx(ctx);
+    return NULL;
+}
+
+static int write_all(int fd, const unsigned char *buf, size_t len)
+{
+    ssize_t ret;
+
+    while (len) {
+	ret = write(fd, buf, len);
+	if (ret < 0) {
+	    if (errno == EINTR)
+		continue;
+	    return -1;
+	}
+	buf += ret;
+	len -= ret;
+    }
+    return 0;
+}
+
+/*
+ * Move the next chunk of input into the socket, through a pipe unless
+ * the input is one already. Returns the number of bytes queued, 0 at the
+ * end of the input. Fails with EINVAL before consuming any input if
+ * splice is not supported.
+ */
+static ssize_t afalg_splice_in(struct afalg_ctx *ctx, int infd, int *pfd,
+			       unsigned char *buf, int *use_splice)
+{
+    ssize_t len, ret, done = 0;
+    int src = infd;
+
+    len = AFALG_CHUNK_SIZE;
+    if (pfd[0] >= 0) {
+	len = splice(infd, NULL, pfd[1], NULL, len, 0);
+	if (len <= 0)
+	    return len;
+	src = pfd[0];
+    }
+
+    while (done < len) {
+	ret = splice(src, NULL, ctx->opfd, NULL, len - done, SPLICE_F_MORE);
+	if (ret < 0 && errno == EINVAL && src != infd) {
+	    /* no splicing into the socket, copy what is in the pipe */
+	    *use_splice = 0;
+	    ret = read(src, buf, len - done);
+	    if (ret > 0 && send(ctx->opfd, buf, ret, MSG_MORE) != ret)
+		ret = -1;
+	}
+	if (ret < 0)
+	    return -1;
+	if (ret == 0 || src == infd)
+	    return done + ret;
+	done += ret;
+    }
+    return done;
+}
+
+static ssize_t afalg_read_in(struct afalg_ctx *ctx, int infd,
+			     unsigned char *buf)
+{
+    ssize_t len;
+
+    len = read(infd, buf, AFALG_CHUNK_SIZE);
+    if (len <= 0)
+	return len;
+
+    return send(ctx->opfd, buf, len, MSG_MORE) == len ? len : -1;
+}
+
+int afalg_do_crypt(FILE *infile, FILE *outfile, void *vctx)
+{
+    struct afalg_ctx *ctx = vctx;
+    unsigned char inbuf[AFALG_CHUNK_SIZE];
+    unsigned char buf[AFALG_CHUNK_SIZE + AFALG_MAX_BLOCK_SIZE];
+    int infd = fileno(infile), outfd = fileno(outfile);
+    int bs = ctx->blocksize;
+    int hold = ctx->padding && !ctx->enc ? bs : 0;
+    size_t total = 0, pending = 0, held = 0, ready;
+    int pfd[2] = { -1, -1 };
+    int use_splice = 1, more = 1;
+    struct stat st;
+    ssize_t len;
+    int ret = EXIT_FAILURE;
+
+    if (fstat(infd, &st) || !S_ISFIFO(st.st_mode)) {
+	if (pipe(pfd))
+	    use_splice = 0;
+    }
+
+    while (more || pending) {
+	if (more) {
+	    if (use_splice) {
+		len = afalg_splice_in(ctx, infd, pfd, inbuf, &use_splice);
+		if (len < 0 && errno == EINVAL) {
+		    use_splice = 0;
+		    len = afalg_read_in(ctx, infd, inbuf);
+		}
+	    } else {
+		len = afalg_read_in(ctx, infd, inbuf);
+	    }
+	    if (len < 0) {
+		fprintf(stderr, "Error: AF_ALG read: %s\n", strerror(errno));
+		goto out;
+	    }
+
+	    total += len;
+	    pending += len;
+	}
+
+	if (more && !len) {
+	    unsigned char pad[AFALG_MAX_BLOCK_SIZE];
+	    size_t padlen = 0;
+
+	    if (!ctx->padding && bs > 1 && total % bs) {
+		fprintf(stderr, "Error: data is not a multiple of the block size.\n");
+		goto out;
+	    }
+	    if (ctx->padding && ctx->enc) {
+		padlen = bs - total % bs;
+		memset(pad, padlen, padlen);
+	    }
+	    /* a send without MSG_MORE ends the operation */
+	    if (send(ctx->opfd, pad, padlen, 0) != padlen) {
+		fprintf(stderr, "Error: AF_ALG send: %s\n", strerror(errno));
+		goto out;
+	    }
+	    pending += padlen;
+	    more = 0;
+	}
+
+	/* the kernel only processes full blocks until the last one */
+	ready = more ? pending - pending % bs : pending;
+	while (ready) {
+	    len = read(ctx->opfd, buf + held,
+		       ready < AFALG_CHUNK_SIZE ? ready : AFALG_CHUNK_SIZE);
+	    if (len <= 0) {
+		fprintf(stderr, "Error: AF_ALG %s failed: %s\n",
+			ctx->enc ? "encryption" : "decryption",
+			len ? strerror(errno) : "no data");
+		goto out;
+	    }
+	    ready -= len;
+	    pending -= len;
+	    held += len;
+
+	    /* keep the last block back to strip the padding from it */
+	    if (held <= hold)
+		continue;
+	    if (write_all(outfd, buf, held - hold)) {
+		fprintf(stderr, "Error: AF_ALG short write.\n");
+		goto out;
+	    }
+	    memmove(buf, buf + held - hold, hold);
+	    held = hold;
+	}
+    }
+
+    if (hold) {
+	unsigned char padlen = buf[bs - 1];
+
+	if (held != bs || !padlen || padlen > bs)
+	    goto bad_padding;
+	for (int i = bs - padlen; i < bs; i++)
+	    if (buf[i] != padlen)
+		goto bad_padding;
+	if (write_all(outfd, buf, bs - padlen)) {
+	    fprintf(stderr, "Error: AF_ALG short write.\n");
+	    goto out;
+	}
+    }
+    ret = 0;
+    goto out;
+
+bad_padding:
+    fprintf(stderr, "Error: bad decrypt (invalid padding).\n");
+out:
+    if (pfd[0] >= 0) {
+	close(pfd[0]);
+	close(pfd[1]);
+    }
+    return ret;
+}
@@ -59,6 +59,16 @@ static inline size_t mbedtls_cipher_info_get_block_size(
 
     return info->block_size;
 }
+
+static inline mbedtls_cipher_type_t mbedtls_cipher_info_get_type(
+    const mbedtls_cipher_info_t *info)
+{
+    if (info == NULL) {
+        return MBEDTLS_CIPHER_NONE;
+    }
+
+    return info->type;
+}
 #endif
 
 unsigned char *hexstr2buf(const char *str, long *len)
@@ -121,6 +131,33 @@ int get_cipher_keysize(const cipher_t *cipher)
     return mbedtls_cipher_info_get_key_bitlen(c) >> 3;
 }
 
+const char *get_cipher_afalg(const cipher_t *cipher, int padding,
+			     int *blocksize)
+{
+    const mbedtls_cipher_info_t *c = cipher;
+
+    switch (mbedtls_cipher_info_get_type(c)) {
+    case MBEDTLS_CIPHER_AES_128_CBC:
+    case MBEDTLS_CIPHER_AES_192_CBC:
+    case MBEDTLS_CIPHER_AES_256_CBC:
+	*blocksize = 16;
+	return "cbc(aes)";
+    /* mbedTLS only pads CBC, keep failing the same way */
+    case MBEDTLS_CIPHER_AES_128_ECB:
+    case MBEDTLS_CIPHER_AES_192_ECB:
+    case MBEDTLS_CIPHER_AES_256_ECB:
+	*blocksize = 16;
+	return padding ? NULL : "ecb(aes)";
+    case MBEDTLS_CIPHER_AES_128_CTR:
+    case MBEDTLS_CIPHER_AES_192_CTR:
+    case MBEDTLS_CIPHER_AES_256_CTR:
+	*blocksize = 1;
+	return "ctr(aes)";
+    default:
+	return NULL;
+    }
+}
+
 ctx_t *create_ctx(const cipher_t *cipher, const unsigned char *key,
 		  const unsigned char *iv, int enc, int padding)
 {
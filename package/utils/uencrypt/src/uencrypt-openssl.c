@@ -44,6 +44,36 @@ int get_cipher_keysize(const cipher_t *cipher)
     return EVP_CIPHER_key_length(cipher);
 }
 
+static const struct {
+    const EVP_CIPHER *(*cipher)(void);
+    const char *afalg;
+    int blocksize;
+} afalg_ciphers[] = {
+    { EVP_aes_128_cbc, "cbc(aes)", 16 },
+    { EVP_aes_192_cbc, "cbc(aes)", 16 },
+    { EVP_aes_256_cbc, "cbc(aes)", 16 },
+#ifndef USE_WOLFSSL
+    { EVP_aes_128_ecb, "ecb(aes)", 16 },
+    { EVP_aes_192_ecb, "ecb(aes)", 16 },
+    { EVP_aes_256_ecb, "ecb(aes)", 16 },
+    { EVP_aes_128_ctr, "ctr(aes)", 1 },
+    { EVP_aes_192_ctr, "ctr(aes)", 1 },
+    { EVP_aes_256_ctr, "ctr(aes)", 1 },
+#endif
+};
+
+const char *get_cipher_afalg(const cipher_t *cipher, int padding,
+			     int *blocksize)
+{
+    for (int i = 0; i < sizeof(afalg_ciphers) / sizeof(*afalg_ciphers); i++) {
+	if (afalg_ciphers[i].cipher() != cipher)
+	    continue;
+	*blocksize = afalg_ciphers[i].blocksize;
+	return afalg_ciphers[i].afalg;
+    }
+    return NULL;
+}
+
 ctx_t *create_ctx(const cipher_t *cipher, const unsigned char *key,
 		  const unsigned char *iv, int enc, int padding)
 {
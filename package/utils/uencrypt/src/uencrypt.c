@@ -94,8 +94,11 @@ int main(int argc, char *argv[])
 		get_cipher_keysize(cipher), keylen);
 	exit(EXIT_FAILURE);
     }
-    ctx = create_ctx(cipher, key, iv, !!enc, padding);
-    if (ctx) {
+    if ((ctx = afalg_create_ctx(cipher, key, keylen, iv, ivlen, !!enc,
+				padding))) {
+	ret = afalg_do_crypt(stdin, stdout, ctx);
+	afalg_free_ctx(ctx);
+    } else if ((ctx = create_ctx(cipher, key, iv, !!enc, padding))) {
 	ret = do_crypt(stdin, stdout, ctx);
 	free_ctx(ctx);
     }
@@ -42,8 +42,16 @@ const cipher_t *get_default_cipher(void);
 const cipher_t *get_cipher_or_print_error(char *name);
 int get_cipher_ivsize(const cipher_t *cipher);
 int get_cipher_keysize(const cipher_t *cipher);
+const char *get_cipher_afalg(const cipher_t *cipher, int padding,
+			     int *blocksize);
 
 ctx_t *create_ctx(const cipher_t *cipher, const unsigned char *key,
 		  const unsigned char *iv, int enc, int padding);
 int do_crypt(FILE *infile, FILE *outfile, ctx_t *ctx);
 void free_ctx(ctx_t *ctx);
+
+void *afalg_create_ctx(const cipher_t *cipher, const unsigned char *key,
+		       int keylen, const unsigned char *iv, int ivlen,
+		       int enc, int padding);
+int afalg_do_crypt(FILE *infile, FILE *outfile, void *ctx);
+void afalg_free_ctx(void *ctx);
@@ -401,10 +401,23 @@ endif
 
 TAR_OPTIONS:=-xf -
 
+# build cache entries, see include/package-cache.mk
+PKG_CACHE_DIR:=$(if $(call qstrip,$(CONFIG_PKG_BUILD_CACHE_DIR)),$(call qstrip,$(CONFIG_PKG_BUILD_CACHE_DIR)),$(TOPDIR)/.pkgcache)
+PKG_CACHE_URL:=$(call qstrip,$(CONFIG_PKG_BUILD_CACHE_URL))
+
 ifeq ($(CONFIG_BUILD_LOG),y)
   BUILD_LOG:=1
 endif
 
+ifneq ($(BUILD_LOG),)
+  # steps run through scripts/time.pl are recorded for scripts/build-report.pl
+  ifeq ($(origin BUILD_TIME_ID),undefined)
+    BUILD_TIME_ID:=$(shell date +%s)
+  endif
+  export BUILD_TIME_ID
+  export BUILD_TIME_LOG:=$(BUILD_LOG_DIR)/timing.txt
+endif
+
 export BISON_PKGDATADIR:=$(STAGING_DIR_HOST)/share/bison
 export HOST_GNULIB_SRCDIR:=$(STAGING_DIR_HOST)/share/gnulib
 export M4:=$(STAGING_DIR_HOST)/bin/m4
@@ -446,7 +459,9 @@ endef
 # @brief Execute commands under flock
 #
 # @param 1: The shell expression.
-# @param 2: The lock name. If not given, the global lock will be used.
+# @param 2: The lock name, after the resource shared with other jobs. If not
+#           given, the global lock will be used and nothing else under it runs
+#           in parallel.
 ##
 ifneq ($(wildcard $(STAGING_DIR_HOST)/bin/flock),)
   define locked
@@ -489,7 +504,7 @@ endef
 ##
 define sha256sums
 	(cd $(1); find . $(if $(2),,-maxdepth 1) -type f -not -name 'sha256sums' -printf "%P\n" | sort | \
-		xargs -r $(MKHASH) -n sha256 | sed -ne 's!^\(.*\) \(.*\)$$!\1 *\2!p' > sha256sums)
+		xargs -r $(MKHASH) -n -j 0 sha256 | sed -ne 's!^\(.*\) \(.*\)$$!\1 *\2!p' > sha256sums)
 endef
 
 ##@
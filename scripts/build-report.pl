@@ -0,0 +1,122 @@
+#!/usr/bin/env perl
+#
+# Summarize per-step build times recorded by scripts/time.pl
+# (BUILD_LOG=1 writes them to $(BUILD_LOG_DIR)/timing.txt)
+#
+# Usage: build-report.pl <timing.txt> [<tmp/.packagedeps>]
+#
+
+use strict;
+use warnings;
+
+@ARGV >= 1 or die "Usage: $0 <timing.txt> [<packagedeps>]\n";
+
+my ($timing, $depsfile) = @ARGV;
+my (%steps, %deps, @records);
+my $last_id = 0;
+
+open(my $fh, '<', $timing) or die "Can't open $timing: $!\n";
+while (<$fh>) {
+	my @rec = split;
+	next unless @rec == 6;
+	push @records, \@rec;
+	$last_id = $rec[0] if $rec[0] > $last_id;
+}
+close($fh);
+
+# only report the most recent build, a retried step counts once
+foreach my $rec (@records) {
+	my ($id, $step, $start, $end, $user, $sys) = @$rec;
+	next unless $id == $last_id;
+
+	$steps{$step} = {
+		name => $step,
+		start => $start,
+		end => $end,
+		wall => $end - $start,
+		cpu => $user + $sys,
+	};
+}
+
+%steps or die "No build steps recorded in $timing\n";
+
+# $(curdir)/<path>/compile += $(curdir)/<dep>/compile ...
+# Conditions are ignored, a dependency only matters if it was built anyway.
+if ($depsfile and open($fh, '<', $depsfile)) {
+	while (<$fh>) {
+		next unless /^\$\(curdir\)\/(\S+)\/compile \+= (.*)$/;
+		my $pkg = "package/$1";
+		my @dep = ($2 =~ /\$\(curdir\)\/([^ ),]+)\/compile/g);
+		push @{$deps{$pkg}}, map { "package/$_" } @dep;
+	}
+	close($fh);
+}
+
+sub step_dir {
+	my $dir = shift;
+
+	$dir =~ s/\/[^\/]+$//;
+	return $dir;
+}
+
+sub step_deps {
+	my $step = shift;
+	my $dir = step_dir($step->{name});
+	my @dirs = @{$deps{$dir} || $deps{step_dir($dir)} || []};
+	# earlier steps of the same package (compile before install) count too
+	my %want = map { $_ => 1 } @dirs, $dir;
+
+	return grep { $want{step_dir($_->{name})} || $want{step_dir(step_dir($_->{name}))} }
+		values %steps;
+}
+
+# Walk back from the step that finished last, each time to whatever it
+# waited for: the latest finishing dependency if known, otherwise the
+# latest step that finished before it was started.
+sub critical_path {
+	my @all = sort { $b->{end} <=> $a->{end} } values %steps;
+	my $step = $all[0];
+	my @path;
+
+	while ($step) {
+		unshift @path, $step;
+		my $start = $step->{start};
+		my @prev = grep { $_->{end} <= $start } step_deps($step);
+		@prev = grep { $_->{end} <= $start } @all unless @prev;
+		($step) = sort { $b->{end} <=> $a->{end} } @prev;
+	}
+
+	return @path;
+}
+
+my @all = values %steps;
+my ($first) = sort { $a->{start} <=> $b->{start} } @all;
+my ($last) = sort { $b->{end} <=> $a->{end} } @all;
+my $span = $last->{end} - $first->{start};
+my ($wall, $cpu) = (0, 0);
+
+foreach my $step (@all) {
+	$wall += $step->{wall};
+	$cpu += $step->{cpu};
+}
+
+printf "Build %s: %d steps, %.1fs elapsed, %.1fs cpu, %.1fs summed step time (%.2fx overlap)\n\n",
+	$last_id, scalar(@all), $span, $cpu, $wall, $span > 0 ? $wall / $span : 0;
+
+my @path = critical_path();
+my $path_wall = 0;
+$path_wall += $_->{wall} foreach @path;
+
+printf "Critical path: %d steps, %.1fs of %.1fs\n", scalar(@path), $path_wall, $span;
+printf "%10s %10s %10s  %s\n", "start", "wall", "cpu", "step";
+foreach my $step (@path) {
+	printf "%10.1f %10.1f %10.1f  %s\n",
+		$step->{start} - $first->{start}, $step->{wall}, $step->{cpu}, $step->{name};
+}
+
+print "\nAll steps by wall time:\n";
+printf "%10s %10s %10s  %s\n", "start", "wall", "cpu", "step";
+foreach my $step (sort { $b->{wall} <=> $a->{wall} } @all) {
+	printf "%10.1f %10.1f %10.1f  %s\n",
+		$step->{start} - $first->{start}, $step->{wall}, $step->{cpu}, $step->{name};
+}
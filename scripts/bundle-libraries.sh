@@ -149,64 +149,85 @@ done
 
 [ -n "$LDD" -a -x "$LDD" ] || LDD=
 
+# print "<binary> <library>" for each library a binary to patch loads
+_resolve() {
+	local bin token
+
+	for bin in "$@"; do
+		should_be_patched "$bin" || continue
+
+		for token in $("$LDD" "$bin" 2>/dev/null); do
+			case "$token" in */*.so*)
+				printf '%s\t%s\n' "$bin" "$token"
+			;; esac
+		done
+	done
+}
+
 for BIN in "$@"; do
 	[ -n "$BIN" -a -n "$DIR" ] || {
 		echo "Usage: $0 <destdir> <executable> ..." >&2
 		exit 1
 	}
+done
 
-	[ ! -d "$DIR/lib" ] && {
-		_md "$DIR/lib"
-		_md "$DIR/usr"
-		_ln "../lib" "$DIR/usr/lib"
-	}
+[ $# -gt 0 ] || exit 0
 
-	[ ! -x "$DIR/lib/runas.so" ] && {
-		_runas_so "$DIR/lib/runas.so"
-	}
+[ ! -d "$DIR/lib" ] && {
+	_md "$DIR/lib"
+	_md "$DIR/usr"
+	_ln "../lib" "$DIR/usr/lib"
+}
 
-	LDSO=""
+[ ! -x "$DIR/lib/runas.so" ] && {
+	_runas_so "$DIR/lib/runas.so"
+}
 
-	[ -n "$LDD" ] && should_be_patched "$BIN" && {
-		for token in $("$LDD" "$BIN" 2>/dev/null); do
-			case "$token" in */*.so*)
-				dest="$DIR/lib/${token##*/}"
-				ddir="${dest%/*}"
-
-				case "$token" in
-					*/ld-*.so*) LDSO="${token##*/}" ;;
-				esac
-
-				[ -f "$token" -a ! -f "$dest" ] && {
-					_md "$ddir"
-					_cp "$token" "$dest"
-					case "$token" in
-						*/ld-*.so*) _patch_ldso "$dest" ;;
-						*/libc.so.6) _patch_glibc "$dest" ;;
-					esac
-				}
-			;; esac
-		done
+# resolve the dependencies of all binaries at once, spread over
+# BUNDLE_JOBS (default: all cpus) processes
+DEPS=""
+[ -n "$LDD" ] && {
+	export LDD
+	export -f should_be_patched _resolve
+
+	DEPS="$(printf '%s\0' "$@" | xargs -0 -r -n 16 \
+		-P "${BUNDLE_JOBS:-$(getconf _NPROCESSORS_ONLN 2>/dev/null || echo 1)}" \
+		bash -c '_resolve "$@"' _)"
+}
+
+# copy each library once, however many binaries share it
+while IFS= read -r token; do
+	dest="$DIR/lib/${token##*/}"
+	ddir="${dest%/*}"
+
+	[ -f "$token" -a ! -f "$dest" ] && {
+		_md "$ddir"
+		_cp "$token" "$dest"
+		case "$token" in
+			*/ld-*.so*) _patch_ldso "$dest" ;;
+			*/libc.so.6) _patch_glibc "$dest" ;;
+		esac
 	}
+done < <(printf '%s\n' "$DEPS" | cut -sf2 | sort -u)
 
-	# is a dynamically linked executable
-	if [ -n "$LDSO" ]; then
-		echo "Bundling ${BIN##*/}"
+# wrap each dynamically linked executable
+while IFS=$'\t' read -r BIN token; do
+	echo "Bundling ${BIN##*/}"
 
-		RUNDIR="$(readlink -f "$BIN")"; RUNDIR="${RUNDIR%/*}"
-		RUN="${LDSO#ld-}"; RUN="run-${RUN%%.so*}.sh"
-		REL="$(_relpath "$DIR/lib" "$BIN")"
+	LDSO="${token##*/}"
+	RUNDIR="$(readlink -f "$BIN")"; RUNDIR="${RUNDIR%/*}"
+	RUN="${LDSO#ld-}"; RUN="run-${RUN%%.so*}.sh"
+	REL="$(_relpath "$DIR/lib" "$BIN")"
 
-		_mv "$BIN" "$RUNDIR/.${BIN##*/}.bin"
+	_mv "$BIN" "$RUNDIR/.${BIN##*/}.bin"
 
-		cat <<-EOF > "$BIN"
-			#!/usr/bin/env bash
-			dir="\$(dirname "\$0")"
-			export RUNAS_ARG0="\$0"
-			export LD_PRELOAD="\${LD_PRELOAD:+\$LD_PRELOAD:}\$dir/${REL:+$REL/}runas.so"
-			exec "\$dir/${REL:+$REL/}$LDSO" --library-path "\$dir/${REL:+$REL/}" "\$dir/.${BIN##*/}.bin" "\$@"
-		EOF
+	cat <<-EOF > "$BIN"
+		#!/usr/bin/env bash
+		dir="\$(dirname "\$0")"
+		export RUNAS_ARG0="\$0"
+		export LD_PRELOAD="\${LD_PRELOAD:+\$LD_PRELOAD:}\$dir/${REL:+$REL/}runas.so"
+		exec "\$dir/${REL:+$REL/}$LDSO" --library-path "\$dir/${REL:+$REL/}" "\$dir/.${BIN##*/}.bin" "\$@"
+	EOF
 
-		chmod ${VERBOSE:+-v} 0755 "$BIN"
-	fi
-done
+	chmod ${VERBOSE:+-v} 0755 "$BIN"
+done < <(printf '%s\n' "$DEPS" | grep -E $'\t[^\t]*/ld-[^/]*\\.so[^/]*$' | sort -u)
@@ -0,0 +1,995 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Cache of the parsed configuration
+ *
+ * With KCONFIG_PARSE_CACHE set to a file name, conf_parse() stores the
+ * finalized menu tree and symbol table there and loads it back instead
+ * of parsing, as long as nothing its result depends on changed: the
+ * contents of every file read, the result of every source glob, the
+ * output of every $(shell,...) and the value of every environment
+ * variable referenced. Anything printed to stderr while parsing is kept
+ * along and printed again when the cache is used.
+ */
+
+#include <sys/stat.h>
+#include <glob.h>
+#include <libgen.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "lkc.h"
+
+/* bump whenever the parser or the layout of the saved data changes */
+#define CACHE_VERSION	1
+#define CACHE_MAGIC	0x4b434348	/* "KCCH" */
+#define CACHE_NONE	UINT32_MAX
+
+enum cache_dep_type {
+	DEP_FILE = 1,
+	DEP_ENV,
+	DEP_SHELL,
+	DEP_SOURCE,
+	DEP_SRCTREE,
+};
+
+struct cache_dep {
+	struct cache_dep *next;
+	enum cache_dep_type type;
+	char *key;
+	char *value;
+};
+
+static const char *cache_file;
+static bool cache_broken;
+static struct cache_dep *deps, **deps_tail = &deps;
+static FILE *cache_log;
+static int saved_stderr = -1;
+
+static uint64_t hash_data(uint64_t hash, const void *data, size_t len)
+{
+	const unsigned char *p = data;
+
+	/* FNV-1a */
+	while (len--) {
+		hash ^= *p++;
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+static char *file_digest(const char *name)
+{
+	char buf[65536], digest[64];
+	uint64_t hash = 0xcbf29ce484222325ULL, size = 0;
+	size_t len;
+	FILE *f;
+
+	f = zconf_fopen(name);
+	if (!f)
+		return NULL;
+	while ((len = fread(buf, 1, sizeof(buf), f)) > 0) {
+		hash = hash_data(hash, buf, len);
+		size += len;
+	}
+	if (ferror(f)) {
+		fclose(f);
+		return NULL;
+	}
+	fclose(f);
+
+	snprintf(digest, sizeof(digest), "%016llx:%llu",
+		 (unsigned long long)hash, (unsigned long long)size);
+	return xstrdup(digest);
+}
+
+/* the files a source statement includes, see zconf_nextfile() */
+static char *source_files(const char *pattern, const char *curname)
+{
+	struct gstr gs;
+	char path[PATH_MAX], *p;
+	glob_t gl;
+	int err;
+	size_t i;
+
+	err = glob(pattern, GLOB_ERR | GLOB_MARK, NULL, &gl);
+
+	/* wildcard patterns are allowed to match nothing */
+	if (err == GLOB_NOMATCH && strchr(pattern, '*')) {
+		globfree(&gl);
+		return xstrdup("");
+	}
+
+	if (err == GLOB_NOMATCH) {
+		globfree(&gl);
+		p = xstrdup(curname);
+		snprintf(path, sizeof(path), "%s/%s", dirname(p), pattern);
+		free(p);
+		err = glob(path, GLOB_ERR | GLOB_MARK, NULL, &gl);
+	}
+	if (err) {
+		globfree(&gl);
+		return NULL;
+	}
+
+	gs = str_new();
+	for (i = 0; i < gl.gl_pathc; i++) {
+		str_append(&gs, gl.gl_pathv[i]);
+		str_append(&gs, "\n");
+	}
+	globfree(&gl);
+
+	return gs.s;
+}
+
+static void cache_add_dep(enum cache_dep_type type, const char *key,
+			  const char *value)
+{
+	struct cache_dep *dep;
+
+	if (!cache_file || cache_broken)
+		return;
+
+	dep = xcalloc(1, sizeof(*dep));
+	dep->type = type;
+	dep->key = xstrdup(key);
+	dep->value = value ? xstrdup(value) : NULL;
+	*deps_tail = dep;
+	deps_tail = &dep->next;
+}
+
+void conf_cache_add_env(const char *name, const char *value)
+{
+	cache_add_dep(DEP_ENV, name, value);
+}
+
+void conf_cache_add_shell(const char *cmd, const char *output)
+{
+	cache_add_dep(DEP_SHELL, cmd, output);
+}
+
+void conf_cache_add_source(const char *pattern)
+{
+	char *files, *key;
+	size_t len;
+
+	if (!cache_file || cache_broken)
+		return;
+
+	/* the directory of the including file is the fallback for a miss */
+	files = source_files(pattern, current_file->name);
+	len = strlen(pattern) + strlen(current_file->name) + 2;
+	key = xmalloc(len);
+	snprintf(key, len, "%s\n%s", pattern, current_file->name);
+	cache_add_dep(DEP_SOURCE, key, files);
+	free(key);
+	free(files);
+}
+
+/* output that can't be replayed, like $(info,...) on stdout */
+void conf_cache_disable(void)
+{
+	cache_broken = true;
+}
+
+static bool dep_valid(struct cache_dep *dep)
+{
+	const char *curval;
+	char *val, *p;
+	bool ret;
+
+	switch (dep->type) {
+	case DEP_FILE:
+		val = file_digest(dep->key);
+		break;
+	case DEP_ENV:
+	case DEP_SRCTREE:
+		curval = getenv(dep->key);
+		if (!curval || !dep->value)
+			return curval == dep->value;
+		return !strcmp(curval, dep->value);
+	case DEP_SHELL:
+		val = shell_expand(dep->key);
+		break;
+	case DEP_SOURCE:
+		p = strchr(dep->key, '\n');
+		if (!p)
+			return false;
+		*p = 0;
+		val = source_files(dep->key, p + 1);
+		*p = '\n';
+		break;
+	default:
+		return false;
+	}
+
+	ret = val && dep->value && !strcmp(val, dep->value);
+	free(val);
+	return ret;
+}
+
+/*
+ * Pointer to index maps for writing all objects out as tables, so that
+ * shared ones (expressions in particular) stay shared when loaded back.
+ */
+struct obj_table {
+	const void **obj;
+	uint32_t count, alloc;
+
+	const void **hkey;
+	uint32_t *hval;
+	uint32_t hsize;
+};
+
+static uint32_t ptr_hash(const void *p, uint32_t size)
+{
+	uintptr_t v = (uintptr_t)p;
+
+	return (uint32_t)((v >> 4) * 2654435761u) & (size - 1);
+}
+
+static void table_rehash(struct obj_table *t)
+{
+	uint32_t i, h;
+
+	free(t->hkey);
+	free(t->hval);
+	t->hsize = t->hsize ? t->hsize * 2 : 1024;
+	t->hkey = xcalloc(t->hsize, sizeof(*t->hkey));
+	t->hval = xcalloc(t->hsize, sizeof(*t->hval));
+	for (i = 0; i < t->count; i++) {
+		if (!t->obj[i])
+			continue;
+		for (h = ptr_hash(t->obj[i], t->hsize); t->hkey[h];
+		     h = (h + 1) & (t->hsize - 1))
+			;
+		t->hkey[h] = t->obj[i];
+		t->hval[h] = i;
+	}
+}
+
+static uint32_t table_find(struct obj_table *t, const void *p)
+{
+	uint32_t h;
+
+	if (!p)
+		return 0;
+	if (!t->hsize)
+		return CACHE_NONE;
+	for (h = ptr_hash(p, t->hsize); t->hkey[h]; h = (h + 1) & (t->hsize - 1))
+		if (t->hkey[h] == p)
+			return t->hval[h];
+	return CACHE_NONE;
+}
+
+/* index 0 always stands for NULL */
+static bool table_add(struct obj_table *t, const void *p)
+{
+	if (p && table_find(t, p) != CACHE_NONE)
+		return false;
+
+	if (t->count == t->alloc) {
+		t->alloc = t->alloc ? t->alloc * 2 : 1024;
+		t->obj = xrealloc(t->obj, t->alloc * sizeof(*t->obj));
+	}
+	t->obj[t->count++] = p;
+	if (2 * t->count > t->hsize)
+		table_rehash(t);
+	else if (p) {
+		uint32_t h;
+
+		for (h = ptr_hash(p, t->hsize); t->hkey[h];
+		     h = (h + 1) & (t->hsize - 1))
+			;
+		t->hkey[h] = p;
+		t->hval[h] = t->count - 1;
+	}
+	return true;
+}
+
+static void table_free(struct obj_table *t)
+{
+	free(t->obj);
+	free(t->hkey);
+	free(t->hval);
+}
+
+struct cache_writer {
+	FILE *out;
+	bool error;
+	struct obj_table files, syms, exprs, props, menus;
+};
+
+static bool expr_left_is_sym(enum expr_type type)
+{
+	switch (type) {
+	case E_SYMBOL:
+	case E_EQUAL:
+	case E_UNEQUAL:
+	case E_LTH:
+	case E_LEQ:
+	case E_GTH:
+	case E_GEQ:
+	case E_RANGE:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool expr_right_is_sym(enum expr_type type)
+{
+	return type != E_SYMBOL && type != E_NOT &&
+	       (expr_left_is_sym(type) || type == E_LIST);
+}
+
+static bool expr_right_is_expr(enum expr_type type)
+{
+	return type == E_OR || type == E_AND;
+}
+
+static void collect_expr(struct cache_writer *w, struct expr *e)
+{
+	while (e && table_add(&w->exprs, e)) {
+		if (expr_right_is_expr(e->type))
+			collect_expr(w, e->right.expr);
+		if (expr_left_is_sym(e->type))
+			break;
+		e = e->left.expr;
+	}
+}
+
+static void collect_prop(struct cache_writer *w, struct property *prop)
+{
+	if (!prop || !table_add(&w->props, prop))
+		return;
+	collect_expr(w, prop->visible.expr);
+	collect_expr(w, prop->expr);
+}
+
+static void collect_menu(struct cache_writer *w, struct menu *menu)
+{
+	for (; menu; menu = menu->next) {
+		table_add(&w->menus, menu);
+		collect_prop(w, menu->prompt);
+		collect_expr(w, menu->visibility);
+		collect_expr(w, menu->dep);
+		collect_menu(w, menu->list);
+	}
+}
+
+static void collect(struct cache_writer *w)
+{
+	struct property *prop;
+	struct symbol *sym;
+	struct file *file;
+	int i;
+
+	table_add(&w->files, NULL);
+	for (file = file_list; file; file = file->next)
+		table_add(&w->files, file);
+
+	table_add(&w->syms, NULL);
+	table_add(&w->syms, &symbol_yes);
+	table_add(&w->syms, &symbol_mod);
+	table_add(&w->syms, &symbol_no);
+	for_all_symbols(i, sym)
+		table_add(&w->syms, sym);
+
+	table_add(&w->exprs, NULL);
+	table_add(&w->props, NULL);
+	for_all_symbols(i, sym) {
+		for (prop = sym->prop; prop; prop = prop->next)
+			collect_prop(w, prop);
+		collect_expr(w, sym->dir_dep.expr);
+		collect_expr(w, sym->rev_dep.expr);
+		collect_expr(w, sym->implied.expr);
+	}
+
+	table_add(&w->menus, NULL);
+	table_add(&w->menus, &rootmenu);
+	collect_prop(w, rootmenu.prompt);
+	collect_expr(w, rootmenu.visibility);
+	collect_expr(w, rootmenu.dep);
+	collect_menu(w, rootmenu.list);
+}
+
+static void w_u32(struct cache_writer *w, uint32_t v)
+{
+	if (fwrite(&v, sizeof(v), 1, w->out) != 1)
+		w->error = true;
+}
+
+static void w_str(struct cache_writer *w, const char *s)
+{
+	uint32_t len = s ? strlen(s) : CACHE_NONE;
+
+	w_u32(w, len);
+	if (s && len && fwrite(s, len, 1, w->out) != 1)
+		w->error = true;
+}
+
+static void w_ref(struct cache_writer *w, struct obj_table *t, const void *p)
+{
+	uint32_t idx = table_find(t, p);
+
+	/* pointing outside of what was collected, can't be saved */
+	if (idx == CACHE_NONE)
+		w->error = true;
+	w_u32(w, idx);
+}
+
+static void write_expr(struct cache_writer *w, struct expr *e)
+{
+	w_u32(w, e->type);
+	if (expr_left_is_sym(e->type))
+		w_ref(w, &w->syms, e->left.sym);
+	else
+		w_ref(w, &w->exprs, e->left.expr);
+	if (expr_right_is_sym(e->type))
+		w_ref(w, &w->syms, e->right.sym);
+	else if (expr_right_is_expr(e->type))
+		w_ref(w, &w->exprs, e->right.expr);
+	else
+		w_u32(w, 0);
+}
+
+static void write_expr_value(struct cache_writer *w, struct expr_value *ev)
+{
+	w_ref(w, &w->exprs, ev->expr);
+	w_u32(w, ev->tri);
+}
+
+static void write_sym(struct cache_writer *w, struct symbol *sym)
+{
+	int i;
+
+	w_str(w, sym->name);
+	w_u32(w, sym->type);
+	w_u32(w, sym->flags);
+	w_u32(w, sym->visible);
+	w_ref(w, &w->props, sym->prop);
+	write_expr_value(w, &sym->dir_dep);
+	write_expr_value(w, &sym->rev_dep);
+	write_expr_value(w, &sym->implied);
+
+	/* values are only ever calculated after parsing */
+	if (sym->curr.val)
+		w->error = true;
+	w_u32(w, sym->curr.tri);
+	for (i = 0; i < S_DEF_COUNT; i++)
+		if (sym->def[i].val || sym->def[i].tri)
+			w->error = true;
+}
+
+static void write_prop(struct cache_writer *w, struct property *prop)
+{
+	w_ref(w, &w->props, prop->next);
+	w_u32(w, prop->type);
+	w_str(w, prop->text);
+	write_expr_value(w, &prop->visible);
+	w_ref(w, &w->exprs, prop->expr);
+	w_ref(w, &w->menus, prop->menu);
+	w_ref(w, &w->files, prop->file);
+	w_u32(w, prop->lineno);
+}
+
+static void write_menu(struct cache_writer *w, struct menu *menu)
+{
+	w_ref(w, &w->menus, menu->next);
+	w_ref(w, &w->menus, menu->parent);
+	w_ref(w, &w->menus, menu->list);
+	w_ref(w, &w->syms, menu->sym);
+	w_ref(w, &w->props, menu->prompt);
+	w_ref(w, &w->exprs, menu->visibility);
+	w_ref(w, &w->exprs, menu->dep);
+	w_u32(w, menu->flags);
+	w_str(w, menu->help);
+	w_ref(w, &w->files, menu->file);
+	w_u32(w, menu->lineno);
+}
+
+static void cache_write(struct cache_writer *w, const char *name,
+			const char *log)
+{
+	struct cache_dep *dep;
+	struct symbol *sym;
+	struct file *file;
+	uint32_t i, count = 0;
+	int bucket;
+
+	w_u32(w, CACHE_MAGIC);
+	w_u32(w, CACHE_VERSION);
+	w_u32(w, sizeof(void *));
+	w_u32(w, recursive_is_error);
+	w_str(w, name);
+
+	for (dep = deps; dep; dep = dep->next)
+		count++;
+	w_u32(w, count);
+	for (dep = deps; dep; dep = dep->next) {
+		w_u32(w, dep->type);
+		w_str(w, dep->key);
+		w_str(w, dep->value);
+	}
+
+	w_str(w, log);
+
+	w_u32(w, w->files.count);
+	w_u32(w, w->syms.count);
+	w_u32(w, w->exprs.count);
+	w_u32(w, w->props.count);
+	w_u32(w, w->menus.count);
+
+	for (i = 1; i < w->files.count; i++) {
+		file = (struct file *)w->files.obj[i];
+		w_str(w, file->name);
+		w_ref(w, &w->files, file->parent);
+		w_u32(w, file->lineno);
+	}
+
+	/* symbol_yes, symbol_mod and symbol_no are left as they are */
+	for_all_symbols(bucket, sym) {
+		w_u32(w, bucket);
+		write_sym(w, sym);
+	}
+	for (i = 1; i < w->exprs.count; i++)
+		write_expr(w, (struct expr *)w->exprs.obj[i]);
+	for (i = 1; i < w->props.count; i++)
+		write_prop(w, (struct property *)w->props.obj[i]);
+	for (i = 1; i < w->menus.count; i++)
+		write_menu(w, (struct menu *)w->menus.obj[i]);
+
+	w_ref(w, &w->syms, modules_sym);
+	w_u32(w, CACHE_MAGIC);
+}
+
+static void cache_log_start(void)
+{
+	fflush(stderr);
+	cache_log = tmpfile();
+	if (!cache_log)
+		return;
+
+	saved_stderr = dup(STDERR_FILENO);
+	if (saved_stderr < 0 || dup2(fileno(cache_log), STDERR_FILENO) < 0) {
+		if (saved_stderr >= 0)
+			close(saved_stderr);
+		saved_stderr = -1;
+		fclose(cache_log);
+		cache_log = NULL;
+	}
+}
+
+/* restores stderr and passes on what was written to it meanwhile */
+static char *cache_log_stop(void)
+{
+	struct gstr gs = str_new();
+	char buf[4096];
+	size_t len;
+
+	if (saved_stderr < 0)
+		return gs.s;
+
+	fflush(stderr);
+	dup2(saved_stderr, STDERR_FILENO);
+	close(saved_stderr);
+	saved_stderr = -1;
+
+	rewind(cache_log);
+	while ((len = fread(buf, 1, sizeof(buf) - 1, cache_log)) > 0) {
+		buf[len] = 0;
+		fputs(buf, stderr);
+		str_append(&gs, buf);
+	}
+	fclose(cache_log);
+	cache_log = NULL;
+
+	return gs.s;
+}
+
+/* parse errors exit() right away */
+static void cache_log_exit(void)
+{
+	free(cache_log_stop());
+}
+
+void conf_cache_save(const char *name)
+{
+	struct cache_writer w = {};
+	struct cache_dep *dep;
+	struct file *file;
+	char *tmp, *log;
+	size_t len;
+
+	if (!cache_file)
+		return;
+
+	log = cache_log_stop();
+	if (cache_broken)
+		goto out;
+
+	for (file = file_list; file; file = file->next) {
+		char *digest = file_digest(file->name);
+
+		if (!digest)
+			goto out;
+		cache_add_dep(DEP_FILE, file->name, digest);
+		free(digest);
+	}
+	cache_add_dep(DEP_SRCTREE, SRCTREE, getenv(SRCTREE));
+
+	len = strlen(cache_file) + 16;
+	tmp = xmalloc(len);
+	snprintf(tmp, len, "%s.%d", cache_file, (int)getpid());
+	w.out = fopen(tmp, "w");
+	if (w.out) {
+		collect(&w);
+		cache_write(&w, name, log);
+		if (fclose(w.out))
+			w.error = true;
+		if (w.error || rename(tmp, cache_file))
+			unlink(tmp);
+	}
+	free(tmp);
+
+	table_free(&w.files);
+	table_free(&w.syms);
+	table_free(&w.exprs);
+	table_free(&w.props);
+	table_free(&w.menus);
+
+out:
+	while ((dep = deps)) {
+		deps = dep->next;
+		free(dep->key);
+		free(dep->value);
+		free(dep);
+	}
+	deps_tail = &deps;
+	free(log);
+}
+
+struct cache_reader {
+	const char *p, *end;
+	bool error;
+	uint32_t nfiles, nsyms, nexprs, nprops, nmenus;
+	struct file **files;
+	struct symbol **syms;
+	struct expr **exprs;
+	struct property **props;
+	struct menu **menus;
+};
+
+static uint32_t r_u32(struct cache_reader *r)
+{
+	uint32_t v;
+
+	if (r->error || r->end - r->p < (ptrdiff_t)sizeof(v)) {
+		r->error = true;
+		return 0;
+	}
+	memcpy(&v, r->p, sizeof(v));
+	r->p += sizeof(v);
+	return v;
+}
+
+static char *r_str(struct cache_reader *r)
+{
+	uint32_t len = r_u32(r);
+	char *s;
+
+	if (r->error || len == CACHE_NONE)
+		return NULL;
+	if (r->end - r->p < len) {
+		r->error = true;
+		return NULL;
+	}
+	s = xstrndup(r->p, len);
+	r->p += len;
+	return s;
+}
+
+static uint32_t r_idx(struct cache_reader *r, uint32_t count)
+{
+	uint32_t idx = r_u32(r);
+
+	if (idx >= count) {
+		r->error = true;
+		return 0;
+	}
+	return idx;
+}
+
+#define r_ref(r, table) ((r)->table[r_idx(r, (r)->n##table)])
+
+static void read_expr_value(struct cache_reader *r, struct expr_value *ev)
+{
+	ev->expr = r_ref(r, exprs);
+	ev->tri = r_u32(r);
+}
+
+static void read_expr(struct cache_reader *r, struct expr *e)
+{
+	e->type = r_u32(r);
+	if (expr_left_is_sym(e->type))
+		e->left.sym = r_ref(r, syms);
+	else
+		e->left.expr = r_ref(r, exprs);
+	if (expr_right_is_sym(e->type))
+		e->right.sym = r_ref(r, syms);
+	else if (expr_right_is_expr(e->type))
+		e->right.expr = r_ref(r, exprs);
+	else
+		r_u32(r);
+}
+
+static void read_sym(struct cache_reader *r, struct symbol *sym)
+{
+	sym->name = r_str(r);
+	sym->type = r_u32(r);
+	sym->flags = r_u32(r);
+	sym->visible = r_u32(r);
+	sym->prop = r_ref(r, props);
+	read_expr_value(r, &sym->dir_dep);
+	read_expr_value(r, &sym->rev_dep);
+	read_expr_value(r, &sym->implied);
+	sym->curr.tri = r_u32(r);
+}
+
+static void read_prop(struct cache_reader *r, struct property *prop)
+{
+	prop->next = r_ref(r, props);
+	prop->type = r_u32(r);
+	prop->text = r_str(r);
+	read_expr_value(r, &prop->visible);
+	prop->expr = r_ref(r, exprs);
+	prop->menu = r_ref(r, menus);
+	prop->file = r_ref(r, files);
+	prop->lineno = r_u32(r);
+}
+
+static void read_menu(struct cache_reader *r, struct menu *menu)
+{
+	menu->next = r_ref(r, menus);
+	menu->parent = r_ref(r, menus);
+	menu->list = r_ref(r, menus);
+	menu->sym = r_ref(r, syms);
+	menu->prompt = r_ref(r, props);
+	menu->visibility = r_ref(r, exprs);
+	menu->dep = r_ref(r, exprs);
+	menu->flags = r_u32(r);
+	menu->help = r_str(r);
+	menu->file = r_ref(r, files);
+	menu->lineno = r_u32(r);
+}
+
+/* index 0 stays NULL, the ones below first are filled in by the caller */
+static void *alloc_table(uint32_t n, uint32_t first, size_t size)
+{
+	void **table;
+	uint32_t i;
+
+	table = xcalloc(n ? n : 1, sizeof(*table));
+	for (i = first; i < n; i++)
+		table[i] = xcalloc(1, size);
+	return table;
+}
+
+static bool cache_read(struct cache_reader *r, const char *name)
+{
+	struct symbol **hash_head, **hash_tail;
+	struct symbol *sym_modules;
+	struct cache_dep dep, *env = NULL, **env_tail = &env, *e;
+	struct menu root;
+	uint32_t i, count, bucket;
+	char *s, *log = NULL;
+	bool valid = true;
+
+	if (r_u32(r) != CACHE_MAGIC || r_u32(r) != CACHE_VERSION ||
+	    r_u32(r) != sizeof(void *) || r_u32(r) != recursive_is_error)
+		return false;
+	s = r_str(r);
+	if (!s || strcmp(s, name))
+		valid = false;
+	free(s);
+
+	count = r_u32(r);
+	for (i = 0; valid && !r->error && i < count; i++) {
+		dep.type = r_u32(r);
+		dep.key = r_str(r);
+		dep.value = r_str(r);
+		valid = dep.key && dep_valid(&dep);
+		if (valid && dep.type == DEP_ENV && dep.value) {
+			/* for env_write_dep(), like when parsing */
+			e = xmalloc(sizeof(*e));
+			*e = dep;
+			e->next = NULL;
+			*env_tail = e;
+			env_tail = &e->next;
+			continue;
+		}
+		free(dep.key);
+		free(dep.value);
+	}
+	if (!valid || r->error)
+		goto fail;
+
+	log = r_str(r);
+
+	r->nfiles = r_u32(r);
+	r->nsyms = r_u32(r);
+	r->nexprs = r_u32(r);
+	r->nprops = r_u32(r);
+	r->nmenus = r_u32(r);
+	if (r->error || r->nsyms < 4 || r->nmenus < 2 ||
+	    (uint64_t)r->nfiles + r->nsyms + r->nexprs + r->nprops + r->nmenus >
+	    (uint64_t)(r->end - r->p))
+		goto fail;
+
+	r->files = alloc_table(r->nfiles, 1, sizeof(struct file));
+	r->syms = alloc_table(r->nsyms, 4, sizeof(struct symbol));
+	r->exprs = alloc_table(r->nexprs, 1, sizeof(struct expr));
+	r->props = alloc_table(r->nprops, 1, sizeof(struct property));
+	r->menus = alloc_table(r->nmenus, 2, sizeof(struct menu));
+	r->syms[1] = &symbol_yes;
+	r->syms[2] = &symbol_mod;
+	r->syms[3] = &symbol_no;
+	memset(&root, 0, sizeof(root));
+	r->menus[1] = &root;
+
+	for (i = 1; i < r->nfiles; i++) {
+		r->files[i]->name = r_str(r);
+		r->files[i]->parent = r_ref(r, files);
+		r->files[i]->lineno = r_u32(r);
+		r->files[i]->next = i + 1 < r->nfiles ? r->files[i + 1] : NULL;
+	}
+
+	/* chained in the order they were written, as in symbol_hash */
+	hash_head = xcalloc(SYMBOL_HASHSIZE, sizeof(*hash_head));
+	hash_tail = xcalloc(SYMBOL_HASHSIZE, sizeof(*hash_tail));
+	for (i = 4; i < r->nsyms; i++) {
+		bucket = r_u32(r);
+		if (bucket >= SYMBOL_HASHSIZE)
+			r->error = true;
+		if (r->error)
+			break;
+		read_sym(r, r->syms[i]);
+		if (hash_tail[bucket])
+			hash_tail[bucket]->next = r->syms[i];
+		else
+			hash_head[bucket] = r->syms[i];
+		hash_tail[bucket] = r->syms[i];
+	}
+	free(hash_tail);
+
+	for (i = 1; i < r->nexprs; i++)
+		read_expr(r, r->exprs[i]);
+	for (i = 1; i < r->nprops; i++)
+		read_prop(r, r->props[i]);
+	for (i = 1; i < r->nmenus; i++)
+		read_menu(r, r->menus[i]);
+	sym_modules = r_ref(r, syms);
+
+	if (r_u32(r) != CACHE_MAGIC || r->error) {
+		/* the allocations made so far are simply leaked */
+		free(hash_head);
+		goto fail;
+	}
+
+	/* everything read, only now replace the (empty) parser state */
+	memcpy(symbol_hash, hash_head, SYMBOL_HASHSIZE * sizeof(*hash_head));
+	free(hash_head);
+	for (i = 2; i < r->nmenus; i++) {
+		struct menu *menu = r->menus[i];
+
+		if (menu->next == &root)
+			menu->next = &rootmenu;
+		if (menu->parent == &root)
+			menu->parent = &rootmenu;
+		if (menu->list == &root)
+			menu->list = &rootmenu;
+	}
+	for (i = 1; i < r->nprops; i++) {
+		if (r->props[i]->menu == &root)
+			r->props[i]->menu = &rootmenu;
+	}
+	rootmenu = root;
+	file_list = r->nfiles > 1 ? r->files[1] : NULL;
+	current_file = NULL;
+	modules_sym = sym_modules;
+
+	while ((e = env)) {
+		env = e->next;
+		env_add(e->key, e->value);
+		free(e->key);
+		free(e->value);
+		free(e);
+	}
+	if (log) {
+		fputs(log, stderr);
+		free(log);
+	}
+	return true;
+
+fail:
+	while ((e = env)) {
+		env = e->next;
+		free(e->key);
+		free(e->value);
+		free(e);
+	}
+	free(log);
+	return false;
+}
+
+/* on a miss, parsing goes on and conf_cache_save() stores the result */
+static bool cache_load(const char *name)
+{
+	struct cache_reader r = {};
+	struct stat st;
+	char *buf;
+	bool ret;
+	FILE *f;
+	int i;
+
+	/* only ever a replacement for the first parse */
+	for (i = 0; i < SYMBOL_HASHSIZE; i++)
+		if (symbol_hash[i])
+			return false;
+
+	f = fopen(cache_file, "r");
+	if (!f)
+		return false;
+	if (fstat(fileno(f), &st) || !st.st_size) {
+		fclose(f);
+		return false;
+	}
+
+	buf = xmalloc(st.st_size);
+	if (fread(buf, st.st_size, 1, f) != 1) {
+		free(buf);
+		fclose(f);
+		return false;
+	}
+	fclose(f);
+
+	r.p = buf;
+	r.end = buf + st.st_size;
+	ret = cache_read(&r, name);
+
+	free(r.files);
+	free(r.syms);
+	free(r.exprs);
+	free(r.props);
+	free(r.menus);
+	free(buf);
+
+	return ret;
+}
+
+bool conf_cache_load(const char *name)
+{
+	static bool registered;
+
+	cache_file = getenv("KCONFIG_PARSE_CACHE");
+	if (!cache_file || !*cache_file) {
+		cache_file = NULL;
+		return false;
+	}
+
+	if (cache_load(name))
+		return true;
+
+	cache_broken = false;
+	cache_log_start();
+	if (!registered) {
+		atexit(cache_log_exit);
+		registered = true;
+	}
+	return false;
+}
@@ -129,6 +129,12 @@ struct symbol {
 	 * "Weak" reverse dependencies through being implied by other symbols
 	 */
 	struct expr_value implied;
+
+	/*
+	 * E_LIST of the symbols whose value is calculated from this one, set
+	 * up on first use by sym_clear_valid()
+	 */
+	struct expr *rdeps;
 };
 
 #define for_all_symbols(i, sym) for (i = 0; i < SYMBOL_HASHSIZE; i++) for (sym = symbol_hash[i]; sym; sym = sym->next)
@@ -144,6 +150,7 @@ struct symbol {
 #define SYMBOL_WRITTEN    0x0800  /* track info to avoid double-write to .config */
 #define SYMBOL_NO_WRITE   0x1000  /* Symbol for internal use only; it will not be written */
 #define SYMBOL_CHECKED    0x2000  /* used during dependency checking */
+#define SYMBOL_INVALIDATE 0x4000  /* used by sym_clear_valid() */
 #define SYMBOL_WARNED     0x8000  /* warning has been issued */
 
 /* Set when symbol.def[] is used */
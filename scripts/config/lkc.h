@@ -40,6 +40,14 @@ int zconf_lineno(void);
 const char *zconf_curname(void);
 extern int recursive_is_error;
 
+/* cache.c */
+bool conf_cache_load(const char *name);
+void conf_cache_save(const char *name);
+void conf_cache_add_env(const char *name, const char *value);
+void conf_cache_add_shell(const char *cmd, const char *output);
+void conf_cache_add_source(const char *pattern);
+void conf_cache_disable(void);
+
 /* confdata.c */
 const char *conf_get_configname(void);
 void set_all_choice_values(struct symbol *csym);
@@ -619,10 +619,10 @@ static const yytype_int16 yyrline[] =
      256,   258,   259,   260,   263,   269,   276,   282,   287,   295,
      296,   297,   298,   301,   302,   305,   306,   307,   311,   319,
      327,   330,   335,   342,   347,   355,   358,   360,   361,   364,
-     373,   380,   383,   385,   390,   396,   408,   415,   422,   424,
-     429,   430,   431,   434,   435,   438,   439,   440,   441,   442,
-     443,   444,   445,   446,   447,   448,   452,   454,   455,   458,
-     459,   463,   466,   467,   468,   472,   473
+     374,   381,   384,   386,   391,   397,   409,   416,   423,   425,
+     430,   431,   432,   435,   436,   439,   440,   441,   442,   443,
+     444,   445,   446,   447,   448,   449,   453,   455,   456,   459,
+     460,   464,   467,   468,   469,   473,   474
 };
 #endif
 
@@ -1592,6 +1592,7 @@ yyreduce:
   case 69: /* source_stmt: T_SOURCE T_WORD_QUOTE T_EOL  */
 {
 	printd(DEBUG_PARSE, "%s:%d:source %s\n", zconf_curname(), zconf_lineno(), (yyvsp[-1].string));
+	conf_cache_add_source((yyvsp[-1].string));
 	zconf_nextfile((yyvsp[-1].string));
 	free((yyvsp[-1].string));
 }
@@ -1938,6 +1939,11 @@ void conf_parse(const char *name)
 	struct symbol *sym;
 	int i;
 
+	if (conf_cache_load(name)) {
+		conf_set_changed(true);
+		return;
+	}
+
 	zconf_initscan(name);
 
 	_menu_init();
@@ -1968,6 +1974,7 @@ void conf_parse(const char *name)
 	}
 	if (yynerrs)
 		exit(1);
+	conf_cache_save(name);
 	conf_set_changed(true);
 }
 
@@ -364,6 +364,7 @@ menu_option_list:
 source_stmt: T_SOURCE T_WORD_QUOTE T_EOL
 {
 	printd(DEBUG_PARSE, "%s:%d:source %s\n", zconf_curname(), zconf_lineno(), $2);
+	conf_cache_add_source($2);
 	zconf_nextfile($2);
 	free($2);
 };
@@ -480,6 +481,11 @@ void conf_parse(const char *name)
 	struct symbol *sym;
 	int i;
 
+	if (conf_cache_load(name)) {
+		conf_set_changed(true);
+		return;
+	}
+
 	zconf_initscan(name);
 
 	_menu_init();
@@ -510,6 +516,7 @@ void conf_parse(const char *name)
 	}
 	if (yynerrs)
 		exit(1);
+	conf_cache_save(name);
 	conf_set_changed(true);
 }
 
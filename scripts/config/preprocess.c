@@ -41,7 +41,7 @@ struct env {
 	struct list_head node;
 };
 
-static void env_add(const char *name, const char *value)
+void env_add(const char *name, const char *value)
 {
 	struct env *e;
 
@@ -75,6 +75,7 @@ static char *env_expand(const char *name)
 	}
 
 	value = getenv(name);
+	conf_cache_add_env(name, value);
 	if (!value)
 		return NULL;
 
@@ -124,6 +125,8 @@ static char *do_filename(int argc, char *argv[])
 
 static char *do_info(int argc, char *argv[])
 {
+	/* stdout is not captured, the cache could not repeat this */
+	conf_cache_disable();
 	printf("%s\n", argv[0]);
 
 	return xstrdup("");
@@ -138,16 +141,14 @@ static char *do_lineno(int argc, char *argv[])
 	return xstrdup(buf);
 }
 
-static char *do_shell(int argc, char *argv[])
+/* The returned pointer must be freed when done */
+char *shell_expand(const char *cmd)
 {
 	FILE *p;
 	char buf[4096];
-	char *cmd;
 	size_t nread;
 	int i;
 
-	cmd = argv[0];
-
 	p = popen(cmd, "r");
 	if (!p) {
 		perror(cmd);
@@ -178,6 +179,16 @@ static char *do_shell(int argc, char *argv[])
 	return xstrdup(buf);
 }
 
+static char *do_shell(int argc, char *argv[])
+{
+	char *res;
+
+	res = shell_expand(argv[0]);
+	conf_cache_add_shell(argv[0], res);
+
+	return res;
+}
+
 static char *do_warning_if(int argc, char *argv[])
 {
 	if (!strcmp(argv[0], "y"))
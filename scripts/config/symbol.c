@@ -5,6 +5,7 @@
 
 #include <sys/types.h>
 #include <ctype.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <regex.h>
@@ -454,6 +455,257 @@ void sym_clear_all_valid(void)
 	sym_calc_value(modules_sym);
 }
 
+/* a choice and its values are calculated together, as one */
+static struct symbol *sym_choice_group(struct symbol *sym)
+{
+	if (sym_is_choice_value(sym))
+		return prop_get_symbol(sym_get_choice_prop(sym));
+	return sym;
+}
+
+static void sym_add_rdep(struct symbol *sym, struct symbol *dep)
+{
+	struct expr *e;
+
+	if (!dep || dep->flags & SYMBOL_CONST)
+		return;
+	dep = sym_choice_group(dep);
+	/* all inputs of one symbol are added in a row */
+	if (dep->rdeps && dep->rdeps->right.sym == sym)
+		return;
+
+	e = expr_alloc_one(E_LIST, dep->rdeps);
+	e->right.sym = sym;
+	dep->rdeps = e;
+}
+
+static void expr_add_rdeps(struct expr *e, struct symbol *sym)
+{
+	for (; e; e = e->left.expr) {
+		switch (e->type) {
+		case E_SYMBOL:
+			sym_add_rdep(sym, e->left.sym);
+			return;
+		case E_EQUAL:
+		case E_UNEQUAL:
+		case E_LTH:
+		case E_LEQ:
+		case E_GTH:
+		case E_GEQ:
+		case E_RANGE:
+			sym_add_rdep(sym, e->left.sym);
+			sym_add_rdep(sym, e->right.sym);
+			return;
+		case E_LIST:
+			sym_add_rdep(sym, e->right.sym);
+			break;
+		case E_OR:
+		case E_AND:
+			expr_add_rdeps(e->right.expr, sym);
+			break;
+		case E_NOT:
+			break;
+		default:
+			return;
+		}
+	}
+}
+
+static int sym_ptr_cmp(const void *a, const void *b)
+{
+	uintptr_t x = (uintptr_t)*(struct symbol * const *)a;
+	uintptr_t y = (uintptr_t)*(struct symbol * const *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+/*
+ * Look for dependency loops, as strongly connected components of the
+ * rdeps graph (Tarjan's algorithm, without recursion). Each choice block
+ * is one node, they only are a loop if they depend on themselves from
+ * outside.
+ */
+static bool sym_find_loops(void)
+{
+	struct symbol **syms, **found, *sym;
+	struct expr **edge;
+	int *index, *low, *stack, *calls;
+	char *on_stack;
+	int i, n = 0, next = 1, sp = 0, cp, v, w;
+	bool loop = false;
+
+	for_all_symbols(i, sym)
+		n++;
+	if (!n)
+		return false;
+	syms = xmalloc(n * sizeof(*syms));
+	n = 0;
+	for_all_symbols(i, sym)
+		syms[n++] = sym;
+	qsort(syms, n, sizeof(*syms), sym_ptr_cmp);
+
+	index = xcalloc(n, sizeof(*index));
+	low = xmalloc(n * sizeof(*low));
+	stack = xmalloc(n * sizeof(*stack));
+	calls = xmalloc(n * sizeof(*calls));
+	edge = xmalloc(n * sizeof(*edge));
+	on_stack = xcalloc(n, sizeof(*on_stack));
+
+	for (i = 0; i < n && !loop; i++) {
+		if (index[i])
+			continue;
+
+		calls[0] = i;
+		cp = 1;
+		while (cp && !loop) {
+			v = calls[cp - 1];
+			if (!index[v]) {
+				index[v] = low[v] = next++;
+				edge[v] = syms[v]->rdeps;
+				stack[sp++] = v;
+				on_stack[v] = 1;
+			}
+
+			if (edge[v]) {
+				sym = sym_choice_group(edge[v]->right.sym);
+				edge[v] = edge[v]->left.expr;
+				found = bsearch(&sym, syms, n, sizeof(*syms),
+						sym_ptr_cmp);
+				if (!found)
+					continue;
+				w = found - syms;
+				if (w == v)
+					loop = !sym_is_choice(sym);
+				else if (!index[w])
+					calls[cp++] = w;
+				else if (on_stack[w] && index[w] < low[v])
+					low[v] = index[w];
+				continue;
+			}
+
+			if (--cp && low[v] < low[calls[cp - 1]])
+				low[calls[cp - 1]] = low[v];
+			if (low[v] != index[v])
+				continue;
+			/* more than one symbol in the component */
+			if (stack[sp - 1] != v)
+				loop = true;
+			do {
+				w = stack[--sp];
+				on_stack[w] = 0;
+			} while (w != v);
+		}
+	}
+
+	free(on_stack);
+	free(edge);
+	free(calls);
+	free(stack);
+	free(low);
+	free(index);
+	free(syms);
+
+	return loop;
+}
+
+/*
+ * Record for every symbol which others read it when their value is
+ * calculated, for a choice block on the choice symbol. Selects and implies
+ * are left out, they are part of the rev_dep and implied expressions of
+ * their targets, and so is the P_SYMBOL property pointing back to the
+ * symbol itself. The P_CHOICE ones only link a choice block together.
+ */
+static void sym_calc_rdeps(void)
+{
+	struct property *prop;
+	struct symbol *sym;
+	int i;
+
+	for_all_symbols(i, sym) {
+		for (prop = sym->prop; prop; prop = prop->next) {
+			if (prop->type == P_SELECT || prop->type == P_IMPLY ||
+			    prop->type == P_SYMBOL || prop->type == P_CHOICE)
+				continue;
+			expr_add_rdeps(prop->visible.expr, sym);
+			expr_add_rdeps(prop->expr, sym);
+		}
+		expr_add_rdeps(sym->dir_dep.expr, sym);
+		expr_add_rdeps(sym->rev_dep.expr, sym);
+		expr_add_rdeps(sym->implied.expr, sym);
+	}
+}
+
+static struct symbol **invalidate_stack;
+static int invalidate_count, invalidate_alloc;
+
+static void sym_invalidate_add(struct symbol *sym)
+{
+	if (sym->flags & SYMBOL_INVALIDATE)
+		return;
+	if (invalidate_count == invalidate_alloc) {
+		invalidate_alloc = invalidate_alloc ? invalidate_alloc * 2 : 64;
+		invalidate_stack = xrealloc(invalidate_stack,
+				invalidate_alloc * sizeof(*invalidate_stack));
+	}
+	invalidate_stack[invalidate_count++] = sym;
+	sym->flags |= SYMBOL_INVALIDATE;
+}
+
+/*
+ * Like sym_clear_all_valid(), after only the user value of sym changed:
+ * invalidate sym and whatever is calculated from it, directly or not.
+ */
+static void sym_clear_valid(struct symbol *sym)
+{
+	static bool rdeps_done, loops;
+	struct symbol *dep;
+	struct expr *e;
+	int i;
+
+	if (!rdeps_done) {
+		sym_calc_rdeps();
+		loops = sym_find_loops();
+		rdeps_done = true;
+	}
+
+	/*
+	 * The values in a loop depend on where it is entered from, which
+	 * anything can change, recalculate all then, as before.
+	 */
+	if (loops) {
+		sym_clear_all_valid();
+		return;
+	}
+
+	invalidate_count = 0;
+	sym_invalidate_add(sym);
+	for (i = 0; i < invalidate_count; i++) {
+		sym = invalidate_stack[i];
+		/* its value changes the type of every tristate symbol */
+		if (sym == modules_sym)
+			break;
+		expr_list_for_each_sym(sym->rdeps, e, dep)
+			sym_invalidate_add(dep);
+
+		sym_invalidate_add(sym_choice_group(sym));
+		if (sym_is_choice(sym))
+			expr_list_for_each_sym(sym_get_choice_prop(sym)->expr, e, dep)
+				sym_invalidate_add(dep);
+	}
+
+	if (i < invalidate_count) {
+		for (i = 0; i < invalidate_count; i++)
+			invalidate_stack[i]->flags &= ~SYMBOL_INVALIDATE;
+		sym_clear_all_valid();
+		return;
+	}
+
+	for (i = 0; i < invalidate_count; i++)
+		invalidate_stack[i]->flags &= ~(SYMBOL_VALID | SYMBOL_INVALIDATE);
+	conf_set_changed(true);
+	sym_calc_value(modules_sym);
+}
+
 bool sym_tristate_within_range(struct symbol *sym, tristate val)
 {
 	int type = sym_get_type(sym);
@@ -504,7 +756,7 @@ bool sym_set_tristate_value(struct symbol *sym, tristate val)
 
 	sym->def[S_DEF_USER].tri = val;
 	if (oldval != val)
-		sym_clear_all_valid();
+		sym_clear_valid(sym);
 
 	return true;
 }
@@ -661,7 +913,7 @@ bool sym_set_string_value(struct symbol *sym, const char *newval)
 
 	strcpy(val, newval);
 	free((void *)oldval);
-	sym_clear_all_valid();
+	sym_clear_valid(sym);
 
 	return true;
 }
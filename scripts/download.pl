@@ -11,8 +11,11 @@ use strict;
 use warnings;
 use File::Basename;
 use File::Copy;
-use File::Path;
+use File::Path qw(make_path);
+use Fcntl qw(:flock);
+use IO::Socket::INET;
 use Text::ParseWords;
+use Time::HiRes;
 use JSON::PP;
 
 @ARGV > 2 or die "Syntax: $0 <target dir> <filename> <hash> <url filename> [<mirror> ...]\n";
@@ -28,6 +31,8 @@ my $ok;
 
 my $check_certificate = $ENV{DOWNLOAD_CHECK_CERTIFICATE} eq "y";
 my $custom_tool = $ENV{DOWNLOAD_TOOL_CUSTOM};
+my $parallel = ($ENV{DOWNLOAD_PARALLEL} || "") eq "y";
+my $host_jobs = $ENV{DOWNLOAD_HOST_JOBS} || 4;
 my $download_tool;
 
 $url_filename or $url_filename = $filename;
@@ -67,12 +72,79 @@ sub projectsmirrors {
 	local $/;
 	my $mirror_json = <PM>;
 	my $mirror = decode_json $mirror_json;
+	my @list = @{$mirror->{$project} || []};
 
-	foreach (@{$mirror->{$project}}) {
+	@list = sort_mirrors(@list) if $parallel and @list > 1;
+
+	foreach (@list) {
 		push @mirrors, $_ . "/" . ($append or "");
 	}
 }
 
+sub mirror_host {
+	my $url = shift;
+
+	$url =~ m!^(\w+)://(?:[^/\@]*\@)?([^/:]+)(?::(\d+))?! or return;
+	return ($2, $3 || ($1 eq "http" ? 80 : 443));
+}
+
+# Order mirrors by the time it takes to connect to them. Results are kept
+# in $TMPDIR for an hour, so that concurrent downloads don't all probe the
+# same servers again.
+sub sort_mirrors {
+	my @list = @_;
+	my $cache = "$ENV{'TMPDIR'}/mirror-latency";
+	my (%latency, $fh);
+	local $/ = "\n";
+
+	$ENV{'TMPDIR'} or return @list;
+	open($fh, '+>>', $cache) or return @list;
+	flock($fh, LOCK_EX);
+	seek($fh, 0, 0);
+	while (<$fh>) {
+		my ($host, $time, $val) = split;
+		$latency{$host} = $val if defined($val) and $time > time() - 3600;
+	}
+
+	foreach my $url (@list) {
+		my ($host, $port) = mirror_host($url);
+		next unless $host and not defined $latency{"$host:$port"};
+
+		my $start = Time::HiRes::time();
+		my $sock = IO::Socket::INET->new(PeerAddr => $host, PeerPort => $port,
+			Proto => 'tcp', Timeout => 3);
+		my $val = $sock ? Time::HiRes::time() - $start : 999;
+		$sock and close($sock);
+
+		$latency{"$host:$port"} = $val;
+		printf $fh "%s %d %.3f\n", "$host:$port", time(), $val;
+	}
+	close($fh);
+
+	return map { $_->[1] } sort { $a->[0] <=> $b->[0] }
+		map { [ $latency{join(":", mirror_host($_))} // 999, $_ ] } @list;
+}
+
+# Hold one of DOWNLOAD_HOST_JOBS slots for the server while downloading
+# from it, waiting for one to become free if all of them are taken.
+sub host_slot {
+	my ($host) = mirror_host(shift);
+	my $dir = "$ENV{'TMPDIR'}/dl-hosts";
+	my $fh;
+
+	$host and $ENV{'TMPDIR'} or return;
+	make_path($dir);
+	foreach my $slot (1 .. $host_jobs) {
+		open($fh, '>', "$dir/$host.$slot") or return;
+		return $fh if flock($fh, LOCK_EX | LOCK_NB);
+		close($fh);
+	}
+
+	open($fh, '>', "$dir/$host." . (1 + int(rand($host_jobs)))) or return;
+	flock($fh, LOCK_EX);
+	return $fh;
+}
+
 sub which($) {
 	my $prog = shift;
 	my $res = `command -v $prog`;
@@ -119,6 +191,27 @@ sub select_tool {
 	return "wget";
 }
 
+# Downloads straight to <file>.part, continuing from whatever an earlier
+# attempt (from any mirror) left there. Stalled transfers are given up on,
+# so that the next mirror can pick up where this one stopped.
+sub resume_cmd {
+	my $url = shift;
+	my $output = shift;
+
+	if ($download_tool eq "curl") {
+		return (qw(curl -f --connect-timeout 20 --retry 5 --location -C -),
+			qw(--speed-limit 1024 --speed-time 60 --silent --show-error),
+			$check_certificate ? () : '--insecure',
+			shellwords($ENV{CURL_OPTIONS} || ''),
+			'--output', $output, $url);
+	} else {
+		return (qw(wget --tries=5 --timeout=20 --continue),
+			$check_certificate ? () : '--no-check-certificate',
+			shellwords($ENV{WGET_OPTIONS} || ''),
+			"--output-document=$output", $url);
+	}
+}
+
 sub download_cmd {
 	my $url = shift;
 	my $filename = shift;
@@ -208,6 +301,35 @@ sub download
 				return;
 			}
 		};
+	} elsif ($parallel and ($download_tool eq "curl" or $download_tool eq "wget")) {
+		my $slot = host_slot($mirror);
+		my @cmd = resume_cmd("$mirror/$download_filename", "$target/$filename.part");
+
+		make_path($target) unless -d $target;
+		print STDERR "+ ".join(" ",@cmd)."\n";
+		my $ret = system(@cmd) >> 8;
+
+		# the server can't resume, start over (curl only, wget does so by itself)
+		if ($download_tool eq "curl" and ($ret == 33 or $ret == 36)) {
+			unlink "$target/$filename.part";
+			$ret = system(@cmd) >> 8;
+		}
+		$slot and close($slot);
+
+		if ($ret) {
+			print STDERR "Download failed.\n";
+			cleanup();
+			return;
+		}
+
+		move("$target/$filename.part", "$target/$filename.dl");
+		$hash_cmd and do {
+			if (system("cat '$target/$filename.dl' | $hash_cmd > '$target/$filename.hash'")) {
+				print("Failed to generate hash for $filename\n");
+				cleanup();
+				return;
+			}
+		};
 	} else {
 		my @cmd = download_cmd("$mirror/$download_filename", $download_filename, @additional_mirrors);
 		print STDERR "+ ".join(" ",@cmd)."\n";
@@ -0,0 +1,148 @@
+#!/usr/bin/env perl
+#
+# Print the shared libraries needed by the ELF executables and shared
+# objects among the NUL separated paths on stdin, followed by the kernel
+# modules the *.ko files among them depend on, each list sorted and
+# without duplicates.
+#
+# Used by scripts/gen-dependencies.sh in place of running file and
+# readelf for every file, and objcopy and sed for every module.
+#
+
+use strict;
+use warnings;
+
+sub elf_unpack {
+	my ($le) = @_;
+	return $le ? ('v', 'V', 'Q<') : ('n', 'N', 'Q>');
+}
+
+sub read_at {
+	my ($fh, $off, $len) = @_;
+	my $buf;
+
+	seek($fh, $off, 0) or return;
+	(read($fh, $buf, $len) // 0) == $len or return;
+	return $buf;
+}
+
+# DT_NEEDED entries, found through the program headers as readelf -d
+# does, so that binaries without section headers are covered as well
+sub elf_needed {
+	my ($fh, $is64, $le, $hdr) = @_;
+	my ($u16, $u32, $u64) = elf_unpack($le);
+	my ($phoff, $phentsize, $phnum, $buf, $dyn, $strtab, @load, @needed);
+
+	if ($is64) {
+		$phoff = unpack($u64, substr($hdr, 0x20, 8));
+		($phentsize, $phnum) = unpack("$u16$u16", substr($hdr, 0x36, 4));
+	} else {
+		$phoff = unpack($u32, substr($hdr, 0x1c, 4));
+		($phentsize, $phnum) = unpack("$u16$u16", substr($hdr, 0x2a, 4));
+	}
+	return unless $phoff and $phnum and $phentsize >= ($is64 ? 56 : 32);
+
+	$buf = read_at($fh, $phoff, $phentsize * $phnum) // return;
+	foreach my $i (0 .. $phnum - 1) {
+		my $ent = substr($buf, $i * $phentsize, $phentsize);
+		# type, offset, vaddr, filesz
+		my @ph = $is64 ?
+			(unpack($u32, substr($ent, 0, 4)), unpack("$u64$u64", substr($ent, 8, 16)), unpack($u64, substr($ent, 32, 8))) :
+			(unpack($u32, substr($ent, 0, 4)), unpack("$u32$u32", substr($ent, 4, 8)), unpack($u32, substr($ent, 16, 4)));
+
+		push @load, \@ph if $ph[0] == 1;	# PT_LOAD
+		$dyn = \@ph if $ph[0] == 2;		# PT_DYNAMIC
+	}
+	return unless $dyn;
+
+	my $entsize = $is64 ? 16 : 8;
+	$buf = read_at($fh, $dyn->[1], $dyn->[3]) // return;
+	for (my $pos = 0; $pos + $entsize <= length($buf); $pos += $entsize) {
+		my ($tag, $val) = unpack($is64 ? "$u64$u64" : "$u32$u32", substr($buf, $pos, $entsize));
+		last if $tag == 0;
+		push @needed, $val if $tag == 1;	# DT_NEEDED
+		$strtab = $val if $tag == 5;		# DT_STRTAB
+	}
+	return unless defined $strtab;
+
+	# DT_STRTAB is an address, find its place in the file
+	my ($seg) = grep { $strtab >= $_->[2] and $strtab < $_->[2] + $_->[3] } @load or return;
+	$strtab = $seg->[1] + $strtab - $seg->[2];
+
+	my @names;
+	foreach my $val (@needed) {
+		my $name = read_at($fh, $strtab + $val, 256);
+		defined($name) or $name = read_at($fh, $strtab + $val, $seg->[1] + $seg->[3] - $strtab - $val);
+		defined($name) and $name =~ /^([^\0]*)/ and push @names, $1;
+	}
+	return @names;
+}
+
+# the depends= entry of the .modinfo section
+sub kmod_depends {
+	my ($fh, $is64, $le, $hdr) = @_;
+	my ($u16, $u32, $u64) = elf_unpack($le);
+	my ($shoff, $shentsize, $shnum, $shstrndx, $buf, @sh);
+
+	if ($is64) {
+		$shoff = unpack($u64, substr($hdr, 0x28, 8));
+		($shentsize, $shnum, $shstrndx) = unpack("$u16$u16$u16", substr($hdr, 0x3a, 6));
+	} else {
+		$shoff = unpack($u32, substr($hdr, 0x20, 4));
+		($shentsize, $shnum, $shstrndx) = unpack("$u16$u16$u16", substr($hdr, 0x2e, 6));
+	}
+	return unless $shoff and $shnum and $shstrndx < $shnum and $shentsize >= ($is64 ? 64 : 40);
+
+	$buf = read_at($fh, $shoff, $shentsize * $shnum) // return;
+	foreach my $i (0 .. $shnum - 1) {
+		my $ent = substr($buf, $i * $shentsize, $shentsize);
+		# name, offset, size
+		push @sh, $is64 ?
+			[ unpack($u32, substr($ent, 0, 4)), unpack("$u64$u64", substr($ent, 24, 16)) ] :
+			[ unpack($u32, substr($ent, 0, 4)), unpack("$u32$u32", substr($ent, 16, 8)) ];
+	}
+
+	my $names = read_at($fh, $sh[$shstrndx]->[1], $sh[$shstrndx]->[2]) // return;
+	my ($modinfo) = grep {
+		substr($names, $_->[0]) =~ /^\.modinfo\0/
+	} @sh or return;
+
+	my $info = read_at($fh, $modinfo->[1], $modinfo->[2]) // return;
+	foreach my $entry (split /\0/, $info) {
+		next unless $entry =~ /^depends=(.+)$/;
+		return map { "$_.ko" } grep { length } split /,/, $1;
+	}
+	return;
+}
+
+my (%libs, %kmods);
+
+$/ = "\0";
+while (my $file = <STDIN>) {
+	chomp $file;
+
+	-f $file and not -l $file or next;
+	open(my $fh, '<', $file) or next;
+	binmode($fh);
+
+	my $hdr;
+	if ((read($fh, $hdr, 64) // 0) >= 52 and substr($hdr, 0, 4) eq "\x7fELF") {
+		my ($class, $data) = unpack("CC", substr($hdr, 4, 2));
+		my $type = unpack($data == 1 ? 'v' : 'n', substr($hdr, 16, 2));
+
+		if ($class == 1 or $class == 2) {
+			if ($type == 2 or $type == 3) {
+				# executable or shared object
+				$libs{$_} = 1 foreach grep { /^lib.*\.so/ }
+					elf_needed($fh, $class == 2, $data == 1, $hdr);
+			}
+			if ($file =~ /\.ko$/) {
+				$kmods{$_} = 1 foreach kmod_depends($fh, $class == 2, $data == 1, $hdr);
+			}
+		}
+	}
+	close($fh);
+}
+
+print "$_\n" foreach sort keys %libs;
+print "$_\n" foreach sort keys %kmods;
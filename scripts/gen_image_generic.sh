@@ -31,30 +31,52 @@ ROOTFSSIZE="$(($4 / 512))"
 # Using mcopy -s ... is using READDIR(3) to iterate through the directory
 # entries, hence they end up in the FAT filesystem in traversal order which
 # breaks reproducibility.
-# Implement recursive copy with reproducible order.
+# Implement recursive copy with reproducible order. Consecutive files of a
+# directory are copied with one mcopy, which keeps the order of the entries
+# and of their clusters the same as copying them one by one.
 dos_dircopy() {
   local entry
   local baseentry
-  for entry in "$1"/* ; do
+  local src="$1"
+  local dst="$2"
+  set --
+  for entry in "$src"/* ; do
     if [ -f "$entry" ]; then
-      mcopy -i "$OUTPUT.kernel" "$entry" ::"$2"
+      set -- "$@" "$entry"
     elif [ -d "$entry" ]; then
+      [ $# -gt 0 ] && mcopy -i "$FATIMAGE" "$@" ::"$dst"
+      set --
       baseentry="$(basename "$entry")"
-      mmd -i "$OUTPUT.kernel" ::"$2""$baseentry"
-      dos_dircopy "$entry" "$2""$baseentry"/
+      mmd -i "$FATIMAGE" ::"$dst""$baseentry"
+      dos_dircopy "$entry" "$dst""$baseentry"/
     fi
   done
+  [ $# -gt 0 ] && mcopy -i "$FATIMAGE" "$@" ::"$dst"
+  return 0
 }
 
-[ -n "$PADDING" ] && dd if=/dev/zero of="$OUTPUT" bs=512 seek="$ROOTFSOFFSET" conv=notrunc count="$ROOTFSSIZE"
-dd if="$ROOTFSIMAGE" of="$OUTPUT" bs=512 seek="$ROOTFSOFFSET" conv=notrunc
+# copy a file into the image at a sector offset, in large blocks and without
+# writing out the zeroes
+image_write() {
+  dd if="$1" of="$OUTPUT" bs=4M oflag=seek_bytes seek="$(($2 * 512))" conv=notrunc,sparse
+}
+
+# nothing but zeroes to write, the padding only has to extend the image
+image_pad() {
+  truncate -s ">$(($1 * 512))" "$OUTPUT"
+}
+
+[ -n "$PADDING" ] && image_pad "$((ROOTFSOFFSET + ROOTFSSIZE))"
+image_write "$ROOTFSIMAGE" "$ROOTFSOFFSET"
 
 if [ -n "$GUID" ]; then
-    [ -n "$PADDING" ] && dd if=/dev/zero of="$OUTPUT" bs=512 seek="$((ROOTFSOFFSET + ROOTFSSIZE))" conv=notrunc count="$sect"
-    mkfs.fat --invariant -n kernel -C "$OUTPUT.kernel" -S 512 "$((KERNELSIZE / 1024))"
+    [ -n "$PADDING" ] && image_pad "$((ROOTFSOFFSET + ROOTFSSIZE + sect))"
+    # the FAT filesystem is created and filled in place
+    mkfs.fat --invariant -n kernel --offset "$KERNELOFFSET" -h 0 -S 512 "$OUTPUT" "$((KERNELSIZE / 1024))"
+    FATIMAGE="$OUTPUT@@$((KERNELOFFSET * 512))"
     LC_ALL=C dos_dircopy "$KERNELDIR" /
 else
     make_ext4fs -J -L kernel -l "$KERNELSIZE" ${SOURCE_DATE_EPOCH:+-T ${SOURCE_DATE_EPOCH}} "$OUTPUT.kernel" "$KERNELDIR"
+    image_write "$OUTPUT.kernel" "$KERNELOFFSET"
+    rm -f "$OUTPUT.kernel"
 fi
-dd if="$OUTPUT.kernel" of="$OUTPUT" bs=512 seek="$KERNELOFFSET" conv=notrunc
-rm -f "$OUTPUT.kernel"
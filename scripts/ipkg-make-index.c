@@ -0,0 +1,625 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * ipkg-make-index - generate an opkg Packages index
+ *
+ * Drop-in replacement for the loop in ipkg-make-index.sh: the control file
+ * is pulled out of the ipk (tar.gz or ar) directly, packages are hashed on
+ * all cores and entries for unchanged files (same size and mtime) are taken
+ * from an optional cache. Output is identical to the shell version.
+ */
+
+#define _GNU_SOURCE
+#define MKHASH_NO_MAIN
+#include "mkhash.c"
+
+#include <sys/types.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <zlib.h>
+
+#ifdef __APPLE__
+#define st_mtim st_mtimespec
+#endif
+
+#define TAR_BLOCK	512
+#define CACHE_MAGIC	"ipkg-make-index cache 1\n"
+
+struct pkg {
+	char *path;
+	long long size;
+	long long mtime_sec;
+	long mtime_nsec;
+	char *entry;
+	size_t entry_len;
+};
+
+struct archive {
+	int (*read)(struct archive *a, void *buf, size_t len);
+	int (*skip)(struct archive *a, size_t len);
+	gzFile gz;
+	const unsigned char *data;
+	size_t len, pos;
+};
+
+static struct pkg *pkgs, *cache;
+static int n_pkgs, n_cache;
+static int next_pkg;
+static bool empty = true, failed;
+static pthread_mutex_t pkg_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int gz_read(struct archive *a, void *buf, size_t len)
+{
+	return gzread(a->gz, buf, len) == (int)len ? 0 : -1;
+}
+
+static int gz_skip(struct archive *a, size_t len)
+{
+	return gzseek(a->gz, len, SEEK_CUR) < 0 ? -1 : 0;
+}
+
+static int mem_read(struct archive *a, void *buf, size_t len)
+{
+	if (a->len - a->pos < len)
+		return -1;
+
+	memcpy(buf, a->data + a->pos, len);
+	a->pos += len;
+	return 0;
+}
+
+static int mem_skip(struct archive *a, size_t len)
+{
+	if (a->len - a->pos < len)
+		return -1;
+
+	a->pos += len;
+	return 0;
+}
+
+static long long parse_num(const char *s, int len, int base)
+{
+	long long val = 0;
+	int i;
+
+	for (i = 0; i < len && s[i] == ' '; i++);
+
+	for (; i < len && s[i] >= '0' && s[i] < '0' + base; i++)
+		val = val * base + s[i] - '0';
+
+	return val;
+}
+
+static bool member_match(const char *name, const char *member)
+{
+	if (!strncmp(name, "./", 2))
+		name += 2;
+
+	return !strcmp(name, member);
+}
+
+static void *read_member(struct archive *a, size_t len)
+{
+	char *buf;
+
+	buf = malloc(len + 1);
+	if (!buf)
+		return NULL;
+
+	if (a->read(a, buf, len)) {
+		free(buf);
+		return NULL;
+	}
+
+	buf[len] = 0;
+	return buf;
+}
+
+/* returns the (NUL terminated) contents of a tar member */
+static void *tar_find(struct archive *a, const char *member, size_t *len)
+{
+	unsigned char hdr[TAR_BLOCK];
+	char name[257], *longname = NULL;
+	long long size;
+	size_t pad;
+
+	while (!a->read(a, hdr, sizeof(hdr))) {
+		if (!hdr[0])
+			break;
+
+		size = parse_num((char *)hdr + 124, 12, 8);
+		pad = (TAR_BLOCK - (size % TAR_BLOCK)) % TAR_BLOCK;
+
+		if (hdr[156] == 'L') {
+			free(longname);
+			longname = read_member(a, size);
+			if (!longname || a->skip(a, pad))
+				break;
+			continue;
+		}
+
+		if (longname) {
+			snprintf(name, sizeof(name), "%s", longname);
+			free(longname);
+			longname = NULL;
+		} else if (!memcmp(hdr + 257, "ustar", 5) && hdr[345]) {
+			snprintf(name, sizeof(name), "%.155s/%.100s",
+				 (char *)hdr + 345, (char *)hdr);
+		} else {
+			snprintf(name, sizeof(name), "%.100s", (char *)hdr);
+		}
+
+		if ((hdr[156] == '0' || !hdr[156]) && member_match(name, member)) {
+			*len = size;
+			return read_member(a, size);
+		}
+
+		if (a->skip(a, size + pad))
+			break;
+	}
+
+	free(longname);
+	return NULL;
+}
+
+/* returns the contents of an ar member, as used by opkg-build */
+static void *ar_find(int fd, const char *member, size_t *len)
+{
+	char hdr[60], name[17];
+	long long size;
+	int i;
+
+	while (read(fd, hdr, sizeof(hdr)) == sizeof(hdr)) {
+		memcpy(name, hdr, 16);
+		for (i = 16; i > 0 && (name[i - 1] == ' ' || name[i - 1] == '/'); i--);
+		name[i] = 0;
+
+		size = parse_num(hdr + 48, 10, 10);
+		if (!strcmp(name, member)) {
+			char *buf = malloc(size + 1);
+
+			if (!buf)
+				return NULL;
+
+			if (read(fd, buf, size) != size) {
+				free(buf);
+				return NULL;
+			}
+
+			buf[size] = 0;
+			*len = size;
+			return buf;
+		}
+
+		if (lseek(fd, size + (size & 1), SEEK_CUR) < 0)
+			break;
+	}
+
+	return NULL;
+}
+
+static void *gunzip(const void *data, size_t len, size_t *out_len)
+{
+	z_stream s = {};
+	size_t size = 4 * len + 1024;
+	unsigned char *buf = NULL, *tmp;
+	int ret;
+
+	if (inflateInit2(&s, 16 + MAX_WBITS) != Z_OK)
+		return NULL;
+
+	s.next_in = (unsigned char *)data;
+	s.avail_in = len;
+
+	do {
+		tmp = realloc(buf, size);
+		if (!tmp)
+			goto error;
+
+		buf = tmp;
+		s.next_out = buf + s.total_out;
+		s.avail_out = size - s.total_out;
+
+		ret = inflate(&s, Z_NO_FLUSH);
+		if (ret != Z_OK && ret != Z_STREAM_END)
+			goto error;
+
+		size *= 2;
+	} while (ret != Z_STREAM_END);
+
+	*out_len = s.total_out;
+	inflateEnd(&s);
+	return buf;
+
+error:
+	inflateEnd(&s);
+	free(buf);
+	return NULL;
+}
+
+static void *ipk_control_tar(int fd, size_t *len)
+{
+	struct archive a = {
+		.read = gz_read,
+		.skip = gz_skip,
+	};
+	char magic[8];
+	void *data;
+
+	if (read(fd, magic, sizeof(magic)) != sizeof(magic))
+		return NULL;
+
+	if (!memcmp(magic, "!<arch>\n", 8))
+		return ar_find(fd, "control.tar.gz", len);
+
+	if (lseek(fd, 0, SEEK_SET) < 0)
+		return NULL;
+
+	a.gz = gzdopen(dup(fd), "rb");
+	if (!a.gz)
+		return NULL;
+
+	data = tar_find(&a, "control.tar.gz", len);
+	gzclose(a.gz);
+
+	return data;
+}
+
+static char *ipk_control(int fd)
+{
+	struct archive a = {
+		.read = mem_read,
+		.skip = mem_skip,
+	};
+	void *tgz, *tar;
+	char *control;
+	size_t len;
+
+	tgz = ipk_control_tar(fd, &len);
+	if (!tgz)
+		return NULL;
+
+	tar = gunzip(tgz, len, &a.len);
+	free(tgz);
+	if (!tar)
+		return NULL;
+
+	a.data = tar;
+	control = tar_find(&a, "control", &len);
+	free(tar);
+
+	return control;
+}
+
+static const char *sha256_fd(int fd)
+{
+	static __thread char str[SHA256_DIGEST_LENGTH * 2 + 1];
+	unsigned char val[SHA256_DIGEST_LENGTH];
+	unsigned char buf[65536];
+	SHA256_CTX ctx;
+	ssize_t len;
+	int i;
+
+	SHA256_Init(&ctx);
+	while ((len = read(fd, buf, sizeof(buf))) > 0)
+		SHA256_Update(&ctx, buf, len);
+	SHA256_Final(val, &ctx);
+
+	if (len < 0)
+		return NULL;
+
+	for (i = 0; i < SHA256_DIGEST_LENGTH; i++)
+		sprintf(&str[i * 2], "%02x", val[i]);
+
+	return str;
+}
+
+static int pkg_index(struct pkg *p)
+{
+	const char *filename = p->path, *hash, *line, *end;
+	char *control, *entry;
+	size_t len;
+	int fd, ret = -1;
+
+	fd = open(p->path, O_RDONLY);
+	if (fd < 0)
+		return -1;
+
+	hash = sha256_fd(fd);
+	if (!hash || lseek(fd, 0, SEEK_SET) < 0)
+		goto out;
+
+	control = ipk_control(fd);
+	if (!control)
+		goto out;
+
+	if (!strncmp(filename, "./", 2))
+		filename += 2;
+
+	/* same as sed "s/^Description:/Filename: ...\nDescription:/" */
+	len = strlen(control) + 1;
+	for (line = control; *line; line = end) {
+		end = strchr(line, '\n');
+		end = end ? end + 1 : line + strlen(line);
+
+		if (!strncmp(line, "Description:", 12))
+			len += strlen(filename) + 128;
+	}
+
+	entry = malloc(len);
+	if (!entry) {
+		free(control);
+		goto out;
+	}
+
+	p->entry = entry;
+	for (line = control; *line; line = end) {
+		end = strchr(line, '\n');
+		end = end ? end + 1 : line + strlen(line);
+
+		if (!strncmp(line, "Description:", 12))
+			entry += sprintf(entry, "Filename: %s\nSize: %lld\nSHA256sum: %s\n",
+					 filename, p->size, hash);
+
+		memcpy(entry, line, end - line);
+		entry += end - line;
+	}
+	*entry++ = '\n';
+	p->entry_len = entry - p->entry;
+	free(control);
+	ret = 0;
+
+out:
+	close(fd);
+	return ret;
+}
+
+static void *pkg_worker(void *arg)
+{
+	struct pkg *p;
+
+	while (1) {
+		pthread_mutex_lock(&pkg_lock);
+		while (next_pkg < n_pkgs && pkgs[next_pkg].entry)
+			next_pkg++;
+		p = next_pkg < n_pkgs && !failed ? &pkgs[next_pkg++] : NULL;
+		pthread_mutex_unlock(&pkg_lock);
+
+		if (!p)
+			break;
+
+		fprintf(stderr, "Generating index for package %s\n", p->path);
+		if (pkg_index(p)) {
+			fprintf(stderr, "Failed to generate index for %s\n", p->path);
+			pthread_mutex_lock(&pkg_lock);
+			failed = true;
+			pthread_mutex_unlock(&pkg_lock);
+		}
+	}
+
+	return NULL;
+}
+
+static int pkg_cmp(const void *a, const void *b)
+{
+	const struct pkg *p1 = a, *p2 = b;
+
+	return strcmp(p1->path, p2->path);
+}
+
+static int pkg_add(const char *path, const struct stat *st, int type,
+		   struct FTW *ftw)
+{
+	const char *name = path + ftw->base;
+	size_t len = strlen(name);
+	struct stat s;
+	struct pkg *p;
+
+	if (type != FTW_F && type != FTW_SL)
+		return 0;
+
+	if (len < 4 || strcmp(name + len - 4, ".ipk"))
+		return 0;
+
+	empty = false;
+	if (!strncmp(name, "kernel_", 7) || !strncmp(name, "libc_", 5))
+		return 0;
+
+	if (stat(path, &s) || S_ISDIR(s.st_mode))
+		return 0;
+
+	pkgs = realloc(pkgs, (n_pkgs + 1) * sizeof(*pkgs));
+	if (!pkgs)
+		return -1;
+
+	p = &pkgs[n_pkgs++];
+	memset(p, 0, sizeof(*p));
+	p->path = strdup(path);
+	p->size = s.st_size;
+	p->mtime_sec = s.st_mtim.tv_sec;
+	p->mtime_nsec = s.st_mtim.tv_nsec;
+
+	return p->path ? 0 : -1;
+}
+
+static void cache_load(const char *file)
+{
+	char magic[sizeof(CACHE_MAGIC)];
+	char *line = NULL;
+	size_t line_len = 0;
+	FILE *f;
+
+	f = fopen(file, "r");
+	if (!f)
+		return;
+
+	if (!fgets(magic, sizeof(magic), f) || strcmp(magic, CACHE_MAGIC))
+		goto out;
+
+	while (getline(&line, &line_len, f) > 0) {
+		struct pkg p = {};
+		size_t entry_len;
+		int ofs;
+
+		if (sscanf(line, "%lld %lld %ld %zu %n", &p.size, &p.mtime_sec,
+			   &p.mtime_nsec, &entry_len, &ofs) != 4)
+			break;
+
+		line[strcspn(line, "\n")] = 0;
+		p.path = strdup(line + ofs);
+		p.entry = malloc(entry_len);
+		p.entry_len = entry_len;
+		if (!p.path || !p.entry ||
+		    fread(p.entry, 1, entry_len, f) != entry_len) {
+			free(p.path);
+			free(p.entry);
+			break;
+		}
+
+		cache = realloc(cache, (n_cache + 1) * sizeof(*cache));
+		if (!cache)
+			break;
+
+		cache[n_cache++] = p;
+	}
+
+	qsort(cache, n_cache, sizeof(*cache), pkg_cmp);
+
+out:
+	free(line);
+	fclose(f);
+}
+
+static void cache_lookup(struct pkg *p)
+{
+	struct pkg *c;
+
+	c = bsearch(p, cache, n_cache, sizeof(*cache), pkg_cmp);
+	if (!c || c->size != p->size || c->mtime_sec != p->mtime_sec ||
+	    c->mtime_nsec != p->mtime_nsec)
+		return;
+
+	p->entry = c->entry;
+	p->entry_len = c->entry_len;
+	c->entry = NULL;
+}
+
+static void cache_save(const char *file)
+{
+	char *tmp;
+	FILE *f;
+	int i;
+
+	if (asprintf(&tmp, "%s.tmp", file) < 0)
+		return;
+
+	f = fopen(tmp, "w");
+	if (!f)
+		goto out;
+
+	fputs(CACHE_MAGIC, f);
+	for (i = 0; i < n_pkgs; i++) {
+		struct pkg *p = &pkgs[i];
+
+		if (!p->entry_len)
+			continue;
+
+		fprintf(f, "%lld %lld %ld %zu %s\n", p->size, p->mtime_sec,
+			p->mtime_nsec, p->entry_len, p->path);
+		fwrite(p->entry, 1, p->entry_len, f);
+	}
+
+	if (fclose(f) || rename(tmp, file))
+		unlink(tmp);
+
+out:
+	free(tmp);
+}
+
+static int usage(const char *progname)
+{
+	fprintf(stderr, "Usage: %s [options] <package_directory>\n"
+		"Options:\n"
+		"	-c <file>	Reuse and update entries cached in <file>\n"
+		"	-j <jobs>	Number of parallel jobs (default: number of CPUs)\n",
+		progname);
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	const char *progname = argv[0], *cache_file = NULL;
+	pthread_t *threads;
+	long jobs = 0;
+	char *pkg_dir;
+	int i, ch;
+
+	while ((ch = getopt(argc, argv, "c:j:")) != -1) {
+		switch (ch) {
+		case 'c':
+			cache_file = optarg;
+			break;
+		case 'j':
+			jobs = strtol(optarg, NULL, 0);
+			break;
+		default:
+			return usage(progname);
+		}
+	}
+
+	if (optind != argc - 1)
+		return usage(progname);
+
+	pkg_dir = argv[optind];
+	for (i = strlen(pkg_dir) - 1; i > 0 && pkg_dir[i] == '/'; i--)
+		pkg_dir[i] = 0;
+
+	if (nftw(pkg_dir, pkg_add, 16, FTW_PHYS)) {
+		fprintf(stderr, "Failed to scan '%s': %s\n", pkg_dir, strerror(errno));
+		return 1;
+	}
+
+	qsort(pkgs, n_pkgs, sizeof(*pkgs), pkg_cmp);
+
+	if (cache_file) {
+		cache_load(cache_file);
+		for (i = 0; i < n_pkgs; i++)
+			if (!pkgs[i].entry)
+				cache_lookup(&pkgs[i]);
+	}
+
+	if (jobs <= 0)
+		jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	if (jobs <= 0)
+		jobs = 1;
+
+	threads = calloc(jobs, sizeof(*threads));
+	if (!threads)
+		return 1;
+
+	for (i = 0; i < jobs; i++)
+		if (pthread_create(&threads[i], NULL, pkg_worker, NULL))
+			break;
+
+	if (!i)
+		pkg_worker(NULL);
+
+	while (i-- > 0)
+		pthread_join(threads[i], NULL);
+
+	if (failed)
+		return 1;
+
+	for (i = 0; i < n_pkgs; i++)
+		fwrite(pkgs[i].entry, 1, pkgs[i].entry_len, stdout);
+
+	if (empty)
+		putchar('\n');
+
+	if (cache_file)
+		cache_save(cache_file);
+
+	return fflush(stdout) ? 1 : 0;
+}
@@ -8,6 +8,16 @@ if [ -z $pkg_dir ] || [ ! -d $pkg_dir ]; then
 	exit 1
 fi
 
+indexer="$STAGING_DIR_HOST/bin/ipkg-make-index"
+if [ -n "$STAGING_DIR_HOST" ] && [ -x "$indexer" ]; then
+	cache=
+	if [ -n "$TMP_DIR" ]; then
+		mkdir -p "$TMP_DIR/ipkg-make-index"
+		cache="$TMP_DIR/ipkg-make-index/$(cd "$pkg_dir" && pwd -P | $MKHASH md5)"
+	fi
+	exec "$indexer" ${cache:+-c "$cache"} "$pkg_dir"
+fi
+
 empty=1
 
 for pkg in `find $pkg_dir -name '*.ipk' | sort`; do
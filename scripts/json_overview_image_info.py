@@ -1,9 +1,10 @@
 #!/usr/bin/env python3
 
-from os import getenv, environ
+from os import getenv, environ, utime
 from pathlib import Path
 from subprocess import run, PIPE
 from sys import argv
+from time import time
 import json
 
 if len(argv) != 2:
@@ -18,6 +19,12 @@ work_dir = Path(getenv("WORK_DIR"))
 
 output = {}
 
+# per device index of the images by name, to merge them in place
+images = {}
+
+# marks when the info files merged into the output were collected
+stamp_path = work_dir / ".profiles-merged"
+
 
 def get_initial_output(image_info):
     # preserve existing profiles.json
@@ -28,22 +35,56 @@ def get_initial_output(image_info):
     return image_info
 
 
-for json_file in work_dir.glob("*.json"):
+def merge_image_info(image_info):
+    # get first and only profile in json file
+    device_id, profile = next(iter(image_info["profiles"].items()))
+    if device_id not in images:
+        existing = output["profiles"].setdefault(device_id, profile)
+        images[device_id] = {e["name"]: e for e in existing["images"]}
+        if existing is profile:
+            return
+
+    # keep last/latest image of a name, in the place of the first one
+    for e in profile["images"]:
+        images[device_id][e["name"]] = e
+
+
+def json_files(since):
+    for json_file in work_dir.glob("*.json"):
+        if since is None or json_file.stat().st_mtime >= since:
+            yield json_file
+
+
+scan_start = time()
+since = None
+if output_path.is_file() and stamp_path.is_file():
+    since = stamp_path.stat().st_mtime
+
+files = list(json_files(since))
+if since is not None:
+    if not files:
+        # nothing new, the existing output is up to date
+        exit(0)
+
+    # only merge the new files into an output of the same version
+    version_code = json.loads(output_path.read_text())["version_code"]
+    if json.loads(files[0].read_text())["version_code"] != version_code:
+        files = list(json_files(None))
+
+for json_file in files:
     image_info = json.loads(json_file.read_text())
 
     if not output:
         output = get_initial_output(image_info)
 
-    # get first and only profile in json file
-    device_id, profile = next(iter(image_info["profiles"].items()))
-    if device_id not in output["profiles"]:
-        output["profiles"][device_id] = profile
-    else:
-        output["profiles"][device_id]["images"].extend(profile["images"])
+    merge_image_info(image_info)
 
-# make image lists unique by name, keep last/latest
+# make image lists unique by name
 for device_id, profile in output.get("profiles", {}).items():
-    profile["images"] = list({e["name"]: e for e in profile["images"]}.values())
+    if device_id in images:
+        profile["images"] = list(images[device_id].values())
+    else:
+        profile["images"] = list({e["name"]: e for e in profile["images"]}.values())
 
 
 if output:
@@ -79,5 +120,7 @@ if output:
         "vermagic": linux_vermagic,
     }
     output_path.write_text(json.dumps(output, sort_keys=True, separators=(",", ":")))
+    stamp_path.touch()
+    utime(stamp_path, (scan_start, scan_start))
 else:
     print("JSON info file script could not find any JSON files for target")
@@ -86,6 +86,7 @@
 #endif
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
 #include <stdbool.h>
@@ -451,6 +452,26 @@ be32dec_vect(uint32_t *dst, const unsigned char *src, size_t len)
 #define Maj(x, y, z)	((x & (y | z)) | (y & z))
 #define ROTR(x, n)	((x >> n) | (x << (32 - n)))
 
+/* SHA256 round constants. */
+static const uint32_t K[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
 /*
  * SHA256 block compression function.  The 256-bit state is transformed via
  * the 512-bit input block to produce a new state.
@@ -458,25 +479,6 @@ be32dec_vect(uint32_t *dst, const unsigned char *src, size_t len)
 static void
 SHA256_Transform(uint32_t * state, const unsigned char block[64])
 {
-	/* SHA256 round constants. */
-	static const uint32_t K[64] = {
-		0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
-		0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
-		0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
-		0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
-		0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
-		0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
-		0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
-		0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
-		0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
-		0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
-		0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
-		0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
-		0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
-		0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
-		0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
-		0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
-	};
 	uint32_t W[64];
 	uint32_t S[8];
 	int i;
@@ -562,6 +564,99 @@ SHA256_Transform(uint32_t * state, const unsigned char block[64])
 		state[i] += S[i];
 }
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+
+/*
+ * Same as SHA256_Transform, using the x86 SHA extensions.  Processes
+ * multiple consecutive blocks without reloading the state.
+ */
+static void __attribute__((target("sha,sse4.1")))
+SHA256_Transform_shani(uint32_t *state, const unsigned char *block, size_t n)
+{
+	const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+					    0x0405060700010203ULL);
+	__m128i abef, cdgh, abef_save, cdgh_save, msg, tmp, W[4];
+	int i;
+
+	/* state is ABCD EFGH, the instructions want ABEF CDGH */
+	tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[0]), 0xb1);
+	cdgh = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)&state[4]), 0x1b);
+	abef = _mm_alignr_epi8(tmp, cdgh, 8);
+	cdgh = _mm_blend_epi16(cdgh, tmp, 0xf0);
+
+	while (n--) {
+		abef_save = abef;
+		cdgh_save = cdgh;
+
+		for (i = 0; i < 16; i++) {
+			if (i < 4) {
+				W[i] = _mm_loadu_si128((const __m128i *)(block + i * 16));
+				W[i] = _mm_shuffle_epi8(W[i], mask);
+			} else {
+				tmp = _mm_sha256msg1_epu32(W[i & 3], W[(i - 3) & 3]);
+				tmp = _mm_add_epi32(tmp, _mm_alignr_epi8(W[(i - 1) & 3],
+									 W[(i - 2) & 3], 4));
+				W[i & 3] = _mm_sha256msg2_epu32(tmp, W[(i - 1) & 3]);
+			}
+
+			msg = _mm_add_epi32(W[i & 3],
+					    _mm_loadu_si128((const __m128i *)&K[i * 4]));
+			cdgh = _mm_sha256rnds2_epu32(cdgh, abef, msg);
+			msg = _mm_shuffle_epi32(msg, 0x0e);
+			abef = _mm_sha256rnds2_epu32(abef, cdgh, msg);
+		}
+
+		abef = _mm_add_epi32(abef, abef_save);
+		cdgh = _mm_add_epi32(cdgh, cdgh_save);
+		block += 64;
+	}
+
+	tmp = _mm_shuffle_epi32(abef, 0x1b);
+	cdgh = _mm_shuffle_epi32(cdgh, 0xb1);
+	_mm_storeu_si128((__m128i *)&state[0], _mm_blend_epi16(tmp, cdgh, 0xf0));
+	_mm_storeu_si128((__m128i *)&state[4], _mm_alignr_epi8(cdgh, tmp, 8));
+}
+
+static bool
+SHA256_have_shani(void)
+{
+	unsigned int eax, ebx, ecx, edx;
+
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) ||
+	    !(ecx & bit_SSSE3) || !(ecx & bit_SSE4_1))
+		return false;
+
+	if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+		return false;
+
+	return ebx & (1 << 29);
+}
+#else
+#define SHA256_have_shani()	false
+#define SHA256_Transform_shani	SHA256_Transform_blocks
+#endif
+
+static void
+SHA256_Transform_blocks(uint32_t *state, const unsigned char *block, size_t n)
+{
+	while (n--) {
+		SHA256_Transform(state, block);
+		block += 64;
+	}
+}
+
+static void (*SHA256_Blocks)(uint32_t *state, const unsigned char *block,
+			     size_t n) = SHA256_Transform_blocks;
+
+static void __attribute__((constructor))
+SHA256_select(void)
+{
+	if (SHA256_have_shani())
+		SHA256_Blocks = SHA256_Transform_shani;
+}
+
 static unsigned char PAD[64] = {
 	0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
 	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
@@ -585,7 +680,7 @@ SHA256_Pad(SHA256_CTX * ctx)
 	} else {
 		/* Finish the current block and mix. */
 		memcpy(&ctx->buf[r], PAD, 64 - r);
-		SHA256_Transform(ctx->state, ctx->buf);
+		SHA256_Blocks(ctx->state, ctx->buf, 1);
 
 		/* The start of the final block is all zeroes. */
 		memset(&ctx->buf[0], 0, 56);
@@ -595,7 +690,7 @@ SHA256_Pad(SHA256_CTX * ctx)
 	be64enc(&ctx->buf[56], ctx->count);
 
 	/* Mix in the final block. */
-	SHA256_Transform(ctx->state, ctx->buf);
+	SHA256_Blocks(ctx->state, ctx->buf, 1);
 }
 
 /* SHA-256 initialization.  Begins a SHA-256 operation. */
@@ -642,16 +737,14 @@ SHA256_Update(SHA256_CTX * ctx, const void *in, size_t len)
 
 	/* Finish the current block */
 	memcpy(&ctx->buf[r], src, 64 - r);
-	SHA256_Transform(ctx->state, ctx->buf);
+	SHA256_Blocks(ctx->state, ctx->buf, 1);
 	src += 64 - r;
 	len -= 64 - r;
 
 	/* Perform complete blocks */
-	while (len >= 64) {
-		SHA256_Transform(ctx->state, src);
-		src += 64;
-		len -= 64;
-	}
+	SHA256_Blocks(ctx->state, src, len / 64);
+	src += len & ~63;
+	len &= 63;
 
 	/* Copy left over data into buffer */
 	memcpy(ctx->buf, src, len);
@@ -674,21 +767,24 @@ SHA256_Final(unsigned char digest[static SHA256_DIGEST_LENGTH], SHA256_CTX *ctx)
 	memset(ctx, 0, sizeof(*ctx));
 }
 
-static void *hash_buf(FILE *f, int *len)
-{
-	static char buf[1024];
+#ifndef MKHASH_NO_MAIN
+#include <pthread.h>
+
+#define HASH_BUF_SIZE	(64 * 1024)
+#define HASH_STR_SIZE	(SHA256_DIGEST_LENGTH * 2 + 1)
 
-	*len = fread(buf, 1, sizeof(buf), f);
+static void *hash_buf(FILE *f, char *buf, int *len)
+{
+	*len = fread(buf, 1, HASH_BUF_SIZE, f);
 
 	return *len > 0 ? buf : NULL;
 }
 
-static char *hash_string(unsigned char *buf, int len)
+static char *hash_string(unsigned char *buf, int len, char *str)
 {
-	static char str[SHA256_DIGEST_LENGTH * 2 + 1];
 	int i;
 
-	if (len * 2 + 1 > sizeof(str))
+	if (len * 2 + 1 > HASH_STR_SIZE)
 		return NULL;
 
 	for (i = 0; i < len; i++)
@@ -697,40 +793,42 @@ static char *hash_string(unsigned char *buf, int len)
 	return str;
 }
 
-static const char *md5_hash(FILE *f)
+static const char *md5_hash(FILE *f, char *str)
 {
 	MD5_CTX ctx;
 	unsigned char val[MD5_DIGEST_LENGTH];
-	void *buf;
+	char buf[HASH_BUF_SIZE];
+	void *data;
 	int len;
 
 	MD5_begin(&ctx);
-	while ((buf = hash_buf(f, &len)) != NULL)
-		MD5_hash(buf, len, &ctx);
+	while ((data = hash_buf(f, buf, &len)) != NULL)
+		MD5_hash(data, len, &ctx);
 	MD5_end(val, &ctx);
 
-	return hash_string(val, MD5_DIGEST_LENGTH);
+	return hash_string(val, MD5_DIGEST_LENGTH, str);
 }
 
-static const char *sha256_hash(FILE *f)
+static const char *sha256_hash(FILE *f, char *str)
 {
 	SHA256_CTX ctx;
 	unsigned char val[SHA256_DIGEST_LENGTH];
-	void *buf;
+	char buf[HASH_BUF_SIZE];
+	void *data;
 	int len;
 
 	SHA256_Init(&ctx);
-	while ((buf = hash_buf(f, &len)) != NULL)
-		SHA256_Update(&ctx, buf, len);
+	while ((data = hash_buf(f, buf, &len)) != NULL)
+		SHA256_Update(&ctx, data, len);
 	SHA256_Final(val, &ctx);
 
-	return hash_string(val, SHA256_DIGEST_LENGTH);
+	return hash_string(val, SHA256_DIGEST_LENGTH, str);
 }
 
 
 struct hash_type {
 	const char *name;
-	const char *(*func)(FILE *f);
+	const char *(*func)(FILE *f, char *str);
 	int len;
 };
 
@@ -739,6 +837,26 @@ struct hash_type types[] = {
 	{ "sha256", sha256_hash, SHA256_DIGEST_LENGTH },
 };
 
+enum hash_error {
+	HASH_OK,
+	HASH_ERR_DIR,
+	HASH_ERR_OPEN,
+	HASH_ERR_HASH,
+};
+
+struct hash_job {
+	const char *filename;
+	enum hash_error error;
+	char str[HASH_STR_SIZE];
+};
+
+struct hash_queue {
+	struct hash_type *t;
+	struct hash_job *jobs;
+	int n_jobs, next;
+	pthread_mutex_t lock;
+};
+
 
 static int usage(const char *progname)
 {
@@ -748,6 +866,7 @@ static int usage(const char *progname)
 		"Options:\n"
 		"	-n		Print filename(s)\n"
 		"	-N		Suppress trailing newline\n"
+		"	-j <jobs>	Hash files in parallel (0: one job per CPU)\n"
 		"\n"
 		"Supported hash types:", progname);
 
@@ -772,44 +891,130 @@ static struct hash_type *get_hash_type(const char *name)
 }
 
 
-static int hash_file(struct hash_type *t, const char *filename, bool add_filename,
-	bool no_newline)
+static void hash_job_run(struct hash_type *t, struct hash_job *job)
 {
+	const char *filename = job->filename;
 	const char *str;
 
 	if (!filename || !strcmp(filename, "-")) {
-		str = t->func(stdin);
+		str = t->func(stdin, job->str);
 	} else {
 		struct stat path_stat;
 		stat(filename, &path_stat);
 		if (S_ISDIR(path_stat.st_mode)) {
-			fprintf(stderr, "Failed to open '%s': Is a directory\n", filename);
-			return 1;
+			job->error = HASH_ERR_DIR;
+			return;
 		}
 
 		FILE *f = fopen(filename, "r");
 
 		if (!f) {
-			fprintf(stderr, "Failed to open '%s'\n", filename);
-			return 1;
+			job->error = HASH_ERR_OPEN;
+			return;
 		}
-		str = t->func(f);
+		str = t->func(f, job->str);
 		fclose(f);
 	}
 
-	if (!str) {
+	if (!str)
+		job->error = HASH_ERR_HASH;
+}
+
+static int hash_job_print(struct hash_job *job, bool add_filename,
+	bool no_newline)
+{
+	const char *filename = job->filename;
+
+	switch (job->error) {
+	case HASH_ERR_DIR:
+		fprintf(stderr, "Failed to open '%s': Is a directory\n", filename);
+		return 1;
+	case HASH_ERR_OPEN:
+		fprintf(stderr, "Failed to open '%s'\n", filename);
+		return 1;
+	case HASH_ERR_HASH:
 		fprintf(stderr, "Failed to generate hash\n");
 		return 1;
+	default:
+		break;
 	}
 
 	if (add_filename)
-		printf("%s %s%s", str, filename ? filename : "-",
+		printf("%s %s%s", job->str, filename ? filename : "-",
 			no_newline ? "" : "\n");
 	else
-		printf("%s%s", str, no_newline ? "" : "\n");
+		printf("%s%s", job->str, no_newline ? "" : "\n");
 	return 0;
 }
 
+static void *hash_worker(void *arg)
+{
+	struct hash_queue *q = arg;
+	struct hash_job *job;
+
+	while (1) {
+		pthread_mutex_lock(&q->lock);
+		job = q->next < q->n_jobs ? &q->jobs[q->next++] : NULL;
+		pthread_mutex_unlock(&q->lock);
+
+		if (!job)
+			break;
+
+		hash_job_run(q->t, job);
+	}
+
+	return NULL;
+}
+
+/*
+ * Hash all files on a pool of threads, then print the results in argument
+ * order, stopping at the first error just like the serial loop does.
+ */
+static int hash_files(struct hash_type *t, char **files, int n, long jobs,
+	bool add_filename, bool no_newline)
+{
+	struct hash_queue q = {
+		.t = t,
+		.n_jobs = n,
+		.lock = PTHREAD_MUTEX_INITIALIZER,
+	};
+	pthread_t *threads;
+	int i, ret = 0;
+
+	if (jobs <= 0)
+		jobs = sysconf(_SC_NPROCESSORS_ONLN);
+	if (jobs > n)
+		jobs = n;
+
+	q.jobs = calloc(n, sizeof(*q.jobs));
+	threads = calloc(jobs > 0 ? jobs : 1, sizeof(*threads));
+	if (!q.jobs || !threads) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	for (i = 0; i < n; i++)
+		q.jobs[i].filename = files[i];
+
+	for (i = 0; i < jobs; i++)
+		if (pthread_create(&threads[i], NULL, hash_worker, &q))
+			break;
+
+	if (!i)
+		hash_worker(&q);
+
+	while (i-- > 0)
+		pthread_join(threads[i], NULL);
+
+	for (i = 0; i < n && !ret; i++)
+		ret = hash_job_print(&q.jobs[i], add_filename, no_newline);
+
+	free(threads);
+	free(q.jobs);
+
+	return ret;
+}
+
 
 int main(int argc, char **argv)
 {
@@ -817,8 +1022,9 @@ int main(int argc, char **argv)
 	const char *progname = argv[0];
 	int i, ch;
 	bool add_filename = false, no_newline = false;
+	long jobs = 1;
 
-	while ((ch = getopt(argc, argv, "nN")) != -1) {
+	while ((ch = getopt(argc, argv, "nNj:")) != -1) {
 		switch (ch) {
 		case 'n':
 			add_filename = true;
@@ -826,6 +1032,9 @@ int main(int argc, char **argv)
 		case 'N':
 			no_newline = true;
 			break;
+		case 'j':
+			jobs = strtol(optarg, NULL, 0);
+			break;
 		default:
 			return usage(progname);
 		}
@@ -841,14 +1050,27 @@ int main(int argc, char **argv)
 	if (!t)
 		return usage(progname);
 
-	if (argc < 2)
-		return hash_file(t, NULL, add_filename, no_newline);
+	if (argc < 2) {
+		struct hash_job job = {};
+
+		hash_job_run(t, &job);
+		return hash_job_print(&job, add_filename, no_newline);
+	}
+
+	if (jobs != 1 && argc > 2)
+		return hash_files(t, argv + 1, argc - 1, jobs, add_filename,
+				  no_newline);
 
 	for (i = 0; i < argc - 1; i++) {
-		int ret = hash_file(t, argv[1 + i], add_filename, no_newline);
+		struct hash_job job = { .filename = argv[1 + i] };
+		int ret;
+
+		hash_job_run(t, &job);
+		ret = hash_job_print(&job, add_filename, no_newline);
 		if (ret)
 			return ret;
 	}
 
 	return 0;
 }
+#endif
@@ -0,0 +1,63 @@
+#!/usr/bin/env bash
+#
+# Fetch and store package build cache entries, see include/package-cache.mk
+#
+# Usage: package-cache.sh fetch <key> <file>
+#        package-cache.sh store <key> <file>
+#
+# Entries are looked up in $PKG_CACHE_DIR first, then under $PKG_CACHE_URL
+# (any URL curl or wget can fetch). New entries only go to $PKG_CACHE_DIR.
+
+cmd="$1"
+key="$2"
+file="$3"
+
+[ -n "$cmd" ] && [ -n "$key" ] && [ -n "$file" ] || {
+	echo "Usage: $0 fetch|store <key> <file>" >&2
+	exit 1
+}
+
+fetch_url() {
+	local url="$1"
+
+	if command -v curl > /dev/null; then
+		curl -fsSL -o "$file.tmp" "$url"
+	elif command -v wget > /dev/null; then
+		wget -q -O "$file.tmp" "$url"
+	else
+		return 1
+	fi
+}
+
+case "$cmd" in
+	fetch)
+		if [ -n "$PKG_CACHE_DIR" ] && [ -f "$PKG_CACHE_DIR/$key.tar.gz" ]; then
+			cp "$PKG_CACHE_DIR/$key.tar.gz" "$file"
+			exit $?
+		fi
+
+		[ -n "$PKG_CACHE_URL" ] || exit 1
+		if fetch_url "${PKG_CACHE_URL%/}/$key.tar.gz"; then
+			mv "$file.tmp" "$file"
+			exit 0
+		fi
+		rm -f "$file.tmp"
+		exit 1
+	;;
+	store)
+		[ -n "$PKG_CACHE_DIR" ] || exit 1
+		[ -f "$PKG_CACHE_DIR/$key.tar.gz" ] && exit 0
+
+		mkdir -p "$PKG_CACHE_DIR" && \
+		cp "$file" "$PKG_CACHE_DIR/.$key.tmp.$$" && \
+		mv "$PKG_CACHE_DIR/.$key.tmp.$$" "$PKG_CACHE_DIR/$key.tar.gz" && \
+		exit 0
+
+		rm -f "$PKG_CACHE_DIR/.$key.tmp.$$"
+		exit 1
+	;;
+	*)
+		echo "Unknown command: $cmd" >&2
+		exit 1
+	;;
+esac
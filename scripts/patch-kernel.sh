@@ -6,9 +6,10 @@
 # (c) 2002 Erik Andersen <andersen@codepoet.org>
 
 # Set directories from arguments, or use defaults.
+# Any further arguments are patterns of the patches to apply, in order.
 targetdir=${1-.}
 patchdir=${2-../kernel-patches}
-patchpattern=${3-*}
+[ $# -gt 2 ] && shift 2 || set -- '*'
 
 if [ ! -d "${targetdir}" ] ; then
     echo "Aborting.  '${targetdir}' is not a directory."
@@ -18,7 +19,49 @@ if [ ! -d "${patchdir}" ] ; then
     echo "Aborting.  '${patchdir}' is not a directory."
     exit 1
 fi
-    
+
+# Plain text patches are fed to a single patch process, one marker line
+# ahead of each so the verbose output tells which one a failure is in.
+batch=
+log=
+trap '[ -z "$log" ] || rm -f "$log"' EXIT
+
+apply_batch() {
+    [ -n "$batch" ] || return 0
+    [ -n "$log" ] || log=$(mktemp) || exit 1
+
+    awk 'FNR == 1 { print "patch-kernel: " FILENAME } { print }' $batch | \
+	${PATCH:-patch} -f -p1 --verbose -d ${targetdir} > "$log" 2>&1
+    status=$?
+    batch=
+
+    awk -v status=$status '
+	/^\|patch-kernel: / {
+	    if (failed)
+		exit
+	    name = substr($0, 16)
+	    printf "\nApplying %s using plaintext: \n", name
+	    next
+	}
+	/^\|/ { next }
+	/^(patching|checking) file / || / FAILED| offset | with fuzz |can.t find file|malformed|Skipping patch|^patch: / {
+	    print
+	    if ($0 ~ /FAILED|can.t find file|malformed|Skipping patch|^patch: /)
+		failed = name
+	}
+	END {
+	    if (status == 0)
+		exit
+	    if (failed != "")
+		printf "Patch failed!  Please fix %s!\n", failed
+	    else
+		print "Patch failed!"
+	}' "$log"
+
+    [ $status = 0 ] || exit 1
+}
+
+for patchpattern in "$@"; do
 for i in ${patchdir}/${patchpattern} ; do 
     case "$i" in
 	*.gz)
@@ -35,6 +78,11 @@ for i in ${patchdir}/${patchpattern} ; do
 	type="plaintext"; uncomp="cat"; ;; 
     esac
     [ -d "${i}" ] && echo "Ignoring subdirectory ${i}" && continue	
+    if [ "$type" = "plaintext" ] && [ -f "${i}" ]; then
+	batch="$batch ${i}"
+	continue
+    fi
+    apply_batch
     echo ""
     echo "Applying ${i} using ${type}: " 
     ${uncomp} ${i} | ${PATCH:-patch} -f -p1 -d ${targetdir}
@@ -43,6 +91,8 @@ for i in ${patchdir}/${patchpattern} ; do
 	exit 1
     fi
 done
+done
+apply_batch
 
 # Check for rejects...
 if [ "`find $targetdir/ '(' -name '*.rej' -o -name '.*.rej' ')' -print`" ] ; then
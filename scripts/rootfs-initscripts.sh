@@ -0,0 +1,88 @@
+#!/usr/bin/env bash
+#
+# Enable the rc.common init scripts of a root filesystem, or disable those
+# listed, creating or removing their /etc/rc.d links.
+#
+# The START and STOP values are read from the scripts directly. Only the
+# scripts that do not set them as plain numbers go through rc.common,
+# which has to source the whole script to find them.
+#
+SELF=${0##*/}
+
+ROOT="$1"; shift
+DISABLED=" $* "
+
+[ -d "$ROOT/etc/init.d" ] || {
+  echo "$SELF: no init scripts in '$ROOT'"
+  echo "usage: $SELF <root> [disabled script...]"
+  exit 1
+}
+
+cd "$ROOT" || exit 1
+
+rc_common() {
+	IPKG_INSTROOT="$ROOT" bash ./etc/rc.common "$1" "$2"
+}
+
+# sets START and STOP, fails for any other kind of assignment to them
+read_start_stop() {
+	local line rc=1 start=0 stop=0
+
+	START=; STOP=
+	while IFS= read -r line || [ -n "$line" ]; do
+		case "$line" in
+		*'#!/bin/sh /etc/rc.common'*)
+			rc=0
+			;;
+		START=[0-9]*|STOP=[0-9]*)
+			local var="${line%%=*}" val="${line#*=}"
+			val="${val%%#*}"
+			val="${val%"${val##*[![:space:]]}"}"
+			case "$val" in
+			*[!0-9]*|'') return 2;;
+			esac
+			[ "$var" = START ] && { START="$val"; start=$((start + 1)); }
+			[ "$var" = STOP ] && { STOP="$val"; stop=$((stop + 1)); }
+			;;
+		*START=*|*STOP=*)
+			return 2
+			;;
+		esac
+	done < "$1"
+
+	[ "$rc" = 0 ] || return 1
+	[ "$start" -le 1 ] && [ "$stop" -le 1 ] || return 2
+}
+
+mkdir -p ./etc/rc.d
+
+for script in ./etc/init.d/*; do
+	[ -f "$script" ] || continue
+	name="${script##*/}"
+
+	read_start_stop "$script"
+	case "$?" in
+	1) continue;;
+	2) native=;;
+	*) native=1;;
+	esac
+
+	if [ "${DISABLED/ $name /}" = "$DISABLED" ]; then
+		if [ -n "$native" ]; then
+			[ -n "$START" ] && ln -sf "../init.d/$name" "./etc/rc.d/S${START}${name##S[0-9][0-9]}"
+			[ -n "$STOP" ] && ln -sf "../init.d/$name" "./etc/rc.d/K${STOP}${name##K[0-9][0-9]}"
+		else
+			rc_common "$script" enable
+		fi
+		echo "Enabling $name"
+	else
+		if [ -n "$native" ]; then
+			rm -f ./etc/rc.d/S??"$name" ./etc/rc.d/K??"$name"
+		else
+			rc_common "$script" disable
+		fi
+		echo "Disabling $name"
+	fi
+done
+
+exit 0
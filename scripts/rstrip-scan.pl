@@ -0,0 +1,82 @@
+#!/usr/bin/env perl
+#
+# List the ELF files among the NUL separated paths on stdin, as
+#   <path>:<type>:<mode>:<rpath>
+# with <type> one of executable, relocatable or shared object, <mode>
+# in octal and <rpath> the DT_RUNPATH/DT_RPATH entry, if any.
+#
+# Used by scripts/rstrip.sh in place of running file, stat and
+# patchelf --print-rpath for every file.
+#
+
+use strict;
+use warnings;
+
+my %types = (1 => "relocatable", 2 => "executable", 3 => "shared object");
+
+sub elf_rpath {
+	my ($fh, $is64, $le, $hdr) = @_;
+	my ($u16, $u32, $u64) = $le ? ('v', 'V', 'Q<') : ('n', 'N', 'Q>');
+	my ($shoff, $shentsize, $shnum);
+	my (@sh, $buf, $rpath);
+
+	if ($is64) {
+		$shoff = unpack($u64, substr($hdr, 0x28, 8));
+		($shentsize, $shnum) = unpack("$u16$u16", substr($hdr, 0x3a, 4));
+	} else {
+		$shoff = unpack($u32, substr($hdr, 0x20, 4));
+		($shentsize, $shnum) = unpack("$u16$u16", substr($hdr, 0x2e, 4));
+	}
+	return "" unless $shoff and $shnum and $shentsize >= ($is64 ? 64 : 40);
+
+	seek($fh, $shoff, 0) or return "";
+	read($fh, $buf, $shentsize * $shnum) == $shentsize * $shnum or return "";
+	foreach my $i (0 .. $shnum - 1) {
+		my $ent = substr($buf, $i * $shentsize, $shentsize);
+		# type, offset, size, link
+		push @sh, $is64 ?
+			[ unpack($u32, substr($ent, 4, 4)), unpack("$u64$u64", substr($ent, 24, 16)), unpack($u32, substr($ent, 40, 4)) ] :
+			[ unpack($u32, substr($ent, 4, 4)), unpack("$u32$u32", substr($ent, 16, 8)), unpack($u32, substr($ent, 24, 4)) ];
+	}
+
+	# SHT_DYNAMIC, its strings are in the section it links to
+	my ($dyn) = grep { $_->[0] == 6 } @sh or return "";
+	my $str = $sh[$dyn->[3]] or return "";
+	my $entsize = $is64 ? 16 : 8;
+
+	seek($fh, $dyn->[1], 0) or return "";
+	read($fh, $buf, $dyn->[2]) == $dyn->[2] or return "";
+	for (my $pos = 0; $pos + $entsize <= length($buf); $pos += $entsize) {
+		my ($tag, $val) = unpack($is64 ? "$u64$u64" : "$u32$u32", substr($buf, $pos, $entsize));
+		last if $tag == 0;
+		# DT_RUNPATH takes precedence over DT_RPATH
+		next unless $tag == 29 or ($tag == 15 and not defined $rpath);
+		my $name;
+		seek($fh, $str->[1] + $val, 0) and read($fh, $name, 4096) or next;
+		($rpath) = $name =~ /^([^\0]*)/;
+	}
+
+	return $rpath // "";
+}
+
+$/ = "\0";
+while (my $file = <STDIN>) {
+	chomp $file;
+
+	my @st = lstat($file) or next;
+	-f _ or next;
+	open(my $fh, '<', $file) or next;
+	binmode($fh);
+
+	my $hdr;
+	if (read($fh, $hdr, 64) >= 52 and substr($hdr, 0, 4) eq "\x7fELF") {
+		my ($class, $data) = unpack("CC", substr($hdr, 4, 2));
+		my $type = unpack($data == 1 ? 'v' : 'n', substr($hdr, 16, 2));
+
+		if ($types{$type} and ($class == 1 or $class == 2)) {
+			my $rpath = $type == 1 ? "" : elf_rpath($fh, $class == 2, $data == 1, $hdr);
+			printf "%s:%s:%o:%s\n", $file, $types{$type}, $st[2] & 07777, $rpath;
+		}
+	}
+	close($fh);
+}
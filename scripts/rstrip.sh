@@ -20,31 +20,51 @@ TARGETS=$*
   exit 1
 }
 
-find $TARGETS -not -path \*/lib/firmware/\* -a -type f -a -exec file {} \; | \
-  sed -n -e 's/^\(.*\):.*ELF.*\(executable\|relocatable\|shared object\).*,.*/\1:\2/p' | \
+# one job per make job, unless told otherwise
+JOBS=${RSTRIP_JOBS:-$(echo " $MAKEFLAGS" | sed -n 's/.* -j\([0-9][0-9]*\).*/\1/p')}
+[ -n "$JOBS" ] || JOBS=1
+
+rstrip_file() {
+	local F="$1" old_rpath="$2" new_rpath="" path
+
+	[ -z "$PATCHELF" ] || [ -z "$TOPDIR" ] || {
+		IFS=":"
+		for path in $old_rpath; do
+			case "$path" in
+				/lib/[^/]*|/usr/lib/[^/]*|\$ORIGIN/*|\$ORIGIN) new_rpath="${new_rpath:+$new_rpath:}$path" ;;
+				*) echo "$SELF: $F: removing rpath $path" ;;
+			esac
+		done
+		unset IFS
+		[ "$new_rpath" = "$old_rpath" ] || $PATCHELF --set-rpath "$new_rpath" $F
+	}
+	eval "$STRIP $F"
+}
+
+find $TARGETS -not -path \*/lib/firmware/\* -a -type f -print0 | \
+  perl "${0%/*}/rstrip-scan.pl" | \
 (
   IFS=":"
-  while read F S; do
+  running=0
+  modes=()
+  while read F S M R; do
     echo "$SELF: $F: $S"
 	[ "${S}" = "relocatable" ] && {
 		[ "${F##*.}" == "o" ] && continue
 		eval "$STRIP_KMOD $F"
 	} || {
-		b=$(stat -c '%a' $F)
-		[ -z "$PATCHELF" ] || [ -z "$TOPDIR" ] || {
-			old_rpath="$($PATCHELF --print-rpath $F)"; new_rpath=""
-			for path in $old_rpath; do
-				case "$path" in
-					/lib/[^/]*|/usr/lib/[^/]*|\$ORIGIN/*|\$ORIGIN) new_rpath="${new_rpath:+$new_rpath:}$path" ;;
-					*) echo "$SELF: $F: removing rpath $path" ;;
-				esac
-			done
-			[ "$new_rpath" = "$old_rpath" ] || $PATCHELF --set-rpath "$new_rpath" $F
-		}
-		eval "$STRIP $F"
-		a=$(stat -c '%a' $F)
-		[ "$a" = "$b" ] || chmod $b $F
+		modes+=("$M:$F")
+		rstrip_file "$F" "$R" &
+		running=$((running + 1))
+		[ $running -lt $JOBS ] || { wait -n; running=$((running - 1)); }
 	}
   done
+  wait
+
+  # strip may not preserve the permissions
+  [ ${#modes[@]} -eq 0 ] || printf '%s\n' "${modes[@]}" | perl -ne '
+    chomp; my ($mode, $file) = split(/:/, $_, 2);
+    my @st = stat($file) or next;
+    chmod(oct($mode), $file) if ($st[2] & 07777) != oct($mode);'
   true
 )
@@ -0,0 +1,44 @@
+#!/usr/bin/env bash
+#
+# Run a filesystem image command only if no image was built before from
+# the same root directory contents and options.
+#
+# Usage: squashfs-cache.sh <cache dir> <root dir> <output> <options> -- <command...>
+
+set -e
+
+[ $# -ge 6 ] && [ "$5" = "--" ] || {
+	echo "Usage: $0 <cache dir> <root dir> <output> <options> -- <command...>" >&2
+	exit 1
+}
+
+cache_dir="$1"
+root_dir="$2"
+output="$3"
+options="$4"
+shift 5
+
+# Everything mksquashfs stores in the image: tree layout, metadata and
+# file contents, plus the options and timestamp used to build it.
+key="$( {
+	echo "$options $SOURCE_DATE_EPOCH"
+	cd "$root_dir"
+	find . -printf '%p %y %m %U %G %s %T@ %l\n' | LC_ALL=C sort
+	find . -type f -print0 | LC_ALL=C sort -z | xargs -0 -r $MKHASH -n -j 0 md5
+} | $MKHASH md5 )"
+
+if [ -f "$cache_dir/$key" ]; then
+	echo "Using cached image for $output" >&2
+	cp "$cache_dir/$key" "$output"
+	touch "$cache_dir/$key"
+	exit 0
+fi
+
+"$@"
+
+mkdir -p "$cache_dir"
+cp "$output" "$cache_dir/$key.$$"
+mv "$cache_dir/$key.$$" "$cache_dir/$key"
+
+# keep the cache bounded to images used in the last few builds
+find "$cache_dir" -type f -mtime +7 -delete
@@ -0,0 +1,85 @@
+#!/usr/bin/env perl
+#
+# Write a tar archive of a directory <dir> holding the given members
+# straight to <out>, reading the members from their source files, as
+#   <name>:<file>[:<pad>]   the contents of <file>, zero padded to a
+#                           multiple of <pad> bytes
+#   <name>=<text>           the text itself
+# The headers match those of GNU tar --owner=0 --group=0 --numeric-owner,
+# with mode 0755 for <dir>, 0644 for the members and <mtime> for all.
+#
+# Used by scripts/sysupgrade-tar.sh in place of copying the members
+# into a staging directory first.
+#
+
+use strict;
+use warnings;
+
+@ARGV >= 3 or die "Usage: $0 <out> <dir> <mtime> <member>...\n";
+my ($out, $dir, $mtime, @members) = @ARGV;
+my $written = 0;
+
+open(my $fh, '>', $out) or die "Cannot open $out: $!\n";
+binmode($fh);
+
+sub put {
+	my ($data) = @_;
+
+	print $fh $data or die "Cannot write $out: $!\n";
+	$written += length($data);
+}
+
+sub header {
+	my ($name, $mode, $size, $type) = @_;
+
+	length($name) < 100 or die "Name too long: $name\n";
+	my $hdr = pack("a100a8a8a8a12a12A8a1a100a8a32a32a8a8a155a12",
+		$name, sprintf("%07o", $mode), "0000000", "0000000",
+		sprintf("%011o", $size), sprintf("%011o", $mtime), "",
+		$type, "", "ustar  ", "", "", "", "", "", "");
+	my $sum = unpack("%32C*", $hdr);
+	substr($hdr, 148, 8) = sprintf("%06o\0 ", $sum);
+	put($hdr);
+	print "$name\n";
+}
+
+sub pad {
+	my ($len, $align) = @_;
+
+	put("\0" x ($align - $len % $align)) if $len % $align;
+}
+
+header("$dir/", 0755, 0, "5");
+foreach my $member (sort { (split /[:=]/, $a)[0] cmp (split /[:=]/, $b)[0] } @members) {
+	if ($member =~ /^([^:=]+)=(.*)$/s) {
+		header("$dir/$1", 0644, length($2), "0");
+		put($2);
+		pad(length($2), 512);
+		next;
+	}
+
+	my ($name, $file, $align) = $member =~ /^([^:]+):(.+?)(?::(\d+))?$/
+		or die "Invalid member: $member\n";
+	my $size = -s $file;
+	defined($size) or die "Cannot stat $file: $!\n";
+	$size += $align - $size % $align if $align and $size % $align;
+
+	header("$dir/$name", 0644, $size, "0");
+	open(my $in, '<', $file) or die "Cannot open $file: $!\n";
+	binmode($in);
+	my ($buf, $len, $done) = ("", 0, 0);
+	while (($len = read($in, $buf, 1 << 20))) {
+		$len = $size - $done if $done + $len > $size;
+		put(substr($buf, 0, $len));
+		$done += $len;
+	}
+	defined($len) or die "Cannot read $file: $!\n";
+	close($in);
+	put("\0" x ($size - $done)) if $done < $size;
+	pad($size, 512);
+}
+
+# end of archive, filled up to the default 10240 byte record
+put("\0" x 1024);
+pad($written, 10240);
+close($fh) or die "Cannot write $out: $!\n";
@@ -43,42 +43,28 @@ if [ ! -n "$board" -o ! -r "$kernel" -a  ! -r "$rootfs" -o ! "$outfile" ]; then
 	exit 1
 fi
 
-tmpdir="$( mktemp -d 2> /dev/null )"
-if [ -z "$tmpdir" ]; then
-	# try OSX signature
-	tmpdir="$( mktemp -t 'ubitmp' -d )"
-fi
-
-if [ -z "$tmpdir" ]; then
-	exit 1
-fi
-
-mkdir -p "${tmpdir}/sysupgrade-${board}"
-echo "BOARD=${board}" > "${tmpdir}/sysupgrade-${board}/CONTROL"
+set -- "CONTROL=BOARD=${board}
+"
 if [ -n "${rootfs}" ]; then
 	case "$( get_fs_type ${rootfs} )" in
 	"squashfs")
-		dd if="${rootfs}" of="${tmpdir}/sysupgrade-${board}/root" bs=1024 conv=sync
+		set -- "$@" "root:${rootfs}:1024"
 		;;
 	*)
-		cp "${rootfs}" "${tmpdir}/sysupgrade-${board}/root"
+		set -- "$@" "root:${rootfs}"
 		;;
 	esac
 fi
-[ -z "${kernel}" ] || cp "${kernel}" "${tmpdir}/sysupgrade-${board}/kernel"
-
-mtime=""
-if [ -n "$SOURCE_DATE_EPOCH" ]; then
-	mtime="--mtime=@${SOURCE_DATE_EPOCH}"
-fi
+[ -z "${kernel}" ] || set -- "$@" "kernel:${kernel}"
 
-(cd "$tmpdir"; tar --sort=name --owner=0 --group=0 --numeric-owner -cvf sysupgrade.tar sysupgrade-${board} ${mtime})
+# the output may be one of the inputs
+perl $TOPDIR/scripts/sysupgrade-tar.pl "$outfile.new" "sysupgrade-${board}" \
+	"${SOURCE_DATE_EPOCH:-$(date +%s)}" "$@"
 err="$?"
-if [ -e "$tmpdir/sysupgrade.tar" ]; then
-	cp "$tmpdir/sysupgrade.tar" "$outfile"
+if [ "$err" = 0 ]; then
+	mv "$outfile.new" "$outfile"
 else
-	err=2
+	rm -f "$outfile.new"
 fi
-rm -rf "$tmpdir"
 
 exit $err
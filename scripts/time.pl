@@ -3,6 +3,7 @@
 use strict;
 use warnings;
 use Config;
+use Fcntl qw(:flock);
 
 if (@ARGV < 2) {
 	die "Usage: $0 <prefix> <command...>\n";
@@ -31,6 +32,24 @@ sub gettime {
 	return ($sec, $usec);
 }
 
+# One line per step for scripts/build-report.pl:
+# <build id> <step> <start> <end> <user> <system>
+sub log_step {
+	my ($prefix, $start, $end, $cuser, $csystem) = @_;
+	my $file = $ENV{'BUILD_TIME_LOG'};
+	my $fh;
+
+	return unless $file;
+
+	$prefix =~ s/^time: //;
+	open($fh, '>>', $file) or return;
+	flock($fh, LOCK_EX);
+	printf $fh "%s %s %.2f %.2f %.2f %.2f\n",
+		$ENV{'BUILD_TIME_ID'} || 0, $prefix, $start, $end,
+		$cuser, $csystem;
+	close($fh);
+}
+
 my ($prefix, @cmd) = @ARGV;
 my ($sec, $usec) = gettime();
 my $pid = fork();
@@ -58,6 +77,9 @@ else {
 		$prefix, $cuser, $csystem,
 		($sec2 - $sec) + ($usec2 - $usec) / 1000000;
 
+	log_step($prefix, $sec + $usec / 1000000, $sec2 + $usec2 / 1000000,
+		$cuser, $csystem);
+
 	$SIG{'INT'} = 'DEFAULT';
 	$SIG{'QUIT'} = 'DEFAULT';
 
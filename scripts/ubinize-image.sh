@@ -162,9 +162,32 @@ ubilayout "$ubootenv" "$rootfs" "$kernel" > "$ubinizecfg"
 
 set_ubinize_seq
 cat "$ubinizecfg"
-ubinize $ubinize_seq -o "$outfile" $ubinize_param "$ubinizecfg"
-err="$?"
-[ ! -e "$outfile" ] && err=2
+
+# images with the same layout of the same inputs (e.g. the factory and
+# sysupgrade variants of a device) are only ubinized once
+cache=""
+if [ -n "$UBINIZE_CACHE_DIR" ] && command -v mkhash > /dev/null; then
+	layout="$( { cat "$ubinizecfg"; echo "$ubinize_seq $ubinize_param"; } | mkhash md5 )"
+	inputs="$( sed -n 's/^image=//p' "$ubinizecfg" | while read -r image; do
+		stat -L -c '%n %s %y' "$image"
+	done | mkhash md5 )"
+	cache="$UBINIZE_CACHE_DIR/ubinize-$layout"
+fi
+
+if [ -n "$cache" ] && [ -f "$cache-$inputs" ]; then
+	echo "Using ubinized image ${cache##*/}-$inputs"
+	cp "$cache-$inputs" "$outfile"
+	err="$?"
+else
+	ubinize $ubinize_seq -o "$outfile" $ubinize_param "$ubinizecfg"
+	err="$?"
+	[ ! -e "$outfile" ] && err=2
+	if [ "$err" = 0 ] && [ -n "$cache" ]; then
+		mkdir -p "$UBINIZE_CACHE_DIR"
+		rm -f "$cache"-*
+		cp "$outfile" "$cache.$$" && mv "$cache.$$" "$cache-$inputs"
+	fi
+fi
 rm "$ubinizecfg"
 
 exit $err
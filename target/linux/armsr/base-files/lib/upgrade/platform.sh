@@ -53,10 +53,8 @@ platform_copy_config() {
 # Copy efi/openwrt and efi/boot from the new image
 # to the existing ESP
 platform_do_upgrade_efi_system_partition() {
-	local image_file=$1
+	local esp_image=$1
 	local target_partdev=$2
-	local image_efisp_start=$3
-	local image_efisp_size=$4
 
 	v "Updating ESP on ${target_partdev}"
 	NEW_ESP_DIR="/mnt/new_esp_loop"
@@ -64,16 +62,13 @@ platform_do_upgrade_efi_system_partition() {
 	mkdir "${NEW_ESP_DIR}"
 	mkdir "${CUR_ESP_DIR}"
 
-	get_image_dd "$image_file" of="/tmp/new_efi_sys_part.img" \
-		skip="$image_efisp_start" count="$image_efisp_size"
-
-	mount -t vfat -o loop -o ro /tmp/new_efi_sys_part.img "${NEW_ESP_DIR}"
+	mount -t vfat -o loop -o ro "${esp_image}" "${NEW_ESP_DIR}"
 	if [ ! -d "${NEW_ESP_DIR}/efi/boot" ]; then
 		v "ERROR: Image does not contain EFI boot files (/efi/boot)"
 		return 1
 	fi
 
-	mount -t vfat "/dev/$partdev" "${CUR_ESP_DIR}"
+	mount -t vfat "/dev/${target_partdev}" "${CUR_ESP_DIR}"
 
 	for d in $(find "${NEW_ESP_DIR}/efi/" -mindepth 1 -maxdepth 1 -type d); do
 		v "Copying ${d}"
@@ -129,22 +124,28 @@ platform_do_upgrade() {
 		return 0
 	fi
 
-	#iterate over each partition from the image and write it to the boot disk
+	#write each partition from the image to the boot disk in one pass over
+	#the image, the ESP goes to a file to be merged into the existing one
+	local ranges espdev
 	while read part start size; do
 		if export_partdevice partdev $part; then
 			v "Writing image to /dev/$partdev..."
 			if [ "$part" = "1" ]; then
-				platform_do_upgrade_efi_system_partition \
-					$1 $partdev $start $size || return 1
+				espdev="$partdev"
+				append ranges "$start:$size:/tmp/new_efi_sys_part.img"
 			else
 				v "Normal partition, doing DD"
-				get_image_dd "$1" of="/dev/$partdev" ibs=512 obs=1M skip="$start" \
-					count="$size" conv=fsync
+				append ranges "$start:$size:/dev/$partdev"
 			fi
 		else
 			v "Unable to find partition $part device, skipped."
 		fi
 	done < /tmp/partmap.image
+	[ -n "$ranges" ] && get_image_ranges "$1" $ranges
+	[ -n "$espdev" ] && {
+		platform_do_upgrade_efi_system_partition \
+			/tmp/new_efi_sys_part.img $espdev || return 1
+	}
 
 	local parttype=ext4
 
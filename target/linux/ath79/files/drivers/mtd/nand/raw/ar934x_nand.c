@@ -435,9 +435,30 @@ static void ar934x_nfc_send_cmd(struct ar934x_nfc *nfc, unsigned command)
 	ar934x_nfc_wait_dev_ready(nfc);
 }
 
+/*
+ * Map a caller supplied buffer for a direct DMA transfer. Buffers that can
+ * not be mapped without touching neighbouring cache lines, or which are not
+ * in the linear mapping, have to go through the bounce buffer instead.
+ */
+static int ar934x_nfc_map_buf(struct ar934x_nfc *nfc, void *buf, int len,
+			      enum dma_data_direction dir, dma_addr_t *dma_addr)
+{
+	if (!virt_addr_valid(buf) ||
+	    !IS_ALIGNED((unsigned long)buf, ARCH_DMA_MINALIGN) ||
+	    !IS_ALIGNED(len, ARCH_DMA_MINALIGN))
+		return -EINVAL;
+
+	*dma_addr = dma_map_single(nfc->parent, buf, len, dir);
+	if (dma_mapping_error(nfc->parent, *dma_addr))
+		return -ENOMEM;
+
+	return 0;
+}
+
 static int ar934x_nfc_do_rw_command(struct ar934x_nfc *nfc, int column,
 				    int page_addr, int len, u32 cmd_reg,
-				    u32 ctrl_reg, bool write)
+				    u32 ctrl_reg, bool write,
+				    dma_addr_t dma_addr)
 {
 	u32 addr0, addr1;
 	u32 dma_ctrl;
@@ -447,7 +468,7 @@ static int ar934x_nfc_do_rw_command(struct ar934x_nfc *nfc, int column,
 
 	WARN_ON(len & 3);
 
-	if (WARN_ON(len > nfc->buf_size))
+	if (dma_addr == nfc->buf_dma && WARN_ON(len > nfc->buf_size))
 		dev_err(nfc->parent, "len=%d > buf_size=%d", len,
 			nfc->buf_size);
 
@@ -476,7 +497,7 @@ retry:
 	ar934x_nfc_wr(nfc, AR934X_NFC_REG_INT_STATUS, 0);
 	ar934x_nfc_wr(nfc, AR934X_NFC_REG_ADDR0_0, addr0);
 	ar934x_nfc_wr(nfc, AR934X_NFC_REG_ADDR0_1, addr1);
-	ar934x_nfc_wr(nfc, AR934X_NFC_REG_DMA_ADDR, nfc->buf_dma);
+	ar934x_nfc_wr(nfc, AR934X_NFC_REG_DMA_ADDR, dma_addr);
 	ar934x_nfc_wr(nfc, AR934X_NFC_REG_DMA_COUNT, len);
 	ar934x_nfc_wr(nfc, AR934X_NFC_REG_DATA_SIZE, len);
 	ar934x_nfc_wr(nfc, AR934X_NFC_REG_CTRL, ctrl_reg);
@@ -519,15 +540,17 @@ static int ar934x_nfc_send_readid(struct ar934x_nfc *nfc, unsigned command)
 	cmd_reg |= (command & AR934X_NFC_CMD_CMD0_M) << AR934X_NFC_CMD_CMD0_S;
 
 	err = ar934x_nfc_do_rw_command(nfc, -1, -1, AR934X_NFC_ID_BUF_SIZE,
-				       cmd_reg, nfc->ctrl_reg, false);
+				       cmd_reg, nfc->ctrl_reg, false,
+				       nfc->buf_dma);
 
 	nfc_debug_data("[id] ", nfc->buf, AR934X_NFC_ID_BUF_SIZE);
 
 	return err;
 }
 
-static int ar934x_nfc_send_read(struct ar934x_nfc *nfc, unsigned command,
-				int column, int page_addr, int len)
+static int __ar934x_nfc_send_read(struct ar934x_nfc *nfc, unsigned command,
+				  int column, int page_addr, int len,
+				  dma_addr_t dma_addr)
 {
 	u32 cmd_reg;
 	int err;
@@ -544,8 +567,18 @@ static int ar934x_nfc_send_read(struct ar934x_nfc *nfc, unsigned command,
 		cmd_reg |= AR934X_NFC_CMD_SEQ_1C5A1CXR;
 	}
 
-	err = ar934x_nfc_do_rw_command(nfc, column, page_addr, len,
-				       cmd_reg, nfc->ctrl_reg, false);
+	return ar934x_nfc_do_rw_command(nfc, column, page_addr, len,
+					cmd_reg, nfc->ctrl_reg, false,
+					dma_addr);
+}
+
+static int ar934x_nfc_send_read(struct ar934x_nfc *nfc, unsigned command,
+				int column, int page_addr, int len)
+{
+	int err;
+
+	err = __ar934x_nfc_send_read(nfc, command, column, page_addr, len,
+				     nfc->buf_dma);
 
 	nfc_debug_data("[data] ", nfc->buf, len);
 
@@ -604,7 +637,8 @@ static int ar934x_nfc_send_write(struct ar934x_nfc *nfc, unsigned command,
 	cmd_reg |= AR934X_NFC_CMD_SEQ_12;
 
 	return ar934x_nfc_do_rw_command(nfc, column, page_addr, len,
-					cmd_reg, nfc->ctrl_reg, true);
+					cmd_reg, nfc->ctrl_reg, true,
+					nfc->buf_dma);
 }
 
 static void ar934x_nfc_read_status(struct ar934x_nfc *nfc)
@@ -890,20 +924,31 @@ static int ar934x_nfc_read_page(struct nand_chip *chip,
 	int max_bitflips = 0;
 	bool ecc_failed;
 	bool ecc_corrected;
+	dma_addr_t dma_addr;
+	bool direct;
 	int err;
 
 	nfc_dbg(nfc, "read_page: page:%d oob:%d\n", page, oob_required);
 
+	/* DMA straight into the caller's buffer when possible */
+	direct = !ar934x_nfc_map_buf(nfc, buf, mtd->writesize,
+				     DMA_FROM_DEVICE, &dma_addr);
+
 	ar934x_nfc_enable_hwecc(nfc);
-	err = ar934x_nfc_send_read(nfc, NAND_CMD_READ0, 0, page,
-				   mtd->writesize);
+	err = __ar934x_nfc_send_read(nfc, NAND_CMD_READ0, 0, page,
+				     mtd->writesize,
+				     direct ? dma_addr : nfc->buf_dma);
 	ar934x_nfc_disable_hwecc(nfc);
 
+	if (direct)
+		dma_unmap_single(nfc->parent, dma_addr, mtd->writesize,
+				 DMA_FROM_DEVICE);
+
 	if (err)
 		return err;
 
-	/* TODO: optimize to avoid memcpy */
-	memcpy(buf, nfc->buf, mtd->writesize);
+	if (!direct)
+		memcpy(buf, nfc->buf, mtd->writesize);
 
 	/* read the ECC status */
 	ecc_ctrl = ar934x_nfc_rr(nfc, AR934X_NFC_REG_ECC_CTRL);
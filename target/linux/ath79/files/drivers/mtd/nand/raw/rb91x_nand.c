@@ -46,10 +46,14 @@ enum rb91x_nand_gpios {
 };
 
 struct rb91x_nand_drvdata {
+	struct nand_controller controller;
 	struct nand_chip chip;
 	struct device *dev;
 	struct gpio_desc **gpio;
 	void __iomem *ath79_gpio_base;
+	/* GPIO OE/OUT registers saved for the operation in progress */
+	u32 oe_reg;
+	u32 out_reg;
 };
 
 static inline void rb91x_nand_latch_lock(struct rb91x_nand_drvdata *drvdata,
@@ -111,27 +115,56 @@ static const struct mtd_ooblayout_ops rb91x_nand_ecclayout_ops = {
 	.free = rb91x_ooblayout_free,
 };
 
+/*
+ * The data lines are shared with other users behind the latch. Hand them
+ * to the NAND once for a whole operation, not for each byte of it.
+ */
+static void rb91x_nand_bus_begin(struct rb91x_nand_drvdata *drvdata)
+{
+	void __iomem *base = drvdata->ath79_gpio_base;
+
+	rb91x_nand_latch_lock(drvdata, 1);
+	rb91x_nand_rst_key_poll_disable(drvdata, 1);
+
+	/* Save registers */
+	drvdata->oe_reg = __raw_readl(base + AR71XX_GPIO_REG_OE);
+	drvdata->out_reg = __raw_readl(base + AR71XX_GPIO_REG_OUT);
+}
+
+static void rb91x_nand_bus_end(struct rb91x_nand_drvdata *drvdata)
+{
+	void __iomem *base = drvdata->ath79_gpio_base;
+	u32 mask = RB91X_NAND_DATA_BITS | RB91X_NAND_NRW_BIT;
+	u32 reg;
+
+	/* Restore the data lines, leave the control lines as they are */
+	reg = __raw_readl(base + AR71XX_GPIO_REG_OUT) & ~mask;
+	__raw_writel(reg | (drvdata->out_reg & mask), base + AR71XX_GPIO_REG_OUT);
+	reg = __raw_readl(base + AR71XX_GPIO_REG_OE) & ~mask;
+	__raw_writel(reg | (drvdata->oe_reg & mask), base + AR71XX_GPIO_REG_OE);
+	/* Flush write */
+	__raw_readl(base + AR71XX_GPIO_REG_OUT);
+
+	rb91x_nand_rst_key_poll_disable(drvdata, 0);
+	rb91x_nand_latch_lock(drvdata, 0);
+}
+
 static void rb91x_nand_write(struct rb91x_nand_drvdata *drvdata,
 			     const u8 *buf,
 			     unsigned len)
 {
 	void __iomem *base = drvdata->ath79_gpio_base;
 	u32 oe_reg;
-	u32 out_reg;
 	u32 out;
 	unsigned i;
 
-	rb91x_nand_latch_lock(drvdata, 1);
-	rb91x_nand_rst_key_poll_disable(drvdata, 1);
-
-	oe_reg = __raw_readl(base + AR71XX_GPIO_REG_OE);
-	out_reg = __raw_readl(base + AR71XX_GPIO_REG_OUT);
-
 	/* Set data lines to output mode */
+	oe_reg = __raw_readl(base + AR71XX_GPIO_REG_OE);
 	__raw_writel(oe_reg & ~(RB91X_NAND_DATA_BITS | RB91X_NAND_NRW_BIT),
 		     base + AR71XX_GPIO_REG_OE);
 
-	out = out_reg & ~(RB91X_NAND_DATA_BITS | RB91X_NAND_NRW_BIT);
+	out = __raw_readl(base + AR71XX_GPIO_REG_OUT) &
+	      ~(RB91X_NAND_DATA_BITS | RB91X_NAND_NRW_BIT);
 	for (i = 0; i != len; i++) {
 		u32 data;
 
@@ -147,15 +180,6 @@ static void rb91x_nand_write(struct rb91x_nand_drvdata *drvdata,
 		/* Flush write */
 		__raw_readl(base + AR71XX_GPIO_REG_OUT);
 	}
-
-	/* Restore registers */
-	__raw_writel(out_reg, base + AR71XX_GPIO_REG_OUT);
-	__raw_writel(oe_reg, base + AR71XX_GPIO_REG_OE);
-	/* Flush write */
-	__raw_readl(base + AR71XX_GPIO_REG_OUT);
-
-	rb91x_nand_rst_key_poll_disable(drvdata, 0);
-	rb91x_nand_latch_lock(drvdata, 0);
 }
 
 static void rb91x_nand_read(struct rb91x_nand_drvdata *drvdata,
@@ -163,32 +187,24 @@ static void rb91x_nand_read(struct rb91x_nand_drvdata *drvdata,
 			    unsigned len)
 {
 	void __iomem *base = drvdata->ath79_gpio_base;
-	u32 oe_reg;
-	u32 out_reg;
 	unsigned i;
 
 	/* Enable read mode */
 	gpiod_set_value_cansleep(drvdata->gpio[RB91X_NAND_READ], 1);
 
-	rb91x_nand_latch_lock(drvdata, 1);
-	rb91x_nand_rst_key_poll_disable(drvdata, 1);
-
-	/* Save registers */
-	oe_reg = __raw_readl(base + AR71XX_GPIO_REG_OE);
-	out_reg = __raw_readl(base + AR71XX_GPIO_REG_OUT);
-
 	/* Set data lines to input mode */
-	__raw_writel(oe_reg | RB91X_NAND_DATA_BITS,
+	__raw_writel(__raw_readl(base + AR71XX_GPIO_REG_OE) | RB91X_NAND_DATA_BITS,
 		     base + AR71XX_GPIO_REG_OE);
 
 	for (i = 0; i < len; i++) {
 		u32 in;
 		u8 data;
 
-		/* Activate RE line */
+		/*
+		 * Activate RE line. The read of the input lines is ordered
+		 * after this write, so it needs no flush of its own.
+		 */
 		__raw_writel(RB91X_NAND_NRW_BIT, base + AR71XX_GPIO_REG_CLEAR);
-		/* Flush write */
-		__raw_readl(base + AR71XX_GPIO_REG_CLEAR);
 
 		/* Read input lines */
 		in = __raw_readl(base + AR71XX_GPIO_REG_IN);
@@ -203,65 +219,80 @@ static void rb91x_nand_read(struct rb91x_nand_drvdata *drvdata,
 		read_buf[i] = data;
 	}
 
-	/* Restore  registers */
-	__raw_writel(out_reg, base + AR71XX_GPIO_REG_OUT);
-	__raw_writel(oe_reg, base + AR71XX_GPIO_REG_OE);
-	/* Flush write */
-	__raw_readl(base + AR71XX_GPIO_REG_OUT);
-
-	rb91x_nand_rst_key_poll_disable(drvdata, 0);
-	rb91x_nand_latch_lock(drvdata, 0);
-
 	/* Disable read mode */
 	gpiod_set_value_cansleep(drvdata->gpio[RB91X_NAND_READ], 0);
 }
 
-static int rb91x_nand_dev_ready(struct nand_chip *chip)
+static int rb91x_nand_exec_instr(struct rb91x_nand_drvdata *drvdata,
+				 const struct nand_op_instr *instr)
 {
-	struct rb91x_nand_drvdata *drvdata = (struct rb91x_nand_drvdata *)(chip->priv);
+	switch (instr->type) {
+	case NAND_OP_CMD_INSTR:
+		gpiod_set_value_cansleep(drvdata->gpio[RB91X_NAND_CLE], 1);
+		rb91x_nand_write(drvdata, &instr->ctx.cmd.opcode, 1);
+		gpiod_set_value_cansleep(drvdata->gpio[RB91X_NAND_CLE], 0);
+		return 0;
+
+	case NAND_OP_ADDR_INSTR:
+		gpiod_set_value_cansleep(drvdata->gpio[RB91X_NAND_ALE], 1);
+		rb91x_nand_write(drvdata, instr->ctx.addr.addrs,
+				 instr->ctx.addr.naddrs);
+		gpiod_set_value_cansleep(drvdata->gpio[RB91X_NAND_ALE], 0);
+		return 0;
+
+	case NAND_OP_DATA_IN_INSTR:
+		rb91x_nand_read(drvdata, instr->ctx.data.buf.in,
+				instr->ctx.data.len);
+		return 0;
+
+	case NAND_OP_DATA_OUT_INSTR:
+		rb91x_nand_write(drvdata, instr->ctx.data.buf.out,
+				 instr->ctx.data.len);
+		return 0;
+
+	case NAND_OP_WAITRDY_INSTR:
+		return nand_gpio_waitrdy(&drvdata->chip,
+					 drvdata->gpio[RB91X_NAND_RDY],
+					 instr->ctx.waitrdy.timeout_ms);
+	}
 
-	return gpiod_get_value_cansleep(drvdata->gpio[RB91X_NAND_RDY]);
+	return -EINVAL;
 }
 
-static void rb91x_nand_cmd_ctrl(struct nand_chip *chip, int cmd,
-				unsigned int ctrl)
+static int rb91x_nand_exec_op(struct nand_chip *chip,
+			      const struct nand_operation *op,
+			      bool check_only)
 {
 	struct rb91x_nand_drvdata *drvdata = chip->priv;
+	unsigned int i;
+	int ret = 0;
 
-	if (ctrl & NAND_CTRL_CHANGE) {
-		gpiod_set_value_cansleep(drvdata->gpio[RB91X_NAND_CLE],
-					(ctrl & NAND_CLE) ? 1 : 0);
-		gpiod_set_value_cansleep(drvdata->gpio[RB91X_NAND_ALE],
-					(ctrl & NAND_ALE) ? 1 : 0);
-		gpiod_set_value_cansleep(drvdata->gpio[RB91X_NAND_NCE],
-					(ctrl & NAND_NCE) ? 1 : 0);
-	}
+	if (check_only)
+		return 0;
 
-	if (cmd != NAND_CMD_NONE) {
-		u8 t = cmd;
+	gpiod_set_value_cansleep(drvdata->gpio[RB91X_NAND_NCE], 1);
+	rb91x_nand_bus_begin(drvdata);
 
-		rb91x_nand_write(drvdata, &t, 1);
-	}
-}
+	for (i = 0; i < op->ninstrs; i++) {
+		const struct nand_op_instr *instr = &op->instrs[i];
 
-static u8 rb91x_nand_read_byte(struct nand_chip *chip)
-{
-	u8 data = 0xff;
+		ret = rb91x_nand_exec_instr(drvdata, instr);
+		if (ret)
+			break;
 
-	rb91x_nand_read(chip->priv, &data, 1);
+		if (instr->delay_ns)
+			ndelay(instr->delay_ns);
+	}
 
-	return data;
-}
+	rb91x_nand_bus_end(drvdata);
+	gpiod_set_value_cansleep(drvdata->gpio[RB91X_NAND_NCE], 0);
 
-static void rb91x_nand_read_buf(struct nand_chip *chip, u8 *buf, int len)
-{
-	rb91x_nand_read(chip->priv, buf, len);
+	return ret;
 }
 
-static void rb91x_nand_write_buf(struct nand_chip *chip, const u8 *buf, int len)
-{
-	rb91x_nand_write(chip->priv, buf, len);
-}
+static const struct nand_controller_ops rb91x_nand_controller_ops = {
+	.exec_op = rb91x_nand_exec_op,
+};
 
 static void rb91x_nand_release(struct rb91x_nand_drvdata *drvdata)
 {
@@ -300,15 +331,12 @@ static int rb91x_nand_probe(struct platform_device *pdev)
 
 	drvdata->dev = dev;
 
-	drvdata->chip.priv = drvdata;
+	nand_controller_init(&drvdata->controller);
+	drvdata->controller.ops = &rb91x_nand_controller_ops;
 
-	drvdata->chip.legacy.cmd_ctrl = rb91x_nand_cmd_ctrl;
-	drvdata->chip.legacy.dev_ready = rb91x_nand_dev_ready;
-	drvdata->chip.legacy.read_byte = rb91x_nand_read_byte;
-	drvdata->chip.legacy.write_buf = rb91x_nand_write_buf;
-	drvdata->chip.legacy.read_buf = rb91x_nand_read_buf;
+	drvdata->chip.priv = drvdata;
+	drvdata->chip.controller = &drvdata->controller;
 
-	drvdata->chip.legacy.chip_delay = 25;
 	drvdata->chip.ecc.engine_type      = NAND_ECC_ENGINE_TYPE_SOFT;
 	drvdata->chip.ecc.algo             = NAND_ECC_ALGO_HAMMING;
 	drvdata->chip.options = NAND_NO_SUBPAGE_WRITE;
@@ -30,10 +30,15 @@
 #include <linux/skbuff.h>
 #include <linux/dma-mapping.h>
 #include <linux/workqueue.h>
+#include <linux/hrtimer.h>
 #include <linux/reset.h>
 #include <linux/of.h>
 #include <linux/mfd/syscon.h>
 #include <linux/regmap.h>
+#include <linux/bpf.h>
+#include <linux/bpf_trace.h>
+#include <net/xdp.h>
+#include <net/page_pool/helpers.h>
 
 #include <linux/bitops.h>
 
@@ -65,8 +70,20 @@
 #define AG71XX_TX_RING_SIZE_DEFAULT	128
 #define AG71XX_RX_RING_SIZE_DEFAULT	256
 
-#define AG71XX_TX_RING_SIZE_MAX		256
-#define AG71XX_RX_RING_SIZE_MAX		256
+#define AG71XX_TX_RING_SIZE_MAX		1024
+#define AG71XX_RX_RING_SIZE_MAX		1024
+
+/*
+ * Interrupt moderation: the RX/TX interrupts stay masked and NAPI is
+ * rescheduled from a timer while the polls keep finding work. In
+ * adaptive mode this only kicks in above AG71XX_MODER_THRESH packets per
+ * poll on average, and the delay is tuned to gather about half a NAPI
+ * budget per poll, bounded by the configured rx-usecs.
+ */
+#define AG71XX_MODER_THRESH		(AG71XX_NAPI_WEIGHT / 4)
+#define AG71XX_MODER_USECS_MIN		10
+#define AG71XX_MODER_USECS_DEFAULT	100
+#define AG71XX_MODER_USECS_MAX		1000
 
 #ifdef CONFIG_AG71XX_LEGACY_DEBUG
 #define DBG(fmt, args...)	pr_debug(fmt, ## args)
@@ -95,15 +112,22 @@ struct ag71xx_desc {
 #define AG71XX_DESC_SIZE	roundup(sizeof(struct ag71xx_desc), \
 					L1_CACHE_BYTES)
 
+enum ag71xx_buf_type {
+	AG71XX_BUF_SKB,
+	AG71XX_BUF_XDP,
+};
+
 struct ag71xx_buf {
 	union {
 		struct sk_buff	*skb;
-		void		*rx_buf;
+		struct xdp_frame *xdpf;
+		struct page	*page;
 	};
 	union {
 		dma_addr_t	dma_addr;
 		unsigned int		len;
 	};
+	enum ag71xx_buf_type	type;
 };
 
 struct ag71xx_ring {
@@ -139,6 +163,15 @@ struct ag71xx_napi_stats {
 	unsigned long		tx[AG71XX_NAPI_WEIGHT + 1];
 };
 
+struct ag71xx_moder {
+	struct hrtimer		timer;
+	unsigned int		usecs;
+	unsigned int		delay;
+	int			avg;	/* packets per poll, in 1/16 */
+	bool			adaptive;
+	unsigned long		deferred;
+};
+
 struct ag71xx_debug {
 	struct dentry		*debugfs_dir;
 
@@ -158,15 +191,21 @@ struct ag71xx {
 
 	u16			desc_pktlen_mask;
 	u16			rx_buf_size;
-	u8			rx_buf_offset;
+	u16			rx_buf_offset;
+	u8			rx_page_order;
 	u8			tx_hang_workaround:1;
 
 	struct net_device	*dev;
 	struct platform_device  *pdev;
 	spinlock_t		lock;
 	struct napi_struct	napi;
+	struct ag71xx_moder	moder;
 	u32			msg_enable;
 
+	struct page_pool	*page_pool;
+	struct bpf_prog __rcu	*xdp_prog;
+	struct xdp_rxq_info	xdp_rxq;
+
 	/*
 	 * From this point onwards we're not looking at per-packet fields.
 	 */
@@ -143,6 +143,40 @@ ag71xx_ethtool_set_ringparam(struct net_device *dev,
 	return err;
 }
 
+static int
+ag71xx_ethtool_get_coalesce(struct net_device *dev,
+			    struct ethtool_coalesce *ec,
+			    struct kernel_ethtool_coalesce *kernel_coal,
+			    struct netlink_ext_ack *extack)
+{
+	struct ag71xx *ag = netdev_priv(dev);
+
+	ec->rx_coalesce_usecs = ag->moder.usecs;
+	ec->use_adaptive_rx_coalesce = ag->moder.adaptive;
+
+	return 0;
+}
+
+static int
+ag71xx_ethtool_set_coalesce(struct net_device *dev,
+			    struct ethtool_coalesce *ec,
+			    struct kernel_ethtool_coalesce *kernel_coal,
+			    struct netlink_ext_ack *extack)
+{
+	struct ag71xx *ag = netdev_priv(dev);
+
+	if (ec->rx_coalesce_usecs > AG71XX_MODER_USECS_MAX) {
+		NL_SET_ERR_MSG_MOD(extack, "rx-usecs out of range");
+		return -EINVAL;
+	}
+
+	/* picked up by the next poll */
+	ag->moder.usecs = ec->rx_coalesce_usecs;
+	ag->moder.adaptive = ec->use_adaptive_rx_coalesce;
+
+	return 0;
+}
+
 static int ag71xx_ethtool_nway_reset(struct net_device *dev)
 {
 	struct ag71xx *ag = netdev_priv(dev);
@@ -184,10 +218,14 @@ static int ag71xx_ethtool_get_sset_count(struct net_device *ndev, int sset)
 }
 
 struct ethtool_ops ag71xx_ethtool_ops = {
+	.supported_coalesce_params = ETHTOOL_COALESCE_RX_USECS |
+				     ETHTOOL_COALESCE_USE_ADAPTIVE_RX,
 	.get_msglevel	= ag71xx_ethtool_get_msglevel,
 	.set_msglevel	= ag71xx_ethtool_set_msglevel,
 	.get_ringparam	= ag71xx_ethtool_get_ringparam,
 	.set_ringparam	= ag71xx_ethtool_set_ringparam,
+	.get_coalesce	= ag71xx_ethtool_get_coalesce,
+	.set_coalesce	= ag71xx_ethtool_set_coalesce,
 	.get_link_ksettings = phy_ethtool_get_link_ksettings,
 	.set_link_ksettings = phy_ethtool_set_link_ksettings,
 	.get_link	= ethtool_op_get_link,
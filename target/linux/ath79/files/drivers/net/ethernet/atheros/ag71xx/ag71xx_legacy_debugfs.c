@@ -137,6 +137,15 @@ static ssize_t read_file_napi_stats(struct file *file, char __user *user_buf,
 	len += snprintf(buf + len, buflen - len, "%3s: %10lu %10lu\n",
 			"pkt", stats->rx_packets, stats->tx_packets);
 
+	len += snprintf(buf + len, buflen - len,
+			"\nmoderation: %s, %u usecs max, %u usecs now\n",
+			ag->moder.adaptive ? "adaptive" : "static",
+			ag->moder.usecs, ag->moder.delay);
+	len += snprintf(buf + len, buflen - len,
+			"avg: %d.%02d pkts/poll, deferred polls: %lu\n",
+			ag->moder.avg >> 4, ((ag->moder.avg & 15) * 100) >> 4,
+			ag->moder.deferred);
+
 	ret = simple_read_from_buffer(user_buf, count, ppos, buf, len);
 	kfree(buf);
 
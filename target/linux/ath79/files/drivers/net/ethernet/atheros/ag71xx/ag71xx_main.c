@@ -111,7 +111,9 @@ static void ag71xx_ring_tx_clean(struct ag71xx *ag)
 			dev->stats.tx_errors++;
 		}
 
-		if (ring->buf[i].skb) {
+		if (ring->buf[i].skb && ring->buf[i].type == AG71XX_BUF_XDP) {
+			xdp_return_frame(ring->buf[i].xdpf);
+		} else if (ring->buf[i].skb) {
 			bytes_compl += ring->buf[i].len;
 			pkts_compl++;
 			dev_kfree_skb_any(ring->buf[i].skb);
@@ -161,11 +163,22 @@ static void ag71xx_ring_rx_clean(struct ag71xx *ag)
 		return;
 
 	for (i = 0; i < ring_size; i++)
-		if (ring->buf[i].rx_buf) {
-			dma_unmap_single(&ag->pdev->dev, ring->buf[i].dma_addr,
-					 ag->rx_buf_size, DMA_FROM_DEVICE);
-			skb_free_frag(ring->buf[i].rx_buf);
+		if (ring->buf[i].page) {
+			page_pool_put_full_page(ag->page_pool,
+						ring->buf[i].page, false);
+			ring->buf[i].page = NULL;
 		}
+
+	if (xdp_rxq_info_is_reg(&ag->xdp_rxq))
+		xdp_rxq_info_unreg(&ag->xdp_rxq);
+
+	page_pool_destroy(ag->page_pool);
+	ag->page_pool = NULL;
+}
+
+static unsigned int ag71xx_rx_buf_size(struct ag71xx *ag, unsigned int mtu)
+{
+	return SKB_DATA_ALIGN(ag->rx_buf_offset + ag71xx_max_frame_len(mtu));
 }
 
 static int ag71xx_buffer_size(struct ag71xx *ag)
@@ -174,25 +187,70 @@ static int ag71xx_buffer_size(struct ag71xx *ag)
 	       SKB_DATA_ALIGN(sizeof(struct skb_shared_info));
 }
 
+/*
+ * XDP programs only get to see frames which fit into a single page,
+ * including the headroom and the skb_shared_info for XDP_PASS.
+ */
+static bool ag71xx_xdp_mtu_ok(struct ag71xx *ag, unsigned int mtu)
+{
+	return ag71xx_rx_buf_size(ag, mtu) +
+	       SKB_DATA_ALIGN(sizeof(struct skb_shared_info)) <= PAGE_SIZE;
+}
+
 static bool ag71xx_fill_rx_buf(struct ag71xx *ag, struct ag71xx_buf *buf,
-			       int offset,
-			       void *(*alloc)(unsigned int size))
+			       int offset, gfp_t gfp)
 {
 	struct ag71xx_ring *ring = &ag->rx_ring;
 	struct ag71xx_desc *desc = ag71xx_ring_desc(ring, buf - &ring->buf[0]);
-	void *data;
+	struct page *page;
 
-	data = alloc(ag71xx_buffer_size(ag));
-	if (!data)
+	/* the pool syncs the buffer for the device when it recycles it */
+	page = page_pool_alloc_pages(ag->page_pool, gfp | __GFP_NOWARN);
+	if (!page)
 		return false;
 
-	buf->rx_buf = data;
-	buf->dma_addr = dma_map_single(&ag->pdev->dev, data, ag->rx_buf_size,
-				       DMA_FROM_DEVICE);
+	buf->page = page;
+	buf->dma_addr = page_pool_get_dma_addr(page);
 	desc->data = (u32) buf->dma_addr + offset;
 	return true;
 }
 
+static int ag71xx_rx_pool_create(struct ag71xx *ag)
+{
+	struct ag71xx_ring *ring = &ag->rx_ring;
+	struct page_pool_params pp_params = {
+		.order = ag->rx_page_order,
+		.flags = PP_FLAG_DMA_MAP | PP_FLAG_DMA_SYNC_DEV,
+		.pool_size = BIT(ring->order),
+		.nid = NUMA_NO_NODE,
+		.dev = &ag->pdev->dev,
+		.napi = &ag->napi,
+		.offset = ag->rx_buf_offset,
+		.max_len = ag->rx_buf_size - ag->rx_buf_offset,
+	};
+	int err;
+
+	/* XDP_TX sends the frame from the RX page it was received in */
+	if (rcu_access_pointer(ag->xdp_prog))
+		pp_params.dma_dir = DMA_BIDIRECTIONAL;
+	else
+		pp_params.dma_dir = DMA_FROM_DEVICE;
+
+	ag->page_pool = page_pool_create(&pp_params);
+	if (IS_ERR(ag->page_pool)) {
+		err = PTR_ERR(ag->page_pool);
+		ag->page_pool = NULL;
+		return err;
+	}
+
+	err = xdp_rxq_info_reg(&ag->xdp_rxq, ag->dev, 0, ag->napi.napi_id);
+	if (err)
+		return err;
+
+	return xdp_rxq_info_reg_mem_model(&ag->xdp_rxq, MEM_TYPE_PAGE_POOL,
+					  ag->page_pool);
+}
+
 static int ag71xx_ring_rx_init(struct ag71xx *ag)
 {
 	struct ag71xx_ring *ring = &ag->rx_ring;
@@ -201,7 +259,10 @@ static int ag71xx_ring_rx_init(struct ag71xx *ag)
 	unsigned int i;
 	int ret;
 
-	ret = 0;
+	ret = ag71xx_rx_pool_create(ag);
+	if (ret)
+		return ret;
+
 	for (i = 0; i < ring_size; i++) {
 		struct ag71xx_desc *desc = ag71xx_ring_desc(ring, i);
 
@@ -216,7 +277,7 @@ static int ag71xx_ring_rx_init(struct ag71xx *ag)
 		struct ag71xx_desc *desc = ag71xx_ring_desc(ring, i);
 
 		if (!ag71xx_fill_rx_buf(ag, &ring->buf[i], ag->rx_buf_offset,
-					netdev_alloc_frag)) {
+					GFP_KERNEL)) {
 			ret = -ENOMEM;
 			break;
 		}
@@ -248,9 +309,9 @@ static int ag71xx_ring_rx_refill(struct ag71xx *ag)
 		i = ring->dirty & ring_mask;
 		desc = ag71xx_ring_desc(ring, i);
 
-		if (!ring->buf[i].rx_buf &&
+		if (!ring->buf[i].page &&
 		    !ag71xx_fill_rx_buf(ag, &ring->buf[i], offset,
-					napi_alloc_frag))
+					GFP_ATOMIC))
 			break;
 
 		desc->ctrl = DESC_EMPTY;
@@ -312,8 +373,9 @@ static void ag71xx_rings_free(struct ag71xx *ag)
 
 static void ag71xx_rings_cleanup(struct ag71xx *ag)
 {
-	ag71xx_ring_rx_clean(ag);
+	/* XDP_TX frames still on the TX ring belong to the RX page pool */
 	ag71xx_ring_tx_clean(ag);
+	ag71xx_ring_rx_clean(ag);
 	ag71xx_rings_free(ag);
 
 	netdev_reset_queue(ag->dev);
@@ -984,12 +1046,14 @@ static int ag71xx_hw_enable(struct ag71xx *ag)
 
 static void ag71xx_hw_disable(struct ag71xx *ag)
 {
-	netif_stop_queue(ag->dev);
+	/* also fences off ndo_xdp_xmit, which runs under the TX queue lock */
+	netif_tx_disable(ag->dev);
 
 	ag71xx_hw_stop(ag);
 	ag71xx_dma_reset(ag);
 
 	napi_disable(&ag->napi);
+	hrtimer_cancel(&ag->moder.timer);
 	del_timer_sync(&ag->oom_timer);
 
 	ag71xx_rings_cleanup(ag);
@@ -1003,7 +1067,8 @@ static int ag71xx_open(struct net_device *dev)
 
 	netif_carrier_off(dev);
 	max_frame_len = ag71xx_max_frame_len(dev->mtu);
-	ag->rx_buf_size = SKB_DATA_ALIGN(max_frame_len + NET_SKB_PAD + NET_IP_ALIGN);
+	ag->rx_buf_size = ag71xx_rx_buf_size(ag, dev->mtu);
+	ag->rx_page_order = get_order(ag71xx_buffer_size(ag));
 
 	/* setup max frame length */
 	ag71xx_wr(ag, AG71XX_REG_MAC_MFL, max_frame_len);
@@ -1024,18 +1089,17 @@ err:
 
 static int ag71xx_stop(struct net_device *dev)
 {
-	unsigned long flags;
 	struct ag71xx *ag = netdev_priv(dev);
 
 	netif_carrier_off(dev);
 	phy_stop(ag->phy_dev);
 
-	spin_lock_irqsave(&ag->lock, flags);
+	spin_lock_bh(&ag->lock);
 	if (ag->link) {
 		ag->link = 0;
 		ag71xx_link_adjust(ag);
 	}
-	spin_unlock_irqrestore(&ag->lock, flags);
+	spin_unlock_bh(&ag->lock);
 
 	ag71xx_hw_disable(ag);
 
@@ -1091,16 +1155,25 @@ static int ag71xx_fill_dma_desc(struct ag71xx_ring *ring, u32 addr, int len)
 	return ndesc;
 }
 
+static bool ag71xx_tx_ring_full(struct ag71xx_ring *ring)
+{
+	int ring_min = 2;
+
+	if (ring->desc_split)
+	    ring_min *= AG71XX_TX_RING_DS_PER_PKT;
+
+	return ring->curr - ring->dirty >= BIT(ring->order) - ring_min;
+}
+
 static netdev_tx_t ag71xx_hard_start_xmit(struct sk_buff *skb,
 					  struct net_device *dev)
 {
 	struct ag71xx *ag = netdev_priv(dev);
 	struct ag71xx_ring *ring = &ag->tx_ring;
 	int ring_mask = BIT(ring->order) - 1;
-	int ring_size = BIT(ring->order);
 	struct ag71xx_desc *desc;
 	dma_addr_t dma_addr;
-	int i, n, ring_min;
+	int i, n;
 
 	if (skb->len <= 4) {
 		DBG("%s: packet len is too small\n", ag->dev->name);
@@ -1121,6 +1194,7 @@ static netdev_tx_t ag71xx_hard_start_xmit(struct sk_buff *skb,
 	i = (ring->curr + n - 1) & ring_mask;
 	ring->buf[i].len = skb->len;
 	ring->buf[i].skb = skb;
+	ring->buf[i].type = AG71XX_BUF_SKB;
 
 	netdev_sent_queue(dev, skb->len);
 
@@ -1132,11 +1206,7 @@ static netdev_tx_t ag71xx_hard_start_xmit(struct sk_buff *skb,
 	/* flush descriptor */
 	wmb();
 
-	ring_min = 2;
-	if (ring->desc_split)
-	    ring_min *= AG71XX_TX_RING_DS_PER_PKT;
-
-	if (ring->curr - ring->dirty >= ring_size - ring_min) {
+	if (ag71xx_tx_ring_full(ring)) {
 		DBG("%s: tx queue full\n", dev->name);
 		netif_stop_queue(dev);
 	}
@@ -1229,6 +1299,8 @@ static int ag71xx_tx_packets(struct ag71xx *ag, bool flush, int budget)
 	int ring_mask = BIT(ring->order) - 1;
 	int ring_size = BIT(ring->order);
 	int sent = 0;
+	int bytes = 0;
+	int pkts_compl = 0;
 	int bytes_compl = 0;
 	int n = 0;
 
@@ -1237,7 +1309,7 @@ static int ag71xx_tx_packets(struct ag71xx *ag, bool flush, int budget)
 	while (ring->dirty + n != ring->curr) {
 		unsigned int i = (ring->dirty + n) & ring_mask;
 		struct ag71xx_desc *desc = ag71xx_ring_desc(ring, i);
-		struct sk_buff *skb = ring->buf[i].skb;
+		struct ag71xx_buf *buf = &ring->buf[i];
 
 		if (!flush && !ag71xx_desc_empty(desc)) {
 			if (ag->tx_hang_workaround &&
@@ -1252,14 +1324,20 @@ static int ag71xx_tx_packets(struct ag71xx *ag, bool flush, int budget)
 			desc->ctrl |= DESC_EMPTY;
 
 		n++;
-		if (!skb)
+		if (!buf->skb)
 			continue;
 
-		napi_consume_skb(skb, budget);
-		ring->buf[i].skb = NULL;
-
-		bytes_compl += ring->buf[i].len;
+		/* XDP frames are not accounted in BQL */
+		if (buf->type == AG71XX_BUF_XDP) {
+			xdp_return_frame(buf->xdpf);
+		} else {
+			napi_consume_skb(buf->skb, budget);
+			bytes_compl += buf->len;
+			pkts_compl++;
+		}
+		buf->skb = NULL;
 
+		bytes += buf->len;
 		sent++;
 		ring->dirty += n;
 
@@ -1274,10 +1352,10 @@ static int ag71xx_tx_packets(struct ag71xx *ag, bool flush, int budget)
 	if (!sent)
 		return 0;
 
-	ag->dev->stats.tx_bytes += bytes_compl;
+	ag->dev->stats.tx_bytes += bytes;
 	ag->dev->stats.tx_packets += sent;
 
-	netdev_completed_queue(ag->dev, sent, bytes_compl);
+	netdev_completed_queue(ag->dev, pkts_compl, bytes_compl);
 	if ((ring->curr - ring->dirty) < (ring_size * 3) / 4)
 		netif_wake_queue(ag->dev);
 
@@ -1287,27 +1365,181 @@ static int ag71xx_tx_packets(struct ag71xx *ag, bool flush, int budget)
 	return sent;
 }
 
+#define AG71XX_XDP_PASS		0
+#define AG71XX_XDP_CONSUMED	BIT(0)
+#define AG71XX_XDP_TX		BIT(1)
+#define AG71XX_XDP_REDIR	BIT(2)
+
+static int ag71xx_xdp_submit(struct ag71xx *ag, struct netdev_queue *txq,
+			     struct xdp_frame *xdpf, bool dma_map)
+{
+	struct ag71xx_ring *ring = &ag->tx_ring;
+	int ring_mask = BIT(ring->order) - 1;
+	struct ag71xx_desc *desc;
+	dma_addr_t dma_addr;
+	int i, n;
+
+	/* the queue is also stopped while the rings are torn down */
+	if (netif_xmit_stopped(txq) || xdpf->len <= 4)
+		return -ENOSPC;
+
+	if (dma_map) {
+		dma_addr = dma_map_single(&ag->pdev->dev, xdpf->data,
+					  xdpf->len, DMA_TO_DEVICE);
+		if (dma_mapping_error(&ag->pdev->dev, dma_addr))
+			return -ENOMEM;
+	} else {
+		struct page *page = virt_to_head_page(xdpf->data);
+
+		dma_addr = page_pool_get_dma_addr(page) +
+			   (xdpf->data - page_address(page));
+		dma_sync_single_for_device(&ag->pdev->dev, dma_addr,
+					   xdpf->len, DMA_BIDIRECTIONAL);
+	}
+
+	i = ring->curr & ring_mask;
+	desc = ag71xx_ring_desc(ring, i);
+
+	n = ag71xx_fill_dma_desc(ring, (u32) dma_addr,
+				 xdpf->len & ag->desc_pktlen_mask);
+	if (n < 0) {
+		if (dma_map)
+			dma_unmap_single(&ag->pdev->dev, dma_addr, xdpf->len,
+					 DMA_TO_DEVICE);
+		return -ENOSPC;
+	}
+
+	i = (ring->curr + n - 1) & ring_mask;
+	ring->buf[i].len = xdpf->len;
+	ring->buf[i].xdpf = xdpf;
+	ring->buf[i].type = AG71XX_BUF_XDP;
+
+	desc->ctrl &= ~DESC_EMPTY;
+	ring->curr += n;
+
+	/* flush descriptor */
+	wmb();
+
+	if (ag71xx_tx_ring_full(ring))
+		netif_tx_stop_queue(txq);
+
+	txq_trans_cond_update(txq);
+
+	return 0;
+}
+
+static bool ag71xx_xdp_tx(struct ag71xx *ag, struct xdp_buff *xdp)
+{
+	struct netdev_queue *txq = netdev_get_tx_queue(ag->dev, 0);
+	struct xdp_frame *xdpf;
+	int err;
+
+	xdpf = xdp_convert_buff_to_frame(xdp);
+	if (unlikely(!xdpf))
+		return false;
+
+	__netif_tx_lock(txq, smp_processor_id());
+	err = ag71xx_xdp_submit(ag, txq, xdpf, false);
+	__netif_tx_unlock(txq);
+
+	return !err;
+}
+
+static int ag71xx_xdp_xmit(struct net_device *dev, int n,
+			   struct xdp_frame **frames, u32 flags)
+{
+	struct netdev_queue *txq = netdev_get_tx_queue(dev, 0);
+	struct ag71xx *ag = netdev_priv(dev);
+	int i, nxmit = 0;
+
+	if (unlikely(flags & ~XDP_XMIT_FLAGS_MASK))
+		return -EINVAL;
+
+	__netif_tx_lock(txq, smp_processor_id());
+	for (i = 0; i < n; i++) {
+		if (ag71xx_xdp_submit(ag, txq, frames[i], true))
+			break;
+		nxmit++;
+	}
+	__netif_tx_unlock(txq);
+
+	/* enable TX engine */
+	if (nxmit && (flags & XDP_XMIT_FLUSH))
+		ag71xx_wr(ag, AG71XX_REG_TX_CTRL, TX_CTRL_TXE);
+
+	return nxmit;
+}
+
+static u32 ag71xx_run_xdp(struct ag71xx *ag, struct bpf_prog *prog,
+			  struct xdp_buff *xdp)
+{
+	struct page *page = virt_to_head_page(xdp->data_hard_start);
+	unsigned int len = xdp->data_end - xdp->data;
+	unsigned int sync;
+	u32 act;
+
+	act = bpf_prog_run_xdp(prog, xdp);
+	switch (act) {
+	case XDP_PASS:
+		return AG71XX_XDP_PASS;
+	case XDP_TX:
+		if (likely(ag71xx_xdp_tx(ag, xdp)))
+			return AG71XX_XDP_TX;
+		goto out_failure;
+	case XDP_REDIRECT:
+		if (likely(!xdp_do_redirect(ag->dev, xdp, prog)))
+			return AG71XX_XDP_REDIR;
+		goto out_failure;
+	default:
+		bpf_warn_invalid_xdp_action(ag->dev, prog, act);
+		fallthrough;
+	case XDP_ABORTED:
+out_failure:
+		trace_xdp_exception(ag->dev, prog, act);
+		ag->dev->stats.rx_dropped++;
+		fallthrough;
+	case XDP_DROP:
+		break;
+	}
+
+	/* only what the MAC or the program wrote needs to go back to the device */
+	sync = xdp->data_end - xdp->data_hard_start - ag->rx_buf_offset;
+	page_pool_put_page(ag->page_pool, page, max(sync, len), true);
+
+	return AG71XX_XDP_CONSUMED;
+}
+
 static int ag71xx_rx_packets(struct ag71xx *ag, int limit)
 {
 	struct net_device *dev = ag->dev;
 	struct ag71xx_ring *ring = &ag->rx_ring;
 	unsigned int pktlen_mask = ag->desc_pktlen_mask;
 	unsigned int offset = ag->rx_buf_offset;
+	unsigned int frame_sz = PAGE_SIZE << ag->rx_page_order;
 	int ring_mask = BIT(ring->order) - 1;
 	int ring_size = BIT(ring->order);
 	struct list_head rx_list;
+	struct bpf_prog *prog;
+	struct xdp_buff xdp;
 	struct sk_buff *skb;
+	u32 xdp_flags = 0;
 	int done = 0;
 
 	DBG("%s: rx packets, limit=%d, curr=%u, dirty=%u\n",
 			dev->name, limit, ring->curr, ring->dirty);
 	INIT_LIST_HEAD(&rx_list);
+	xdp_init_buff(&xdp, frame_sz, &ag->xdp_rxq);
+
+	rcu_read_lock();
+	prog = rcu_dereference(ag->xdp_prog);
 
 	while (done < limit) {
 		unsigned int i = ring->curr & ring_mask;
 		struct ag71xx_desc *desc = ag71xx_ring_desc(ring, i);
+		struct page *page = ring->buf[i].page;
+		unsigned int headroom = offset;
 		int pktlen;
-		int err = 0;
+		u32 ret;
 
 		if (ag71xx_desc_empty(desc))
 			break;
@@ -1322,37 +1554,57 @@ static int ag71xx_rx_packets(struct ag71xx *ag, int limit)
 		pktlen = desc->ctrl & pktlen_mask;
 		pktlen -= ETH_FCS_LEN;
 
-		dma_unmap_single(&ag->pdev->dev, ring->buf[i].dma_addr,
-				 ag->rx_buf_size, DMA_FROM_DEVICE);
+		/* only the part written by the MAC needs to be synced */
+		dma_sync_single_for_cpu(&ag->pdev->dev,
+					ring->buf[i].dma_addr + offset, pktlen,
+					page_pool_get_dma_dir(ag->page_pool));
 
 		dev->stats.rx_packets++;
 		dev->stats.rx_bytes += pktlen;
 
-		skb = napi_build_skb(ring->buf[i].rx_buf, ag71xx_buffer_size(ag));
+		if (prog) {
+			xdp_prepare_buff(&xdp, page_address(page), offset,
+					 pktlen, false);
+			ret = ag71xx_run_xdp(ag, prog, &xdp);
+			if (ret != AG71XX_XDP_PASS) {
+				xdp_flags |= ret;
+				goto next;
+			}
+
+			headroom = xdp.data - xdp.data_hard_start;
+			pktlen = xdp.data_end - xdp.data;
+		}
+
+		skb = napi_build_skb(page_address(page), frame_sz);
 		if (!skb) {
-			skb_free_frag(ring->buf[i].rx_buf);
+			page_pool_recycle_direct(ag->page_pool, page);
 			goto next;
 		}
 
-		skb_reserve(skb, offset);
+		skb_mark_for_recycle(skb);
+		skb_reserve(skb, headroom);
 		skb_put(skb, pktlen);
 
-		if (err) {
-			dev->stats.rx_dropped++;
-			kfree_skb(skb);
-		} else {
-			skb->dev = dev;
-			skb->ip_summed = CHECKSUM_NONE;
-			list_add_tail(&skb->list, &rx_list);
-		}
+		skb->dev = dev;
+		skb->ip_summed = CHECKSUM_NONE;
+		list_add_tail(&skb->list, &rx_list);
 
 next:
-		ring->buf[i].rx_buf = NULL;
+		ring->buf[i].page = NULL;
 		done++;
 
 		ring->curr++;
 	}
 
+	rcu_read_unlock();
+
+	/* enable TX engine for the XDP_TX frames */
+	if (xdp_flags & AG71XX_XDP_TX)
+		ag71xx_wr(ag, AG71XX_REG_TX_CTRL, TX_CTRL_TXE);
+
+	if (xdp_flags & AG71XX_XDP_REDIR)
+		xdp_do_flush();
+
 	ag71xx_ring_rx_refill(ag);
 
 	list_for_each_entry(skb, &rx_list, list)
@@ -1365,6 +1617,73 @@ next:
 	return done;
 }
 
+static enum hrtimer_restart ag71xx_moder_timer(struct hrtimer *timer)
+{
+	struct ag71xx *ag = container_of(timer, struct ag71xx, moder.timer);
+
+	napi_schedule(&ag->napi);
+
+	return HRTIMER_NORESTART;
+}
+
+static void ag71xx_moder_update(struct ag71xx *ag, int rx, int tx)
+{
+	struct ag71xx_moder *m = &ag->moder;
+
+	m->avg += (((rx + tx) << 4) - m->avg) / 8;
+}
+
+/*
+ * Decide whether NAPI should come back from the moderation timer instead
+ * of re-enabling the interrupts. work is what the current poll handled.
+ */
+static bool ag71xx_moder_defer(struct ag71xx *ag, int work)
+{
+	struct ag71xx_moder *m = &ag->moder;
+
+	if (!m->usecs)
+		return false;
+
+	if (!m->adaptive) {
+		m->delay = m->usecs;
+		return work > 0;
+	}
+
+	if ((m->avg >> 4) < AG71XX_MODER_THRESH) {
+		m->delay = AG71XX_MODER_USECS_MIN;
+		return false;
+	}
+
+	if (work > AG71XX_NAPI_WEIGHT / 2)
+		m->delay = max_t(unsigned int, m->delay / 2,
+				 AG71XX_MODER_USECS_MIN);
+	else if (work < AG71XX_NAPI_WEIGHT / 4)
+		m->delay = min(m->delay * 2, m->usecs);
+
+	return true;
+}
+
+/*
+ * The RX/TX status packet counters are only 8 bits wide, with rings
+ * larger than that they may run dry while descriptors are still pending.
+ */
+static bool ag71xx_rx_pending(struct ag71xx *ag)
+{
+	struct ag71xx_ring *ring = &ag->rx_ring;
+	int ring_mask = BIT(ring->order) - 1;
+
+	return !ag71xx_desc_empty(ag71xx_ring_desc(ring, ring->curr & ring_mask));
+}
+
+static bool ag71xx_tx_pending(struct ag71xx *ag)
+{
+	struct ag71xx_ring *ring = &ag->tx_ring;
+	int ring_mask = BIT(ring->order) - 1;
+
+	return ring->curr != ring->dirty &&
+	       ag71xx_desc_empty(ag71xx_ring_desc(ring, ring->dirty & ring_mask));
+}
+
 static int ag71xx_poll(struct napi_struct *napi, int limit)
 {
 	struct ag71xx *ag = container_of(napi, struct ag71xx, napi);
@@ -1382,8 +1701,9 @@ static int ag71xx_poll(struct napi_struct *napi, int limit)
 	rx_done = ag71xx_rx_packets(ag, limit);
 
 	ag71xx_debugfs_update_napi_stats(ag, rx_done, tx_done);
+	ag71xx_moder_update(ag, rx_done, tx_done);
 
-	if (rx_ring->buf[rx_ring->dirty % rx_ring_size].rx_buf == NULL)
+	if (rx_ring->buf[rx_ring->dirty % rx_ring_size].page == NULL)
 		goto oom;
 
 	status = ag71xx_rr(ag, AG71XX_REG_RX_STATUS);
@@ -1396,13 +1716,25 @@ static int ag71xx_poll(struct napi_struct *napi, int limit)
 	}
 
 	if (rx_done < limit) {
-		if (status & RX_STATUS_PR)
+		if (status & RX_STATUS_PR || ag71xx_rx_pending(ag))
 			goto more;
 
 		status = ag71xx_rr(ag, AG71XX_REG_TX_STATUS);
-		if (status & TX_STATUS_PS)
+		if (status & TX_STATUS_PS || ag71xx_tx_pending(ag))
 			goto more;
 
+		if (ag71xx_moder_defer(ag, rx_done + tx_done)) {
+			DBG("%s: poll again in %u us, rx=%d, tx=%d\n",
+				dev->name, ag->moder.delay, rx_done, tx_done);
+
+			ag->moder.deferred++;
+			napi_complete_done(napi, rx_done);
+			hrtimer_start(&ag->moder.timer,
+				      ns_to_ktime(ag->moder.delay * NSEC_PER_USEC),
+				      HRTIMER_MODE_REL_PINNED);
+			return rx_done;
+		}
+
 		DBG("%s: disable polling mode, rx=%d, tx=%d,limit=%d\n",
 			dev->name, rx_done, tx_done, limit);
 
@@ -1467,6 +1799,12 @@ static int ag71xx_change_mtu(struct net_device *dev, int new_mtu)
 {
 	struct ag71xx *ag = netdev_priv(dev);
 
+	if (rcu_access_pointer(ag->xdp_prog) &&
+	    !ag71xx_xdp_mtu_ok(ag, new_mtu)) {
+		pr_err("%s: MTU %d too large for XDP\n", dev->name, new_mtu);
+		return -EINVAL;
+	}
+
 	dev->mtu = new_mtu;
 	ag71xx_wr(ag, AG71XX_REG_MAC_MFL,
 		  ag71xx_max_frame_len(dev->mtu));
@@ -1474,6 +1812,49 @@ static int ag71xx_change_mtu(struct net_device *dev, int new_mtu)
 	return 0;
 }
 
+static int ag71xx_xdp_setup(struct net_device *dev, struct bpf_prog *prog,
+			    struct netlink_ext_ack *extack)
+{
+	struct ag71xx *ag = netdev_priv(dev);
+	struct bpf_prog *old_prog;
+	bool need_update;
+	int err = 0;
+
+	if (prog && !ag71xx_xdp_mtu_ok(ag, dev->mtu)) {
+		NL_SET_ERR_MSG_MOD(extack, "MTU too large for XDP");
+		return -EOPNOTSUPP;
+	}
+
+	/* the RX page pool is recreated with the matching DMA direction */
+	need_update = netif_running(dev) &&
+		      !!rcu_access_pointer(ag->xdp_prog) != !!prog;
+	if (need_update) {
+		err = dev->netdev_ops->ndo_stop(dev);
+		if (err)
+			return err;
+	}
+
+	old_prog = rcu_replace_pointer(ag->xdp_prog, prog,
+				       lockdep_rtnl_is_held());
+	if (old_prog)
+		bpf_prog_put(old_prog);
+
+	if (need_update)
+		err = dev->netdev_ops->ndo_open(dev);
+
+	return err;
+}
+
+static int ag71xx_bpf(struct net_device *dev, struct netdev_bpf *xdp)
+{
+	switch (xdp->command) {
+	case XDP_SETUP_PROG:
+		return ag71xx_xdp_setup(dev, xdp->prog, xdp->extack);
+	default:
+		return -EINVAL;
+	}
+}
+
 static const struct net_device_ops ag71xx_netdev_ops = {
 	.ndo_open		= ag71xx_open,
 	.ndo_stop		= ag71xx_stop,
@@ -1483,6 +1864,8 @@ static const struct net_device_ops ag71xx_netdev_ops = {
 	.ndo_change_mtu		= ag71xx_change_mtu,
 	.ndo_set_mac_address	= eth_mac_addr,
 	.ndo_validate_addr	= eth_validate_addr,
+	.ndo_bpf		= ag71xx_bpf,
+	.ndo_xdp_xmit		= ag71xx_xdp_xmit,
 };
 
 static int ag71xx_probe(struct platform_device *pdev)
@@ -1588,11 +1971,19 @@ static int ag71xx_probe(struct platform_device *pdev)
 
 	dev->netdev_ops = &ag71xx_netdev_ops;
 	dev->ethtool_ops = &ag71xx_ethtool_ops;
+	dev->xdp_features = NETDEV_XDP_ACT_BASIC | NETDEV_XDP_ACT_REDIRECT |
+			    NETDEV_XDP_ACT_NDO_XMIT;
 
 	INIT_DELAYED_WORK(&ag->restart_work, ag71xx_restart_work_func);
 
 	timer_setup(&ag->oom_timer, ag71xx_oom_timer_handler, 0);
 
+	hrtimer_init(&ag->moder.timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL_PINNED);
+	ag->moder.timer.function = ag71xx_moder_timer;
+	ag->moder.usecs = AG71XX_MODER_USECS_DEFAULT;
+	ag->moder.delay = AG71XX_MODER_USECS_MIN;
+	ag->moder.adaptive = true;
+
 	tx_size = AG71XX_TX_RING_SIZE_DEFAULT;
 	ag->rx_ring.order = ag71xx_ring_size_order(AG71XX_RX_RING_SIZE_DEFAULT);
 
@@ -1624,7 +2015,7 @@ static int ag71xx_probe(struct platform_device *pdev)
 	    of_device_is_compatible(np, "qca,qca9560-eth"))
 		ag->tx_hang_workaround = 1;
 
-	ag->rx_buf_offset = NET_SKB_PAD;
+	ag->rx_buf_offset = XDP_PACKET_HEADROOM;
 	if (!of_device_is_compatible(np, "qca,ar7100-eth") &&
 	    !of_device_is_compatible(np, "qca,ar9130-eth"))
 		ag->rx_buf_offset += NET_IP_ALIGN;
@@ -18,10 +18,13 @@ static void ag71xx_phy_link_adjust(struct net_device *dev)
 {
 	struct ag71xx *ag = netdev_priv(dev);
 	struct phy_device *phydev = ag->phy_dev;
-	unsigned long flags;
 	int status_change = 0;
 
-	spin_lock_irqsave(&ag->lock, flags);
+	/*
+	 * A link change flushes the TX ring, XDP frames on it go back to
+	 * their page pool, which must not happen with interrupts disabled.
+	 */
+	spin_lock_bh(&ag->lock);
 
 	if (phydev->link) {
 		if (ag->duplex != phydev->duplex
@@ -40,7 +43,7 @@ static void ag71xx_phy_link_adjust(struct net_device *dev)
 	if (status_change)
 		ag71xx_link_adjust(ag);
 
-	spin_unlock_irqrestore(&ag->lock, flags);
+	spin_unlock_bh(&ag->lock);
 }
 
 int ag71xx_phy_connect(struct ag71xx *ag)
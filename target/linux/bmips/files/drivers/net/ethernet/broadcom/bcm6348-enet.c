@@ -301,6 +301,8 @@ module_platform_driver(bcm6348_iudma_driver);
 #define ENET_TAG_SIZE			6
 #define ENET_MTU_OVERHEAD		(VLAN_ETH_HLEN + VLAN_HLEN + \
 					 ENET_TAG_SIZE)
+#define ENET_FRAG_SIZE(x)		(SKB_DATA_ALIGN(NET_SKB_PAD + x + \
+					 SKB_DATA_ALIGN(sizeof(struct skb_shared_info))))
 
 /* Default number of descriptor */
 #define ENET_DEF_RX_DESC		64
@@ -447,13 +449,16 @@ struct bcm6348_emac {
 	/* next dirty rx descriptor to refill */
 	int rx_dirty_desc;
 
-	/* size of allocated rx skbs */
-	unsigned int rx_skb_size;
+	/* size of allocated rx buffer */
+	unsigned int rx_buf_size;
 
-	/* list of skb given to hw for rx */
-	struct sk_buff **rx_skb;
+	/* size of allocated rx frag */
+	unsigned int rx_frag_size;
 
-	/* used when rx skb allocation failed, so we defer rx queue
+	/* list of buffer given to hw for rx */
+	unsigned char **rx_buf;
+
+	/* used when rx buffer allocation failed, so we defer rx queue
 	 * refill */
 	struct timer_list rx_timeout;
 
@@ -512,7 +517,7 @@ static inline u32 emac_readl(struct bcm6348_emac *emac, u32 off)
 /*
  * refill rx queue
  */
-static int bcm6348_emac_refill_rx(struct net_device *ndev)
+static int bcm6348_emac_refill_rx(struct net_device *ndev, bool napi_mode)
 {
 	struct bcm6348_emac *emac = netdev_priv(ndev);
 	struct bcm6348_iudma *iudma = emac->iudma;
@@ -521,25 +526,36 @@ static int bcm6348_emac_refill_rx(struct net_device *ndev)
 
 	while (emac->rx_desc_count < emac->rx_ring_size) {
 		struct bcm6348_iudma_desc *desc;
-		struct sk_buff *skb;
-		dma_addr_t p;
 		int desc_idx;
 		u32 len_stat;
 
 		desc_idx = emac->rx_dirty_desc;
 		desc = &emac->rx_desc_cpu[desc_idx];
 
-		if (!emac->rx_skb[desc_idx]) {
-			skb = netdev_alloc_skb(ndev, emac->rx_skb_size);
-			if (!skb)
+		if (!emac->rx_buf[desc_idx]) {
+			unsigned char *buf;
+			dma_addr_t p;
+
+			if (likely(napi_mode))
+				buf = napi_alloc_frag(emac->rx_frag_size);
+			else
+				buf = netdev_alloc_frag(emac->rx_frag_size);
+
+			if (unlikely(!buf))
 				break;
-			emac->rx_skb[desc_idx] = skb;
-			p = dma_map_single(dev, skb->data, emac->rx_skb_size,
-					   DMA_FROM_DEVICE);
+
+			p = dma_map_single(dev, buf + NET_SKB_PAD,
+					   emac->rx_buf_size, DMA_FROM_DEVICE);
+			if (unlikely(dma_mapping_error(dev, p))) {
+				skb_free_frag(buf);
+				break;
+			}
+
+			emac->rx_buf[desc_idx] = buf;
 			desc->address = p;
 		}
 
-		len_stat = emac->rx_skb_size << DMADESC_LENGTH_SHIFT;
+		len_stat = emac->rx_buf_size << DMADESC_LENGTH_SHIFT;
 		len_stat |= DMADESC_OWNER_MASK;
 		if (emac->rx_dirty_desc == emac->rx_ring_size - 1) {
 			len_stat |= DMADESC_WRAP_MASK;
@@ -576,7 +592,7 @@ static void bcm6348_emac_refill_rx_timer(struct timer_list *t)
 	struct net_device *ndev = emac->net_dev;
 
 	spin_lock(&emac->rx_lock);
-	bcm6348_emac_refill_rx(ndev);
+	bcm6348_emac_refill_rx(ndev, false);
 	spin_unlock(&emac->rx_lock);
 }
 
@@ -589,6 +605,7 @@ static int bcm6348_emac_receive_queue(struct net_device *ndev, int budget)
 	struct bcm6348_iudma *iudma = emac->iudma;
 	struct platform_device *pdev = emac->pdev;
 	struct device *dev = &pdev->dev;
+	struct sk_buff *skb;
 	int processed = 0;
 
 	/* don't scan ring further than number of refilled
@@ -598,7 +615,8 @@ static int bcm6348_emac_receive_queue(struct net_device *ndev, int budget)
 
 	do {
 		struct bcm6348_iudma_desc *desc;
-		struct sk_buff *skb;
+		unsigned int frag_size;
+		unsigned char *buf;
 		int desc_idx;
 		u32 len_stat;
 		unsigned int len;
@@ -630,17 +648,17 @@ static int bcm6348_emac_receive_queue(struct net_device *ndev, int budget)
 		}
 
 		/* valid packet */
-		skb = emac->rx_skb[desc_idx];
+		buf = emac->rx_buf[desc_idx];
 		len = (len_stat & DMADESC_LENGTH_MASK)
 		      >> DMADESC_LENGTH_SHIFT;
 		/* don't include FCS */
 		len -= 4;
 
 		if (len < emac->copybreak) {
-			struct sk_buff *nskb;
+			unsigned int nfrag_size = ENET_FRAG_SIZE(len);
+			unsigned char *nbuf = napi_alloc_frag(nfrag_size);
 
-			nskb = napi_alloc_skb(&emac->napi, len);
-			if (!nskb) {
+			if (unlikely(!nbuf)) {
 				/* forget packet, just rearm desc */
 				ndev->stats.rx_dropped++;
 				continue;
@@ -648,25 +666,36 @@ static int bcm6348_emac_receive_queue(struct net_device *ndev, int budget)
 
 			dma_sync_single_for_cpu(dev, desc->address,
 						len, DMA_FROM_DEVICE);
-			memcpy(nskb->data, skb->data, len);
+			memcpy(nbuf + NET_SKB_PAD, buf + NET_SKB_PAD, len);
 			dma_sync_single_for_device(dev, desc->address,
 						   len, DMA_FROM_DEVICE);
-			skb = nskb;
+			buf = nbuf;
+			frag_size = nfrag_size;
 		} else {
 			dma_unmap_single(dev, desc->address,
-					 emac->rx_skb_size, DMA_FROM_DEVICE);
-			emac->rx_skb[desc_idx] = NULL;
+					 emac->rx_buf_size, DMA_FROM_DEVICE);
+			emac->rx_buf[desc_idx] = NULL;
+			frag_size = emac->rx_frag_size;
+		}
+
+		skb = napi_build_skb(buf, frag_size);
+		if (unlikely(!skb)) {
+			skb_free_frag(buf);
+			ndev->stats.rx_dropped++;
+			continue;
 		}
 
+		skb_reserve(skb, NET_SKB_PAD);
 		skb_put(skb, len);
 		skb->protocol = eth_type_trans(skb, ndev);
 		ndev->stats.rx_packets++;
 		ndev->stats.rx_bytes += len;
-		netif_receive_skb(skb);
+		/* non-GRO packets are batched on the napi rx list */
+		napi_gro_receive(&emac->napi, skb);
 	} while (--budget > 0);
 
 	if (processed || !emac->rx_desc_count) {
-		bcm6348_emac_refill_rx(ndev);
+		bcm6348_emac_refill_rx(ndev, true);
 
 		/* kick rx dma */
 		dmac_writel(iudma, DMAC_CHANCFG_EN_MASK, DMAC_CHANCFG_REG,
@@ -1147,11 +1176,11 @@ static int bcm6348_emac_open(struct net_device *ndev)
 	emac->tx_curr_desc = 0;
 	spin_lock_init(&emac->tx_lock);
 
-	/* init & fill rx ring with skbs */
-	emac->rx_skb = kzalloc(sizeof(struct sk_buff *) * emac->rx_ring_size,
+	/* init & fill rx ring with buffers */
+	emac->rx_buf = kzalloc(sizeof(unsigned char *) * emac->rx_ring_size,
 			       GFP_KERNEL);
-	if (!emac->rx_skb) {
-		dev_err(dev, "cannot allocate rx skb queue\n");
+	if (!emac->rx_buf) {
+		dev_err(dev, "cannot allocate rx buffer queue\n");
 		ret = -ENOMEM;
 		goto out_free_tx_skb;
 	}
@@ -1164,8 +1193,8 @@ static int bcm6348_emac_open(struct net_device *ndev)
 	dma_writel(iudma, DMA_BUFALLOC_FORCE_MASK | 0,
 		   DMA_BUFALLOC_REG(emac->rx_chan));
 
-	if (bcm6348_emac_refill_rx(ndev)) {
-		dev_err(dev, "cannot allocate rx skb queue\n");
+	if (bcm6348_emac_refill_rx(ndev, false)) {
+		dev_err(dev, "cannot allocate rx buffer queue\n");
 		ret = -ENOMEM;
 		goto out;
 	}
@@ -1243,15 +1272,15 @@ out:
 	for (i = 0; i < emac->rx_ring_size; i++) {
 		struct bcm6348_iudma_desc *desc;
 
-		if (!emac->rx_skb[i])
+		if (!emac->rx_buf[i])
 			continue;
 
 		desc = &emac->rx_desc_cpu[i];
-		dma_unmap_single(dev, desc->address, emac->rx_skb_size,
+		dma_unmap_single(dev, desc->address, emac->rx_buf_size,
 				 DMA_FROM_DEVICE);
-		kfree_skb(emac->rx_skb[i]);
+		skb_free_frag(emac->rx_buf[i]);
 	}
-	kfree(emac->rx_skb);
+	kfree(emac->rx_buf);
 
 out_free_tx_skb:
 	kfree(emac->tx_skb);
@@ -1304,22 +1333,22 @@ static int bcm6348_emac_stop(struct net_device *ndev)
 	/* force reclaim of all tx buffers */
 	bcm6348_emac_tx_reclaim(ndev, 1);
 
-	/* free the rx skb ring */
+	/* free the rx buffer ring */
 	for (i = 0; i < emac->rx_ring_size; i++) {
 		struct bcm6348_iudma_desc *desc;
 
-		if (!emac->rx_skb[i])
+		if (!emac->rx_buf[i])
 			continue;
 
 		desc = &emac->rx_desc_cpu[i];
-		dma_unmap_single_attrs(dev, desc->address, emac->rx_skb_size,
+		dma_unmap_single_attrs(dev, desc->address, emac->rx_buf_size,
 				       DMA_FROM_DEVICE,
 				       DMA_ATTR_SKIP_CPU_SYNC);
-		kfree_skb(emac->rx_skb[i]);
+		skb_free_frag(emac->rx_buf[i]);
 	}
 
 	/* free remaining allocated memory */
-	kfree(emac->rx_skb);
+	kfree(emac->rx_buf);
 	kfree(emac->tx_skb);
 	dma_free_coherent(dev, emac->rx_desc_alloc_size, emac->rx_desc_cpu,
 			  emac->rx_desc_dma);
@@ -1574,9 +1603,11 @@ static int bcm6348_emac_probe(struct platform_device *pdev)
 		dev_info(dev, "random mac\n");
 	}
 
-	emac->rx_skb_size = ALIGN(ndev->mtu + ENET_MTU_OVERHEAD,
+	emac->rx_buf_size = ALIGN(ndev->mtu + ENET_MTU_OVERHEAD,
 				  ENET_DMA_MAXBURST * 4);
 
+	emac->rx_frag_size = ENET_FRAG_SIZE(emac->rx_buf_size);
+
 	emac->num_clocks = of_clk_get_parent_count(node);
 	if (emac->num_clocks) {
 		emac->clock = devm_kcalloc(dev, emac->num_clocks,
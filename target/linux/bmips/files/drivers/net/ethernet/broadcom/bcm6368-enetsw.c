@@ -583,7 +583,7 @@ bcm6368_enetsw_start_xmit(struct sk_buff *skb, struct net_device *ndev)
 		netif_stop_queue(ndev);
 		dev_err(dev, "xmit called with no tx desc available?\n");
 		ret = NETDEV_TX_BUSY;
-		goto out_unlock;
+		goto out_kick;
 	}
 
 	/* pad small packets */
@@ -597,7 +597,7 @@ bcm6368_enetsw_start_xmit(struct sk_buff *skb, struct net_device *ndev)
 			nskb = skb_copy_expand(skb, 0, needed, GFP_ATOMIC);
 			if (!nskb) {
 				ret = NETDEV_TX_BUSY;
-				goto out_unlock;
+				goto out_kick;
 			}
 
 			dev_kfree_skb(skb);
@@ -611,7 +611,7 @@ bcm6368_enetsw_start_xmit(struct sk_buff *skb, struct net_device *ndev)
 	if (unlikely(dma_mapping_error(dev, p))) {
 		dev_kfree_skb(skb);
 		ret = NETDEV_TX_OK;
-		goto out_unlock;
+		goto out_kick;
 	}
 
 	/* point to the next available desc */
@@ -636,19 +636,27 @@ bcm6368_enetsw_start_xmit(struct sk_buff *skb, struct net_device *ndev)
 	desc->len_stat = len_stat;
 	wmb();
 
-	netdev_sent_queue(ndev, skb->len);
-
-	/* kick tx dma */
-	dmac_writel(priv, DMAC_CHANCFG_EN_MASK, DMAC_CHANCFG_REG,
-		    priv->tx_chan);
-
 	/* stop queue if no more desc available */
 	if (!priv->tx_desc_count)
 		netif_stop_queue(ndev);
 
+	/* kick tx dma, unless the stack has more frames coming and the
+	 * queue is still running */
+	if (__netdev_sent_queue(ndev, skb->len, netdev_xmit_more()))
+		dmac_writel(priv, DMAC_CHANCFG_EN_MASK, DMAC_CHANCFG_REG,
+			    priv->tx_chan);
+
 	ndev->stats.tx_bytes += skb->len;
 	ndev->stats.tx_packets++;
 	ret = NETDEV_TX_OK;
+	goto out_unlock;
+
+out_kick:
+	/* this frame may have ended an xmit_more burst, make sure the
+	 * descriptors queued before it are not left waiting */
+	if (!netdev_xmit_more() && priv->tx_desc_count < priv->tx_ring_size)
+		dmac_writel(priv, DMAC_CHANCFG_EN_MASK, DMAC_CHANCFG_REG,
+			    priv->tx_chan);
 
 out_unlock:
 	spin_unlock(&priv->tx_lock);
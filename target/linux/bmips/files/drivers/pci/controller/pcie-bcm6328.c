@@ -83,6 +83,7 @@
 struct bcm6328_pcie {
 	void __iomem *base;
 	int irq;
+	bool link_up;
 	struct regmap *serdes;
 	struct device **pm;
 	struct device_link **link_pm;
@@ -150,10 +151,13 @@ static int bcm6328_pcie_can_access(struct pci_bus *bus, int devfn)
 	case PCIE_BUS_BRIDGE:
 		return PCI_SLOT(devfn) == 0;
 	case PCIE_BUS_DEVICE:
-		if (PCI_SLOT(devfn) == 0)
-			return __raw_readl(priv->base + PCIE_DLSTATUS_REG)
-			       & DLSTATUS_PHYLINKUP;
-		fallthrough;
+		if (PCI_SLOT(devfn) != 0)
+			return false;
+		/* the link stays up once trained, only poll it until then */
+		if (!priv->link_up)
+			priv->link_up = __raw_readl(priv->base + PCIE_DLSTATUS_REG)
+					 & DLSTATUS_PHYLINKUP;
+		return priv->link_up;
 	default:
 		return false;
 	}
@@ -191,7 +195,7 @@ static int bcm6328_pcie_write(struct pci_bus *bus, unsigned int devfn,
 	if (bus->number == PCIE_BUS_DEVICE)
 		reg += PCIE_DEVICE_OFFSET;
 
-	data = __raw_readl(priv->base + reg);
+	data = size == 4 ? 0 : __raw_readl(priv->base + reg);
 	data = preprocess_write(data, val, where, size);
 	__raw_writel(data, priv->base + reg);
 
@@ -14,16 +14,42 @@
 
 #include <linux/export.h>
 #include <linux/init.h>
+#include <linux/jiffies.h>
 #include <linux/kernel.h>
 #include <linux/magic.h>
+#include <linux/mm.h>
 #include <linux/mtd/mtd.h>
 #include <linux/mtd/partitions.h>
+#include <linux/mutex.h>
 #include <linux/byteorder/generic.h>
 
 #include "mtdsplit.h"
 
 #define UBI_EC_MAGIC			0x55424923	/* UBI# */
 
+/*
+ * All split parsers probe the same partition one after another, mostly by
+ * sniffing the first bytes of every eraseblock. Keep those bytes around for
+ * a short while so that each block is read only once per partition.
+ */
+#define MTDSPLIT_HEAD_LEN		64
+#define MTDSPLIT_HEAD_MAX_BLOCKS	4096
+#define MTDSPLIT_HEAD_TIMEOUT		HZ
+
+struct mtdsplit_eb_head {
+	int ret;		/* 1: not read yet */
+	u8 data[MTDSPLIT_HEAD_LEN];
+};
+
+static struct {
+	struct mtd_info *mtd;
+	unsigned long expires;
+	u32 nblocks;
+	struct mtdsplit_eb_head *heads;
+} eb_cache;
+
+static DEFINE_MUTEX(eb_cache_lock);
+
 struct squashfs_super_block {
 	__le32 s_magic;
 	__le32 pad0[9];
@@ -72,21 +98,98 @@ static ssize_t mtd_next_eb(struct mtd_info *mtd, size_t offset)
 	return mtd_rounddown_to_eb(offset, mtd) + mtd->erasesize;
 }
 
+static struct mtdsplit_eb_head *mtd_eb_cache_get(struct mtd_info *mtd)
+{
+	u32 nblocks, i;
+
+	if (eb_cache.mtd == mtd && time_before(jiffies, eb_cache.expires))
+		return eb_cache.heads;
+
+	kvfree(eb_cache.heads);
+	eb_cache.mtd = NULL;
+	eb_cache.heads = NULL;
+
+	nblocks = mtd_div_by_eb(mtd->size, mtd);
+	if (!nblocks || nblocks > MTDSPLIT_HEAD_MAX_BLOCKS)
+		return NULL;
+
+	eb_cache.heads = kvmalloc_array(nblocks, sizeof(*eb_cache.heads),
+					GFP_KERNEL);
+	if (!eb_cache.heads)
+		return NULL;
+
+	for (i = 0; i < nblocks; i++)
+		eb_cache.heads[i].ret = 1;
+
+	eb_cache.mtd = mtd;
+	eb_cache.nblocks = nblocks;
+	eb_cache.expires = jiffies + MTDSPLIT_HEAD_TIMEOUT;
+
+	return eb_cache.heads;
+}
+
+/*
+ * Read len bytes at offset. Reads within the first MTDSPLIT_HEAD_LEN
+ * bytes of an eraseblock are served from the shared cache.
+ */
+int mtd_read_eb_head(struct mtd_info *mtd, size_t offset, size_t len,
+		     void *buf)
+{
+	struct mtdsplit_eb_head *heads, *head;
+	size_t ofs = mtd_mod_by_eb(offset, mtd);
+	size_t retlen;
+	u32 block;
+	int ret;
+
+	if (ofs + len > MTDSPLIT_HEAD_LEN || offset + len > mtd->size)
+		goto direct;
+
+	mutex_lock(&eb_cache_lock);
+
+	heads = mtd_eb_cache_get(mtd);
+	if (!heads) {
+		mutex_unlock(&eb_cache_lock);
+		goto direct;
+	}
+
+	block = mtd_div_by_eb(offset, mtd);
+	head = &heads[block];
+	if (head->ret == 1) {
+		size_t head_len = min_t(uint64_t, MTDSPLIT_HEAD_LEN,
+					mtd->size - (offset - ofs));
+
+		head->ret = mtd_read(mtd, offset - ofs, head_len, &retlen,
+				     head->data);
+		if (!head->ret && retlen != head_len)
+			head->ret = -EIO;
+	}
+
+	ret = head->ret;
+	memcpy(buf, head->data + ofs, len);
+
+	mutex_unlock(&eb_cache_lock);
+
+	return ret;
+
+direct:
+	ret = mtd_read(mtd, offset, len, &retlen, buf);
+	if (ret)
+		return ret;
+
+	return retlen == len ? 0 : -EIO;
+}
+EXPORT_SYMBOL_GPL(mtd_read_eb_head);
+
 int mtd_check_rootfs_magic(struct mtd_info *mtd, size_t offset,
 			   enum mtdsplit_part_type *type)
 {
 	u32 magic;
-	size_t retlen;
 	int ret;
 
-	ret = mtd_read(mtd, offset, sizeof(magic), &retlen,
-		       (unsigned char *) &magic);
+	ret = mtd_read_eb_head(mtd, offset, sizeof(magic), &magic);
 	if (ret)
 		return ret;
 
-	if (retlen != sizeof(magic))
-		return -EIO;
-
 	if (le32_to_cpu(magic) == SQUASHFS_MAGIC) {
 		if (type)
 			*type = MTDSPLIT_PART_TYPE_SQUASHFS;
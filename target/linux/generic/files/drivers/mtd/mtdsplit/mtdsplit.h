@@ -31,6 +31,9 @@ int mtd_get_squashfs_len(struct mtd_info *master,
 			 size_t offset,
 			 size_t *squashfs_len);
 
+int mtd_read_eb_head(struct mtd_info *mtd, size_t offset, size_t len,
+		     void *buf);
+
 int mtd_check_rootfs_magic(struct mtd_info *mtd, size_t offset,
 			   enum mtdsplit_part_type *type);
 
@@ -48,6 +51,12 @@ static inline int mtd_get_squashfs_len(struct mtd_info *master,
 	return -ENODEV;
 }
 
+static inline int mtd_read_eb_head(struct mtd_info *mtd, size_t offset,
+				   size_t len, void *buf)
+{
+	return -ENODEV;
+}
+
 static inline int mtd_check_rootfs_magic(struct mtd_info *mtd, size_t offset,
 					 enum mtdsplit_part_type *type)
 {
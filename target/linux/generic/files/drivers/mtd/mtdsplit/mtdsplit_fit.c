@@ -189,6 +189,66 @@ static int fit_image_get_data_and_size(const void *fit, int noffset,
 	return ret;
 }
 
+static int mtdsplit_fit_read(struct mtd_info *mtd, size_t from, size_t len,
+			     void *buf)
+{
+	size_t retlen;
+	int ret;
+
+	ret = mtd_read(mtd, from, len, &retlen, buf);
+	if (ret && !mtd_is_bitflip(ret))
+		return ret;
+
+	return retlen == len ? 0 : -EIO;
+}
+
+/*
+ * Only the structure and strings blocks are needed to look up the image
+ * nodes and their data properties, skip everything else in the FDT (the
+ * memory reservation map and any padding between the blocks). The blocks
+ * are read to their offsets in a buffer of the full FDT size, so libfdt
+ * can be used on it as is.
+ */
+static void *mtdsplit_fit_read_fdt(struct mtd_info *mtd, size_t offset,
+				   const struct fdt_header *hdr)
+{
+	size_t fit_size = be32_to_cpu(hdr->totalsize);
+	size_t struct_off = be32_to_cpu(hdr->off_dt_struct);
+	size_t struct_size = be32_to_cpu(hdr->size_dt_struct);
+	size_t strings_off = be32_to_cpu(hdr->off_dt_strings);
+	size_t strings_size = be32_to_cpu(hdr->size_dt_strings);
+	void *fit;
+	int ret;
+
+	fit = kzalloc(fit_size, GFP_KERNEL);
+	if (!fit)
+		return ERR_PTR(-ENOMEM);
+
+	/* size_dt_struct is only there since version 17 */
+	if (fdt_version(hdr) < 17 ||
+	    struct_off > fit_size || struct_size > fit_size - struct_off ||
+	    strings_off > fit_size || strings_size > fit_size - strings_off) {
+		ret = mtdsplit_fit_read(mtd, offset, fit_size, fit);
+		goto out;
+	}
+
+	memcpy(fit, hdr, sizeof(*hdr));
+
+	ret = mtdsplit_fit_read(mtd, offset + struct_off, struct_size,
+				fit + struct_off);
+	if (!ret)
+		ret = mtdsplit_fit_read(mtd, offset + strings_off, strings_size,
+					fit + strings_off);
+
+out:
+	if (ret) {
+		kfree(fit);
+		return ERR_PTR(ret);
+	}
+
+	return fit;
+}
+
 static int
 mtdsplit_fit_parse(struct mtd_info *mtd,
 		   const struct mtd_partition **pparts,
@@ -197,7 +257,7 @@ mtdsplit_fit_parse(struct mtd_info *mtd,
 	struct device_node *np = mtd_get_of_node(mtd);
 	const char *cmdline_match = NULL;
 	struct fdt_header hdr;
-	size_t hdr_len, retlen;
+	size_t hdr_len;
 	size_t offset;
 	u32 offset_start = 0;
 	size_t fit_offset, fit_size;
@@ -218,18 +278,13 @@ mtdsplit_fit_parse(struct mtd_info *mtd,
 
 	/* Parse the MTD device & search for the FIT image location */
 	for(offset = 0; offset + hdr_len <= mtd->size; offset += mtd->erasesize) {
-		ret = mtd_read(mtd, offset + offset_start, hdr_len, &retlen, (void*) &hdr);
+		ret = mtd_read_eb_head(mtd, offset + offset_start, hdr_len, &hdr);
 		if (ret) {
 			pr_err("read error in \"%s\" at offset 0x%llx\n",
 			       mtd->name, (unsigned long long) offset);
 			return ret;
 		}
 
-		if (retlen != hdr_len) {
-			pr_err("short read in \"%s\"\n", mtd->name);
-			return -EIO;
-		}
-
 		/* Check the magic - see if this is a FIT image */
 		if (be32_to_cpu(hdr.magic) != OF_DT_HEADER) {
 			pr_debug("no valid FIT image found in \"%s\" at offset %llx\n",
@@ -292,18 +347,18 @@ mtdsplit_fit_parse(struct mtd_info *mtd,
 		return 2;
 	} else {
 		/* Search for rootfs_data after FIT external data */
-		fit = kzalloc(fit_size, GFP_KERNEL);
-		ret = mtd_read(mtd, offset, fit_size + offset_start, &retlen, fit);
-		if (ret) {
+		fit = mtdsplit_fit_read_fdt(mtd, offset + offset_start, &hdr);
+		if (IS_ERR(fit)) {
 			pr_err("read error in \"%s\" at offset 0x%llx\n",
 			       mtd->name, (unsigned long long) offset);
-			return ret;
+			return PTR_ERR(fit);
 		}
 
 		images_noffset = fdt_path_offset(fit, FIT_IMAGES_PATH);
 		if (images_noffset < 0) {
 			pr_err("Can't find images parent node '%s' (%s)\n",
 			FIT_IMAGES_PATH, fdt_strerror(images_noffset));
+			kfree(fit);
 			return -ENODEV;
 		}
 
@@ -313,8 +368,10 @@ mtdsplit_fit_parse(struct mtd_info *mtd,
 		     noffset = fdt_next_node(fit, noffset, &ndepth)) {
 			if (ndepth == 1) {
 				ret = fit_image_get_data_and_size(fit, noffset, &img_data, &data_size);
-				if (ret)
+				if (ret) {
+					kfree(fit);
 					return 0;
+				}
 
 				img_total = data_size + (img_data - fit);
 
@@ -322,6 +379,8 @@ mtdsplit_fit_parse(struct mtd_info *mtd,
 			}
 		}
 
+		kfree(fit);
+
 		parts = kzalloc(sizeof(*parts), GFP_KERNEL);
 		if (!parts)
 			return -ENOMEM;
@@ -332,8 +391,6 @@ mtdsplit_fit_parse(struct mtd_info *mtd,
 
 		*pparts = parts;
 
-		kfree(fit);
-
 		return 1;
 	}
 }
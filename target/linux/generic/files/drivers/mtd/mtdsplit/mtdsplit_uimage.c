@@ -46,20 +46,14 @@ static int
 read_uimage_header(struct mtd_info *mtd, size_t offset, u_char *buf,
 		   size_t header_len)
 {
-	size_t retlen;
 	int ret;
 
-	ret = mtd_read(mtd, offset, header_len, &retlen, buf);
+	ret = mtd_read_eb_head(mtd, offset, header_len, buf);
 	if (ret) {
 		pr_debug("read error in \"%s\"\n", mtd->name);
 		return ret;
 	}
 
-	if (retlen != header_len) {
-		pr_debug("short read in \"%s\"\n", mtd->name);
-		return -EIO;
-	}
-
 	return 0;
 }
 
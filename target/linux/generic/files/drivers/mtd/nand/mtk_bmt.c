@@ -110,6 +110,7 @@ mtk_bmt_read(struct mtd_info *mtd, loff_t from,
 	struct mtd_oob_ops cur_ops = *ops;
 	int retry_count = 0;
 	loff_t cur_from;
+	loff_t split_until = 0;
 	int ret = 0;
 	int max_bitflips = 0;
 
@@ -122,6 +123,7 @@ mtk_bmt_read(struct mtd_info *mtd, loff_t from,
 		u32 offset = from & (bmtd.blk_size - 1);
 		u32 block = from >> bmtd.blk_shift;
 		int cur_block;
+		int n_blocks = 1;
 
 		cur_block = bmtd.ops->get_mapping_block(block);
 		if (cur_block < 0)
@@ -133,7 +135,30 @@ mtk_bmt_read(struct mtd_info *mtd, loff_t from,
 		cur_ops.retlen = 0;
 		cur_ops.len = min_t(u32, mtd->erasesize - offset,
 					 ops->len - ops->retlen);
+
+		/*
+		 * Data-only reads over blocks that are mapped contiguously are
+		 * issued as one request, so the controller can keep streaming
+		 */
+		while (!ops->oobbuf && from >= split_until &&
+		       cur_ops.len < ops->len - ops->retlen &&
+		       ((loff_t)(block + n_blocks) << bmtd.blk_shift) < mtd->size &&
+		       bmtd.ops->get_mapping_block(block + n_blocks) == cur_block + n_blocks) {
+			cur_ops.len += min_t(u32, mtd->erasesize,
+					     ops->len - ops->retlen - cur_ops.len);
+			n_blocks++;
+		}
+
 		cur_ret = bmtd._read_oob(mtd, cur_from, &cur_ops);
+
+		/* redo a merged read block by block to find the one to remap */
+		if (n_blocks > 1 &&
+		    ((cur_ret < 0 && !mtd_is_bitflip(cur_ret)) ||
+		     (mtd->bitflip_threshold && cur_ret >= mtd->bitflip_threshold))) {
+			split_until = from + cur_ops.len;
+			continue;
+		}
+
 		if (cur_ret < 0)
 			ret = cur_ret;
 		else
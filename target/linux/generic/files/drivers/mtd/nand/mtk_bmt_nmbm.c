@@ -1,4 +1,5 @@
 #include <linux/crc32.h>
+#include <linux/ktime.h>
 #include <linux/slab.h>
 #include "mtk_bmt.h"
 
@@ -1770,18 +1771,36 @@ static bool nmbm_try_load_info_table(struct nmbm_instance *ni, uint32_t ba,
 		if (chunksize > bmtd.blk_size)
 			chunksize = bmtd.blk_size;
 
-		/* Assume block with ECC error has no info table data */
-		ret = nmbn_read_data(ni, ba2addr(ni, ba), off, chunksize);
+		/*
+		 * Most blocks probed by the search hold no table, so check the
+		 * header page before reading the rest of the chunk
+		 */
+		if (checkhdr) {
+			/* Assume block with ECC error has no info table data */
+			ret = nmbn_read_data(ni, ba2addr(ni, ba), off,
+					     bmtd.pg_size);
+			if (ret < 0)
+				goto skip_bad_block;
+			else if (ret > 0)
+				return false;
+
+			success = nmbm_check_info_table_header(ni, off);
+			if (!success)
+				return false;
+
+			ret = nmbn_read_data(ni, ba2addr(ni, ba) + bmtd.pg_size,
+					     off + bmtd.pg_size,
+					     chunksize - bmtd.pg_size);
+		} else {
+			ret = nmbn_read_data(ni, ba2addr(ni, ba), off, chunksize);
+		}
+
 		if (ret < 0)
 			goto skip_bad_block;
 		else if (ret > 0)
 			return false;
 
 		if (checkhdr) {
-			success = nmbm_check_info_table_header(ni, off);
-			if (!success)
-				return false;
-
 			start_ba = ba;
 			checkhdr = false;
 		}
@@ -2246,6 +2265,7 @@ static int get_mapping_block_index_nmbm(int block)
 static int mtk_bmt_init_nmbm(struct device_node *np)
 {
 	struct nmbm_instance *ni;
+	ktime_t start;
 	int ret;
 
 	ni = kzalloc(nmbm_calc_structure_size(), GFP_KERNEL);
@@ -2264,10 +2284,14 @@ static int mtk_bmt_init_nmbm(struct device_node *np)
 	if (of_property_read_bool(np, "mediatek,bmt-force-create"))
 		ni->force_create = true;
 
+	start = ktime_get();
 	ret = nmbm_attach(ni);
 	if (ret)
 		goto out;
 
+	nlog_info(ni, "NMBM attached in %lld ms\n",
+		  ktime_ms_delta(ktime_get(), start));
+
 	bmtd.mtd->size = ni->data_block_count << bmtd.blk_shift;
 
 	return 0;
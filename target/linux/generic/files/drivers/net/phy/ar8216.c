@@ -35,6 +35,8 @@
 #include <linux/lockdep.h>
 #include <linux/ar8216_platform.h>
 #include <linux/workqueue.h>
+#include <linux/jhash.h>
+#include <linux/mm.h>
 
 #include "ar8216.h"
 
@@ -248,21 +250,53 @@ ar8xxx_mii_write32(struct ar8xxx_priv *priv, int phy_id, int regnum, u32 val)
 	}
 }
 
-u32
-ar8xxx_read(struct ar8xxx_priv *priv, int reg)
+/* Must be called with the mdio_lock held. The page only changes through
+ * this function, so the register write and the settle time are skipped
+ * while consecutive accesses stay on the same page. The reset bit lives
+ * on page 0, so a switch reset does not leave the cached page stale.
+ */
+void
+ar8xxx_set_page(struct ar8xxx_priv *priv, u16 page)
 {
 	struct mii_bus *bus = priv->mii_bus;
+
+	if (priv->current_page == page)
+		return;
+
+	bus->write(bus, 0x18, 0, page);
+	wait_for_page_switch();
+	priv->current_page = page;
+}
+
+static u32
+__ar8xxx_read(struct ar8xxx_priv *priv, int reg)
+{
 	u16 r1, r2, page;
-	u32 val;
 
 	split_addr((u32) reg, &r1, &r2, &page);
+	ar8xxx_set_page(priv, page);
 
-	mutex_lock(&bus->mdio_lock);
+	return ar8xxx_mii_read32(priv, 0x10 | r2, r1);
+}
 
-	bus->write(bus, 0x18, 0, page);
-	wait_for_page_switch();
-	val = ar8xxx_mii_read32(priv, 0x10 | r2, r1);
+/* read count consecutive registers, must be called with the mdio_lock held */
+void
+__ar8xxx_read_bulk(struct ar8xxx_priv *priv, int reg, u32 *val, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		val[i] = __ar8xxx_read(priv, reg + i * 4);
+}
 
+u32
+ar8xxx_read(struct ar8xxx_priv *priv, int reg)
+{
+	struct mii_bus *bus = priv->mii_bus;
+	u32 val;
+
+	mutex_lock(&bus->mdio_lock);
+	val = __ar8xxx_read(priv, reg);
 	mutex_unlock(&bus->mdio_lock);
 
 	return val;
@@ -278,8 +312,7 @@ ar8xxx_write(struct ar8xxx_priv *priv, int reg, u32 val)
 
 	mutex_lock(&bus->mdio_lock);
 
-	bus->write(bus, 0x18, 0, page);
-	wait_for_page_switch();
+	ar8xxx_set_page(priv, page);
 	ar8xxx_mii_write32(priv, 0x10 | r2, r1, val);
 
 	mutex_unlock(&bus->mdio_lock);
@@ -296,8 +329,7 @@ ar8xxx_rmw(struct ar8xxx_priv *priv, int reg, u32 mask, u32 val)
 
 	mutex_lock(&bus->mdio_lock);
 
-	bus->write(bus, 0x18, 0, page);
-	wait_for_page_switch();
+	ar8xxx_set_page(priv, page);
 
 	ret = ar8xxx_mii_read32(priv, 0x10 | r2, r1);
 	ret &= ~mask;
@@ -422,6 +454,7 @@ ar8xxx_mib_flush(struct ar8xxx_priv *priv)
 static void
 ar8xxx_mib_fetch_port_stat(struct ar8xxx_priv *priv, int port, bool flush)
 {
+	struct mii_bus *bus = priv->mii_bus;
 	unsigned int base;
 	u64 *mib_stats;
 	int i;
@@ -434,27 +467,53 @@ ar8xxx_mib_fetch_port_stat(struct ar8xxx_priv *priv, int port, bool flush)
 	       priv->chip->reg_port_stats_length * port;
 
 	mib_stats = &priv->mib_stats[port * priv->chip->num_mibs];
+
+	/* all counters of a port share a page, fetch them in one go */
+	mutex_lock(&bus->mdio_lock);
 	for (i = 0; i < priv->chip->num_mibs; i++) {
 		const struct ar8xxx_mib_desc *mib;
-		u64 t;
+		u32 val[2] = { 0 };
 
 		mib = &priv->chip->mib_decs[i];
 		if (mib->type > priv->mib_type)
 			continue;
-		t = ar8xxx_read(priv, base + mib->offset);
-		if (mib->size == 2) {
-			u64 hi;
-
-			hi = ar8xxx_read(priv, base + mib->offset + 4);
-			t |= hi << 32;
-		}
+		__ar8xxx_read_bulk(priv, base + mib->offset, val, mib->size);
 
 		if (flush)
 			mib_stats[i] = 0;
 		else
-			mib_stats[i] += t;
-		cond_resched();
+			mib_stats[i] += ((u64) val[1] << 32) | val[0];
 	}
+	mutex_unlock(&bus->mdio_lock);
+
+	cond_resched();
+}
+
+/* capture and accumulate the counters of all ports at once */
+static int
+ar8xxx_mib_refresh(struct ar8xxx_priv *priv)
+{
+	int err, i;
+
+	lockdep_assert_held(&priv->mib_lock);
+
+	err = ar8xxx_mib_capture(priv);
+	if (err)
+		return err;
+
+	for (i = 0; i < priv->dev.ports; i++)
+		ar8xxx_mib_fetch_port_stat(priv, i, false);
+
+	priv->mib_updated = jiffies;
+
+	return 0;
+}
+
+static bool
+ar8xxx_mib_stale(struct ar8xxx_priv *priv)
+{
+	return time_after_eq(jiffies, priv->mib_updated +
+			     msecs_to_jiffies(priv->mib_poll_interval));
 }
 
 static void
@@ -791,10 +850,10 @@ ar8216_wait_atu_ready(struct ar8xxx_priv *priv, u16 r2, u16 r1)
 static void ar8216_get_arl_entry(struct ar8xxx_priv *priv,
 				 struct arl_entry *a, u32 *status, enum arl_op op)
 {
-	struct mii_bus *bus = priv->mii_bus;
 	u16 r2, page;
 	u16 r1_func0, r1_func1, r1_func2;
 	u32 t, val0, val1, val2;
+	u32 val[3];
 
 	split_addr(AR8216_REG_ATU_FUNC0, &r1_func0, &r2, &page);
 	r2 |= 0x10;
@@ -807,8 +866,7 @@ static void ar8216_get_arl_entry(struct ar8xxx_priv *priv,
 		/* all ATU registers are on the same page
 		* therefore set page only once
 		*/
-		bus->write(bus, 0x18, 0, page);
-		wait_for_page_switch();
+		ar8xxx_set_page(priv, page);
 
 		ar8216_wait_atu_ready(priv, r2, r1_func0);
 
@@ -817,14 +875,18 @@ static void ar8216_get_arl_entry(struct ar8xxx_priv *priv,
 		ar8xxx_mii_write32(priv, r2, r1_func2, 0);
 		break;
 	case AR8XXX_ARL_GET_NEXT:
+		/* the bus may have been released since the last entry */
+		ar8xxx_set_page(priv, page);
+
 		t = ar8xxx_mii_read32(priv, r2, r1_func0);
 		t |= AR8216_ATU_ACTIVE;
 		ar8xxx_mii_write32(priv, r2, r1_func0, t);
 		ar8216_wait_atu_ready(priv, r2, r1_func0);
 
-		val0 = ar8xxx_mii_read32(priv, r2, r1_func0);
-		val1 = ar8xxx_mii_read32(priv, r2, r1_func1);
-		val2 = ar8xxx_mii_read32(priv, r2, r1_func2);
+		__ar8xxx_read_bulk(priv, AR8216_REG_ATU_FUNC0, val, 3);
+		val0 = val[0];
+		val1 = val[1];
+		val2 = val[2];
 
 		*status = (val2 & AR8216_ATU_STATUS) >> AR8216_ATU_STATUS_S;
 		if (!*status)
@@ -1703,12 +1765,14 @@ ar8xxx_sw_get_port_mib(struct switch_dev *dev,
 	if (port >= dev->ports)
 		return -EINVAL;
 
+	/* serve the snapshot of the poll worker unless it is out of date,
+	 * so several readers do not each capture and read all counters */
 	mutex_lock(&priv->mib_lock);
-	ret = ar8xxx_mib_capture(priv);
-	if (ret)
-		goto unlock;
-
-	ar8xxx_mib_fetch_port_stat(priv, port, false);
+	if (ar8xxx_mib_stale(priv)) {
+		ret = ar8xxx_mib_refresh(priv);
+		if (ret)
+			goto unlock;
+	}
 
 	len += snprintf(buf + len, sizeof(priv->buf) - len,
 			"MIB counters\n");
@@ -1774,30 +1838,34 @@ ar8xxx_sw_get_arl_age_time(struct switch_dev *dev, const struct switch_attr *att
 	return 0;
 }
 
-int
-ar8xxx_sw_get_arl_table(struct switch_dev *dev,
-			const struct switch_attr *attr,
-			struct switch_val *val)
+/* Walk the ARL table into @table, must be called with the reg_mutex held.
+ * The bus lock is dropped every AR8XXX_ARL_BATCH entries so that large
+ * tables do not stall other users of the MDIO bus.
+ */
+static int
+ar8xxx_get_arl_entries(struct ar8xxx_priv *priv, struct arl_entry *table,
+		       int max)
 {
-	struct ar8xxx_priv *priv = swdev_to_ar8xxx(dev);
 	struct mii_bus *bus = priv->mii_bus;
 	const struct ar8xxx_chip *chip = priv->chip;
-	char *buf = priv->arl_buf;
-	int i, j, k, len = 0;
-	struct arl_entry *a, *a1;
+	u16 head[BIT(AR8XXX_ARL_HASH_BITS)];
+	struct arl_entry *a;
 	u32 status;
+	int i = 0;
+	u16 j;
 
-	if (!chip->get_arl_entry)
-		return -EOPNOTSUPP;
+	lockdep_assert_held(&priv->reg_mutex);
+
+	memset(head, 0xff, sizeof(head));
 
-	mutex_lock(&priv->reg_mutex);
 	mutex_lock(&bus->mdio_lock);
 
 	chip->get_arl_entry(priv, NULL, NULL, AR8XXX_ARL_INITIALIZE);
 
-	for(i = 0; i < AR8XXX_NUM_ARL_RECORDS; ++i) {
-		a = &priv->arl_table[i];
-		duplicate:
+	while (i < max) {
+		u32 hash;
+
+		a = &table[i];
 		chip->get_arl_entry(priv, a, &status, AR8XXX_ARL_GET_NEXT);
 
 		if (!status)
@@ -1807,19 +1875,51 @@ ar8xxx_sw_get_arl_table(struct switch_dev *dev,
 		 * ARL table can include multiple valid entries
 		 * per MAC, just with differing status codes
 		 */
-		for (j = 0; j < i; ++j) {
-			a1 = &priv->arl_table[j];
-			if (!memcmp(a->mac, a1->mac, sizeof(a->mac))) {
-				/* ignore ports already seen in former entry */
-				a->portmap &= ~a1->portmap;
-				if (!a->portmap)
-					goto duplicate;
-			}
+		hash = jhash(a->mac, sizeof(a->mac), 0) & (ARRAY_SIZE(head) - 1);
+		for (j = head[hash]; j != 0xffff && a->portmap;
+		     j = table[j].hash_next) {
+			/* ignore ports already seen in former entry */
+			if (!memcmp(a->mac, table[j].mac, sizeof(a->mac)))
+				a->portmap &= ~table[j].portmap;
+		}
+
+		if (!a->portmap)
+			continue;
+
+		a->hash_next = head[hash];
+		head[hash] = i++;
+
+		if (!(i % AR8XXX_ARL_BATCH)) {
+			mutex_unlock(&bus->mdio_lock);
+			cond_resched();
+			mutex_lock(&bus->mdio_lock);
 		}
 	}
 
 	mutex_unlock(&bus->mdio_lock);
 
+	return i;
+}
+
+int
+ar8xxx_sw_get_arl_table(struct switch_dev *dev,
+			const struct switch_attr *attr,
+			struct switch_val *val)
+{
+	struct ar8xxx_priv *priv = swdev_to_ar8xxx(dev);
+	const struct ar8xxx_chip *chip = priv->chip;
+	char *buf = priv->arl_buf;
+	int i, j, k, len = 0;
+	struct arl_entry *a;
+
+	if (!chip->get_arl_entry)
+		return -EOPNOTSUPP;
+
+	mutex_lock(&priv->reg_mutex);
+
+	i = ar8xxx_get_arl_entries(priv, priv->arl_table,
+				   AR8XXX_NUM_ARL_RECORDS);
+
 	len += snprintf(buf + len, sizeof(priv->arl_buf) - len,
                         "address resolution table\n");
 
@@ -1849,6 +1949,47 @@ ar8xxx_sw_get_arl_table(struct switch_dev *dev,
 	return 0;
 }
 
+int
+ar8xxx_sw_get_arl_entries(struct switch_dev *dev,
+			  const struct switch_attr *attr,
+			  struct switch_val *val)
+{
+	struct ar8xxx_priv *priv = swdev_to_ar8xxx(dev);
+	struct ar8xxx_arl_dump *dump;
+	int i, j, n;
+
+	if (!priv->chip->get_arl_entry)
+		return -EOPNOTSUPP;
+
+	mutex_lock(&priv->reg_mutex);
+
+	if (!priv->arl_dump) {
+		priv->arl_dump = kvzalloc(sizeof(*priv->arl_dump), GFP_KERNEL);
+		if (!priv->arl_dump) {
+			mutex_unlock(&priv->reg_mutex);
+			return -ENOMEM;
+		}
+	}
+
+	dump = priv->arl_dump;
+	n = ar8xxx_get_arl_entries(priv, dump->table, AR8XXX_ARL_TABLE_SIZE);
+
+	for (i = 0; i < n; i++) {
+		/* the chip accessors store the address in reverse order */
+		for (j = 0; j < ETH_ALEN; j++)
+			dump->entries[i].mac[j] = dump->table[i].mac[ETH_ALEN - 1 - j];
+		dump->entries[i].portmap = dump->table[i].portmap;
+	}
+
+	/* stays valid until swconfig has sent it, the switch is locked */
+	val->value.arl = dump->entries;
+	val->len = n;
+
+	mutex_unlock(&priv->reg_mutex);
+
+	return 0;
+}
+
 int
 ar8xxx_sw_set_flush_arl_table(struct switch_dev *dev,
 			      const struct switch_attr *attr,
@@ -1993,6 +2134,13 @@ static const struct switch_attr ar8xxx_sw_attr_globals[] = {
 		.set = NULL,
 		.get = ar8xxx_sw_get_arl_table,
 	},
+	{
+		.type = SWITCH_TYPE_ARL,
+		.name = "arl_entries",
+		.description = "Get ARL table entries",
+		.set = NULL,
+		.get = ar8xxx_sw_get_arl_entries,
+	},
 	{
 		.type = SWITCH_TYPE_NOVAL,
 		.name = "flush_arl_table",
@@ -2289,20 +2437,11 @@ static void
 ar8xxx_mib_work_func(struct work_struct *work)
 {
 	struct ar8xxx_priv *priv;
-	int err, i;
 
 	priv = container_of(work, struct ar8xxx_priv, mib_work.work);
 
 	mutex_lock(&priv->mib_lock);
-
-	err = ar8xxx_mib_capture(priv);
-	if (err)
-		goto next_attempt;
-
-	for (i = 0; i < priv->dev.ports; i++)
-		ar8xxx_mib_fetch_port_stat(priv, i, false);
-
-next_attempt:
+	ar8xxx_mib_refresh(priv);
 	mutex_unlock(&priv->mib_lock);
 	schedule_delayed_work(&priv->mib_work,
 			      msecs_to_jiffies(priv->mib_poll_interval));
@@ -2334,6 +2473,10 @@ ar8xxx_mib_start(struct ar8xxx_priv *priv)
 	if (!ar8xxx_has_mib_counters(priv) || !priv->mib_poll_interval)
 		return;
 
+	/* nothing captured yet, let the first reader refresh */
+	priv->mib_updated = jiffies -
+			    msecs_to_jiffies(priv->mib_poll_interval);
+
 	schedule_delayed_work(&priv->mib_work,
 			      msecs_to_jiffies(priv->mib_poll_interval));
 }
@@ -2358,6 +2501,7 @@ ar8xxx_create(void)
 
 	mutex_init(&priv->reg_mutex);
 	mutex_init(&priv->mib_lock);
+	priv->current_page = 0xffff;
 	INIT_DELAYED_WORK(&priv->mib_work, ar8xxx_mib_work_func);
 
 	return priv;
@@ -2371,6 +2515,7 @@ ar8xxx_free(struct ar8xxx_priv *priv)
 
 	kfree(priv->chip_data);
 	kfree(priv->mib_stats);
+	kvfree(priv->arl_dump);
 	kfree(priv);
 }
 
@@ -2502,7 +2647,8 @@ ar8xxx_phy_read_status(struct phy_device *phydev)
 	struct switch_port_link link;
 
 	/* check for switch port link changes */
-	ar8xxx_check_link_states(priv);
+	if (ar8xxx_check_link_states(priv))
+		switch_port_link_changed(&priv->dev);
 
 	if (phydev->mdio.addr != 0)
 		return genphy_read_status(phydev);
@@ -2640,6 +2786,8 @@ ar8xxx_phy_probe(struct phy_device *phydev)
 
 	swdev = &priv->dev;
 	swdev->alias = dev_name(&priv->mii_bus->dev);
+	/* port links are checked in ar8xxx_phy_read_status() */
+	swdev->link_events = true;
 	ret = register_switch(swdev, NULL);
 	if (ret)
 		goto free_priv;
@@ -407,6 +407,9 @@ enum {
 };
 
 #define AR8XXX_NUM_ARL_RECORDS	100
+#define AR8XXX_ARL_TABLE_SIZE	2048
+#define AR8XXX_ARL_HASH_BITS	7
+#define AR8XXX_ARL_BATCH	32
 
 enum arl_op {
 	AR8XXX_ARL_INITIALIZE,
@@ -416,6 +419,12 @@ enum arl_op {
 struct arl_entry {
 	u16 portmap;
 	u8 mac[6];
+	u16 hash_next;
+};
+
+struct ar8xxx_arl_dump {
+	struct arl_entry table[AR8XXX_ARL_TABLE_SIZE];
+	struct switch_arl_entry entries[AR8XXX_ARL_TABLE_SIZE];
 };
 
 struct ar8xxx_priv;
@@ -483,6 +492,7 @@ struct ar8xxx_priv {
 	const struct net_device_ops *ndo_old;
 	struct net_device_ops ndo;
 	struct mutex reg_mutex;
+	u16 current_page;
 	u8 chip_ver;
 	u8 chip_rev;
 	const struct ar8xxx_chip *chip;
@@ -492,6 +502,7 @@ struct ar8xxx_priv {
 	char buf[2048];
 	struct arl_entry arl_table[AR8XXX_NUM_ARL_RECORDS];
 	char arl_buf[AR8XXX_NUM_ARL_RECORDS * 32 + 256];
+	struct ar8xxx_arl_dump *arl_dump;
 	bool link_up[AR8X16_MAX_PORTS];
 
 	bool init;
@@ -499,6 +510,7 @@ struct ar8xxx_priv {
 	struct mutex mib_lock;
 	struct delayed_work mib_work;
 	u64 *mib_stats;
+	unsigned long mib_updated;
 	u32 mib_poll_interval;
 	u8 mib_type;
 
@@ -528,6 +540,10 @@ u32
 ar8xxx_mii_read32(struct ar8xxx_priv *priv, int phy_id, int regnum);
 void
 ar8xxx_mii_write32(struct ar8xxx_priv *priv, int phy_id, int regnum, u32 val);
+void
+ar8xxx_set_page(struct ar8xxx_priv *priv, u16 page);
+void
+__ar8xxx_read_bulk(struct ar8xxx_priv *priv, int reg, u32 *val, int count);
 u32
 ar8xxx_read(struct ar8xxx_priv *priv, int reg);
 void
@@ -637,6 +653,10 @@ ar8xxx_sw_get_arl_table(struct switch_dev *dev,
 			const struct switch_attr *attr,
 			struct switch_val *val);
 int
+ar8xxx_sw_get_arl_entries(struct switch_dev *dev,
+			  const struct switch_attr *attr,
+			  struct switch_val *val);
+int
 ar8xxx_sw_set_flush_arl_table(struct switch_dev *dev,
 			      const struct switch_attr *attr,
 			      struct switch_val *val);
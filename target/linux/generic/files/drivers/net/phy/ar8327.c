@@ -389,6 +389,105 @@ static DEVICE_ATTR(enable_hw_mode,  S_IRUGO | S_IWUSR,
 		   ar8327_led_enable_hw_mode_show,
 		   ar8327_led_enable_hw_mode_store);
 
+#ifdef CONFIG_LEDS_TRIGGERS
+static const struct {
+	enum led_trigger_netdev_modes mode;
+	u32 rule;
+} ar8327_led_hw_modes[] = {
+	{ TRIGGER_NETDEV_LINK_10, AR8327_LED_RULE_LINK_10M },
+	{ TRIGGER_NETDEV_LINK_100, AR8327_LED_RULE_LINK_100M },
+	{ TRIGGER_NETDEV_LINK_1000, AR8327_LED_RULE_LINK_1000M },
+	{ TRIGGER_NETDEV_HALF_DUPLEX, AR8327_LED_RULE_HALF_DUPLEX },
+	{ TRIGGER_NETDEV_FULL_DUPLEX, AR8327_LED_RULE_FULL_DUPLEX },
+	{ TRIGGER_NETDEV_TX, AR8327_LED_RULE_TX_BLINK },
+	{ TRIGGER_NETDEV_RX, AR8327_LED_RULE_RX_BLINK },
+};
+
+static int
+ar8327_led_hw_rule(unsigned long flags, u32 *rule)
+{
+	int i;
+
+	*rule = 0;
+
+	if (test_and_clear_bit(TRIGGER_NETDEV_LINK, &flags))
+		*rule |= AR8327_LED_RULE_LINK_10M | AR8327_LED_RULE_LINK_100M |
+			 AR8327_LED_RULE_LINK_1000M;
+
+	for (i = 0; i < ARRAY_SIZE(ar8327_led_hw_modes); i++)
+		if (test_and_clear_bit(ar8327_led_hw_modes[i].mode, &flags))
+			*rule |= ar8327_led_hw_modes[i].rule;
+
+	if (flags)
+		return -EOPNOTSUPP;
+
+	*rule |= AR8327_LED_RULE_BLINK_4HZ;
+
+	return 0;
+}
+
+static int
+ar8327_led_hw_control_is_supported(struct led_classdev *led_cdev,
+				   unsigned long flags)
+{
+	u32 rule;
+
+	return ar8327_led_hw_rule(flags, &rule);
+}
+
+/*
+ * The rule of a LED is shared by the same LED of the PHYs 0-3, only PHY4
+ * has its own, so this changes the sibling LEDs in rule mode as well.
+ */
+static int
+ar8327_led_hw_control_set(struct led_classdev *led_cdev, unsigned long flags)
+{
+	struct ar8327_led *aled = led_cdev_to_ar8327_led(led_cdev);
+	unsigned int phy = aled->led_num / 3;
+	u32 rule;
+	int ret;
+
+	ret = ar8327_led_hw_rule(flags, &rule);
+	if (ret)
+		return ret;
+
+	ar8xxx_rmw(aled->sw_priv, AR8327_REG_LED_CTRL(aled->led_num % 3),
+		   AR8327_LED_RULE << AR8327_LED_RULE_S(phy),
+		   rule << AR8327_LED_RULE_S(phy));
+
+	spin_lock(&aled->lock);
+
+	aled->enable_hw_mode = true;
+	ar8327_led_schedule_change(aled, AR8327_LED_PATTERN_RULE);
+
+	spin_unlock(&aled->lock);
+
+	return 0;
+}
+
+static int
+ar8327_led_hw_control_get(struct led_classdev *led_cdev, unsigned long *flags)
+{
+	struct ar8327_led *aled = led_cdev_to_ar8327_led(led_cdev);
+	unsigned int phy = aled->led_num / 3;
+	u32 rule;
+	int i;
+
+	if (!aled->enable_hw_mode)
+		return -EINVAL;
+
+	rule = ar8xxx_read(aled->sw_priv, AR8327_REG_LED_CTRL(aled->led_num % 3));
+	rule = (rule >> AR8327_LED_RULE_S(phy)) & AR8327_LED_RULE;
+
+	*flags = 0;
+	for (i = 0; i < ARRAY_SIZE(ar8327_led_hw_modes); i++)
+		if (rule & ar8327_led_hw_modes[i].rule)
+			__set_bit(ar8327_led_hw_modes[i].mode, flags);
+
+	return 0;
+}
+#endif
+
 static int
 ar8327_led_register(struct ar8327_led *aled)
 {
@@ -459,6 +558,14 @@ ar8327_led_create(struct ar8xxx_priv *priv,
 	aled->cdev.brightness_set = ar8327_led_set_brightness;
 	aled->cdev.blink_set = ar8327_led_blink_set;
 	aled->cdev.default_trigger = led_info->default_trigger;
+#ifdef CONFIG_LEDS_TRIGGERS
+	if (aled->mode == AR8327_LED_MODE_HW) {
+		aled->cdev.hw_control_trigger = "netdev";
+		aled->cdev.hw_control_is_supported = ar8327_led_hw_control_is_supported;
+		aled->cdev.hw_control_set = ar8327_led_hw_control_set;
+		aled->cdev.hw_control_get = ar8327_led_hw_control_get;
+	}
+#endif
 
 	spin_lock_init(&aled->lock);
 	mutex_init(&aled->mutex);
@@ -1097,10 +1204,10 @@ ar8327_wait_atu_ready(struct ar8xxx_priv *priv, u16 r2, u16 r1)
 static void ar8327_get_arl_entry(struct ar8xxx_priv *priv,
 				 struct arl_entry *a, u32 *status, enum arl_op op)
 {
-	struct mii_bus *bus = priv->mii_bus;
 	u16 r2, page;
 	u16 r1_data0, r1_data1, r1_data2, r1_func;
 	u32 val0, val1, val2;
+	u32 val[3];
 
 	split_addr(AR8327_REG_ATU_DATA0, &r1_data0, &r2, &page);
 	r2 |= 0x10;
@@ -1114,8 +1221,7 @@ static void ar8327_get_arl_entry(struct ar8xxx_priv *priv,
 		/* all ATU registers are on the same page
 		* therefore set page only once
 		*/
-		bus->write(bus, 0x18, 0, page);
-		wait_for_page_switch();
+		ar8xxx_set_page(priv, page);
 
 		ar8327_wait_atu_ready(priv, r2, r1_func);
 
@@ -1124,14 +1230,18 @@ static void ar8327_get_arl_entry(struct ar8xxx_priv *priv,
 		ar8xxx_mii_write32(priv, r2, r1_data2, 0);
 		break;
 	case AR8XXX_ARL_GET_NEXT:
+		/* the bus may have been released since the last entry */
+		ar8xxx_set_page(priv, page);
+
 		ar8xxx_mii_write32(priv, r2, r1_func,
 				   AR8327_ATU_FUNC_OP_GET_NEXT |
 				   AR8327_ATU_FUNC_BUSY);
 		ar8327_wait_atu_ready(priv, r2, r1_func);
 
-		val0 = ar8xxx_mii_read32(priv, r2, r1_data0);
-		val1 = ar8xxx_mii_read32(priv, r2, r1_data1);
-		val2 = ar8xxx_mii_read32(priv, r2, r1_data2);
+		__ar8xxx_read_bulk(priv, AR8327_REG_ATU_DATA0, val, 3);
+		val0 = val[0];
+		val1 = val[1];
+		val2 = val[2];
 
 		*status = val2 & AR8327_ATU_STATUS;
 		if (!*status)
@@ -1381,6 +1491,13 @@ static const struct switch_attr ar8327_sw_attr_globals[] = {
 		.set = NULL,
 		.get = ar8xxx_sw_get_arl_table,
 	},
+	{
+		.type = SWITCH_TYPE_ARL,
+		.name = "arl_entries",
+		.description = "Get ARL table entries",
+		.set = NULL,
+		.get = ar8xxx_sw_get_arl_entries,
+	},
 	{
 		.type = SWITCH_TYPE_NOVAL,
 		.name = "flush_arl_table",
@@ -77,6 +77,16 @@
 #define AR8327_REG_LED_CTRL1			0x054
 #define AR8327_REG_LED_CTRL2			0x058
 #define AR8327_REG_LED_CTRL3			0x05c
+#define   AR8327_LED_RULE_S(_phy)		((_phy) == 4 ? 16 : 0)
+#define   AR8327_LED_RULE			BITS(0, 14)
+#define   AR8327_LED_RULE_BLINK_4HZ		1
+#define   AR8327_LED_RULE_LINK_10M		BIT(4)
+#define   AR8327_LED_RULE_LINK_100M		BIT(5)
+#define   AR8327_LED_RULE_LINK_1000M		BIT(6)
+#define   AR8327_LED_RULE_FULL_DUPLEX		BIT(7)
+#define   AR8327_LED_RULE_HALF_DUPLEX		BIT(8)
+#define   AR8327_LED_RULE_TX_BLINK		BIT(9)
+#define   AR8327_LED_RULE_RX_BLINK		BIT(10)
 #define AR8327_REG_MAC_ADDR0			0x060
 #define AR8327_REG_MAC_ADDR1			0x064
 
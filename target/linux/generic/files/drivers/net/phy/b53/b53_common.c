@@ -464,6 +464,71 @@ static int b53_apply(struct b53_device *dev)
 	if (!is5325(dev) && !is5365(dev))
 		b53_set_jumbo(dev, dev->enable_jumbo, 1);
 
+	/* remember what was programmed for the next b53_apply_diff() */
+	for (i = 0; i < dev->sw_dev.vlans; i++) {
+		if (dev->enable_vlan)
+			dev->hw_vlans[i] = dev->vlans[i];
+		else
+			dev->hw_vlans[i].members = dev->hw_vlans[i].untag = 0;
+	}
+
+	b53_for_each_port(dev, i)
+		dev->hw_pvid[i] = dev->enable_vlan ? dev->ports[i].pvid : 1;
+
+	dev->hw_enable_vlan = dev->enable_vlan;
+	dev->hw_enable_jumbo = dev->enable_jumbo;
+	dev->hw_allow_vid_4095 = dev->allow_vid_4095;
+	dev->hw_valid = 1;
+
+	return 0;
+}
+
+/*
+ * Toggling VLAN mode changes the whole forwarding setup, everything else
+ * can be updated in place without disrupting traffic.
+ */
+static bool b53_can_apply_diff(struct b53_device *dev)
+{
+	return dev->hw_valid &&
+	       dev->enable_vlan == dev->hw_enable_vlan &&
+	       dev->allow_vid_4095 == dev->hw_allow_vid_4095;
+}
+
+/* only reprogram VLAN entries and PVIDs differing from the hardware */
+static int b53_apply_diff(struct b53_device *dev)
+{
+	int i;
+
+	if (dev->enable_vlan) {
+		for (i = 0; i < dev->sw_dev.vlans; i++) {
+			struct b53_vlan *vlan = &dev->vlans[i];
+			struct b53_vlan *hw = &dev->hw_vlans[i];
+
+			if (vlan->members == hw->members &&
+			    vlan->untag == hw->untag)
+				continue;
+
+			b53_set_vlan_entry(dev, i, vlan->members, vlan->untag);
+			*hw = *vlan;
+		}
+
+		b53_for_each_port(dev, i) {
+			if (dev->hw_pvid[i] == dev->ports[i].pvid)
+				continue;
+
+			b53_write16(dev, B53_VLAN_PAGE,
+				    B53_VLAN_PORT_DEF_TAG(i),
+				    dev->ports[i].pvid);
+			dev->hw_pvid[i] = dev->ports[i].pvid;
+		}
+	}
+
+	if (dev->enable_jumbo != dev->hw_enable_jumbo &&
+	    !is5325(dev) && !is5365(dev)) {
+		b53_set_jumbo(dev, dev->enable_jumbo, 1);
+		dev->hw_enable_jumbo = dev->enable_jumbo;
+	}
+
 	return 0;
 }
 
@@ -647,6 +712,8 @@ static int b53_switch_reset(struct b53_device *dev)
 	int ret = 0;
 	u8 mgmt;
 
+	dev->hw_valid = 0;
+
 	b53_switch_reset_gpio(dev);
 
 	if (is539x(dev)) {
@@ -978,6 +1045,9 @@ static int b53_global_apply_config(struct switch_dev *dev)
 {
 	struct b53_device *priv = sw_to_b53(dev);
 
+	if (b53_can_apply_diff(priv))
+		return b53_apply_diff(priv);
+
 	/* disable switching */
 	b53_set_forwarding(priv, 0);
 
@@ -1012,9 +1082,11 @@ static int b53_port_get_mib(struct switch_dev *sw_dev,
 			    struct switch_val *val)
 {
 	struct b53_device *dev = sw_to_b53(sw_dev);
+	struct b53_bulk_reg regs[B53_BULK_MAX];
 	const struct b53_mib_desc *mibs;
 	int port = val->port_vlan;
 	int len = 0;
+	int i, num;
 
 	if (!(BIT(port) & dev->enabled_ports))
 		return -1;
@@ -1032,21 +1104,19 @@ static int b53_port_get_mib(struct switch_dev *sw_dev,
 
 	dev->buf[0] = 0;
 
-	for (; mibs->size > 0; mibs++) {
-		u64 val;
-
-		if (mibs->size == 8) {
-			b53_read64(dev, B53_MIB_PAGE(port), mibs->offset, &val);
-		} else {
-			u32 val32;
-
-			b53_read32(dev, B53_MIB_PAGE(port), mibs->offset,
-				   &val32);
-			val = val32;
+	while (mibs->size > 0) {
+		for (num = 0; num < B53_BULK_MAX && mibs[num].size > 0; num++) {
+			regs[num].reg = mibs[num].offset;
+			regs[num].size = mibs[num].size;
+			regs[num].val = 0;
 		}
 
-		len += snprintf(dev->buf + len, B53_BUF_SIZE - len,
-				"%-20s: %llu\n", mibs->name, val);
+		b53_read_bulk(dev, B53_MIB_PAGE(port), regs, num);
+
+		for (i = 0; i < num; i++, mibs++)
+			len += snprintf(dev->buf + len, B53_BUF_SIZE - len,
+					"%-20s: %llu\n", mibs->name,
+					regs[i].val);
 	}
 
 	val->len = len;
@@ -1059,9 +1129,9 @@ static int b53_port_get_stats(struct switch_dev *sw_dev, int port,
 				struct switch_port_stats *stats)
 {
 	struct b53_device *dev = sw_to_b53(sw_dev);
+	struct b53_bulk_reg regs[2];
 	const struct b53_mib_desc *mibs;
 	int txb_id, rxb_id;
-	u64 rxb, txb;
 
 	if (!(BIT(port) & dev->enabled_ports))
 		return -EINVAL;
@@ -1084,21 +1154,17 @@ static int b53_port_get_stats(struct switch_dev *sw_dev, int port,
 
 	dev->buf[0] = 0;
 
-	if (mibs->size == 8) {
-		b53_read64(dev, B53_MIB_PAGE(port), mibs[txb_id].offset, &txb);
-		b53_read64(dev, B53_MIB_PAGE(port), mibs[rxb_id].offset, &rxb);
-	} else {
-		u32 val32;
-
-		b53_read32(dev, B53_MIB_PAGE(port), mibs[txb_id].offset, &val32);
-		txb = val32;
+	regs[0].reg = mibs[txb_id].offset;
+	regs[0].size = mibs[txb_id].size;
+	regs[0].val = 0;
+	regs[1].reg = mibs[rxb_id].offset;
+	regs[1].size = mibs[rxb_id].size;
+	regs[1].val = 0;
 
-		b53_read32(dev, B53_MIB_PAGE(port), mibs[rxb_id].offset, &val32);
-		rxb = val32;
-	}
+	b53_read_bulk(dev, B53_MIB_PAGE(port), regs, ARRAY_SIZE(regs));
 
-	stats->tx_bytes = txb;
-	stats->rx_bytes = rxb;
+	stats->tx_bytes = regs[0].val;
+	stats->rx_bytes = regs[1].val;
 
 	return 0;
 }
@@ -1596,6 +1662,12 @@ static int b53_switch_init(struct b53_device *dev)
 	if (!dev->vlans)
 		return -ENOMEM;
 
+	dev->hw_vlans = devm_kzalloc(dev->dev,
+				     sizeof(struct b53_vlan) * sw_dev->vlans,
+				     GFP_KERNEL);
+	if (!dev->hw_vlans)
+		return -ENOMEM;
+
 	dev->buf = devm_kzalloc(dev->dev, B53_BUF_SIZE, GFP_KERNEL);
 	if (!dev->buf)
 		return -ENOMEM;
@@ -36,7 +36,8 @@
 #define REG_MII_ADDR_WRITE      BIT(0)
 #define REG_MII_ADDR_READ       BIT(1)
 
-static int b53_mdio_op(struct b53_device *dev, u8 page, u8 reg, u16 op)
+/* caller must hold the mdio bus lock */
+static int __b53_mdio_op(struct b53_device *dev, u8 page, u8 reg, u16 op)
 {
 	int i;
 	u16 v;
@@ -46,7 +47,7 @@ static int b53_mdio_op(struct b53_device *dev, u8 page, u8 reg, u16 op)
 	if (dev->current_page != page) {
 		/* set page number */
 		v = (page << 8) | REG_MII_PAGE_ENABLE;
-		ret = mdiobus_write(bus, B53_PSEUDO_PHY, REG_MII_PAGE, v);
+		ret = __mdiobus_write(bus, B53_PSEUDO_PHY, REG_MII_PAGE, v);
 		if (ret)
 			return ret;
 		dev->current_page = page;
@@ -54,13 +55,13 @@ static int b53_mdio_op(struct b53_device *dev, u8 page, u8 reg, u16 op)
 
 	/* set register address */
 	v = (reg << 8) | op;
-	ret = mdiobus_write(bus, B53_PSEUDO_PHY, REG_MII_ADDR, v);
+	ret = __mdiobus_write(bus, B53_PSEUDO_PHY, REG_MII_ADDR, v);
 	if (ret)
 		return ret;
 
 	/* check if operation completed */
 	for (i = 0; i < 5; ++i) {
-		v = mdiobus_read(bus, B53_PSEUDO_PHY, REG_MII_ADDR);
+		v = __mdiobus_read(bus, B53_PSEUDO_PHY, REG_MII_ADDR);
 		if (!(v & (REG_MII_ADDR_WRITE | REG_MII_ADDR_READ)))
 			break;
 		usleep_range(10, 100);
@@ -72,6 +73,18 @@ static int b53_mdio_op(struct b53_device *dev, u8 page, u8 reg, u16 op)
 	return 0;
 }
 
+static int b53_mdio_op(struct b53_device *dev, u8 page, u8 reg, u16 op)
+{
+	struct mii_bus *bus = dev->priv;
+	int ret;
+
+	mutex_lock(&bus->mdio_lock);
+	ret = __b53_mdio_op(dev, page, reg, op);
+	mutex_unlock(&bus->mdio_lock);
+
+	return ret;
+}
+
 static int b53_mdio_read8(struct b53_device *dev, u8 page, u8 reg, u8 *val)
 {
 	struct mii_bus *bus = dev->priv;
@@ -238,6 +251,38 @@ static int b53_mdio_write64(struct b53_device *dev, u8 page, u8 reg,
 	return b53_mdio_op(dev, page, reg, REG_MII_ADDR_WRITE);
 }
 
+/*
+ * Take the bus lock once per register instead of once per bus operation.
+ * Other MDIO users still get the bus between two registers.
+ */
+static int b53_mdio_read_bulk(struct b53_device *dev, u8 page,
+			      struct b53_bulk_reg *regs, unsigned int num)
+{
+	struct mii_bus *bus = dev->priv;
+	unsigned int i;
+	int ret = 0;
+
+	for (i = 0; i < num && !ret; i++) {
+		int words = DIV_ROUND_UP(regs[i].size, 2);
+		u64 temp = 0;
+
+		mutex_lock(&bus->mdio_lock);
+		ret = __b53_mdio_op(dev, page, regs[i].reg, REG_MII_ADDR_READ);
+		while (!ret && words--) {
+			temp <<= 16;
+			temp |= __mdiobus_read(bus, B53_PSEUDO_PHY,
+					       REG_MII_DATA0 + words) & 0xffff;
+		}
+		mutex_unlock(&bus->mdio_lock);
+
+		if (regs[i].size == 1)
+			temp &= 0xff;
+		regs[i].val = temp;
+	}
+
+	return ret;
+}
+
 static int b53_mdio_phy_read16(struct b53_device *dev, int addr, u8 reg,
 			       u16 *value)
 {
@@ -269,6 +314,7 @@ static struct b53_io_ops b53_mdio_ops = {
 	.write64 = b53_mdio_write64,
 	.phy_read16 = b53_mdio_phy_read16,
 	.phy_write16 = b53_mdio_phy_write16,
+	.read_bulk = b53_mdio_read_bulk,
 };
 
 static int b53_phy_probe(struct phy_device *phydev)
@@ -25,6 +25,16 @@
 
 struct b53_device;
 
+/* one register of a b53_read_bulk() request */
+struct b53_bulk_reg {
+	u8 reg;
+	u8 size;	/* 1, 2, 4, 6 or 8 bytes */
+	u64 val;
+};
+
+/* maximum number of registers per b53_read_bulk() call */
+#define B53_BULK_MAX	16
+
 struct b53_io_ops {
 	int (*read8)(struct b53_device *dev, u8 page, u8 reg, u8 *value);
 	int (*read16)(struct b53_device *dev, u8 page, u8 reg, u16 *value);
@@ -38,6 +48,9 @@ struct b53_io_ops {
 	int (*write64)(struct b53_device *dev, u8 page, u8 reg, u64 value);
 	int (*phy_read16)(struct b53_device *dev, int addr, u8 reg, u16 *value);
 	int (*phy_write16)(struct b53_device *dev, int addr, u8 reg, u16 value);
+	/* optional, read several registers of one page in a single burst */
+	int (*read_bulk)(struct b53_device *dev, u8 page,
+			 struct b53_bulk_reg *regs, unsigned int num);
 };
 
 enum {
@@ -101,6 +114,14 @@ struct b53_device {
 	struct b53_port *ports;
 	struct b53_vlan *vlans;
 
+	/* hardware state as of the last apply, invalidated by a reset */
+	unsigned hw_valid:1;
+	unsigned hw_enable_vlan:1;
+	unsigned hw_enable_jumbo:1;
+	unsigned hw_allow_vid_4095:1;
+	u16 hw_pvid[B53_N_PORTS];
+	struct b53_vlan *hw_vlans;
+
 	char *buf;
 };
 
@@ -250,6 +271,69 @@ static inline int b53_read64(struct b53_device *dev, u8 page, u8 reg, u64 *val)
 	return ret;
 }
 
+static inline int __b53_read_reg(struct b53_device *dev, u8 page, u8 reg,
+				 u8 size, u64 *val)
+{
+	int ret;
+
+	switch (size) {
+	case 1: {
+		u8 tmp;
+
+		ret = dev->ops->read8(dev, page, reg, &tmp);
+		*val = tmp;
+		break;
+	}
+	case 2: {
+		u16 tmp;
+
+		ret = dev->ops->read16(dev, page, reg, &tmp);
+		*val = tmp;
+		break;
+	}
+	case 4: {
+		u32 tmp;
+
+		ret = dev->ops->read32(dev, page, reg, &tmp);
+		*val = tmp;
+		break;
+	}
+	case 6:
+		ret = dev->ops->read48(dev, page, reg, val);
+		break;
+	case 8:
+		ret = dev->ops->read64(dev, page, reg, val);
+		break;
+	default:
+		ret = -EINVAL;
+	}
+
+	return ret;
+}
+
+/*
+ * Read several registers of the same page without releasing the register
+ * lock in between, letting the backend skip redundant page selects.
+ */
+static inline int b53_read_bulk(struct b53_device *dev, u8 page,
+				struct b53_bulk_reg *regs, unsigned int num)
+{
+	unsigned int i;
+	int ret = 0;
+
+	mutex_lock(&dev->reg_mutex);
+	if (dev->ops->read_bulk) {
+		ret = dev->ops->read_bulk(dev, page, regs, num);
+	} else {
+		for (i = 0; i < num && !ret; i++)
+			ret = __b53_read_reg(dev, page, regs[i].reg,
+					     regs[i].size, &regs[i].val);
+	}
+	mutex_unlock(&dev->reg_mutex);
+
+	return ret;
+}
+
 static inline int b53_write8(struct b53_device *dev, u8 page, u8 reg, u8 value)
 {
 	int ret;
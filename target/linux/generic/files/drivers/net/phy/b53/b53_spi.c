@@ -270,6 +270,41 @@ static int b53_spi_write64(struct b53_device *dev, u8 page, u8 reg, u64 value)
 	return spi_write(spi, txbuf, sizeof(txbuf));
 }
 
+static int b53_spi_read_bulk(struct b53_device *dev, u8 page,
+			     struct b53_bulk_reg *regs, unsigned int num)
+{
+	struct spi_device *spi = dev->priv;
+	unsigned int i;
+	int ret;
+
+	/* the page stays selected for the whole burst */
+	ret = b53_prepare_reg_access(spi, page);
+	if (ret)
+		return ret;
+
+	for (i = 0; i < num; i++) {
+		u8 buf[8] = { 0 };
+
+		if (i) {
+			ret = b53_spi_clear_status(spi);
+			if (ret)
+				return ret;
+		}
+
+		ret = b53_spi_prepare_reg_read(spi, regs[i].reg);
+		if (ret)
+			return ret;
+
+		ret = b53_spi_read_reg(spi, B53_SPI_DATA, buf, regs[i].size);
+		if (ret)
+			return ret;
+
+		regs[i].val = get_unaligned_le64(buf);
+	}
+
+	return 0;
+}
+
 static struct b53_io_ops b53_spi_ops = {
 	.read8 = b53_spi_read8,
 	.read16 = b53_spi_read16,
@@ -281,6 +316,7 @@ static struct b53_io_ops b53_spi_ops = {
 	.write32 = b53_spi_write32,
 	.write48 = b53_spi_write48,
 	.write64 = b53_spi_write64,
+	.read_bulk = b53_spi_read_bulk,
 };
 
 static int b53_spi_probe(struct spi_device *spi)
@@ -12,6 +12,7 @@
 #include <linux/module.h>
 #include <linux/device.h>
 #include <linux/delay.h>
+#include <linux/ktime.h>
 #include <linux/gpio.h>
 #include <linux/spinlock.h>
 #include <linux/skbuff.h>
@@ -38,6 +39,31 @@ static inline void rtl8366_smi_clk_delay(struct rtl8366_smi *smi)
 	ndelay(smi->clk_delay);
 }
 
+#ifdef CONFIG_RTL8366_SMI_DEBUG_FS
+static void rtl8366_smi_account(struct rtl8366_smi *smi, u64 start,
+				unsigned int count)
+{
+	u64 delta = ktime_get_ns() - start;
+
+	atomic64_add(count, &smi->access_count);
+	atomic64_add(delta, &smi->access_ns);
+
+	/* racy, but good enough for a debug counter */
+	delta = div_u64(delta, count);
+	if (delta > READ_ONCE(smi->access_max_ns))
+		WRITE_ONCE(smi->access_max_ns, delta);
+}
+
+static inline u64 rtl8366_smi_access_start(void)
+{
+	return ktime_get_ns();
+}
+#else
+static inline void rtl8366_smi_account(struct rtl8366_smi *smi, u64 start,
+				       unsigned int count) {}
+static inline u64 rtl8366_smi_access_start(void) { return 0; }
+#endif
+
 static void rtl8366_smi_start(struct rtl8366_smi *smi)
 {
 	unsigned int sda = smi->gpio_sda;
@@ -47,8 +73,14 @@ static void rtl8366_smi_start(struct rtl8366_smi *smi)
 	 * Set GPIO pins to output mode, with initial state:
 	 * SCK = 0, SDA = 1
 	 */
-	gpio_direction_output(sck, 0);
-	gpio_direction_output(sda, 1);
+	if (smi->pins_out) {
+		gpio_set_value(sck, 0);
+		gpio_set_value(sda, 1);
+	} else {
+		gpio_direction_output(sck, 0);
+		gpio_direction_output(sda, 1);
+		smi->pins_out = true;
+	}
 	rtl8366_smi_clk_delay(smi);
 
 	/* CLK 1: 0 -> 1, 1 -> 0 */
@@ -67,7 +99,11 @@ static void rtl8366_smi_start(struct rtl8366_smi *smi)
 	gpio_set_value(sda, 1);
 }
 
-static void rtl8366_smi_stop(struct rtl8366_smi *smi)
+/*
+ * Within a batch the pins stay outputs between transactions, saving the
+ * direction switches on every register access.
+ */
+static void rtl8366_smi_stop(struct rtl8366_smi *smi, bool release)
 {
 	unsigned int sda = smi->gpio_sda;
 	unsigned int sck = smi->gpio_sck;
@@ -90,9 +126,13 @@ static void rtl8366_smi_stop(struct rtl8366_smi *smi)
 	rtl8366_smi_clk_delay(smi);
 	gpio_set_value(sck, 1);
 
+	if (!release)
+		return;
+
 	/* set GPIO pins to input mode */
 	gpio_direction_input(sda);
 	gpio_direction_input(sck);
+	smi->pins_out = false;
 }
 
 static void rtl8366_smi_write_bits(struct rtl8366_smi *smi, u32 data, u32 len)
@@ -199,7 +239,8 @@ static int rtl8366_smi_read_byte1(struct rtl8366_smi *smi, u8 *data)
 	return 0;
 }
 
-static int __rtl8366_smi_read_reg(struct rtl8366_smi *smi, u32 addr, u32 *data)
+static int __rtl8366_smi_read_one(struct rtl8366_smi *smi, u32 addr, u32 *data,
+				  bool release)
 {
 	unsigned long flags;
 	u8 lo = 0;
@@ -235,11 +276,46 @@ static int __rtl8366_smi_read_reg(struct rtl8366_smi *smi, u32 addr, u32 *data)
 	ret = 0;
 
  out:
-	rtl8366_smi_stop(smi);
+	rtl8366_smi_stop(smi, release);
 	spin_unlock_irqrestore(&smi->lock, flags);
 
 	return ret;
 }
+
+static int __rtl8366_smi_read_reg(struct rtl8366_smi *smi, u32 addr, u32 *data)
+{
+	return __rtl8366_smi_read_one(smi, addr, data, true);
+}
+
+/*
+ * The lock is only held for one register at a time to keep the interrupt
+ * latency bounded, the pins are released after the last one.
+ */
+static int __rtl8366_smi_read_regs(struct rtl8366_smi *smi, u32 addr,
+				   u32 *data, unsigned int count)
+{
+	unsigned int i;
+	int ret = 0;
+
+	for (i = 0; i < count && !ret; i++)
+		ret = __rtl8366_smi_read_one(smi, addr + i, &data[i],
+					     i == count - 1);
+
+	if (ret) {
+		unsigned long flags;
+
+		spin_lock_irqsave(&smi->lock, flags);
+		if (smi->pins_out) {
+			gpio_direction_input(smi->gpio_sda);
+			gpio_direction_input(smi->gpio_sck);
+			smi->pins_out = false;
+		}
+		spin_unlock_irqrestore(&smi->lock, flags);
+	}
+
+	return ret;
+}
+
 /* Read/write via mdiobus */
 #define MDC_MDIO_CTRL0_REG		31
 #define MDC_MDIO_START_REG		29
@@ -254,14 +330,12 @@ static int __rtl8366_smi_read_reg(struct rtl8366_smi *smi, u32 addr, u32 *data)
 #define MDC_MDIO_WRITE_OP		0x0003
 #define MDC_REALTEK_PHY_ADDR		0x0
 
-int __rtl8366_mdio_read_reg(struct rtl8366_smi *smi, u32 addr, u32 *data)
+/* caller must hold the mdio bus lock */
+static void __rtl8366_mdio_read_one(struct rtl8366_smi *smi, u32 addr, u32 *data)
 {
 	u32 phy_id = smi->phy_id;
 	struct mii_bus *mbus = smi->ext_mbus;
 
-	BUG_ON(in_interrupt());
-
-	mutex_lock(&mbus->mdio_lock);
 	/* Write Start command to register 29 */
 	mbus->write(mbus, phy_id, MDC_MDIO_START_REG, MDC_MDIO_START_OP);
 
@@ -285,7 +359,32 @@ int __rtl8366_mdio_read_reg(struct rtl8366_smi *smi, u32 addr, u32 *data)
 
 	/* Read data from register 25 */
 	*data = mbus->read(mbus, phy_id, MDC_MDIO_DATA_READ_REG);
+}
+
+int __rtl8366_mdio_read_reg(struct rtl8366_smi *smi, u32 addr, u32 *data)
+{
+	struct mii_bus *mbus = smi->ext_mbus;
+
+	BUG_ON(in_interrupt());
+
+	mutex_lock(&mbus->mdio_lock);
+	__rtl8366_mdio_read_one(smi, addr, data);
+	mutex_unlock(&mbus->mdio_lock);
+
+	return 0;
+}
+
+static int __rtl8366_mdio_read_regs(struct rtl8366_smi *smi, u32 addr,
+				    u32 *data, unsigned int count)
+{
+	struct mii_bus *mbus = smi->ext_mbus;
+	unsigned int i;
+
+	BUG_ON(in_interrupt());
 
+	mutex_lock(&mbus->mdio_lock);
+	for (i = 0; i < count; i++)
+		__rtl8366_mdio_read_one(smi, addr + i, &data[i]);
 	mutex_unlock(&mbus->mdio_lock);
 
 	return 0;
@@ -330,13 +429,41 @@ static int __rtl8366_mdio_write_reg(struct rtl8366_smi *smi, u32 addr, u32 data)
 
 int rtl8366_smi_read_reg(struct rtl8366_smi *smi, u32 addr, u32 *data)
 {
+	u64 start = rtl8366_smi_access_start();
+	int ret;
+
 	if (smi->ext_mbus)
-		return __rtl8366_mdio_read_reg(smi, addr, data);
+		ret = __rtl8366_mdio_read_reg(smi, addr, data);
 	else
-		return __rtl8366_smi_read_reg(smi, addr, data);
+		ret = __rtl8366_smi_read_reg(smi, addr, data);
+
+	rtl8366_smi_account(smi, start, 1);
+
+	return ret;
 }
 EXPORT_SYMBOL_GPL(rtl8366_smi_read_reg);
 
+/* read count consecutive registers starting at addr */
+int rtl8366_smi_read_regs(struct rtl8366_smi *smi, u32 addr, u32 *data,
+			  unsigned int count)
+{
+	u64 start = rtl8366_smi_access_start();
+	int ret;
+
+	if (!count)
+		return 0;
+
+	if (smi->ext_mbus)
+		ret = __rtl8366_mdio_read_regs(smi, addr, data, count);
+	else
+		ret = __rtl8366_smi_read_regs(smi, addr, data, count);
+
+	rtl8366_smi_account(smi, start, count);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(rtl8366_smi_read_regs);
+
 static int __rtl8366_smi_write_reg(struct rtl8366_smi *smi,
 				   u32 addr, u32 data, bool ack)
 {
@@ -378,7 +505,7 @@ static int __rtl8366_smi_write_reg(struct rtl8366_smi *smi,
 	ret = 0;
 
  out:
-	rtl8366_smi_stop(smi);
+	rtl8366_smi_stop(smi, true);
 	spin_unlock_irqrestore(&smi->lock, flags);
 
 	return ret;
@@ -386,10 +513,17 @@ static int __rtl8366_smi_write_reg(struct rtl8366_smi *smi,
 
 int rtl8366_smi_write_reg(struct rtl8366_smi *smi, u32 addr, u32 data)
 {
+	u64 start = rtl8366_smi_access_start();
+	int ret;
+
 	if (smi->ext_mbus)
-		return __rtl8366_mdio_write_reg(smi, addr, data);
+		ret = __rtl8366_mdio_write_reg(smi, addr, data);
 	else
-		return __rtl8366_smi_write_reg(smi, addr, data, true);
+		ret = __rtl8366_smi_write_reg(smi, addr, data, true);
+
+	rtl8366_smi_account(smi, start, 1);
+
+	return ret;
 }
 EXPORT_SYMBOL_GPL(rtl8366_smi_write_reg);
 
@@ -895,6 +1029,42 @@ static ssize_t rtl8366_read_debugfs_mibs(struct file *file,
 	return simple_read_from_buffer(user_buf, count, ppos, buf, len);
 }
 
+static ssize_t rtl8366_read_debugfs_access_stats(struct file *file,
+						 char __user *user_buf,
+						 size_t count, loff_t *ppos)
+{
+	struct rtl8366_smi *smi = file->private_data;
+	u64 accesses = atomic64_read(&smi->access_count);
+	u64 ns = atomic64_read(&smi->access_ns);
+	char *buf = smi->buf;
+	int len = 0;
+
+	len += snprintf(buf + len, sizeof(smi->buf) - len,
+			"transport: %s\n", smi->ext_mbus ? "mdio" : "gpio");
+	len += snprintf(buf + len, sizeof(smi->buf) - len,
+			"accesses: %llu\n", accesses);
+	len += snprintf(buf + len, sizeof(smi->buf) - len,
+			"avg ns: %llu\n", accesses ? div64_u64(ns, accesses) : 0);
+	len += snprintf(buf + len, sizeof(smi->buf) - len,
+			"max ns: %llu\n", READ_ONCE(smi->access_max_ns));
+
+	return simple_read_from_buffer(user_buf, count, ppos, buf, len);
+}
+
+static ssize_t rtl8366_write_debugfs_access_stats(struct file *file,
+						  const char __user *user_buf,
+						  size_t count, loff_t *ppos)
+{
+	struct rtl8366_smi *smi = file->private_data;
+
+	/* any write resets the counters */
+	atomic64_set(&smi->access_count, 0);
+	atomic64_set(&smi->access_ns, 0);
+	WRITE_ONCE(smi->access_max_ns, 0);
+
+	return count;
+}
+
 static const struct file_operations fops_rtl8366_regs = {
 	.read	= rtl8366_read_debugfs_reg,
 	.write	= rtl8366_write_debugfs_reg,
@@ -926,6 +1096,13 @@ static const struct file_operations fops_rtl8366_mibs = {
 	.owner = THIS_MODULE
 };
 
+static const struct file_operations fops_rtl8366_access_stats = {
+	.read = rtl8366_read_debugfs_access_stats,
+	.write = rtl8366_write_debugfs_access_stats,
+	.open = rtl8366_debugfs_open,
+	.owner = THIS_MODULE
+};
+
 static void rtl8366_debugfs_init(struct rtl8366_smi *smi)
 {
 	struct dentry *node;
@@ -994,6 +1171,12 @@ static void rtl8366_debugfs_init(struct rtl8366_smi *smi)
 	if (!node)
 		dev_err(smi->parent, "Creating debugfs file '%s' failed\n",
 			"mibs");
+
+	node = debugfs_create_file("access_stats", S_IRUSR | S_IWUSR, root,
+				   smi, &fops_rtl8366_access_stats);
+	if (!node)
+		dev_err(smi->parent, "Creating debugfs file '%s' failed\n",
+			"access_stats");
 }
 
 static void rtl8366_debugfs_remove(struct rtl8366_smi *smi)
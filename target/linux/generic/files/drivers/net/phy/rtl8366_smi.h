@@ -50,6 +50,7 @@ struct rtl8366_smi {
 	unsigned int		clk_delay;	/* ns */
 	u8			cmd_read;
 	u8			cmd_write;
+	bool			pins_out;	/* SDA/SCK left as outputs */
 	spinlock_t		lock;
 	struct mii_bus		*mii_bus;
 	int			mii_irq[PHY_MAX_ADDR];
@@ -74,6 +75,9 @@ struct rtl8366_smi {
 	struct dentry           *debugfs_root;
 	u16			dbg_reg;
 	u8			dbg_vlan_4k_page;
+	atomic64_t		access_count;
+	atomic64_t		access_ns;
+	u64			access_max_ns;
 #endif
 	u32			phy_id;
 	rtl8367b_chip_t		rtl8367b_chip;
@@ -128,6 +132,8 @@ void rtl8366_smi_cleanup(struct rtl8366_smi *smi);
 int rtl8366_smi_write_reg(struct rtl8366_smi *smi, u32 addr, u32 data);
 int rtl8366_smi_write_reg_noack(struct rtl8366_smi *smi, u32 addr, u32 data);
 int rtl8366_smi_read_reg(struct rtl8366_smi *smi, u32 addr, u32 *data);
+int rtl8366_smi_read_regs(struct rtl8366_smi *smi, u32 addr, u32 *data,
+			  unsigned int count);
 int rtl8366_smi_rmwr(struct rtl8366_smi *smi, u32 addr, u32 mask, u32 data);
 
 #ifdef CONFIG_RTL8366_SMI_DEBUG_FS
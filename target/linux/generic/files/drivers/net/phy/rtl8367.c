@@ -1221,6 +1221,7 @@ static int rtl8367_get_mib_counter(struct rtl8366_smi *smi, int counter,
 	int i;
 	int err;
 	u32 addr, data;
+	u32 words[4];
 	u64 mibvalue;
 
 	if (port > RTL8367_NUM_PORTS || counter >= RTL8367_MIB_COUNT)
@@ -1249,11 +1250,15 @@ static int rtl8367_get_mib_counter(struct rtl8366_smi *smi, int counter,
 	else
 		offset = (mib->offset + 1) % 4;
 
+	err = rtl8366_smi_read_regs(smi,
+				    RTL8367_MIB_COUNTER_REG(offset - mib->length + 1),
+				    words, mib->length);
+	if (err)
+		return err;
+
 	mibvalue = 0;
-	for (i = 0; i < mib->length; i++) {
-		REG_RD(smi, RTL8367_MIB_COUNTER_REG(offset - i), &data);
-		mibvalue = (mibvalue << 16) | (data & 0xFFFF);
-	}
+	for (i = mib->length; i > 0; i--)
+		mibvalue = (mibvalue << 16) | (words[i - 1] & 0xFFFF);
 
 	*val = mibvalue;
 	return 0;
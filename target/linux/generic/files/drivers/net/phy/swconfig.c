@@ -279,6 +279,10 @@ static const struct nla_policy switch_policy[SWITCH_ATTR_MAX+1] = {
 	[SWITCH_ATTR_OP_VALUE_STR] = { .type = NLA_NUL_STRING },
 	[SWITCH_ATTR_OP_VALUE_PORTS] = { .type = NLA_NESTED },
 	[SWITCH_ATTR_TYPE] = { .type = NLA_U32 },
+	[SWITCH_ATTR_OP_BATCH] = { .type = NLA_NESTED },
+	[SWITCH_ATTR_OP] = { .type = NLA_NESTED },
+	[SWITCH_ATTR_OP_CMD] = { .type = NLA_U32 },
+	[SWITCH_ATTR_OP_APPLY] = { .type = NLA_FLAG },
 };
 
 static const struct nla_policy port_policy[SWITCH_PORT_ATTR_MAX+1] = {
@@ -493,10 +497,9 @@ out:
 }
 
 static const struct switch_attr *
-swconfig_lookup_attr(struct switch_dev *dev, struct genl_info *info,
+__swconfig_lookup_attr(struct switch_dev *dev, int cmd, struct nlattr **attrs,
 		struct switch_val *val)
 {
-	struct genlmsghdr *hdr = nlmsg_data(info->nlhdr);
 	const struct switch_attrlist *alist;
 	const struct switch_attr *attr = NULL;
 	unsigned int attr_id;
@@ -506,10 +509,10 @@ swconfig_lookup_attr(struct switch_dev *dev, struct genl_info *info,
 	unsigned long *def_active;
 	int n_def;
 
-	if (!info->attrs[SWITCH_ATTR_OP_ID])
+	if (!attrs[SWITCH_ATTR_OP_ID])
 		goto done;
 
-	switch (hdr->cmd) {
+	switch (cmd) {
 	case SWITCH_CMD_SET_GLOBAL:
 	case SWITCH_CMD_GET_GLOBAL:
 		alist = &dev->ops->attr_global;
@@ -523,9 +526,9 @@ swconfig_lookup_attr(struct switch_dev *dev, struct genl_info *info,
 		def_list = default_vlan;
 		def_active = &dev->def_vlan;
 		n_def = ARRAY_SIZE(default_vlan);
-		if (!info->attrs[SWITCH_ATTR_OP_VLAN])
+		if (!attrs[SWITCH_ATTR_OP_VLAN])
 			goto done;
-		val->port_vlan = nla_get_u32(info->attrs[SWITCH_ATTR_OP_VLAN]);
+		val->port_vlan = nla_get_u32(attrs[SWITCH_ATTR_OP_VLAN]);
 		if (val->port_vlan >= dev->vlans)
 			goto done;
 		break;
@@ -535,9 +538,9 @@ swconfig_lookup_attr(struct switch_dev *dev, struct genl_info *info,
 		def_list = default_port;
 		def_active = &dev->def_port;
 		n_def = ARRAY_SIZE(default_port);
-		if (!info->attrs[SWITCH_ATTR_OP_PORT])
+		if (!attrs[SWITCH_ATTR_OP_PORT])
 			goto done;
-		val->port_vlan = nla_get_u32(info->attrs[SWITCH_ATTR_OP_PORT]);
+		val->port_vlan = nla_get_u32(attrs[SWITCH_ATTR_OP_PORT]);
 		if (val->port_vlan >= dev->ports)
 			goto done;
 		break;
@@ -549,7 +552,7 @@ swconfig_lookup_attr(struct switch_dev *dev, struct genl_info *info,
 	if (!alist)
 		goto done;
 
-	attr_id = nla_get_u32(info->attrs[SWITCH_ATTR_OP_ID]);
+	attr_id = nla_get_u32(attrs[SWITCH_ATTR_OP_ID]);
 	if (attr_id >= SWITCH_ATTR_DEFAULTS_OFFSET) {
 		attr_id -= SWITCH_ATTR_DEFAULTS_OFFSET;
 		if (attr_id >= n_def)
@@ -573,6 +576,15 @@ done:
 	return attr;
 }
 
+static const struct switch_attr *
+swconfig_lookup_attr(struct switch_dev *dev, struct genl_info *info,
+		struct switch_val *val)
+{
+	struct genlmsghdr *hdr = nlmsg_data(info->nlhdr);
+
+	return __swconfig_lookup_attr(dev, hdr->cmd, info->attrs, val);
+}
+
 static int
 swconfig_parse_ports(struct sk_buff *msg, struct nlattr *head,
 		struct switch_val *val, int max)
@@ -623,22 +635,15 @@ swconfig_parse_link(struct sk_buff *msg, struct nlattr *nla,
 }
 
 static int
-swconfig_set_attr(struct sk_buff *skb, struct genl_info *info)
+swconfig_set_one(struct sk_buff *skb, struct switch_dev *dev, int cmd,
+		 struct nlattr **attrs)
 {
 	const struct switch_attr *attr;
-	struct switch_dev *dev;
 	struct switch_val val;
 	int err = -EINVAL;
 
-	if (!capable(CAP_NET_ADMIN))
-		return -EPERM;
-
-	dev = swconfig_get_dev(info);
-	if (!dev)
-		return -EINVAL;
-
 	memset(&val, 0, sizeof(val));
-	attr = swconfig_lookup_attr(dev, info, &val);
+	attr = __swconfig_lookup_attr(dev, cmd, attrs, &val);
 	if (!attr || !attr->set)
 		goto error;
 
@@ -647,16 +652,16 @@ swconfig_set_attr(struct sk_buff *skb, struct genl_info *info)
 	case SWITCH_TYPE_NOVAL:
 		break;
 	case SWITCH_TYPE_INT:
-		if (!info->attrs[SWITCH_ATTR_OP_VALUE_INT])
+		if (!attrs[SWITCH_ATTR_OP_VALUE_INT])
 			goto error;
 		val.value.i =
-			nla_get_u32(info->attrs[SWITCH_ATTR_OP_VALUE_INT]);
+			nla_get_u32(attrs[SWITCH_ATTR_OP_VALUE_INT]);
 		break;
 	case SWITCH_TYPE_STRING:
-		if (!info->attrs[SWITCH_ATTR_OP_VALUE_STR])
+		if (!attrs[SWITCH_ATTR_OP_VALUE_STR])
 			goto error;
 		val.value.s =
-			nla_data(info->attrs[SWITCH_ATTR_OP_VALUE_STR]);
+			nla_data(attrs[SWITCH_ATTR_OP_VALUE_STR]);
 		break;
 	case SWITCH_TYPE_PORTS:
 		val.value.ports = dev->portbuf;
@@ -664,9 +669,9 @@ swconfig_set_attr(struct sk_buff *skb, struct genl_info *info)
 			sizeof(struct switch_port) * dev->ports);
 
 		/* TODO: implement multipart? */
-		if (info->attrs[SWITCH_ATTR_OP_VALUE_PORTS]) {
+		if (attrs[SWITCH_ATTR_OP_VALUE_PORTS]) {
 			err = swconfig_parse_ports(skb,
-				info->attrs[SWITCH_ATTR_OP_VALUE_PORTS],
+				attrs[SWITCH_ATTR_OP_VALUE_PORTS],
 				&val, dev->ports);
 			if (err < 0)
 				goto error;
@@ -679,9 +684,9 @@ swconfig_set_attr(struct sk_buff *skb, struct genl_info *info)
 		val.value.link = &dev->linkbuf;
 		memset(&dev->linkbuf, 0, sizeof(struct switch_port_link));
 
-		if (info->attrs[SWITCH_ATTR_OP_VALUE_LINK]) {
+		if (attrs[SWITCH_ATTR_OP_VALUE_LINK]) {
 			err = swconfig_parse_link(skb,
-						  info->attrs[SWITCH_ATTR_OP_VALUE_LINK],
+						  attrs[SWITCH_ATTR_OP_VALUE_LINK],
 						  val.value.link);
 			if (err < 0)
 				goto error;
@@ -696,7 +701,94 @@ swconfig_set_attr(struct sk_buff *skb, struct genl_info *info)
 
 	err = attr->set(dev, attr, &val);
 error:
+	return err;
+}
+
+static int
+swconfig_set_attr(struct sk_buff *skb, struct genl_info *info)
+{
+	struct genlmsghdr *hdr = nlmsg_data(info->nlhdr);
+	struct switch_dev *dev;
+	int err;
+
+	if (!capable(CAP_NET_ADMIN))
+		return -EPERM;
+
+	dev = swconfig_get_dev(info);
+	if (!dev)
+		return -EINVAL;
+
+	err = swconfig_set_one(skb, dev, hdr->cmd, info->attrs);
 	swconfig_put_dev(dev);
+
+	return err;
+}
+
+static int
+swconfig_set_batch_op(struct sk_buff *skb, struct switch_dev *dev,
+		      struct nlattr *nla, struct netlink_ext_ack *extack)
+{
+	struct nlattr *tb[SWITCH_ATTR_MAX + 1];
+	int cmd;
+
+	if (nla_parse_nested_deprecated(tb, SWITCH_ATTR_MAX, nla,
+					switch_policy, extack))
+		return -EINVAL;
+
+	if (!tb[SWITCH_ATTR_OP_CMD])
+		return -EINVAL;
+
+	cmd = nla_get_u32(tb[SWITCH_ATTR_OP_CMD]);
+	switch (cmd) {
+	case SWITCH_CMD_SET_GLOBAL:
+	case SWITCH_CMD_SET_VLAN:
+	case SWITCH_CMD_SET_PORT:
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return swconfig_set_one(skb, dev, cmd, tb);
+}
+
+/* Apply a list of attribute changes, optionally followed by apply_config,
+ * in one request. The device stays locked for the whole batch, so other
+ * requests can not interleave with it.
+ */
+static int
+swconfig_set_batch(struct sk_buff *skb, struct genl_info *info)
+{
+	struct switch_dev *dev;
+	struct nlattr *nla;
+	int err = 0;
+	int rem;
+	int ret;
+
+	dev = swconfig_get_dev(info);
+	if (!dev)
+		return -EINVAL;
+
+	if (info->attrs[SWITCH_ATTR_OP_BATCH]) {
+		nla_for_each_nested(nla, info->attrs[SWITCH_ATTR_OP_BATCH], rem) {
+			if (nla_type(nla) != SWITCH_ATTR_OP)
+				continue;
+
+			/* carry on like a series of set requests would, but
+			 * report the first failure */
+			ret = swconfig_set_batch_op(skb, dev, nla, info->extack);
+			if (ret && !err)
+				err = ret;
+		}
+	}
+
+	if (info->attrs[SWITCH_ATTR_OP_APPLY] && dev->ops->apply_config) {
+		ret = dev->ops->apply_config(dev);
+		if (ret && !err)
+			err = ret;
+	}
+
+	swconfig_put_dev(dev);
+
 	return err;
 }
 
@@ -820,6 +912,127 @@ nla_put_failure:
 	return -1;
 }
 
+static int
+swconfig_close_arl(struct swconfig_callback *cb, void *arg)
+{
+	if (!cb->hdr)
+		return 0;
+
+	nla_nest_end(cb->msg, cb->nest[0]);
+	genlmsg_end(cb->msg, cb->hdr);
+
+	/* the next part starts with a fresh header */
+	cb->hdr = NULL;
+	cb->nest[0] = NULL;
+
+	return 0;
+}
+
+static int
+swconfig_start_arl(struct swconfig_callback *cb)
+{
+	struct genl_info *info = cb->info;
+
+	if (cb->hdr)
+		return 0;
+
+	cb->hdr = genlmsg_put(cb->msg, info->snd_portid, info->snd_seq,
+			      &switch_fam, NLM_F_MULTI, cb->args[0]);
+	if (!cb->hdr)
+		return -1;
+
+	cb->nest[0] = nla_nest_start(cb->msg, cb->cmd);
+	if (!cb->nest[0]) {
+		genlmsg_cancel(cb->msg, cb->hdr);
+		cb->hdr = NULL;
+		return -1;
+	}
+
+	return 0;
+}
+
+static int
+swconfig_send_arl_entry(struct swconfig_callback *cb, void *arg)
+{
+	const struct switch_arl_entry *arl = arg;
+	struct nlattr *p;
+
+	if (swconfig_start_arl(cb))
+		return -1;
+
+	p = nla_nest_start(cb->msg, SWITCH_ATTR_ARL);
+	if (!p)
+		return -1;
+
+	if (nla_put(cb->msg, SWITCH_ARL_MAC, ETH_ALEN, arl->mac))
+		goto nla_put_failure;
+	if (nla_put_u32(cb->msg, SWITCH_ARL_PORTMAP, arl->portmap))
+		goto nla_put_failure;
+
+	nla_nest_end(cb->msg, p);
+	return 0;
+
+nla_put_failure:
+	nla_nest_cancel(cb->msg, p);
+	return -1;
+}
+
+/* address tables do not fit into a single message, send them as a
+ * multipart reply terminated by NLMSG_DONE */
+static int
+swconfig_send_arl(struct genl_info *info, int cmd,
+		  const struct switch_val *val)
+{
+	struct swconfig_callback cb;
+	int err;
+	int i;
+
+	memset(&cb, 0, sizeof(cb));
+	cb.cmd = SWITCH_ATTR_OP_VALUE_ARL;
+	cb.args[0] = cmd;
+	cb.info = info;
+	cb.fill = swconfig_send_arl_entry;
+	cb.close = swconfig_close_arl;
+
+	for (i = 0; i < val->len; i++) {
+		err = swconfig_send_multipart(&cb, &val->value.arl[i]);
+		if (err)
+			return -ENOMEM;
+	}
+
+	if (!cb.msg) {
+		cb.msg = nlmsg_new(NLMSG_GOODSIZE, GFP_KERNEL);
+		if (!cb.msg)
+			return -ENOMEM;
+	}
+
+	/* an empty table still gets one (empty) part */
+	if (swconfig_start_arl(&cb))
+		goto error;
+	swconfig_close_arl(&cb, NULL);
+
+	if (!nlmsg_put(cb.msg, info->snd_portid, info->snd_seq,
+		       NLMSG_DONE, 0, NLM_F_MULTI)) {
+		err = genlmsg_reply(cb.msg, info);
+		if (err < 0)
+			return err;
+
+		cb.msg = nlmsg_new(0, GFP_KERNEL);
+		if (!cb.msg)
+			return -ENOMEM;
+
+		if (!nlmsg_put(cb.msg, info->snd_portid, info->snd_seq,
+			       NLMSG_DONE, 0, NLM_F_MULTI))
+			goto error;
+	}
+
+	return genlmsg_reply(cb.msg, info);
+
+error:
+	nlmsg_free(cb.msg);
+	return -ENOMEM;
+}
+
 static int
 swconfig_get_attr(struct sk_buff *skb, struct genl_info *info)
 {
@@ -853,6 +1066,12 @@ swconfig_get_attr(struct sk_buff *skb, struct genl_info *info)
 	if (err)
 		goto error;
 
+	if (attr->type == SWITCH_TYPE_ARL) {
+		err = swconfig_send_arl(info, cmd, &val);
+		swconfig_put_dev(dev);
+		return err;
+	}
+
 	msg = nlmsg_new(NLMSG_GOODSIZE, GFP_KERNEL);
 	if (!msg)
 		goto error;
@@ -1036,6 +1255,11 @@ static struct genl_ops swconfig_ops[] = {
 		.flags = GENL_ADMIN_PERM,
 		.doit = swconfig_set_attr,
 	},
+	{
+		.cmd = SWITCH_CMD_SET_BATCH,
+		.flags = GENL_ADMIN_PERM,
+		.doit = swconfig_set_batch,
+	},
 	{
 		.cmd = SWITCH_CMD_GET_SWITCH,
 		.validate = GENL_DONT_VALIDATE_STRICT | GENL_DONT_VALIDATE_DUMP,
@@ -1187,6 +1411,17 @@ unregister_switch(struct switch_dev *dev)
 }
 EXPORT_SYMBOL_GPL(unregister_switch);
 
+/*
+ * Called by drivers that set link_events on port link changes. May be
+ * called for changes on any port and from atomic context.
+ */
+void
+switch_port_link_changed(struct switch_dev *dev)
+{
+	swconfig_led_link_changed(dev);
+}
+EXPORT_SYMBOL_GPL(switch_port_link_changed);
+
 int
 switch_generic_set_link(struct switch_dev *dev, int port,
 			struct switch_port_link *link)
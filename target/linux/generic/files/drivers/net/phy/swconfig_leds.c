@@ -44,6 +44,8 @@ struct switch_led_trigger {
 
 	struct delayed_work sw_led_work;
 	u32 port_mask;
+	u32 traffic_mask;	/* ports with a tx/rx blinking led */
+	unsigned long link_changed;
 	u32 port_link;
 	unsigned long long port_tx_traffic[SWCONFIG_LED_NUM_PORTS];
 	unsigned long long port_rx_traffic[SWCONFIG_LED_NUM_PORTS];
@@ -77,7 +79,7 @@ swconfig_trig_update_port_mask(struct led_trigger *trigger)
 {
 	struct list_head *entry;
 	struct switch_led_trigger *sw_trig;
-	u32 port_mask;
+	u32 port_mask, traffic_mask;
 
 	if (!trigger)
 		return;
@@ -85,6 +87,7 @@ swconfig_trig_update_port_mask(struct led_trigger *trigger)
 	sw_trig = (void *) trigger;
 
 	port_mask = 0;
+	traffic_mask = 0;
 	spin_lock(&trigger->leddev_list_lock);
 	list_for_each(entry, &trigger->led_cdevs) {
 		struct led_classdev *led_cdev;
@@ -95,18 +98,23 @@ swconfig_trig_update_port_mask(struct led_trigger *trigger)
 		if (trig_data) {
 			read_lock(&trig_data->lock);
 			port_mask |= trig_data->port_mask;
+			if (trig_data->mode & SWCONFIG_LED_MODE_TXRX)
+				traffic_mask |= trig_data->port_mask;
 			read_unlock(&trig_data->lock);
 		}
 	}
 	spin_unlock(&trigger->leddev_list_lock);
 
 	sw_trig->port_mask = port_mask;
+	sw_trig->traffic_mask = traffic_mask;
 
-	if (port_mask)
-		schedule_delayed_work(&sw_trig->sw_led_work,
-				      SWCONFIG_LED_TIMER_INTERVAL);
-	else
+	if (port_mask) {
+		/* pick up the link state of newly added ports right away */
+		set_bit(0, &sw_trig->link_changed);
+		mod_delayed_work(system_wq, &sw_trig->sw_led_work, 0);
+	} else {
 		cancel_delayed_work_sync(&sw_trig->sw_led_work);
+	}
 }
 
 static ssize_t
@@ -267,6 +275,9 @@ static ssize_t swconfig_trig_mode_store(struct device *dev,
 	trig_data->mode = (u8)new_mode;
 	write_unlock(&trig_data->lock);
 
+	/* tx/rx mode decides which port counters are polled */
+	swconfig_trig_update_port_mask(led_cdev->trigger);
+
 	return size;
 }
 
@@ -429,22 +440,15 @@ swconfig_trig_update_leds(struct switch_led_trigger *sw_trig)
 }
 
 static void
-swconfig_led_work_func(struct work_struct *work)
+swconfig_led_read_link(struct switch_led_trigger *sw_trig, u32 port_mask)
 {
-	struct switch_led_trigger *sw_trig;
-	struct switch_dev *swdev;
-	u32 port_mask;
+	struct switch_dev *swdev = sw_trig->swdev;
 	u32 link;
 	int i;
 
-	sw_trig = container_of(work, struct switch_led_trigger,
-			       sw_led_work.work);
-
-	port_mask = sw_trig->port_mask;
-	swdev = sw_trig->swdev;
-
 	link = 0;
 	for (i = 0; i < SWCONFIG_LED_NUM_PORTS; i++) {
+		struct switch_port_link port_link;
 		u32 port_bit;
 
 		sw_trig->link_speed[i] = 0;
@@ -453,51 +457,95 @@ swconfig_led_work_func(struct work_struct *work)
 		if ((port_mask & port_bit) == 0)
 			continue;
 
-		if (swdev->ops->get_port_link) {
-			struct switch_port_link port_link;
-
-			memset(&port_link, '\0', sizeof(port_link));
-			swdev->ops->get_port_link(swdev, i, &port_link);
-
-			if (port_link.link) {
-				link |= port_bit;
-				switch (port_link.speed) {
-				case SWITCH_PORT_SPEED_UNKNOWN:
-					sw_trig->link_speed[i] =
-						SWCONFIG_LED_PORT_SPEED_NA;
-					break;
-				case SWITCH_PORT_SPEED_10:
-					sw_trig->link_speed[i] =
-						SWCONFIG_LED_PORT_SPEED_10;
-					break;
-				case SWITCH_PORT_SPEED_100:
-					sw_trig->link_speed[i] =
-						SWCONFIG_LED_PORT_SPEED_100;
-					break;
-				case SWITCH_PORT_SPEED_1000:
-					sw_trig->link_speed[i] =
-						SWCONFIG_LED_PORT_SPEED_1000;
-					break;
-				}
-			}
-		}
-
-		if (swdev->ops->get_port_stats) {
-			struct switch_port_stats port_stats;
+		memset(&port_link, '\0', sizeof(port_link));
+		swdev->ops->get_port_link(swdev, i, &port_link);
+		if (!port_link.link)
+			continue;
 
-			memset(&port_stats, '\0', sizeof(port_stats));
-			swdev->ops->get_port_stats(swdev, i, &port_stats);
-			sw_trig->port_tx_traffic[i] = port_stats.tx_bytes;
-			sw_trig->port_rx_traffic[i] = port_stats.rx_bytes;
+		link |= port_bit;
+		switch (port_link.speed) {
+		case SWITCH_PORT_SPEED_UNKNOWN:
+			sw_trig->link_speed[i] = SWCONFIG_LED_PORT_SPEED_NA;
+			break;
+		case SWITCH_PORT_SPEED_10:
+			sw_trig->link_speed[i] = SWCONFIG_LED_PORT_SPEED_10;
+			break;
+		case SWITCH_PORT_SPEED_100:
+			sw_trig->link_speed[i] = SWCONFIG_LED_PORT_SPEED_100;
+			break;
+		case SWITCH_PORT_SPEED_1000:
+			sw_trig->link_speed[i] = SWCONFIG_LED_PORT_SPEED_1000;
+			break;
 		}
 	}
 
 	sw_trig->port_link = link;
+}
+
+static void
+swconfig_led_read_traffic(struct switch_led_trigger *sw_trig, u32 port_mask)
+{
+	struct switch_dev *swdev = sw_trig->swdev;
+	int i;
+
+	if (!swdev->ops->get_port_stats)
+		return;
+
+	for (i = 0; i < SWCONFIG_LED_NUM_PORTS; i++) {
+		struct switch_port_stats port_stats;
+
+		if ((port_mask & BIT(i)) == 0)
+			continue;
+
+		memset(&port_stats, '\0', sizeof(port_stats));
+		swdev->ops->get_port_stats(swdev, i, &port_stats);
+		sw_trig->port_tx_traffic[i] = port_stats.tx_bytes;
+		sw_trig->port_rx_traffic[i] = port_stats.rx_bytes;
+	}
+}
+
+/*
+ * The link state is only read again after switch_port_link_changed() if
+ * the driver reports link changes, the traffic counters only of ports with
+ * a led in tx/rx mode. Without either, there is nothing left to poll.
+ */
+static void
+swconfig_led_work_func(struct work_struct *work)
+{
+	struct switch_led_trigger *sw_trig;
+	struct switch_dev *swdev;
+	u32 port_mask;
+
+	sw_trig = container_of(work, struct switch_led_trigger,
+			       sw_led_work.work);
+
+	port_mask = sw_trig->port_mask;
+	swdev = sw_trig->swdev;
+
+	if (test_and_clear_bit(0, &sw_trig->link_changed) ||
+	    !swdev->link_events)
+		swconfig_led_read_link(sw_trig, port_mask);
+
+	swconfig_led_read_traffic(sw_trig,
+				  sw_trig->traffic_mask & sw_trig->port_link);
 
 	swconfig_trig_update_leds(sw_trig);
 
-	schedule_delayed_work(&sw_trig->sw_led_work,
-			      SWCONFIG_LED_TIMER_INTERVAL);
+	if (sw_trig->traffic_mask || !swdev->link_events)
+		schedule_delayed_work(&sw_trig->sw_led_work,
+				      SWCONFIG_LED_TIMER_INTERVAL);
+}
+
+static void
+swconfig_led_link_changed(struct switch_dev *swdev)
+{
+	struct switch_led_trigger *sw_trig = swdev->led_trigger;
+
+	if (!sw_trig || !sw_trig->port_mask)
+		return;
+
+	set_bit(0, &sw_trig->link_changed);
+	mod_delayed_work(system_wq, &sw_trig->sw_led_work, 0);
 }
 
 static int
@@ -552,4 +600,7 @@ swconfig_create_led_trigger(struct switch_dev *swdev) { return 0; }
 
 static inline void
 swconfig_destroy_led_trigger(struct switch_dev *swdev) { }
+
+static inline void
+swconfig_led_link_changed(struct switch_dev *swdev) { }
 #endif /* CONFIG_SWCONFIG_LEDS */
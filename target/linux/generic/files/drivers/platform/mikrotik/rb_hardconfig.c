@@ -17,6 +17,8 @@
  * MTD partition, although it is technically possible to operate entirely from
  * the MTD device without using a local buffer (except when requesting WLAN
  * calibration data), at the cost of a performance penalty.
+ * The unpacked WLAN calibration data is kept after it is first read, until
+ * it has not been read for a while.
  *
  * Note: PAGE_SIZE is assumed to be >= 4K, hence the device attribute show
  * routines need not check for output overflow.
@@ -36,14 +38,19 @@
 #include <linux/mtd/mtd.h>
 #include <linux/sysfs.h>
 #include <linux/lzo.h>
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
 
 #include "rb_hardconfig.h"
 #include "routerboot.h"
 #include "rb_lz77.h"
 
-#define RB_HARDCONFIG_VER		"0.08"
+#define RB_HARDCONFIG_VER		"0.09"
 #define RB_HC_PR_PFX			"[rb_hardconfig] "
 
+/* Time the unpacked WLAN data is kept after the last read */
+#define RB_HC_WLAN_CACHE_TIMEOUT	(60 * HZ)
+
 /* Bit definitions for hardware options */
 #define RB_HW_OPT_NO_UART		BIT(0)
 #define RB_HW_OPT_HAS_VOLTAGE		BIT(1)
@@ -350,6 +357,8 @@ static struct hc_wlan_attr {
 	struct bin_attribute battr;
 	u16 pld_ofs;
 	u16 pld_len;
+	void *data;		// unpacked payload, protected by hc_wlan_lock
+	size_t data_len;
 } hc_wd_multi_battrs[] = {
 	{
 		.erd_tag_id = RB_WLAN_ERD_ID_MULTI_8001,
@@ -365,6 +374,11 @@ static struct hc_wlan_attr hc_wd_solo_battr = {
 	.battr = __BIN_ATTR(wlan_data, S_IRUSR, hc_wlan_data_bin_read, NULL, 0),
 };
 
+static void hc_wlan_data_release(struct work_struct *work);
+
+static DEFINE_MUTEX(hc_wlan_lock);
+static DECLARE_DELAYED_WORK(hc_wlan_release_work, hc_wlan_data_release);
+
 static ssize_t hc_attr_show(struct kobject *kobj, struct kobj_attribute *attr,
 			    char *buf);
 
@@ -645,11 +659,29 @@ static ssize_t hc_attr_show(struct kobject *kobj, struct kobj_attribute *attr,
 	return hc_attr->tshow(pld, pld_len, buf);
 }
 
+static void hc_wlan_data_free(struct hc_wlan_attr *hc_wattr)
+{
+	kfree(hc_wattr->data);
+	hc_wattr->data = NULL;
+	hc_wattr->data_len = 0;
+}
+
+static void hc_wlan_data_release(struct work_struct *work)
+{
+	int i;
+
+	mutex_lock(&hc_wlan_lock);
+	hc_wlan_data_free(&hc_wd_solo_battr);
+	for (i = 0; i < ARRAY_SIZE(hc_wd_multi_battrs); i++)
+		hc_wlan_data_free(&hc_wd_multi_battrs[i]);
+	mutex_unlock(&hc_wlan_lock);
+}
+
 /*
- * This function will allocate and free memory every time it is called. This
- * is not the fastest way to do this, but since the data is rarely read (mainly
- * at boot time to load wlan caldata), this makes it possible to save memory for
- * the system.
+ * The data is unpacked on the first read and kept for the following ones,
+ * since it is usually read in small chunks. As it is rarely read (mainly at
+ * boot time to load wlan caldata), it is freed again once it has not been
+ * read for RB_HC_WLAN_CACHE_TIMEOUT, to save memory for the system.
  */
 static ssize_t hc_wlan_data_bin_read(struct file *filp, struct kobject *kobj,
 				     struct bin_attribute *attr, char *buf,
@@ -658,7 +690,7 @@ static ssize_t hc_wlan_data_bin_read(struct file *filp, struct kobject *kobj,
 	struct hc_wlan_attr *hc_wattr;
 	size_t outlen;
 	void *outbuf;
-	int ret;
+	ssize_t ret;
 
 	hc_wattr = container_of(attr, typeof(*hc_wattr), battr);
 
@@ -671,28 +703,41 @@ static ssize_t hc_wlan_data_bin_read(struct file *filp, struct kobject *kobj,
 	if (hc_wattr->pld_len > outlen)
 		return -EFBIG;
 
-	outbuf = kmalloc(outlen, GFP_KERNEL);
-	if (!outbuf)
-		return -ENOMEM;
+	mutex_lock(&hc_wlan_lock);
 
-	ret = hc_wlan_data_unpack(hc_wattr->erd_tag_id, hc_wattr->pld_ofs, hc_wattr->pld_len, outbuf, &outlen);
-	if (ret) {
-		kfree(outbuf);
-		return ret;
+	if (!hc_wattr->data) {
+		outbuf = kmalloc(outlen, GFP_KERNEL);
+		if (!outbuf) {
+			ret = -ENOMEM;
+			goto out;
+		}
+
+		ret = hc_wlan_data_unpack(hc_wattr->erd_tag_id, hc_wattr->pld_ofs, hc_wattr->pld_len, outbuf, &outlen);
+		if (ret) {
+			kfree(outbuf);
+			goto out;
+		}
+
+		hc_wattr->data = outbuf;
+		hc_wattr->data_len = outlen;
 	}
 
-	if (off >= outlen) {
-		kfree(outbuf);
-		return 0;
+	mod_delayed_work(system_wq, &hc_wlan_release_work, RB_HC_WLAN_CACHE_TIMEOUT);
+
+	if (off >= hc_wattr->data_len) {
+		ret = 0;
+		goto out;
 	}
 
-	if (off + count > outlen)
-		count = outlen - off;
+	if (off + count > hc_wattr->data_len)
+		count = hc_wattr->data_len - off;
 
-	memcpy(buf, outbuf + off, count);
+	memcpy(buf, hc_wattr->data + off, count);
+	ret = count;
 
-	kfree(outbuf);
-	return count;
+out:
+	mutex_unlock(&hc_wlan_lock);
+	return ret;
 }
 
 int rb_hardconfig_init(struct kobject *rb_kobj, struct mtd_info *mtd)
@@ -839,6 +884,8 @@ void rb_hardconfig_exit(void)
 {
 	kobject_put(hc_kobj);
 	hc_kobj = NULL;
+	cancel_delayed_work_sync(&hc_wlan_release_work);
+	hc_wlan_data_release(NULL);
 	kfree(hc_buf);
 	hc_buf = NULL;
 }
@@ -8,6 +8,9 @@
 #include <linux/string.h>
 #include <linux/errno.h>
 #include <linux/minmax.h>
+#include <linux/bitops.h>
+#include <linux/bitrev.h>
+#include <asm/unaligned.h>
 
 #include "rb_lz77.h"
 
@@ -95,16 +98,46 @@ static inline u8 rb_lz77_get_bit(const u8 *in, const size_t in_offset_bit)
  *
  * @in:			compressed data
  * @in_offset_bit:	bit offset to extract byte
+ *
+ * The byte is stored lsb first, starting at a (likely) unaligned bit.
  */
 static inline u8 rb_lz77_get_byte(const u8 *in, const size_t in_offset_bit)
 {
-	u8 buf = 0;
-	int i;
+	const u8 *p = in + in_offset_bit / BITS_PER_BYTE;
+	const unsigned int shift = in_offset_bit % BITS_PER_BYTE;
+	u8 buf = p[0] >> shift;
+
+	if (shift)
+		buf |= p[1] << (BITS_PER_BYTE - shift);
+
+	return bitrev8(buf);
+}
+
+/**
+ * rb_lz77_peek_bits
+ *
+ * @in:			compressed data
+ * @in_len:		length of compressed data
+ * @in_offset_bit:	bit offset of the first bit
+ *
+ * Returns at least 57 bits starting at in_offset_bit, lsb first.
+ * Bits beyond the end of the input read as 0.
+ */
+static inline u64 rb_lz77_peek_bits(const u8 *in, const size_t in_len,
+				    const size_t in_offset_bit)
+{
+	const size_t pos = in_offset_bit / BITS_PER_BYTE;
+	u64 bits = 0;
+	size_t i;
+
+	if (likely(pos + sizeof(bits) <= in_len)) {
+		bits = get_unaligned_le64(in + pos);
+	} else {
+		for (i = 0; pos + i < in_len && i < sizeof(bits); i++)
+			bits |= (u64)in[pos + i] << (i * BITS_PER_BYTE);
+	}
 
-	/* built a reversed byte from (likely) unaligned bits */
-	for (i = 0; i <= 7; ++i)
-		buf += rb_lz77_get_bit(in, in_offset_bit + i) << (7 - i);
-	return buf;
+	return bits >> (in_offset_bit % BITS_PER_BYTE);
 }
 
 /**
@@ -124,47 +157,42 @@ static int rb_lz77_decode_count(const u8 *in, const size_t in_len,
 				const size_t in_offset_bit, u8 shift,
 				size_t count, u8 *bits_used, const u8 max_bits)
 {
-	size_t pos = in_offset_bit;
-	const size_t max_pos = min(pos + max_bits, in_len * BITS_PER_BYTE);
-	bool up = true;
+	const size_t max_pos = min(in_offset_bit + max_bits,
+				   in_len * BITS_PER_BYTE);
+	const size_t avail = max_pos > in_offset_bit ?
+			     max_pos - in_offset_bit : 0;
+	u64 bits = rb_lz77_peek_bits(in, in_len, in_offset_bit);
+	unsigned int ones, i;
 
 	*bits_used = 0;
 	pr_debug(MIKRO_LZ77
 		 "decode_count inbit: %zu, start shift:%u, initial count:%zu\n",
 		 in_offset_bit, shift, count);
 
-	while (true) {
-		/* check the input offset bit does not overflow the minimum of
-		 * a reasonable length for this encoded count, and
-		 * the end of the input */
-		if (unlikely(pos >= max_pos)) {
-			pr_err(MIKRO_LZ77
-			       "max bit index reached before count completed\n");
-			return -EFBIG;
-		}
+	/*
+	 * A run of set bits, each adding 1 << shift with an increasing
+	 * shift, ended by a clear bit. The remaining shift value is then
+	 * followed by that many bits, msb first.
+	 * Both parts must fit in a reasonable length for this encoded
+	 * count, and within the input.
+	 */
+	ones = ~bits ? __ffs64(~bits) : 64;
+	if (unlikely(ones + 1 + shift + ones > avail)) {
+		pr_err(MIKRO_LZ77
+		       "max bit index reached before count completed\n");
+		return -EFBIG;
+	}
 
-		/* if the bit value at offset is set */
-		if (rb_lz77_get_bit(in, pos))
-			count += (1 << shift);
+	count += (((size_t)1 << ones) - 1) << shift;
+	shift += ones;
+	bits >>= ones + 1;
 
-		/* shift increases until we find an unsed bit */
-		else if (up)
-			up = false;
+	for (i = shift; i > 0; --i, bits >>= 1)
+		if (bits & 1)
+			count += (size_t)1 << (i - 1);
 
-		if (up)
-			++shift;
-		else {
-			if (!shift) {
-				*bits_used = pos - in_offset_bit + 1;
-				return count;
-			}
-			--shift;
-		}
-
-		++pos;
-	}
-
-	return -EINVAL;
+	*bits_used = ones + 1 + shift;
+	return count;
 }
 
 /**
@@ -305,7 +333,8 @@ int rb_lz77_decompress(const u8 *in, const size_t in_len, u8 *out,
 	struct rb_lz77_instr_opcodes *opcode;
 	size_t match_offset = 0;
 	int rc = 0;
-	size_t match_length, partial_count, i;
+	size_t match_length, partial_count, chunk, i;
+	const u8 *match_src;
 
 	output_ptr = out;
 
@@ -364,6 +393,20 @@ int rb_lz77_decompress(const u8 *in, const size_t in_len, u8 *out,
 					rc = 0;
 					goto free_lz77_struct;
 				}
+				if (unlikely(opcode->length >
+					     output_end - output_ptr)) {
+					pr_err(MIKRO_LZ77
+					       "non-match group output overflow\n");
+					rc = -ENOBUFS;
+					goto free_lz77_struct;
+				}
+				if (unlikely(input_bit + opcode->length *
+					     BITS_PER_BYTE > in_len * BITS_PER_BYTE)) {
+					pr_err(MIKRO_LZ77
+					       "non-match group input overrun\n");
+					rc = -ENODATA;
+					goto free_lz77_struct;
+				}
 				for (i = opcode->length; i > 0; --i) {
 					*output_ptr =
 						rb_lz77_get_byte(in, input_bit);
@@ -407,17 +450,20 @@ int rb_lz77_decompress(const u8 *in, const size_t in_len, u8 *out,
 			}
 
 			/* there are cases where the match (length) includes
-			 * data that is a part of the same match
+			 * data that is a part of the same match. The output
+			 * repeats with a period of offset, so each copy can
+			 * source everything written since the match start,
+			 * doubling the chunk size every round.
 			 */
-			while (opcode->offset < match_length) {
+			match_src = output_ptr - opcode->offset;
+			while (output_ptr - match_src < match_length) {
+				chunk = output_ptr - match_src;
 				++partial_count;
-				memcpy(output_ptr, output_ptr - opcode->offset,
-				       opcode->offset);
-				output_ptr += opcode->offset;
-				match_length -= opcode->offset;
+				memcpy(output_ptr, match_src, chunk);
+				output_ptr += chunk;
+				match_length -= chunk;
 			}
-			memcpy(output_ptr, output_ptr - opcode->offset,
-			       match_length);
+			memcpy(output_ptr, match_src, match_length);
 			output_ptr += match_length;
 			if (partial_count)
 				pr_debug(" (%zu partial memcpy)",
@@ -118,6 +118,8 @@ struct switch_dev {
 	unsigned int ports;
 	unsigned int vlans;
 	unsigned int cpu_port;
+	/* driver calls switch_port_link_changed() on port link changes */
+	bool link_events;
 
 	/* the following fields are internal for swconfig */
 	unsigned int id;
@@ -146,6 +148,11 @@ struct switch_portmap {
 	const char *s;
 };
 
+struct switch_arl_entry {
+	u8 mac[ETH_ALEN];
+	u32 portmap;
+};
+
 struct switch_val {
 	const struct switch_attr *attr;
 	unsigned int port_vlan;
@@ -155,6 +162,7 @@ struct switch_val {
 		u32 i;
 		struct switch_port *ports;
 		struct switch_port_link *link;
+		struct switch_arl_entry *arl;
 	} value;
 };
 
@@ -175,5 +183,6 @@ struct switch_attr {
 
 int switch_generic_set_link(struct switch_dev *dev, int port,
 			    struct switch_port_link *link);
+void switch_port_link_changed(struct switch_dev *dev);
 
 #endif /* _LINUX_SWITCH_H */
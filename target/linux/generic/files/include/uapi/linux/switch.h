@@ -54,6 +54,14 @@ enum {
 	SWITCH_ATTR_OP_DESCRIPTION,
 	/* port lists */
 	SWITCH_ATTR_PORT,
+	/* address tables */
+	SWITCH_ATTR_OP_VALUE_ARL,
+	SWITCH_ATTR_ARL,
+	/* batched changes */
+	SWITCH_ATTR_OP_BATCH,
+	SWITCH_ATTR_OP,
+	SWITCH_ATTR_OP_CMD,
+	SWITCH_ATTR_OP_APPLY,
 	SWITCH_ATTR_MAX
 };
 
@@ -78,7 +86,8 @@ enum {
 	SWITCH_CMD_SET_PORT,
 	SWITCH_CMD_LIST_VLAN,
 	SWITCH_CMD_GET_VLAN,
-	SWITCH_CMD_SET_VLAN
+	SWITCH_CMD_SET_VLAN,
+	SWITCH_CMD_SET_BATCH,
 };
 
 /* data types */
@@ -89,6 +98,7 @@ enum switch_val_type {
 	SWITCH_TYPE_PORTS,
 	SWITCH_TYPE_LINK,
 	SWITCH_TYPE_NOVAL,
+	SWITCH_TYPE_ARL,
 };
 
 /* port nested attributes */
@@ -113,6 +123,14 @@ enum {
 	SWITCH_LINK_ATTR_MAX,
 };
 
+/* arl nested attributes */
+enum {
+	SWITCH_ARL_UNSPEC,
+	SWITCH_ARL_MAC,
+	SWITCH_ARL_PORTMAP,
+	SWITCH_ARL_ATTR_MAX
+};
+
 #define SWITCH_ATTR_DEFAULTS_OFFSET	0x1000
 
 
@@ -26,6 +26,7 @@
 #include <linux/ethtool.h>
 #include <linux/phy.h>
 #include <linux/delay.h>
+#include <linux/workqueue.h>
 
 #include <linux/uaccess.h>
 #include <linux/version.h>
@@ -51,10 +52,33 @@ enum {
 	PHY_STATE_FAIL = 3,
 };
 
+/* pbus registers set up on link changes, shadowed in en8801s_priv */
+static const u16 en8801s_shadow_regs[] = {
+	0x1694, 0x10, 0x0, 0x0A14, 0x1404, 0x140c,
+};
+
+struct en8801s_speed_cfg {
+	int speed;
+	u32 reg_10;
+	u32 reg_0a14;
+	u32 reg_0600;
+	u32 reg_1404;
+};
+
+static const struct en8801s_speed_cfg en8801s_speed_cfgs[] = {
+	{ SPEED_1000, 0xD801, 0x0003, 0x0c000c00, 0x004b },
+	{ SPEED_100,  0xD401, 0x0007, 0x0c11,     0x0027 },
+	{ SPEED_10,   0xD001, 0x000b, 0x0c11,     0x0027 },
+};
+
 struct en8801s_priv {
 	bool first_init;
 	u16 count;
 	u16 pro_version;
+	struct phy_device *phydev;
+	struct work_struct link_work;
+	u32 shadow[ARRAY_SIZE(en8801s_shadow_regs)];
+	unsigned long shadow_valid;
 };
 
 /*
@@ -445,6 +469,8 @@ static int en8801s_phase1_init(struct phy_device *phydev)
 	struct device *dev = phydev_dev(phydev);
 	struct en8801s_priv *priv = phydev->priv;
 
+	cancel_work_sync(&priv->link_work);
+	priv->shadow_valid = 0;
 	priv->count = 1;
 	msleep(1000);
 
@@ -574,6 +600,7 @@ static int en8801s_phase2_init(struct phy_device *phydev)
 	struct device *dev = phydev_dev(phydev);
 	struct en8801s_priv *priv = phydev->priv;
 
+	priv->shadow_valid = 0;
 	pbus_data = airoha_pbus_read(mbus, pbus_addr, 0x1690);
 	pbus_data |= BIT(31);
 	ret = airoha_pbus_write(mbus, pbus_addr, 0x1690, pbus_data);
@@ -859,10 +886,7 @@ static int en8801s_phase2_init(struct phy_device *phydev)
 static int en8801s_read_status(struct phy_device *phydev)
 {
 	int ret = 0, preSpeed = phydev->speed;
-	struct mii_bus *mbus = phydev_mdio_bus(phydev);
-	u32 reg_value;
 	struct device *dev = phydev_dev(phydev);
-	int pbus_addr = phydev_pbus_addr(phydev);
 	struct en8801s_priv *priv = phydev->priv;
 
 	ret = genphy_read_status(phydev);
@@ -891,118 +915,129 @@ static int en8801s_read_status(struct phy_device *phydev)
 		priv->count++;
 	}
 
-	if ((preSpeed != phydev->speed) && (phydev->link == LINK_UP)) {
-		preSpeed = phydev->speed;
+	/* the link setup sleeps, keep it out of the phylib poll */
+	if ((preSpeed != phydev->speed) && (phydev->link == LINK_UP))
+		schedule_work(&priv->link_work);
 
-		if (preSpeed == SPEED_10) {
-			reg_value = airoha_pbus_read(mbus, pbus_addr, 0x1694);
-			reg_value |= BIT(31);
-			ret = airoha_pbus_write(mbus, pbus_addr, 0x1694,
-					reg_value);
-			if (ret < 0)
-				return ret;
-			phydev->dev_flags = PHY_STATE_PROCESS;
-		} else {
-			reg_value = airoha_pbus_read(mbus, pbus_addr, 0x1694);
-			reg_value &= ~BIT(31);
-			ret = airoha_pbus_write(mbus, pbus_addr, 0x1694,
-					reg_value);
-			if (ret < 0)
-				return ret;
-			phydev->dev_flags = PHY_STATE_PROCESS;
-		}
+	return ret;
+}
 
-		airoha_pbus_write(mbus, pbus_addr, 0x0600,
-				0x0c000c00);
-		if (preSpeed == SPEED_1000) {
-			dev_dbg(dev, "SPEED_1000\n");
-			ret = airoha_pbus_write(mbus, pbus_addr, 0x10,
-					0xD801);
-			if (ret < 0)
-				return ret;
-			ret = airoha_pbus_write(mbus, pbus_addr, 0x0,
-					0x9140);
-			if (ret < 0)
-				return ret;
+static int en8801s_shadow_idx(unsigned long pbus_address)
+{
+	int i;
 
-			ret = airoha_pbus_write(mbus, pbus_addr, 0x0A14,
-					0x0003);
-			if (ret < 0)
-				return ret;
-			ret = airoha_pbus_write(mbus, pbus_addr, 0x0600,
-					0x0c000c00);
-			if (ret < 0)
-				return ret;
-			mdelay(2);      /* delay 2 ms */
-			ret = airoha_pbus_write(mbus, pbus_addr, 0x1404,
-					0x004b);
-			if (ret < 0)
-				return ret;
-			ret = airoha_pbus_write(mbus, pbus_addr, 0x140c,
-					0x0007);
-			if (ret < 0)
-				return ret;
-		} else if (preSpeed == SPEED_100) {
-			dev_dbg(dev, "SPEED_100\n");
-			ret = airoha_pbus_write(mbus, pbus_addr, 0x10,
-					0xD401);
-			if (ret < 0)
-				return ret;
-			ret = airoha_pbus_write(mbus, pbus_addr, 0x0,
-					0x9140);
-			if (ret < 0)
-				return ret;
+	for (i = 0; i < ARRAY_SIZE(en8801s_shadow_regs); i++)
+		if (en8801s_shadow_regs[i] == pbus_address)
+			return i;
+	return -1;
+}
 
-			ret = airoha_pbus_write(mbus, pbus_addr, 0x0A14,
-					0x0007);
-			if (ret < 0)
-				return ret;
-			ret = airoha_pbus_write(mbus, pbus_addr, 0x0600,
-					0x0c11);
-			if (ret < 0)
-				return ret;
-			mdelay(2);      /* delay 2 ms */
-			ret = airoha_pbus_write(mbus, pbus_addr, 0x1404,
-					0x0027);
-			if (ret < 0)
-				return ret;
-			ret = airoha_pbus_write(mbus, pbus_addr, 0x140c,
-					0x0007);
-			if (ret < 0)
-				return ret;
-		} else if (preSpeed == SPEED_10) {
-			dev_dbg(dev, "SPEED_10\n");
-			ret = airoha_pbus_write(mbus, pbus_addr, 0x10,
-					0xD001);
-			if (ret < 0)
-				return ret;
-			ret = airoha_pbus_write(mbus, pbus_addr, 0x0,
-					0x9140);
-			if (ret < 0)
-				return ret;
+static unsigned long en8801s_shadow_read(struct phy_device *phydev,
+			unsigned long pbus_address)
+{
+	struct en8801s_priv *priv = phydev->priv;
+	int i = en8801s_shadow_idx(pbus_address);
 
-			ret = airoha_pbus_write(mbus, pbus_addr, 0x0A14,
-					0x000b);
-			if (ret < 0)
-				return ret;
-			ret = airoha_pbus_write(mbus, pbus_addr, 0x0600,
-					0x0c11);
-			if (ret < 0)
-				return ret;
-			mdelay(2);      /* delay 2 ms */
-			ret = airoha_pbus_write(mbus, pbus_addr, 0x1404,
-					0x0027);
-			if (ret < 0)
-				return ret;
-			ret = airoha_pbus_write(mbus, pbus_addr, 0x140c,
-					0x0007);
-			if (ret < 0)
-				return ret;
-		}
+	if (i >= 0 && (priv->shadow_valid & BIT(i)))
+		return priv->shadow[i];
+	return airoha_pbus_read(phydev_mdio_bus(phydev),
+				phydev_pbus_addr(phydev), pbus_address);
+}
+
+/* Write a pbus register, skipped if the shadow says it is set already */
+static int en8801s_shadow_write(struct phy_device *phydev,
+			unsigned long pbus_address, unsigned long pbus_data)
+{
+	struct en8801s_priv *priv = phydev->priv;
+	int i = en8801s_shadow_idx(pbus_address);
+	int ret;
+
+	if (i >= 0 && (priv->shadow_valid & BIT(i)) &&
+	    priv->shadow[i] == pbus_data)
+		return 0;
+
+	ret = airoha_pbus_write(phydev_mdio_bus(phydev),
+				phydev_pbus_addr(phydev), pbus_address,
+				pbus_data);
+	if (i < 0)
+		return ret;
+	if (ret < 0) {
+		priv->shadow_valid &= ~BIT(i);
+		return ret;
 	}
+	priv->shadow[i] = pbus_data;
+	priv->shadow_valid |= BIT(i);
 	return ret;
 }
 
+static int en8801s_link_setup(struct phy_device *phydev, int speed)
+{
+	const struct en8801s_speed_cfg *cfg = NULL;
+	struct mii_bus *mbus = phydev_mdio_bus(phydev);
+	int pbus_addr = phydev_pbus_addr(phydev);
+	unsigned long reg_value;
+	int i, ret;
+
+	for (i = 0; i < ARRAY_SIZE(en8801s_speed_cfgs); i++)
+		if (en8801s_speed_cfgs[i].speed == speed)
+			cfg = &en8801s_speed_cfgs[i];
+
+	reg_value = en8801s_shadow_read(phydev, 0x1694);
+	if (speed == SPEED_10)
+		reg_value |= BIT(31);
+	else
+		reg_value &= ~BIT(31);
+	ret = en8801s_shadow_write(phydev, 0x1694, reg_value);
+	if (ret < 0)
+		return ret;
+	phydev->dev_flags = PHY_STATE_PROCESS;
+
+	/* 0x0600 is not shadowed, it is toggled around the speed setup */
+	airoha_pbus_write(mbus, pbus_addr, 0x0600, 0x0c000c00);
+	if (!cfg)
+		return 0;
+
+	dev_dbg(phydev_dev(phydev), "SPEED_%d\n", speed);
+	ret = en8801s_shadow_write(phydev, 0x10, cfg->reg_10);
+	if (ret < 0)
+		return ret;
+	ret = en8801s_shadow_write(phydev, 0x0, 0x9140);
+	if (ret < 0)
+		return ret;
+
+	ret = en8801s_shadow_write(phydev, 0x0A14, cfg->reg_0a14);
+	if (ret < 0)
+		return ret;
+	ret = airoha_pbus_write(mbus, pbus_addr, 0x0600, cfg->reg_0600);
+	if (ret < 0)
+		return ret;
+	usleep_range(2000, 3000);      /* delay 2 ms */
+	ret = en8801s_shadow_write(phydev, 0x1404, cfg->reg_1404);
+	if (ret < 0)
+		return ret;
+	ret = en8801s_shadow_write(phydev, 0x140c, 0x0007);
+	if (ret < 0)
+		return ret;
+	return 0;
+}
+
+static void en8801s_link_work(struct work_struct *work)
+{
+	struct en8801s_priv *priv = container_of(work, struct en8801s_priv,
+						 link_work);
+	struct phy_device *phydev = priv->phydev;
+	int ret;
+
+	mutex_lock(&phydev->lock);
+	if (phydev->link == LINK_UP) {
+		ret = en8801s_link_setup(phydev, phydev->speed);
+		if (ret < 0)
+			dev_err(phydev_dev(phydev),
+				"%s fail. (ret=%d)\n", __func__, ret);
+	}
+	mutex_unlock(&phydev->lock);
+}
+
 static int en8801s_probe(struct phy_device *phydev)
 {
 	struct en8801s_priv *priv;
@@ -1015,6 +1050,8 @@ static int en8801s_probe(struct phy_device *phydev)
 
 	priv->count = 0;
 	priv->first_init = true;
+	priv->phydev = phydev;
+	INIT_WORK(&priv->link_work, en8801s_link_work);
 
 	if (mdiodev->reset_gpio) {
 		dev_dbg(phydev_dev(phydev),
@@ -1028,6 +1065,22 @@ static int en8801s_probe(struct phy_device *phydev)
 	return 0;
 }
 
+static void en8801s_remove(struct phy_device *phydev)
+{
+	struct en8801s_priv *priv = phydev->priv;
+
+	cancel_work_sync(&priv->link_work);
+	kfree(priv);
+}
+
+static int en8801s_suspend(struct phy_device *phydev)
+{
+	struct en8801s_priv *priv = phydev->priv;
+
+	cancel_work_sync(&priv->link_work);
+	return genphy_suspend(phydev);
+}
+
 static int airoha_mmd_read(struct phy_device *phydev,
 			int devad, u16 reg)
 {
@@ -1097,10 +1150,11 @@ static struct phy_driver Airoha_driver[] = {
 		.phy_id_mask    = 0x0ffffff0,
 		.features       = PHY_GBIT_FEATURES,
 		.probe          = en8801s_probe,
+		.remove         = en8801s_remove,
 		.config_init    = en8801s_phase1_init,
 		.config_aneg    = genphy_config_aneg,
 		.read_status    = en8801s_read_status,
-		.suspend        = genphy_suspend,
+		.suspend        = en8801s_suspend,
 		.resume         = genphy_resume,
 		.read_mmd       = airoha_mmd_read,
 		.write_mmd      = airoha_mmd_write,
@@ -48,6 +48,8 @@
 
 rtk_int32 smi_read(rtk_uint32 mAddrs, rtk_uint32 *rData);
 rtk_int32 smi_write(rtk_uint32 mAddrs, rtk_uint32 rData);
+rtk_int32 smi_read_cached(rtk_uint32 mAddrs, rtk_uint32 *rData);
+void smi_cache_invalidate(void);
 
 #endif /* __SMI_H__ */
 
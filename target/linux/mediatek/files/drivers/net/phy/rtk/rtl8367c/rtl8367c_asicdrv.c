@@ -123,7 +123,7 @@ ret_t rtl8367c_setAsicRegBit(rtk_uint32 reg, rtk_uint32 bit, rtk_uint32 value)
     if(bit >= RTL8367C_REGBITLENGTH)
         return RT_ERR_INPUT;
 
-    retVal = smi_read(reg, &regData);
+    retVal = smi_read_cached(reg, &regData);
     if(retVal != RT_ERR_OK)
         return RT_ERR_SMI;
 
@@ -366,7 +366,7 @@ ret_t rtl8367c_setAsicRegBits(rtk_uint32 reg, rtk_uint32 bits, rtk_uint32 value)
     if(valueShifted > RTL8367C_REGDATAMAX)
         return RT_ERR_INPUT;
 
-    retVal = smi_read(reg, &regData);
+    retVal = smi_read_cached(reg, &regData);
     if(retVal != RT_ERR_OK)
         return RT_ERR_SMI;
   #ifdef CONFIG_RTL865X_CLE
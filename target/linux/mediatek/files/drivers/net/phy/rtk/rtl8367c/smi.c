@@ -91,6 +91,59 @@ static void rtlglue_drvMutexUnlock(void)
 }
 
 
+/* Shadow copy of the configuration registers, so that read-modify-write
+ * helpers do not need an SMI read.  Only ranges holding plain software
+ * owned settings (ACL, VLAN, RMA, QoS, port isolation, SVLAN) are cached;
+ * tables behind TABLE_ACCESS, counters, status, interrupt, indirect and
+ * self clearing registers keep going to the chip. */
+#define SMI_CACHE_SIZE      0x1000
+
+typedef struct smi_cache_range_s
+{
+    rtk_uint16 start;
+    rtk_uint16 end;
+} smi_cache_range_t;
+
+static const smi_cache_range_t smi_cache_range[] =
+{
+    { 0x0600, 0x06D7 },     /* ACL templates, actions and ranges */
+    { 0x06DA, 0x06FF },     /* ACL control, skip LOG_CNT_TYPE/RESET_CFG */
+    { 0x0700, 0x0914 },     /* VLAN, RMA, QoS, isolation, trunk */
+    { 0x0916, 0x0916 },     /* HIGHPRI_CFG */
+    { 0x091F, 0x0A36 },     /* egress VLAN, IPMC groups, LUT config, EFID */
+    { 0x0B00, 0x0E86 },     /* SVLAN, IPMC VID */
+    { 0x0E8B, 0x0FFF },     /* SVLAN */
+};
+
+static rtk_uint16 smi_cache[SMI_CACHE_SIZE];
+static rtk_uint32 smi_cache_valid[SMI_CACHE_SIZE / 32];
+
+static rtk_int32 _smi_cacheable(rtk_uint32 mAddrs)
+{
+    rtk_uint32 i;
+
+    if(mAddrs >= SMI_CACHE_SIZE)
+        return 0;
+
+    for(i = 0; i < sizeof(smi_cache_range) / sizeof(smi_cache_range[0]); i++)
+    {
+        if(mAddrs >= smi_cache_range[i].start && mAddrs <= smi_cache_range[i].end)
+            return 1;
+    }
+
+    return 0;
+}
+
+static void _smi_cache_update(rtk_uint32 mAddrs, rtk_uint32 rData)
+{
+    if(!_smi_cacheable(mAddrs))
+        return;
+
+    smi_cache[mAddrs] = (rtk_uint16)rData;
+    smi_cache_valid[mAddrs / 32] |= (1U << (mAddrs % 32));
+}
+
+
 
 #if defined(MDC_MDIO_OPERATION) || defined(SPI_OPERATION)
     /* No local function in MDC/MDIO & SPI mode */
@@ -207,7 +260,7 @@ static void _smi_stop(void)
 
 #endif /* End of #if defined(MDC_MDIO_OPERATION) || defined(SPI_OPERATION) */
 
-rtk_int32 smi_read(rtk_uint32 mAddrs, rtk_uint32 *rData)
+static rtk_int32 _smi_read(rtk_uint32 mAddrs, rtk_uint32 *rData)
 {
 #if (!defined(MDC_MDIO_OPERATION) && !defined(SPI_OPERATION))
     rtk_uint32 rawData=0, ACK;
@@ -323,7 +376,7 @@ rtk_int32 smi_read(rtk_uint32 mAddrs, rtk_uint32 *rData)
 
 
 
-rtk_int32 smi_write(rtk_uint32 mAddrs, rtk_uint32 rData)
+static rtk_int32 _smi_write(rtk_uint32 mAddrs, rtk_uint32 rData)
 {
 #if (!defined(MDC_MDIO_OPERATION) && !defined(SPI_OPERATION))
     rtk_int8 con;
@@ -442,3 +495,49 @@ rtk_int32 smi_write(rtk_uint32 mAddrs, rtk_uint32 rData)
 #endif /* end of #if defined(MDC_MDIO_OPERATION) */
 }
 
+rtk_int32 smi_read(rtk_uint32 mAddrs, rtk_uint32 *rData)
+{
+    rtk_int32 ret;
+
+    ret = _smi_read(mAddrs, rData);
+    if(ret == RT_ERR_OK)
+        _smi_cache_update(mAddrs, *rData);
+
+    return ret;
+}
+
+rtk_int32 smi_write(rtk_uint32 mAddrs, rtk_uint32 rData)
+{
+    rtk_int32 ret;
+
+    ret = _smi_write(mAddrs, rData);
+    if(ret == RT_ERR_OK)
+        _smi_cache_update(mAddrs, rData);
+
+    return ret;
+}
+
+/* Like smi_read(), but served from the shadow copy when the register is
+ * cacheable and has been read or written since the last invalidation. */
+rtk_int32 smi_read_cached(rtk_uint32 mAddrs, rtk_uint32 *rData)
+{
+    if(rData == NULL)
+        return RT_ERR_NULL_POINTER;
+
+    if(_smi_cacheable(mAddrs) && (smi_cache_valid[mAddrs / 32] & (1U << (mAddrs % 32))))
+    {
+        *rData = smi_cache[mAddrs];
+        return RT_ERR_OK;
+    }
+
+    return smi_read(mAddrs, rData);
+}
+
+/* Drop the shadow copy, must be called whenever the chip is reset. */
+void smi_cache_invalidate(void)
+{
+    rtk_uint32 i;
+
+    for(i = 0; i < SMI_CACHE_SIZE / 32; i++)
+        smi_cache_valid[i] = 0;
+}
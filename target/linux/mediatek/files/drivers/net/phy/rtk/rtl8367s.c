@@ -17,6 +17,8 @@
 #include <linux/device.h>
 #include <linux/delay.h>
 #include <linux/skbuff.h>
+#include <linux/jiffies.h>
+#include <linux/mm.h>
 #include <linux/switch.h>
 
 //include from rtl8367c dir
@@ -24,6 +26,15 @@
 #include  "./rtl8367c/include/vlan.h"
 #include  "./rtl8367c/include/stat.h"
 #include  "./rtl8367c/include/port.h"
+#include  "./rtl8367c/include/igmp.h"
+#include  "./rtl8367c/include/rtl8367c_asicdrv_igmp.h"
+#include  "./rtl8367c/include/rate.h"
+#include  "./rtl8367c/include/storm.h"
+#include  "./rtl8367c/include/rtl8367c_asicdrv.h"
+#include  "./rtl8367c/include/trunk.h"
+#include  "./rtl8367c/include/rtl8367c_asicdrv_trunking.h"
+#include  "./rtl8367c/include/l2.h"
+#include  "./rtl8367c/include/rtl8367c_asicdrv_lut.h"
 
 #define RTL8367C_SW_CPU_PORT    6
 
@@ -31,9 +42,17 @@
 #define RTL8367C_NUM_PORTS 7 
 #define RTL8367C_NUM_VIDS  4096   
 
+/* polling the whole LUT takes a while, reuse a dump for this long */
+#define RTL8367C_ARL_CACHE_TIME	HZ
+
 struct rtl8367_priv {
 	struct switch_dev	swdev;
 	bool			global_vlan_enable;
+	bool			igmp_init;
+	bool			igmp_v3;
+	struct switch_arl_entry	*arl;
+	unsigned int		arl_count;
+	unsigned long		arl_jiffies;
 };
 
 struct rtl8367_mib_counter {	
@@ -245,6 +264,209 @@ static int rtl8367c_get_port_link(int port, int *link, int *speed, int *duplex)
 	return 0;
 }
 
+static int rtl8367c_set_port_igmp(int port, int enable, int v3)
+{
+	rtk_port_t phy_port = rtl8367c_sw_to_phy_port(port);
+	rtk_igmp_action_t action = enable ? IGMP_ACTION_ASIC : IGMP_ACTION_FORWARD;
+	rtk_igmp_action_t v3_action = enable && v3 ? IGMP_ACTION_ASIC : IGMP_ACTION_FORWARD;
+
+	if (rtk_igmp_protocol_set(phy_port, PROTOCOL_IGMPv1, action) ||
+	    rtk_igmp_protocol_set(phy_port, PROTOCOL_IGMPv2, action) ||
+	    rtk_igmp_protocol_set(phy_port, PROTOCOL_MLDv1, action) ||
+	    rtk_igmp_protocol_set(phy_port, PROTOCOL_IGMPv3, v3_action) ||
+	    rtk_igmp_protocol_set(phy_port, PROTOCOL_MLDv2, v3_action))
+		return -EINVAL;
+
+	return 0;
+}
+
+static int rtl8367c_get_port_igmp(int port, int *enable)
+{
+	rtk_igmp_action_t action;
+
+	if (rtk_igmp_protocol_get(rtl8367c_sw_to_phy_port(port),
+				  PROTOCOL_IGMPv2, &action))
+		return -EINVAL;
+
+	*enable = action == IGMP_ACTION_ASIC;
+
+	return 0;
+}
+
+static rtk_rate_t rtl8367c_rate_max(int port)
+{
+	if (rtk_switch_isHsgPort(rtl8367c_sw_to_phy_port(port)) == RT_ERR_OK)
+		return RTL8367C_QOS_RATE_INPUT_MAX_HSG;
+
+	return RTL8367C_QOS_RATE_INPUT_MAX;
+}
+
+/* the storm meters are taken from the top of the shared meters */
+static rtk_meter_id_t rtl8367c_storm_meter(int port, rtk_rate_storm_group_t type)
+{
+	return RTK_MAX_METER_ID - (port * STORM_GROUP_END + type);
+}
+
+static int rtl8367c_set_port_storm(int port, rtk_rate_storm_group_t type,
+				   unsigned int pps)
+{
+	rtk_port_t phy_port = rtl8367c_sw_to_phy_port(port);
+	rtk_meter_id_t meter = rtl8367c_storm_meter(port, type);
+
+	if (!pps)
+		return rtk_rate_stormControlPortEnable_set(phy_port, type,
+							   DISABLED) ? -EINVAL : 0;
+
+	if (rtk_rate_shareMeter_set(meter, METER_TYPE_PPS, pps, DISABLED) ||
+	    rtk_rate_stormControlMeterIdx_set(phy_port, type, meter) ||
+	    rtk_rate_stormControlPortEnable_set(phy_port, type, ENABLED))
+		return -EINVAL;
+
+	return 0;
+}
+
+static int rtl8367c_get_port_storm(int port, rtk_rate_storm_group_t type,
+				   int *pps)
+{
+	rtk_port_t phy_port = rtl8367c_sw_to_phy_port(port);
+	rtk_enable_t enable, ifg;
+	rtk_meter_type_t meter_type;
+	rtk_uint32 meter;
+	rtk_rate_t rate;
+
+	if (rtk_rate_stormControlPortEnable_get(phy_port, type, &enable))
+		return -EINVAL;
+
+	*pps = 0;
+	if (enable != ENABLED)
+		return 0;
+
+	if (rtk_rate_stormControlMeterIdx_get(phy_port, type, &meter) ||
+	    rtk_rate_shareMeter_get(meter, &meter_type, &rate, &ifg))
+		return -EINVAL;
+
+	*pps = rate;
+
+	return 0;
+}
+
+/* spread the hash values evenly over the members of a trunk group */
+static int rtl8367c_set_trunk_hash_map(rtk_trunk_group_t group)
+{
+	rtk_trunk_hashVal2Port_t map;
+	rtk_uint32 members, offsets[RTL8367C_TRUNKING_PORTNO];
+	int i, num = 0;
+
+	if (rtl8367c_getAsicTrunkingGroup(group, &members))
+		return -EINVAL;
+
+	for (i = 0; i < RTL8367C_TRUNKING_PORTNO; i++)
+		if (members & BIT(i))
+			offsets[num++] = i;
+
+	/* less than two members leave the group disabled */
+	if (num < 2)
+		return 0;
+
+	for (i = 0; i < RTK_MAX_NUM_OF_TRUNK_HASH_VAL; i++)
+		map.value[i] = offsets[i % num];
+
+	/* groups 0 and 1 share one table, the last configured one wins */
+	if (rtk_trunk_hashMappingTable_set(group, &map))
+		return -EINVAL;
+
+	return 0;
+}
+
+static int rtl8367c_set_port_trunk(int port, int trunk)
+{
+	rtk_port_t phy_port = rtl8367c_sw_to_phy_port(port);
+	rtk_portmask_t pmask;
+	int group, member;
+
+	for (group = TRUNK_GROUP0; group < TRUNK_GROUP_END; group++) {
+		if (rtk_switch_isValidTrunkGrpId(group) != RT_ERR_OK)
+			continue;
+
+		if (rtk_trunk_port_get(group, &pmask))
+			return -EINVAL;
+
+		member = !!RTK_PORTMASK_IS_PORT_SET(pmask, phy_port);
+		if (member == (group + 1 == trunk))
+			continue;
+
+		if (member)
+			RTK_PORTMASK_PORT_CLEAR(pmask, phy_port);
+		else
+			RTK_PORTMASK_PORT_SET(pmask, phy_port);
+
+		if (rtk_trunk_port_set(group, &pmask) ||
+		    rtl8367c_set_trunk_hash_map(group))
+			return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int rtl8367c_get_port_trunk(int port, int *trunk)
+{
+	rtk_port_t phy_port = rtl8367c_sw_to_phy_port(port);
+	rtk_portmask_t pmask;
+	int group;
+
+	*trunk = 0;
+	for (group = TRUNK_GROUP0; group < TRUNK_GROUP_END; group++) {
+		if (rtk_switch_isValidTrunkGrpId(group) != RT_ERR_OK)
+			continue;
+
+		if (rtk_trunk_port_get(group, &pmask))
+			return -EINVAL;
+
+		if (RTK_PORTMASK_IS_PORT_SET(pmask, phy_port)) {
+			*trunk = group + 1;
+			break;
+		}
+	}
+
+	return 0;
+}
+
+static int rtl8367c_phy_to_sw_port(rtk_port_t phy_port)
+{
+	int i;
+
+	for (i = 0; i < RTL8367C_NUM_PORTS; i++)
+		if (rtl8367c_sw_to_phy_port(i) == phy_port)
+			return i;
+
+	return -1;
+}
+
+/* walk the unicast entries of the LUT in a single pass */
+static int rtl8367c_get_arl_entries(struct switch_arl_entry *arl, int max)
+{
+	rtk_l2_ucastAddr_t l2_data;
+	rtk_uint32 address = 0;
+	int port, n = 0;
+
+	while (n < max) {
+		if (rtk_l2_addr_next_get(READMETHOD_NEXT_L2UC, UTP_PORT0,
+					 &address, &l2_data) != RT_ERR_OK)
+			break;
+
+		port = rtl8367c_phy_to_sw_port(l2_data.port);
+		if (port >= 0) {
+			memcpy(arl[n].mac, l2_data.mac.octet, ETH_ALEN);
+			arl[n].portmap = BIT(port);
+			n++;
+		}
+
+		address++;
+	}
+
+	return n;
+}
+
 /*common rtl8367 swconfig entry API*/
 
 static int
@@ -271,6 +493,450 @@ rtl8367_sw_get_vlan_enable(struct switch_dev *dev,
 	return 0;
 }
 
+static int
+rtl8367_sw_set_igmp_snooping(struct switch_dev *dev,
+			     const struct switch_attr *attr,
+			     struct switch_val *val)
+{
+	struct rtl8367_priv *priv = container_of(dev, struct rtl8367_priv, swdev);
+
+	/* the first enable loads the default snooping setup of the ASIC */
+	if (val->value.i && !priv->igmp_init) {
+		if (rtk_igmp_init())
+			return -EINVAL;
+		priv->igmp_init = true;
+		priv->igmp_v3 = false;
+		return 0;
+	}
+
+	if (rtk_igmp_state_set(val->value.i ? ENABLED : DISABLED))
+		return -EINVAL;
+
+	return 0;
+}
+
+static int
+rtl8367_sw_get_igmp_snooping(struct switch_dev *dev,
+			     const struct switch_attr *attr,
+			     struct switch_val *val)
+{
+	rtk_enable_t state;
+
+	if (rtk_igmp_state_get(&state))
+		return -EINVAL;
+
+	val->value.i = state == ENABLED;
+
+	return 0;
+}
+
+static int
+rtl8367_sw_set_igmp_v3(struct switch_dev *dev,
+		       const struct switch_attr *attr,
+		       struct switch_val *val)
+{
+	struct rtl8367_priv *priv = container_of(dev, struct rtl8367_priv, swdev);
+	int port, enable, err;
+
+	priv->igmp_v3 = !!val->value.i;
+
+	for (port = 0; port < RTL8367C_NUM_PORTS; port++) {
+		err = rtl8367c_get_port_igmp(port, &enable);
+		if (!err)
+			err = rtl8367c_set_port_igmp(port, enable, priv->igmp_v3);
+		if (err)
+			return err;
+	}
+
+	return 0;
+}
+
+static int
+rtl8367_sw_get_igmp_v3(struct switch_dev *dev,
+		       const struct switch_attr *attr,
+		       struct switch_val *val)
+{
+	struct rtl8367_priv *priv = container_of(dev, struct rtl8367_priv, swdev);
+
+	val->value.i = priv->igmp_v3;
+
+	return 0;
+}
+
+static int
+rtl8367_sw_set_igmp_fast_leave(struct switch_dev *dev,
+			       const struct switch_attr *attr,
+			       struct switch_val *val)
+{
+	if (rtk_igmp_fastLeave_set(val->value.i ? ENABLED : DISABLED))
+		return -EINVAL;
+
+	return 0;
+}
+
+static int
+rtl8367_sw_get_igmp_fast_leave(struct switch_dev *dev,
+			       const struct switch_attr *attr,
+			       struct switch_val *val)
+{
+	rtk_enable_t state;
+
+	if (rtk_igmp_fastLeave_get(&state))
+		return -EINVAL;
+
+	val->value.i = state == ENABLED;
+
+	return 0;
+}
+
+static int
+rtl8367_sw_get_igmp_groups(struct switch_dev *dev,
+			   const struct switch_attr *attr,
+			   struct switch_val *val)
+{
+	rtk_igmp_groupInfo_t group;
+	static char group_buf[2048];
+	unsigned int member;
+	int i, port, len = 0;
+
+	for (i = 0; i <= RTL8367C_IGMP_MAX_GOUP; i++) {
+		if (rtk_igmp_groupInfo_get(i, &group))
+			return -EINVAL;
+
+		member = rtl8367c_portmask_phy_to_sw(group.member);
+		if (!group.valid || !member)
+			continue;
+
+		/* keep the reply within a single netlink message */
+		if (len > sizeof(group_buf) - 64) {
+			len += snprintf(group_buf + len, sizeof(group_buf) - len,
+					"...\n");
+			break;
+		}
+
+		len += snprintf(group_buf + len, sizeof(group_buf) - len,
+				"Group %d: Ports:", i);
+		for (port = 0; port < RTL8367C_NUM_PORTS; port++) {
+			if (!(member & BIT(port)))
+				continue;
+
+			len += snprintf(group_buf + len, sizeof(group_buf) - len,
+					" %d(%u)", port,
+					group.timer[rtl8367c_sw_to_phy_port(port)]);
+		}
+		len += snprintf(group_buf + len, sizeof(group_buf) - len, "\n");
+	}
+
+	val->value.s = group_buf;
+	val->len = len;
+
+	return 0;
+}
+
+static int
+rtl8367_sw_set_port_igmp_snooping(struct switch_dev *dev,
+				  const struct switch_attr *attr,
+				  struct switch_val *val)
+{
+	struct rtl8367_priv *priv = container_of(dev, struct rtl8367_priv, swdev);
+
+	if (val->port_vlan >= RTL8367C_NUM_PORTS)
+		return -EINVAL;
+
+	return rtl8367c_set_port_igmp(val->port_vlan, val->value.i,
+				      priv->igmp_v3);
+}
+
+static int
+rtl8367_sw_get_port_igmp_snooping(struct switch_dev *dev,
+				  const struct switch_attr *attr,
+				  struct switch_val *val)
+{
+	if (val->port_vlan >= RTL8367C_NUM_PORTS)
+		return -EINVAL;
+
+	return rtl8367c_get_port_igmp(val->port_vlan, &val->value.i);
+}
+
+static int
+rtl8367_sw_set_port_igmp_router(struct switch_dev *dev,
+				const struct switch_attr *attr,
+				struct switch_val *val)
+{
+	rtk_port_t phy_port;
+	rtk_portmask_t pmask;
+
+	if (val->port_vlan >= RTL8367C_NUM_PORTS)
+		return -EINVAL;
+
+	if (rtk_igmp_static_router_port_get(&pmask))
+		return -EINVAL;
+
+	phy_port = rtl8367c_sw_to_phy_port(val->port_vlan);
+	if (val->value.i)
+		RTK_PORTMASK_PORT_SET(pmask, phy_port);
+	else
+		RTK_PORTMASK_PORT_CLEAR(pmask, phy_port);
+
+	if (rtk_igmp_static_router_port_set(&pmask))
+		return -EINVAL;
+
+	return 0;
+}
+
+static int
+rtl8367_sw_get_port_igmp_router(struct switch_dev *dev,
+				const struct switch_attr *attr,
+				struct switch_val *val)
+{
+	rtk_portmask_t pmask;
+
+	if (val->port_vlan >= RTL8367C_NUM_PORTS)
+		return -EINVAL;
+
+	if (rtk_igmp_static_router_port_get(&pmask))
+		return -EINVAL;
+
+	val->value.i = !!RTK_PORTMASK_IS_PORT_SET(pmask,
+			rtl8367c_sw_to_phy_port(val->port_vlan));
+
+	return 0;
+}
+
+static int
+rtl8367_sw_set_port_igmp_max_groups(struct switch_dev *dev,
+				    const struct switch_attr *attr,
+				    struct switch_val *val)
+{
+	if (val->port_vlan >= RTL8367C_NUM_PORTS)
+		return -EINVAL;
+
+	if (rtk_igmp_maxGroup_set(rtl8367c_sw_to_phy_port(val->port_vlan),
+				  val->value.i))
+		return -EINVAL;
+
+	return 0;
+}
+
+static int
+rtl8367_sw_get_port_igmp_max_groups(struct switch_dev *dev,
+				    const struct switch_attr *attr,
+				    struct switch_val *val)
+{
+	rtk_uint32 group;
+
+	if (val->port_vlan >= RTL8367C_NUM_PORTS)
+		return -EINVAL;
+
+	if (rtk_igmp_maxGroup_get(rtl8367c_sw_to_phy_port(val->port_vlan),
+				  &group))
+		return -EINVAL;
+
+	val->value.i = group;
+
+	return 0;
+}
+
+static int
+rtl8367_sw_set_port_ingress_rate(struct switch_dev *dev,
+				 const struct switch_attr *attr,
+				 struct switch_val *val)
+{
+	int port = val->port_vlan;
+	rtk_rate_t rate;
+
+	if (port >= RTL8367C_NUM_PORTS)
+		return -EINVAL;
+
+	rate = val->value.i ? val->value.i : rtl8367c_rate_max(port);
+	if (rtk_rate_igrBandwidthCtrlRate_set(rtl8367c_sw_to_phy_port(port),
+					      rate, DISABLED, DISABLED))
+		return -EINVAL;
+
+	return 0;
+}
+
+static int
+rtl8367_sw_get_port_ingress_rate(struct switch_dev *dev,
+				 const struct switch_attr *attr,
+				 struct switch_val *val)
+{
+	int port = val->port_vlan;
+	rtk_enable_t ifg, fc;
+	rtk_rate_t rate;
+
+	if (port >= RTL8367C_NUM_PORTS)
+		return -EINVAL;
+
+	if (rtk_rate_igrBandwidthCtrlRate_get(rtl8367c_sw_to_phy_port(port),
+					      &rate, &ifg, &fc))
+		return -EINVAL;
+
+	val->value.i = rate >= rtl8367c_rate_max(port) ? 0 : rate;
+
+	return 0;
+}
+
+static int
+rtl8367_sw_set_port_egress_rate(struct switch_dev *dev,
+				const struct switch_attr *attr,
+				struct switch_val *val)
+{
+	int port = val->port_vlan;
+	rtk_rate_t rate;
+
+	if (port >= RTL8367C_NUM_PORTS)
+		return -EINVAL;
+
+	rate = val->value.i ? val->value.i : rtl8367c_rate_max(port);
+	if (rtk_rate_egrBandwidthCtrlRate_set(rtl8367c_sw_to_phy_port(port),
+					      rate, DISABLED))
+		return -EINVAL;
+
+	return 0;
+}
+
+static int
+rtl8367_sw_get_port_egress_rate(struct switch_dev *dev,
+				const struct switch_attr *attr,
+				struct switch_val *val)
+{
+	int port = val->port_vlan;
+	rtk_enable_t ifg;
+	rtk_rate_t rate;
+
+	if (port >= RTL8367C_NUM_PORTS)
+		return -EINVAL;
+
+	if (rtk_rate_egrBandwidthCtrlRate_get(rtl8367c_sw_to_phy_port(port),
+					      &rate, &ifg))
+		return -EINVAL;
+
+	val->value.i = rate >= rtl8367c_rate_max(port) ? 0 : rate;
+
+	return 0;
+}
+
+static rtk_rate_storm_group_t rtl8367_storm_type(const struct switch_attr *attr)
+{
+	return (rtk_rate_storm_group_t)attr->id;
+}
+
+static int
+rtl8367_sw_set_port_storm(struct switch_dev *dev,
+			  const struct switch_attr *attr,
+			  struct switch_val *val)
+{
+	if (val->port_vlan >= RTL8367C_NUM_PORTS)
+		return -EINVAL;
+
+	return rtl8367c_set_port_storm(val->port_vlan, rtl8367_storm_type(attr),
+				       val->value.i);
+}
+
+static int
+rtl8367_sw_get_port_storm(struct switch_dev *dev,
+			  const struct switch_attr *attr,
+			  struct switch_val *val)
+{
+	if (val->port_vlan >= RTL8367C_NUM_PORTS)
+		return -EINVAL;
+
+	return rtl8367c_get_port_storm(val->port_vlan, rtl8367_storm_type(attr),
+				       &val->value.i);
+}
+
+static int
+rtl8367_sw_set_trunk_hash(struct switch_dev *dev,
+			  const struct switch_attr *attr,
+			  struct switch_val *val)
+{
+	if (rtk_trunk_distributionAlgorithm_set(RTK_WHOLE_SYSTEM, val->value.i))
+		return -EINVAL;
+
+	return 0;
+}
+
+static int
+rtl8367_sw_get_trunk_hash(struct switch_dev *dev,
+			  const struct switch_attr *attr,
+			  struct switch_val *val)
+{
+	rtk_uint32 algo;
+
+	if (rtk_trunk_distributionAlgorithm_get(RTK_WHOLE_SYSTEM, &algo))
+		return -EINVAL;
+
+	val->value.i = algo;
+
+	return 0;
+}
+
+static int
+rtl8367_sw_set_port_trunk(struct switch_dev *dev,
+			  const struct switch_attr *attr,
+			  struct switch_val *val)
+{
+	if (val->port_vlan >= RTL8367C_NUM_PORTS)
+		return -EINVAL;
+
+	return rtl8367c_set_port_trunk(val->port_vlan, val->value.i);
+}
+
+static int
+rtl8367_sw_get_port_trunk(struct switch_dev *dev,
+			  const struct switch_attr *attr,
+			  struct switch_val *val)
+{
+	if (val->port_vlan >= RTL8367C_NUM_PORTS)
+		return -EINVAL;
+
+	return rtl8367c_get_port_trunk(val->port_vlan, &val->value.i);
+}
+
+static int
+rtl8367_sw_get_arl_entries(struct switch_dev *dev,
+			   const struct switch_attr *attr,
+			   struct switch_val *val)
+{
+	struct rtl8367_priv *priv = container_of(dev, struct rtl8367_priv, swdev);
+
+	if (!priv->arl) {
+		priv->arl = kvcalloc(RTL8367C_LUT_LEARNLIMITMAX,
+				     sizeof(*priv->arl), GFP_KERNEL);
+		if (!priv->arl)
+			return -ENOMEM;
+		priv->arl_jiffies = jiffies - RTL8367C_ARL_CACHE_TIME - 1;
+	}
+
+	if (time_after(jiffies, priv->arl_jiffies + RTL8367C_ARL_CACHE_TIME)) {
+		priv->arl_count = rtl8367c_get_arl_entries(priv->arl,
+						RTL8367C_LUT_LEARNLIMITMAX);
+		priv->arl_jiffies = jiffies;
+	}
+
+	/* swconfig keeps the device locked until the table is sent */
+	val->value.arl = priv->arl;
+	val->len = priv->arl_count;
+
+	return 0;
+}
+
+static int
+rtl8367_sw_set_flush_arl_table(struct switch_dev *dev,
+			       const struct switch_attr *attr,
+			       struct switch_val *val)
+{
+	struct rtl8367_priv *priv = container_of(dev, struct rtl8367_priv, swdev);
+
+	if (rtk_l2_table_clear())
+		return -EINVAL;
+
+	priv->arl_count = 0;
+
+	return 0;
+}
+
 static int rtl8367_sw_reset_mibs(struct switch_dev *dev,
 				  const struct switch_attr *attr,
 				  struct switch_val *val)
@@ -449,6 +1115,11 @@ static int rtl8367_sw_set_port_pvid(struct switch_dev *dev, int port, int val)
 
 static int rtl8367_sw_reset_switch(struct switch_dev *dev)
 {
+	struct rtl8367_priv *priv = container_of(dev, struct rtl8367_priv, swdev);
+
+	priv->igmp_init = false;
+	priv->igmp_v3 = false;
+
 	if(rtl8367_switch_reset_func)
 		(*rtl8367_switch_reset_func)();
 	else
@@ -503,6 +1174,53 @@ static struct switch_attr rtl8367_globals[] = {
 		.name = "reset_mibs",
 		.description = "Reset all MIB counters",
 		.set = rtl8367_sw_reset_mibs,
+	}, {
+		.type = SWITCH_TYPE_INT,
+		.name = "igmp_snooping",
+		.description = "Enable IGMP/MLD snooping in hardware",
+		.set = rtl8367_sw_set_igmp_snooping,
+		.get = rtl8367_sw_get_igmp_snooping,
+		.max = 1,
+	}, {
+		.type = SWITCH_TYPE_INT,
+		.name = "igmp_v3",
+		.description = "Snoop IGMPv3/MLDv2 on the snooping ports",
+		.set = rtl8367_sw_set_igmp_v3,
+		.get = rtl8367_sw_get_igmp_v3,
+		.max = 1,
+	}, {
+		.type = SWITCH_TYPE_INT,
+		.name = "igmp_fast_leave",
+		.description = "Remove a port from a group on its leave",
+		.set = rtl8367_sw_set_igmp_fast_leave,
+		.get = rtl8367_sw_get_igmp_fast_leave,
+		.max = 1,
+	}, {
+		.type = SWITCH_TYPE_STRING,
+		.name = "igmp_groups",
+		.description = "Get the IGMP/MLD group table",
+		.set = NULL,
+		.get = rtl8367_sw_get_igmp_groups,
+	}, {
+		.type = SWITCH_TYPE_INT,
+		.name = "trunk_hash",
+		.description = "Trunk hash fields bitmask (1: source port, 2: source MAC, "
+			       "4: dest MAC, 8: source IP, 16: dest IP, 32: source L4 port, "
+			       "64: dest L4 port)",
+		.set = rtl8367_sw_set_trunk_hash,
+		.get = rtl8367_sw_get_trunk_hash,
+		.max = 0x7f,
+	}, {
+		.type = SWITCH_TYPE_ARL,
+		.name = "arl_entries",
+		.description = "Get ARL table entries",
+		.set = NULL,
+		.get = rtl8367_sw_get_arl_entries,
+	}, {
+		.type = SWITCH_TYPE_NOVAL,
+		.name = "flush_arl_table",
+		.description = "Flush ARL table",
+		.set = rtl8367_sw_set_flush_arl_table,
 	}
 };
 
@@ -519,6 +1237,80 @@ static struct switch_attr rtl8367_port[] = {
 		//.max = 33,
 		.set = NULL,
 		.get = rtl8367_sw_get_port_mib,
+	}, {
+		.type = SWITCH_TYPE_INT,
+		.name = "igmp_snooping",
+		.description = "Snoop IGMP/MLD on this port in hardware",
+		.set = rtl8367_sw_set_port_igmp_snooping,
+		.get = rtl8367_sw_get_port_igmp_snooping,
+		.max = 1,
+	}, {
+		.type = SWITCH_TYPE_INT,
+		.name = "igmp_router",
+		.description = "Static multicast router port",
+		.set = rtl8367_sw_set_port_igmp_router,
+		.get = rtl8367_sw_get_port_igmp_router,
+		.max = 1,
+	}, {
+		.type = SWITCH_TYPE_INT,
+		.name = "igmp_max_groups",
+		.description = "Maximum number of groups joined on this port",
+		.set = rtl8367_sw_set_port_igmp_max_groups,
+		.get = rtl8367_sw_get_port_igmp_max_groups,
+		.max = RTL8367C_IGMP_MAX_GOUP,
+	}, {
+		.type = SWITCH_TYPE_INT,
+		.name = "ingress_rate",
+		.description = "Ingress rate limit in kbps (0 = unlimited)",
+		.set = rtl8367_sw_set_port_ingress_rate,
+		.get = rtl8367_sw_get_port_ingress_rate,
+		.max = RTL8367C_QOS_RATE_INPUT_MAX_HSG,
+	}, {
+		.type = SWITCH_TYPE_INT,
+		.name = "egress_rate",
+		.description = "Egress rate limit in kbps (0 = unlimited)",
+		.set = rtl8367_sw_set_port_egress_rate,
+		.get = rtl8367_sw_get_port_egress_rate,
+		.max = RTL8367C_QOS_RATE_INPUT_MAX_HSG,
+	}, {
+		.type = SWITCH_TYPE_INT,
+		.name = "storm_broadcast",
+		.description = "Broadcast storm limit in pps (0 = off)",
+		.id = STORM_GROUP_BROADCAST,
+		.set = rtl8367_sw_set_port_storm,
+		.get = rtl8367_sw_get_port_storm,
+		.max = RTL8367C_QOS_PPS_INPUT_MAX,
+	}, {
+		.type = SWITCH_TYPE_INT,
+		.name = "storm_multicast",
+		.description = "Multicast storm limit in pps (0 = off)",
+		.id = STORM_GROUP_MULTICAST,
+		.set = rtl8367_sw_set_port_storm,
+		.get = rtl8367_sw_get_port_storm,
+		.max = RTL8367C_QOS_PPS_INPUT_MAX,
+	}, {
+		.type = SWITCH_TYPE_INT,
+		.name = "storm_unknown_multicast",
+		.description = "Unknown multicast storm limit in pps (0 = off)",
+		.id = STORM_GROUP_UNKNOWN_MULTICAST,
+		.set = rtl8367_sw_set_port_storm,
+		.get = rtl8367_sw_get_port_storm,
+		.max = RTL8367C_QOS_PPS_INPUT_MAX,
+	}, {
+		.type = SWITCH_TYPE_INT,
+		.name = "storm_unknown_unicast",
+		.description = "Unknown unicast storm limit in pps (0 = off)",
+		.id = STORM_GROUP_UNKNOWN_UNICAST,
+		.set = rtl8367_sw_set_port_storm,
+		.get = rtl8367_sw_get_port_storm,
+		.max = RTL8367C_QOS_PPS_INPUT_MAX,
+	}, {
+		.type = SWITCH_TYPE_INT,
+		.name = "trunk",
+		.description = "Trunk group of the port (0 = none)",
+		.set = rtl8367_sw_set_port_trunk,
+		.get = rtl8367_sw_get_port_trunk,
+		.max = TRUNK_GROUP_END,
 	},
 };
 
@@ -25,6 +25,7 @@
 #include  "./rtl8367c/include/port.h"
 #include  "./rtl8367c/include/vlan.h"
 #include  "./rtl8367c/include/rtl8367c_asicdrv_port.h"
+#include  "./rtl8367c/include/smi.h"
 
 struct rtk_gsw {
  	struct device           *dev;
@@ -83,6 +84,8 @@ static int rtl8367s_hw_reset(void)
 
 	mdelay(500);
 
+	smi_cache_invalidate();
+
 	return 0;
 }
 
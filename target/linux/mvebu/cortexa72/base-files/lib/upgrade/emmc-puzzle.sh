@@ -15,22 +15,25 @@ platform_do_upgrade_emmc() {
 	fi
 
 	#iterate over each partition from the image and write it to the boot disk
+	local ranges="0:1:/tmp/image.mbr"
 	while read part start size; do
 		if export_partdevice partdev $part; then
 			if [ "$partdev" = "mmcblk0p2" ]; then
 				v "Writing image mmcblk0p3 for /dev/$partdev  $start $size"
-				get_image_dd "$1" of="/dev/mmcblk0p3" ibs="512" obs=1M skip="$start" count="$size" conv=fsync
+				append ranges "$start:$size:/dev/mmcblk0p3"
 			elif [ "$partdev" = "mmcblk0p1" ]; then
 				v "Writing image mmcblk0p1 for /dev/$partdev $start $size"
-				get_image_dd "$1" of="/dev/$partdev" ibs="512" obs=1M skip="$start" count="$size" conv=fsync
+				append ranges "$start:$size:/dev/$partdev"
 			fi
 		else
 			v "Unable to find partition $part device, skipped."
 		fi
 	done < /tmp/partmap.image
+	get_image_ranges "$1" $ranges
 
 	v "Writing new UUID to /dev/$diskdev..."
-	get_image_dd "$1" of="/dev/$diskdev" bs=1 skip=440 count=4 seek=440 conv=fsync
+	dd if=/tmp/image.mbr of="/dev/$diskdev" bs=1 skip=440 count=4 seek=440 conv=fsync 2>/dev/null
+	rm -f /tmp/image.mbr
 
 	dd if=/dev/zero of=$(find_mmc_part rootfs_data) bs=512 count=8
 
@@ -41,7 +41,7 @@
 #define HSDMA_REG_SCH_Q23		0x284
 
 #define HSDMA_DESCS_MAX			0xfff
-#define HSDMA_DESCS_NUM			8
+#define HSDMA_DESCS_NUM			64
 #define HSDMA_DESCS_MASK		(HSDMA_DESCS_NUM - 1)
 #define HSDMA_NEXT_DESC(x)		(((x) + 1) & HSDMA_DESCS_MASK)
 
@@ -137,6 +137,7 @@ struct mtk_hsdma_sg {
 struct mtk_hsdma_desc {
 	struct virt_dma_desc vdesc;
 	unsigned int num_sgs;
+	bool queued;
 	struct mtk_hsdma_sg sg[1];
 };
 
@@ -148,7 +149,8 @@ struct mtk_hsdma_chan {
 	int rx_idx;
 	struct hsdma_desc *tx_ring;
 	struct hsdma_desc *rx_ring;
-	struct mtk_hsdma_desc *desc;
+	/* rx descs handed to hw, and chunks done of the oldest queued desc */
+	unsigned int rx_used;
 	unsigned int next_sg;
 };
 
@@ -194,6 +196,8 @@ static void mtk_hsdma_reset_chan(struct mtk_hsdam_engine *hsdma,
 {
 	chan->tx_idx = 0;
 	chan->rx_idx = HSDMA_DESCS_NUM - 1;
+	chan->rx_used = 0;
+	chan->next_sg = 0;
 
 	mtk_hsdma_write(hsdma, HSDMA_REG_TX_CTX, chan->tx_idx);
 	mtk_hsdma_write(hsdma, HSDMA_REG_RX_CRX, chan->rx_idx);
@@ -286,7 +290,6 @@ static int mtk_hsdma_terminate_all(struct dma_chan *c)
 	LIST_HEAD(head);
 
 	spin_lock_bh(&chan->vchan.lock);
-	chan->desc = NULL;
 	clear_bit(chan->id, &hsdma->chan_issued);
 	vchan_get_all_descriptors(&chan->vchan, &head);
 	spin_unlock_bh(&chan->vchan.lock);
@@ -306,26 +309,46 @@ static int mtk_hsdma_terminate_all(struct dma_chan *c)
 		cpu_relax();
 	}
 
+	/* drop whatever the aborted descs left in the rx ring */
+	spin_lock_bh(&chan->vchan.lock);
+	chan->rx_idx = (mtk_hsdma_read(hsdma, HSDMA_REG_RX_DRX) - 1) &
+		       HSDMA_DESCS_MASK;
+	chan->rx_used = 0;
+	chan->next_sg = 0;
+	mtk_hsdma_write(hsdma, HSDMA_REG_RX_CRX, chan->rx_idx);
+	spin_unlock_bh(&chan->vchan.lock);
+
 	return 0;
 }
 
+/*
+ * Append one memcpy desc to the rings without kicking the engine, so that
+ * the caller can queue as many descs as fit and write TX_CTX once.
+ */
 static int mtk_hsdma_start_transfer(struct mtk_hsdam_engine *hsdma,
-				    struct mtk_hsdma_chan *chan)
+				    struct mtk_hsdma_chan *chan,
+				    struct mtk_hsdma_desc *desc)
 {
 	dma_addr_t src, dst;
 	size_t len, tlen;
 	struct hsdma_desc *tx_desc, *rx_desc;
 	struct mtk_hsdma_sg *sg;
-	unsigned int i;
+	unsigned int i, tx_free;
 	int rx_idx;
 
-	sg = &chan->desc->sg[0];
+	/* one tx desc carries two chunks, every chunk needs its own rx desc */
+	tx_free = (mtk_hsdma_read(hsdma, HSDMA_REG_TX_DTX) - chan->tx_idx - 1) &
+		  HSDMA_DESCS_MASK;
+	if (DIV_ROUND_UP(desc->num_sgs, 2) > tx_free ||
+	    chan->rx_used + desc->num_sgs > HSDMA_DESCS_NUM - 1)
+		return -ENOSPC;
+
+	sg = &desc->sg[0];
 	len = sg->len;
-	chan->desc->num_sgs = DIV_ROUND_UP(len, HSDMA_MAX_PLEN);
 
 	/* tx desc */
 	src = sg->src_addr;
-	for (i = 0; i < chan->desc->num_sgs; i++) {
+	for (i = 0; i < desc->num_sgs; i++) {
 		tx_desc = &chan->tx_ring[chan->tx_idx];
 
 		if (len > HSDMA_MAX_PLEN)
@@ -353,10 +376,10 @@ static int mtk_hsdma_start_transfer(struct mtk_hsdam_engine *hsdma,
 		tx_desc->flags |= HSDMA_DESC_LS1;
 
 	/* rx desc */
-	rx_idx = HSDMA_NEXT_DESC(chan->rx_idx);
+	rx_idx = (chan->rx_idx + chan->rx_used + 1) & HSDMA_DESCS_MASK;
 	len = sg->len;
 	dst = sg->dst_addr;
-	for (i = 0; i < chan->desc->num_sgs; i++) {
+	for (i = 0; i < desc->num_sgs; i++) {
 		rx_desc = &chan->rx_ring[rx_idx];
 		if (len > HSDMA_MAX_PLEN)
 			tlen = HSDMA_MAX_PLEN;
@@ -373,48 +396,43 @@ static int mtk_hsdma_start_transfer(struct mtk_hsdam_engine *hsdma,
 		rx_idx = HSDMA_NEXT_DESC(rx_idx);
 	}
 
-	/* make sure desc and index all up to date */
-	wmb();
-	mtk_hsdma_write(hsdma, HSDMA_REG_TX_CTX, chan->tx_idx);
+	chan->rx_used += desc->num_sgs;
+	desc->queued = true;
 
 	return 0;
 }
 
-static int gdma_next_desc(struct mtk_hsdma_chan *chan)
-{
-	struct virt_dma_desc *vdesc;
-
-	vdesc = vchan_next_desc(&chan->vchan);
-	if (!vdesc) {
-		chan->desc = NULL;
-		return 0;
-	}
-	chan->desc = to_mtk_hsdma_desc(vdesc);
-	chan->next_sg = 0;
-
-	return 1;
-}
-
+/* retire cnt finished chunks, oldest desc first */
 static void mtk_hsdma_chan_done(struct mtk_hsdam_engine *hsdma,
-				struct mtk_hsdma_chan *chan)
+				struct mtk_hsdma_chan *chan, unsigned int cnt)
 {
 	struct mtk_hsdma_desc *desc;
-	int chan_issued;
+	struct virt_dma_desc *vdesc;
+	unsigned int done;
 
-	chan_issued = 0;
 	spin_lock_bh(&chan->vchan.lock);
-	desc = chan->desc;
-	if (likely(desc)) {
+	chan->rx_used -= min(cnt, chan->rx_used);
+	while (cnt) {
+		vdesc = vchan_next_desc(&chan->vchan);
+		if (unlikely(!vdesc || !to_mtk_hsdma_desc(vdesc)->queued)) {
+			dev_dbg(hsdma->ddev.dev, "no desc to complete\n");
+			chan->next_sg = 0;
+			break;
+		}
+		desc = to_mtk_hsdma_desc(vdesc);
+
+		done = min(cnt, desc->num_sgs - chan->next_sg);
+		chan->next_sg += done;
+		cnt -= done;
 		if (chan->next_sg == desc->num_sgs) {
 			list_del(&desc->vdesc.node);
 			vchan_cookie_complete(&desc->vdesc);
-			chan_issued = gdma_next_desc(chan);
+			chan->next_sg = 0;
 		}
-	} else {
-		dev_dbg(hsdma->ddev.dev, "no desc to complete\n");
 	}
 
-	if (chan_issued)
+	/* ring space was freed, let tx queue the rest */
+	if (vchan_next_desc(&chan->vchan))
 		set_bit(chan->id, &hsdma->chan_issued);
 	spin_unlock_bh(&chan->vchan.lock);
 }
@@ -444,13 +462,9 @@ static void mtk_hsdma_issue_pending(struct dma_chan *c)
 	struct mtk_hsdam_engine *hsdma = mtk_hsdma_chan_get_dev(chan);
 
 	spin_lock_bh(&chan->vchan.lock);
-	if (vchan_issue_pending(&chan->vchan) && !chan->desc) {
-		if (gdma_next_desc(chan)) {
-			set_bit(chan->id, &hsdma->chan_issued);
-			tasklet_schedule(&hsdma->task);
-		} else {
-			dev_dbg(hsdma->ddev.dev, "no desc to issue\n");
-		}
+	if (vchan_issue_pending(&chan->vchan)) {
+		set_bit(chan->id, &hsdma->chan_issued);
+		tasklet_schedule(&hsdma->task);
 	}
 	spin_unlock_bh(&chan->vchan.lock);
 }
@@ -465,6 +479,11 @@ static struct dma_async_tx_descriptor *mtk_hsdma_prep_dma_memcpy(
 	if (len <= 0)
 		return NULL;
 
+	if (DIV_ROUND_UP(len, HSDMA_MAX_PLEN) > HSDMA_DESCS_NUM - 1) {
+		dev_err(c->device->dev, "memcpy len too large %zu\n", len);
+		return NULL;
+	}
+
 	desc = kzalloc(sizeof(*desc), GFP_ATOMIC);
 	if (!desc) {
 		dev_err(c->device->dev, "alloc memcpy decs error\n");
@@ -474,6 +493,7 @@ static struct dma_async_tx_descriptor *mtk_hsdma_prep_dma_memcpy(
 	desc->sg[0].src_addr = src;
 	desc->sg[0].dst_addr = dest;
 	desc->sg[0].len = len;
+	desc->num_sgs = DIV_ROUND_UP(len, HSDMA_MAX_PLEN);
 
 	return vchan_tx_prep(&chan->vchan, &desc->vdesc, flags);
 }
@@ -498,14 +518,33 @@ static void mtk_hsdma_desc_free(struct virt_dma_desc *vdesc)
 static void mtk_hsdma_tx(struct mtk_hsdam_engine *hsdma)
 {
 	struct mtk_hsdma_chan *chan;
+	struct mtk_hsdma_desc *desc;
+	struct virt_dma_desc *vdesc;
+	int queued = 0;
 
-	if (test_and_clear_bit(0, &hsdma->chan_issued)) {
-		chan = &hsdma->chan[0];
-		if (chan->desc)
-			mtk_hsdma_start_transfer(hsdma, chan);
-		else
-			dev_dbg(hsdma->ddev.dev, "chan 0 no desc to issue\n");
+	if (!test_and_clear_bit(0, &hsdma->chan_issued))
+		return;
+
+	chan = &hsdma->chan[0];
+	spin_lock_bh(&chan->vchan.lock);
+	list_for_each_entry(vdesc, &chan->vchan.desc_issued, node) {
+		desc = to_mtk_hsdma_desc(vdesc);
+		if (desc->queued)
+			continue;
+		/* ring full, rx completion will try again */
+		if (mtk_hsdma_start_transfer(hsdma, chan, desc))
+			break;
+		queued++;
 	}
+
+	if (queued) {
+		/* make sure desc and index all up to date */
+		wmb();
+		mtk_hsdma_write(hsdma, HSDMA_REG_TX_CTX, chan->tx_idx);
+	} else {
+		dev_dbg(hsdma->ddev.dev, "chan 0 no desc to issue\n");
+	}
+	spin_unlock_bh(&chan->vchan.lock);
 }
 
 static void mtk_hsdma_rx(struct mtk_hsdam_engine *hsdma)
@@ -521,14 +560,13 @@ static void mtk_hsdma_rx(struct mtk_hsdam_engine *hsdma)
 	if (!cnt)
 		return;
 
-	chan->next_sg += cnt;
 	chan->rx_idx = (chan->rx_idx + cnt) & HSDMA_DESCS_MASK;
 
 	/* update rx crx */
 	wmb();
 	mtk_hsdma_write(hsdma, HSDMA_REG_RX_CRX, chan->rx_idx);
 
-	mtk_hsdma_chan_done(hsdma, chan);
+	mtk_hsdma_chan_done(hsdma, chan, cnt);
 }
 
 static void mtk_hsdma_tasklet(struct tasklet_struct *t)
@@ -13,8 +13,10 @@
 #include <linux/slab.h>
 #include <linux/spinlock.h>
 #include <linux/irq.h>
+#include <linux/ktime.h>
 #include <linux/of_dma.h>
 #include <linux/reset.h>
+#include <linux/seq_file.h>
 #include <linux/of_device.h>
 
 #include "virt-dma.h"
@@ -113,6 +115,12 @@ struct gdma_dmaengine_chan {
 
 	struct gdma_dma_desc *desc;
 	unsigned int next_sg;
+
+	/* segment-to-segment restart latency, protected by vchan.lock */
+	u64 stat_segs;
+	u64 stat_chained;
+	u64 stat_gap_ns;
+	u32 stat_gap_max_ns;
 };
 
 struct gdma_dma_dev {
@@ -422,22 +430,48 @@ static int gdma_next_desc(struct gdma_dmaengine_chan *chan)
 	return 1;
 }
 
-static void gdma_dma_chan_irq(struct gdma_dma_dev *dma_dev,
-			      struct gdma_dmaengine_chan *chan)
+/*
+ * Program the next segment of the current descriptor straight from the
+ * completion interrupt instead of bouncing through the tasklet, so an sg
+ * list or cyclic buffer only pays the interrupt latency between segments.
+ * The channel keeps its slot in dma_dev->cnt while it is being chained.
+ */
+static bool gdma_chain_next_sg(struct gdma_dma_dev *dma_dev,
+			       struct gdma_dmaengine_chan *chan, ktime_t stamp)
+{
+	u32 gap;
+
+	if (gdma_start_transfer(dma_dev, chan))
+		return false;
+
+	gap = ktime_to_ns(ktime_sub(ktime_get(), stamp));
+	chan->stat_chained++;
+	chan->stat_gap_ns += gap;
+	if (gap > chan->stat_gap_max_ns)
+		chan->stat_gap_max_ns = gap;
+
+	return true;
+}
+
+static bool gdma_dma_chan_irq(struct gdma_dma_dev *dma_dev,
+			      struct gdma_dmaengine_chan *chan, ktime_t stamp)
 {
 	struct gdma_dma_desc *desc;
 	unsigned long flags;
+	bool chained = false;
 	int chan_issued;
 
 	chan_issued = 0;
 	spin_lock_irqsave(&chan->vchan.lock, flags);
 	desc = chan->desc;
 	if (desc) {
+		chan->stat_segs++;
 		if (desc->cyclic) {
 			vchan_cyclic_callback(&desc->vdesc);
 			if (chan->next_sg == desc->num_sgs)
 				chan->next_sg = 0;
-			chan_issued = 1;
+			chained = gdma_chain_next_sg(dma_dev, chan, stamp);
+			chan_issued = !chained;
 		} else {
 			desc->residue -= desc->sg[chan->next_sg - 1].len;
 			if (chan->next_sg == desc->num_sgs) {
@@ -445,7 +479,9 @@ static void gdma_dma_chan_irq(struct gdma_dma_dev *dma_dev,
 				vchan_cookie_complete(&desc->vdesc);
 				chan_issued = gdma_next_desc(chan);
 			} else {
-				chan_issued = 1;
+				chained = gdma_chain_next_sg(dma_dev, chan,
+							     stamp);
+				chan_issued = !chained;
 			}
 		}
 	} else {
@@ -455,11 +491,14 @@ static void gdma_dma_chan_irq(struct gdma_dma_dev *dma_dev,
 	if (chan_issued)
 		set_bit(chan->id, &dma_dev->chan_issued);
 	spin_unlock_irqrestore(&chan->vchan.lock, flags);
+
+	return chained;
 }
 
 static irqreturn_t gdma_dma_irq(int irq, void *devid)
 {
 	struct gdma_dma_dev *dma_dev = devid;
+	ktime_t stamp = ktime_get();
 	u32 done, done_reg;
 	unsigned int i;
 
@@ -473,10 +512,9 @@ static irqreturn_t gdma_dma_irq(int irq, void *devid)
 
 	i = 0;
 	while (done) {
-		if (done & 0x1) {
-			gdma_dma_chan_irq(dma_dev, &dma_dev->chan[i]);
+		if ((done & 0x1) &&
+		    !gdma_dma_chan_irq(dma_dev, &dma_dev->chan[i], stamp))
 			atomic_dec(&dma_dev->cnt);
-		}
 		done >>= 1;
 		i++;
 	}
@@ -738,6 +776,38 @@ static void gdma_dma_tasklet(struct tasklet_struct *t)
 	} while (i != last_chan);
 }
 
+#ifdef CONFIG_DEBUG_FS
+static void gdma_dma_dbg_summary_show(struct seq_file *s,
+				      struct dma_device *dd)
+{
+	struct gdma_dma_dev *dma_dev = container_of(dd, struct gdma_dma_dev,
+						    ddev);
+	struct gdma_dmaengine_chan *chan;
+	u64 segs, chained, gap_ns;
+	unsigned long flags;
+	u32 gap_max;
+	unsigned int i;
+
+	for (i = 0; i < dma_dev->data->chancnt; i++) {
+		chan = &dma_dev->chan[i];
+
+		spin_lock_irqsave(&chan->vchan.lock, flags);
+		segs = chan->stat_segs;
+		chained = chan->stat_chained;
+		gap_ns = chan->stat_gap_ns;
+		gap_max = chan->stat_gap_max_ns;
+		spin_unlock_irqrestore(&chan->vchan.lock, flags);
+
+		if (!segs)
+			continue;
+
+		seq_printf(s, " %-13s| segs %llu, chained %llu, gap avg %llu ns, max %u ns\n",
+			   dma_chan_name(&chan->vchan.chan), segs, chained,
+			   chained ? div64_u64(gap_ns, chained) : 0, gap_max);
+	}
+}
+#endif
+
 static void rt305x_gdma_init(struct gdma_dma_dev *dma_dev)
 {
 	u32 gct;
@@ -847,6 +917,9 @@ static int gdma_dma_probe(struct platform_device *pdev)
 	dd->device_terminate_all = gdma_dma_terminate_all;
 	dd->device_tx_status = gdma_dma_tx_status;
 	dd->device_issue_pending = gdma_dma_issue_pending;
+#ifdef CONFIG_DEBUG_FS
+	dd->dbg_summary_show = gdma_dma_dbg_summary_show;
+#endif
 
 	dd->src_addr_widths = BIT(DMA_SLAVE_BUSWIDTH_4_BYTES);
 	dd->dst_addr_widths = BIT(DMA_SLAVE_BUSWIDTH_4_BYTES);
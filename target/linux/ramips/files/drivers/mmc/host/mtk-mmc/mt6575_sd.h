@@ -945,6 +945,7 @@ struct msdc_host {
 	u8                          suspend;        /* host suspended ? */
 	u8                          app_cmd;        /* for app command */
 	u32                         app_cmd_arg;
+	u32                         autocmd;        /* auto cmd sent with the data cmd */
 };
 
 #define sdr_read8(reg)            readb(reg)
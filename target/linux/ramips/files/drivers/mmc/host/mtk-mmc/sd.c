@@ -41,6 +41,7 @@
 #include <linux/interrupt.h>
 #include <linux/of.h>
 
+#include <linux/mmc/card.h>
 #include <linux/mmc/host.h>
 #include <linux/mmc/mmc.h>
 #include <linux/mmc/sd.h>
@@ -100,6 +101,10 @@
 #define MAX_SGMT_SZ         (MAX_DMA_CNT)
 #define MAX_REQ_SZ          (MAX_SGMT_SZ * 8)
 
+/* mmc_data.host_cookie */
+#define MSDC_PREPARE_FLAG   BIT(0)  /* sg list is dma mapped */
+#define MSDC_ASYNC_FLAG     BIT(1)  /* mapped by pre_req, unmapped by post_req */
+
 static int cd_active_low = 1;
 
 //=================================
@@ -839,6 +844,10 @@ static unsigned int msdc_command_start(struct msdc_host   *host,
 		rawcmd &= ~(0x0FFF << 16);
 	}
 
+	/* let the controller send CMD23 with SDC_BLK_NUM ahead of the data */
+	if (host->autocmd == MSDC_AUTOCMD23 && mmc_op_multi(opcode))
+		rawcmd |= MSDC_AUTOCMD23 << 28;
+
 	N_MSG(CMD, "CMD<%d><0x%.8x> Arg<0x%.8x>", opcode, rawcmd, cmd->arg);
 
 	tmo = jiffies + timeout;
@@ -1137,6 +1146,72 @@ static void msdc_dma_setup(struct msdc_host *host, struct msdc_dma *dma,
 	msdc_dma_config(host, dma);
 }
 
+static void msdc_prepare_data(struct msdc_host *host, struct mmc_data *data)
+{
+	if (data->host_cookie & MSDC_PREPARE_FLAG)
+		return;
+
+	data->sg_count = dma_map_sg(mmc_dev(host->mmc), data->sg, data->sg_len,
+				    mmc_get_dma_dir(data));
+	data->host_cookie |= MSDC_PREPARE_FLAG;
+}
+
+static void msdc_unprepare_data(struct msdc_host *host, struct mmc_data *data)
+{
+	if (data->host_cookie & MSDC_ASYNC_FLAG)
+		return;
+
+	if (data->host_cookie & MSDC_PREPARE_FLAG) {
+		dma_unmap_sg(mmc_dev(host->mmc), data->sg, data->sg_len,
+			     mmc_get_dma_dir(data));
+		data->host_cookie &= ~MSDC_PREPARE_FLAG;
+	}
+}
+
+/*
+ * Multi-block transfers with a CMD23 from the block layer: eMMC gets it
+ * sent by the controller as auto CMD23, anything else gets it sent by
+ * hand. Either way no CMD12 is needed once the data is in.
+ */
+static int msdc_send_sbc(struct mmc_host *mmc, struct mmc_request *mrq)
+	__must_hold(&host->lock)
+{
+	struct msdc_host *host = mmc_priv(mmc);
+
+	if (!mrq->sbc || !mmc_op_multi(mrq->cmd->opcode))
+		return 0;
+
+	if (mmc->card && mmc_card_mmc(mmc->card) &&
+	    !(mrq->sbc->arg & 0xFFFF0000)) {
+		host->autocmd = MSDC_AUTOCMD23;
+		mrq->sbc->error = 0;
+		return 0;
+	}
+
+	return msdc_do_command(host, mrq->sbc, 0, CMD_TIMEOUT);
+}
+
+static void msdc_auto_cmd_done(struct msdc_host *host, u32 intsts,
+			       struct mmc_command *cmd)
+{
+	void __iomem *base = host->base;
+
+	cmd->resp[0] = sdr_read32(SDC_ACMD_RESP);
+	if (intsts & MSDC_INT_ACMDRDY) {
+		cmd->error = 0;
+		return;
+	}
+
+	msdc_reset_hw(host);
+	if (intsts & MSDC_INT_ACMDCRCERR) {
+		IRQ_MSG("XXX CMD<%d> MSDC_INT_ACMDCRCERR", cmd->opcode);
+		cmd->error = -EIO;
+	} else {
+		IRQ_MSG("XXX CMD<%d> MSDC_INT_ACMDTMO", cmd->opcode);
+		cmd->error = -ETIMEDOUT;
+	}
+}
+
 static int msdc_do_request(struct mmc_host *mmc, struct mmc_request *mrq)
 	__must_hold(&host->lock)
 {
@@ -1173,6 +1248,9 @@ static int msdc_do_request(struct mmc_host *mmc, struct mmc_request *mrq)
 		BUG_ON(data->blksz > HOST_MAX_BLKSZ);
 		send_type = SND_DAT;
 
+		if (msdc_send_sbc(mmc, mrq) != 0)
+			goto done;
+
 		data->error = 0;
 		read = data->flags & MMC_DATA_READ ? 1 : 0;
 		host->data = data;
@@ -1196,9 +1274,7 @@ static int msdc_do_request(struct mmc_host *mmc, struct mmc_request *mrq)
 		if (msdc_command_start(host, cmd, 1, CMD_TIMEOUT) != 0)
 			goto done;
 
-		data->sg_count = dma_map_sg(mmc_dev(mmc), data->sg,
-					    data->sg_len,
-					    mmc_get_dma_dir(data));
+		msdc_prepare_data(host, data);
 		msdc_dma_setup(host, &host->dma, data->sg,
 			       data->sg_count);
 
@@ -1227,8 +1303,8 @@ static int msdc_do_request(struct mmc_host *mmc, struct mmc_request *mrq)
 		spin_lock(&host->lock);
 		msdc_dma_stop(host);
 
-		/* Last: stop transfer */
-		if (data->stop) {
+		/* Last: stop transfer, not needed after a good CMD23 */
+		if (data->stop && (!mrq->sbc || data->error)) {
 			if (msdc_do_command(host, data->stop, 0, CMD_TIMEOUT) != 0)
 				goto done;
 		}
@@ -1237,8 +1313,8 @@ static int msdc_do_request(struct mmc_host *mmc, struct mmc_request *mrq)
 done:
 	if (data != NULL) {
 		host->data = NULL;
-		dma_unmap_sg(mmc_dev(mmc), data->sg, data->sg_len,
-			     mmc_get_dma_dir(data));
+		host->autocmd = 0;
+		msdc_unprepare_data(host, data);
 		host->blksz = 0;
 
 #if 0 // don't stop twice!
@@ -1283,6 +1359,8 @@ done:
 		host->error |= 0x010;
 	if (mrq->stop && mrq->stop->error)
 		host->error |= 0x100;
+	if (mrq->sbc && mrq->sbc->error)
+		host->error |= 0x1000;
 
 	//if (host->error) ERR_MSG("host->error<%d>", host->error);
 
@@ -1718,6 +1796,35 @@ static void msdc_ops_request(struct mmc_host *mmc, struct mmc_request *mrq)
 	return;
 }
 
+/* ops.pre_req: map the next request while the current one is running */
+static void msdc_ops_pre_req(struct mmc_host *mmc, struct mmc_request *mrq)
+{
+	struct msdc_host *host = mmc_priv(mmc);
+	struct mmc_data *data = mrq->data;
+
+	if (!data)
+		return;
+
+	msdc_prepare_data(host, data);
+	data->host_cookie |= MSDC_ASYNC_FLAG;
+}
+
+/* ops.post_req */
+static void msdc_ops_post_req(struct mmc_host *mmc, struct mmc_request *mrq,
+			      int err)
+{
+	struct msdc_host *host = mmc_priv(mmc);
+	struct mmc_data *data = mrq->data;
+
+	if (!data)
+		return;
+
+	if (data->host_cookie) {
+		data->host_cookie &= ~MSDC_ASYNC_FLAG;
+		msdc_unprepare_data(host, data);
+	}
+}
+
 /* called by ops.set_ios */
 static void msdc_set_buswidth(struct msdc_host *host, u32 width)
 {
@@ -1875,6 +1982,8 @@ static int msdc_ops_get_cd(struct mmc_host *mmc)
 
 static struct mmc_host_ops mt_msdc_ops = {
 	.request         = msdc_ops_request,
+	.pre_req         = msdc_ops_pre_req,
+	.post_req        = msdc_ops_post_req,
 	.set_ios         = msdc_ops_set_ios,
 	.get_ro          = msdc_ops_get_ro,
 	.get_cd          = msdc_ops_get_cd,
@@ -1942,6 +2051,20 @@ static irqreturn_t msdc_irq(int irq, void *dev_id)
 		}
 	}
 
+	/* auto CMD23 finishes ahead of the command it was sent for */
+	if ((cmd != NULL) && (host->autocmd == MSDC_AUTOCMD23) &&
+	    (intsts & (MSDC_INT_ACMDRDY | MSDC_INT_ACMDCRCERR | MSDC_INT_ACMDTMO))) {
+		struct mmc_command *sbc = host->mrq->sbc;
+
+		msdc_auto_cmd_done(host, intsts, sbc);
+		intsts &= ~(MSDC_INT_ACMDRDY | MSDC_INT_ACMDCRCERR | MSDC_INT_ACMDTMO);
+		if (sbc->error) {
+			cmd->error = sbc->error;
+			intsts &= ~cmdsts;
+			complete(&host->cmd_done);
+		}
+	}
+
 	/* command interrupts */
 	if ((cmd != NULL) && (intsts & cmdsts)) {
 		if ((intsts & MSDC_INT_CMDRDY) || (intsts & MSDC_INT_ACMDRDY) ||
@@ -2242,6 +2365,7 @@ static int msdc_drv_probe(struct platform_device *pdev)
 
 	//TODO: read this as bus-width from dt (via mmc_of_parse)
 	mmc->caps  |= MMC_CAP_4_BIT_DATA;
+	mmc->caps  |= MMC_CAP_CMD23;
 
 	cd_active_low = !of_property_read_bool(pdev->dev.of_node, "cd-inverted");
 
@@ -10,6 +10,10 @@
 #include <linux/io.h>
 #include <linux/clk.h>
 #include <linux/init.h>
+#include <linux/ktime.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/dma-mapping.h>
 #include <linux/errno.h>
 #include <linux/sizes.h>
 #include <linux/iopoll.h>
@@ -30,7 +34,9 @@
 #define   CNFG_AUTO_FMT_EN		BIT(9)
 #define   CNFG_HW_ECC_EN		BIT(8)
 #define   CNFG_BYTE_RW			BIT(6)
+#define   CNFG_DMA_BURST_EN		BIT(2)
 #define   CNFG_READ_MODE		BIT(1)
+#define   CNFG_AHB			BIT(0)
 
 #define NFI_PAGEFMT			0x004
 #define   PAGEFMT_FDM_ECC_S		12
@@ -75,6 +81,10 @@
 #define   ACCCON_RLT_DEF		15
 #define   ACCCON_RLT_MIN		3
 
+#define NFI_INTR_EN			0x010
+#define NFI_INTR_STA			0x014
+#define   INTR_AHB_DONE			BIT(6)
+
 #define NFI_CMD				0x020
 
 #define NFI_ADDRNOB			0x030
@@ -114,6 +124,10 @@
 #define   SEC_ADDR_S			0
 #define   SEC_ADDR_M			GENMASK(9, 0)
 
+#define NFI_STRADDR			0x080
+
+#define NFI_BYTELEN			0x084
+
 #define NFI_CSEL			0x090
 #define   CSEL_S			0
 #define   CSEL_M			GENMASK(1, 0)
@@ -209,6 +223,18 @@
 
 #define MT7621_NFC_NAME			"mt7621-nand"
 
+enum mt7621_nfc_xfer_mode {
+	NFC_XFER_PIO,
+	NFC_XFER_DMA,
+	__NFC_XFER_MAX
+};
+
+struct mt7621_nfc_xfer_stats {
+	u64 pages;
+	u64 bytes;
+	u64 ns;
+};
+
 struct mt7621_nfc {
 	struct nand_controller controller;
 	struct nand_chip nand;
@@ -220,6 +246,11 @@ struct mt7621_nfc {
 	void __iomem *ecc_regs;
 
 	u32 spare_per_sector;
+
+	bool use_dma;
+	struct dentry *debugfs_dir;
+	struct mt7621_nfc_xfer_stats read_stats[__NFC_XFER_MAX];
+	struct mt7621_nfc_xfer_stats write_stats[__NFC_XFER_MAX];
 };
 
 static const u16 mt7621_nfi_page_size[] = { SZ_512, SZ_2K, SZ_4K };
@@ -623,6 +654,65 @@ static void mt7621_nfc_write_data_empty(struct mt7621_nfc *nfc, u32 len)
 	}
 }
 
+static int mt7621_nfc_dma_map(struct mt7621_nfc *nfc, const void *buf,
+			      u32 len, enum dma_data_direction dir,
+			      dma_addr_t *addr)
+{
+	/*
+	 * Buffers which can not be mapped safely on this non-coherent
+	 * platform are left to PIO
+	 */
+	if (!nfc->use_dma || !buf || !virt_addr_valid(buf) ||
+	    !IS_ALIGNED((uintptr_t)buf, ARCH_DMA_MINALIGN))
+		return -EINVAL;
+
+	*addr = dma_map_single(nfc->dev, (void *)buf, len, dir);
+	if (dma_mapping_error(nfc->dev, *addr))
+		return -ENOMEM;
+
+	return 0;
+}
+
+static void mt7621_nfc_dma_start(struct mt7621_nfc *nfc, dma_addr_t addr)
+{
+	nfi_write32(nfc, NFI_STRADDR, addr);
+	nfi_write16(nfc, NFI_INTR_EN, INTR_AHB_DONE);
+	nfi_write16(nfc, NFI_STRDATA, STR_DATA);
+}
+
+static int mt7621_nfc_dma_wait_read(struct mt7621_nfc *nfc,
+				    struct nand_chip *nand)
+{
+	struct device *dev = nfc->dev;
+	u32 val;
+	int ret;
+
+	ret = readw_poll_timeout_atomic(nfc->nfi_regs + NFI_INTR_STA, val,
+					val & INTR_AHB_DONE, 10,
+					NFI_CORE_TIMEOUT);
+	if (!ret)
+		ret = readl_poll_timeout_atomic(nfc->nfi_regs + NFI_BYTELEN,
+			val, ((val & SEC_CNTR_M) >> SEC_CNTR_S) >=
+			nand->ecc.steps, 10, NFI_CORE_TIMEOUT);
+
+	nfi_write16(nfc, NFI_INTR_EN, 0);
+
+	if (ret) {
+		dev_warn(dev, "NFI core DMA read timed out\n");
+		return -ETIMEDOUT;
+	}
+
+	return 0;
+}
+
+static void mt7621_nfc_account(struct mt7621_nfc_xfer_stats *stats, u32 len,
+			       u64 start)
+{
+	stats->pages++;
+	stats->bytes += len;
+	stats->ns += ktime_get_ns() - start;
+}
+
 static int mt7621_nfc_dev_ready(struct mt7621_nfc *nfc,
 				unsigned int timeout_ms)
 {
@@ -1007,23 +1097,41 @@ static int mt7621_nfc_read_page_hwecc(struct nand_chip *nand, uint8_t *buf,
 	struct mt7621_nfc *nfc = nand_get_controller_data(nand);
 	struct mtd_info *mtd = nand_to_mtd(nand);
 	int bitflips = 0, ret = 0;
+	u64 start = ktime_get_ns();
+	dma_addr_t dma_addr;
+	bool dma;
+	u16 cnfg;
 	int rc, i;
 
+	dma = !mt7621_nfc_dma_map(nfc, buf, mtd->writesize, DMA_FROM_DEVICE,
+				  &dma_addr);
+
 	nand_read_page_op(nand, page, 0, NULL, 0);
 
-	nfi_write16(nfc, NFI_CNFG, (CNFG_OP_CUSTOM << CNFG_OP_MODE_S) |
-		    CNFG_READ_MODE | CNFG_AUTO_FMT_EN | CNFG_HW_ECC_EN);
+	cnfg = (CNFG_OP_CUSTOM << CNFG_OP_MODE_S) | CNFG_READ_MODE |
+	       CNFG_AUTO_FMT_EN | CNFG_HW_ECC_EN;
+	if (dma)
+		cnfg |= CNFG_AHB | CNFG_DMA_BURST_EN;
+
+	nfi_write16(nfc, NFI_CNFG, cnfg);
 
 	mt7621_ecc_decoder_op(nfc, true);
 
 	nfi_write16(nfc, NFI_CON,
 		    CON_NFI_BRD | (nand->ecc.steps << CON_NFI_SEC_S));
 
+	if (dma) {
+		mt7621_nfc_dma_start(nfc, dma_addr);
+		ret = mt7621_nfc_dma_wait_read(nfc, nand);
+		dma_unmap_single(nfc->dev, dma_addr, mtd->writesize,
+				 DMA_FROM_DEVICE);
+	}
+
 	for (i = 0; i < nand->ecc.steps; i++) {
-		if (buf)
+		if (!dma && buf)
 			mt7621_nfc_read_data(nfc, page_data_ptr(nand, buf, i),
 					     nand->ecc.size);
-		else
+		else if (!dma)
 			mt7621_nfc_read_data_discard(nfc, nand->ecc.size);
 
 		rc = mt7621_ecc_decoder_wait_done(nfc, i);
@@ -1059,6 +1167,10 @@ static int mt7621_nfc_read_page_hwecc(struct nand_chip *nand, uint8_t *buf,
 	if (ret < 0)
 		return ret;
 
+	if (buf)
+		mt7621_nfc_account(&nfc->read_stats[dma], mtd->writesize,
+				   start);
+
 	return bitflips;
 }
 
@@ -1135,6 +1247,11 @@ static int mt7621_nfc_write_page_hwecc(struct nand_chip *nand,
 {
 	struct mt7621_nfc *nfc = nand_get_controller_data(nand);
 	struct mtd_info *mtd = nand_to_mtd(nand);
+	dma_addr_t dma_addr;
+	u64 start;
+	bool dma;
+	u16 cnfg;
+	int ret;
 
 	if (mt7621_nfc_check_empty_page(nand, buf)) {
 		/*
@@ -1149,10 +1266,18 @@ static int mt7621_nfc_write_page_hwecc(struct nand_chip *nand,
 		return 0;
 	}
 
+	start = ktime_get_ns();
+	dma = !mt7621_nfc_dma_map(nfc, buf, mtd->writesize, DMA_TO_DEVICE,
+				  &dma_addr);
+
 	nand_prog_page_begin_op(nand, page, 0, NULL, 0);
 
-	nfi_write16(nfc, NFI_CNFG, (CNFG_OP_CUSTOM << CNFG_OP_MODE_S) |
-		   CNFG_AUTO_FMT_EN | CNFG_HW_ECC_EN);
+	cnfg = (CNFG_OP_CUSTOM << CNFG_OP_MODE_S) | CNFG_AUTO_FMT_EN |
+	       CNFG_HW_ECC_EN;
+	if (dma)
+		cnfg |= CNFG_AHB | CNFG_DMA_BURST_EN;
+
+	nfi_write16(nfc, NFI_CNFG, cnfg);
 
 	mt7621_ecc_encoder_op(nfc, true);
 
@@ -1161,18 +1286,32 @@ static int mt7621_nfc_write_page_hwecc(struct nand_chip *nand,
 	nfi_write16(nfc, NFI_CON,
 		    CON_NFI_BWR | (nand->ecc.steps << CON_NFI_SEC_S));
 
-	if (buf)
+	if (dma)
+		mt7621_nfc_dma_start(nfc, dma_addr);
+	else if (buf)
 		mt7621_nfc_write_data(nfc, buf, mtd->writesize);
 	else
 		mt7621_nfc_write_data_empty(nfc, mtd->writesize);
 
 	mt7621_nfc_wait_write_completion(nfc, nand);
 
+	if (dma) {
+		nfi_write16(nfc, NFI_INTR_EN, 0);
+		dma_unmap_single(nfc->dev, dma_addr, mtd->writesize,
+				 DMA_TO_DEVICE);
+	}
+
 	mt7621_ecc_encoder_op(nfc, false);
 
 	nfi_write16(nfc, NFI_CON, 0);
 
-	return nand_prog_page_end_op(nand);
+	ret = nand_prog_page_end_op(nand);
+
+	if (!ret && buf)
+		mt7621_nfc_account(&nfc->write_stats[dma], mtd->writesize,
+				   start);
+
+	return ret;
 }
 
 static int mt7621_nfc_write_page_raw(struct nand_chip *nand,
@@ -1271,6 +1410,42 @@ static int mt7621_nfc_init_chip(struct mt7621_nfc *nfc)
 	return 0;
 }
 
+static void mt7621_nfc_show_stats(struct seq_file *m, const char *name,
+				  const struct mt7621_nfc_xfer_stats *stats)
+{
+	u64 kbps = 0;
+
+	if (stats->ns)
+		kbps = div64_u64(stats->bytes * 1000000ULL, stats->ns) *
+		       1000 / 1024;
+
+	seq_printf(m, "%-10s %10llu %14llu %14llu %10llu\n", name,
+		   stats->pages, stats->bytes, stats->ns, kbps);
+}
+
+static int mt7621_nfc_stats_show(struct seq_file *m, void *data)
+{
+	struct mt7621_nfc *nfc = m->private;
+
+	seq_printf(m, "%-10s %10s %14s %14s %10s\n", "mode", "pages",
+		   "bytes", "ns", "KiB/s");
+	mt7621_nfc_show_stats(m, "read-pio", &nfc->read_stats[NFC_XFER_PIO]);
+	mt7621_nfc_show_stats(m, "read-dma", &nfc->read_stats[NFC_XFER_DMA]);
+	mt7621_nfc_show_stats(m, "write-pio", &nfc->write_stats[NFC_XFER_PIO]);
+	mt7621_nfc_show_stats(m, "write-dma", &nfc->write_stats[NFC_XFER_DMA]);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(mt7621_nfc_stats);
+
+static void mt7621_nfc_debugfs_init(struct mt7621_nfc *nfc)
+{
+	nfc->debugfs_dir = debugfs_create_dir(MT7621_NFC_NAME, NULL);
+	debugfs_create_bool("use_dma", 0600, nfc->debugfs_dir, &nfc->use_dma);
+	debugfs_create_file("stats", 0400, nfc->debugfs_dir, nfc,
+			    &mt7621_nfc_stats_fops);
+}
+
 static int mt7621_nfc_probe(struct platform_device *pdev)
 {
 	struct device *dev = &pdev->dev;
@@ -1303,12 +1478,18 @@ static int mt7621_nfc_probe(struct platform_device *pdev)
 	if (!nfc->nfi_clk)
 		dev_warn(dev, "nfi clk not provided\n");
 
+	nfc->use_dma = !dma_set_mask_and_coherent(dev, DMA_BIT_MASK(32));
+	if (!nfc->use_dma)
+		dev_warn(dev, "DMA not available, using PIO\n");
+
 	platform_set_drvdata(pdev, nfc);
 
 	ret = mt7621_nfc_init_chip(nfc);
 	if (ret)
 		return dev_err_probe(dev, ret, "Failed to initialize nand chip\n");
 
+	mt7621_nfc_debugfs_init(nfc);
+
 	return 0;
 }
 
@@ -1318,6 +1499,7 @@ static int mt7621_nfc_remove(struct platform_device *pdev)
 	struct nand_chip *nand = &nfc->nand;
 	struct mtd_info *mtd = nand_to_mtd(nand);
 
+	debugfs_remove_recursive(nfc->debugfs_dir);
 	mtk_bmt_detach(mtd);
 	mtd_device_unregister(mtd);
 	nand_cleanup(nand);
@@ -19,6 +19,7 @@
 #include <asm/mach-ralink/ralink_regs.h>
 #include <linux/of_device.h>
 #include <linux/of_irq.h>
+#include <linux/workqueue.h>
 
 #include <linux/switch.h>
 #include <linux/reset.h>
@@ -177,6 +178,9 @@
 #define RT5350_ESW_REG_PXTPC(_x)	(0x150 + (4 * _x))
 #define RT5350_EWS_REG_LED_CONTROL	0x168
 
+/* the 16 bit packet counters wrap after ~440ms at 100Mbit line rate */
+#define RT305X_ESW_MIB_WORK_DELAY	250
+
 enum {
 	/* Global attributes. */
 	RT305X_ESW_ATTR_ENABLE_VLAN,
@@ -193,6 +197,22 @@ enum {
 	RT305X_ESW_ATTR_PORT_RECV_GOOD,
 	RT5350_ESW_ATTR_PORT_TR_BAD,
 	RT5350_ESW_ATTR_PORT_TR_GOOD,
+	RT305X_ESW_ATTR_PORT_MIB,
+};
+
+enum {
+	RT305X_ESW_MIB_RX_GOOD,
+	RT305X_ESW_MIB_RX_BAD,
+	RT305X_ESW_MIB_TX_GOOD,
+	RT305X_ESW_MIB_TX_BAD,
+	RT305X_ESW_NUM_MIBS,
+};
+
+static const char * const esw_mib_names[RT305X_ESW_NUM_MIBS] = {
+	[RT305X_ESW_MIB_RX_GOOD] = "RxGood",
+	[RT305X_ESW_MIB_RX_BAD] = "RxBad",
+	[RT305X_ESW_MIB_TX_GOOD] = "TxGood",
+	[RT305X_ESW_MIB_TX_BAD] = "TxBad",
 };
 
 struct esw_port {
@@ -203,6 +223,12 @@ struct esw_port {
 	u16	pvid;
 };
 
+/* last raw counter values, and their 64 bit totals */
+struct esw_port_mib {
+	u16	last[RT305X_ESW_NUM_MIBS];
+	u64	total[RT305X_ESW_NUM_MIBS];
+};
+
 struct esw_vlan {
 	u8	ports;
 	u16	vid;
@@ -239,6 +265,14 @@ struct rt305x_esw {
 	struct esw_port ports[RT305X_ESW_NUM_PORTS];
 	struct reset_control	*rst_ephy;
 
+	/* Protects the port mib totals. */
+	struct mutex		mib_lock;
+	struct esw_port_mib	mibs[RT305X_ESW_NUM_LANWAN];
+	struct delayed_work	mib_work;
+	char			mib_buf[256];
+
+	struct work_struct	link_work;
+	u32			link_ports;
 };
 
 static inline void esw_w32(struct rt305x_esw *esw, u32 val, unsigned reg)
@@ -747,6 +781,41 @@ int rt3050_esw_has_carrier(struct fe_priv *priv)
 	return !!link && cpuport;
 }
 
+static u32 esw_get_link_ports(struct rt305x_esw *esw)
+{
+	u32 link = esw_r32(esw, RT305X_ESW_REG_POA);
+
+	return (link >> RT305X_ESW_POA_LINK_SHIFT) & RT305X_ESW_POA_LINK_MASK;
+}
+
+/* Send a change uevent with PORT and LINK for every port that went up or
+ * down since the last run, for hotplug handlers to act on (or log) the
+ * port that flapped.
+ */
+static void esw_link_work_func(struct work_struct *work)
+{
+	struct rt305x_esw *esw = container_of(work, struct rt305x_esw,
+					      link_work);
+	char port_env[16], link_env[16];
+	char *envp[] = { port_env, link_env, NULL };
+	u32 link, changed;
+	int i;
+
+	link = esw_get_link_ports(esw);
+	changed = link ^ esw->link_ports;
+	esw->link_ports = link;
+
+	for (i = 0; i <= RT305X_ESW_PORT5; i++) {
+		if (!(changed & BIT(i)))
+			continue;
+
+		snprintf(port_env, sizeof(port_env), "PORT=%d", i);
+		snprintf(link_env, sizeof(link_env), "LINK=%s",
+			 link & BIT(i) ? "up" : "down");
+		kobject_uevent_env(&esw->dev->kobj, KOBJ_CHANGE, envp);
+	}
+}
+
 static irqreturn_t esw_interrupt(int irq, void *_esw)
 {
 	struct rt305x_esw *esw = (struct rt305x_esw *) _esw;
@@ -756,6 +825,7 @@ static irqreturn_t esw_interrupt(int irq, void *_esw)
 	if (status & RT305X_ESW_PORT_ST_CHG) {
 		if (!esw->priv)
 			goto out;
+		schedule_work(&esw->link_work);
 		if (rt3050_esw_has_carrier(esw->priv))
 			netif_carrier_on(esw->priv->netdev);
 		else
@@ -1049,6 +1119,13 @@ static int esw_set_port_bool(struct switch_dev *dev,
 	return 0;
 }
 
+static bool esw_has_tx_counters(void)
+{
+	return ralink_soc == RT305X_SOC_RT5350 ||
+	       ralink_soc == MT762X_SOC_MT7628AN ||
+	       ralink_soc == MT762X_SOC_MT7688;
+}
+
 static int esw_get_port_recv_badgood(struct switch_dev *dev,
 				 const struct switch_attr *attr,
 				 struct switch_val *val)
@@ -1077,7 +1154,7 @@ esw_get_port_tr_badgood(struct switch_dev *dev,
 	int shift = attr->id == RT5350_ESW_ATTR_PORT_TR_GOOD ? 0 : 16;
 	u32 reg;
 
-	if ((ralink_soc != RT305X_SOC_RT5350) && (ralink_soc != MT762X_SOC_MT7628AN) && (ralink_soc != MT762X_SOC_MT7688))
+	if (!esw_has_tx_counters())
 		return -EINVAL;
 
 	if (idx < 0 || idx >= RT305X_ESW_NUM_LANWAN)
@@ -1089,6 +1166,116 @@ esw_get_port_tr_badgood(struct switch_dev *dev,
 	return 0;
 }
 
+static void esw_mib_add(struct esw_port_mib *port, int mib, u16 raw)
+{
+	port->total[mib] += (u16)(raw - port->last[mib]);
+	port->last[mib] = raw;
+}
+
+/* Must be called with mib_lock held. */
+static void esw_mib_refresh(struct rt305x_esw *esw)
+{
+	struct esw_port_mib *port;
+	u32 reg;
+	int i;
+
+	for (i = 0; i < RT305X_ESW_NUM_LANWAN; i++) {
+		port = &esw->mibs[i];
+
+		reg = esw_r32(esw, RT305X_ESW_REG_PXPC(i));
+		esw_mib_add(port, RT305X_ESW_MIB_RX_GOOD, reg & 0xffff);
+		esw_mib_add(port, RT305X_ESW_MIB_RX_BAD, reg >> 16);
+
+		if (!esw_has_tx_counters())
+			continue;
+
+		reg = esw_r32(esw, RT5350_ESW_REG_PXTPC(i));
+		esw_mib_add(port, RT305X_ESW_MIB_TX_GOOD, reg & 0xffff);
+		esw_mib_add(port, RT305X_ESW_MIB_TX_BAD, reg >> 16);
+	}
+}
+
+static void esw_mib_work_func(struct work_struct *work)
+{
+	struct rt305x_esw *esw = container_of(work, struct rt305x_esw,
+					      mib_work.work);
+
+	mutex_lock(&esw->mib_lock);
+	esw_mib_refresh(esw);
+	mutex_unlock(&esw->mib_lock);
+
+	schedule_delayed_work(&esw->mib_work,
+			      msecs_to_jiffies(RT305X_ESW_MIB_WORK_DELAY));
+}
+
+static void esw_mib_start(struct rt305x_esw *esw)
+{
+	int i;
+
+	/* count from the current values, not from 0 */
+	mutex_lock(&esw->mib_lock);
+	esw_mib_refresh(esw);
+	for (i = 0; i < RT305X_ESW_NUM_LANWAN; i++)
+		memset(esw->mibs[i].total, 0, sizeof(esw->mibs[i].total));
+	mutex_unlock(&esw->mib_lock);
+
+	schedule_delayed_work(&esw->mib_work,
+			      msecs_to_jiffies(RT305X_ESW_MIB_WORK_DELAY));
+}
+
+static int esw_get_port_mib(struct switch_dev *dev,
+			    const struct switch_attr *attr,
+			    struct switch_val *val)
+{
+	struct rt305x_esw *esw = container_of(dev, struct rt305x_esw, swdev);
+	int idx = val->port_vlan;
+	int i, len = 0;
+
+	if (idx < 0 || idx >= RT305X_ESW_NUM_LANWAN)
+		return -EINVAL;
+
+	mutex_lock(&esw->mib_lock);
+	esw_mib_refresh(esw);
+
+	len += snprintf(esw->mib_buf + len, sizeof(esw->mib_buf) - len,
+			"Port %d MIB counters\n", idx);
+	for (i = 0; i < RT305X_ESW_NUM_MIBS; i++) {
+		if (i >= RT305X_ESW_MIB_TX_GOOD && !esw_has_tx_counters())
+			break;
+		len += snprintf(esw->mib_buf + len,
+				sizeof(esw->mib_buf) - len,
+				"%-12s: %llu\n", esw_mib_names[i],
+				esw->mibs[idx].total[i]);
+	}
+	mutex_unlock(&esw->mib_lock);
+
+	val->value.s = esw->mib_buf;
+	val->len = len;
+
+	return 0;
+}
+
+/* The switch only counts packets, so the byte fields carry the good
+ * packet totals. That is all the swconfig LED trigger needs to see
+ * traffic on a port.
+ */
+static int esw_get_port_stats(struct switch_dev *dev, int port,
+			      struct switch_port_stats *stats)
+{
+	struct rt305x_esw *esw = container_of(dev, struct rt305x_esw, swdev);
+
+	if (port < 0 || port >= RT305X_ESW_NUM_LANWAN)
+		return -EINVAL;
+
+	mutex_lock(&esw->mib_lock);
+	esw_mib_refresh(esw);
+	stats->rx_bytes = esw->mibs[port].total[RT305X_ESW_MIB_RX_GOOD];
+	stats->tx_bytes = esw->mibs[port].total[RT305X_ESW_MIB_TX_GOOD];
+	mutex_unlock(&esw->mib_lock);
+
+	return 0;
+}
+
 static int esw_get_port_led(struct switch_dev *dev,
 			const struct switch_attr *attr,
 			struct switch_val *val)
@@ -1358,6 +1545,13 @@ static const struct switch_attr esw_port[] = {
 		.id = RT5350_ESW_ATTR_PORT_TR_GOOD,
 		.get = esw_get_port_tr_badgood,
 	},
+	{
+		.type = SWITCH_TYPE_STRING,
+		.name = "mib",
+		.description = "Get 64 bit packet counters for a port",
+		.id = RT305X_ESW_ATTR_PORT_MIB,
+		.get = esw_get_port_mib,
+	},
 };
 
 static const struct switch_attr esw_vlan[] = {
@@ -1381,6 +1575,7 @@ static const struct switch_dev_ops esw_ops = {
 	.get_port_pvid = esw_get_port_pvid,
 	.set_port_pvid = esw_set_port_pvid,
 	.get_port_link = esw_get_port_link,
+	.get_port_stats = esw_get_port_stats,
 	.apply_config = esw_apply_config,
 	.reset_switch = esw_reset_switch,
 };
@@ -1432,6 +1627,9 @@ static int esw_probe(struct platform_device *pdev)
 	}
 
 	spin_lock_init(&esw->reg_rw_lock);
+	mutex_init(&esw->mib_lock);
+	INIT_DELAYED_WORK(&esw->mib_work, esw_mib_work_func);
+	INIT_WORK(&esw->link_work, esw_link_work_func);
 	platform_set_drvdata(pdev, esw);
 
 	return 0;
@@ -1443,6 +1641,8 @@ static int esw_remove(struct platform_device *pdev)
 
 	if (esw) {
 		esw_w32(esw, ~0, RT305X_ESW_REG_IMR);
+		cancel_work_sync(&esw->link_work);
+		cancel_delayed_work_sync(&esw->mib_work);
 		platform_set_drvdata(pdev, NULL);
 	}
 
@@ -1507,6 +1707,9 @@ int rt3050_esw_init(struct fe_priv *priv)
 		return ret;
 	}
 
+	esw->link_ports = esw_get_link_ports(esw);
+	esw_mib_start(esw);
+
 	ret = devm_request_irq(&pdev->dev, esw->irq, esw_interrupt, 0, "esw",
 			esw);
 	if (!ret) {
@@ -161,6 +161,18 @@ static void fe_get_ringparam(struct net_device *dev,
 	ring->tx_pending = priv->tx_ring.tx_ring_size;
 }
 
+/* The PDMA has more rings, but the frame engine of these SoCs cannot
+ * steer flows between RX rings, so only ring 0 is used in each direction.
+ */
+static void fe_get_channels(struct net_device *dev,
+			    struct ethtool_channels *ch)
+{
+	ch->max_rx = 1;
+	ch->max_tx = 1;
+	ch->rx_count = 1;
+	ch->tx_count = 1;
+}
+
 static void fe_get_strings(struct net_device *dev, u32 stringset, u8 *data)
 {
 	switch (stringset) {
@@ -217,6 +229,7 @@ static struct ethtool_ops fe_ethtool_ops = {
 	.get_link		= fe_get_link,
 	.set_ringparam		= fe_set_ringparam,
 	.get_ringparam		= fe_get_ringparam,
+	.get_channels		= fe_get_channels,
 };
 
 void fe_set_ethtool_ops(struct net_device *netdev)
@@ -46,6 +46,10 @@
 #define MT7530_PORT_MIB_TXB_ID	2	/* TxGOC */
 #define MT7530_PORT_MIB_RXB_ID	6	/* RxGOC */
 
+/* bounds in seconds for the port MIB harvesting interval */
+#define MT7530_MIB_INTERVAL_MIN	1
+#define MT7530_MIB_INTERVAL_MAX	30
+
 /* registers */
 #define REG_ESW_WT_MAC_MFC		0x10
 
@@ -179,6 +183,13 @@ struct mt7530_priv {
 	struct mt7530_vlan_entry	vlan_entries[MT7530_NUM_VLANS];
 	struct mt7530_port_entry	port_entries[MT7530_NUM_PORTS];
 	char arl_buf[MT7530_NUM_ARL_RECORDS * ARL_LINE_LENGTH + 1];
+
+	/* 64 bit software copies of the 32 bit port MIB counters */
+	struct delayed_work	mib_work;
+	struct mutex		mib_lock;
+	unsigned long		port_mib_stamp[MT7530_NUM_PORTS];
+	u32	port_mib_last[MT7530_NUM_PORTS][ARRAY_SIZE(mt7620_port_mibs)];
+	u64	port_mib[MT7530_NUM_PORTS][ARRAY_SIZE(mt7620_port_mibs)];
 };
 
 struct mt7530_mapping {
@@ -751,6 +762,109 @@ static u64 get_mib_counter_port_7620(struct mt7530_priv *priv, int i, int port)
 			mt7620_port_mibs[i].offset);
 }
 
+static void mt7530_mib_update_port(struct mt7530_priv *priv, int port)
+{
+	int i;
+
+	lockdep_assert_held(&priv->mib_lock);
+
+	for (i = 0; i < ARRAY_SIZE(mt7620_port_mibs); i++) {
+		u32 val = get_mib_counter_port_7620(priv, i, port);
+
+		priv->port_mib[port][i] += (u32)(val - priv->port_mib_last[port][i]);
+		priv->port_mib_last[port][i] = val;
+	}
+
+	priv->port_mib_stamp[port] = jiffies;
+}
+
+/* refresh a port for readers, unless it was harvested within the last second */
+static void mt7530_mib_sync_port(struct mt7530_priv *priv, int port)
+{
+	lockdep_assert_held(&priv->mib_lock);
+
+	if (time_after(jiffies, priv->port_mib_stamp[port] + HZ))
+		mt7530_mib_update_port(priv, port);
+}
+
+static unsigned long mt7530_mib_interval(struct mt7530_priv *priv)
+{
+	u32 speed = 0, wrap;
+	int port;
+
+	for (port = 0; port < MT7530_NUM_PORTS; port++) {
+		u32 pmsr = mt7530_r32(priv, 0x3008 + (0x100 * port));
+
+		if (!(pmsr & 1))
+			continue;
+
+		switch ((pmsr >> 2) & 3) {
+		case 0:
+			speed = max_t(u32, speed, 10);
+			break;
+		case 1:
+			speed = max_t(u32, speed, 100);
+			break;
+		default:
+			speed = 1000;
+			break;
+		}
+	}
+
+	if (!speed)
+		return MT7530_MIB_INTERVAL_MAX * HZ;
+
+	/* seconds until an octet counter wraps at line rate, poll 4x as often */
+	wrap = div_u64(1ULL << 32, speed * 125000);
+
+	return clamp_t(u32, wrap / 4, MT7530_MIB_INTERVAL_MIN,
+		       MT7530_MIB_INTERVAL_MAX) * HZ;
+}
+
+static void mt7530_mib_work(struct work_struct *work)
+{
+	struct mt7530_priv *priv = container_of(work, struct mt7530_priv,
+						mib_work.work);
+	int port;
+
+	mutex_lock(&priv->mib_lock);
+	for (port = 0; port < MT7530_NUM_PORTS; port++)
+		mt7530_mib_update_port(priv, port);
+	mutex_unlock(&priv->mib_lock);
+
+	schedule_delayed_work(&priv->mib_work, mt7530_mib_interval(priv));
+}
+
+static void mt7530_mib_stop(void *data)
+{
+	struct mt7530_priv *priv = data;
+
+	cancel_delayed_work_sync(&priv->mib_work);
+}
+
+static int mt7530_mib_init(struct device *dev, struct mt7530_priv *priv)
+{
+	int port, i;
+
+	mutex_init(&priv->mib_lock);
+	INIT_DELAYED_WORK(&priv->mib_work, mt7530_mib_work);
+
+	/* start from the current hardware values */
+	for (port = 0; port < MT7530_NUM_PORTS; port++) {
+		for (i = 0; i < ARRAY_SIZE(mt7620_port_mibs); i++) {
+			u32 val = get_mib_counter_port_7620(priv, i, port);
+
+			priv->port_mib_last[port][i] = val;
+			priv->port_mib[port][i] = val;
+		}
+		priv->port_mib_stamp[port] = jiffies;
+	}
+
+	schedule_delayed_work(&priv->mib_work, mt7530_mib_interval(priv));
+
+	return devm_add_action_or_reset(dev, mt7530_mib_stop, priv);
+}
+
 static int mt7530_sw_get_mib(struct switch_dev *dev,
 				  const struct switch_attr *attr,
 				  struct switch_val *val)
@@ -883,14 +997,15 @@ static int mt7530_sw_get_port_mib(struct switch_dev *dev,
 	len += snprintf(buf + len, sizeof(buf) - len,
 			"Port %d MIB counters\n", val->port_vlan);
 
+	mutex_lock(&priv->mib_lock);
+	mt7530_mib_sync_port(priv, val->port_vlan);
 	for (i = 0; i < ARRAY_SIZE(mt7620_port_mibs); ++i) {
-		u64 counter;
 		len += snprintf(buf + len, sizeof(buf) - len,
 				"%-11s: ", mt7620_port_mibs[i].name);
-		counter = get_mib_counter_port_7620(priv, i, val->port_vlan);
 		len += snprintf(buf + len, sizeof(buf) - len, "%llu\n",
-				counter);
+				priv->port_mib[val->port_vlan][i]);
 	}
+	mutex_unlock(&priv->mib_lock);
 
 	val->value.s = buf;
 	val->len = len;
@@ -905,8 +1020,11 @@ static int mt7530_get_port_stats(struct switch_dev *dev, int port,
 	if (port < 0 || port >= MT7530_NUM_PORTS)
 		return -EINVAL;
 
-	stats->tx_bytes = get_mib_counter_port_7620(priv, MT7530_PORT_MIB_TXB_ID, port);
-	stats->rx_bytes = get_mib_counter_port_7620(priv, MT7530_PORT_MIB_RXB_ID, port);
+	mutex_lock(&priv->mib_lock);
+	mt7530_mib_sync_port(priv, port);
+	stats->tx_bytes = priv->port_mib[port][MT7530_PORT_MIB_TXB_ID];
+	stats->rx_bytes = priv->port_mib[port][MT7530_PORT_MIB_RXB_ID];
+	mutex_unlock(&priv->mib_lock);
 
 	return 0;
 }
@@ -1030,6 +1148,10 @@ mt7530_probe(struct device *dev, void __iomem *base, struct mii_bus *bus, int vl
 	swdev->vlans = MT7530_NUM_VLANS;
 	swdev->ops = &mt7530_ops;
 
+	ret = mt7530_mib_init(dev, mt7530);
+	if (ret)
+		return ret;
+
 	ret = register_switch(swdev, NULL);
 	if (ret) {
 		dev_err(dev, "failed to register mt7530\n");
@@ -131,6 +131,44 @@ static int lzma_init_props(void)
 	return res;
 }
 
+static __inline__ unsigned int read_c0_count(void)
+{
+	unsigned int count;
+
+	__asm__ __volatile__("mfc0 %0, $9" : "=r" (count));
+
+	return count;
+}
+
+#if !(LZMA_WRAPPER)
+/*
+ * The decoder fetches the stream a byte at a time, which is slow from
+ * uncached flash. Copy it behind the probability tables in RAM first,
+ * using word reads.
+ */
+static void lzma_copy_data(void)
+{
+	unsigned long probs = LzmaGetNumProbs(&lzma_state.Properties) *
+			      sizeof(CProb);
+	unsigned long src = (unsigned long) lzma_data & ~3UL;
+	unsigned long len = (unsigned long) lzma_data + lzma_datasize - src;
+	unsigned char *buf = workspace + ((probs + 31) & ~31UL);
+	unsigned long dst = (unsigned long) buf;
+	const uint32_t *s = (const uint32_t *) src;
+	uint32_t *d = (uint32_t *) buf;
+	unsigned long i;
+
+	/* don't overlap the decompressed kernel */
+	if (dst < kernel_la + lzma_outsize && dst + len + 3 > kernel_la)
+		return;
+
+	for (i = 0; i < (len + 3) / 4; i++)
+		d[i] = s[i];
+
+	lzma_data = buf + ((unsigned long) lzma_data & 3);
+}
+#endif
+
 static int lzma_decompress(unsigned char *outStream)
 {
 	SizeT ip, op;
@@ -214,6 +252,7 @@ void loader_main(unsigned long reg_a0, unsigned long reg_a1,
 {
 	void (*kernel_entry) (unsigned long, unsigned long, unsigned long,
 			      unsigned long);
+	unsigned int start;
 	int res;
 
 	board_init();
@@ -229,8 +268,13 @@ void loader_main(unsigned long reg_a0, unsigned long reg_a1,
 		halt();
 	}
 
+#if !(LZMA_WRAPPER)
+	lzma_copy_data();
+#endif
+
 	printf("Decompressing kernel... ");
 
+	start = read_c0_count();
 	res = lzma_decompress((unsigned char *) kernel_la);
 	if (res != LZMA_RESULT_OK) {
 		printf("failed, ");
@@ -243,7 +287,7 @@ void loader_main(unsigned long reg_a0, unsigned long reg_a1,
 		}
 		halt();
 	} else {
-		printf("done!\n");
+		printf("done in %u counter ticks!\n", read_c0_count() - start);
 	}
 
 	flush_cache(kernel_la, lzma_outsize);
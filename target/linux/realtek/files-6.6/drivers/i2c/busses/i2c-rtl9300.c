@@ -1,5 +1,6 @@
 // SPDX-License-Identifier: GPL-2.0-only
 
+#include <linux/iopoll.h>
 #include <linux/module.h>
 #include <linux/of_platform.h>
 #include "i2c-rtl9300.h"
@@ -8,6 +9,16 @@
 #define REG_MASK(i, clear, set, reg)	\
 			writel((readl(REG(i, reg)) & ~(clear)) | (set), REG(i, reg))
 
+/* The controller moves at most 16 bytes through its data registers */
+#define RTL9300_I2C_MAX_XFER	16
+
+/*
+ * A 16 byte transfer takes about 2ms at 100kHz, sleep between checking
+ * for completion instead of spinning on the trigger bit
+ */
+#define RTL9300_I2C_POLL_US	50
+#define RTL9300_I2C_TIMEOUT_US	100000
+
 struct i2c_drv_data {
 	int scl0_pin;
 	int scl1_pin;
@@ -121,14 +132,15 @@ static int rtl9310_i2c_config_xfer(struct rtl9300_i2c *i2c, u16 addr, u16 len)
 	return 0;
 }
 
+/* The first byte is in the lowest bits of the first data word */
 static int i2c_read(void __iomem *r0, u8 *buf, int len)
 {
-	if (len > 16)
+	u32 v = 0;
+
+	if (len > RTL9300_I2C_MAX_XFER)
 		return -EIO;
 
 	for (int i = 0; i < len; i++) {
-		u32 v;
-
 		if (i % 4 == 0)
 			v = readl(r0 + i);
 		buf[i] = v;
@@ -140,16 +152,15 @@ static int i2c_read(void __iomem *r0, u8 *buf, int len)
 
 static int i2c_write(void __iomem *r0, u8 *buf, int len)
 {
-	if (len > 16)
+	u32 v = 0;
+
+	if (len > RTL9300_I2C_MAX_XFER)
 		return -EIO;
 
 	for (int i = 0; i < len; i++) {
-		u32 v;
-
-		if (! (i % 4))
+		if (i % 4 == 0)
 			v = 0;
-		v <<= 8;
-		v |= buf[i];
+		v |= buf[i] << ((i % 4) * 8);
 		if (i % 4 == 3 || i == len - 1)
 			writel(v, r0 + (i / 4) * 4);
 	}
@@ -199,9 +210,9 @@ static int rtl9300_execute_xfer(struct rtl9300_i2c *i2c, char read_write,
 		REG_MASK(i2c, 0, BIT(RTL9300_I2C_CTRL1_RWOP), RTL9300_I2C_CTRL1);
 
 	REG_MASK(i2c, 0, BIT(RTL9300_I2C_CTRL1_I2C_TRIG), RTL9300_I2C_CTRL1);
-	do {
-		v = readl(REG(i2c, RTL9300_I2C_CTRL1));
-	} while (v & BIT(RTL9300_I2C_CTRL1_I2C_TRIG));
+	if (readl_poll_timeout(REG(i2c, RTL9300_I2C_CTRL1), v, !(v & BIT(RTL9300_I2C_CTRL1_I2C_TRIG)),
+			       RTL9300_I2C_POLL_US, RTL9300_I2C_TIMEOUT_US))
+		return -ETIMEDOUT;
 
 	if (v & BIT(RTL9300_I2C_CTRL1_I2C_FAIL))
 		return -EIO;
@@ -230,9 +241,9 @@ static int rtl9310_execute_xfer(struct rtl9300_i2c *i2c, char read_write,
 		REG_MASK(i2c, 0, BIT(RTL9310_I2C_CTRL_RWOP), RTL9310_I2C_CTRL);
 
 	REG_MASK(i2c, 0, BIT(RTL9310_I2C_CTRL_I2C_TRIG), RTL9310_I2C_CTRL);
-	do {
-		v = readl(REG(i2c, RTL9310_I2C_CTRL));
-	} while (v & BIT(RTL9310_I2C_CTRL_I2C_TRIG));
+	if (readl_poll_timeout(REG(i2c, RTL9310_I2C_CTRL), v, !(v & BIT(RTL9310_I2C_CTRL_I2C_TRIG)),
+			       RTL9300_I2C_POLL_US, RTL9300_I2C_TIMEOUT_US))
+		return -ETIMEDOUT;
 
 	if (v & BIT(RTL9310_I2C_CTRL_I2C_FAIL))
 		return -EIO;
@@ -250,6 +261,38 @@ static int rtl9310_execute_xfer(struct rtl9300_i2c *i2c, char read_write,
 	return 0;
 }
 
+/*
+ * I2C block transfers of up to I2C_SMBUS_BLOCK_MAX bytes are split into
+ * bursts of the largest size the data registers hold
+ */
+static int rtl9300_i2c_block_xfer(struct rtl9300_i2c *i2c, struct i2c_drv_data *drv_data,
+				  u16 addr, char read_write, u8 command,
+				  union i2c_smbus_data *data)
+{
+	int len = data->block[0], ret;
+
+	if (!len || len > I2C_SMBUS_BLOCK_MAX)
+		return -EINVAL;
+
+	for (int off = 0; off < len; off += RTL9300_I2C_MAX_XFER) {
+		int burst = min(len - off, RTL9300_I2C_MAX_XFER);
+
+		drv_data->reg_addr_set(i2c, command + off, 1);
+		drv_data->config_xfer(i2c, addr, burst);
+		if (read_write == I2C_SMBUS_WRITE)
+			drv_data->write(i2c, &data->block[1 + off], burst);
+
+		ret = drv_data->execute_xfer(i2c, read_write, I2C_SMBUS_I2C_BLOCK_DATA, data, 0);
+		if (ret)
+			return ret;
+
+		if (read_write == I2C_SMBUS_READ)
+			drv_data->read(i2c, &data->block[1 + off], burst);
+	}
+
+	return 0;
+}
+
 static int rtl9300_i2c_smbus_xfer(struct i2c_adapter * adap, u16 addr,
 		  unsigned short flags, char read_write,
 		  u8 command, int size, union i2c_smbus_data * data)
@@ -304,13 +347,21 @@ static int rtl9300_i2c_smbus_xfer(struct i2c_adapter * adap, u16 addr,
 		len = data->block[0];
 		break;
 
+	case I2C_SMBUS_I2C_BLOCK_DATA:
+		pr_debug("I2C_SMBUS_I2C_BLOCK_DATA %02x, read %d, len %d\n",
+			addr, read_write, data->block[0]);
+		ret = rtl9300_i2c_block_xfer(i2c, drv_data, addr, read_write, command, data);
+		goto out;
+
 	default:
 		dev_warn(&adap->dev, "Unsupported transaction %d\n", size);
-		return -EOPNOTSUPP;
+		ret = -EOPNOTSUPP;
+		goto out;
 	}
 
 	ret = drv_data->execute_xfer(i2c, read_write, size, data, len);
 
+out:
 	mutex_unlock(&i2c_lock);
 
 	return ret;
@@ -320,7 +371,7 @@ static u32 rtl9300_i2c_func(struct i2c_adapter *a)
 {
 	return I2C_FUNC_SMBUS_QUICK | I2C_FUNC_SMBUS_BYTE |
 	       I2C_FUNC_SMBUS_BYTE_DATA | I2C_FUNC_SMBUS_WORD_DATA |
-	       I2C_FUNC_SMBUS_BLOCK_DATA;
+	       I2C_FUNC_SMBUS_BLOCK_DATA | I2C_FUNC_SMBUS_I2C_BLOCK;
 }
 
 static const struct i2c_algorithm rtl9300_i2c_algo = {
@@ -330,8 +381,8 @@ static const struct i2c_algorithm rtl9300_i2c_algo = {
 
 struct i2c_adapter_quirks rtl9300_i2c_quirks = {
 	.flags		= I2C_AQ_NO_CLK_STRETCH,
-	.max_read_len	= 16,
-	.max_write_len	= 16,
+	.max_read_len	= RTL9300_I2C_MAX_XFER,
+	.max_write_len	= RTL9300_I2C_MAX_XFER,
 };
 
 static int rtl9300_i2c_probe(struct platform_device *pdev)
@@ -436,7 +487,7 @@ struct i2c_drv_data rtl9300_i2c_drv_data = {
 	.scl1_pin = 17,
 	.sda0_pin = 9,
 	.read = rtl9300_i2c_read,
-	.read = rtl9300_i2c_write,
+	.write = rtl9300_i2c_write,
 	.reg_addr_set = rtl9300_i2c_reg_addr_set,
 	.config_xfer = rtl9300_i2c_config_xfer,
 	.execute_xfer = rtl9300_execute_xfer,
@@ -450,7 +501,7 @@ struct i2c_drv_data rtl9310_i2c_drv_data = {
 	.scl1_pin = 14,
 	.sda0_pin = 0,
 	.read = rtl9310_i2c_read,
-	.read = rtl9310_i2c_write,
+	.write = rtl9310_i2c_write,
 	.reg_addr_set = rtl9310_i2c_reg_addr_set,
 	.config_xfer = rtl9310_i2c_config_xfer,
 	.execute_xfer = rtl9310_execute_xfer,
@@ -464,7 +515,7 @@ static const struct of_device_id i2c_rtl9300_dt_ids[] = {
 	{ .compatible = "realtek,rtl9310-i2c", .data = (void *) &rtl9310_i2c_drv_data },
 	{ /* sentinel */ }
 };
-MODULE_DEVICE_TABLE(of, rtl838x_eth_of_ids);
+MODULE_DEVICE_TABLE(of, i2c_rtl9300_dt_ids);
 
 static struct platform_driver rtl9300_i2c_driver = {
 	.probe		= rtl9300_i2c_probe,
@@ -11,6 +11,8 @@
 #include <linux/inetdevice.h>
 #include <linux/rhashtable.h>
 #include <linux/of_net.h>
+#include <linux/vmalloc.h>
+#include <net/switchdev.h>
 #include <asm/mach-rtl838x/mach-rtl83xx.h>
 
 #include "rtl83xx.h"
@@ -595,6 +597,320 @@ int rtl83xx_packet_cntr_alloc(struct rtl838x_switch_priv *priv)
 	return idx;
 }
 
+/* The PIE gives precedence to the rule at the lower index when several rules
+ * match, so rules are kept ordered by their priority over the whole TCAM: no rule
+ * sits below a rule with a numerically lower prio. Among rules of equal prio the
+ * order is arbitrary. Which slots a rule may use further depends on the templates
+ * enabled for the slot's block, see pie_rule_tid().
+ */
+static bool rtl83xx_pie_fits(struct rtl838x_switch_priv *priv, struct pie_rule *pr, int idx)
+{
+	return priv->r->pie_rule_tid(priv, pr, idx / PIE_BLOCK_SIZE) >= 0;
+}
+
+/* Caller must hold priv->pie_mutex */
+static void rtl83xx_pie_place(struct rtl838x_switch_priv *priv, struct pie_rule *pr, int idx)
+{
+	pr->valid = true;
+	pr->tid = priv->r->pie_rule_tid(priv, pr, idx / PIE_BLOCK_SIZE);
+	pr->id = idx;
+
+	set_bit(idx, priv->pie_use_bm);
+	priv->pie_rules[idx] = pr;
+
+	priv->r->pie_lookup_enable(priv, idx);
+	priv->r->pie_rule_write(priv, idx, pr);
+}
+
+/* Moves the rules between the free slot hole and the slot idx by one towards the
+ * hole, so that idx becomes free. Each rule is written to its new slot before its
+ * old slot is cleared, so the rule matches throughout the move. Nothing is touched
+ * if a rule does not fit the templates of the slot it would move to.
+ * Caller must hold priv->pie_mutex
+ */
+static int rtl83xx_pie_shift(struct rtl838x_switch_priv *priv, int hole, int idx)
+{
+	int step = hole > idx ? -1 : 1;
+	int h, i;
+
+	for (h = hole, i = hole + step; i != idx + step; h = i, i += step) {
+		if (priv->pie_rules[i] && !rtl83xx_pie_fits(priv, priv->pie_rules[i], h))
+			return -ENOSPC;
+	}
+
+	for (h = hole, i = hole + step; i != idx + step; h = i, i += step) {
+		struct pie_rule *pr = priv->pie_rules[i];
+
+		if (!pr)
+			continue;
+
+		rtl83xx_pie_place(priv, pr, h);
+		priv->r->pie_rule_clear(priv, i);
+		clear_bit(i, priv->pie_use_bm);
+		priv->pie_rules[i] = NULL;
+	}
+
+	return 0;
+}
+
+/* Places the rule pr into a slot of blocks min_block to max_block - 1 behind all
+ * rules of lower and in front of all rules of higher prio. If no fitting slot is
+ * free there, neighbouring rules are shifted by one towards the nearest free slot
+ * they can move to, which keeps the TCAM usable however fragmented it became
+ */
+int rtl83xx_pie_rule_alloc(struct rtl838x_switch_priv *priv, struct pie_rule *pr,
+			   int min_block, int max_block)
+{
+	int first = min_block * PIE_BLOCK_SIZE;
+	int last = max_block * PIE_BLOCK_SIZE;
+	int lo = first - 1, hi = last;
+	int idx, hole;
+
+	mutex_lock(&priv->pie_mutex);
+
+	/* Rules in front of pr end at lo, those behind it start at hi */
+	for (idx = first; idx < last; idx++) {
+		struct pie_rule *q = priv->pie_rules[idx];
+
+		if (!q)
+			continue;
+		if (q->prio < pr->prio)
+			lo = idx;
+		else if (q->prio > pr->prio && hi == last)
+			hi = idx;
+	}
+	if (lo > hi) {
+		pr_warn("%s: PIE rules out of order\n", __func__);
+		lo = first - 1;
+		hi = last;
+	}
+
+	for (idx = lo + 1; idx < hi; idx++) {
+		if (!test_bit(idx, priv->pie_use_bm) && rtl83xx_pie_fits(priv, pr, idx))
+			goto place;
+	}
+
+	/* Open the slot closest to the upper end of the window by moving the rules
+	 * from there upwards
+	 */
+	for (idx = min(hi, last - 1); idx > lo; idx--) {
+		if (rtl83xx_pie_fits(priv, pr, idx))
+			break;
+	}
+	if (idx > lo) {
+		for (hole = idx + 1; hole < last; hole++) {
+			if (!test_bit(hole, priv->pie_use_bm) &&
+			    !rtl83xx_pie_shift(priv, hole, idx))
+				goto place;
+		}
+	}
+
+	/* Failing that open the slot closest to the lower end by moving rules down */
+	for (idx = max(lo, first); idx < hi; idx++) {
+		if (rtl83xx_pie_fits(priv, pr, idx))
+			break;
+	}
+	if (idx < hi) {
+		for (hole = idx - 1; hole >= first; hole--) {
+			if (!test_bit(hole, priv->pie_use_bm) &&
+			    !rtl83xx_pie_shift(priv, hole, idx))
+				goto place;
+		}
+	}
+
+	mutex_unlock(&priv->pie_mutex);
+	pr_debug("%s: no space for rule with prio %u\n", __func__, pr->prio);
+
+	return -ENOSPC;
+
+place:
+	pr_debug("%s: using index %d for rule with prio %u\n", __func__, idx, pr->prio);
+	rtl83xx_pie_place(priv, pr, idx);
+	mutex_unlock(&priv->pie_mutex);
+
+	return 0;
+}
+
+/* Rewrites an installed rule in place after its match fields or actions changed,
+ * the SoC replaces the entry with a single table write
+ */
+int rtl83xx_pie_rule_update(struct rtl838x_switch_priv *priv, struct pie_rule *pr)
+{
+	int err = -ENOENT;
+
+	mutex_lock(&priv->pie_mutex);
+
+	if (pr->id >= 0 && pr->id < MAX_PIE_ENTRIES && priv->pie_rules[pr->id] == pr) {
+		err = -EOPNOTSUPP;
+		if (rtl83xx_pie_fits(priv, pr, pr->id)) {
+			pr->tid = priv->r->pie_rule_tid(priv, pr, pr->id / PIE_BLOCK_SIZE);
+			err = priv->r->pie_rule_write(priv, pr->id, pr);
+		}
+	}
+
+	mutex_unlock(&priv->pie_mutex);
+
+	return err;
+}
+
+void rtl83xx_pie_rule_rm(struct rtl838x_switch_priv *priv, struct pie_rule *pr)
+{
+	int idx = pr->id;
+
+	mutex_lock(&priv->pie_mutex);
+
+	if (idx >= 0 && idx < MAX_PIE_ENTRIES && priv->pie_rules[idx] == pr) {
+		priv->r->pie_rule_clear(priv, idx);
+		clear_bit(idx, priv->pie_use_bm);
+		priv->pie_rules[idx] = NULL;
+		pr->valid = false;
+	}
+
+	mutex_unlock(&priv->pie_mutex);
+}
+
+/* The L2 shadow is a RAM copy of the L2 hash table followed by the CAM, indexed by
+ * the position of the entry in the table, i.e. (hash << 2) | pos for the hash table
+ * and fib_entries + idx for the CAM. Slots are read from the SoC on first use and
+ * kept up to date on every write by the driver, so that lookups and free slot searches
+ * do not have to go through the table access registers. Entries learned or aged out
+ * by the hardware only make the shadow stale for dynamic entries, which is harmless
+ * for the lookups, the FDB dump re-reads the tables once they may have changed.
+ */
+static void rtl83xx_l2_shadow_free(void *data)
+{
+	vfree(data);
+}
+
+static int rtl83xx_l2_shadow_init(struct rtl838x_switch_priv *priv)
+{
+	int n = priv->fib_entries + L2_CAM_ENTRIES;
+	int err;
+
+	priv->l2_shadow = vcalloc(n, sizeof(*priv->l2_shadow));
+	if (!priv->l2_shadow)
+		return -ENOMEM;
+
+	err = devm_add_action_or_reset(priv->dev, rtl83xx_l2_shadow_free, priv->l2_shadow);
+	if (err)
+		return err;
+
+	priv->l2_shadow_synced = devm_bitmap_zalloc(priv->dev, n, GFP_KERNEL);
+	if (!priv->l2_shadow_synced)
+		return -ENOMEM;
+
+	priv->l2_shadow_valid = devm_bitmap_zalloc(priv->dev, n, GFP_KERNEL);
+	if (!priv->l2_shadow_valid)
+		return -ENOMEM;
+
+	/* The RTL839x notifies learning and aging events, see rtl83xx_switchdev_event() */
+	priv->l2_shadow_ttl = priv->family_id == RTL8390_FAMILY_ID ? 10 * L2_SHADOW_TTL : L2_SHADOW_TTL;
+	priv->l2_shadow_expires = jiffies;
+
+	return 0;
+}
+
+/* Caller must hold priv->reg_mutex */
+void rtl83xx_l2_shadow_flush(struct rtl838x_switch_priv *priv)
+{
+	WRITE_ONCE(priv->l2_shadow_stale, false);
+	WRITE_ONCE(priv->l2_shadow_learned, false);
+	bitmap_zero(priv->l2_shadow_synced, priv->fib_entries + L2_CAM_ENTRIES);
+	priv->l2_shadow_expires = jiffies + priv->l2_shadow_ttl;
+}
+
+/* Marks the whole shadow stale after the L2 table was written without holding
+ * priv->reg_mutex, it is re-read slot by slot on the next access
+ */
+void rtl83xx_l2_shadow_invalidate(struct rtl838x_switch_priv *priv)
+{
+	WRITE_ONCE(priv->l2_shadow_stale, true);
+}
+
+static void rtl83xx_l2_shadow_check(struct rtl838x_switch_priv *priv)
+{
+	if (unlikely(READ_ONCE(priv->l2_shadow_stale)))
+		rtl83xx_l2_shadow_flush(priv);
+}
+
+/* Caller must hold priv->reg_mutex */
+void rtl83xx_l2_shadow_update(struct rtl838x_switch_priv *priv, int slot, u64 seed,
+			      const struct rtl838x_l2_entry *e)
+{
+	struct rtl83xx_l2_shadow *s = &priv->l2_shadow[slot];
+
+	s->valid = e->valid;
+	s->seed = e->valid ? seed & 0x0fffffffffffffffULL : 0;
+	ether_addr_copy(s->mac, e->mac);
+	s->vid = e->vid;
+	s->port = e->port;
+	s->is_static = e->is_static;
+	if (e->valid)
+		set_bit(slot, priv->l2_shadow_valid);
+	else
+		clear_bit(slot, priv->l2_shadow_valid);
+	set_bit(slot, priv->l2_shadow_synced);
+}
+
+/* Reads the slot from the SoC into e and updates the shadow
+ * Caller must hold priv->reg_mutex
+ */
+const struct rtl83xx_l2_shadow *rtl83xx_l2_shadow_read(struct rtl838x_switch_priv *priv, int slot,
+						       struct rtl838x_l2_entry *e)
+{
+	u64 seed;
+
+	if (slot < priv->fib_entries)
+		seed = priv->r->read_l2_entry_using_hash(slot >> 2, slot & 0x3, e);
+	else
+		seed = priv->r->read_cam(slot - priv->fib_entries, e);
+
+	rtl83xx_l2_shadow_update(priv, slot, seed, e);
+
+	return &priv->l2_shadow[slot];
+}
+
+/* Returns the shadow of a slot, reading it from the SoC when not in sync
+ * Caller must hold priv->reg_mutex
+ */
+const struct rtl83xx_l2_shadow *rtl83xx_l2_shadow_get(struct rtl838x_switch_priv *priv, int slot)
+{
+	struct rtl838x_l2_entry e;
+
+	rtl83xx_l2_shadow_check(priv);
+
+	if (test_bit(slot, priv->l2_shadow_synced))
+		return &priv->l2_shadow[slot];
+
+	return rtl83xx_l2_shadow_read(priv, slot, &e);
+}
+
+/* Returns the first slot starting at slot which is either not in sync or holds an entry,
+ * which allows walking the tables without looking at slots known to be empty
+ * Caller must hold priv->reg_mutex
+ */
+int rtl83xx_l2_shadow_next(struct rtl838x_switch_priv *priv, int slot)
+{
+	int n = priv->fib_entries + L2_CAM_ENTRIES;
+
+	rtl83xx_l2_shadow_check(priv);
+
+	return min(find_next_bit(priv->l2_shadow_valid, n, slot),
+		   find_next_zero_bit(priv->l2_shadow_synced, n, slot));
+}
+
+/* Translates the hash key and position in the bucket as used by read_l2_entry_using_hash()
+ * into a slot of the L2 shadow. On the RTL93xx positions 4 to 7 are in the bucket given
+ * by the second hash algorithm in the upper 16 bits of the key
+ */
+int rtl83xx_l2_hash_slot(struct rtl838x_switch_priv *priv, u32 key, int pos)
+{
+	if (priv->l2_bucket_size > 4)
+		key = pos >= 4 ? key >> 16 : key & 0xffff;
+
+	return (key << 2) | (pos & 0x3);
+}
+
 /* Add an L2 nexthop entry for the L3 routing system / PIE forwarding in the SoC
  * Use VID and MAC in rtl838x_l2_entry to identify either a free slot in the L2 hash table
  * or mark an existing entry as a nexthop by setting it's nexthop bit
@@ -660,6 +976,7 @@ int rtl83xx_l2_nexthop_add(struct rtl838x_switch_priv *priv, struct rtl83xx_next
 	e.nh_vlan_target = false;
 
 	priv->r->write_l2_entry_using_hash(idx >> 2, idx & 0x3, &e);
+	rtl83xx_l2_shadow_invalidate(priv);
 
 	return 0;
 }
@@ -688,6 +1005,7 @@ int rtl83xx_l2_nexthop_rm(struct rtl838x_switch_priv *priv, struct rtl83xx_nexth
 	e.rvid = nh->rvid;
 
 	priv->r->write_l2_entry_using_hash(key, i, &e);
+	rtl83xx_l2_shadow_invalidate(priv);
 
 	return 0;
 }
@@ -745,6 +1063,22 @@ out:
 	return 0;
 }
 
+/* Called from the link change interrupt of all families. Besides phylink, the PHY
+ * of the port has to be told as well. Enabled ports switch their PHY from polling
+ * to PHY_MAC_INTERRUPT, so this is the only way it learns about the link going up
+ * or down.
+ */
+void rtl83xx_port_link_change(struct dsa_switch *ds, int port, bool up)
+{
+	struct rtl838x_switch_priv *priv = ds->priv;
+	struct phy_device *phydev = READ_ONCE(priv->ports[port].phydev);
+
+	if (phydev)
+		phy_mac_interrupt(phydev);
+
+	dsa_port_phylink_mac_change(ds, port, up);
+}
+
 /* Is the lower network device a DSA slave network device of our RTL930X-switch?
  * Unfortunately we cannot just follow dev->dsa_prt as this is only set for the
  * DSA master device.
@@ -863,11 +1197,13 @@ static int rtl83xx_l3_nexthop_update(struct rtl838x_switch_priv *priv,  __be32 i
 				r->pr.log_data = r->pr.packet_cntr;
 			}
 			priv->r->pie_rule_add(priv, &r->pr);
+			if (r->pr.packet_cntr >= 0)
+				r->last_cntr = priv->r->packet_cntr_read(r->pr.packet_cntr);
 		} else {
 			int pkts = priv->r->packet_cntr_read(r->pr.packet_cntr);
 			pr_info("%s: total packets: %d\n", __func__, pkts);
 
-			priv->r->pie_rule_write(priv, r->pr.id, &r->pr);
+			rtl83xx_pie_rule_update(priv, &r->pr);
 		}
 	}
 	rcu_read_unlock();
@@ -951,6 +1287,10 @@ static struct rtl83xx_route *rtl83xx_route_alloc(struct rtl838x_switch_priv *pri
 
 	idx = find_first_zero_bit(priv->route_use_bm, MAX_ROUTES);
 	pr_debug("%s id: %d, ip %pI4\n", __func__, idx, &ip);
+	if (idx >= MAX_ROUTES) {
+		mutex_unlock(&priv->reg_mutex);
+		return NULL;
+	}
 
 	r = kzalloc(sizeof(*r), GFP_KERNEL);
 	if (!r) {
@@ -992,6 +1332,10 @@ static struct rtl83xx_route *rtl83xx_host_route_alloc(struct rtl838x_switch_priv
 
 	idx = find_first_zero_bit(priv->host_route_use_bm, MAX_HOST_ROUTES);
 	pr_debug("%s id: %d, ip %pI4\n", __func__, idx, &ip);
+	if (idx >= MAX_HOST_ROUTES) {
+		mutex_unlock(&priv->reg_mutex);
+		return NULL;
+	}
 
 	r = kzalloc(sizeof(*r), GFP_KERNEL);
 	if (!r) {
@@ -1053,9 +1397,262 @@ static void rtl83xx_route_rm(struct rtl838x_switch_priv *priv, struct rtl83xx_ro
 		clear_bit(r->id, priv->route_use_bm);
 	}
 
+	list_del(&r->list);
+	fib_info_put(r->fri.fi);
 	kfree(r);
 }
 
+static void rtl83xx_fib4_rt_info(struct fib_rt_info *fri, const struct fib_entry_notifier_info *info)
+{
+	memset(fri, 0, sizeof(*fri));
+	fri->fi = info->fi;
+	fri->tb_id = info->tb_id;
+	fri->dst = htonl(info->dst);
+	fri->dst_len = info->dst_len;
+	fri->dscp = info->dscp;
+	fri->type = info->type;
+}
+
+/* Reports whether a route is forwarded or trapped by the hardware to the FIB */
+static void rtl83xx_route_hw_flags_set(struct rtl83xx_route *r, bool offload, bool trap)
+{
+	struct fib_nh *nh = fib_info_nh(r->fri.fi, 0);
+
+	r->fri.offload = offload;
+	r->fri.trap = trap;
+	fib_alias_hw_flags_set(&init_net, &r->fri);
+
+	if (offload || trap)
+		nh->fib_nh_flags |= RTNH_F_OFFLOAD;
+	else
+		nh->fib_nh_flags &= ~RTNH_F_OFFLOAD;
+}
+
+/* Removes a route together with its nexthop, PIE rule and packet counter from the
+ * hardware and frees it
+ * Caller must hold RTNL
+ */
+static void rtl83xx_route_release(struct rtl838x_switch_priv *priv, struct rtl83xx_route *r)
+{
+	rtl83xx_l2_nexthop_rm(priv, &r->nh);
+
+	if (r->pr.id >= 0) {
+		if (r->pr.packet_cntr >= 0) {
+			pr_debug("%s: Releasing packet counter %d\n", __func__, r->pr.packet_cntr);
+			set_bit(r->pr.packet_cntr, priv->packet_cntr_use_bm);
+		}
+		priv->r->pie_rule_rm(priv, &r->pr);
+	}
+
+	rtl83xx_route_rm(priv, r);
+}
+
+/* Makes room in the host route table by removing the least recently used host route
+ * from the hardware, the kernel keeps forwarding it in software. Routes trapping
+ * to the CPU are never evicted
+ * Caller must hold RTNL
+ */
+static int rtl83xx_host_route_evict(struct rtl838x_switch_priv *priv)
+{
+	struct rtl83xx_route *r, *lru = NULL;
+
+	list_for_each_entry(r, &priv->route_list, list) {
+		if (!r->is_host_route || r->attr.action == ROUTE_ACT_TRAP2CPU)
+			continue;
+		if (!lru || time_before(r->last_used, lru->last_used))
+			lru = r;
+	}
+
+	if (!lru)
+		return -ENOSPC;
+
+	pr_debug("%s: evicting host route %pI4, idle for %u ms\n", __func__, &lru->fri.dst,
+		 jiffies_to_msecs(jiffies - lru->last_used));
+
+	rtl83xx_route_hw_flags_set(lru, false, false);
+	rtl83xx_route_release(priv, lru);
+
+	return 0;
+}
+
+/* Periodically harvests the packet counters of the PIE rules of all offloaded routes
+ * to track their use, and keeps the neighbours of gateways the hardware forwards to
+ * from going stale, as these packets never reach the kernel
+ */
+static void rtl83xx_l3_stats_work_do(struct work_struct *work)
+{
+	struct rtl838x_switch_priv *priv =
+		container_of(to_delayed_work(work), struct rtl838x_switch_priv, l3_stats_work);
+	struct rtl83xx_route *r;
+	struct neighbour *n;
+	u32 cntr;
+
+	rtnl_lock();
+	list_for_each_entry(r, &priv->route_list, list) {
+		if (r->pr.id < 0 || r->pr.packet_cntr < 0)
+			continue;
+
+		cntr = priv->r->packet_cntr_read(r->pr.packet_cntr);
+		if (cntr == r->last_cntr)
+			continue;
+
+		r->packets += (u32)(cntr - r->last_cntr);
+		r->last_cntr = cntr;
+		r->last_used = jiffies;
+
+		n = neigh_lookup(&arp_tbl, &r->gw_ip, fib_info_nh(r->fri.fi, 0)->fib_nh_dev);
+		if (n) {
+			neigh_event_send(n, NULL);
+			neigh_release(n);
+		}
+	}
+	rtnl_unlock();
+
+	schedule_delayed_work(&priv->l3_stats_work, L3_STATS_INTERVAL);
+}
+
+#define RTL838X_STAT_PRVTE_DROP_COUNTERS	(0x6A00)
+#define RTL839X_STAT_PRVTE_DROP_COUNTERS	(0x3E00)
+#define RTL930X_STAT_PRVTE_DROP_COUNTERS	(0xB5B8)
+#define RTL931X_STAT_PRVTE_DROP_COUNTERS	(0xd800)
+
+static const char * const rtl838x_drop_cntr[] = {
+    "ALE_TX_GOOD_PKTS", "MAC_RX_DROP", "ACL_FWD_DROP", "HW_ATTACK_PREVENTION_DROP",
+    "RMA_DROP", "VLAN_IGR_FLTR_DROP", "INNER_OUTER_CFI_EQUAL_1_DROP", "PORT_MOVE_DROP",
+    "NEW_SA_DROP", "MAC_LIMIT_SYS_DROP", "MAC_LIMIT_VLAN_DROP", "MAC_LIMIT_PORT_DROP",
+    "SWITCH_MAC_DROP", "ROUTING_EXCEPTION_DROP", "DA_LKMISS_DROP", "RSPAN_DROP",
+    "ACL_LKMISS_DROP", "ACL_DROP", "INBW_DROP", "IGR_METER_DROP",
+    "ACCEPT_FRAME_TYPE_DROP", "STP_IGR_DROP", "INVALID_SA_DROP", "SA_BLOCKING_DROP",
+    "DA_BLOCKING_DROP", "L2_INVALID_DPM_DROP", "MCST_INVALID_DPM_DROP", "RX_FLOW_CONTROL_DROP",
+    "STORM_SPPRS_DROP", "LALS_DROP", "VLAN_EGR_FILTER_DROP", "STP_EGR_DROP",
+    "SRC_PORT_FILTER_DROP", "PORT_ISOLATION_DROP", "ACL_FLTR_DROP", "MIRROR_FLTR_DROP",
+    "TX_MAX_DROP", "LINK_DOWN_DROP", "FLOW_CONTROL_DROP", "BRIDGE .1d discards"
+};
+
+static const char * const rtl839x_drop_cntr[] = {
+    "ALE_TX_GOOD_PKTS", "ERROR_PKTS", "EGR_ACL_DROP", "EGR_METER_DROP",
+    "OAM", "CFM", "VLAN_IGR_FLTR", "VLAN_ERR",
+    "INNER_OUTER_CFI_EQUAL_1", "VLAN_TAG_FORMAT", "SRC_PORT_SPENDING_TREE", "INBW",
+    "RMA", "HW_ATTACK_PREVENTION", "PROTO_STORM", "MCAST_SA",
+    "IGR_ACL_DROP", "IGR_METER_DROP", "DFLT_ACTION_FOR_MISS_ACL_AND_C2SC", "NEW_SA",
+    "PORT_MOVE", "SA_BLOCKING", "ROUTING_EXCEPTION", "SRC_PORT_SPENDING_TREE_NON_FWDING",
+    "MAC_LIMIT", "UNKNOW_STORM", "MISS_DROP", "CPU_MAC_DROP",
+    "DA_BLOCKING", "SRC_PORT_FILTER_BEFORE_EGR_ACL", "VLAN_EGR_FILTER", "SPANNING_TRE",
+    "PORT_ISOLATION", "OAM_EGRESS_DROP", "MIRROR_ISOLATION", "MAX_LEN_BEFORE_EGR_ACL",
+    "SRC_PORT_FILTER_BEFORE_MIRROR", "MAX_LEN_BEFORE_MIRROR", "SPECIAL_CONGEST_BEFORE_MIRROR",
+    "LINK_STATUS_BEFORE_MIRROR",
+    "WRED_BEFORE_MIRROR", "MAX_LEN_AFTER_MIRROR", "SPECIAL_CONGEST_AFTER_MIRROR",
+    "LINK_STATUS_AFTER_MIRROR",
+    "WRED_AFTER_MIRROR"
+};
+
+static const char * const rtl930x_drop_cntr[] = {
+	"OAM_PARSER", "UC_RPF", "DEI_CFI", "MAC_IP_SUBNET_BASED_VLAN", "VLAN_IGR_FILTER",
+	"L2_UC_MC", "IPV_IP6_MC_BRIDGE", "PTP", "USER_DEF_0_3", "RESERVED",
+	"RESERVED1", "RESERVED2", "BPDU_RMA", "LACP", "LLDP",
+	"EAPOL", "XX_RMA", "L3_IPUC_NON_IP", "IP4_IP6_HEADER_ERROR", "L3_BAD_IP",
+	"L3_DIP_DMAC_MISMATCH", "IP4_IP_OPTION", "IP_UC_MC_ROUTING_LOOK_UP_MISS", "L3_DST_NULL_INTF",
+	"L3_PBR_NULL_INTF",
+	"HOST_NULL_INTF", "ROUTE_NULL_INTF", "BRIDGING_ACTION", "ROUTING_ACTION", "IPMC_RPF",
+	"L2_NEXTHOP_AGE_OUT", "L3_UC_TTL_FAIL", "L3_MC_TTL_FAIL", "L3_UC_MTU_FAIL", "L3_MC_MTU_FAIL",
+	"L3_UC_ICMP_REDIR", "IP6_MLD_OTHER_ACT", "ND", "IP_MC_RESERVED", "IP6_HBH",
+	"INVALID_SA", "L2_HASH_FULL", "NEW_SA", "PORT_MOVE_FORBID", "STATIC_PORT_MOVING",
+	"DYNMIC_PORT_MOVING", "L3_CRC", "MAC_LIMIT", "ATTACK_PREVENT", "ACL_FWD_ACTION",
+	"OAMPDU", "OAM_MUX", "TRUNK_FILTER", "ACL_DROP", "IGR_BW",
+	"ACL_METER", "VLAN_ACCEPT_FRAME_TYPE", "MSTP_SRC_DROP_DISABLED_BLOCKING", "SA_BLOCK", "DA_BLOCK",
+	"STORM_CONTROL", "VLAN_EGR_FILTER", "MSTP_DESTINATION_DROP", "SRC_PORT_FILTER", "PORT_ISOLATION",
+	"TX_MAX_FRAME_SIZE", "EGR_LINK_STATUS", "MAC_TX_DISABLE", "MAC_PAUSE_FRAME", "MAC_RX_DROP",
+	"MIRROR_ISOLATE", "RX_FC", "EGR_QUEUE", "HSM_RUNOUT", "ROUTING_DISABLE", "INVALID_L2_NEXTHOP_ENTRY",
+	"L3_MC_SRC_FLT", "CPUTAG_FLT", "FWD_PMSK_NULL", "IPUC_ROUTING_LOOKUP_MISS", "MY_DEV_DROP",
+	"STACK_NONUC_BLOCKING_PMSK", "STACK_PORT_NOT_FOUND", "ACL_LOOPBACK_DROP", "IP6_ROUTING_EXT_HEADER"
+};
+
+static const char * const rtl931x_drop_cntr[] = {
+	"ALE_RX_GOOD_PKTS", "RX_MAX_FRAME_SIZE", "MAC_RX_DROP", "OPENFLOW_IP_MPLS_TTL", "OPENFLOW_TBL_MISS",
+	"IGR_BW", "SPECIAL_CONGEST", "EGR_QUEUE", "RESERVED", "EGR_LINK_STATUS", "STACK_UCAST_NONUCAST_TTL", /* 10 */
+	"STACK_NONUC_BLOCKING_PMSK", "L2_CRC", "SRC_PORT_FILTER", "PARSER_PACKET_TOO_LONG", "PARSER_MALFORM_PACKET",
+	"MPLS_OVER_2_LBL", "EACL_METER", "IACL_METER", "PROTO_STORM", "INVALID_CAPWAP_HEADER", /* 20 */
+	"MAC_IP_SUBNET_BASED_VLAN", "OAM_PARSER", "UC_MC_RPF", "IP_MAC_BINDING_MATCH_MISMATCH", "SA_BLOCK",
+	"TUNNEL_IP_ADDRESS_CHECK", "EACL_DROP", "IACL_DROP", "ATTACK_PREVENT", "SYSTEM_PORT_LIMIT_LEARN", /* 30 */
+	"OAMPDU", "CCM_RX", "CFM_UNKNOWN_TYPE", "LBM_LBR_LTM_LTR", "Y_1731", "VLAN_LIMIT_LEARN",
+	"VLAN_ACCEPT_FRAME_TYPE", "CFI_1", "STATIC_DYNAMIC_PORT_MOVING", "PORT_MOVE_FORBID", /* 40 */
+	"L3_CRC", "BPDU_PTP_LLDP_EAPOL_RMA", "MSTP_SRC_DROP_DISABLED_BLOCKING", "INVALID_SA", "NEW_SA",
+	"VLAN_IGR_FILTER", "IGR_VLAN_CONVERT", "GRATUITOUS_ARP", "MSTP_SRC_DROP", "L2_HASH_FULL", /* 50 */
+	"MPLS_UNKNOWN_LBL", "L3_IPUC_NON_IP", "TTL", "MTU", "ICMP_REDIRECT", "STORM_CONTROL", "L3_DIP_DMAC_MISMATCH",
+	"IP4_IP_OPTION", "IP6_HBH_EXT_HEADER", "IP4_IP6_HEADER_ERROR", /* 60 */
+	"ROUTING_IP_ADDR_CHECK", "ROUTING_EXCEPTION", "DA_BLOCK", "OAM_MUX", "PORT_ISOLATION", "VLAN_EGR_FILTER",
+	"MIRROR_ISOLATE", "MSTP_DESTINATION_DROP", "L2_MC_BRIDGE", "IP_UC_MC_ROUTING_LOOK_UP_MISS", /* 70 */
+	"L2_UC", "L2_MC", "IP4_MC", "IP6_MC", "L3_UC_MC_ROUTE", "UNKNOWN_L2_UC_FLPM", "BC_FLPM",
+	"VLAN_PRO_UNKNOWN_L2_MC_FLPM", "VLAN_PRO_UNKNOWN_IP4_MC_FLPM", "VLAN_PROFILE_UNKNOWN_IP6_MC_FLPM", /* 80 */
+};
+
+/* Folds the private drop counters of the switch into 64-bit totals. The
+ * counters are 16 bits wide and wrap, so this must run well before 65536
+ * more drops of one reason can happen. Called with drop_cntr_mutex held
+ */
+void rtl83xx_drop_cntr_update(struct rtl838x_switch_priv *priv)
+{
+	struct rtl83xx_drop_cntr *d;
+	u16 v;
+
+	for (int i = 0; i < priv->n_drop_cntrs; i++) {
+		d = &priv->drop_cntrs[i];
+		v = sw_r32(priv->drop_cntr_base + (i << 2)) & 0xffff;
+		d->total += (u16)(v - d->last);
+		d->last = v;
+	}
+}
+
+static void rtl83xx_drop_stats_work_do(struct work_struct *work)
+{
+	struct rtl838x_switch_priv *priv =
+		container_of(to_delayed_work(work), struct rtl838x_switch_priv, drop_stats_work);
+
+	mutex_lock(&priv->drop_cntr_mutex);
+	rtl83xx_drop_cntr_update(priv);
+	mutex_unlock(&priv->drop_cntr_mutex);
+
+	schedule_delayed_work(&priv->drop_stats_work, DROP_STATS_INTERVAL);
+}
+
+static void rtl83xx_drop_cntr_init(struct rtl838x_switch_priv *priv)
+{
+	BUILD_BUG_ON(ARRAY_SIZE(rtl930x_drop_cntr) > MAX_DROP_COUNTERS);
+
+	switch (priv->family_id) {
+	case RTL8380_FAMILY_ID:
+		priv->drop_cntr_names = rtl838x_drop_cntr;
+		priv->n_drop_cntrs = ARRAY_SIZE(rtl838x_drop_cntr);
+		priv->drop_cntr_base = RTL838X_STAT_PRVTE_DROP_COUNTERS;
+		break;
+	case RTL8390_FAMILY_ID:
+		priv->drop_cntr_names = rtl839x_drop_cntr;
+		priv->n_drop_cntrs = ARRAY_SIZE(rtl839x_drop_cntr);
+		priv->drop_cntr_base = RTL839X_STAT_PRVTE_DROP_COUNTERS;
+		break;
+	case RTL9300_FAMILY_ID:
+		priv->drop_cntr_names = rtl930x_drop_cntr;
+		priv->n_drop_cntrs = ARRAY_SIZE(rtl930x_drop_cntr);
+		priv->drop_cntr_base = RTL930X_STAT_PRVTE_DROP_COUNTERS;
+		break;
+	case RTL9310_FAMILY_ID:
+		priv->drop_cntr_names = rtl931x_drop_cntr;
+		priv->n_drop_cntrs = ARRAY_SIZE(rtl931x_drop_cntr);
+		priv->drop_cntr_base = RTL931X_STAT_PRVTE_DROP_COUNTERS;
+		break;
+	}
+
+	mutex_init(&priv->drop_cntr_mutex);
+	INIT_DELAYED_WORK(&priv->drop_stats_work, rtl83xx_drop_stats_work_do);
+
+	/* Start counting from the current values */
+	rtl83xx_drop_cntr_update(priv);
+	for (int i = 0; i < priv->n_drop_cntrs; i++)
+		priv->drop_cntrs[i].total = 0;
+
+	schedule_delayed_work(&priv->drop_stats_work, DROP_STATS_INTERVAL);
+}
+
 static int rtl83xx_fib4_del(struct rtl838x_switch_priv *priv,
 			    struct fib_entry_notifier_info *info)
 {
@@ -1080,13 +1677,11 @@ static int rtl83xx_fib4_del(struct rtl838x_switch_priv *priv,
 	}
 	rcu_read_unlock();
 
-	rtl83xx_l2_nexthop_rm(priv, &r->nh);
-
-	pr_debug("%s: Releasing packet counter %d\n", __func__, r->pr.packet_cntr);
-	set_bit(r->pr.packet_cntr, priv->packet_cntr_use_bm);
-	priv->r->pie_rule_rm(priv, &r->pr);
+	/* The route may have been evicted from the hardware already */
+	if (!r || r->dst_ip != info->dst || r->prefix_len != info->dst_len)
+		return -ENOENT;
 
-	rtl83xx_route_rm(priv, r);
+	rtl83xx_route_release(priv, r);
 
 	nh->fib_nh_flags &= ~RTNH_F_OFFLOAD;
 
@@ -1217,17 +1812,32 @@ static int rtl83xx_fib4_add(struct rtl838x_switch_priv *priv,
 	if ((info->dst & 0xff000000) == 0x7f000000)
 		return 0;
 
-	/* Allocate route or host-route (entry if hardware supports this) */
-	if (info->dst_len == 32 && priv->r->host_route_write)
+	/* Allocate route or host-route (entry if hardware supports this), when the
+	 * host route table is full the least recently used host route makes room
+	 */
+	if (info->dst_len == 32 && priv->r->host_route_write) {
 		r = rtl83xx_host_route_alloc(priv, nh->fib_nh_gw4);
-	else
+		if (!r && !rtl83xx_host_route_evict(priv))
+			r = rtl83xx_host_route_alloc(priv, nh->fib_nh_gw4);
+	} else {
 		r = rtl83xx_route_alloc(priv, nh->fib_nh_gw4);
+	}
 
 	if (!r) {
+		struct fib_rt_info fri;
+
 		pr_err("%s: No more free route entries\n", __func__);
+		rtl83xx_fib4_rt_info(&fri, info);
+		fri.offload_failed = true;
+		fib_alias_hw_flags_set(&init_net, &fri);
 		return -1;
 	}
 
+	rtl83xx_fib4_rt_info(&r->fri, info);
+	fib_info_hold(r->fri.fi);
+	r->last_used = jiffies;
+	list_add_tail(&r->list, &priv->route_list);
+
 	r->dst_ip = info->dst;
 	r->prefix_len = info->dst_len;
 	r->nh.rvid = vlan;
@@ -1265,7 +1875,7 @@ static int rtl83xx_fib4_add(struct rtl838x_switch_priv *priv,
 	if (!to_localhost)
 		rtl83xx_port_ipv4_resolve(priv, dev, nh->fib_nh_gw4);
 
-	nh->fib_nh_flags |= RTNH_F_OFFLOAD;
+	rtl83xx_route_hw_flags_set(r, !to_localhost, to_localhost);
 
 	return 0;
 
@@ -1462,6 +2072,26 @@ static int rtl83xx_fib_event(struct notifier_block *this, unsigned long event, v
 	return NOTIFY_DONE;
 }
 
+/* The ethernet driver forwards the L2 learning and aging notifications of the SoC as
+ * switchdev FDB events on the bridged user ports. Mark the dynamic entries of
+ * the L2 shadow stale, we are in atomic context here.
+ */
+static int rtl83xx_switchdev_event(struct notifier_block *this, unsigned long event, void *ptr)
+{
+	struct rtl838x_switch_priv *priv = container_of(this, struct rtl838x_switch_priv, swdev_nb);
+	struct net_device *dev = switchdev_notifier_info_to_dev(ptr);
+
+	switch (event) {
+	case SWITCHDEV_FDB_ADD_TO_BRIDGE:
+	case SWITCHDEV_FDB_DEL_TO_BRIDGE:
+		if (rtl83xx_port_is_under(dev, priv) >= 0)
+			WRITE_ONCE(priv->l2_shadow_learned, true);
+		break;
+	}
+
+	return NOTIFY_DONE;
+}
+
 static int __init rtl83xx_sw_probe(struct platform_device *pdev)
 {
 	int i, err = 0;
@@ -1564,6 +2194,10 @@ static int __init rtl83xx_sw_probe(struct platform_device *pdev)
 	}
 	pr_debug("Chip version %c\n", priv->version);
 
+	err = rtl83xx_l2_shadow_init(priv);
+	if (err)
+		return err;
+
 	for (i = 0; i <= priv->cpu_port; i++) {
 		switch (soc_info.family) {
 		case RTL8380_FAMILY_ID:
@@ -1593,6 +2227,7 @@ static int __init rtl83xx_sw_probe(struct platform_device *pdev)
 		dev_err(dev, "Error registering switch: %d\n", err);
 		return err;
 	}
+	platform_set_drvdata(pdev, priv);
 
 	/* dsa_to_port returns dsa_port from the port list in
 	 * dsa_switch_tree, the tree is built when the switch
@@ -1629,6 +2264,8 @@ static int __init rtl83xx_sw_probe(struct platform_device *pdev)
 	}
 	if (err) {
 		dev_err(dev, "Error setting up switch interrupt.\n");
+		/* PHYs keep being polled then */
+		priv->link_state_irq = err;
 		/* Need to free allocated switch here */
 	}
 
@@ -1656,6 +2293,8 @@ static int __init rtl83xx_sw_probe(struct platform_device *pdev)
 
 	/* Initialize hash table for L3 routing */
 	rhltable_init(&priv->routes, &route_ht_params);
+	INIT_LIST_HEAD(&priv->route_list);
+	INIT_DELAYED_WORK(&priv->l3_stats_work, rtl83xx_l3_stats_work_do);
 
 	/* Register netevent notifier callback to catch notifications about neighboring
 	 * changes to update nexthop entries for L3 routing.
@@ -1678,6 +2317,13 @@ static int __init rtl83xx_sw_probe(struct platform_device *pdev)
 	if (err)
 		goto err_register_fib_nb;
 
+	priv->swdev_nb.notifier_call = rtl83xx_switchdev_event;
+	err = register_switchdev_notifier(&priv->swdev_nb);
+	if (err)
+		goto err_register_swdev_nb;
+
+	rtl83xx_drop_cntr_init(priv);
+
 	/* TODO: put this into l2_setup() */
 	/* Flood BPDUs to all ports including cpu-port */
 	if (soc_info.family != RTL9300_FAMILY_ID) {
@@ -1692,8 +2338,13 @@ static int __init rtl83xx_sw_probe(struct platform_device *pdev)
 		rtl930x_dbgfs_init(priv);
 	}
 
+	if (priv->r->packet_cntr_read)
+		schedule_delayed_work(&priv->l3_stats_work, L3_STATS_INTERVAL);
+
 	return 0;
 
+err_register_swdev_nb:
+	unregister_fib_notifier(&init_net, &priv->fib_nb);
 err_register_fib_nb:
 	unregister_netevent_notifier(&priv->ne_nb);
 err_register_ne_nb:
@@ -1704,9 +2355,15 @@ err_register_nb:
 
 static int rtl83xx_sw_remove(struct platform_device *pdev)
 {
+	struct rtl838x_switch_priv *priv = platform_get_drvdata(pdev);
+
 	/* TODO: */
 	pr_debug("Removing platform driver for rtl83xx-sw\n");
 
+	/* priv is freed with the device, stop the periodic work using it */
+	if (priv && priv->ds->setup)
+		rtl83xx_tc_fini(priv);
+
 	return 0;
 }
 
@@ -2,6 +2,7 @@
 
 #include <linux/debugfs.h>
 #include <linux/kernel.h>
+#include <linux/rtnetlink.h>
 #include <asm/mach-rtl838x/mach-rtl83xx.h>
 
 #include "rtl83xx.h"
@@ -32,11 +33,6 @@
 #define RTL839X_MIR_RSPAN_TX_TAG_EN_CTRL	(0x2554)
 #define RTL839X_MIR_SAMPLE_RATE_CTRL		(0x2558)
 
-#define RTL838X_STAT_PRVTE_DROP_COUNTERS	(0x6A00)
-#define RTL839X_STAT_PRVTE_DROP_COUNTERS	(0x3E00)
-#define RTL930X_STAT_PRVTE_DROP_COUNTERS	(0xB5B8)
-#define RTL931X_STAT_PRVTE_DROP_COUNTERS	(0xd800)
-
 int rtl83xx_port_get_stp_state(struct rtl838x_switch_priv *priv, int port);
 void rtl83xx_port_stp_state_set(struct dsa_switch *ds, int port, u8 state);
 void rtl83xx_fast_age(struct dsa_switch *ds, int port);
@@ -46,76 +42,6 @@ int rtl838x_set_egress_rate(struct rtl838x_switch_priv *priv, int port, u32 rate
 int rtl839x_set_egress_rate(struct rtl838x_switch_priv *priv, int port, u32 rate);
 
 
-const char *rtl838x_drop_cntr[] = {
-    "ALE_TX_GOOD_PKTS", "MAC_RX_DROP", "ACL_FWD_DROP", "HW_ATTACK_PREVENTION_DROP",
-    "RMA_DROP", "VLAN_IGR_FLTR_DROP", "INNER_OUTER_CFI_EQUAL_1_DROP", "PORT_MOVE_DROP",
-    "NEW_SA_DROP", "MAC_LIMIT_SYS_DROP", "MAC_LIMIT_VLAN_DROP", "MAC_LIMIT_PORT_DROP",
-    "SWITCH_MAC_DROP", "ROUTING_EXCEPTION_DROP", "DA_LKMISS_DROP", "RSPAN_DROP",
-    "ACL_LKMISS_DROP", "ACL_DROP", "INBW_DROP", "IGR_METER_DROP",
-    "ACCEPT_FRAME_TYPE_DROP", "STP_IGR_DROP", "INVALID_SA_DROP", "SA_BLOCKING_DROP",
-    "DA_BLOCKING_DROP", "L2_INVALID_DPM_DROP", "MCST_INVALID_DPM_DROP", "RX_FLOW_CONTROL_DROP",
-    "STORM_SPPRS_DROP", "LALS_DROP", "VLAN_EGR_FILTER_DROP", "STP_EGR_DROP",
-    "SRC_PORT_FILTER_DROP", "PORT_ISOLATION_DROP", "ACL_FLTR_DROP", "MIRROR_FLTR_DROP",
-    "TX_MAX_DROP", "LINK_DOWN_DROP", "FLOW_CONTROL_DROP", "BRIDGE .1d discards"
-};
-
-const char *rtl839x_drop_cntr[] = {
-    "ALE_TX_GOOD_PKTS", "ERROR_PKTS", "EGR_ACL_DROP", "EGR_METER_DROP",
-    "OAM", "CFM" "VLAN_IGR_FLTR", "VLAN_ERR",
-    "INNER_OUTER_CFI_EQUAL_1", "VLAN_TAG_FORMAT", "SRC_PORT_SPENDING_TREE", "INBW",
-    "RMA", "HW_ATTACK_PREVENTION", "PROTO_STORM", "MCAST_SA",
-    "IGR_ACL_DROP", "IGR_METER_DROP", "DFLT_ACTION_FOR_MISS_ACL_AND_C2SC", "NEW_SA",
-    "PORT_MOVE", "SA_BLOCKING", "ROUTING_EXCEPTION", "SRC_PORT_SPENDING_TREE_NON_FWDING",
-    "MAC_LIMIT", "UNKNOW_STORM", "MISS_DROP", "CPU_MAC_DROP",
-    "DA_BLOCKING", "SRC_PORT_FILTER_BEFORE_EGR_ACL", "VLAN_EGR_FILTER", "SPANNING_TRE",
-    "PORT_ISOLATION", "OAM_EGRESS_DROP", "MIRROR_ISOLATION", "MAX_LEN_BEFORE_EGR_ACL",
-    "SRC_PORT_FILTER_BEFORE_MIRROR", "MAX_LEN_BEFORE_MIRROR", "SPECIAL_CONGEST_BEFORE_MIRROR",
-    "LINK_STATUS_BEFORE_MIRROR",
-    "WRED_BEFORE_MIRROR", "MAX_LEN_AFTER_MIRROR", "SPECIAL_CONGEST_AFTER_MIRROR",
-    "LINK_STATUS_AFTER_MIRROR",
-    "WRED_AFTER_MIRROR"
-};
-
-const char *rtl930x_drop_cntr[] = {
-	"OAM_PARSER", "UC_RPF", "DEI_CFI", "MAC_IP_SUBNET_BASED_VLAN", "VLAN_IGR_FILTER",
-	"L2_UC_MC", "IPV_IP6_MC_BRIDGE", "PTP", "USER_DEF_0_3", "RESERVED",
-	"RESERVED1", "RESERVED2", "BPDU_RMA", "LACP", "LLDP",
-	"EAPOL", "XX_RMA", "L3_IPUC_NON_IP", "IP4_IP6_HEADER_ERROR", "L3_BAD_IP",
-	"L3_DIP_DMAC_MISMATCH", "IP4_IP_OPTION", "IP_UC_MC_ROUTING_LOOK_UP_MISS", "L3_DST_NULL_INTF",
-	"L3_PBR_NULL_INTF",
-	"HOST_NULL_INTF", "ROUTE_NULL_INTF", "BRIDGING_ACTION", "ROUTING_ACTION", "IPMC_RPF",
-	"L2_NEXTHOP_AGE_OUT", "L3_UC_TTL_FAIL", "L3_MC_TTL_FAIL", "L3_UC_MTU_FAIL", "L3_MC_MTU_FAIL",
-	"L3_UC_ICMP_REDIR", "IP6_MLD_OTHER_ACT", "ND", "IP_MC_RESERVED", "IP6_HBH",
-	"INVALID_SA", "L2_HASH_FULL", "NEW_SA", "PORT_MOVE_FORBID", "STATIC_PORT_MOVING",
-	"DYNMIC_PORT_MOVING", "L3_CRC", "MAC_LIMIT", "ATTACK_PREVENT", "ACL_FWD_ACTION",
-	"OAMPDU", "OAM_MUX", "TRUNK_FILTER", "ACL_DROP", "IGR_BW",
-	"ACL_METER", "VLAN_ACCEPT_FRAME_TYPE", "MSTP_SRC_DROP_DISABLED_BLOCKING", "SA_BLOCK", "DA_BLOCK",
-	"STORM_CONTROL", "VLAN_EGR_FILTER", "MSTP_DESTINATION_DROP", "SRC_PORT_FILTER", "PORT_ISOLATION",
-	"TX_MAX_FRAME_SIZE", "EGR_LINK_STATUS", "MAC_TX_DISABLE", "MAC_PAUSE_FRAME", "MAC_RX_DROP",
-	"MIRROR_ISOLATE", "RX_FC", "EGR_QUEUE", "HSM_RUNOUT", "ROUTING_DISABLE", "INVALID_L2_NEXTHOP_ENTRY",
-	"L3_MC_SRC_FLT", "CPUTAG_FLT", "FWD_PMSK_NULL", "IPUC_ROUTING_LOOKUP_MISS", "MY_DEV_DROP",
-	"STACK_NONUC_BLOCKING_PMSK", "STACK_PORT_NOT_FOUND", "ACL_LOOPBACK_DROP", "IP6_ROUTING_EXT_HEADER"
-};
-
-const char *rtl931x_drop_cntr[] = {
-	"ALE_RX_GOOD_PKTS", "RX_MAX_FRAME_SIZE", "MAC_RX_DROP", "OPENFLOW_IP_MPLS_TTL", "OPENFLOW_TBL_MISS",
-	"IGR_BW", "SPECIAL_CONGEST", "EGR_QUEUE", "RESERVED", "EGR_LINK_STATUS", "STACK_UCAST_NONUCAST_TTL", /* 10 */
-	"STACK_NONUC_BLOCKING_PMSK", "L2_CRC", "SRC_PORT_FILTER", "PARSER_PACKET_TOO_LONG", "PARSER_MALFORM_PACKET",
-	"MPLS_OVER_2_LBL", "EACL_METER", "IACL_METER", "PROTO_STORM", "INVALID_CAPWAP_HEADER", /* 20 */
-	"MAC_IP_SUBNET_BASED_VLAN", "OAM_PARSER", "UC_MC_RPF", "IP_MAC_BINDING_MATCH_MISMATCH", "SA_BLOCK",
-	"TUNNEL_IP_ADDRESS_CHECK", "EACL_DROP", "IACL_DROP", "ATTACK_PREVENT", "SYSTEM_PORT_LIMIT_LEARN", /* 30 */
-	"OAMPDU", "CCM_RX", "CFM_UNKNOWN_TYPE", "LBM_LBR_LTM_LTR", "Y_1731", "VLAN_LIMIT_LEARN",
-	"VLAN_ACCEPT_FRAME_TYPE", "CFI_1", "STATIC_DYNAMIC_PORT_MOVING", "PORT_MOVE_FORBID", /* 40 */
-	"L3_CRC", "BPDU_PTP_LLDP_EAPOL_RMA", "MSTP_SRC_DROP_DISABLED_BLOCKING", "INVALID_SA", "NEW_SA",
-	"VLAN_IGR_FILTER", "IGR_VLAN_CONVERT", "GRATUITOUS_ARP", "MSTP_SRC_DROP", "L2_HASH_FULL", /* 50 */
-	"MPLS_UNKNOWN_LBL", "L3_IPUC_NON_IP", "TTL", "MTU", "ICMP_REDIRECT", "STORM_CONTROL", "L3_DIP_DMAC_MISMATCH",
-	"IP4_IP_OPTION", "IP6_HBH_EXT_HEADER", "IP4_IP6_HEADER_ERROR", /* 60 */
-	"ROUTING_IP_ADDR_CHECK", "ROUTING_EXCEPTION", "DA_BLOCK", "OAM_MUX", "PORT_ISOLATION", "VLAN_EGR_FILTER",
-	"MIRROR_ISOLATE", "MSTP_DESTINATION_DROP", "L2_MC_BRIDGE", "IP_UC_MC_ROUTING_LOOK_UP_MISS", /* 70 */
-	"L2_UC", "L2_MC", "IP4_MC", "IP6_MC", "L3_UC_MC_ROUTE", "UNKNOWN_L2_UC_FLPM", "BC_FLPM",
-	"VLAN_PRO_UNKNOWN_L2_MC_FLPM", "VLAN_PRO_UNKNOWN_IP4_MC_FLPM", "VLAN_PROFILE_UNKNOWN_IP6_MC_FLPM", /* 80 */
-};
-
 static ssize_t rtl838x_common_read(char __user *buffer, size_t count,
 					loff_t *ppos, unsigned int value)
 {
@@ -204,50 +130,21 @@ static ssize_t drop_counter_read(struct file *filp, char __user *buffer, size_t
 			     loff_t *ppos)
 {
 	struct rtl838x_switch_priv *priv = filp->private_data;
-	const char **d;
-	u32 v;
 	char *buf;
-	int n = 0, len, offset;
-	int num;
-
-	switch (priv->family_id) {
-	case RTL8380_FAMILY_ID:
-		d = rtl838x_drop_cntr;
-		offset = RTL838X_STAT_PRVTE_DROP_COUNTERS;
-		num = 40;
-		break;
-	case RTL8390_FAMILY_ID:
-		d = rtl839x_drop_cntr;
-		offset = RTL839X_STAT_PRVTE_DROP_COUNTERS;
-		num = 45;
-		break;
-	case RTL9300_FAMILY_ID:
-		d = rtl930x_drop_cntr;
-		offset = RTL930X_STAT_PRVTE_DROP_COUNTERS;
-		num = 85;
-		break;
-	case RTL9310_FAMILY_ID:
-		d = rtl931x_drop_cntr;
-		offset = RTL931X_STAT_PRVTE_DROP_COUNTERS;
-		num = 81;
-		break;
-	}
+	int n = 0, len;
 
-	buf = kmalloc(30 * num, GFP_KERNEL);
+	buf = kmalloc(48 * priv->n_drop_cntrs + 1, GFP_KERNEL);
 	if (!buf)
 		return -ENOMEM;
 
-	for (int i = 0; i < num; i++) {
-		v = sw_r32(offset + (i << 2)) & 0xffff;
-		n += sprintf(buf + n, "%s: %d\n", d[i], v);
-	}
-
-	if (count < strlen(buf)) {
-		kfree(buf);
-		return -ENOSPC;
-	}
+	mutex_lock(&priv->drop_cntr_mutex);
+	rtl83xx_drop_cntr_update(priv);
+	for (int i = 0; i < priv->n_drop_cntrs; i++)
+		n += scnprintf(buf + n, 48 * priv->n_drop_cntrs + 1 - n, "%s: %llu\n",
+			       priv->drop_cntr_names[i], priv->drop_cntrs[i].total);
+	mutex_unlock(&priv->drop_cntr_mutex);
 
-	len = simple_read_from_buffer(buffer, count, ppos, buf, strlen(buf));
+	len = simple_read_from_buffer(buffer, count, ppos, buf, n);
 	kfree(buf);
 
 	return len;
@@ -364,6 +261,38 @@ static const struct file_operations l2_table_fops = {
 	.release = single_release,
 };
 
+static int l3_routes_show(struct seq_file *m, void *v)
+{
+	struct rtl838x_switch_priv *priv = m->private;
+	struct rtl83xx_route *r;
+
+	rtnl_lock();
+
+	list_for_each_entry(r, &priv->route_list, list) {
+		seq_printf(m, "Route %d %pI4/%d via %pI4 %s", r->id, &r->fri.dst, r->prefix_len,
+			   &r->gw_ip, r->is_host_route ? "host" : "prefix");
+		seq_printf(m, " packets %llu idle %u ms\n", r->packets,
+			   jiffies_to_msecs(jiffies - r->last_used));
+	}
+
+	rtnl_unlock();
+
+	return 0;
+}
+
+static int l3_routes_open(struct inode *inode, struct file *filp)
+{
+	return single_open(filp, l3_routes_show, inode->i_private);
+}
+
+static const struct file_operations l3_routes_fops = {
+	.owner = THIS_MODULE,
+	.open = l3_routes_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
 static ssize_t age_out_read(struct file *filp, char __user *buffer, size_t count,
 			     loff_t *ppos)
 {
@@ -697,6 +626,11 @@ void rtl838x_dbgfs_init(struct rtl838x_switch_priv *priv)
 
 	debugfs_create_file("l2_table", 0400, rtl838x_dir, priv, &l2_table_fops);
 
+	debugfs_create_file("l3_routes", 0400, rtl838x_dir, priv, &l3_routes_fops);
+
+	debugfs_create_u32("fdb_dump_last_us", 0444, rtl838x_dir, &priv->fdb_dump_last_us);
+	debugfs_create_u32("fdb_dump_max_us", 0644, rtl838x_dir, &priv->fdb_dump_max_us);
+
 	return;
 err:
 	rtl838x_dbgfs_cleanup(priv);
@@ -716,4 +650,9 @@ void rtl930x_dbgfs_init(struct rtl838x_switch_priv *priv)
 	debugfs_create_file("drop_counters", 0400, dbg_dir, priv, &drop_counter_fops);
 
 	debugfs_create_file("l2_table", 0400, dbg_dir, priv, &l2_table_fops);
+
+	debugfs_create_file("l3_routes", 0400, dbg_dir, priv, &l3_routes_fops);
+
+	debugfs_create_u32("fdb_dump_last_us", 0444, dbg_dir, &priv->fdb_dump_last_us);
+	debugfs_create_u32("fdb_dump_max_us", 0644, dbg_dir, &priv->fdb_dump_max_us);
 }
@@ -249,13 +249,21 @@ static int rtl83xx_setup(struct dsa_switch *ds)
 	else
 		sw_w32(0x2, RTL839X_SPCL_TRAP_SWITCH_MAC_CTRL);
 
+	/* PHY packages may still be patched in the background */
+	rtl83xx_phy_wait_configured();
+
 	/* Enable MAC Polling PHY again */
 	rtl83xx_enable_phy_polling(priv);
 	pr_debug("Please wait until PHY is settled\n");
 	msleep(1000);
 	priv->r->pie_init(priv);
 
-	return 0;
+	return rtl83xx_tc_init(priv);
+}
+
+static void rtl83xx_teardown(struct dsa_switch *ds)
+{
+	rtl83xx_tc_fini(ds->priv);
 }
 
 static int rtl93xx_setup(struct dsa_switch *ds)
@@ -308,7 +316,7 @@ static int rtl93xx_setup(struct dsa_switch *ds)
 
 	priv->r->led_init(priv);
 
-	return 0;
+	return rtl83xx_tc_init(priv);
 }
 
 static int rtl93xx_get_sds(struct phy_device *phydev)
@@ -969,14 +977,28 @@ static void rtl93xx_phylink_mac_link_up(struct dsa_switch *ds, int port,
 	/* TODO: Set speed/duplex/pauses */
 }
 
+/* The private drop counters of the switch count the packets dropped for each
+ * reason, for all ports together. They are reported with the stats of the CPU
+ * port, which DSA adds to those of the conduit interface
+ */
+static int rtl83xx_port_n_drop_cntrs(struct rtl838x_switch_priv *priv, int port)
+{
+	return port == priv->cpu_port ? priv->n_drop_cntrs : 0;
+}
+
 static void rtl83xx_get_strings(struct dsa_switch *ds,
 				int port, u32 stringset, u8 *data)
 {
+	struct rtl838x_switch_priv *priv = ds->priv;
+
 	if (stringset != ETH_SS_STATS)
 		return;
 
 	for (int i = 0; i < ARRAY_SIZE(rtl83xx_mib); i++)
 		ethtool_puts(&data, rtl83xx_mib[i].name);
+
+	for (int i = 0; i < rtl83xx_port_n_drop_cntrs(priv, port); i++)
+		ethtool_puts(&data, priv->drop_cntr_names[i]);
 }
 
 static void rtl83xx_get_ethtool_stats(struct dsa_switch *ds, int port,
@@ -984,6 +1006,7 @@ static void rtl83xx_get_ethtool_stats(struct dsa_switch *ds, int port,
 {
 	struct rtl838x_switch_priv *priv = ds->priv;
 	const struct rtl83xx_mib_desc *mib;
+	int n_drop = rtl83xx_port_n_drop_cntrs(priv, port);
 	u64 h;
 
 	for (int i = 0; i < ARRAY_SIZE(rtl83xx_mib); i++) {
@@ -995,14 +1018,26 @@ static void rtl83xx_get_ethtool_stats(struct dsa_switch *ds, int port,
 			data[i] |= h << 32;
 		}
 	}
+
+	if (!n_drop)
+		return;
+
+	data += ARRAY_SIZE(rtl83xx_mib);
+	mutex_lock(&priv->drop_cntr_mutex);
+	rtl83xx_drop_cntr_update(priv);
+	for (int i = 0; i < n_drop; i++)
+		data[i] = priv->drop_cntrs[i].total;
+	mutex_unlock(&priv->drop_cntr_mutex);
 }
 
 static int rtl83xx_get_sset_count(struct dsa_switch *ds, int port, int sset)
 {
+	struct rtl838x_switch_priv *priv = ds->priv;
+
 	if (sset != ETH_SS_STATS)
 		return 0;
 
-	return ARRAY_SIZE(rtl83xx_mib);
+	return ARRAY_SIZE(rtl83xx_mib) + rtl83xx_port_n_drop_cntrs(priv, port);
 }
 
 static int rtl83xx_mc_group_alloc(struct rtl838x_switch_priv *priv, int port)
@@ -1083,6 +1118,12 @@ static int rtl83xx_port_enable(struct dsa_switch *ds, int port,
 	if (priv->ports[port].sds_num < 0)
 		priv->ports[port].sds_num = rtl93xx_get_sds(phydev);
 
+	/* The switch polls the PHY itself and raises an interrupt on link changes */
+	if (phydev && priv->link_state_irq > 0) {
+		phydev->irq = PHY_MAC_INTERRUPT;
+		WRITE_ONCE(priv->ports[port].phydev, phydev);
+	}
+
 	return 0;
 }
 
@@ -1096,6 +1137,8 @@ static void rtl83xx_port_disable(struct dsa_switch *ds, int port)
 	if (!dsa_is_user_port(ds, port))
 		return;
 
+	WRITE_ONCE(priv->ports[port].phydev, NULL);
+
 	/* BUG: This does not work on RTL931X */
 	/* remove port from switch mask of CPU_PORT */
 	priv->r->traffic_disable(priv->cpu_port, port);
@@ -1336,6 +1379,7 @@ void rtl83xx_fast_age(struct dsa_switch *ds, int port)
 	sw_w32(1 << (26 + s) | 1 << (23 + s) | port << (5 + (s / 2)), priv->r->l2_tbl_flush_ctrl);
 
 	do { } while (sw_r32(priv->r->l2_tbl_flush_ctrl) & BIT(26 + s));
+	rtl83xx_l2_shadow_flush(priv);
 
 	mutex_unlock(&priv->reg_mutex);
 }
@@ -1351,6 +1395,7 @@ void rtl931x_fast_age(struct dsa_switch *ds, int port)
 	sw_w32(BIT(24) | BIT(28), RTL931X_L2_TBL_FLUSH_CTRL);
 
 	do { } while (sw_r32(RTL931X_L2_TBL_FLUSH_CTRL) & BIT (28));
+	rtl83xx_l2_shadow_flush(priv);
 
 	mutex_unlock(&priv->reg_mutex);
 }
@@ -1369,6 +1414,7 @@ void rtl930x_fast_age(struct dsa_switch *ds, int port)
 	sw_w32(BIT(26) | BIT(30), RTL930X_L2_TBL_FLUSH_CTRL);
 
 	do { } while (sw_r32(priv->r->l2_tbl_flush_ctrl) & BIT(30));
+	rtl83xx_l2_shadow_flush(priv);
 
 	mutex_unlock(&priv->reg_mutex);
 }
@@ -1590,25 +1636,38 @@ static void rtl83xx_setup_l2_mc_entry(struct rtl838x_l2_entry *e, int vid, u64 m
  * Returns the filled in rtl838x_l2_entry and the index in the bucket when an entry was found
  * when an empty slot was found and must exist is false, the index of the slot is returned
  * when no slots are available returns -1
+ * The bucket is searched in the L2 shadow, only a matching entry is read from the SoC
  */
 static int rtl83xx_find_l2_hash_entry(struct rtl838x_switch_priv *priv, u64 seed,
 				     bool must_exist, struct rtl838x_l2_entry *e)
 {
+	const struct rtl83xx_l2_shadow *s;
 	int idx = -1;
 	u32 key = priv->r->l2_hash_key(priv, seed);
-	u64 entry;
+	int slot;
 
 	pr_debug("%s: using key %x, for seed %016llx\n", __func__, key, seed);
 	/* Loop over all entries in the hash-bucket and over the second block on 93xx SoCs */
 	for (int i = 0; i < priv->l2_bucket_size; i++) {
-		entry = priv->r->read_l2_entry_using_hash(key, i, e);
+		slot = rtl83xx_l2_hash_slot(priv, key, i);
+		s = rtl83xx_l2_shadow_get(priv, slot);
+		if (s->valid && s->seed != seed)
+			continue;
+
+		if (s->valid) {
+			/* Fetch the full entry, the hardware may have aged it out meanwhile */
+			s = rtl83xx_l2_shadow_read(priv, slot, e);
+			if (s->valid && s->seed != seed)
+				continue;
+		} else {
+			memset(e, 0, sizeof(*e));
+		}
 		pr_debug("valid %d, mac %016llx\n", e->valid, ether_addr_to_u64(&e->mac[0]));
 		if (must_exist && !e->valid)
 			continue;
-		if (!e->valid || ((entry & 0x0fffffffffffffffULL) == seed)) {
-			idx = i > 3 ? ((key >> 14) & 0xffff) | i >> 1 : ((key << 2) | i) & 0xffff;
-			break;
-		}
+
+		idx = i > 3 ? ((key >> 14) & 0xffff) | i >> 1 : ((key << 2) | i) & 0xffff;
+		break;
 	}
 
 	return idx;
@@ -1618,27 +1677,30 @@ static int rtl83xx_find_l2_hash_entry(struct rtl838x_switch_priv *priv, u64 seed
  * Returns the filled in rtl838x_l2_entry and the index in the CAM when an entry was found
  * when an empty slot was found the index of the slot is returned
  * when no slots are available returns -1
+ * Like for the hash table, the CAM is searched in the L2 shadow
  */
 static int rtl83xx_find_l2_cam_entry(struct rtl838x_switch_priv *priv, u64 seed,
 				     bool must_exist, struct rtl838x_l2_entry *e)
 {
-	int idx = -1;
-	u64 entry;
+	const struct rtl83xx_l2_shadow *s;
+	int slot;
 
-	for (int i = 0; i < 64; i++) {
-		entry = priv->r->read_cam(i, e);
-		if (!must_exist && !e->valid) {
-			if (idx < 0) /* First empty entry? */
-				idx = i;
-			break;
-		} else if ((entry & 0x0fffffffffffffffULL) == seed) {
+	for (int i = 0; i < L2_CAM_ENTRIES; i++) {
+		slot = priv->fib_entries + i;
+		s = rtl83xx_l2_shadow_get(priv, slot);
+		if (s->valid && s->seed == seed)
+			s = rtl83xx_l2_shadow_read(priv, slot, e);
+
+		if (!must_exist && !s->valid) { /* First empty entry */
+			memset(e, 0, sizeof(*e));
+			return i;
+		} else if (s->valid && s->seed == seed) {
 			pr_debug("Found entry in CAM\n");
-			idx = i;
-			break;
+			return i;
 		}
 	}
 
-	return idx;
+	return -1;
 }
 
 static int rtl83xx_port_fdb_add(struct dsa_switch *ds, int port,
@@ -1664,6 +1726,7 @@ static int rtl83xx_port_fdb_add(struct dsa_switch *ds, int port,
 	if (idx >= 0) {
 		rtl83xx_setup_l2_uc_entry(&e, port, vid, mac);
 		priv->r->write_l2_entry_using_hash(idx >> 2, idx & 0x3, &e);
+		rtl83xx_l2_shadow_update(priv, idx, seed, &e);
 		goto out;
 	}
 
@@ -1673,6 +1736,7 @@ static int rtl83xx_port_fdb_add(struct dsa_switch *ds, int port,
 	if (idx >= 0) {
 		rtl83xx_setup_l2_uc_entry(&e, port, vid, mac);
 		priv->r->write_cam(idx, &e);
+		rtl83xx_l2_shadow_update(priv, priv->fib_entries + idx, seed, &e);
 		goto out;
 	}
 
@@ -1703,6 +1767,7 @@ static int rtl83xx_port_fdb_del(struct dsa_switch *ds, int port,
 		pr_debug("Found entry index %d, key %d and bucket %d\n", idx, idx >> 2, idx & 3);
 		e.valid = false;
 		priv->r->write_l2_entry_using_hash(idx >> 2, idx & 0x3, &e);
+		rtl83xx_l2_shadow_update(priv, idx, seed, &e);
 		goto out;
 	}
 
@@ -1712,6 +1777,7 @@ static int rtl83xx_port_fdb_del(struct dsa_switch *ds, int port,
 	if (idx >= 0) {
 		e.valid = false;
 		priv->r->write_cam(idx, &e);
+		rtl83xx_l2_shadow_update(priv, priv->fib_entries + idx, seed, &e);
 		goto out;
 	}
 	err = -ENOENT;
@@ -1725,37 +1791,56 @@ out:
 static int rtl83xx_port_fdb_dump(struct dsa_switch *ds, int port,
 				 dsa_fdb_dump_cb_t *cb, void *data)
 {
-	struct rtl838x_l2_entry e;
+	const struct rtl83xx_l2_shadow *s;
 	struct rtl838x_switch_priv *priv = ds->priv;
+	int n = priv->fib_entries + L2_CAM_ENTRIES;
+	ktime_t start = ktime_get();
+	int i = 0, end, err = 0;
+	u32 us;
 
 	mutex_lock(&priv->reg_mutex);
 
-	for (int i = 0; i < priv->fib_entries; i++) {
-		priv->r->read_l2_entry_using_hash(i >> 2, i & 0x3, &e);
+	/* Dynamic entries come and go without the driver noticing, re-read the tables
+	 * when learning events were notified or the shadow is older than its TTL
+	 */
+	if (READ_ONCE(priv->l2_shadow_learned) || time_after(jiffies, priv->l2_shadow_expires))
+		rtl83xx_l2_shadow_flush(priv);
 
-		if (!e.valid)
-			continue;
+	mutex_unlock(&priv->reg_mutex);
 
-		if (e.port == port || e.port == RTL930X_PORT_IGNORE)
-			cb(e.mac, e.vid, e.is_static, data);
+	/* Walk the hash table and the CAM in batches, releasing reg_mutex in between
+	 * so that a dump of a large table does not block other switch configuration
+	 */
+	while (i < n && !err) {
+		mutex_lock(&priv->reg_mutex);
 
-		if (!((i + 1) % 64))
-			cond_resched();
-	}
+		for (end = min(i + L2_DUMP_BATCH, n); i < end; i++) {
+			i = rtl83xx_l2_shadow_next(priv, i);
+			if (i >= end)
+				break;
 
-	for (int i = 0; i < 64; i++) {
-		priv->r->read_cam(i, &e);
+			s = rtl83xx_l2_shadow_get(priv, i);
+			if (!s->valid)
+				continue;
 
-		if (!e.valid)
-			continue;
+			if (s->port == port ||
+			    (i < priv->fib_entries && s->port == RTL930X_PORT_IGNORE)) {
+				err = cb(s->mac, s->vid, s->is_static, data);
+				if (err)
+					break;
+			}
+		}
 
-		if (e.port == port)
-			cb(e.mac, e.vid, e.is_static, data);
+		mutex_unlock(&priv->reg_mutex);
+		cond_resched();
 	}
 
-	mutex_unlock(&priv->reg_mutex);
+	us = ktime_us_delta(ktime_get(), start);
+	WRITE_ONCE(priv->fdb_dump_last_us, us);
+	if (us > READ_ONCE(priv->fdb_dump_max_us))
+		WRITE_ONCE(priv->fdb_dump_max_us, us);
 
-	return 0;
+	return err;
 }
 
 static int rtl83xx_port_mdb_add(struct dsa_switch *ds, int port,
@@ -1799,6 +1884,7 @@ static int rtl83xx_port_mdb_add(struct dsa_switch *ds, int port,
 			}
 			rtl83xx_setup_l2_mc_entry(&e, vid, mac, mc_group);
 			priv->r->write_l2_entry_using_hash(idx >> 2, idx & 0x3, &e);
+			rtl83xx_l2_shadow_update(priv, idx, seed, &e);
 		}
 		goto out;
 	}
@@ -1820,6 +1906,7 @@ static int rtl83xx_port_mdb_add(struct dsa_switch *ds, int port,
 			}
 			rtl83xx_setup_l2_mc_entry(&e, vid, mac, mc_group);
 			priv->r->write_cam(idx, &e);
+			rtl83xx_l2_shadow_update(priv, priv->fib_entries + idx, seed, &e);
 		}
 		goto out;
 	}
@@ -1863,6 +1950,7 @@ int rtl83xx_port_mdb_del(struct dsa_switch *ds, int port,
 		if (!portmask) {
 			e.valid = false;
 			priv->r->write_l2_entry_using_hash(idx >> 2, idx & 0x3, &e);
+			rtl83xx_l2_shadow_update(priv, idx, seed, &e);
 		}
 		goto out;
 	}
@@ -1875,6 +1963,7 @@ int rtl83xx_port_mdb_del(struct dsa_switch *ds, int port,
 		if (!portmask) {
 			e.valid = false;
 			priv->r->write_cam(idx, &e);
+			rtl83xx_l2_shadow_update(priv, priv->fib_entries + idx, seed, &e);
 		}
 		goto out;
 	}
@@ -2181,6 +2270,7 @@ const struct phylink_pcs_ops rtl83xx_pcs_ops = {
 const struct dsa_switch_ops rtl83xx_switch_ops = {
 	.get_tag_protocol	= rtl83xx_get_tag_protocol,
 	.setup			= rtl83xx_setup,
+	.teardown		= rtl83xx_teardown,
 
 	.phy_read		= dsa_phy_read,
 	.phy_write		= dsa_phy_write,
@@ -2221,6 +2311,11 @@ const struct dsa_switch_ops rtl83xx_switch_ops = {
 	.port_mirror_add	= rtl83xx_port_mirror_add,
 	.port_mirror_del	= rtl83xx_port_mirror_del,
 
+	.cls_flower_add		= rtl83xx_cls_flower_add,
+	.cls_flower_del		= rtl83xx_cls_flower_del,
+	.cls_flower_stats	= rtl83xx_cls_flower_stats,
+	.port_setup_tc		= rtl83xx_port_setup_tc,
+
 	.port_lag_change	= rtl83xx_port_lag_change,
 	.port_lag_join		= rtl83xx_port_lag_join,
 	.port_lag_leave		= rtl83xx_port_lag_leave,
@@ -2239,6 +2334,7 @@ const struct phylink_pcs_ops rtl93xx_pcs_ops = {
 const struct dsa_switch_ops rtl930x_switch_ops = {
 	.get_tag_protocol	= rtl83xx_get_tag_protocol,
 	.setup			= rtl93xx_setup,
+	.teardown		= rtl83xx_teardown,
 
 	.phy_read		= dsa_phy_read,
 	.phy_write		= dsa_phy_write,
@@ -2276,6 +2372,10 @@ const struct dsa_switch_ops rtl930x_switch_ops = {
 	.port_mdb_add		= rtl83xx_port_mdb_add,
 	.port_mdb_del		= rtl83xx_port_mdb_del,
 
+	.cls_flower_add		= rtl83xx_cls_flower_add,
+	.cls_flower_del		= rtl83xx_cls_flower_del,
+	.cls_flower_stats	= rtl83xx_cls_flower_stats,
+
 	.port_lag_change	= rtl83xx_port_lag_change,
 	.port_lag_join		= rtl83xx_port_lag_join,
 	.port_lag_leave		= rtl83xx_port_lag_leave,
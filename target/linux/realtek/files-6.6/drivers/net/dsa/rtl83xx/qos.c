@@ -1,6 +1,8 @@
 // SPDX-License-Identifier: GPL-2.0-only
 
 #include <net/dsa.h>
+#include <net/pkt_cls.h>
+#include <net/pkt_sched.h>
 #include <linux/delay.h>
 #include <asm/mach-rtl838x/mach-rtl83xx.h>
 
@@ -14,6 +16,9 @@ enum scheduler_type {
 	WEIGHTED_ROUND_ROBIN,
 };
 
+/* Egress rates are programmed in units of 16 kbit/s */
+#define RTL83XX_EGR_RATE_UNIT	16000
+
 int max_available_queue[] = {0, 1, 2, 3, 4, 5, 6, 7};
 int default_queue_weights[] = {1, 1, 1, 1, 1, 1, 1, 1};
 int dot1p_priority_remapping[] = {0, 1, 2, 3, 4, 5, 6, 7};
@@ -547,6 +552,119 @@ void rtl839x_config_qos(void)
 	}
 }
 
+/* Offloads a TBF qdisc at the root of a port to the port's egress rate limit. The
+ * bucket size is global to the SoC, so the burst of the qdisc is not applied
+ */
+static int rtl83xx_qos_tbf(struct rtl838x_switch_priv *priv, int port,
+			   struct tc_tbf_qopt_offload *qopt)
+{
+	struct rtl838x_port *p = &priv->ports[port];
+	u64 max_rate = priv->family_id == RTL8380_FAMILY_ID ? 0xffff : 0xfffff;
+	u64 rate;
+	int old_rate;
+
+	if (qopt->parent != TC_H_ROOT)
+		return -EOPNOTSUPP;
+
+	switch (qopt->command) {
+	case TC_TBF_REPLACE:
+		rate = DIV_ROUND_UP_ULL(qopt->replace_params.rate.rate_bytes_ps * 8,
+					RTL83XX_EGR_RATE_UNIT);
+		if (!rate || rate > max_rate)
+			return -EOPNOTSUPP;
+
+		if (priv->family_id == RTL8380_FAMILY_ID)
+			old_rate = rtl838x_set_egress_rate(priv, port, rate);
+		else
+			old_rate = rtl839x_set_egress_rate(priv, port, rate);
+		if (old_rate < 0)
+			return -EOPNOTSUPP;
+
+		if (!p->tbf_offloaded) {
+			p->tbf_saved_rate = old_rate;
+			p->tbf_offloaded = true;
+		}
+		return 0;
+
+	case TC_TBF_DESTROY:
+		if (!p->tbf_offloaded)
+			return 0;
+
+		if (priv->family_id == RTL8380_FAMILY_ID)
+			rtl838x_set_egress_rate(priv, port, p->tbf_saved_rate);
+		else
+			rtl839x_set_egress_rate(priv, port, p->tbf_saved_rate);
+		p->tbf_offloaded = false;
+		return 0;
+
+	case TC_TBF_STATS:
+		return 0;
+
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+/* Offloads an ETS qdisc at the root of a port to the WFQ weights of its egress
+ * queues, a weight of 0 makes a queue strict priority. Band 0 is served first,
+ * which is queue 7 on the SoC. As the queue of a packet follows from its internal
+ * priority, priority n has to map to band 7 - n
+ */
+static int rtl839x_qos_ets(struct rtl838x_switch_priv *priv, int port,
+			   struct tc_ets_qopt_offload *qopt)
+{
+	struct tc_ets_qopt_offload_replace_params *p = &qopt->replace_params;
+	int queue_weights[8];
+
+	if (priv->family_id != RTL8390_FAMILY_ID || qopt->parent != TC_H_ROOT)
+		return -EOPNOTSUPP;
+
+	switch (qopt->command) {
+	case TC_ETS_REPLACE:
+		if (p->bands != 8)
+			return -EOPNOTSUPP;
+
+		/* The switch only knows priorities 0-7, 8-15 must stay in the
+		 * default last band
+		 */
+		for (int i = 0; i < ARRAY_SIZE(p->priomap); i++) {
+			if (p->priomap[i] != (i < MAX_PRIOS ? 7 - i : 7))
+				return -EOPNOTSUPP;
+		}
+
+		for (int b = 0; b < 8; b++)
+			queue_weights[7 - b] = p->quanta[b] ? clamp_t(u32, p->weights_pct[b], 1, 0x3ff) : 0;
+
+		rtl839x_set_scheduling_queue_weights(priv, port, queue_weights);
+		return 0;
+
+	case TC_ETS_DESTROY:
+		rtl839x_set_scheduling_queue_weights(priv, port, default_queue_weights);
+		return 0;
+
+	case TC_ETS_STATS:
+		return 0;
+
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+int rtl83xx_port_setup_tc(struct dsa_switch *ds, int port, enum tc_setup_type type,
+			  void *type_data)
+{
+	struct rtl838x_switch_priv *priv = ds->priv;
+
+	switch (type) {
+	case TC_SETUP_QDISC_TBF:
+		return rtl83xx_qos_tbf(priv, port, type_data);
+	case TC_SETUP_QDISC_ETS:
+		return rtl839x_qos_ets(priv, port, type_data);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
 void __init rtl83xx_setup_qos(struct rtl838x_switch_priv *priv)
 {
 	switch_priv = priv;
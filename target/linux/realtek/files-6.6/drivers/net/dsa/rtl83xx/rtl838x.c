@@ -1397,16 +1397,13 @@ static bool rtl838x_pie_templ_has(int t, enum template_field_id field_type)
 	return false;
 }
 
-static int rtl838x_pie_verify_template(struct rtl838x_switch_priv *priv,
-				       struct pie_rule *pr, int t, int block)
+static bool rtl838x_pie_verify_template(struct pie_rule *pr, int t)
 {
-	int i;
-
 	if (!pr->is_ipv6 && pr->sip_m && !rtl838x_pie_templ_has(t, TEMPLATE_FIELD_SIP0))
-		return -1;
+		return false;
 
 	if (!pr->is_ipv6 && pr->dip_m && !rtl838x_pie_templ_has(t, TEMPLATE_FIELD_DIP0))
-		return -1;
+		return false;
 
 	if (pr->is_ipv6) {
 		if ((pr->sip6_m.s6_addr32[0] ||
@@ -1414,78 +1411,67 @@ static int rtl838x_pie_verify_template(struct rtl838x_switch_priv *priv,
 		     pr->sip6_m.s6_addr32[2] ||
 		     pr->sip6_m.s6_addr32[3]) &&
 		    !rtl838x_pie_templ_has(t, TEMPLATE_FIELD_SIP2))
-			return -1;
+			return false;
 		if ((pr->dip6_m.s6_addr32[0] ||
 		     pr->dip6_m.s6_addr32[1] ||
 		     pr->dip6_m.s6_addr32[2] ||
 		     pr->dip6_m.s6_addr32[3]) &&
 		    !rtl838x_pie_templ_has(t, TEMPLATE_FIELD_DIP2))
-			return -1;
+			return false;
 	}
 
 	if (ether_addr_to_u64(pr->smac) && !rtl838x_pie_templ_has(t, TEMPLATE_FIELD_SMAC0))
-		return -1;
+		return false;
 
 	if (ether_addr_to_u64(pr->dmac) && !rtl838x_pie_templ_has(t, TEMPLATE_FIELD_DMAC0))
-		return -1;
-
-	/* TODO: Check more */
+		return false;
 
-	i = find_first_zero_bit(&priv->pie_use_bm[block * 4], PIE_BLOCK_SIZE);
+	if (pr->spm_m && !rtl838x_pie_templ_has(t, TEMPLATE_FIELD_SPM0))
+		return false;
 
-	if (i >= PIE_BLOCK_SIZE)
-		return -1;
+	/* TODO: Check more */
 
-	return i + PIE_BLOCK_SIZE * block;
+	return true;
 }
 
-static int rtl838x_pie_rule_add(struct rtl838x_switch_priv *priv, struct pie_rule *pr)
+/* Returns the template number the rule pr is written with in block block or -1
+ * if none of the templates enabled for the block holds all fields pr matches on
+ */
+static int rtl838x_pie_rule_tid(struct rtl838x_switch_priv *priv, struct pie_rule *pr, int block)
 {
-	int idx, block, j;
-
-	pr_debug("In %s\n", __func__);
+	u32 t_select = sw_r32(RTL838X_ACL_BLK_TMPLTE_CTRL(block));
 
-	mutex_lock(&priv->pie_mutex);
+	for (int j = 0; j < 3; j++) {
+		int t = (t_select >> (j * 3)) & 0x7;
 
-	for (block = 0; block < priv->n_pie_blocks; block++) {
-		for (j = 0; j < 3; j++) {
-			int t = (sw_r32(RTL838X_ACL_BLK_TMPLTE_CTRL(block)) >> (j * 3)) & 0x7;
-			pr_debug("Testing block %d, template %d, template id %d\n", block, j, t);
-			idx = rtl838x_pie_verify_template(priv, pr, t, block);
-			if (idx >= 0)
-				break;
-		}
-		if (j < 3)
-			break;
+		pr_debug("Testing block %d, template %d, template id %d\n", block, j, t);
+		if (rtl838x_pie_verify_template(pr, t))
+			return j;
 	}
 
-	if (block >= priv->n_pie_blocks) {
-		mutex_unlock(&priv->pie_mutex);
-		return -EOPNOTSUPP;
-	}
-
-	pr_debug("Using block: %d, index %d, template-id %d\n", block, idx, j);
-	set_bit(idx, priv->pie_use_bm);
-
-	pr->valid = true;
-	pr->tid = j;  /* Mapped to template number */
-	pr->tid_m = 0x3;
-	pr->id = idx;
+	return -1;
+}
 
-	rtl838x_pie_lookup_enable(priv, idx);
-	rtl838x_pie_rule_write(priv, idx, pr);
+/* Invalidates a single rule by writing an empty entry over it. Unlike the range
+ * deletion in rtl838x_pie_rule_del() this keeps rule lookup enabled in the block
+ */
+static void rtl838x_pie_rule_clear(struct rtl838x_switch_priv *priv, int idx)
+{
+	/* Access IACL table (1) via register 0 */
+	struct table_reg *q = rtl_table_get(RTL8380_TBL_0, 1);
 
-	mutex_unlock(&priv->pie_mutex);
+	for (int i = 0; i < 18; i++)
+		sw_w32(0, rtl_table_data(q, i));
 
-	return 0;
+	rtl_table_write(q, idx);
+	rtl_table_release(q);
 }
 
-static void rtl838x_pie_rule_rm(struct rtl838x_switch_priv *priv, struct pie_rule *pr)
+static int rtl838x_pie_rule_add(struct rtl838x_switch_priv *priv, struct pie_rule *pr)
 {
-	int idx = pr->id;
+	pr->tid_m = 0x3;
 
-	rtl838x_pie_rule_del(priv, idx, idx);
-	clear_bit(idx, priv->pie_use_bm);
+	return rtl83xx_pie_rule_alloc(priv, pr, 0, priv->n_pie_blocks);
 }
 
 /* Initializes the Packet Inspection Engine:
@@ -1763,7 +1749,10 @@ const struct rtl838x_reg rtl838x_reg = {
 	.pie_rule_read = rtl838x_pie_rule_read,
 	.pie_rule_write = rtl838x_pie_rule_write,
 	.pie_rule_add = rtl838x_pie_rule_add,
-	.pie_rule_rm = rtl838x_pie_rule_rm,
+	.pie_rule_rm = rtl83xx_pie_rule_rm,
+	.pie_rule_tid = rtl838x_pie_rule_tid,
+	.pie_rule_clear = rtl838x_pie_rule_clear,
+	.pie_lookup_enable = rtl838x_pie_lookup_enable,
 	.l2_learning_setup = rtl838x_l2_learning_setup,
 	.packet_cntr_read = rtl838x_packet_cntr_read,
 	.packet_cntr_clear = rtl838x_packet_cntr_clear,
@@ -1788,10 +1777,7 @@ irqreturn_t rtl838x_switch_irq(int irq, void *dev_id)
 	for (int i = 0; i < 28; i++) {
 		if (ports & BIT(i)) {
 			link = sw_r32(RTL838X_MAC_LINK_STS);
-			if (link & BIT(i))
-				dsa_port_phylink_mac_change(ds, i, true);
-			else
-				dsa_port_phylink_mac_change(ds, i, false);
+			rtl83xx_port_link_change(ds, i, link & BIT(i));
 		}
 	}
 
@@ -4,6 +4,7 @@
 #define _RTL838X_H
 
 #include <net/dsa.h>
+#include <net/ip_fib.h>
 
 /* Register definition */
 #define RTL838X_MAC_PORT_CTRL(port)		(0xd560 + (((port) << 7)))
@@ -609,6 +610,13 @@ typedef enum {
 #define MAX_ROUTER_MACS 64
 #define L3_EGRESS_DMACS 2048
 #define MAX_SMACS 64
+#define L2_CAM_ENTRIES 64
+#define L2_SHADOW_TTL HZ
+#define L2_DUMP_BATCH 256
+#define L3_STATS_INTERVAL HZ
+#define TC_STATS_INTERVAL HZ
+#define DROP_STATS_INTERVAL HZ
+#define MAX_DROP_COUNTERS 85
 
 enum phy_type {
 	PHY_NONE = 0,
@@ -644,6 +652,9 @@ struct rtl838x_port {
 	int led_set;
 	int leds_on_this_port;
 	const struct dsa_port *dp;
+	struct phy_device *phydev;	/* Told about link changes from the switch IRQ */
+	bool tbf_offloaded;
+	u32 tbf_saved_rate;		/* Egress rate before TBF was offloaded */
 };
 
 struct rtl838x_pcs {
@@ -709,6 +720,16 @@ struct rtl838x_l2_entry {
 	int l2_tunnel_list_id;
 };
 
+/* RAM copy of a slot of the L2 hash table or CAM, see rtl83xx_l2_shadow_get() */
+struct rtl83xx_l2_shadow {
+	u64 seed;		/* MAC and VID concatenated as hash seed */
+	u8 mac[ETH_ALEN];
+	u16 vid;
+	u8 port;
+	bool valid;
+	bool is_static;
+};
+
 enum fwd_rule_action {
 	FWD_RULE_ACTION_NONE = 0,
 	FWD_RULE_ACTION_FWD = 1,
@@ -736,6 +757,7 @@ enum egr_filter {
  * to SoC family (e.g. because of different port ranges) */
 struct pie_rule {
 	int id;
+	u32 prio;		/* Rules with a lower value are placed at lower indices */
 	enum pie_phase phase;	/* Phase in which this template is applied */
 	int packet_cntr;	/* ID of a packet counter assigned to this rule */
 	int octet_cntr;		/* ID of a byte counter assigned to this rule */
@@ -935,7 +957,12 @@ struct rtl83xx_flow {
 	struct rcu_head rcu_head;
 	struct rtl838x_switch_priv *priv;
 	struct pie_rule rule;
+	u64 ports;		/* Ports a port-bound flow is matched on */
 	u32 flags;
+	struct list_head list;	/* In priv->tc_flows */
+	u64 packets;		/* Packets counted up to the last harvest */
+	u64 reported;		/* Packets already reported to tc */
+	unsigned long lastused;	/* jiffies when the rule last matched */
 };
 
 struct rtl93xx_route_attr {
@@ -962,6 +989,11 @@ struct rtl83xx_route {
 	struct rtl83xx_nexthop nh;
 	struct pie_rule pr;
 	struct rtl93xx_route_attr attr;
+	struct list_head list;		/* In priv->route_list, protected by RTNL */
+	struct fib_rt_info fri;		/* FIB alias for reporting the offload state */
+	u64 packets;			/* Packets forwarded in hardware */
+	u32 last_cntr;			/* Last value read from the packet counter */
+	unsigned long last_used;	/* jiffies when hardware last forwarded packets */
 };
 
 struct rtl838x_reg {
@@ -1042,6 +1074,9 @@ struct rtl838x_reg {
 	int (*pie_rule_write)(struct rtl838x_switch_priv *priv, int idx, struct pie_rule *pr);
 	int (*pie_rule_add)(struct rtl838x_switch_priv *priv, struct pie_rule *rule);
 	void (*pie_rule_rm)(struct rtl838x_switch_priv *priv, struct pie_rule *rule);
+	int (*pie_rule_tid)(struct rtl838x_switch_priv *priv, struct pie_rule *pr, int block);
+	void (*pie_rule_clear)(struct rtl838x_switch_priv *priv, int idx);
+	void (*pie_lookup_enable)(struct rtl838x_switch_priv *priv, int idx);
 	void (*l2_learning_setup)(void);
 	u32 (*packet_cntr_read)(int counter);
 	void (*packet_cntr_clear)(int counter);
@@ -1063,6 +1098,11 @@ struct rtl838x_reg {
 	void (*led_init)(struct rtl838x_switch_priv *priv);
 };
 
+struct rtl83xx_drop_cntr {
+	u16 last;	/* Last value read from the 16-bit hardware counter */
+	u64 total;
+};
+
 struct rtl838x_switch_priv {
 	/* Switch operation */
 	struct dsa_switch *ds;
@@ -1085,6 +1125,16 @@ struct rtl838x_switch_priv {
 	u64 irq_mask;
 	u32 fib_entries;
 	int l2_bucket_size;
+	struct rtl83xx_l2_shadow *l2_shadow;	/* L2 hash table followed by the CAM */
+	unsigned long *l2_shadow_synced;	/* Shadow slots in sync with the SoC */
+	unsigned long *l2_shadow_valid;		/* Shadow slots holding an entry */
+	unsigned long l2_shadow_expires;	/* Dynamic entries need re-reading after this */
+	unsigned long l2_shadow_ttl;
+	bool l2_shadow_stale;			/* Written outside reg_mutex, flush everything */
+	bool l2_shadow_learned;			/* Learning/aging events were notified */
+	struct notifier_block swdev_nb;
+	u32 fdb_dump_last_us;
+	u32 fdb_dump_max_us;
 	struct dentry *dbgfs_dir;
 	int n_lags;
 	u64 lags_port_members[MAX_LAGS];
@@ -1099,16 +1149,27 @@ struct rtl838x_switch_priv {
 	unsigned long int mc_group_bm[MAX_MC_GROUPS >> 5];
 	int n_pie_blocks;
 	struct rhashtable tc_ht;
+	struct list_head tc_flows;
+	struct delayed_work tc_stats_work;
 	unsigned long int pie_use_bm[MAX_PIE_ENTRIES >> 5];
+	struct pie_rule *pie_rules[MAX_PIE_ENTRIES];	/* Protected by pie_mutex */
 	int n_counters;
 	unsigned long int octet_cntr_use_bm[MAX_COUNTERS >> 5];
 	unsigned long int packet_cntr_use_bm[MAX_COUNTERS >> 4];
 	struct rhltable routes;
+	struct list_head route_list;
+	struct delayed_work l3_stats_work;
 	unsigned long int route_use_bm[MAX_ROUTES >> 5];
 	unsigned long int host_route_use_bm[MAX_HOST_ROUTES >> 5];
 	struct rtl838x_l3_intf *interfaces[MAX_INTERFACES];
 	u16 intf_mtus[MAX_INTF_MTUS];
 	int intf_mtu_count[MAX_INTF_MTUS];
+	struct mutex drop_cntr_mutex;		/* Protects drop_cntrs */
+	struct delayed_work drop_stats_work;
+	const char * const *drop_cntr_names;
+	int n_drop_cntrs;
+	u32 drop_cntr_base;
+	struct rtl83xx_drop_cntr drop_cntrs[MAX_DROP_COUNTERS];
 };
 
 void rtl838x_dbgfs_init(struct rtl838x_switch_priv *priv);
@@ -615,10 +615,7 @@ irqreturn_t rtl839x_switch_irq(int irq, void *dev_id)
 	for (int i = 0; i < RTL839X_CPU_PORT; i++) {
 		if (ports & BIT_ULL(i)) {
 			link = rtl839x_get_port_reg_le(RTL839X_MAC_LINK_STS);
-			if (link & BIT_ULL(i))
-				dsa_port_phylink_mac_change(ds, i, true);
-			else
-				dsa_port_phylink_mac_change(ds, i, false);
+			rtl83xx_port_link_change(ds, i, link & BIT_ULL(i));
 		}
 	}
 
@@ -1501,16 +1498,13 @@ static bool rtl839x_pie_templ_has(int t, enum template_field_id field_type)
 	return false;
 }
 
-static int rtl839x_pie_verify_template(struct rtl838x_switch_priv *priv,
-				       struct pie_rule *pr, int t, int block)
+static bool rtl839x_pie_verify_template(struct pie_rule *pr, int t)
 {
-	int i;
-
 	if (!pr->is_ipv6 && pr->sip_m && !rtl839x_pie_templ_has(t, TEMPLATE_FIELD_SIP0))
-		return -1;
+		return false;
 
 	if (!pr->is_ipv6 && pr->dip_m && !rtl839x_pie_templ_has(t, TEMPLATE_FIELD_DIP0))
-		return -1;
+		return false;
 
 	if (pr->is_ipv6) {
 		if ((pr->sip6_m.s6_addr32[0] ||
@@ -1518,34 +1512,54 @@ static int rtl839x_pie_verify_template(struct rtl838x_switch_priv *priv,
 		     pr->sip6_m.s6_addr32[2] ||
 		     pr->sip6_m.s6_addr32[3]) &&
 		    !rtl839x_pie_templ_has(t, TEMPLATE_FIELD_SIP2))
-			return -1;
+			return false;
 		if ((pr->dip6_m.s6_addr32[0] ||
 		     pr->dip6_m.s6_addr32[1] ||
 		     pr->dip6_m.s6_addr32[2] ||
 		     pr->dip6_m.s6_addr32[3]) &&
 		    !rtl839x_pie_templ_has(t, TEMPLATE_FIELD_DIP2))
-			return -1;
+			return false;
 	}
 
 	if (ether_addr_to_u64(pr->smac) && !rtl839x_pie_templ_has(t, TEMPLATE_FIELD_SMAC0))
-		return -1;
+		return false;
 
 	if (ether_addr_to_u64(pr->dmac) && !rtl839x_pie_templ_has(t, TEMPLATE_FIELD_DMAC0))
-		return -1;
+		return false;
+
+	if (pr->spm_m && !rtl839x_pie_templ_has(t, TEMPLATE_FIELD_SPM0))
+		return false;
 
 	/* TODO: Check more */
 
-	i = find_first_zero_bit(&priv->pie_use_bm[block * 4], PIE_BLOCK_SIZE);
+	return true;
+}
 
-	if (i >= PIE_BLOCK_SIZE)
-		return -1;
+/* Returns the template number the rule pr is written with in block block or -1
+ * if none of the templates enabled for the block holds all fields pr matches on
+ */
+static int rtl839x_pie_rule_tid(struct rtl838x_switch_priv *priv, struct pie_rule *pr, int block)
+{
+	u32 t_select = sw_r32(RTL839X_ACL_BLK_TMPLTE_CTRL(block));
 
-	return i + PIE_BLOCK_SIZE * block;
+	for (int j = 0; j < 2; j++) {
+		int t = (t_select >> (j * 3)) & 0x7;
+
+		pr_debug("Testing block %d, template %d, template id %d\n", block, j, t);
+		if (rtl839x_pie_verify_template(pr, t))
+			return j;
+	}
+
+	return -1;
+}
+
+static void rtl839x_pie_rule_clear(struct rtl838x_switch_priv *priv, int idx)
+{
+	rtl839x_pie_rule_del(priv, idx, idx);
 }
 
 static int rtl839x_pie_rule_add(struct rtl838x_switch_priv *priv, struct pie_rule *pr)
 {
-	int idx, block, j, t;
 	int min_block = 0;
 	int max_block = priv->n_pie_blocks / 2;
 
@@ -1554,45 +1568,9 @@ static int rtl839x_pie_rule_add(struct rtl838x_switch_priv *priv, struct pie_rul
 		max_block = priv->n_pie_blocks;
 	}
 
-	mutex_lock(&priv->pie_mutex);
-
-	for (block = min_block; block < max_block; block++) {
-		for (j = 0; j < 2; j++) {
-			t = (sw_r32(RTL839X_ACL_BLK_TMPLTE_CTRL(block)) >> (j * 3)) & 0x7;
-			idx = rtl839x_pie_verify_template(priv, pr, t, block);
-			if (idx >= 0)
-				break;
-		}
-		if (j < 2)
-			break;
-	}
-
-	if (block >= priv->n_pie_blocks) {
-		mutex_unlock(&priv->pie_mutex);
-		return -EOPNOTSUPP;
-	}
-
-	set_bit(idx, priv->pie_use_bm);
-
-	pr->valid = true;
-	pr->tid = j;  /* Mapped to template number */
 	pr->tid_m = 0x3;
-	pr->id = idx;
 
-	rtl839x_pie_lookup_enable(priv, idx);
-	rtl839x_pie_rule_write(priv, idx, pr);
-
-	mutex_unlock(&priv->pie_mutex);
-
-	return 0;
-}
-
-static void rtl839x_pie_rule_rm(struct rtl838x_switch_priv *priv, struct pie_rule *pr)
-{
-	int idx = pr->id;
-
-	rtl839x_pie_rule_del(priv, idx, idx);
-	clear_bit(idx, priv->pie_use_bm);
+	return rtl83xx_pie_rule_alloc(priv, pr, min_block, max_block);
 }
 
 static void rtl839x_pie_init(struct rtl838x_switch_priv *priv)
@@ -1899,7 +1877,10 @@ const struct rtl838x_reg rtl839x_reg = {
 	.pie_rule_read = rtl839x_pie_rule_read,
 	.pie_rule_write = rtl839x_pie_rule_write,
 	.pie_rule_add = rtl839x_pie_rule_add,
-	.pie_rule_rm = rtl839x_pie_rule_rm,
+	.pie_rule_rm = rtl83xx_pie_rule_rm,
+	.pie_rule_tid = rtl839x_pie_rule_tid,
+	.pie_rule_clear = rtl839x_pie_rule_clear,
+	.pie_lookup_enable = rtl839x_pie_lookup_enable,
 	.l2_learning_setup = rtl839x_l2_learning_setup,
 	.packet_cntr_read = rtl839x_packet_cntr_read,
 	.packet_cntr_clear = rtl839x_packet_cntr_clear,
@@ -74,13 +74,42 @@ inline u32 rtl_table_data_r(struct table_reg *r, int i);
 inline void rtl_table_data_w(struct table_reg *r, u32 v, int i);
 
 void __init rtl83xx_setup_qos(struct rtl838x_switch_priv *priv);
+int rtl83xx_port_setup_tc(struct dsa_switch *ds, int port, enum tc_setup_type type,
+			  void *type_data);
 
 int rtl83xx_packet_cntr_alloc(struct rtl838x_switch_priv *priv);
+int rtl83xx_pie_rule_alloc(struct rtl838x_switch_priv *priv, struct pie_rule *pr,
+			   int min_block, int max_block);
+int rtl83xx_pie_rule_update(struct rtl838x_switch_priv *priv, struct pie_rule *pr);
+void rtl83xx_pie_rule_rm(struct rtl838x_switch_priv *priv, struct pie_rule *pr);
+
+int rtl83xx_tc_init(struct rtl838x_switch_priv *priv);
+void rtl83xx_tc_fini(struct rtl838x_switch_priv *priv);
+int rtl83xx_cls_flower_add(struct dsa_switch *ds, int port, struct flow_cls_offload *cls,
+			   bool ingress);
+int rtl83xx_cls_flower_del(struct dsa_switch *ds, int port, struct flow_cls_offload *cls,
+			   bool ingress);
+int rtl83xx_cls_flower_stats(struct dsa_switch *ds, int port, struct flow_cls_offload *cls,
+			     bool ingress);
+
+void rtl83xx_drop_cntr_update(struct rtl838x_switch_priv *priv);
 
 int rtl83xx_port_is_under(const struct net_device * dev, struct rtl838x_switch_priv *priv);
+void rtl83xx_port_link_change(struct dsa_switch *ds, int port, bool up);
+
+void rtl83xx_l2_shadow_flush(struct rtl838x_switch_priv *priv);
+void rtl83xx_l2_shadow_invalidate(struct rtl838x_switch_priv *priv);
+void rtl83xx_l2_shadow_update(struct rtl838x_switch_priv *priv, int slot, u64 seed,
+			      const struct rtl838x_l2_entry *e);
+const struct rtl83xx_l2_shadow *rtl83xx_l2_shadow_read(struct rtl838x_switch_priv *priv, int slot,
+						       struct rtl838x_l2_entry *e);
+const struct rtl83xx_l2_shadow *rtl83xx_l2_shadow_get(struct rtl838x_switch_priv *priv, int slot);
+int rtl83xx_l2_shadow_next(struct rtl838x_switch_priv *priv, int slot);
+int rtl83xx_l2_hash_slot(struct rtl838x_switch_priv *priv, u32 key, int pos);
 
 int read_phy(u32 port, u32 page, u32 reg, u32 *val);
 int write_phy(u32 port, u32 page, u32 reg, u32 val);
+void rtl83xx_phy_wait_configured(void);
 
 /* Port register accessor functions for the RTL839x and RTL931X SoCs */
 void rtl839x_mask_port_reg_be(u64 clear, u64 set, int reg);
@@ -714,10 +714,7 @@ irqreturn_t rtl930x_switch_irq(int irq, void *dev_id)
 			 */
 			link = sw_r32(RTL930X_MAC_LINK_STS);
 			link = sw_r32(RTL930X_MAC_LINK_STS);
-			if (link & BIT(i))
-				dsa_port_phylink_mac_change(ds, i, true);
-			else
-				dsa_port_phylink_mac_change(ds, i, false);
+			rtl83xx_port_link_change(ds, i, link & BIT(i));
 		}
 	}
 
@@ -1895,16 +1892,13 @@ static bool rtl930x_pie_templ_has(int t, enum template_field_id field_type)
  * Note that this function is SoC specific since the values of e.g. TEMPLATE_FIELD_SIP0
  * depend on the SoC
  */
-static int rtl930x_pie_verify_template(struct rtl838x_switch_priv *priv,
-				       struct pie_rule *pr, int t, int block)
+static bool rtl930x_pie_verify_template(struct pie_rule *pr, int t)
 {
-	int i;
-
 	if (!pr->is_ipv6 && pr->sip_m && !rtl930x_pie_templ_has(t, TEMPLATE_FIELD_SIP0))
-		return -1;
+		return false;
 
 	if (!pr->is_ipv6 && pr->dip_m && !rtl930x_pie_templ_has(t, TEMPLATE_FIELD_DIP0))
-		return -1;
+		return false;
 
 	if (pr->is_ipv6) {
 		if ((pr->sip6_m.s6_addr32[0] ||
@@ -1912,77 +1906,45 @@ static int rtl930x_pie_verify_template(struct rtl838x_switch_priv *priv,
 		     pr->sip6_m.s6_addr32[2] ||
 		     pr->sip6_m.s6_addr32[3]) &&
 		    !rtl930x_pie_templ_has(t, TEMPLATE_FIELD_SIP2))
-			return -1;
+			return false;
 		if ((pr->dip6_m.s6_addr32[0] ||
 		     pr->dip6_m.s6_addr32[1] ||
 		     pr->dip6_m.s6_addr32[2] ||
 		     pr->dip6_m.s6_addr32[3]) &&
 		    !rtl930x_pie_templ_has(t, TEMPLATE_FIELD_DIP2))
-			return -1;
+			return false;
 	}
 
 	if (ether_addr_to_u64(pr->smac) && !rtl930x_pie_templ_has(t, TEMPLATE_FIELD_SMAC0))
-		return -1;
+		return false;
 
 	if (ether_addr_to_u64(pr->dmac) && !rtl930x_pie_templ_has(t, TEMPLATE_FIELD_DMAC0))
-		return -1;
+		return false;
 
-	/* TODO: Check more */
+	if (pr->spm_m && !rtl930x_pie_templ_has(t, TEMPLATE_FIELD_SPM0))
+		return false;
 
-	i = find_first_zero_bit(&priv->pie_use_bm[block * 4], PIE_BLOCK_SIZE);
-
-	if (i >= PIE_BLOCK_SIZE)
-		return -1;
+	/* TODO: Check more */
 
-	return i + PIE_BLOCK_SIZE * block;
+	return true;
 }
 
-static int rtl930x_pie_rule_add(struct rtl838x_switch_priv *priv, struct pie_rule *pr)
+/* Returns the template number the rule pr is written with in block block or -1
+ * if none of the templates enabled for the block holds all fields pr matches on
+ */
+static int rtl930x_pie_rule_tid(struct rtl838x_switch_priv *priv, struct pie_rule *pr, int block)
 {
-	int idx, block, j, t;
-	int min_block = 0;
-	int max_block = priv->n_pie_blocks / 2;
+	u32 t_select = sw_r32(RTL930X_PIE_BLK_TMPLTE_CTRL(block));
 
-	if (pr->is_egress) {
-		min_block = max_block;
-		max_block = priv->n_pie_blocks;
-	}
-	pr_debug("In %s\n", __func__);
-
-	mutex_lock(&priv->pie_mutex);
-
-	for (block = min_block; block < max_block; block++) {
-		for (j = 0; j < 2; j++) {
-			t = (sw_r32(RTL930X_PIE_BLK_TMPLTE_CTRL(block)) >> (j * 4)) & 0xf;
-			pr_debug("Testing block %d, template %d, template id %d\n", block, j, t);
-			pr_debug("%s: %08x\n",
-				__func__, sw_r32(RTL930X_PIE_BLK_TMPLTE_CTRL(block)));
-			idx = rtl930x_pie_verify_template(priv, pr, t, block);
-			if (idx >= 0)
-				break;
-		}
-		if (j < 2)
-			break;
-	}
+	for (int j = 0; j < 2; j++) {
+		int t = (t_select >> (j * 4)) & 0xf;
 
-	if (block >= priv->n_pie_blocks) {
-		mutex_unlock(&priv->pie_mutex);
-		return -EOPNOTSUPP;
+		pr_debug("Testing block %d, template %d, template id %d\n", block, j, t);
+		if (rtl930x_pie_verify_template(pr, t))
+			return j;
 	}
 
-	pr_debug("Using block: %d, index %d, template-id %d\n", block, idx, j);
-	set_bit(idx, priv->pie_use_bm);
-
-	pr->valid = true;
-	pr->tid = j;  /* Mapped to template number */
-	pr->tid_m = 0x1;
-	pr->id = idx;
-
-	rtl930x_pie_lookup_enable(priv, idx);
-	rtl930x_pie_rule_write(priv, idx, pr);
-
-	mutex_unlock(&priv->pie_mutex);
-	return 0;
+	return -1;
 }
 
 /* Delete a range of Packet Inspection Engine rules */
@@ -2004,12 +1966,24 @@ static int rtl930x_pie_rule_del(struct rtl838x_switch_priv *priv, int index_from
 	return 0;
 }
 
-static void rtl930x_pie_rule_rm(struct rtl838x_switch_priv *priv, struct pie_rule *pr)
+static void rtl930x_pie_rule_clear(struct rtl838x_switch_priv *priv, int idx)
 {
-	int idx = pr->id;
-
 	rtl930x_pie_rule_del(priv, idx, idx);
-	clear_bit(idx, priv->pie_use_bm);
+}
+
+static int rtl930x_pie_rule_add(struct rtl838x_switch_priv *priv, struct pie_rule *pr)
+{
+	int min_block = 0;
+	int max_block = priv->n_pie_blocks / 2;
+
+	if (pr->is_egress) {
+		min_block = max_block;
+		max_block = priv->n_pie_blocks;
+	}
+
+	pr->tid_m = 0x1;
+
+	return rtl83xx_pie_rule_alloc(priv, pr, min_block, max_block);
 }
 
 static void rtl930x_pie_init(struct rtl838x_switch_priv *priv)
@@ -2546,7 +2520,10 @@ const struct rtl838x_reg rtl930x_reg = {
 	.pie_init = rtl930x_pie_init,
 	.pie_rule_write = rtl930x_pie_rule_write,
 	.pie_rule_add = rtl930x_pie_rule_add,
-	.pie_rule_rm = rtl930x_pie_rule_rm,
+	.pie_rule_rm = rtl83xx_pie_rule_rm,
+	.pie_rule_tid = rtl930x_pie_rule_tid,
+	.pie_rule_clear = rtl930x_pie_rule_clear,
+	.pie_lookup_enable = rtl930x_pie_lookup_enable,
 	.l2_learning_setup = rtl930x_l2_learning_setup,
 	.packet_cntr_read = rtl930x_packet_cntr_read,
 	.packet_cntr_clear = rtl930x_packet_cntr_clear,
@@ -231,27 +231,103 @@ static const struct rhashtable_params tc_ht_params = {
 	.automatic_shrinking = true,
 };
 
+/* Serializes adding and removing flows, the block callbacks are unlocked */
+static DEFINE_MUTEX(rtl83xx_tc_mutex);
+
+/* Binds a flow to the ports in the mask ports through the source port matrix of
+ * its rule. The SoC sets only the ingress port's bit in the matrix, so requiring
+ * all other ports' bits to be 0 matches traffic from any of the ports with a
+ * single TCAM entry
+ */
+static int rtl83xx_flow_set_ports(struct rtl838x_switch_priv *priv,
+				  struct rtl83xx_flow *flow, u64 ports)
+{
+	flow->ports = ports;
+	flow->rule.spm = 0;
+	flow->rule.spm_m = GENMASK_ULL(priv->cpu_port, 0) & ~ports;
+
+	if (!flow->rule.valid)
+		return 0;
+
+	return rtl83xx_pie_rule_update(priv, &flow->rule);
+}
+
+static void rtl83xx_flow_release(struct rtl838x_switch_priv *priv, struct rtl83xx_flow *flow)
+{
+	priv->r->pie_rule_rm(priv, &flow->rule);
+
+	if (flow->rule.packet_cntr >= 0) {
+		pr_debug("%s: Releasing packet counter %d\n", __func__, flow->rule.packet_cntr);
+		set_bit(flow->rule.packet_cntr, priv->packet_cntr_use_bm);
+	}
+}
+
+/* Caller must hold rtl83xx_tc_mutex */
+static void rtl83xx_flow_harvest(struct rtl838x_switch_priv *priv, struct rtl83xx_flow *flow)
+{
+	u32 cntr;
+
+	if (!flow->rule.valid || flow->rule.packet_cntr < 0)
+		return;
+
+	cntr = priv->r->packet_cntr_read(flow->rule.packet_cntr);
+	if (cntr == flow->rule.last_packet_cnt)
+		return;
+
+	flow->packets += (u32)(cntr - flow->rule.last_packet_cnt);
+	flow->rule.last_packet_cnt = cntr;
+	flow->lastused = jiffies;
+}
+
+/* Periodically harvests the packet counters of all offloaded flows. Stats requests
+ * are answered from the values cached here, so listing many filters does not cause
+ * a burst of LOG table reads
+ */
+static void rtl83xx_tc_stats_work_do(struct work_struct *work)
+{
+	struct rtl838x_switch_priv *priv =
+		container_of(to_delayed_work(work), struct rtl838x_switch_priv, tc_stats_work);
+	struct rtl83xx_flow *flow;
+
+	mutex_lock(&rtl83xx_tc_mutex);
+	list_for_each_entry(flow, &priv->tc_flows, list)
+		rtl83xx_flow_harvest(priv, flow);
+	mutex_unlock(&rtl83xx_tc_mutex);
+
+	schedule_delayed_work(&priv->tc_stats_work, TC_STATS_INTERVAL);
+}
+
+/* Adds the flower filter f, port is the switch port the filter was attached to or
+ * -1 for filters on the CPU port's master device, which match on all ports
+ */
 static int rtl83xx_configure_flower(struct rtl838x_switch_priv *priv,
-				    struct flow_cls_offload *f)
+				    struct flow_cls_offload *f, int port)
 {
 	struct rtl83xx_flow *flow;
 	int err = 0;
 
 	pr_debug("In %s\n", __func__);
 
-	rcu_read_lock();
+	mutex_lock(&rtl83xx_tc_mutex);
+
 	pr_debug("Cookie %08lx\n", f->cookie);
-	flow = rhashtable_lookup(&priv->tc_ht, &f->cookie, tc_ht_params);
+	flow = rhashtable_lookup_fast(&priv->tc_ht, &f->cookie, tc_ht_params);
 	if (flow) {
+		/* A filter of a block shared between ports is offered once per port,
+		 * these share the rule installed for the first port
+		 */
+		if (port >= 0 && flow->ports && !(flow->ports & BIT_ULL(port))) {
+			err = rtl83xx_flow_set_ports(priv, flow, flow->ports | BIT_ULL(port));
+			if (err)
+				goto out;
+			mutex_unlock(&rtl83xx_tc_mutex);
+			return 0;
+		}
 		pr_info("%s: Got flow\n", __func__);
 		err = -EEXIST;
-		goto rcu_unlock;
+		goto out;
 	}
 
-rcu_unlock:
-	rcu_read_unlock();
-	if (flow)
-		goto out;
 	pr_debug("%s: New flow\n", __func__);
 
 	flow = kzalloc(sizeof(*flow), GFP_KERNEL);
@@ -262,14 +338,15 @@ rcu_unlock:
 
 	flow->cookie = f->cookie;
 	flow->priv = priv;
+	flow->rule.id = -1;
+	flow->rule.prio = f->common.prio;
 
-	err = rhashtable_insert_fast(&priv->tc_ht, &flow->node, tc_ht_params);
-	if (err) {
-		pr_err("Could not insert add new rule\n");
+	err = rtl83xx_add_flow(priv, f, flow);
+	if (err)
 		goto out_free;
-	}
 
-	rtl83xx_add_flow(priv, f, flow); /* TODO: check error */
+	if (port >= 0)
+		rtl83xx_flow_set_ports(priv, flow, BIT_ULL(port));
 
 	/* Add log action to flow */
 	flow->rule.packet_cntr = rtl83xx_packet_cntr_alloc(priv);
@@ -280,62 +357,97 @@ rcu_unlock:
 	}
 
 	err = priv->r->pie_rule_add(priv, &flow->rule);
-	return err;
+	if (err)
+		goto out_release;
+
+	err = rhashtable_insert_fast(&priv->tc_ht, &flow->node, tc_ht_params);
+	if (err) {
+		pr_err("Could not insert add new rule\n");
+		goto out_release;
+	}
+
+	/* Counters are not cleared when released, start counting from here */
+	if (flow->rule.packet_cntr >= 0 && priv->r->packet_cntr_read)
+		flow->rule.last_packet_cnt = priv->r->packet_cntr_read(flow->rule.packet_cntr);
+	flow->lastused = jiffies;
+	list_add_tail(&flow->list, &priv->tc_flows);
 
+	mutex_unlock(&rtl83xx_tc_mutex);
+
+	return 0;
+
+out_release:
+	rtl83xx_flow_release(priv, flow);
 out_free:
 	kfree(flow);
 out:
+	mutex_unlock(&rtl83xx_tc_mutex);
 	pr_err("%s: error %d\n", __func__, err);
 
 	return err;
 }
 
 static int rtl83xx_delete_flower(struct rtl838x_switch_priv *priv,
-				 struct flow_cls_offload * cls_flower)
+				 struct flow_cls_offload * cls_flower, int port)
 {
 	struct rtl83xx_flow *flow;
+	int err = 0;
 
 	pr_debug("In %s\n", __func__);
-	rcu_read_lock();
+
+	mutex_lock(&rtl83xx_tc_mutex);
+
 	flow = rhashtable_lookup_fast(&priv->tc_ht, &cls_flower->cookie, tc_ht_params);
 	if (!flow) {
-		rcu_read_unlock();
-		return -EINVAL;
+		err = -EINVAL;
+		goto out;
 	}
 
-	priv->r->pie_rule_rm(priv, &flow->rule);
+	/* Other ports still use the rule */
+	if (port >= 0 && (flow->ports & ~BIT_ULL(port))) {
+		err = rtl83xx_flow_set_ports(priv, flow, flow->ports & ~BIT_ULL(port));
+		goto out;
+	}
 
 	rhashtable_remove_fast(&priv->tc_ht, &flow->node, tc_ht_params);
+	list_del(&flow->list);
+	rtl83xx_flow_release(priv, flow);
 
 	kfree_rcu(flow, rcu_head);
 
-	rcu_read_unlock();
+out:
+	mutex_unlock(&rtl83xx_tc_mutex);
 
-	return 0;
+	return err;
 }
 
 static int rtl83xx_stats_flower(struct rtl838x_switch_priv *priv,
 				struct flow_cls_offload * cls_flower)
 {
 	struct rtl83xx_flow *flow;
-	unsigned long lastused = 0;
-	int total_packets, new_packets;
+	unsigned long lastused;
+	u64 new_packets;
 
 	pr_debug("%s: \n", __func__);
-	flow = rhashtable_lookup_fast(&priv->tc_ht, &cls_flower->cookie, tc_ht_params);
-	if (!flow)
-		return -1;
+	mutex_lock(&rtl83xx_tc_mutex);
 
-	if (flow->rule.packet_cntr >= 0) {
-		total_packets = priv->r->packet_cntr_read(flow->rule.packet_cntr);
-		pr_debug("Total packets: %d\n", total_packets);
-		new_packets = total_packets - flow->rule.last_packet_cnt;
-		flow->rule.last_packet_cnt = total_packets;
+	flow = rhashtable_lookup_fast(&priv->tc_ht, &cls_flower->cookie, tc_ht_params);
+	if (!flow) {
+		mutex_unlock(&rtl83xx_tc_mutex);
+		return -ENOENT;
 	}
 
-	/* TODO: We need a second PIE rule to count the bytes */
-	flow_stats_update(&cls_flower->stats, 100 * new_packets, new_packets, 0, lastused,
-	                  FLOW_ACTION_HW_STATS_IMMEDIATE);
+	new_packets = flow->packets - flow->reported;
+	flow->reported = flow->packets;
+	lastused = flow->lastused;
+
+	mutex_unlock(&rtl83xx_tc_mutex);
+
+	/* The LOG action of a rule feeds a single counter, which counts packets. The
+	 * byte count is unknown and left at 0 instead of being estimated
+	 */
+	flow_stats_update(&cls_flower->stats, 0, new_packets, 0, lastused,
+			  FLOW_ACTION_HW_STATS_DELAYED);
 
 	return 0;
 }
@@ -346,9 +458,9 @@ static int rtl83xx_setup_tc_cls_flower(struct rtl838x_switch_priv *priv,
 	pr_debug("%s: %d\n", __func__, cls_flower->command);
 	switch (cls_flower->command) {
 	case FLOW_CLS_REPLACE:
-		return rtl83xx_configure_flower(priv, cls_flower);
+		return rtl83xx_configure_flower(priv, cls_flower, -1);
 	case FLOW_CLS_DESTROY:
-		return rtl83xx_delete_flower(priv, cls_flower);
+		return rtl83xx_delete_flower(priv, cls_flower, -1);
 	case FLOW_CLS_STATS:
 		return rtl83xx_stats_flower(priv, cls_flower);
 	default:
@@ -377,8 +489,6 @@ int rtl83xx_setup_tc(struct net_device *dev, enum tc_setup_type type, void *type
 {
 	struct rtl838x_switch_priv *priv;
 	struct flow_block_offload *f = type_data;
-	static bool first_time = true;
-	int err;
 
 	pr_debug("%s: %d\n", __func__, type);
 
@@ -390,13 +500,6 @@ int rtl83xx_setup_tc(struct net_device *dev, enum tc_setup_type type, void *type
 
 	switch (type) {
 	case TC_SETUP_BLOCK:
-		if (first_time) {
-			first_time = false;
-			err = rhashtable_init(&priv->tc_ht, &tc_ht_params);
-			if (err)
-				pr_err("%s: Could not initialize hash table\n", __func__);
-		}
-
 		f->unlocked_driver_cb = true;
 		return flow_block_cb_setup_simple(type_data,
 						  &rtl83xx_block_cb_list,
@@ -408,3 +511,40 @@ int rtl83xx_setup_tc(struct net_device *dev, enum tc_setup_type type, void *type
 
 	return 0;
 }
+
+/* Flower filters bound to the switch ports, these match on the ingress port */
+int rtl83xx_cls_flower_add(struct dsa_switch *ds, int port, struct flow_cls_offload *cls,
+			   bool ingress)
+{
+	if (!ingress)
+		return -EOPNOTSUPP;
+
+	return rtl83xx_configure_flower(ds->priv, cls, port);
+}
+
+int rtl83xx_cls_flower_del(struct dsa_switch *ds, int port, struct flow_cls_offload *cls,
+			   bool ingress)
+{
+	return rtl83xx_delete_flower(ds->priv, cls, port);
+}
+
+int rtl83xx_cls_flower_stats(struct dsa_switch *ds, int port, struct flow_cls_offload *cls,
+			     bool ingress)
+{
+	return rtl83xx_stats_flower(ds->priv, cls);
+}
+
+int rtl83xx_tc_init(struct rtl838x_switch_priv *priv)
+{
+	INIT_LIST_HEAD(&priv->tc_flows);
+	INIT_DELAYED_WORK(&priv->tc_stats_work, rtl83xx_tc_stats_work_do);
+	if (priv->r->packet_cntr_read)
+		schedule_delayed_work(&priv->tc_stats_work, TC_STATS_INTERVAL);
+
+	return rhashtable_init(&priv->tc_ht, &tc_ht_params);
+}
+
+void rtl83xx_tc_fini(struct rtl838x_switch_priv *priv)
+{
+	cancel_delayed_work_sync(&priv->tc_stats_work);
+}
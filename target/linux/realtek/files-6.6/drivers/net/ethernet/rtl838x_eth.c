@@ -5,11 +5,13 @@
 
 #include <linux/dma-mapping.h>
 #include <linux/etherdevice.h>
+#include <linux/if_bridge.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
 #include <linux/platform_device.h>
 #include <linux/sched.h>
 #include <linux/slab.h>
+#include <linux/u64_stats_sync.h>
 #include <linux/of.h>
 #include <linux/of_net.h>
 #include <linux/of_mdio.h>
@@ -17,6 +19,7 @@
 #include <linux/phylink.h>
 #include <linux/pkt_sched.h>
 #include <net/dsa.h>
+#include <net/page_pool/helpers.h>
 #include <net/switchdev.h>
 #include <asm/cacheflush.h>
 
@@ -39,6 +42,7 @@ extern struct rtl83xx_soc_info soc_info;
 #define TXRINGLEN	160
 #define NOTIFY_EVENTS	10
 #define NOTIFY_BLOCKS	10
+#define FDB_EVENTS	(2 * NOTIFY_BLOCKS * NOTIFY_EVENTS)
 #define TX_EN		0x8
 #define RX_EN		0x4
 #define TX_EN_93XX	0x20
@@ -53,6 +57,16 @@ extern struct rtl83xx_soc_info soc_info;
 
 #define RING_BUFFER	1600
 
+/* In page_pool mode every RX descriptor owns half a page. The ASIC writes
+ * the frame behind the headroom, the skb_shared_info goes at the end.
+ */
+#define RX_PP_FRAG_SIZE	(PAGE_SIZE / 2)
+#define RX_PP_HEADROOM	(NET_SKB_PAD + NET_IP_ALIGN)
+
+static bool rx_page_pool;
+module_param(rx_page_pool, bool, 0444);
+MODULE_PARM_DESC(rx_page_pool, "Receive into page_pool buffers instead of copying from the ring buffer");
+
 struct p_hdr {
 	uint8_t		*buf;
 	uint16_t	reserved;
@@ -79,7 +93,6 @@ struct ring_b {
 	struct	p_hdr	tx_header[TXRINGS][TXRINGLEN];
 	uint32_t	c_rx[MAX_RXRINGS];
 	uint32_t	c_tx[TXRINGS];
-	uint8_t		tx_space[TXRINGS * TXRINGLEN * RING_BUFFER];
 	uint8_t		*rx_space;
 };
 
@@ -172,10 +185,40 @@ static void rtl931x_create_tx_header(struct p_hdr *h, unsigned int dest_port, in
 // 	h->cpu_tag[3] |= (vlan & 0xff) << 8;
 // }
 
+struct rtl838x_rx_stats {
+	struct u64_stats_sync syncp;
+	u64 packets;
+	u64 bytes;
+	u64 dropped;
+};
+
+/* Each RX ring is processed by its own NAPI context. The ring lock
+ * serialises it against rtl838x_rb_cleanup() on RX buffer overruns.
+ */
 struct rtl838x_rx_q {
 	int id;
 	struct rtl838x_eth_priv *priv;
 	struct napi_struct napi;
+	spinlock_t lock;
+	struct rtl838x_rx_stats stats;
+	struct page_pool *page_pool;
+	void *rx_buf[MAX_RXLEN];
+	dma_addr_t rx_dma[MAX_RXLEN];
+};
+
+/* An skb handed to the ASIC, kept mapped until its descriptor comes back */
+struct rtl838x_tx_buf {
+	struct sk_buff *skb;
+	dma_addr_t dma;
+	unsigned int len;
+};
+
+/* A learning or aging event taken from the L2 notification ring */
+struct rtl838x_fdb_event {
+	u8 mac[ETH_ALEN];
+	u16 vid;
+	u8 port;
+	bool add;
 };
 
 struct rtl838x_eth_priv {
@@ -185,6 +228,9 @@ struct rtl838x_eth_priv {
 	spinlock_t lock;
 	struct mii_bus *mii_bus;
 	struct rtl838x_rx_q rx_qs[MAX_RXRINGS];
+	struct napi_struct tx_napi;
+	struct rtl838x_tx_buf tx_bufs[TXRINGS][TXRINGLEN];
+	u32 tx_dirty[TXRINGS];
 	struct phylink *phylink;
 	struct phylink_config phylink_config;
 	struct phylink_pcs pcs;
@@ -193,8 +239,15 @@ struct rtl838x_eth_priv {
 	const struct rtl838x_eth_reg *r;
 	u8 cpu_port;
 	u32 lastEvent;
+	spinlock_t fdb_lock;		/* Protects the FDB event buffers */
+	struct work_struct fdb_work;
+	struct rtl838x_fdb_event fdb_events[2][FDB_EVENTS];
+	u8 fdb_buf;			/* Buffer the interrupt handler fills */
+	u16 fdb_n;
+	u32 fdb_dropped;
 	u16 rxrings;
 	u16 rxringlen;
+	bool rx_page_pool;
 	int smi_bus[MAX_PORTS];
 	u8 smi_addr[MAX_PORTS];
 	u32 sds_id[MAX_PORTS];
@@ -337,21 +390,28 @@ bool rtl931x_decode_tag(struct p_hdr *h, struct dsa_tag *t)
 static void rtl838x_rb_cleanup(struct rtl838x_eth_priv *priv, int status)
 {
 	for (int r = 0; r < priv->rxrings; r++) {
+		struct rtl838x_rx_q *rx_q = &priv->rx_qs[r];
 		struct ring_b *ring = priv->membase;
+		unsigned int dropped = 0;
 		struct p_hdr *h;
 		u32 *last;
 
 		pr_debug("In %s working on r: %d\n", __func__, r);
+		spin_lock(&rx_q->lock);
 		last = (u32 *)KSEG1ADDR(sw_r32(priv->r->dma_if_rx_cur + r * 4));
 		do {
 			if ((ring->rx_r[r][ring->c_rx[r]] & 0x1))
 				break;
 			pr_debug("Got something: %d\n", ring->c_rx[r]);
+			dropped++;
 			h = &ring->rx_header[r][ring->c_rx[r]];
 			memset(h, 0, sizeof(struct p_hdr));
-			h->buf = (u8 *)KSEG1ADDR(ring->rx_space +
-			                         r * priv->rxringlen * RING_BUFFER +
-			                         ring->c_rx[r] * RING_BUFFER);
+			if (priv->rx_page_pool)
+				h->buf = (u8 *)KSEG1ADDR(priv->rx_qs[r].rx_dma[ring->c_rx[r]]);
+			else
+				h->buf = (u8 *)KSEG1ADDR(ring->rx_space +
+				                         r * priv->rxringlen * RING_BUFFER +
+				                         ring->c_rx[r] * RING_BUFFER);
 			h->size = RING_BUFFER;
 			/* make sure the header is visible to the ASIC */
 			mb();
@@ -361,74 +421,100 @@ static void rtl838x_rb_cleanup(struct rtl838x_eth_priv *priv, int status)
 			                               0x1);
 			ring->c_rx[r] = (ring->c_rx[r] + 1) % priv->rxringlen;
 		} while (&ring->rx_r[r][ring->c_rx[r]] != last);
+
+		u64_stats_update_begin(&rx_q->stats.syncp);
+		rx_q->stats.dropped += dropped;
+		u64_stats_update_end(&rx_q->stats.syncp);
+		spin_unlock(&rx_q->lock);
 	}
 }
 
-struct fdb_update_work {
-	struct work_struct work;
-	struct net_device *ndev;
-	u64 macs[NOTIFY_EVENTS + 1];
-};
+/* Hands the learning and aging events collected by the interrupt handler to the
+ * bridge. Events pile up in one buffer while the other one is processed, so a
+ * single work item covers any number of notification blocks
+ */
+static void rtl838x_fdb_sync(struct work_struct *work)
+{
+	struct rtl838x_eth_priv *priv = container_of(work, struct rtl838x_eth_priv, fdb_work);
+	struct dsa_port *cpu_dp = priv->netdev->dsa_ptr;
+	struct rtl838x_fdb_event *events;
+	u32 dropped;
+	int n;
+
+	spin_lock_irq(&priv->fdb_lock);
+	events = priv->fdb_events[priv->fdb_buf];
+	n = priv->fdb_n;
+	dropped = priv->fdb_dropped;
+	priv->fdb_buf ^= 1;
+	priv->fdb_n = 0;
+	priv->fdb_dropped = 0;
+	spin_unlock_irq(&priv->fdb_lock);
+
+	if (dropped)
+		netdev_warn_once(priv->netdev, "%u L2 notifications lost\n", dropped);
+
+	if (!cpu_dp)
+		return;
 
-void rtl838x_fdb_sync(struct work_struct *work)
-{
-	const struct fdb_update_work *uw = container_of(work, struct fdb_update_work, work);
+	rtnl_lock();
+	for (int i = 0; i < n; i++) {
+		const struct rtl838x_fdb_event *ev = &events[i];
+		struct switchdev_notifier_fdb_info info = {};
+		struct dsa_port *dp = dsa_to_port(cpu_dp->ds, ev->port);
+		struct net_device *br;
+		int action;
 
-	for (int i = 0; uw->macs[i]; i++) {
-	        struct switchdev_notifier_fdb_info info;
-	        u8 addr[ETH_ALEN];
-	        int action;
+		if (!dp || !dp->slave)
+			continue;
+
+		/* Only bridged ports learn, the notified FID is a VLAN if the bridge filters */
+		br = dsa_port_bridge_dev_get(dp);
+		if (!br)
+			continue;
 
-		action = (uw->macs[i] & (1ULL << 63)) ?
-		         SWITCHDEV_FDB_ADD_TO_BRIDGE :
-		         SWITCHDEV_FDB_DEL_TO_BRIDGE;
-		u64_to_ether_addr(uw->macs[i] & 0xffffffffffffULL, addr);
-		info.addr = &addr[0];
-		info.vid = 0;
+		action = ev->add ? SWITCHDEV_FDB_ADD_TO_BRIDGE : SWITCHDEV_FDB_DEL_TO_BRIDGE;
+		info.addr = ev->mac;
+		info.vid = br_vlan_enabled(br) ? ev->vid : 0;
 		info.offloaded = 1;
-		pr_debug("FDB entry %d: %llx, action %d\n", i, uw->macs[0], action);
-		call_switchdev_notifiers(action, uw->ndev, &info.info, NULL);
+		pr_debug("FDB entry %d: %pM, port %d, action %d\n", i, ev->mac, ev->port, action);
+		call_switchdev_notifiers(action, dp->slave, &info.info, NULL);
 	}
-	kfree(work);
+	rtnl_unlock();
 }
 
 static void rtl839x_l2_notification_handler(struct rtl838x_eth_priv *priv)
 {
 	struct notify_b *nb = priv->membase + sizeof(struct ring_b);
-        u32 e = priv->lastEvent;
+	u32 e = priv->lastEvent;
 
+	spin_lock(&priv->fdb_lock);
 	while (!(nb->ring[e] & 1)) {
-                struct fdb_update_work *w;
-                struct n_event *event;
-                u64 mac;
-                int i;
-
-		w = kzalloc(sizeof(*w), GFP_ATOMIC);
-		if (!w) {
-			pr_err("Out of memory: %s", __func__);
-			return;
-		}
-		INIT_WORK(&w->work, rtl838x_fdb_sync);
+		for (int i = 0; i < NOTIFY_EVENTS; i++) {
+			struct n_event *event = &nb->blocks[e].events[i];
+			struct rtl838x_fdb_event *ev;
 
-		for (i = 0; i < NOTIFY_EVENTS; i++) {
-			event = &nb->blocks[e].events[i];
 			if (!event->valid)
 				continue;
-			mac = event->mac;
-			if (event->type)
-				mac |= 1ULL << 63;
-			w->ndev = priv->netdev;
-			w->macs[i] = mac;
+			if (priv->fdb_n >= FDB_EVENTS) {
+				priv->fdb_dropped++;
+				continue;
+			}
+
+			ev = &priv->fdb_events[priv->fdb_buf][priv->fdb_n++];
+			u64_to_ether_addr(event->mac, ev->mac);
+			ev->vid = event->fidVid;
+			ev->port = event->slp;
+			ev->add = !!event->type;
 		}
 
 		/* Hand the ring entry back to the switch */
 		nb->ring[e] = nb->ring[e] | 1;
 		e = (e + 1) % NOTIFY_BLOCKS;
-
-		w->macs[i] = 0ULL;
-		schedule_work(&w->work);
 	}
+	spin_unlock(&priv->fdb_lock);
+
 	priv->lastEvent = e;
+	schedule_work(&priv->fdb_work);
 }
 
 static irqreturn_t rtl83xx_net_irq(int irq, void *dev_id)
@@ -439,10 +525,12 @@ static irqreturn_t rtl83xx_net_irq(int irq, void *dev_id)
 
 	pr_debug("IRQ: %08x\n", status);
 
-	/*  Ignore TX interrupt */
+	/* TX done: disable TX interrupts and reclaim descriptors in NAPI */
 	if ((status & 0xf0000)) {
+		sw_w32_mask(0xf0000, 0, priv->r->dma_if_intr_msk);
 		/* Clear ISR */
 		sw_w32(0x000f0000, priv->r->dma_if_intr_sts);
+		napi_schedule(&priv->tx_napi);
 	}
 
 	/* RX interrupt */
@@ -495,11 +583,13 @@ static irqreturn_t rtl93xx_net_irq(int irq, void *dev_id)
 	pr_debug("In %s, status_tx: %08x, status_rx: %08x, status_rx_r: %08x\n",
 		__func__, status_tx, status_rx, status_rx_r);
 
-	/*  Ignore TX interrupt */
+	/* TX done: disable TX interrupts and reclaim descriptors in NAPI */
 	if (status_tx) {
-		/* Clear ISR */
 		pr_debug("TX done\n");
+		sw_w32(0x00000000, priv->r->dma_if_intr_tx_done_msk);
+		/* Clear ISR */
 		sw_w32(status_tx, priv->r->dma_if_intr_tx_done_sts);
+		napi_schedule(&priv->tx_napi);
 	}
 
 	/* RX interrupt */
@@ -815,6 +905,81 @@ static void rtl93xx_hw_en_rxtx(struct rtl838x_eth_priv *priv)
 		sw_w32(0x2a1d, priv->r->mac_force_mode_ctrl + priv->cpu_port * 4);
 }
 
+static int rtl838x_rx_pp_alloc(struct rtl838x_eth_priv *priv, struct rtl838x_rx_q *rx_q, int idx)
+{
+	unsigned int offset;
+	struct page *page;
+
+	page = page_pool_dev_alloc_frag(rx_q->page_pool, &offset, RX_PP_FRAG_SIZE);
+	if (!page)
+		return -ENOMEM;
+
+	rx_q->rx_buf[idx] = page_address(page) + offset;
+	rx_q->rx_dma[idx] = page_pool_get_dma_addr(page) + offset + RX_PP_HEADROOM;
+	dma_sync_single_for_device(&priv->pdev->dev, rx_q->rx_dma[idx],
+	                           RING_BUFFER, DMA_FROM_DEVICE);
+
+	return 0;
+}
+
+static void rtl838x_rx_pp_destroy(struct rtl838x_eth_priv *priv)
+{
+	for (int r = 0; r < priv->rxrings; r++) {
+		struct rtl838x_rx_q *rx_q = &priv->rx_qs[r];
+
+		if (!rx_q->page_pool)
+			continue;
+
+		for (int i = 0; i < priv->rxringlen; i++) {
+			if (!rx_q->rx_buf[i])
+				continue;
+			page_pool_put_full_page(rx_q->page_pool,
+			                        virt_to_head_page(rx_q->rx_buf[i]), false);
+			rx_q->rx_buf[i] = NULL;
+		}
+
+		page_pool_destroy(rx_q->page_pool);
+		rx_q->page_pool = NULL;
+	}
+}
+
+/* Create one page_pool per RX ring and attach a buffer to every descriptor.
+ * Must be called before the ring buffer is set up, with the DMA stopped.
+ */
+static int rtl838x_rx_pp_setup(struct rtl838x_eth_priv *priv)
+{
+	BUILD_BUG_ON(SKB_WITH_OVERHEAD(RX_PP_FRAG_SIZE) - RX_PP_HEADROOM < RING_BUFFER);
+
+	for (int r = 0; r < priv->rxrings; r++) {
+		struct rtl838x_rx_q *rx_q = &priv->rx_qs[r];
+		struct page_pool_params pp_params = {
+			.flags = PP_FLAG_DMA_MAP | PP_FLAG_PAGE_FRAG,
+			.pool_size = priv->rxringlen,
+			.nid = NUMA_NO_NODE,
+			.dev = &priv->pdev->dev,
+			.napi = &rx_q->napi,
+			.dma_dir = DMA_FROM_DEVICE,
+		};
+		struct page_pool *pp;
+
+		pp = page_pool_create(&pp_params);
+		if (IS_ERR(pp)) {
+			rtl838x_rx_pp_destroy(priv);
+			return PTR_ERR(pp);
+		}
+		rx_q->page_pool = pp;
+
+		for (int i = 0; i < priv->rxringlen; i++) {
+			if (rtl838x_rx_pp_alloc(priv, rx_q, i)) {
+				rtl838x_rx_pp_destroy(priv);
+				return -ENOMEM;
+			}
+		}
+	}
+
+	return 0;
+}
+
 static void rtl838x_setup_ring_buffer(struct rtl838x_eth_priv *priv, struct ring_b *ring)
 {
 	for (int i = 0; i < priv->rxrings; i++) {
@@ -824,9 +989,12 @@ static void rtl838x_setup_ring_buffer(struct rtl838x_eth_priv *priv, struct ring
 		for (j = 0; j < priv->rxringlen; j++) {
 			h = &ring->rx_header[i][j];
 			memset(h, 0, sizeof(struct p_hdr));
-			h->buf = (u8 *)KSEG1ADDR(ring->rx_space +
-			                         i * priv->rxringlen * RING_BUFFER +
-			                         j * RING_BUFFER);
+			if (priv->rx_page_pool)
+				h->buf = (u8 *)KSEG1ADDR(priv->rx_qs[i].rx_dma[j]);
+			else
+				h->buf = (u8 *)KSEG1ADDR(ring->rx_space +
+				                         i * priv->rxringlen * RING_BUFFER +
+				                         j * RING_BUFFER);
 			h->size = RING_BUFFER;
 			/* All rings owned by switch, last one wraps */
 			ring->rx_r[i][j] = KSEG1ADDR(h) | 1 | (j == (priv->rxringlen - 1) ?
@@ -840,18 +1008,16 @@ static void rtl838x_setup_ring_buffer(struct rtl838x_eth_priv *priv, struct ring
 		struct p_hdr *h;
 		int j;
 
+		/* Buffers are attached to the headers in rtl838x_eth_tx() */
 		for (j = 0; j < TXRINGLEN; j++) {
 			h = &ring->tx_header[i][j];
 			memset(h, 0, sizeof(struct p_hdr));
-			h->buf = (u8 *)KSEG1ADDR(ring->tx_space +
-			                         i * TXRINGLEN * RING_BUFFER +
-			                         j * RING_BUFFER);
-			h->size = RING_BUFFER;
 			ring->tx_r[i][j] = KSEG1ADDR(&ring->tx_header[i][j]);
 		}
 		/* Last header is wrapping around */
 		ring->tx_r[i][j - 1] |= WRAP;
 		ring->c_tx[i] = 0;
+		priv->tx_dirty[i] = 0;
 	}
 }
 
@@ -874,6 +1040,30 @@ static void rtl839x_setup_notify_ring_buffer(struct rtl838x_eth_priv *priv)
 	priv->lastEvent = 0;
 }
 
+/* Drop all skbs still owned by the TX rings. The ring positions are kept,
+ * they are only reset together with the hardware in rtl838x_eth_open().
+ */
+static void rtl838x_tx_clean(struct rtl838x_eth_priv *priv)
+{
+	struct ring_b *ring = priv->membase;
+
+	for (int q = 0; q < TXRINGS; q++) {
+		for (int i = 0; i < TXRINGLEN; i++) {
+			struct rtl838x_tx_buf *buf = &priv->tx_bufs[q][i];
+
+			ring->tx_r[q][i] &= ~0x1;
+			if (!buf->skb)
+				continue;
+
+			dma_unmap_single(&priv->pdev->dev, buf->dma, buf->len, DMA_TO_DEVICE);
+			dev_kfree_skb_any(buf->skb);
+			buf->skb = NULL;
+		}
+		priv->tx_dirty[q] = ring->c_tx[q];
+		netdev_tx_reset_queue(netdev_get_tx_queue(priv->netdev, q));
+	}
+}
+
 static int rtl838x_eth_open(struct net_device *ndev)
 {
 	unsigned long flags;
@@ -883,6 +1073,15 @@ static int rtl838x_eth_open(struct net_device *ndev)
 	pr_debug("%s called: RX rings %d(length %d), TX rings %d(length %d)\n",
 		__func__, priv->rxrings, priv->rxringlen, TXRINGS, TXRINGLEN);
 
+	if (priv->rx_page_pool) {
+		int err = rtl838x_rx_pp_setup(priv);
+
+		if (err) {
+			netdev_err(ndev, "cannot set up RX page pools: %d\n", err);
+			return err;
+		}
+	}
+
 	spin_lock_irqsave(&priv->lock, flags);
 	rtl838x_hw_reset(priv);
 	rtl838x_setup_ring_buffer(priv, ring);
@@ -898,6 +1097,7 @@ static int rtl838x_eth_open(struct net_device *ndev)
 
 	for (int i = 0; i < priv->rxrings; i++)
 		napi_enable(&priv->rx_qs[i].napi);
+	napi_enable(&priv->tx_napi);
 
 	switch (priv->family_id) {
 	case RTL8380_FAMILY_ID:
@@ -1019,8 +1219,13 @@ static int rtl838x_eth_stop(struct net_device *ndev)
 
 	for (int i = 0; i < priv->rxrings; i++)
 		napi_disable(&priv->rx_qs[i].napi);
+	napi_disable(&priv->tx_napi);
 
 	netif_tx_stop_all_queues(ndev);
+	rtl838x_tx_clean(priv);
+
+	if (priv->rx_page_pool)
+		rtl838x_rx_pp_destroy(priv);
 
 	return 0;
 }
@@ -1112,6 +1317,7 @@ static void rtl838x_eth_tx_timeout(struct net_device *ndev, unsigned int txqueue
 	pr_warn("%s\n", __func__);
 	spin_lock_irqsave(&priv->lock, flags);
 	rtl838x_hw_stop(priv);
+	rtl838x_tx_clean(priv);
 	rtl838x_hw_ring_setup(priv);
 	rtl838x_hw_en_rxtx(priv);
 	netif_trans_update(ndev);
@@ -1124,16 +1330,24 @@ static int rtl838x_eth_tx(struct sk_buff *skb, struct net_device *dev)
 	int len;
 	struct rtl838x_eth_priv *priv = netdev_priv(dev);
 	struct ring_b *ring = priv->membase;
-	int ret;
 	unsigned long flags;
 	struct p_hdr *h;
 	int dest_port = -1;
 	int q = skb_get_queue_mapping(skb) % TXRINGS;
+	struct netdev_queue *txq = netdev_get_tx_queue(dev, q);
+	struct rtl838x_tx_buf *buf = &priv->tx_bufs[q][ring->c_tx[q]];
+	dma_addr_t dma;
 
 	if (q) /* Check for high prio queue */
 		pr_debug("SKB priority: %d\n", skb->priority);
 
-	spin_lock_irqsave(&priv->lock, flags);
+	/* We can send this packet only if CPU owns the descriptor */
+	if (unlikely(buf->skb || (ring->tx_r[q][ring->c_tx[q]] & 0x1))) {
+		dev_warn(&priv->pdev->dev, "Data is owned by switch\n");
+		netif_tx_stop_queue(txq);
+		return NETDEV_TX_BUSY;
+	}
+
 	len = skb->len;
 
 	/* Check for DSA tagging at the end of the buffer */
@@ -1150,69 +1364,78 @@ static int rtl838x_eth_tx(struct sk_buff *skb, struct net_device *dev)
 
 	len += 4; /* Add space for CRC */
 
-	if (skb_padto(skb, len)) {
-		ret = NETDEV_TX_OK;
-		goto txdone;
+	if (skb_padto(skb, len))
+		return NETDEV_TX_OK;
+
+	/* The ASIC reads the frame straight from the skb */
+	dma = dma_map_single(&priv->pdev->dev, skb->data, len, DMA_TO_DEVICE);
+	if (unlikely(dma_mapping_error(&priv->pdev->dev, dma))) {
+		dev_kfree_skb_any(skb);
+		dev->stats.tx_dropped++;
+		return NETDEV_TX_OK;
 	}
 
-	/* We can send this packet if CPU owns the descriptor */
-	if (!(ring->tx_r[q][ring->c_tx[q]] & 0x1)) {
+	/* Set descriptor for tx */
+	h = &ring->tx_header[q][ring->c_tx[q]];
+	h->buf = (u8 *)KSEG1ADDR(dma);
+	h->size = len;
+	h->len = len;
+	/* On RTL8380 SoCs, small packet lengths being sent need adjustments */
+	if (priv->family_id == RTL8380_FAMILY_ID) {
+		if (len < ETH_ZLEN - 4)
+			h->len -= 4;
+	}
 
-		/* Set descriptor for tx */
-		h = &ring->tx_header[q][ring->c_tx[q]];
-		h->size = len;
-		h->len = len;
-		/* On RTL8380 SoCs, small packet lengths being sent need adjustments */
-		if (priv->family_id == RTL8380_FAMILY_ID) {
-			if (len < ETH_ZLEN - 4)
-				h->len -= 4;
-		}
+	if (dest_port >= 0)
+		priv->r->create_tx_header(h, dest_port, skb->priority >> 1);
 
-		if (dest_port >= 0)
-			priv->r->create_tx_header(h, dest_port, skb->priority >> 1);
+	buf->skb = skb;
+	buf->dma = dma;
+	buf->len = len;
 
-		/* Copy packet data to tx buffer */
-		memcpy((void *)KSEG1ADDR(h->buf), skb->data, len);
-		/* Make sure packet data is visible to ASIC */
-		wmb();
+	/* Make sure the header is visible to the ASIC */
+	wmb();
 
-		/* Hand over to switch */
-		ring->tx_r[q][ring->c_tx[q]] |= 1;
+	/* Hand over to switch */
+	ring->tx_r[q][ring->c_tx[q]] |= 1;
+	ring->c_tx[q] = (ring->c_tx[q] + 1) % TXRINGLEN;
 
-		/* Before starting TX, prevent a Lextra bus bug on RTL8380 SoCs */
-		if (priv->family_id == RTL8380_FAMILY_ID) {
-			for (int i = 0; i < 10; i++) {
-				u32 val = sw_r32(priv->r->dma_if_ctrl);
-				if ((val & 0xc) == 0xc)
-					break;
-			}
-		}
+	dev->stats.tx_packets++;
+	dev->stats.tx_bytes += len;
 
-		/* Tell switch to send data */
-		if (priv->family_id == RTL9310_FAMILY_ID || priv->family_id == RTL9300_FAMILY_ID) {
-			/* Ring ID q == 0: Low priority, Ring ID = 1: High prio queue */
-			if (!q)
-				sw_w32_mask(0, BIT(2), priv->r->dma_if_ctrl);
-			else
-				sw_w32_mask(0, BIT(3), priv->r->dma_if_ctrl);
-		} else {
-			sw_w32_mask(0, TX_DO, priv->r->dma_if_ctrl);
+	/* Stop the queue until rtl838x_tx_reclaim() frees the next descriptor */
+	if (priv->tx_bufs[q][ring->c_tx[q]].skb)
+		netif_tx_stop_queue(txq);
+
+	/* Only kick the DMA once for a burst of packets */
+	if (!__netdev_tx_sent_queue(txq, len, netdev_xmit_more()))
+		return NETDEV_TX_OK;
+
+	spin_lock_irqsave(&priv->lock, flags);
+
+	/* Before starting TX, prevent a Lextra bus bug on RTL8380 SoCs */
+	if (priv->family_id == RTL8380_FAMILY_ID) {
+		for (int i = 0; i < 10; i++) {
+			u32 val = sw_r32(priv->r->dma_if_ctrl);
+			if ((val & 0xc) == 0xc)
+				break;
 		}
+	}
 
-		dev->stats.tx_packets++;
-		dev->stats.tx_bytes += len;
-		dev_kfree_skb(skb);
-		ring->c_tx[q] = (ring->c_tx[q] + 1) % TXRINGLEN;
-		ret = NETDEV_TX_OK;
+	/* Tell switch to send data */
+	if (priv->family_id == RTL9310_FAMILY_ID || priv->family_id == RTL9300_FAMILY_ID) {
+		/* Ring ID q == 0: Low priority, Ring ID = 1: High prio queue */
+		if (!q)
+			sw_w32_mask(0, BIT(2), priv->r->dma_if_ctrl);
+		else
+			sw_w32_mask(0, BIT(3), priv->r->dma_if_ctrl);
 	} else {
-		dev_warn(&priv->pdev->dev, "Data is owned by switch\n");
-		ret = NETDEV_TX_BUSY;
+		sw_w32_mask(0, TX_DO, priv->r->dma_if_ctrl);
 	}
 
-txdone:
 	spin_unlock_irqrestore(&priv->lock, flags);
 
-	return ret;
+	return NETDEV_TX_OK;
 }
 
 /* Return queue number for TX. On the RTL83XX, these queues have equal priority
@@ -1238,19 +1461,69 @@ u16 rtl93xx_pick_tx_queue(struct net_device *dev, struct sk_buff *skb,
 	return 0;
 }
 
+/* Build an skb around the page_pool buffer of RX descriptor idx. A fresh
+ * buffer is attached to the descriptor first, so if that fails the frame is
+ * dropped and the old buffer simply stays on the ring.
+ */
+static struct sk_buff *rtl838x_rx_pp_build_skb(struct rtl838x_eth_priv *priv, int r,
+                                               int idx, int len)
+{
+	struct rtl838x_rx_q *rx_q = &priv->rx_qs[r];
+	void *buf = rx_q->rx_buf[idx];
+	dma_addr_t dma = rx_q->rx_dma[idx];
+	struct sk_buff *skb;
+
+	if (rtl838x_rx_pp_alloc(priv, rx_q, idx))
+		return NULL;
+
+	/* Only the part written by the ASIC needs to be synced */
+	dma_sync_single_for_cpu(&priv->pdev->dev, dma, len, DMA_FROM_DEVICE);
+
+	skb = napi_build_skb(buf, RX_PP_FRAG_SIZE);
+	if (unlikely(!skb)) {
+		page_pool_put_full_page(rx_q->page_pool, virt_to_head_page(buf), true);
+		return NULL;
+	}
+
+	skb_mark_for_recycle(skb);
+	skb_reserve(skb, RX_PP_HEADROOM);
+
+	return skb;
+}
+
+/* Hand count refilled RX descriptors starting at first back to the switch */
+static void rtl838x_rx_pp_release(struct rtl838x_eth_priv *priv, int r, int first, int count)
+{
+	struct ring_b *ring = priv->membase;
+
+	/* Make sure the headers are visible to the ASIC before giving them back */
+	wmb();
+
+	for (int i = 0; i < count; i++) {
+		int idx = (first + i) % priv->rxringlen;
+
+		ring->rx_r[r][idx] = KSEG1ADDR(&ring->rx_header[r][idx]) | 0x1 |
+		                     (idx == (priv->rxringlen - 1) ? WRAP : 0x1);
+	}
+}
+
 static int rtl838x_hw_receive(struct net_device *dev, int r, int budget)
 {
 	struct rtl838x_eth_priv *priv = netdev_priv(dev);
+	struct rtl838x_rx_q *rx_q = &priv->rx_qs[r];
 	struct ring_b *ring = priv->membase;
+	unsigned int packets = 0, bytes = 0, dropped = 0;
 	LIST_HEAD(rx_list);
 	unsigned long flags;
 	int work_done = 0;
 	u32	*last;
 	bool dsa = netdev_uses_dsa(dev);
+	int first;
 
 	pr_debug("---------------------------------------------------------- RX - %d\n", r);
-	spin_lock_irqsave(&priv->lock, flags);
+	spin_lock_irqsave(&rx_q->lock, flags);
 	last = (u32 *)KSEG1ADDR(sw_r32(priv->r->dma_if_rx_cur + r * 4));
+	first = ring->c_rx[r];
 
 	do {
 		struct sk_buff *skb;
@@ -1280,8 +1553,13 @@ static int rtl838x_hw_receive(struct net_device *dev, int r, int budget)
 		if (dsa)
 			len += 4;
 
-		skb = netdev_alloc_skb(dev, len + 4);
-		skb_reserve(skb, NET_IP_ALIGN);
+		if (priv->rx_page_pool) {
+			skb = rtl838x_rx_pp_build_skb(priv, r, ring->c_rx[r], h->len);
+		} else {
+			skb = netdev_alloc_skb(dev, len + 4);
+			if (likely(skb))
+				skb_reserve(skb, NET_IP_ALIGN);
+		}
 
 		if (likely(skb)) {
 			/* BUG: Prevent bug on RTL838x SoCs */
@@ -1297,9 +1575,11 @@ static int rtl838x_hw_receive(struct net_device *dev, int r, int budget)
 			}
 
 			skb_data = skb_put(skb, len);
-			/* Make sure data is visible */
-			mb();
-			memcpy(skb->data, (u8 *)KSEG1ADDR(data), len);
+			if (!priv->rx_page_pool) {
+				/* Make sure data is visible */
+				mb();
+				memcpy(skb->data, (u8 *)KSEG1ADDR(data), len);
+			}
 			/* Overwrite CRC with cpu_tag */
 			if (dsa) {
 				priv->r->decode_tag(h, &tag);
@@ -1322,34 +1602,51 @@ static int rtl838x_hw_receive(struct net_device *dev, int r, int budget)
 				else
 					skb->ip_summed = CHECKSUM_UNNECESSARY;
 			}
-			dev->stats.rx_packets++;
-			dev->stats.rx_bytes += len;
+			skb_record_rx_queue(skb, r);
+			packets++;
+			bytes += len;
 
 			list_add_tail(&skb->list, &rx_list);
 		} else {
 			if (net_ratelimit())
 				dev_warn(&dev->dev, "low on memory - packet dropped\n");
-			dev->stats.rx_dropped++;
+			dropped++;
 		}
 
 		/* Reset header structure */
 		memset(h, 0, sizeof(struct p_hdr));
-		h->buf = data;
 		h->size = RING_BUFFER;
 
-		ring->rx_r[r][ring->c_rx[r]] = KSEG1ADDR(h) | 0x1 | (ring->c_rx[r] == (priv->rxringlen - 1) ?
-		                               WRAP :
-		                               0x1);
+		if (priv->rx_page_pool) {
+			/* Descriptors are given back in one go after the loop */
+			h->buf = (u8 *)KSEG1ADDR(priv->rx_qs[r].rx_dma[ring->c_rx[r]]);
+		} else {
+			h->buf = data;
+			ring->rx_r[r][ring->c_rx[r]] = KSEG1ADDR(h) | 0x1 | (ring->c_rx[r] == (priv->rxringlen - 1) ?
+			                               WRAP :
+			                               0x1);
+		}
 		ring->c_rx[r] = (ring->c_rx[r] + 1) % priv->rxringlen;
 		last = (u32 *)KSEG1ADDR(sw_r32(priv->r->dma_if_rx_cur + r * 4));
 	} while (&ring->rx_r[r][ring->c_rx[r]] != last && work_done < budget);
 
-	netif_receive_skb_list(&rx_list);
+	if (priv->rx_page_pool)
+		rtl838x_rx_pp_release(priv, r, first, work_done);
 
-	/* Update counters */
+	/* Update counters, the counter registers are shared between rings */
+	spin_lock(&priv->lock);
 	priv->r->update_cntr(r, 0);
+	spin_unlock(&priv->lock);
 
-	spin_unlock_irqrestore(&priv->lock, flags);
+	u64_stats_update_begin(&rx_q->stats.syncp);
+	rx_q->stats.packets += packets;
+	rx_q->stats.bytes += bytes;
+	rx_q->stats.dropped += dropped;
+	u64_stats_update_end(&rx_q->stats.syncp);
+
+	spin_unlock_irqrestore(&rx_q->lock, flags);
+
+	netif_receive_skb_list(&rx_list);
 
 	return work_done;
 }
@@ -1376,12 +1673,64 @@ static int rtl838x_poll_rx(struct napi_struct *napi, int budget)
 		if (priv->family_id == RTL9300_FAMILY_ID || priv->family_id == RTL9310_FAMILY_ID)
 			sw_w32(0xffffffff, priv->r->dma_if_intr_rx_done_msk);
 		else
-			sw_w32_mask(0, 0xf00ff | BIT(r + 8), priv->r->dma_if_intr_msk);
+			sw_w32_mask(0, 0xff | BIT(r + 8), priv->r->dma_if_intr_msk);
 	}
 
 	return work_done;
 }
 
+/* Free the skbs of all descriptors the switch has handed back on ring q */
+static int rtl838x_tx_reclaim(struct rtl838x_eth_priv *priv, int q, int budget)
+{
+	struct netdev_queue *txq = netdev_get_tx_queue(priv->netdev, q);
+	struct ring_b *ring = priv->membase;
+	unsigned int bytes = 0;
+	int pkts = 0;
+
+	__netif_tx_lock(txq, smp_processor_id());
+
+	for (;;) {
+		struct rtl838x_tx_buf *buf = &priv->tx_bufs[q][priv->tx_dirty[q]];
+
+		/* Nothing in flight or still owned by the switch */
+		if (!buf->skb || (ring->tx_r[q][priv->tx_dirty[q]] & 0x1))
+			break;
+
+		dma_unmap_single(&priv->pdev->dev, buf->dma, buf->len, DMA_TO_DEVICE);
+		bytes += buf->len;
+		pkts++;
+		napi_consume_skb(buf->skb, budget);
+		buf->skb = NULL;
+
+		priv->tx_dirty[q] = (priv->tx_dirty[q] + 1) % TXRINGLEN;
+	}
+
+	netdev_tx_completed_queue(txq, pkts, bytes);
+	if (pkts && netif_tx_queue_stopped(txq))
+		netif_tx_wake_queue(txq);
+
+	__netif_tx_unlock(txq);
+
+	return pkts;
+}
+
+static int rtl838x_poll_tx(struct napi_struct *napi, int budget)
+{
+	struct rtl838x_eth_priv *priv = container_of(napi, struct rtl838x_eth_priv, tx_napi);
+
+	for (int q = 0; q < TXRINGS; q++)
+		rtl838x_tx_reclaim(priv, q, budget);
+
+	if (napi_complete_done(napi, 0)) {
+		/* Enable TX done interrupts */
+		if (priv->family_id == RTL9300_FAMILY_ID || priv->family_id == RTL9310_FAMILY_ID)
+			sw_w32(0x0000000f, priv->r->dma_if_intr_tx_done_msk);
+		else
+			sw_w32_mask(0, 0xf0000, priv->r->dma_if_intr_msk);
+	}
+
+	return 0;
+}
 
 static void rtl838x_validate(struct phylink_config *config,
 			 unsigned long *supported,
@@ -1628,6 +1977,72 @@ static int rtl838x_set_link_ksettings(struct net_device *ndev,
 	return phylink_ethtool_ksettings_set(priv->phylink, cmd);
 }
 
+static const char rtl838x_rx_ring_stats[][ETH_GSTRING_LEN] = {
+	"packets", "bytes", "dropped",
+};
+
+static void rtl838x_rx_ring_stats_get(struct rtl838x_rx_q *rx_q, u64 *data)
+{
+	unsigned int start;
+
+	do {
+		start = u64_stats_fetch_begin(&rx_q->stats.syncp);
+		data[0] = rx_q->stats.packets;
+		data[1] = rx_q->stats.bytes;
+		data[2] = rx_q->stats.dropped;
+	} while (u64_stats_fetch_retry(&rx_q->stats.syncp, start));
+}
+
+static int rtl838x_get_sset_count(struct net_device *ndev, int sset)
+{
+	struct rtl838x_eth_priv *priv = netdev_priv(ndev);
+
+	if (sset != ETH_SS_STATS)
+		return -EOPNOTSUPP;
+
+	return priv->rxrings * ARRAY_SIZE(rtl838x_rx_ring_stats);
+}
+
+static void rtl838x_get_strings(struct net_device *ndev, u32 sset, u8 *data)
+{
+	struct rtl838x_eth_priv *priv = netdev_priv(ndev);
+
+	if (sset != ETH_SS_STATS)
+		return;
+
+	for (int r = 0; r < priv->rxrings; r++)
+		for (int i = 0; i < ARRAY_SIZE(rtl838x_rx_ring_stats); i++)
+			ethtool_sprintf(&data, "rx_ring%d_%s", r, rtl838x_rx_ring_stats[i]);
+}
+
+static void rtl838x_get_ethtool_stats(struct net_device *ndev,
+				      struct ethtool_stats *stats, u64 *data)
+{
+	struct rtl838x_eth_priv *priv = netdev_priv(ndev);
+
+	for (int r = 0; r < priv->rxrings; r++) {
+		rtl838x_rx_ring_stats_get(&priv->rx_qs[r], data);
+		data += ARRAY_SIZE(rtl838x_rx_ring_stats);
+	}
+}
+
+/* RX counters are kept per ring, everything else in dev->stats */
+static void rtl838x_get_stats64(struct net_device *ndev, struct rtnl_link_stats64 *stats)
+{
+	struct rtl838x_eth_priv *priv = netdev_priv(ndev);
+
+	netdev_stats_to_stats64(stats, &ndev->stats);
+
+	for (int r = 0; r < priv->rxrings; r++) {
+		u64 data[ARRAY_SIZE(rtl838x_rx_ring_stats)];
+
+		rtl838x_rx_ring_stats_get(&priv->rx_qs[r], data);
+		stats->rx_packets += data[0];
+		stats->rx_bytes += data[1];
+		stats->rx_dropped += data[2];
+	}
+}
+
 /*
  * On all Realtek switch platforms the hardware periodically reads the link status of all
  * PHYs. This is to some degree programmable, so that one can tell the hardware to read
@@ -1707,27 +2122,64 @@ static int rtl838x_set_link_ksettings(struct net_device *ndev,
 #define RTMDIO_ABS		0x4
 #define RTMDIO_PKG		0x8
 
+static int rtmdio_83xx_read(struct mii_bus *bus, int addr, int regnum);
+static int rtmdio_93xx_read(struct mii_bus *bus, int addr, int regnum);
+
+/*
+ * On our own bus there is no need to go through the port and page emulation below. The
+ * read_phy()/write_phy() functions of the SoC take port and page as arguments, so a paged
+ * access of a plain PHY is exactly one bus transaction. SerDes mapped into the PHY address
+ * space and non raw accesses to the select register still need the emulation, as do PHYs
+ * on any other bus. For those -EOPNOTSUPP is returned. Must be called with the bus locked.
+ */
+
+static int rtmdio_direct(struct mii_bus *bus, int op, int port, int page, u32 regnum, u16 val)
+{
+	struct rtl838x_bus_priv *bus_priv = bus->priv;
+	struct rtl838x_eth_priv *eth_priv;
+	u32 v;
+	int err;
+
+	if (bus->read != rtmdio_83xx_read && bus->read != rtmdio_93xx_read)
+		return -EOPNOTSUPP;
+
+	eth_priv = bus_priv->eth_priv;
+	if (port < 0 || port >= MAX_PORTS)
+		return -EOPNOTSUPP;
+
+	if (eth_priv->family_id == RTL8380_FAMILY_ID ?
+	    (port >= 24 && port <= 27 && eth_priv->id == 0x8380) : eth_priv->phy_is_internal[port])
+		return -EOPNOTSUPP;
+
+	if (page < 0 || page > bus_priv->rawpage ||
+	    (regnum == RTMDIO_PAGE_SELECT && page != bus_priv->rawpage))
+		return -EOPNOTSUPP;
+
+	if (op & RTMDIO_WRITE)
+		return (*bus_priv->write_phy)(port, page, regnum, val);
+
+	err = (*bus_priv->read_phy)(port, page, regnum, &v);
+	return err ? err : v;
+}
+
 /*
  * Provide a generic read/write function so we can access arbitrary ports on the bus.
  * E.g. other ports of a PHY package on the bus. This basically resembles the kernel
  * phy_read_paged() and phy_write_paged() functions. To inform the bus that we are
  * working on a not default port send a RTMDIO_PORT_SELECT command at the beginning
- * and the end to switch the port handling logic.
+ * and the end to switch the port handling logic. Must be called with the bus locked.
  */
 
-static int rtmdio_access(struct phy_device *phydev, int op, int port,
-			 int page, u32 regnum, u16 val)
+static int __rtmdio_access(struct phy_device *phydev, int op, int port,
+			   int page, u32 regnum, u16 val)
 {
 	int r, ret = 0, oldpage;
 
-	if (op & RTMDIO_PKG) {
-		if (!phydev->shared)
-			return -EIO;
-		port = phydev->shared->base_addr + port;
-	}
+	ret = rtmdio_direct(phydev->mdio.bus, op, port, page, regnum, val);
+	if (ret != -EOPNOTSUPP)
+		return ret;
 
-	/* lock and inform bus about non default addressing */
-	phy_lock_mdio_bus(phydev);
+	/* inform bus about non default addressing */
 	__mdiobus_write(phydev->mdio.bus, phydev->mdio.addr,
 			RTMDIO_PORT_SELECT, port);
 
@@ -1752,14 +2204,64 @@ static int rtmdio_access(struct phy_device *phydev, int op, int port,
 	} else
 		ret = oldpage;
 
-	/* reset bus to default adressing and unlock it */
+	/* reset bus to default adressing */
 	__mdiobus_write(phydev->mdio.bus, phydev->mdio.addr,
 			RTMDIO_PORT_SELECT, -1);
+
+	return ret;
+}
+
+static int rtmdio_access(struct phy_device *phydev, int op, int port,
+			 int page, u32 regnum, u16 val)
+{
+	int ret;
+
+	if (op & RTMDIO_PKG) {
+		if (!phydev->shared)
+			return -EIO;
+		port = phydev->shared->base_addr + port;
+	}
+
+	phy_lock_mdio_bus(phydev);
+	ret = __rtmdio_access(phydev, op, port, page, regnum, val);
 	phy_unlock_mdio_bus(phydev);
 
 	return ret;
 }
 
+/*
+ * Write a whole table of registers on one page, e.g. a firmware patch, with a single bus
+ * lock. Entries are <port, regnum, value> triples if port is RTMDIO_TABLE_PORTS and
+ * <regnum, value> pairs otherwise. The table ends with the first entry that has a zero
+ * register (or port) number, the same as the patch tables in the PHY firmware files.
+ */
+
+#define RTMDIO_TABLE_PORTS	-1
+
+static int rtmdio_write_table(struct phy_device *phydev, int op, int port,
+			      int page, const u32 *table)
+{
+	int base = 0, ret = 0;
+
+	if (op & RTMDIO_PKG) {
+		if (!phydev->shared)
+			return -EIO;
+		base = phydev->shared->base_addr;
+	}
+
+	phy_lock_mdio_bus(phydev);
+	if (port == RTMDIO_TABLE_PORTS) {
+		for (; table[0] && table[1] && ret >= 0; table += 3)
+			ret = __rtmdio_access(phydev, op, base + table[0], page, table[1], table[2]);
+	} else {
+		for (; table[0] && ret >= 0; table += 2)
+			ret = __rtmdio_access(phydev, op, base + port, page, table[0], table[1]);
+	}
+	phy_unlock_mdio_bus(phydev);
+
+	return ret < 0 ? ret : 0;
+}
+
 /*
  * To make use of the shared package functions provide wrappers that align with kernel
  * naming conventions. The package() functions are useful to change settings on the
@@ -1798,6 +2300,21 @@ int phy_port_read_paged(struct phy_device *phydev, int port, int page, u32 regnu
 	return rtmdio_access(phydev, RTMDIO_READ | RTMDIO_ABS, port, page, regnum, 0);
 }
 
+int phy_package_write_paged_table(struct phy_device *phydev, int page, const u32 *table)
+{
+	return rtmdio_write_table(phydev, RTMDIO_WRITE | RTMDIO_PKG, RTMDIO_TABLE_PORTS, page, table);
+}
+
+int phy_package_port_write_paged_table(struct phy_device *phydev, int port, int page, const u32 *table)
+{
+	return rtmdio_write_table(phydev, RTMDIO_WRITE | RTMDIO_PKG, port, page, table);
+}
+
+int phy_port_write_paged_table(struct phy_device *phydev, int port, int page, const u32 *table)
+{
+	return rtmdio_write_table(phydev, RTMDIO_WRITE | RTMDIO_ABS, port, page, table);
+}
+
 /* These are the core functions of our new Realtek SoC MDIO bus. */
 
 static int rtmdio_read_c45(struct mii_bus *bus, int addr, int devnum, int regnum)
@@ -2395,6 +2912,7 @@ static const struct net_device_ops rtl838x_eth_netdev_ops = {
 	.ndo_validate_addr = eth_validate_addr,
 	.ndo_set_rx_mode = rtl838x_eth_set_multicast_list,
 	.ndo_tx_timeout = rtl838x_eth_tx_timeout,
+	.ndo_get_stats64 = rtl838x_get_stats64,
 	.ndo_set_features = rtl83xx_set_features,
 	.ndo_fix_features = rtl838x_fix_features,
 	.ndo_setup_tc = rtl83xx_setup_tc,
@@ -2409,6 +2927,7 @@ static const struct net_device_ops rtl839x_eth_netdev_ops = {
 	.ndo_validate_addr = eth_validate_addr,
 	.ndo_set_rx_mode = rtl839x_eth_set_multicast_list,
 	.ndo_tx_timeout = rtl838x_eth_tx_timeout,
+	.ndo_get_stats64 = rtl838x_get_stats64,
 	.ndo_set_features = rtl83xx_set_features,
 	.ndo_fix_features = rtl838x_fix_features,
 	.ndo_setup_tc = rtl83xx_setup_tc,
@@ -2423,6 +2942,7 @@ static const struct net_device_ops rtl930x_eth_netdev_ops = {
 	.ndo_validate_addr = eth_validate_addr,
 	.ndo_set_rx_mode = rtl930x_eth_set_multicast_list,
 	.ndo_tx_timeout = rtl838x_eth_tx_timeout,
+	.ndo_get_stats64 = rtl838x_get_stats64,
 	.ndo_set_features = rtl93xx_set_features,
 	.ndo_fix_features = rtl838x_fix_features,
 	.ndo_setup_tc = rtl83xx_setup_tc,
@@ -2437,6 +2957,7 @@ static const struct net_device_ops rtl931x_eth_netdev_ops = {
 	.ndo_validate_addr = eth_validate_addr,
 	.ndo_set_rx_mode = rtl931x_eth_set_multicast_list,
 	.ndo_tx_timeout = rtl838x_eth_tx_timeout,
+	.ndo_get_stats64 = rtl838x_get_stats64,
 	.ndo_set_features = rtl93xx_set_features,
 	.ndo_fix_features = rtl838x_fix_features,
 };
@@ -2458,6 +2979,9 @@ static const struct phylink_mac_ops rtl838x_phylink_ops = {
 static const struct ethtool_ops rtl838x_ethtool_ops = {
 	.get_link_ksettings     = rtl838x_get_link_ksettings,
 	.set_link_ksettings     = rtl838x_set_link_ksettings,
+	.get_sset_count         = rtl838x_get_sset_count,
+	.get_strings            = rtl838x_get_strings,
+	.get_ethtool_stats      = rtl838x_get_ethtool_stats,
 };
 
 static int __init rtl838x_eth_probe(struct platform_device *pdev)
@@ -2509,8 +3033,10 @@ static int __init rtl838x_eth_probe(struct platform_device *pdev)
 		return -ENXIO;
 	}
 
-	/* Allocate buffer memory */
-	priv->membase = dmam_alloc_coherent(&pdev->dev, rxrings * rxringlen * RING_BUFFER +
+	/* Allocate buffer memory, in page_pool mode RX buffers come from the pools */
+	priv->rx_page_pool = rx_page_pool;
+	priv->membase = dmam_alloc_coherent(&pdev->dev,
+	                                    (priv->rx_page_pool ? 0 : rxrings * rxringlen * RING_BUFFER) +
 	                                    sizeof(struct ring_b) + sizeof(struct notify_b),
 	                                    (void *)&dev->mem_start, GFP_KERNEL);
 	if (!priv->membase) {
@@ -2520,9 +3046,12 @@ static int __init rtl838x_eth_probe(struct platform_device *pdev)
 
 	/* Allocate ring-buffer space at the end of the allocated memory */
 	ring = priv->membase;
-	ring->rx_space = priv->membase + sizeof(struct ring_b) + sizeof(struct notify_b);
+	if (!priv->rx_page_pool)
+		ring->rx_space = priv->membase + sizeof(struct ring_b) + sizeof(struct notify_b);
 
 	spin_lock_init(&priv->lock);
+	spin_lock_init(&priv->fdb_lock);
+	INIT_WORK(&priv->fdb_work, rtl838x_fdb_sync);
 
 	dev->ethtool_ops = &rtl838x_ethtool_ops;
 	dev->min_mtu = ETH_ZLEN;
@@ -2629,8 +3158,18 @@ static int __init rtl838x_eth_probe(struct platform_device *pdev)
 	for (int i = 0; i < priv->rxrings; i++) {
 		priv->rx_qs[i].id = i;
 		priv->rx_qs[i].priv = priv;
+		spin_lock_init(&priv->rx_qs[i].lock);
+		u64_stats_init(&priv->rx_qs[i].stats.syncp);
 		netif_napi_add(dev, &priv->rx_qs[i].napi, rtl838x_poll_rx);
 	}
+	netif_napi_add_tx(dev, &priv->tx_napi, rtl838x_poll_tx);
+
+	/* All rings share one interrupt, so on SMP parts let each ring run
+	 * in its own NAPI thread. The napi/eth0-<ring> threads can then be
+	 * pinned to CPUs, /sys/class/net/<dev>/threaded turns this off again.
+	 */
+	if (num_possible_cpus() > 1 && dev_set_threaded(dev, true))
+		netdev_warn(dev, "cannot enable threaded NAPI\n");
 
 	platform_set_drvdata(pdev, dev);
 
@@ -2664,11 +3203,13 @@ static int rtl838x_eth_remove(struct platform_device *pdev)
 	if (dev) {
 		pr_info("Removing platform driver for rtl838x-eth\n");
 		rtl838x_hw_stop(priv);
+		cancel_work_sync(&priv->fdb_work);
 
 		netif_tx_stop_all_queues(dev);
 
 		for (int i = 0; i < priv->rxrings; i++)
 			netif_napi_del(&priv->rx_qs[i].napi);
+		netif_napi_del(&priv->tx_napi);
 	}
 
 	return 0;
@@ -14,6 +14,8 @@
 #include <linux/sfp.h>
 #include <linux/mii.h>
 #include <linux/mdio.h>
+#include <linux/async.h>
+#include <linux/ktime.h>
 
 #include <asm/mach-rtl838x/mach-rtl83xx.h>
 #include "rtl83xx-phy.h"
@@ -26,6 +28,9 @@ extern int phy_port_write_paged(struct phy_device *phydev, int port, int page, u
 extern int phy_package_port_read_paged(struct phy_device *phydev, int port, int page, u32 regnum);
 extern int phy_package_read_paged(struct phy_device *phydev, int page, u32 regnum);
 extern int phy_port_read_paged(struct phy_device *phydev, int port, int page, u32 regnum);
+extern int phy_package_write_paged_table(struct phy_device *phydev, int page, const u32 *table);
+extern int phy_package_port_write_paged_table(struct phy_device *phydev, int port, int page, const u32 *table);
+extern int phy_port_write_paged_table(struct phy_device *phydev, int port, int page, const u32 *table);
 
 #define PHY_PAGE_2	2
 #define PHY_PAGE_4	4
@@ -727,6 +732,7 @@ static struct fw_header *rtl838x_request_fw(struct phy_device *phydev,
 	int err;
 	struct fw_header *h;
 	uint32_t checksum, my_checksum;
+	static const uint32_t zero;
 
 	err = request_firmware(&fw, name, dev);
 	if (err < 0)
@@ -746,15 +752,20 @@ static struct fw_header *rtl838x_request_fw(struct phy_device *phydev,
 		goto out;
 	}
 
+	/*
+	 * The checksum is calculated with the checksum field set to zero. Don't modify the
+	 * buffer for that, packages are configured in parallel and may share it.
+	 */
 	checksum = h->checksum;
-	h->checksum = 0;
-	my_checksum = ~crc32(0xFFFFFFFFU, fw->data, fw->size);
+	my_checksum = crc32(0xFFFFFFFFU, fw->data, offsetof(struct fw_header, checksum));
+	my_checksum = crc32(my_checksum, &zero, sizeof(zero));
+	my_checksum = ~crc32(my_checksum, fw->data + offsetof(struct fw_header, version),
+			     fw->size - offsetof(struct fw_header, version));
 	if (checksum != my_checksum) {
 		pr_err("Firmware checksum mismatch.\n");
 		err = -EINVAL;
 		goto out;
 	}
-	h->checksum = checksum;
 
 	return h;
 out:
@@ -873,22 +884,10 @@ static int rtl8380_configure_int_rtl8218b(struct phy_device *phydev)
 		}
 	}
 	for (int p = 0; p < 8; p++) {
-		int i;
-
-		i = 0;
-		while (rtl838x_6275B_intPhy_perport[i * 2]) {
-			phy_package_port_write_paged(phydev, p, RTL838X_PAGE_RAW,
-			                             rtl838x_6275B_intPhy_perport[i * 2],
-			                             rtl838x_6275B_intPhy_perport[i * 2 + 1]);
-			i++;
-		}
-		i = 0;
-		while (rtl8218b_6276B_hwEsd_perport[i * 2]) {
-			phy_package_port_write_paged(phydev, p, RTL838X_PAGE_RAW,
-			                             rtl8218b_6276B_hwEsd_perport[i * 2],
-			                             rtl8218b_6276B_hwEsd_perport[i * 2 + 1]);
-			i++;
-		}
+		phy_package_port_write_paged_table(phydev, p, RTL838X_PAGE_RAW,
+		                                   rtl838x_6275B_intPhy_perport);
+		phy_package_port_write_paged_table(phydev, p, RTL838X_PAGE_RAW,
+		                                   rtl8218b_6276B_hwEsd_perport);
 	}
 
 	return 0;
@@ -950,19 +949,14 @@ static int rtl8380_configure_ext_rtl8218b(struct phy_device *phydev)
 
 	phydev_info(phydev, "Detected chip revision %04x\n", val);
 
-	for (int i = 0; rtl8380_rtl8218b_perchip[i * 3] &&
-	                rtl8380_rtl8218b_perchip[i * 3 + 1]; i++) {
-		phy_package_port_write_paged(phydev, rtl8380_rtl8218b_perchip[i * 3],
-					     RTL838X_PAGE_RAW, rtl8380_rtl8218b_perchip[i * 3 + 1],
-					     rtl8380_rtl8218b_perchip[i * 3 + 2]);
-	}
+	phy_package_write_paged_table(phydev, RTL838X_PAGE_RAW, rtl8380_rtl8218b_perchip);
 
 	/* Enable PHY */
 	for (int i = 0; i < 8; i++) {
 		phy_package_port_write_paged(phydev, i, RTL838X_PAGE_RAW, RTL8XXX_PAGE_SELECT, RTL8XXX_PAGE_MAIN);
 		phy_package_port_write_paged(phydev, i, RTL838X_PAGE_RAW, 0x00, 0x1140);
 	}
-	mdelay(100);
+	msleep(100);
 
 	/* Request patch */
 	for (int i = 0; i < 8; i++) {
@@ -970,7 +964,7 @@ static int rtl8380_configure_ext_rtl8218b(struct phy_device *phydev)
 		phy_package_port_write_paged(phydev, i, RTL838X_PAGE_RAW, 0x10, 0x0010);
 	}
 
-	mdelay(300);
+	msleep(300);
 
 	/* Verify patch readiness */
 	for (int i = 0; i < 8; i++) {
@@ -998,10 +992,7 @@ static int rtl8380_configure_ext_rtl8218b(struct phy_device *phydev)
 	phy_write_paged(phydev, 0, 30, 0);
 	ipd = (ipd >> 4) & 0xf; /* unused ? */
 
-	for (int i = 0; rtl8218B_6276B_rtl8380_perport[i * 2]; i++) {
-		phy_write_paged(phydev, RTL838X_PAGE_RAW, rtl8218B_6276B_rtl8380_perport[i * 2],
-		                rtl8218B_6276B_rtl8380_perport[i * 2 + 1]);
-	}
+	phy_port_write_paged_table(phydev, mac, RTL838X_PAGE_RAW, rtl8218B_6276B_rtl8380_perport);
 
 	/* Disable broadcast ID */
 	rtl821x_phy_setup_package_broadcast(phydev, false);
@@ -1454,7 +1445,7 @@ static int rtl8380_configure_rtl8214fc(struct phy_device *phydev)
 		phy_package_port_write_paged(phydev, i, RTL838X_PAGE_RAW, RTL8XXX_PAGE_SELECT, RTL8XXX_PAGE_MAIN);
 		phy_package_port_write_paged(phydev, i, RTL838X_PAGE_RAW, 0x00, 0x1140);
 	}
-	mdelay(100);
+	msleep(100);
 
 	/* Disable Autosensing */
 	for (int i = 0; i < 4; i++) {
@@ -1476,7 +1467,7 @@ static int rtl8380_configure_rtl8214fc(struct phy_device *phydev)
 		phy_package_port_write_paged(phydev, i, RTL838X_PAGE_RAW, RTL8XXX_PAGE_SELECT, RTL821X_PAGE_PATCH);
 		phy_package_port_write_paged(phydev, i, RTL838X_PAGE_RAW, 0x10, 0x0010);
 	}
-	mdelay(300);
+	msleep(300);
 
 	/* Verify patch readiness */
 	for (int i = 0; i < 4; i++) {
@@ -1495,10 +1486,7 @@ static int rtl8380_configure_rtl8214fc(struct phy_device *phydev)
 	/* Use Broadcast ID method for patching */
 	rtl821x_phy_setup_package_broadcast(phydev, true);
 
-	for (int i = 0; rtl8380_rtl8214fc_perport[i * 2]; i++) {
-		phy_write_paged(phydev, RTL838X_PAGE_RAW, rtl8380_rtl8214fc_perport[i * 2],
-		                rtl8380_rtl8214fc_perport[i * 2 + 1]);
-	}
+	phy_port_write_paged_table(phydev, phydev->mdio.addr, RTL838X_PAGE_RAW, rtl8380_rtl8214fc_perport);
 
 	/* Disable broadcast ID */
 	rtl821x_phy_setup_package_broadcast(phydev, false);
@@ -3697,10 +3685,90 @@ int rtl931x_link_sts_get(u32 sds)
 	return sts1;
 }
 
+/*
+ * Patching a PHY package takes a few hundred milliseconds, most of it waiting for the
+ * PHYs. Instead of doing that for one package after the other from the probe of their
+ * first port, run the configuration from the async domain, so that all packages are
+ * patched in parallel. Every port of the driver waits for that to finish before it is
+ * used, both in config_init() and on SFP insertion.
+ */
+
+static bool async_configure = true;
+module_param(async_configure, bool, 0444);
+MODULE_PARM_DESC(async_configure, "Configure the PHY packages in parallel");
+
+static ASYNC_DOMAIN_EXCLUSIVE(rtl83xx_package_domain);
+
+static void rtl83xx_package_configure_run(struct phy_device *phydev)
+{
+	struct rtl83xx_shared_private *shared = phydev->shared->priv;
+	ktime_t start = ktime_get();
+
+	shared->configure_ret = shared->configure(phydev);
+	phydev_info(phydev, "%s package %s after %lld ms\n", shared->name,
+		    shared->configure_ret ? "configuration failed" : "configured",
+		    ktime_ms_delta(ktime_get(), start));
+}
+
+static void rtl83xx_package_configure_async(void *data, async_cookie_t cookie)
+{
+	rtl83xx_package_configure_run(data);
+}
+
+static int rtl83xx_package_configure(struct phy_device *phydev,
+				     int (*configure)(struct phy_device *phydev))
+{
+	struct rtl83xx_shared_private *shared = phydev->shared->priv;
+
+	shared->configure = configure;
+	if (!async_configure) {
+		rtl83xx_package_configure_run(phydev);
+		return shared->configure_ret;
+	}
+
+	async_schedule_domain(rtl83xx_package_configure_async, phydev, &rtl83xx_package_domain);
+
+	return 0;
+}
+
+static int rtl83xx_package_wait(struct phy_device *phydev)
+{
+	struct rtl83xx_shared_private *shared;
+	ktime_t start = ktime_get();
+	s64 waited;
+
+	async_synchronize_full_domain(&rtl83xx_package_domain);
+
+	waited = ktime_ms_delta(ktime_get(), start);
+	if (waited)
+		phydev_dbg(phydev, "waited %lld ms for PHY package configuration\n", waited);
+
+	if (!phydev->shared)
+		return 0;
+
+	shared = phydev->shared->priv;
+
+	return shared->configure ? shared->configure_ret : 0;
+}
+
+static int rtl83xx_package_config_init(struct phy_device *phydev)
+{
+	return rtl83xx_package_wait(phydev);
+}
+
+/* For the switch, before it lets the MAC poll the PHYs */
+void rtl83xx_phy_wait_configured(void)
+{
+	async_synchronize_full_domain(&rtl83xx_package_domain);
+}
+
 static int rtl8214fc_sfp_insert(void *upstream, const struct sfp_eeprom_id *id)
 {
 	struct phy_device *phydev = upstream;
 
+	if (rtl83xx_package_wait(phydev))
+		return -EIO;
+
 	rtl8214fc_media_set(phydev, true);
 
 	return 0;
@@ -3738,7 +3806,7 @@ static int rtl8214fc_phy_probe(struct phy_device *phydev)
 		struct rtl83xx_shared_private *shared = phydev->shared->priv;
 		shared->name = "RTL8214FC";
 		/* Configuration must be done while patching still possible */
-		ret = rtl8380_configure_rtl8214fc(phydev);
+		ret = rtl83xx_package_configure(phydev, rtl8380_configure_rtl8214fc);
 		if (ret)
 			return ret;
 	}
@@ -3779,7 +3847,7 @@ static int rtl8218b_ext_phy_probe(struct phy_device *phydev)
 		shared->name = "RTL8218B (external)";
 		if (soc_info.family == RTL8380_FAMILY_ID) {
 			/* Configuration must be done while patching still possible */
-			return rtl8380_configure_ext_rtl8218b(phydev);
+			return rtl83xx_package_configure(phydev, rtl8380_configure_ext_rtl8218b);
 		}
 	}
 
@@ -3805,7 +3873,7 @@ static int rtl8218b_int_phy_probe(struct phy_device *phydev)
 		struct rtl83xx_shared_private *shared = phydev->shared->priv;
 		shared->name = "RTL8218B (internal)";
 		/* Configuration must be done while patching still possible */
-		return rtl8380_configure_int_rtl8218b(phydev);
+		return rtl83xx_package_configure(phydev, rtl8380_configure_int_rtl8218b);
 	}
 
 	return 0;
@@ -3905,6 +3973,7 @@ static struct phy_driver rtl83xx_phy_driver[] = {
 		.name		= "Realtek RTL8214FC",
 		.features	= PHY_GBIT_FIBRE_FEATURES,
 		.probe		= rtl8214fc_phy_probe,
+		.config_init	= rtl83xx_package_config_init,
 		.read_page	= rtl821x_read_page,
 		.write_page	= rtl821x_write_page,
 		.suspend	= rtl8214fc_suspend,
@@ -3920,6 +3989,7 @@ static struct phy_driver rtl83xx_phy_driver[] = {
 		.name		= "Realtek RTL8218B (external)",
 		.features	= PHY_GBIT_FEATURES,
 		.probe		= rtl8218b_ext_phy_probe,
+		.config_init	= rtl83xx_package_config_init,
 		.read_page	= rtl821x_read_page,
 		.write_page	= rtl821x_write_page,
 		.suspend	= genphy_suspend,
@@ -3974,6 +4044,7 @@ static struct phy_driver rtl83xx_phy_driver[] = {
 		.name		= "Realtek RTL8218B (internal)",
 		.features	= PHY_GBIT_FEATURES,
 		.probe		= rtl8218b_int_phy_probe,
+		.config_init	= rtl83xx_package_config_init,
 		.read_page	= rtl821x_read_page,
 		.write_page	= rtl821x_write_page,
 		.suspend	= genphy_suspend,
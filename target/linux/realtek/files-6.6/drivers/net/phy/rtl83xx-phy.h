@@ -2,6 +2,8 @@
 
 struct rtl83xx_shared_private {
 	char *name;
+	int (*configure)(struct phy_device *phydev);
+	int configure_ret;
 };
 
 struct __attribute__ ((__packed__)) part {
@@ -103,18 +103,22 @@ platform_do_upgrade() {
 		return 0
 	fi
 
-	#iterate over each partition from the image and write it to the boot disk
+	#write each partition from the image to the boot disk, in one pass over
+	#the image along with its boot sector for the UUID
+	local ranges="0:1:/tmp/image.mbr"
 	while read part start size; do
 		if export_partdevice partdev $part; then
 			v "Writing image to /dev/$partdev..."
-			get_image_dd "$1" of="/dev/$partdev" ibs=512 obs=1M skip="$start" count="$size" conv=fsync
+			append ranges "$start:$size:/dev/$partdev"
 		else
 			v "Unable to find partition $part device, skipped."
 		fi
 	done < /tmp/partmap.image
+	get_image_ranges "$1" $ranges
 
 	v "Writing new UUID to /dev/$diskdev..."
-	get_image_dd "$1" of="/dev/$diskdev" bs=1 skip=440 count=4 seek=440 conv=fsync
+	dd if=/tmp/image.mbr of="/dev/$diskdev" bs=1 skip=440 count=4 seek=440 conv=fsync 2>/dev/null
+	rm -f /tmp/image.mbr
 
 	platform_do_bootloader_upgrade "$diskdev"
 	local parttype=ext4